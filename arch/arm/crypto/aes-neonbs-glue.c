@@ -14,6 +14,7 @@
 #include <crypto/internal/skcipher.h>
 #include <crypto/scatterwalk.h>
 #include <crypto/xts.h>
+#include <linux/sizes.h>
 #include <linux/module.h>
 
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
@@ -238,9 +239,17 @@ static int ctr_encrypt(struct skcipher_request *req)
 	struct aesbs_ctx *ctx = crypto_skcipher_ctx(tfm);
 	struct skcipher_walk walk;
 	u8 buf[AES_BLOCK_SIZE];
+	unsigned int done = 0;
 	int err;
 
-	err = skcipher_walk_virt(&walk, req, false);
+	/*
+	 * As in the chacha glue: one kernel mode NEON section per SZ_4K of
+	 * data rather than per walk step, which needs an atomic walk.
+	 */
+	err = skcipher_walk_virt(&walk, req, true);
+
+	if (walk.nbytes)
+		kernel_neon_begin();
 
 	while (walk.nbytes > 0) {
 		const u8 *src = walk.src.virt.addr;
@@ -253,15 +262,21 @@ static int ctr_encrypt(struct skcipher_request *req)
 		else if (walk.nbytes < walk.total)
 			bytes &= ~(8 * AES_BLOCK_SIZE - 1);
 
-		kernel_neon_begin();
 		aesbs_ctr_encrypt(dst, src, ctx->rk, ctx->rounds, bytes, walk.iv);
-		kernel_neon_end();
+		done += bytes;
 
 		if (unlikely(bytes < AES_BLOCK_SIZE))
 			memcpy(walk.dst.virt.addr,
 			       buf + sizeof(buf) - bytes, bytes);
 
 		err = skcipher_walk_done(&walk, walk.nbytes - bytes);
+
+		if (done >= SZ_4K || !walk.nbytes) {
+			kernel_neon_end();
+			if (walk.nbytes)
+				kernel_neon_begin();
+			done = 0;
+		}
 	}
 
 	return err;
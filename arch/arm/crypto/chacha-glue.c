@@ -111,30 +111,48 @@ static int chacha_stream_xor(struct skcipher_request *req,
 			     bool neon)
 {
 	struct skcipher_walk walk;
+	unsigned int done = 0;
 	u32 state[16];
 	int err;
 
-	err = skcipher_walk_virt(&walk, req, false);
+	neon = IS_ENABLED(CONFIG_KERNEL_MODE_NEON) && neon;
+
+	/*
+	 * Stay in kernel mode NEON across the walk, so a request spread over
+	 * several pages or fragments (an ESP packet, say) enters it once, and
+	 * only drop out every SZ_4K of data to bound the latency, like
+	 * chacha_crypt_arch() does. The walk must not sleep meanwhile.
+	 */
+	err = skcipher_walk_virt(&walk, req, neon);
 
 	chacha_init_generic(state, ctx->key, iv);
 
+	if (neon && walk.nbytes)
+		kernel_neon_begin();
+
 	while (walk.nbytes > 0) {
 		unsigned int nbytes = walk.nbytes;
 
 		if (nbytes < walk.total)
 			nbytes = round_down(nbytes, walk.stride);
 
-		if (!IS_ENABLED(CONFIG_KERNEL_MODE_NEON) || !neon) {
+		if (!neon) {
 			chacha_doarm(walk.dst.virt.addr, walk.src.virt.addr,
 				     nbytes, state, ctx->nrounds);
 			state[12] += DIV_ROUND_UP(nbytes, CHACHA_BLOCK_SIZE);
 		} else {
-			kernel_neon_begin();
 			chacha_doneon(state, walk.dst.virt.addr,
 				      walk.src.virt.addr, nbytes, ctx->nrounds);
-			kernel_neon_end();
+			done += nbytes;
 		}
 		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
+
+		if (neon && (done >= SZ_4K || !walk.nbytes)) {
+			kernel_neon_end();
+			if (walk.nbytes)
+				kernel_neon_begin();
+			done = 0;
+		}
 	}
 
 	return err;
@@ -8,7 +8,9 @@
 #include <linux/cpufeature.h>
 #include <linux/crc32.h>
 #include <linux/init.h>
+#include <linux/gfp.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/string.h>
 
@@ -30,9 +32,15 @@ asmlinkage u32 crc32_armv8_le(u32 init_crc, const u8 buf[], u32 len);
 asmlinkage u32 crc32c_pmull_le(const u8 buf[], u32 len, u32 init_crc);
 asmlinkage u32 crc32c_armv8_le(u32 init_crc, const u8 buf[], u32 len);
 
+asmlinkage u32 crc32_pmull_p8_le(const u8 buf[], u32 len, u32 init_crc);
+asmlinkage u32 crc32c_pmull_p8_le(const u8 buf[], u32 len, u32 init_crc);
+
 static u32 (*fallback_crc32)(u32 init_crc, const u8 buf[], u32 len);
 static u32 (*fallback_crc32c)(u32 init_crc, const u8 buf[], u32 len);
 
+static u32 (*pmull_crc32)(const u8 buf[], u32 len, u32 init_crc);
+static u32 (*pmull_crc32c)(const u8 buf[], u32 len, u32 init_crc);
+
 static int crc32_cra_init(struct crypto_tfm *tfm)
 {
 	u32 *key = crypto_tfm_ctx(tfm);
@@ -123,7 +131,7 @@ static int crc32_pmull_update(struct shash_desc *desc, const u8 *data,
 			l = round_down(length, SCALE_F);
 
 			kernel_neon_begin();
-			*crc = crc32_pmull_le(data, l, *crc);
+			*crc = pmull_crc32(data, l, *crc);
 			kernel_neon_end();
 
 			data += l;
@@ -157,7 +165,7 @@ static int crc32c_pmull_update(struct shash_desc *desc, const u8 *data,
 			l = round_down(length, SCALE_F);
 
 			kernel_neon_begin();
-			*crc = crc32c_pmull_le(data, l, *crc);
+			*crc = pmull_crc32c(data, l, *crc);
 			kernel_neon_end();
 
 			data += l;
@@ -205,11 +213,49 @@ static struct shash_alg crc32_pmull_algs[] = { {
 	.base.cra_module	= THIS_MODULE,
 } };
 
+/*
+ * The vmull.p8 based folding needs roughly ten NEON multiplies for every
+ * vmull.p64, so whether it beats the slice-by-8 tables depends on the
+ * core.  Time both once over a page and only use NEON if it wins.
+ */
+static bool __init crc32_pmull_p8_faster(void)
+{
+	u64 t0, t1, t2;
+	u8 *buf;
+
+	buf = (u8 *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return false;
+	memset(buf, 0x5a, PAGE_SIZE);
+
+	/* warm up caches and the NEON unit */
+	crc32_le(0, buf, PAGE_SIZE);
+	kernel_neon_begin();
+	crc32_pmull_p8_le(buf, PAGE_SIZE, 0);
+	kernel_neon_end();
+
+	t0 = ktime_get_ns();
+	crc32_le(0, buf, PAGE_SIZE);
+	t1 = ktime_get_ns();
+	kernel_neon_begin();
+	crc32_pmull_p8_le(buf, PAGE_SIZE, 0);
+	kernel_neon_end();
+	t2 = ktime_get_ns();
+
+	free_page((unsigned long)buf);
+
+	pr_debug("crc32: %lu bytes: table %llu ns, NEON vmull.p8 %llu ns\n",
+		 PAGE_SIZE, t1 - t0, t2 - t1);
+	return t2 - t1 < t1 - t0;
+}
+
 static int __init crc32_pmull_mod_init(void)
 {
 	if (elf_hwcap2 & HWCAP2_PMULL) {
 		crc32_pmull_algs[0].update = crc32_pmull_update;
 		crc32_pmull_algs[1].update = crc32c_pmull_update;
+		pmull_crc32 = crc32_pmull_le;
+		pmull_crc32c = crc32c_pmull_le;
 
 		if (elf_hwcap2 & HWCAP2_CRC32) {
 			fallback_crc32 = crc32_armv8_le;
@@ -219,7 +265,19 @@ static int __init crc32_pmull_mod_init(void)
 			fallback_crc32c = __crc32c_le;
 		}
 	} else if (!(elf_hwcap2 & HWCAP2_CRC32)) {
-		return -ENODEV;
+		if (!(elf_hwcap & HWCAP_NEON) || !crc32_pmull_p8_faster())
+			return -ENODEV;
+
+		crc32_pmull_algs[0].update = crc32_pmull_update;
+		crc32_pmull_algs[1].update = crc32c_pmull_update;
+		strscpy(crc32_pmull_algs[0].base.cra_driver_name,
+			"crc32-arm-neon", CRYPTO_MAX_ALG_NAME);
+		strscpy(crc32_pmull_algs[1].base.cra_driver_name,
+			"crc32c-arm-neon", CRYPTO_MAX_ALG_NAME);
+		pmull_crc32 = crc32_pmull_p8_le;
+		pmull_crc32c = crc32c_pmull_p8_le;
+		fallback_crc32 = crc32_le;
+		fallback_crc32c = __crc32c_le;
 	}
 
 	return crypto_register_shashes(crc32_pmull_algs,
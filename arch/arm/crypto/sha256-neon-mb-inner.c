@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * SHA-256 over four independent messages at once, one message per 32-bit
+ * NEON lane.  Used by the sha256-neon finup_mb() hook; must be called
+ * between kernel_neon_begin() and kernel_neon_end().
+ *
+ * Built with NEON flags and <arm_neon.h>, whose types clash with the
+ * kernel's, so no kernel header may be included here; sha256_glue.h has
+ * the prototype the glue code uses.
+ */
+
+#include <arm_neon.h>
+
+/* Must match sha256_glue.h and crypto/sha2.h */
+#define SHA256_NEON_MB_LANES	4
+#define SHA256_BLOCK_SIZE	64
+
+void sha256_blocks_neon_x4(uint32_t state[8][SHA256_NEON_MB_LANES],
+			   const uint8_t *const src[SHA256_NEON_MB_LANES],
+			   unsigned int blocks);
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ror(x, n)	vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+
+#define Sigma0(x)	veorq_u32(veorq_u32(ror(x, 2), ror(x, 13)), ror(x, 22))
+#define Sigma1(x)	veorq_u32(veorq_u32(ror(x, 6), ror(x, 11)), ror(x, 25))
+#define sigma0(x)	veorq_u32(veorq_u32(ror(x, 7), ror(x, 18)), \
+				  vshrq_n_u32(x, 3))
+#define sigma1(x)	veorq_u32(veorq_u32(ror(x, 17), ror(x, 19)), \
+				  vshrq_n_u32(x, 10))
+
+static inline uint32x4_t load_be32x4(const uint8_t *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+/* Load 16 bytes from each message and transpose to one word per vector. */
+static inline void load_words(uint32x4_t w[4], const uint8_t *const p[4],
+			      int off)
+{
+	uint32x4x2_t t01 = vtrnq_u32(load_be32x4(p[0] + off),
+				     load_be32x4(p[1] + off));
+	uint32x4x2_t t23 = vtrnq_u32(load_be32x4(p[2] + off),
+				     load_be32x4(p[3] + off));
+
+	w[0] = vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0]));
+	w[1] = vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1]));
+	w[2] = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+	w[3] = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+}
+
+void sha256_blocks_neon_x4(uint32_t state[8][SHA256_NEON_MB_LANES],
+			   const uint8_t *const src[SHA256_NEON_MB_LANES],
+			   unsigned int blocks)
+{
+	const uint8_t *p[SHA256_NEON_MB_LANES] = {
+		src[0], src[1], src[2], src[3]
+	};
+	uint32x4_t s[8], w[16];
+	int i, t;
+
+	for (i = 0; i < 8; i++)
+		s[i] = vld1q_u32(state[i]);
+
+	while (blocks--) {
+		uint32x4_t a = s[0], b = s[1], c = s[2], d = s[3];
+		uint32x4_t e = s[4], f = s[5], g = s[6], h = s[7];
+
+		for (i = 0; i < 4; i++)
+			load_words(&w[4 * i], p, 16 * i);
+
+		for (t = 0; t < 64; t++) {
+			uint32x4_t t1, t2;
+
+			if (t >= 16)
+				w[t & 15] = vaddq_u32(vaddq_u32(w[t & 15],
+						sigma1(w[(t - 2) & 15])),
+					vaddq_u32(w[(t - 7) & 15],
+						sigma0(w[(t - 15) & 15])));
+
+			t1 = vaddq_u32(vaddq_u32(h, Sigma1(e)),
+				       vaddq_u32(vbslq_u32(e, f, g),
+						 vaddq_u32(vdupq_n_u32(sha256_k[t]),
+							   w[t & 15])));
+			t2 = vaddq_u32(Sigma0(a), vbslq_u32(veorq_u32(a, b), c, b));
+
+			h = g;
+			g = f;
+			f = e;
+			e = vaddq_u32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = vaddq_u32(t1, t2);
+		}
+
+		s[0] = vaddq_u32(s[0], a);
+		s[1] = vaddq_u32(s[1], b);
+		s[2] = vaddq_u32(s[2], c);
+		s[3] = vaddq_u32(s[3], d);
+		s[4] = vaddq_u32(s[4], e);
+		s[5] = vaddq_u32(s[5], f);
+		s[6] = vaddq_u32(s[6], g);
+		s[7] = vaddq_u32(s[7], h);
+
+		for (i = 0; i < SHA256_NEON_MB_LANES; i++)
+			p[i] += SHA256_BLOCK_SIZE;
+	}
+
+	for (i = 0; i < 8; i++)
+		vst1q_u32(state[i], s[i]);
+}
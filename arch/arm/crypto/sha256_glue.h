@@ -3,6 +3,9 @@
 #define _CRYPTO_SHA256_GLUE_H
 
 #include <linux/crypto.h>
+#include <crypto/sha2.h>
+
+struct shash_desc;
 
 extern struct shash_alg sha256_neon_algs[2];
 
@@ -12,4 +15,11 @@ int crypto_sha256_arm_update(struct shash_desc *desc, const u8 *data,
 int crypto_sha256_arm_finup(struct shash_desc *desc, const u8 *data,
 			    unsigned int len, u8 *hash);
 
+#define SHA256_NEON_MB_LANES	4
+
+/* In sha256-neon-mb-inner.c, which cannot include this header */
+void sha256_blocks_neon_x4(u32 state[8][SHA256_NEON_MB_LANES],
+			   const u8 *const src[SHA256_NEON_MB_LANES],
+			   unsigned int blocks);
+
 #endif /* _CRYPTO_SHA256_GLUE_H */
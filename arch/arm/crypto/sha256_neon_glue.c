@@ -18,6 +18,7 @@
 #include <asm/byteorder.h>
 #include <asm/simd.h>
 #include <asm/neon.h>
+#include <asm/unaligned.h>
 
 #include "sha256_glue.h"
 
@@ -63,13 +64,99 @@ static int crypto_sha256_neon_final(struct shash_desc *desc, u8 *out)
 	return crypto_sha256_neon_finup(desc, NULL, 0, out);
 }
 
+/*
+ * Finish up to four equal length messages that share the state in @desc
+ * (typically a dm-verity salt), one message per NEON lane.  Unused lanes
+ * hash a copy of the first message into a scratch digest.
+ */
+static int crypto_sha256_neon_finup_mb(struct shash_desc *desc,
+				       const u8 * const data[],
+				       unsigned int len, u8 * const outs[],
+				       unsigned int num_msgs)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA256_BLOCK_SIZE;
+	unsigned int digestsize = crypto_shash_digestsize(desc->tfm);
+	u64 bits = (sctx->count + len) << 3;
+	u8 buf[SHA256_NEON_MB_LANES][2 * SHA256_BLOCK_SIZE];
+	u32 state[8][SHA256_NEON_MB_LANES];
+	const u8 *src[SHA256_NEON_MB_LANES];
+	unsigned int i, j, done = 0, blocks, tail;
+
+	if (!crypto_simd_usable()) {
+		SHASH_DESC_ON_STACK(tmp, desc->tfm);
+		int err = 0;
+
+		tmp->tfm = desc->tfm;
+		for (i = 0; i < num_msgs && !err; i++) {
+			memcpy(shash_desc_ctx(tmp), sctx, sizeof(*sctx));
+			err = crypto_sha256_arm_finup(tmp, data[i], len, outs[i]);
+		}
+		shash_desc_zero(tmp);
+		return err;
+	}
+
+	for (i = 0; i < SHA256_NEON_MB_LANES; i++)
+		for (j = 0; j < 8; j++)
+			state[j][i] = sctx->state[j];
+
+	kernel_neon_begin();
+
+	if (partial && partial + len >= SHA256_BLOCK_SIZE) {
+		done = SHA256_BLOCK_SIZE - partial;
+		for (i = 0; i < SHA256_NEON_MB_LANES; i++) {
+			memcpy(buf[i], sctx->buf, partial);
+			memcpy(buf[i] + partial, data[i < num_msgs ? i : 0], done);
+			src[i] = buf[i];
+		}
+		sha256_blocks_neon_x4(state, src, 1);
+		partial = 0;
+	}
+
+	blocks = (len - done) / SHA256_BLOCK_SIZE;
+	if (blocks) {
+		for (i = 0; i < SHA256_NEON_MB_LANES; i++)
+			src[i] = data[i < num_msgs ? i : 0] + done;
+		sha256_blocks_neon_x4(state, src, blocks);
+		done += blocks * SHA256_BLOCK_SIZE;
+	}
+
+	/* whatever is left, the 0x80 terminator and the bit count */
+	tail = partial + len - done;
+	blocks = tail + 1 + sizeof(__be64) > SHA256_BLOCK_SIZE ? 2 : 1;
+	for (i = 0; i < SHA256_NEON_MB_LANES; i++) {
+		memcpy(buf[i], sctx->buf, partial);
+		memcpy(buf[i] + partial, data[i < num_msgs ? i : 0] + done,
+		       len - done);
+		buf[i][tail] = 0x80;
+		memset(buf[i] + tail + 1, 0,
+		       blocks * SHA256_BLOCK_SIZE - tail - 1 - sizeof(__be64));
+		put_unaligned_be64(bits,
+				   buf[i] + blocks * SHA256_BLOCK_SIZE - sizeof(__be64));
+		src[i] = buf[i];
+	}
+	sha256_blocks_neon_x4(state, src, blocks);
+
+	kernel_neon_end();
+
+	for (i = 0; i < num_msgs; i++)
+		for (j = 0; j < digestsize / sizeof(__be32); j++)
+			put_unaligned_be32(state[j][i], outs[i] + j * sizeof(__be32));
+
+	memzero_explicit(buf, sizeof(buf));
+	memzero_explicit(state, sizeof(state));
+	return 0;
+}
+
 struct shash_alg sha256_neon_algs[] = { {
 	.digestsize	=	SHA256_DIGEST_SIZE,
 	.init		=	sha256_base_init,
 	.update		=	crypto_sha256_neon_update,
 	.final		=	crypto_sha256_neon_final,
 	.finup		=	crypto_sha256_neon_finup,
+	.finup_mb	=	crypto_sha256_neon_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_MB_LANES,
 	.base		=	{
 		.cra_name	=	"sha256",
 		.cra_driver_name =	"sha256-neon",
@@ -83,7 +170,9 @@ struct shash_alg sha256_neon_algs[] = { {
 	.update		=	crypto_sha256_neon_update,
 	.final		=	crypto_sha256_neon_final,
 	.finup		=	crypto_sha256_neon_finup,
+	.finup_mb	=	crypto_sha256_neon_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_MB_LANES,
 	.base		=	{
 		.cra_name	=	"sha224",
 		.cra_driver_name =	"sha224-neon",
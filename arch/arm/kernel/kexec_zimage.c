@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Kexec zImage loader
+ *
+ * The zImage header layout is defined by arch/arm/boot/compressed/head.S
+ * and vmlinux.lds.S; placement follows what the kexec-tools zImage loader
+ * does for the same image.
+ */
+
+#define pr_fmt(fmt)	"kexec_file(zImage): " fmt
+
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/kexec.h>
+#include <linux/memblock.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <asm/byteorder.h>
+#include <asm/unaligned.h>
+#include <asm/memory.h>
+
+#define ZIMAGE_MAGIC_OFFSET	0x24
+#define ZIMAGE_MAGIC		0x016f2818
+#define ZIMAGE_TABLE_MAGIC	0x45454545
+#define ZIMAGE_TAG_KRNL_SIZE	0x5a534c4b
+
+struct zimage_header {
+	__le32	magic;
+	__le32	start;
+	__le32	end;
+	__le32	endian;
+	__le32	table_magic;
+	__le32	table;
+};
+
+/* "KLSZ" entry of the zImage data table */
+struct zimage_krnl_size {
+	__le32	size;		/* in words, including this header */
+	__le32	tag;
+	__le32	size_ptr;	/* offset of the decompressed size */
+	__le32	bss_size;
+	__le32	text_offset;
+	__le32	malloc_size;
+};
+
+static const struct zimage_header *zimage_header(const char *buf,
+						 unsigned long len)
+{
+	const struct zimage_header *h;
+
+	if (!buf || len < ZIMAGE_MAGIC_OFFSET + sizeof(*h))
+		return NULL;
+
+	h = (const struct zimage_header *)(buf + ZIMAGE_MAGIC_OFFSET);
+	if (le32_to_cpu(h->magic) != ZIMAGE_MAGIC)
+		return NULL;
+
+	return h;
+}
+
+static const struct zimage_krnl_size *
+zimage_krnl_size(const char *buf, unsigned long len,
+		 const struct zimage_header *h)
+{
+	const struct zimage_krnl_size *t;
+	unsigned long off;
+
+	if (le32_to_cpu(h->table_magic) != ZIMAGE_TABLE_MAGIC)
+		return NULL;
+
+	off = le32_to_cpu(h->table) - le32_to_cpu(h->start);
+	while (off + 2 * sizeof(__le32) <= len) {
+		u32 words;
+
+		t = (const struct zimage_krnl_size *)(buf + off);
+		words = le32_to_cpu(t->size);
+		/* Also keeps off + words * 4 from wrapping */
+		if (!words || words > (len - off) / 4)
+			break;
+
+		if (le32_to_cpu(t->tag) == ZIMAGE_TAG_KRNL_SIZE &&
+		    words * 4 >= sizeof(*t) && off + sizeof(*t) <= len)
+			return t;
+
+		off += words * 4;
+	}
+
+	return NULL;
+}
+
+static int zimage_probe(const char *kernel_buf, unsigned long kernel_len)
+{
+	return zimage_header(kernel_buf, kernel_len) ? 0 : -ENOEXEC;
+}
+
+static void *zimage_load(struct kimage *image,
+			 char *kernel, unsigned long kernel_len,
+			 char *initrd, unsigned long initrd_len,
+			 char *cmdline, unsigned long cmdline_len)
+{
+	const struct zimage_header *h = zimage_header(kernel, kernel_len);
+	const struct zimage_krnl_size *ks;
+	unsigned long text_offset = KEXEC_ARM_ZIMAGE_OFFSET;
+	unsigned long image_size, base;
+	struct kexec_segment *kernel_segment;
+	struct kexec_buf kbuf;
+	int ret;
+
+	if (image->type == KEXEC_TYPE_CRASH)
+		return ERR_PTR(-EOPNOTSUPP);
+
+	/*
+	 * Room the decompressor needs above the load address: the
+	 * decompressed kernel and its bss, plus a relocated copy of the
+	 * zImage and its heap if the two overlap. Without a size table
+	 * assume the usual 4:1 compression ratio.
+	 */
+	ks = zimage_krnl_size(kernel, kernel_len, h);
+	if (ks && le32_to_cpu(ks->size_ptr) + sizeof(__le32) <= kernel_len) {
+		image_size = get_unaligned_le32(kernel +
+						le32_to_cpu(ks->size_ptr));
+		image_size += le32_to_cpu(ks->bss_size);
+		image_size += kernel_len + le32_to_cpu(ks->malloc_size);
+		text_offset = le32_to_cpu(ks->text_offset);
+	} else {
+		image_size = kernel_len * 4;
+	}
+	image_size = PAGE_ALIGN(image_size + SZ_64K);
+
+	/*
+	 * With AUTO_ZRELADDR the decompressor finds the start of RAM by
+	 * rounding its own address down to 128MB, so the zImage goes to
+	 * the usual text offset above the start of RAM.
+	 */
+	base = round_down(memblock_start_of_DRAM(), SZ_128M);
+
+	kbuf.image = image;
+	kbuf.buffer = kernel;
+	kbuf.bufsz = kernel_len;
+	kbuf.mem = KEXEC_BUF_MEM_UNKNOWN;
+	kbuf.memsz = image_size;
+	kbuf.buf_align = PAGE_SIZE;
+	kbuf.buf_min = base + text_offset;
+	kbuf.buf_max = base + text_offset + image_size;
+	kbuf.top_down = false;
+
+	ret = kexec_add_buffer(&kbuf);
+	if (ret) {
+		pr_err("Could not reserve 0x%lx bytes at 0x%lx\n",
+		       image_size, base + text_offset);
+		return ERR_PTR(ret);
+	}
+
+	kernel_segment = &image->segment[image->nr_segments - 1];
+	ret = load_other_segments(image, kernel_segment->mem,
+				  kernel_segment->memsz, initrd, initrd_len,
+				  cmdline);
+	if (ret)
+		return ERR_PTR(ret);
+
+	image->start = kernel_segment->mem;
+
+	pr_debug("Loaded kernel at 0x%lx bufsz=0x%lx memsz=0x%lx\n",
+		 kernel_segment->mem, kbuf.bufsz, kernel_segment->memsz);
+
+	return NULL;
+}
+
+const struct kexec_file_ops kexec_zimage_ops = {
+	.probe = zimage_probe,
+	.load = zimage_load,
+};
@@ -50,7 +50,8 @@ int machine_kexec_prepare(struct kimage *image)
 
 	/*
 	 * No segment at default ATAGs address. try to locate
-	 * a dtb using magic.
+	 * a dtb using magic. kexec_file_load() placed the dtb itself
+	 * and its segments live in kernel memory.
 	 */
 	for (i = 0; i < image->nr_segments; i++) {
 		current_segment = &image->segment[i];
@@ -59,6 +60,11 @@ int machine_kexec_prepare(struct kimage *image)
 					       current_segment->memsz))
 			return -EINVAL;
 
+		if (image->file_mode) {
+			image->arch.kernel_r2 = image->arch.dtb_mem;
+			continue;
+		}
+
 		err = get_user(header, (__be32*)current_segment->buf);
 		if (err)
 			return err;
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kexec_file for arm
+ *
+ * Derived from the arm64 implementation.
+ *
+ * Besides the kernel, initrd and dtb this can pass a small opaque
+ * "handover" blob to the next kernel, e.g. network configuration that
+ * userspace wants to restore without waiting for DHCP after an update.
+ * The blob is written to /sys/kernel/kexec_handover before the image
+ * is loaded and ends up in the /chosen/linux,kexec-handover property
+ * of the new dtb, where the next kernel's userspace finds it under
+ * /sys/firmware/devicetree.
+ */
+
+#define pr_fmt(fmt) "kexec_file: " fmt
+
+#include <linux/kernel.h>
+#include <linux/kexec.h>
+#include <linux/kobject.h>
+#include <linux/libfdt.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/of_fdt.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/sysfs.h>
+#include <linux/types.h>
+#include <asm/memory.h>
+
+#define KEXEC_HANDOVER_PROP	"linux,kexec-handover"
+#define KEXEC_HANDOVER_MAX	SZ_16K
+
+static DEFINE_MUTEX(kexec_handover_mutex);
+static void *kexec_handover;
+static size_t kexec_handover_len;
+
+const struct kexec_file_ops * const kexec_file_loaders[] = {
+	&kexec_zimage_ops,
+	NULL
+};
+
+int arch_kimage_file_post_load_cleanup(struct kimage *image)
+{
+	kvfree(image->arch.dtb);
+	image->arch.dtb = NULL;
+
+	return kexec_image_post_load_cleanup_default(image);
+}
+
+static int setup_handover(void *dtb)
+{
+	int chosen, ret = 0;
+
+	chosen = fdt_path_offset(dtb, "/chosen");
+	if (chosen < 0)
+		return -EINVAL;
+
+	/* Don't pass on what the previous kernel handed to us */
+	fdt_delprop(dtb, chosen, KEXEC_HANDOVER_PROP);
+
+	mutex_lock(&kexec_handover_mutex);
+	if (kexec_handover_len)
+		ret = fdt_setprop(dtb, chosen, KEXEC_HANDOVER_PROP,
+				  kexec_handover, kexec_handover_len);
+	mutex_unlock(&kexec_handover_mutex);
+
+	return ret ? -EINVAL : 0;
+}
+
+/*
+ * Tries to add the initrd and DTB to the image. If it is not possible to find
+ * valid locations, this function will undo changes to the image and return non
+ * zero.
+ */
+int load_other_segments(struct kimage *image,
+			unsigned long kernel_load_addr,
+			unsigned long kernel_size,
+			char *initrd, unsigned long initrd_len,
+			char *cmdline)
+{
+	struct kexec_buf kbuf;
+	void *dtb = NULL;
+	unsigned long initrd_load_addr = 0, dtb_len, lowmem_end,
+		      orig_segments = image->nr_segments;
+	int ret = 0;
+
+	/* The new kernel reads both before it has set up highmem */
+	lowmem_end = __pa(high_memory - 1) + 1;
+
+	kbuf.image = image;
+	/* not allocate anything below the kernel */
+	kbuf.buf_min = kernel_load_addr + kernel_size;
+	kbuf.buf_max = lowmem_end;
+	kbuf.top_down = false;
+
+	/* load initrd */
+	if (initrd) {
+		kbuf.buffer = initrd;
+		kbuf.bufsz = initrd_len;
+		kbuf.mem = KEXEC_BUF_MEM_UNKNOWN;
+		kbuf.memsz = initrd_len;
+		kbuf.buf_align = PAGE_SIZE;
+
+		ret = kexec_add_buffer(&kbuf);
+		if (ret)
+			goto out_err;
+		initrd_load_addr = kbuf.mem;
+
+		pr_debug("Loaded initrd at 0x%lx bufsz=0x%lx memsz=0x%lx\n",
+				initrd_load_addr, kbuf.bufsz, kbuf.memsz);
+	}
+
+	/* load dtb */
+	dtb = of_kexec_alloc_and_setup_fdt(image, initrd_load_addr, initrd_len,
+					   cmdline, KEXEC_HANDOVER_MAX + SZ_1K);
+	if (!dtb) {
+		pr_err("Preparing for new dtb failed\n");
+		ret = -EINVAL;
+		goto out_err;
+	}
+
+	ret = setup_handover(dtb);
+	if (ret) {
+		pr_err("Adding handover data to dtb failed\n");
+		goto out_err;
+	}
+
+	/* trim it */
+	fdt_pack(dtb);
+	dtb_len = fdt_totalsize(dtb);
+	kbuf.buffer = dtb;
+	kbuf.bufsz = dtb_len;
+	kbuf.mem = KEXEC_BUF_MEM_UNKNOWN;
+	kbuf.memsz = dtb_len;
+	kbuf.buf_align = PAGE_SIZE;
+
+	ret = kexec_add_buffer(&kbuf);
+	if (ret)
+		goto out_err;
+	image->arch.dtb = dtb;
+	image->arch.dtb_mem = kbuf.mem;
+
+	pr_debug("Loaded dtb at 0x%lx bufsz=0x%lx memsz=0x%lx\n",
+			kbuf.mem, kbuf.bufsz, kbuf.memsz);
+
+	return 0;
+
+out_err:
+	image->nr_segments = orig_segments;
+	kvfree(dtb);
+	return ret;
+}
+
+static ssize_t kexec_handover_read(struct file *filp, struct kobject *kobj,
+				   struct bin_attribute *attr, char *buf,
+				   loff_t off, size_t count)
+{
+	ssize_t ret;
+
+	mutex_lock(&kexec_handover_mutex);
+	ret = memory_read_from_buffer(buf, count, &off, kexec_handover,
+				      kexec_handover_len);
+	mutex_unlock(&kexec_handover_mutex);
+
+	return ret;
+}
+
+/* A write at offset 0 replaces the blob, later offsets extend it */
+static ssize_t kexec_handover_write(struct file *filp, struct kobject *kobj,
+				    struct bin_attribute *attr, char *buf,
+				    loff_t off, size_t count)
+{
+	ssize_t ret = count;
+
+	if (off + count > KEXEC_HANDOVER_MAX)
+		return -EFBIG;
+
+	mutex_lock(&kexec_handover_mutex);
+	if (!kexec_handover) {
+		kexec_handover = kzalloc(KEXEC_HANDOVER_MAX, GFP_KERNEL);
+		if (!kexec_handover) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	if (off > kexec_handover_len) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	memcpy(kexec_handover + off, buf, count);
+	kexec_handover_len = off + count;
+out:
+	mutex_unlock(&kexec_handover_mutex);
+
+	return ret;
+}
+
+static BIN_ATTR(kexec_handover, 0600, kexec_handover_read,
+		kexec_handover_write, 0);
+
+static int __init kexec_handover_init(void)
+{
+	return sysfs_create_bin_file(kernel_kobj, &bin_attr_kexec_handover);
+}
+late_initcall(kexec_handover_init);
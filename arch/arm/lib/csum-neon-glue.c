@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * linux/arch/arm/lib/csum-neon-glue.c
+ *
+ * csum_partial() and csum_partial_copy_nocheck() entry points: large
+ * buffers are summed with NEON, the tail and everything that cannot use
+ * NEON (short buffers, interrupt context, no NEON unit) goes to the
+ * assembly implementation.
+ */
+
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#include <asm/checksum.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#include "csum-neon.h"
+
+/*
+ * The first kernel_neon_begin() after a context switch has to save the
+ * user's VFP state, which costs about as much as summing a few hundred
+ * bytes with the scalar code.
+ */
+#define CSUM_NEON_MIN_LEN	256
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(use_neon);
+
+static inline bool csum_neon_usable(int len)
+{
+	return len >= CSUM_NEON_MIN_LEN && static_branch_likely(&use_neon) &&
+	       may_use_simd();
+}
+
+static inline __wsum csum_from64(u64 sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	return (__force __wsum)sum;
+}
+
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	unsigned int bulk;
+	u64 s;
+
+	if (!csum_neon_usable(len))
+		return csum_partial_arm(buff, len, sum);
+
+	bulk = round_down(len, CSUM_NEON_BLOCK);
+
+	kernel_neon_begin();
+	s = csum_partial_neon(buff, bulk);
+	kernel_neon_end();
+
+	/* bulk is even, so the tail needs no byte rotation */
+	s += (__force u32)sum;
+	return csum_partial_arm(buff + bulk, len - bulk, csum_from64(s));
+}
+
+__wsum csum_partial_copy_nocheck(const void *src, void *dst, int len)
+{
+	unsigned int bulk;
+	u64 s;
+
+	if (!csum_neon_usable(len))
+		return csum_partial_copy_nocheck_arm(src, dst, len);
+
+	bulk = round_down(len, CSUM_NEON_BLOCK);
+
+	kernel_neon_begin();
+	s = csum_partial_copy_neon(src, dst, bulk);
+	kernel_neon_end();
+
+	s += (__force u32)csum_partial_copy_nocheck_arm(src + bulk, dst + bulk,
+							len - bulk);
+	return csum_from64(s);
+}
+
+static int __init csum_neon_init(void)
+{
+	if (cpu_has_neon())
+		static_branch_enable(&use_neon);
+	return 0;
+}
+arch_initcall(csum_neon_init);
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * linux/arch/arm/lib/csum-neon-inner.c
+ *
+ * NEON inner loops for the Internet checksum.  Every 32-bit word is
+ * accumulated into 64-bit lanes, so no carries are lost and the result
+ * only has to be folded once at the end.  Must only be called between
+ * kernel_neon_begin() and kernel_neon_end().
+ *
+ * Built with NEON flags and <arm_neon.h>, whose types clash with the
+ * kernel's, so no kernel header may be included here.  The prototypes
+ * the rest of the kernel uses are in csum-neon.h.
+ */
+
+#include <arm_neon.h>
+
+/* Must match csum-neon.h */
+#define CSUM_NEON_BLOCK		64
+
+uint64_t csum_partial_neon(const void *buff, unsigned int len);
+uint64_t csum_partial_copy_neon(const void *src, void *dst, unsigned int len);
+
+#define CSUM_NEON_ACC(acc, v)	vpadalq_u32(acc, vreinterpretq_u32_u8(v))
+
+uint64_t csum_partial_neon(const void *buff, unsigned int len)
+{
+	uint64x2_t acc0 = vdupq_n_u64(0), acc1 = vdupq_n_u64(0);
+	uint64x2_t acc2 = vdupq_n_u64(0), acc3 = vdupq_n_u64(0);
+	const uint8_t *p = buff;
+
+	for (; len >= CSUM_NEON_BLOCK; len -= CSUM_NEON_BLOCK) {
+		acc0 = CSUM_NEON_ACC(acc0, vld1q_u8(p));
+		acc1 = CSUM_NEON_ACC(acc1, vld1q_u8(p + 16));
+		acc2 = CSUM_NEON_ACC(acc2, vld1q_u8(p + 32));
+		acc3 = CSUM_NEON_ACC(acc3, vld1q_u8(p + 48));
+		p += CSUM_NEON_BLOCK;
+	}
+
+	acc0 = vaddq_u64(vaddq_u64(acc0, acc1), vaddq_u64(acc2, acc3));
+	return vgetq_lane_u64(acc0, 0) + vgetq_lane_u64(acc0, 1);
+}
+
+uint64_t csum_partial_copy_neon(const void *src, void *dst, unsigned int len)
+{
+	uint64x2_t acc0 = vdupq_n_u64(0), acc1 = vdupq_n_u64(0);
+	uint64x2_t acc2 = vdupq_n_u64(0), acc3 = vdupq_n_u64(0);
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+
+	for (; len >= CSUM_NEON_BLOCK; len -= CSUM_NEON_BLOCK) {
+		uint8x16_t v0 = vld1q_u8(s);
+		uint8x16_t v1 = vld1q_u8(s + 16);
+		uint8x16_t v2 = vld1q_u8(s + 32);
+		uint8x16_t v3 = vld1q_u8(s + 48);
+
+		vst1q_u8(d, v0);
+		vst1q_u8(d + 16, v1);
+		vst1q_u8(d + 32, v2);
+		vst1q_u8(d + 48, v3);
+		acc0 = CSUM_NEON_ACC(acc0, v0);
+		acc1 = CSUM_NEON_ACC(acc1, v1);
+		acc2 = CSUM_NEON_ACC(acc2, v2);
+		acc3 = CSUM_NEON_ACC(acc3, v3);
+		s += CSUM_NEON_BLOCK;
+		d += CSUM_NEON_BLOCK;
+	}
+
+	acc0 = vaddq_u64(vaddq_u64(acc0, acc1), vaddq_u64(acc2, acc3));
+	return vgetq_lane_u64(acc0, 0) + vgetq_lane_u64(acc0, 1);
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test cases and benchmark for the NEON csum_partial() and
+ * csum_partial_copy_nocheck() against the scalar assembly.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <kunit/test.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#include <asm/checksum.h>
+
+#include "csum-neon.h"
+
+#define CSUM_TEST_MAX_LEN	SZ_64K
+#define CSUM_TEST_ALIGN_MAX	8
+#define CSUM_BENCH_BYTES	SZ_16M
+
+struct csum_neon_test_ctx {
+	u8 *src;
+	u8 *dst;
+	u8 *ref;
+};
+
+static int csum_neon_test_init(struct kunit *test)
+{
+	struct csum_neon_test_ctx *ctx;
+	size_t size = CSUM_TEST_MAX_LEN + CSUM_TEST_ALIGN_MAX;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx);
+	ctx->src = kunit_kmalloc(test, size, GFP_KERNEL);
+	ctx->dst = kunit_kmalloc(test, size, GFP_KERNEL);
+	ctx->ref = kunit_kmalloc(test, size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->src);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->dst);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->ref);
+
+	get_random_bytes(ctx->src, size);
+	test->priv = ctx;
+	return 0;
+}
+
+static const int csum_test_lens[] = {
+	0, 1, 2, 3, 63, 64, 65, 255, 256, 257, 511, 1023, 1499, 1500,
+	1514, 4095, 4096, 9000, 16383, 32768, 65535, 65536,
+};
+
+static void csum_partial_matches_scalar(struct kunit *test)
+{
+	struct csum_neon_test_ctx *ctx = test->priv;
+	int i, off;
+
+	for (i = 0; i < ARRAY_SIZE(csum_test_lens); i++) {
+		for (off = 0; off < CSUM_TEST_ALIGN_MAX; off++) {
+			const u8 *buf = ctx->src + off;
+			int len = csum_test_lens[i];
+			__wsum seed = (__force __wsum)get_random_u32();
+
+			KUNIT_EXPECT_EQ_MSG(test,
+				csum_fold(csum_partial(buf, len, seed)),
+				csum_fold(csum_partial_arm(buf, len, seed)),
+				"len %d offset %d", len, off);
+		}
+	}
+}
+
+static void csum_partial_copy_matches_scalar(struct kunit *test)
+{
+	struct csum_neon_test_ctx *ctx = test->priv;
+	int i, off;
+
+	for (i = 0; i < ARRAY_SIZE(csum_test_lens); i++) {
+		for (off = 0; off < CSUM_TEST_ALIGN_MAX; off++) {
+			int len = csum_test_lens[i];
+			__sum16 neon, arm;
+
+			memset(ctx->dst, 0, len + off);
+			memset(ctx->ref, 0, len + off);
+			neon = csum_fold(csum_partial_copy_nocheck(ctx->src + off,
+								   ctx->dst, len));
+			arm = csum_fold(csum_partial_copy_nocheck_arm(ctx->src + off,
+								      ctx->ref, len));
+
+			KUNIT_EXPECT_EQ_MSG(test, neon, arm,
+					    "len %d offset %d", len, off);
+			KUNIT_EXPECT_EQ_MSG(test, memcmp(ctx->dst, ctx->ref, len), 0,
+					    "len %d offset %d", len, off);
+		}
+	}
+}
+
+static u64 csum_bench_mbps(u64 bytes, ktime_t start)
+{
+	u64 ns = max_t(u64, ktime_to_ns(ktime_sub(ktime_get(), start)), 1);
+
+	return div64_u64(bytes * 1000, ns);
+}
+
+static void csum_partial_bench(struct kunit *test)
+{
+	struct csum_neon_test_ctx *ctx = test->priv;
+	int len;
+
+	for (len = 64; len <= CSUM_TEST_MAX_LEN; len <<= 1) {
+		unsigned int n, iters = CSUM_BENCH_BYTES / len;
+		u64 bytes = (u64)iters * len;
+		u64 neon, arm, copy_neon, copy_arm;
+		__wsum sum = 0;
+		ktime_t start;
+
+		start = ktime_get();
+		for (n = 0; n < iters; n++)
+			sum = csum_partial_arm(ctx->src, len, sum);
+		arm = csum_bench_mbps(bytes, start);
+
+		start = ktime_get();
+		for (n = 0; n < iters; n++)
+			sum = csum_partial(ctx->src, len, sum);
+		neon = csum_bench_mbps(bytes, start);
+
+		start = ktime_get();
+		for (n = 0; n < iters; n++)
+			sum = csum_partial_copy_nocheck_arm(ctx->src, ctx->dst, len);
+		copy_arm = csum_bench_mbps(bytes, start);
+
+		start = ktime_get();
+		for (n = 0; n < iters; n++)
+			sum = csum_partial_copy_nocheck(ctx->src, ctx->dst, len);
+		copy_neon = csum_bench_mbps(bytes, start);
+
+		kunit_info(test,
+			   "len %5d: csum %4llu/%4llu MB/s copy %4llu/%4llu MB/s (scalar/dispatch)\n",
+			   len, arm, neon, copy_arm, copy_neon);
+		cond_resched();
+	}
+}
+
+static struct kunit_case csum_neon_test_cases[] = {
+	KUNIT_CASE(csum_partial_matches_scalar),
+	KUNIT_CASE(csum_partial_copy_matches_scalar),
+	KUNIT_CASE(csum_partial_bench),
+	{}
+};
+
+static struct kunit_suite csum_neon_test_suite = {
+	.name = "csum_neon",
+	.init = csum_neon_test_init,
+	.test_cases = csum_neon_test_cases,
+};
+
+kunit_test_suite(csum_neon_test_suite);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __ARM_LIB_CSUM_NEON_H
+#define __ARM_LIB_CSUM_NEON_H
+
+#include <linux/linkage.h>
+#include <linux/types.h>
+
+/* Process whole 64 byte blocks only; the caller handles the tail. */
+#define CSUM_NEON_BLOCK		64
+
+/* In csum-neon-inner.c, which cannot include this header */
+u64 csum_partial_neon(const void *buff, unsigned int len);
+u64 csum_partial_copy_neon(const void *src, void *dst, unsigned int len);
+
+asmlinkage __wsum csum_partial_arm(const void *buff, int len, __wsum sum);
+asmlinkage __wsum csum_partial_copy_nocheck_arm(const void *src, void *dst,
+						int len);
+
+#endif
@@ -523,6 +523,38 @@ static ssize_t hctx_run_write(void *data, const char __user *buf, size_t count,
 	return count;
 }
 
+static const char *const hctx_lat_op_name[BLK_MQ_LAT_OPS] = {
+	[BLK_MQ_LAT_READ]	= "read",
+	[BLK_MQ_LAT_WRITE]	= "write",
+	[BLK_MQ_LAT_FLUSH]	= "flush",
+	[BLK_MQ_LAT_DISCARD]	= "discard",
+};
+
+/* One line per operation: the name, then "<lower bound ns>:<count>" pairs. */
+static int hctx_lat_hist_show(void *data, struct seq_file *m)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	int op, i;
+
+	for (op = 0; op < BLK_MQ_LAT_OPS; op++) {
+		seq_puts(m, hctx_lat_op_name[op]);
+		for (i = 0; i < BLK_MQ_LAT_BUCKETS; i++)
+			seq_printf(m, " %llu:%lu", i ? 1024ULL << i : 0,
+				   READ_ONCE(hctx->lat_hist[op][i]));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+static ssize_t hctx_lat_hist_write(void *data, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+
+	memset(hctx->lat_hist, 0, sizeof(hctx->lat_hist));
+	return count;
+}
+
 static int hctx_active_show(void *data, struct seq_file *m)
 {
 	struct blk_mq_hw_ctx *hctx = data;
@@ -652,6 +684,7 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_hctx_attrs[] = {
 	{"sched_tags", 0400, hctx_sched_tags_show},
 	{"sched_tags_bitmap", 0400, hctx_sched_tags_bitmap_show},
 	{"run", 0600, hctx_run_show, hctx_run_write},
+	{"lat_hist", 0600, hctx_lat_hist_show, hctx_lat_hist_write},
 	{"active", 0400, hctx_active_show},
 	{"dispatch_busy", 0400, hctx_dispatch_busy_show},
 	{"type", 0400, hctx_type_show},
@@ -127,6 +127,35 @@ static ssize_t blk_mq_hw_sysfs_cpus_show(struct blk_mq_hw_ctx *hctx, char *page)
 	return pos + ret;
 }
 
+static ssize_t blk_mq_hw_sysfs_lat_hist_show(struct blk_mq_hw_ctx *hctx,
+					     char *page, int op)
+{
+	int i, pos = 0;
+
+	for (i = 0; i < BLK_MQ_LAT_BUCKETS; i++)
+		pos += sysfs_emit_at(page, pos, "%s%lu", i ? " " : "",
+				     READ_ONCE(hctx->lat_hist[op][i]));
+	pos += sysfs_emit_at(page, pos, "\n");
+	return pos;
+}
+
+#define BLK_MQ_HW_LAT_HIST_SHOW(name, op)				\
+static ssize_t blk_mq_hw_sysfs_##name##_lat_show(struct blk_mq_hw_ctx *hctx, \
+						char *page)		\
+{									\
+	return blk_mq_hw_sysfs_lat_hist_show(hctx, page, op);		\
+}									\
+static struct blk_mq_hw_ctx_sysfs_entry blk_mq_hw_sysfs_##name##_lat = { \
+	.attr = {.name = #name "_lat_hist", .mode = 0444 },		\
+	.show = blk_mq_hw_sysfs_##name##_lat_show,			\
+}
+
+BLK_MQ_HW_LAT_HIST_SHOW(read, BLK_MQ_LAT_READ);
+BLK_MQ_HW_LAT_HIST_SHOW(write, BLK_MQ_LAT_WRITE);
+BLK_MQ_HW_LAT_HIST_SHOW(flush, BLK_MQ_LAT_FLUSH);
+BLK_MQ_HW_LAT_HIST_SHOW(discard, BLK_MQ_LAT_DISCARD);
+#undef BLK_MQ_HW_LAT_HIST_SHOW
+
 static struct blk_mq_hw_ctx_sysfs_entry blk_mq_hw_sysfs_nr_tags = {
 	.attr = {.name = "nr_tags", .mode = 0444 },
 	.show = blk_mq_hw_sysfs_nr_tags_show,
@@ -144,6 +173,10 @@ static struct attribute *default_hw_ctx_attrs[] = {
 	&blk_mq_hw_sysfs_nr_tags.attr,
 	&blk_mq_hw_sysfs_nr_reserved_tags.attr,
 	&blk_mq_hw_sysfs_cpus.attr,
+	&blk_mq_hw_sysfs_read_lat.attr,
+	&blk_mq_hw_sysfs_write_lat.attr,
+	&blk_mq_hw_sysfs_flush_lat.attr,
+	&blk_mq_hw_sysfs_discard_lat.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(default_hw_ctx);
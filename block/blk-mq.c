@@ -1018,8 +1018,46 @@ static inline void blk_account_io_start(struct request *req)
 		__blk_account_io_start(req);
 }
 
+/*
+ * The latency histogram uses the allocation timestamp that is already taken
+ * for I/O accounting, so keeping it always on costs no extra clock read. Lost
+ * updates from concurrent completions are tolerated, as for hctx->run.
+ */
+static inline void blk_mq_account_latency(struct request *rq, u64 now)
+{
+	int op, bucket;
+
+	if (!rq->start_time_ns || now < rq->start_time_ns)
+		return;
+
+	switch (req_op(rq)) {
+	case REQ_OP_READ:
+		op = BLK_MQ_LAT_READ;
+		break;
+	case REQ_OP_WRITE:
+		op = BLK_MQ_LAT_WRITE;
+		break;
+	case REQ_OP_FLUSH:
+		op = BLK_MQ_LAT_FLUSH;
+		break;
+	case REQ_OP_DISCARD:
+		op = BLK_MQ_LAT_DISCARD;
+		break;
+	default:
+		return;
+	}
+
+	bucket = now - rq->start_time_ns < 2048 ? 0 :
+		 ilog2(now - rq->start_time_ns) - 10;
+	if (bucket >= BLK_MQ_LAT_BUCKETS)
+		bucket = BLK_MQ_LAT_BUCKETS - 1;
+	rq->mq_hctx->lat_hist[op][bucket]++;
+}
+
 static inline void __blk_mq_end_request_acct(struct request *rq, u64 now)
 {
+	blk_mq_account_latency(rq, now);
+
 	if (rq->rq_flags & RQF_STATS) {
 		blk_mq_poll_stats_start(rq->q);
 		blk_stat_add(rq, now);
@@ -25,6 +25,7 @@
 #include "blk-mq-debugfs.h"
 #include "blk-mq-tag.h"
 #include "blk-mq-sched.h"
+#include "blk-stat.h"
 
 /*
  * See Documentation/block/deadline-iosched.rst
@@ -39,6 +40,12 @@ static const int prio_aging_expire = 10 * HZ;
 static const int writes_starved = 2;    /* max times reads can starve a write */
 static const int fifo_batch = 16;       /* # of sequential requests treated as one
 				     by the above parameters. For throughput. */
+/*
+ * Flash mode: writes are held back until this much is queued (one erase
+ * block of a typical SD card) or until the oldest has waited write_hold.
+ */
+static const int write_batch_kb = 4096;
+static const int write_hold = HZ / 20;
 
 enum dd_data_dir {
 	DD_READ		= READ,
@@ -56,6 +63,13 @@ enum dd_prio {
 
 enum { DD_PRIO_COUNT = 3 };
 
+/*
+ * Completion latency histogram buckets. Bucket 0 counts requests that took
+ * less than 64 us, bucket i (i > 0) those that took [32 << i, 64 << i) us
+ * and the last bucket everything slower.
+ */
+enum { DD_LAT_BUCKETS = 16 };
+
 /*
  * I/O statistics per I/O priority. It is fine if these counters overflow.
  * What matters is that these counters are at least as wide as
@@ -102,6 +116,13 @@ struct deadline_data {
 	int front_merges;
 	u32 async_depth;
 	int prio_aging_expire;
+	int flash_mode;
+	int write_batch_kb;
+	int write_hold;
+
+	struct request_queue *q;
+	struct blk_stat_callback *cb;
+	u64 lat_hist[DD_DIR_COUNT][DD_LAT_BUCKETS];
 
 	spinlock_t lock;
 	spinlock_t zone_lock;
@@ -416,6 +437,37 @@ static bool started_after(struct deadline_data *dd, struct request *rq,
 	return time_after(start_time, latest_start);
 }
 
+/*
+ * In flash mode, let writes sit in the scheduler and merge until
+ * write_batch_kb of them are queued or the oldest one has waited for
+ * write_hold, so that the card sees a few large writes instead of many
+ * small ones. Returning no request makes blk-mq run the queue again
+ * shortly, which is what ends the hold.
+ */
+static bool dd_hold_writes(struct deadline_data *dd,
+			   struct dd_per_prio *per_prio)
+{
+	struct request *rq;
+	unsigned long start_time;
+	u64 bytes = 0;
+
+	if (!dd->flash_mode || !dd->write_batch_kb)
+		return false;
+
+	rq = rq_entry_fifo(per_prio->fifo_list[DD_WRITE].next);
+	start_time = (unsigned long)rq->fifo_time - dd->fifo_expire[DD_WRITE];
+	if (time_after_eq(jiffies, start_time + dd->write_hold))
+		return false;
+
+	list_for_each_entry(rq, &per_prio->fifo_list[DD_WRITE], queuelist) {
+		bytes += blk_rq_bytes(rq);
+		if (bytes >= (u64)dd->write_batch_kb << 10)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * deadline_dispatch_requests selects the best request according to
  * read/write expire, fifo_batch, etc and with a start time <= @latest_start.
@@ -444,7 +496,9 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	 * batches are currently reads XOR writes
 	 */
 	rq = deadline_next_request(dd, per_prio, dd->last_dir);
-	if (rq && dd->batching < dd->fifo_batch)
+	if (rq && dd->batching < dd->fifo_batch &&
+	    !(dd->flash_mode && dd->last_dir == DD_WRITE &&
+	      !list_empty(&per_prio->fifo_list[DD_READ])))
 		/* we have a next request are still entitled to batch */
 		goto dispatch_request;
 
@@ -456,9 +510,15 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	if (!list_empty(&per_prio->fifo_list[DD_READ])) {
 		BUG_ON(RB_EMPTY_ROOT(&per_prio->sort_list[DD_READ]));
 
-		if (deadline_fifo_request(dd, per_prio, DD_WRITE) &&
-		    (dd->starved++ >= dd->writes_starved))
+		/* in flash mode, reads only yield to expired writes */
+		if (dd->flash_mode) {
+			if (deadline_fifo_request(dd, per_prio, DD_WRITE) &&
+			    deadline_check_fifo(per_prio, DD_WRITE))
+				goto dispatch_writes;
+		} else if (deadline_fifo_request(dd, per_prio, DD_WRITE) &&
+			   (dd->starved++ >= dd->writes_starved)) {
 			goto dispatch_writes;
+		}
 
 		data_dir = DD_READ;
 
@@ -470,6 +530,8 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	 */
 
 	if (!list_empty(&per_prio->fifo_list[DD_WRITE])) {
+		if (dd_hold_writes(dd, per_prio))
+			return NULL;
 dispatch_writes:
 		BUG_ON(RB_EMPTY_ROOT(&per_prio->sort_list[DD_WRITE]));
 
@@ -635,11 +697,55 @@ static int dd_init_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx)
 	return 0;
 }
 
+static int dd_lat_bucket(const struct request *rq)
+{
+	u64 lat_us;
+	int dir;
+
+	switch (req_op(rq)) {
+	case REQ_OP_READ:
+		dir = DD_READ;
+		break;
+	case REQ_OP_WRITE:
+		dir = DD_WRITE;
+		break;
+	default:
+		return -1;
+	}
+
+	if (!rq->io_start_time_ns)
+		return -1;
+
+	lat_us = div_u64(ktime_get_ns() - rq->io_start_time_ns, NSEC_PER_USEC);
+	if (lat_us < 64)
+		return dir * DD_LAT_BUCKETS;
+
+	return dir * DD_LAT_BUCKETS +
+		min_t(int, ilog2(lat_us) - 5, DD_LAT_BUCKETS - 1);
+}
+
+static void dd_lat_timer_fn(struct blk_stat_callback *cb)
+{
+	struct deadline_data *dd = cb->data;
+	int dir, i;
+
+	for (dir = 0; dir < DD_DIR_COUNT; dir++)
+		for (i = 0; i < DD_LAT_BUCKETS; i++)
+			dd->lat_hist[dir][i] +=
+				cb->stat[dir * DD_LAT_BUCKETS + i].nr_samples;
+
+	if (READ_ONCE(dd->flash_mode))
+		blk_stat_activate_msecs(cb, 100);
+}
+
 static void dd_exit_sched(struct elevator_queue *e)
 {
 	struct deadline_data *dd = e->elevator_data;
 	enum dd_prio prio;
 
+	blk_stat_remove_callback(dd->q, dd->cb);
+	blk_stat_free_callback(dd->cb);
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		struct dd_per_prio *per_prio = &dd->per_prio[prio];
 		const struct io_stats_per_prio *stats = &per_prio->stats;
@@ -681,6 +787,11 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 
 	eq->elevator_data = dd;
 
+	dd->cb = blk_stat_alloc_callback(dd_lat_timer_fn, dd_lat_bucket,
+					 DD_DIR_COUNT * DD_LAT_BUCKETS, dd);
+	if (!dd->cb)
+		goto free_dd;
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		struct dd_per_prio *per_prio = &dd->per_prio[prio];
 
@@ -697,15 +808,22 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	dd->last_dir = DD_WRITE;
 	dd->fifo_batch = fifo_batch;
 	dd->prio_aging_expire = prio_aging_expire;
+	dd->write_batch_kb = write_batch_kb;
+	dd->write_hold = write_hold;
+	dd->q = q;
 	spin_lock_init(&dd->lock);
 	spin_lock_init(&dd->zone_lock);
 
 	/* We dispatch from request queue wide instead of hw queue */
 	blk_queue_flag_set(QUEUE_FLAG_SQ_SCHED, q);
 
+	blk_stat_add_callback(q, dd->cb);
+
 	q->elevator = eq;
 	return 0;
 
+free_dd:
+	kfree(dd);
 put_eq:
 	kobject_put(&eq->kobj);
 	return ret;
@@ -942,6 +1060,9 @@ SHOW_INT(deadline_writes_starved_show, dd->writes_starved);
 SHOW_INT(deadline_front_merges_show, dd->front_merges);
 SHOW_INT(deadline_async_depth_show, dd->async_depth);
 SHOW_INT(deadline_fifo_batch_show, dd->fifo_batch);
+SHOW_INT(deadline_flash_mode_show, dd->flash_mode);
+SHOW_INT(deadline_write_batch_kb_show, dd->write_batch_kb);
+SHOW_JIFFIES(deadline_write_hold_show, dd->write_hold);
 #undef SHOW_INT
 #undef SHOW_JIFFIES
 
@@ -972,10 +1093,29 @@ STORE_INT(deadline_writes_starved_store, &dd->writes_starved, INT_MIN, INT_MAX);
 STORE_INT(deadline_front_merges_store, &dd->front_merges, 0, 1);
 STORE_INT(deadline_async_depth_store, &dd->async_depth, 1, INT_MAX);
 STORE_INT(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX);
+STORE_INT(deadline_write_batch_kb_store, &dd->write_batch_kb, 0, INT_MAX);
+STORE_JIFFIES(deadline_write_hold_store, &dd->write_hold, 0, INT_MAX);
 #undef STORE_FUNCTION
 #undef STORE_INT
 #undef STORE_JIFFIES
 
+static ssize_t deadline_flash_mode_store(struct elevator_queue *e,
+					 const char *page, size_t count)
+{
+	struct deadline_data *dd = e->elevator_data;
+	int ret, val;
+
+	ret = kstrtoint(page, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	WRITE_ONCE(dd->flash_mode, !!val);
+	/* the latency histogram is collected while flash mode is on */
+	if (dd->flash_mode && !blk_stat_is_active(dd->cb))
+		blk_stat_activate_msecs(dd->cb, 100);
+	return count;
+}
+
 #define DD_ATTR(name) \
 	__ATTR(name, 0644, deadline_##name##_show, deadline_##name##_store)
 
@@ -987,6 +1127,9 @@ static struct elv_fs_entry deadline_attrs[] = {
 	DD_ATTR(async_depth),
 	DD_ATTR(fifo_batch),
 	DD_ATTR(prio_aging_expire),
+	DD_ATTR(flash_mode),
+	DD_ATTR(write_batch_kb),
+	DD_ATTR(write_hold),
 	__ATTR_NULL
 };
 
@@ -1069,6 +1212,32 @@ static int deadline_starved_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static void dd_lat_hist_show(struct deadline_data *dd, enum dd_data_dir dir,
+			     struct seq_file *m)
+{
+	int i;
+
+	seq_printf(m, "%u:%llu\n", 0, dd->lat_hist[dir][0]);
+	for (i = 1; i < DD_LAT_BUCKETS; i++)
+		seq_printf(m, "%u:%llu\n", 32U << i, dd->lat_hist[dir][i]);
+}
+
+static int deadline_read_lat_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+
+	dd_lat_hist_show(q->elevator->elevator_data, DD_READ, m);
+	return 0;
+}
+
+static int deadline_write_lat_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+
+	dd_lat_hist_show(q->elevator->elevator_data, DD_WRITE, m);
+	return 0;
+}
+
 static int dd_async_depth_show(void *data, struct seq_file *m)
 {
 	struct request_queue *q = data;
@@ -1193,6 +1362,8 @@ static const struct blk_mq_debugfs_attr deadline_queue_debugfs_attrs[] = {
 	{"dispatch2", 0400, .seq_ops = &deadline_dispatch2_seq_ops},
 	{"owned_by_driver", 0400, dd_owned_by_driver_show},
 	{"queued", 0400, dd_queued_show},
+	{"read_lat_us", 0400, deadline_read_lat_show},
+	{"write_lat_us", 0400, deadline_write_lat_show},
 	{},
 };
 #undef DEADLINE_QUEUE_DDIR_ATTRS
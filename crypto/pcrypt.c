@@ -328,6 +328,13 @@ static int pcrypt_init_padata(struct padata_instance **pinst, const char *name)
 	if (!*pinst)
 		return ret;
 
+	/*
+	 * The child transform runs from the parallel worker; keep BHs on
+	 * there so SIMD implementations need not defer to cryptd where
+	 * softirq context excludes kernel-mode SIMD (e.g. 32-bit ARM).
+	 */
+	(*pinst)->flags |= PADATA_PARALLEL_BH;
+
 	ret = pcrypt_sysfs_add(*pinst, name);
 	if (ret)
 		padata_free(*pinst);
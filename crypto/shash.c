@@ -194,6 +194,34 @@ int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_finup);
 
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	SHASH_DESC_ON_STACK(tmp, tfm);
+	unsigned int i;
+	int err = 0;
+
+	if (WARN_ON_ONCE(num_msgs > shash->mb_max_msgs))
+		return -EINVAL;
+
+	if (num_msgs > 1)
+		return shash->finup_mb(desc, data, len, outs, num_msgs);
+
+	tmp->tfm = tfm;
+	for (i = 0; i < num_msgs && !err; i++) {
+		memcpy(shash_desc_ctx(tmp), shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(tmp, data[i], len, outs[i]);
+	}
+	shash_desc_zero(tmp);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
 static int shash_digest_unaligned(struct shash_desc *desc, const u8 *data,
 				  unsigned int len, u8 *out)
 {
@@ -539,6 +567,11 @@ static int shash_prepare_alg(struct shash_alg *alg)
 	if ((alg->export && !alg->import) || (alg->import && !alg->export))
 		return -EINVAL;
 
+	if (alg->mb_max_msgs > 1 && !alg->finup_mb)
+		return -EINVAL;
+	if (!alg->mb_max_msgs)
+		alg->mb_max_msgs = 1;
+
 	base->cra_type = &crypto_shash_type;
 	base->cra_flags &= ~CRYPTO_ALG_TYPE_MASK;
 	base->cra_flags |= CRYPTO_ALG_TYPE_SHASH;
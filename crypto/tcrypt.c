@@ -33,6 +33,8 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include "internal.h"
 #include "tcrypt.h"
 
 /*
@@ -64,6 +66,7 @@ static u32 mask;
 static int mode;
 static u32 num_mb = 8;
 static unsigned int klen;
+static bool tune;
 static char *tvmem[TVMEMSIZE];
 
 static const int block_sizes[] = { 16, 64, 128, 256, 1024, 1420, 4096, 0 };
@@ -1434,6 +1437,336 @@ static void test_cipher_speed(const char *algo, int enc, unsigned int secs,
 				   false);
 }
 
+/*
+ * Dispatch benchmark: time every registered implementation of one
+ * algorithm over the block_sizes size classes, with a single request in
+ * flight and with num_mb of them, so that CPU code and an offload engine
+ * on the same board can be compared directly.
+ */
+#define DISPATCH_MAX_IMPLS	8
+#define DISPATCH_NR_SIZES	(ARRAY_SIZE(block_sizes) - 1)
+
+struct dispatch_impl {
+	char driver[CRYPTO_MAX_ALG_NAME];
+	u32 priority;
+	bool ok;
+	u64 ns[2][DISPATCH_NR_SIZES];	/* per op, at depth 1 and num_mb */
+};
+
+struct dispatch_req {
+	struct scatterlist sg[XBUFSIZE];
+	struct crypto_wait wait;
+	char *xbuf[XBUFSIZE];
+	union {
+		struct skcipher_request *sk;
+		struct ahash_request *ah;
+	} req;
+	u8 iv[MAX_IVLEN];
+	u8 result[MAX_DIGEST_SIZE];
+};
+
+static int dispatch_get_impls(const char *name, u32 type, u32 mask,
+			      struct dispatch_impl *impls)
+{
+	struct crypto_alg *q;
+	int n = 0;
+
+	down_read(&crypto_alg_sem);
+	list_for_each_entry(q, &crypto_alg_list, cra_list) {
+		if (crypto_is_larval(q) || crypto_is_dead(q) ||
+		    !(q->cra_flags & CRYPTO_ALG_TESTED))
+			continue;
+		if (((q->cra_flags ^ type) & mask) || strcmp(q->cra_name, name))
+			continue;
+		if (n == DISPATCH_MAX_IMPLS)
+			break;
+		strscpy(impls[n].driver, q->cra_driver_name,
+			sizeof(impls[n].driver));
+		impls[n].priority = q->cra_priority;
+		n++;
+	}
+	up_read(&crypto_alg_sem);
+
+	return n;
+}
+
+/* Same as a priority update through crypto_user. */
+static void dispatch_set_priority(const char *driver, u32 priority)
+{
+	struct crypto_alg *q;
+	LIST_HEAD(list);
+
+	down_write(&crypto_alg_sem);
+	list_for_each_entry(q, &crypto_alg_list, cra_list) {
+		if (crypto_is_larval(q) || crypto_is_dead(q) ||
+		    strcmp(q->cra_driver_name, driver))
+			continue;
+		crypto_remove_spawns(q, &list, NULL);
+		q->cra_priority = priority;
+		break;
+	}
+	up_write(&crypto_alg_sem);
+
+	crypto_remove_final(&list);
+}
+
+static int dispatch_do_op(struct dispatch_req *data, bool hash, u32 depth,
+			  int *rc)
+{
+	int i, err = 0;
+
+	for (i = 0; i < depth; i++)
+		rc[i] = hash ? crypto_ahash_digest(data[i].req.ah) :
+			       crypto_skcipher_encrypt(data[i].req.sk);
+
+	for (i = 0; i < depth; i++) {
+		rc[i] = crypto_wait_req(rc[i], &data[i].wait);
+		if (rc[i])
+			err = rc[i];
+	}
+
+	return err;
+}
+
+static int dispatch_time(struct dispatch_req *data, bool hash, u32 depth,
+			 int *rc, u64 *ns)
+{
+	u64 start;
+	int i, ret;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = dispatch_do_op(data, hash, depth, rc);
+		if (ret)
+			return ret;
+	}
+
+	start = ktime_get_ns();
+	for (i = 0; i < 8; i++) {
+		ret = dispatch_do_op(data, hash, depth, rc);
+		if (ret)
+			return ret;
+	}
+	*ns = div_u64(ktime_get_ns() - start, 8 * depth);
+
+	return 0;
+}
+
+static int dispatch_bench_impl(struct dispatch_impl *impl, bool hash,
+			       struct dispatch_req *data, int *rc)
+{
+	struct crypto_skcipher *sktfm = NULL;
+	struct crypto_ahash *ahtfm = NULL;
+	u32 depths[2] = { 1, num_mb };
+	unsigned int i, j, d, keylen;
+	u8 *key = tvmem[0];
+	int ret;
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		key[i] = i + 1;
+
+	if (hash) {
+		ahtfm = crypto_alloc_ahash(impl->driver, 0, 0);
+		if (IS_ERR(ahtfm))
+			return PTR_ERR(ahtfm);
+		keylen = klen ?: 16;
+		ret = 0;
+		if (crypto_ahash_get_flags(ahtfm) & CRYPTO_TFM_NEED_KEY)
+			ret = crypto_ahash_setkey(ahtfm, key, keylen);
+	} else {
+		sktfm = crypto_alloc_skcipher(impl->driver, 0, 0);
+		if (IS_ERR(sktfm))
+			return PTR_ERR(sktfm);
+		keylen = klen ?: crypto_skcipher_min_keysize(sktfm);
+		ret = crypto_skcipher_setkey(sktfm, key, keylen);
+	}
+	if (ret) {
+		pr_err("%s: setkey() failed: %d\n", impl->driver, ret);
+		goto out_free_tfm;
+	}
+
+	for (i = 0; i < num_mb; i++) {
+		if (hash)
+			data[i].req.ah = ahash_request_alloc(ahtfm, GFP_KERNEL);
+		else
+			data[i].req.sk = skcipher_request_alloc(sktfm,
+								GFP_KERNEL);
+		if (hash ? !data[i].req.ah : !data[i].req.sk) {
+			ret = -ENOMEM;
+			goto out_free_req;
+		}
+		crypto_init_wait(&data[i].wait);
+		if (hash)
+			ahash_request_set_callback(data[i].req.ah,
+						   CRYPTO_TFM_REQ_MAY_BACKLOG,
+						   crypto_req_done,
+						   &data[i].wait);
+		else
+			skcipher_request_set_callback(data[i].req.sk,
+					CRYPTO_TFM_REQ_MAY_BACKLOG,
+					crypto_req_done, &data[i].wait);
+	}
+
+	for (j = 0; j < DISPATCH_NR_SIZES; j++) {
+		unsigned int bs = block_sizes[j];
+
+		if (!hash)
+			bs = round_up(bs, crypto_skcipher_blocksize(sktfm));
+
+		for (i = 0; i < num_mb; i++) {
+			struct dispatch_req *cur = &data[i];
+			unsigned int pages = DIV_ROUND_UP(bs, PAGE_SIZE);
+			unsigned int k = bs, p = 0;
+
+			sg_init_table(cur->sg, pages);
+			while (k > PAGE_SIZE) {
+				sg_set_buf(cur->sg + p, cur->xbuf[p],
+					   PAGE_SIZE);
+				memset(cur->xbuf[p], 0xff, PAGE_SIZE);
+				p++;
+				k -= PAGE_SIZE;
+			}
+			sg_set_buf(cur->sg + p, cur->xbuf[p], k);
+			memset(cur->xbuf[p], 0xff, k);
+			memset(cur->iv, 0xff, sizeof(cur->iv));
+
+			if (hash)
+				ahash_request_set_crypt(cur->req.ah, cur->sg,
+							cur->result, bs);
+			else
+				skcipher_request_set_crypt(cur->req.sk,
+							   cur->sg, cur->sg,
+							   bs, cur->iv);
+		}
+
+		for (d = 0; d < ARRAY_SIZE(depths); d++) {
+			ret = dispatch_time(data, hash, depths[d], rc,
+					    &impl->ns[d][j]);
+			if (ret) {
+				pr_err("%s: %u bytes, depth %u failed: %d\n",
+				       impl->driver, bs, depths[d], ret);
+				goto out_free_req;
+			}
+			pr_info("%-24s %5u bytes depth %2u: %8llu ns/op\n",
+				impl->driver, bs, depths[d], impl->ns[d][j]);
+		}
+		cond_resched();
+	}
+	impl->ok = true;
+
+out_free_req:
+	for (i = 0; i < num_mb; i++) {
+		if (hash)
+			ahash_request_free(data[i].req.ah);
+		else
+			skcipher_request_free(data[i].req.sk);
+		data[i].req.sk = NULL;
+	}
+out_free_tfm:
+	if (hash)
+		crypto_free_ahash(ahtfm);
+	else
+		crypto_free_skcipher(sktfm);
+	return ret;
+}
+
+static void test_dispatch_speed(const char *name)
+{
+	struct dispatch_impl *impls, *best;
+	unsigned int wins[DISPATCH_MAX_IMPLS] = {};
+	struct dispatch_req *data;
+	unsigned int i, j, d;
+	u32 top = 0;
+	bool hash = false;
+	int n, *rc;
+
+	if (!num_mb) {
+		pr_err("num_mb must be at least 1\n");
+		return;
+	}
+
+	impls = kcalloc(DISPATCH_MAX_IMPLS, sizeof(*impls), GFP_KERNEL);
+	data = kcalloc(num_mb, sizeof(*data), GFP_KERNEL);
+	rc = kcalloc(num_mb, sizeof(*rc), GFP_KERNEL);
+	if (!impls || !data || !rc)
+		goto out_free;
+
+	n = dispatch_get_impls(name, CRYPTO_ALG_TYPE_SKCIPHER,
+			       CRYPTO_ALG_TYPE_MASK, impls);
+	if (!n) {
+		hash = true;
+		n = dispatch_get_impls(name, CRYPTO_ALG_TYPE_HASH,
+				       CRYPTO_ALG_TYPE_HASH_MASK, impls);
+	}
+	if (!n) {
+		pr_err("no implementation of %s is registered\n", name);
+		goto out_free;
+	}
+
+	for (i = 0; i < num_mb; i++)
+		if (testmgr_alloc_buf(data[i].xbuf)) {
+			while (i--)
+				testmgr_free_buf(data[i].xbuf);
+			goto out_free;
+		}
+
+	pr_info("\ntesting dispatch of %s over %d implementations\n",
+		name, n);
+
+	for (i = 0; i < n; i++)
+		dispatch_bench_impl(&impls[i], hash, data, rc);
+
+	pr_info("fastest implementation of %s:\n", name);
+	for (j = 0; j < DISPATCH_NR_SIZES; j++) {
+		struct dispatch_impl *win[2] = {};
+
+		for (d = 0; d < 2; d++)
+			for (i = 0; i < n; i++)
+				if (impls[i].ok &&
+				    (!win[d] ||
+				     impls[i].ns[d][j] < win[d]->ns[d][j]))
+					win[d] = &impls[i];
+		if (!win[1])
+			break;
+		wins[win[1] - impls]++;
+		pr_info("%5d bytes: depth 1 %s, depth %u %s\n",
+			block_sizes[j], win[0]->driver, num_mb,
+			win[1]->driver);
+	}
+
+	best = NULL;
+	for (i = 0; i < n; i++) {
+		top = max(top, impls[i].priority);
+		if (impls[i].ok && (!best || wins[i] > wins[best - impls]))
+			best = &impls[i];
+	}
+
+	if (!tune || !best || best->priority == top) {
+		if (best)
+			pr_info("%s wins %u of %zu size classes\n",
+				best->driver, wins[best - impls],
+				DISPATCH_NR_SIZES);
+		goto out_free_buf;
+	}
+
+	/*
+	 * cra_priority cannot depend on the request size, so the driver that
+	 * wins the most size classes at depth num_mb is put on top.
+	 */
+	pr_info("%s wins %u of %zu size classes, priority %u -> %u\n",
+		best->driver, wins[best - impls], DISPATCH_NR_SIZES,
+		best->priority, top + 1);
+	dispatch_set_priority(best->driver, top + 1);
+
+out_free_buf:
+	for (i = 0; i < num_mb; i++)
+		testmgr_free_buf(data[i].xbuf);
+out_free:
+	kfree(rc);
+	kfree(data);
+	kfree(impls);
+}
+
 static inline int tcrypt_test(const char *alg)
 {
 	int ret;
@@ -2857,6 +3190,18 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				       speed_template_16_32, num_mb);
 		break;
 
+	case 700:
+		if (alg) {
+			test_dispatch_speed(alg);
+			break;
+		}
+		test_dispatch_speed("ecb(aes)");
+		test_dispatch_speed("cbc(aes)");
+		test_dispatch_speed("cbc(des3_ede)");
+		test_dispatch_speed("md5");
+		test_dispatch_speed("sha1");
+		break;
+
 	}
 
 	return ret;
@@ -2919,6 +3264,8 @@ module_param(num_mb, uint, 0000);
 MODULE_PARM_DESC(num_mb, "Number of concurrent requests to be used in mb speed tests (defaults to 8)");
 module_param(klen, uint, 0);
 MODULE_PARM_DESC(klen, "Key length (defaults to 0)");
+module_param(tune, bool, 0);
+MODULE_PARM_DESC(tune, "Give the fastest implementation found by mode 700 the highest priority");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
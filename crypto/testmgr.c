@@ -1886,6 +1886,91 @@ static int alloc_shash(const char *driver, u32 type, u32 mask,
 	return 0;
 }
 
+#define TEST_MB_MAX_MSGS	8
+#define TEST_MB_MAX_LEN		4200
+
+/*
+ * Check crypto_shash_finup_mb() against one crypto_shash_finup() per
+ * message, starting from a state that already holds some data, for
+ * message lengths around the block and padding boundaries.
+ */
+static int test_shash_finup_mb(struct shash_desc *desc, u8 *hashstate)
+{
+	static const unsigned int prefix_lens[] = { 0, 1, 32, 63, 64, 100 };
+	static const unsigned int msg_lens[] = {
+		0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 4096, 4200,
+	};
+	struct crypto_shash *tfm = desc->tfm;
+	const unsigned int digestsize = crypto_shash_digestsize(tfm);
+	const char *driver = crypto_shash_driver_name(tfm);
+	unsigned int max = min_t(unsigned int, crypto_shash_mb_max_msgs(tfm),
+				 TEST_MB_MAX_MSGS);
+	u8 *outs[TEST_MB_MAX_MSGS], *data[TEST_MB_MAX_MSGS];
+	u8 expected[HASH_MAX_DIGESTSIZE];
+	unsigned int p, l, n, i;
+	u8 *buf;
+	int err = 0;
+
+	if (max < 2 || crypto_shash_get_flags(tfm) & CRYPTO_TFM_NEED_KEY)
+		return 0;
+
+	buf = kmalloc(max * (TEST_MB_MAX_LEN + HASH_MAX_DIGESTSIZE),
+		      GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	get_random_bytes(buf, max * TEST_MB_MAX_LEN);
+	for (i = 0; i < max; i++) {
+		data[i] = buf + i * TEST_MB_MAX_LEN;
+		outs[i] = buf + max * TEST_MB_MAX_LEN + i * HASH_MAX_DIGESTSIZE;
+	}
+
+	for (p = 0; p < ARRAY_SIZE(prefix_lens); p++) {
+		err = crypto_shash_init(desc) ?:
+		      crypto_shash_update(desc, data[max - 1],
+					  prefix_lens[p]) ?:
+		      crypto_shash_export(desc, hashstate);
+		if (err)
+			goto out;
+
+		for (l = 0; l < ARRAY_SIZE(msg_lens); l++) {
+			for (n = 1; n <= max; n++) {
+				err = crypto_shash_import(desc, hashstate) ?:
+				      crypto_shash_finup_mb(desc,
+						(const u8 * const *)data,
+						msg_lens[l], outs, n);
+				if (err)
+					goto out;
+
+				for (i = 0; i < n; i++) {
+					err = crypto_shash_import(desc,
+								  hashstate) ?:
+					      crypto_shash_finup(desc, data[i],
+								 msg_lens[l],
+								 expected);
+					if (err)
+						goto out;
+					if (memcmp(outs[i], expected,
+						   digestsize)) {
+						pr_err("alg: shash: %s finup_mb() differs from finup() for message %u of %u, prefix %u, length %u\n",
+						       driver, i, n,
+						       prefix_lens[p],
+						       msg_lens[l]);
+						err = -EINVAL;
+						goto out;
+					}
+				}
+			}
+			cond_resched();
+		}
+	}
+out:
+	if (err && err != -EINVAL)
+		pr_err("alg: shash: %s finup_mb() test failed with err %d\n",
+		       driver, err);
+	kfree_sensitive(buf);
+	return err;
+}
+
 static int __alg_test_hash(const struct hash_testvec *vecs,
 			   unsigned int num_vecs, const char *driver,
 			   u32 type, u32 mask,
@@ -1960,6 +2045,11 @@ static int __alg_test_hash(const struct hash_testvec *vecs,
 			goto out;
 		cond_resched();
 	}
+	if (desc) {
+		err = test_shash_finup_mb(desc, hashstate);
+		if (err)
+			goto out;
+	}
 	err = test_hash_vs_generic_impl(generic_driver, maxkeysize, req,
 					desc, tsgl, hashstate);
 out:
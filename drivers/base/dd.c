@@ -256,6 +256,72 @@ static int deferred_devs_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(deferred_devs);
 
+/*
+ * The first probes after boot are timed and listed in debugfs as
+ * devices_probe_times, so that regressions in how long it takes to
+ * bring up e.g. the network show up without booting with initcall_debug.
+ */
+#define PROBE_TIMES_MAX		256
+
+struct probe_time {
+	char	dev[32];
+	char	drv[24];
+	s64	start_us;
+	s64	len_us;
+	int	ret;
+	bool	async;
+	bool	done;
+};
+
+static struct probe_time probe_times[PROBE_TIMES_MAX];
+static atomic_t probe_times_count = ATOMIC_INIT(0);
+
+static bool probe_times_full(void)
+{
+	return atomic_read(&probe_times_count) >= PROBE_TIMES_MAX;
+}
+
+static void probe_time_record(struct device *dev, struct device_driver *drv,
+			      ktime_t calltime, ktime_t rettime, int ret)
+{
+	struct probe_time *t;
+	int i;
+
+	i = atomic_inc_return(&probe_times_count) - 1;
+	if (i >= PROBE_TIMES_MAX) {
+		atomic_set(&probe_times_count, PROBE_TIMES_MAX);
+		return;
+	}
+
+	t = &probe_times[i];
+	strscpy(t->dev, dev_name(dev), sizeof(t->dev));
+	strscpy(t->drv, drv->name, sizeof(t->drv));
+	t->start_us = ktime_to_us(calltime);
+	t->len_us = ktime_us_delta(rettime, calltime);
+	t->ret = ret;
+	t->async = current_is_async();
+	smp_store_release(&t->done, true);
+}
+
+static int probe_times_show(struct seq_file *s, void *data)
+{
+	int i, n = min(atomic_read(&probe_times_count), PROBE_TIMES_MAX);
+
+	seq_puts(s, "# start_us len_us mode ret driver device\n");
+	for (i = 0; i < n; i++) {
+		struct probe_time *t = &probe_times[i];
+
+		if (!smp_load_acquire(&t->done))
+			continue;
+		seq_printf(s, "%lld %lld %s %d %s %s\n",
+			   t->start_us, t->len_us, t->async ? "async" : "sync",
+			   t->ret, t->drv, t->dev);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(probe_times);
+
 #ifdef CONFIG_MODULES
 int driver_deferred_probe_timeout = 10;
 #else
@@ -345,6 +411,8 @@ static int deferred_probe_initcall(void)
 {
 	debugfs_create_file("devices_deferred", 0444, NULL, NULL,
 			    &deferred_devs_fops);
+	debugfs_create_file("devices_probe_times", 0444, NULL, NULL,
+			    &probe_times_fops);
 
 	driver_deferred_probe_enable = true;
 	driver_deferred_probe_trigger();
@@ -373,6 +441,7 @@ late_initcall(deferred_probe_initcall);
 static void __exit deferred_probe_exit(void)
 {
 	debugfs_lookup_and_remove("devices_deferred", NULL);
+	debugfs_lookup_and_remove("devices_probe_times", NULL);
 }
 __exitcall(deferred_probe_exit);
 
@@ -710,7 +779,8 @@ done:
 }
 
 /*
- * For initcall_debug, show the driver probe time.
+ * For initcall_debug, show the driver probe time. The first probes after
+ * boot are also recorded for devices_probe_times.
  */
 static int really_probe_debug(struct device *dev, struct device_driver *drv)
 {
@@ -720,6 +790,12 @@ static int really_probe_debug(struct device *dev, struct device_driver *drv)
 	calltime = ktime_get();
 	ret = really_probe(dev, drv);
 	rettime = ktime_get();
+
+	if (ret != -EPROBE_DEFER)
+		probe_time_record(dev, drv, calltime, rettime, ret);
+
+	if (!initcall_debug)
+		return ret;
 	/*
 	 * Don't change this to pr_debug() because that requires
 	 * CONFIG_DYNAMIC_DEBUG and we want a simple 'initcall_debug' on the
@@ -779,7 +855,7 @@ static int __driver_probe_device(struct device_driver *drv, struct device *dev)
 		pm_runtime_get_sync(dev->parent);
 
 	pm_runtime_barrier(dev);
-	if (initcall_debug)
+	if (initcall_debug || !probe_times_full())
 		ret = really_probe_debug(dev, drv);
 	else
 		ret = really_probe(dev, drv);
@@ -7,6 +7,7 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/debugfs.h>
 #include <linux/errno.h>
 #include <linux/gpio/consumer.h>
 #include <linux/kernel.h>
@@ -27,8 +28,8 @@
 #define HCI_3WIRE_ACK_PKT	0
 #define HCI_3WIRE_LINK_PKT	15
 
-/* Sliding window size */
-#define H5_TX_WIN_MAX		4
+/* Sliding window size, the largest the 3-bit config field can carry */
+#define H5_TX_WIN_MAX		7
 
 #define H5_ACK_TIMEOUT	msecs_to_jiffies(250)
 #define H5_SYNC_TIMEOUT	msecs_to_jiffies(100)
@@ -58,6 +59,7 @@ enum {
 	H5_TX_ACK_REQ,		/* Pending ack to send */
 	H5_WAKEUP_DISABLE,	/* Device cannot wake host */
 	H5_HW_FLOW_CONTROL,	/* Use HW flow control */
+	H5_DEBUGFS_CREATED,	/* debugfs entries are registered */
 };
 
 struct h5 {
@@ -82,6 +84,12 @@ struct h5 {
 	u8			tx_seq;		/* Next seq number to send */
 	u8			tx_ack;		/* Next ack number to send */
 	u8			tx_win;		/* Sliding window size */
+	ktime_t			tx_time[8];	/* Last send time per seq */
+
+	u64			retransmits;	/* Reliable pkts resent */
+	u64			acked;		/* Reliable pkts acked */
+	u64			ack_latency_us;	/* Sum of ack latencies */
+	u64			ack_latency_max_us;
 
 	enum {
 		H5_UNINITIALIZED,
@@ -179,6 +187,7 @@ static void h5_timed_event(struct timer_list *t)
 
 	while ((skb = __skb_dequeue_tail(&h5->unack)) != NULL) {
 		h5->tx_seq = (h5->tx_seq - 1) & 0x07;
+		h5->retransmits++;
 		skb_queue_head(&h5->rel, skb);
 	}
 
@@ -271,10 +280,43 @@ static int h5_close(struct hci_uart *hu)
 	return 0;
 }
 
+static int h5_ack_latency_show(struct seq_file *file, void *offset)
+{
+	struct h5 *h5 = file->private;
+	u64 acked = h5->acked;
+
+	seq_printf(file, "acked:\t\t%llu\n", acked);
+	seq_printf(file, "avg_us:\t\t%llu\n",
+		   acked ? div64_u64(h5->ack_latency_us, acked) : 0);
+	seq_printf(file, "max_us:\t\t%llu\n", h5->ack_latency_max_us);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(h5_ack_latency);
+
+static void h5_debugfs_init(struct h5 *h5, struct hci_dev *hdev)
+{
+	struct dentry *dir;
+
+	if (!hdev->debugfs)
+		return;
+
+	if (test_and_set_bit(H5_DEBUGFS_CREATED, &h5->flags))
+		return;
+
+	dir = debugfs_create_dir("h5", hdev->debugfs);
+	debugfs_create_u8("tx_win", 0444, dir, &h5->tx_win);
+	debugfs_create_u64("retransmits", 0444, dir, &h5->retransmits);
+	debugfs_create_file("ack_latency", 0444, dir, h5,
+			    &h5_ack_latency_fops);
+}
+
 static int h5_setup(struct hci_uart *hu)
 {
 	struct h5 *h5 = hu->priv;
 
+	h5_debugfs_init(h5, hu->hdev);
+
 	if (h5->vnd && h5->vnd->setup)
 		return h5->vnd->setup(h5);
 
@@ -286,6 +328,7 @@ static void h5_pkt_cull(struct h5 *h5)
 	struct sk_buff *skb, *tmp;
 	unsigned long flags;
 	int i, to_remove;
+	ktime_t now;
 	u8 seq;
 
 	spin_lock_irqsave(&h5->unack.lock, flags);
@@ -307,11 +350,24 @@ static void h5_pkt_cull(struct h5 *h5)
 	if (seq != h5->rx_ack)
 		BT_ERR("Controller acked invalid packet");
 
+	/* The oldest unacked packet went out with this sequence number */
+	seq = (h5->tx_seq - skb_queue_len(&h5->unack)) & 0x07;
+	now = ktime_get();
+
 	i = 0;
 	skb_queue_walk_safe(&h5->unack, skb, tmp) {
+		u64 us;
+
 		if (i++ >= to_remove)
 			break;
 
+		us = ktime_us_delta(now, h5->tx_time[seq]);
+		h5->ack_latency_us += us;
+		if (us > h5->ack_latency_max_us)
+			h5->ack_latency_max_us = us;
+		h5->acked++;
+		seq = (seq + 1) & 0x07;
+
 		__skb_unlink(skb, &h5->unack);
 		dev_kfree_skb_irq(skb);
 	}
@@ -464,6 +520,12 @@ static int h5_rx_3wire_hdr(struct hci_uart *hu, unsigned char c)
 		bt_dev_err(hu->hdev, "Out-of-order packet arrived (%u != %u)",
 			   H5_HDR_SEQ(hdr), h5->tx_ack);
 		h5_reset_rx(h5);
+
+		/* Tell the controller right away which packet we expect
+		 * instead of letting it wait for its retransmission timer.
+		 */
+		set_bit(H5_TX_ACK_REQ, &h5->flags);
+		hci_uart_tx_wakeup(hu);
 		return 0;
 	}
 
@@ -543,6 +605,31 @@ static void h5_unslip_one_byte(struct h5 *h5, unsigned char c)
 	BT_DBG("unslipped 0x%02hhx, rx_pending %zu", *byte, h5->rx_pending);
 }
 
+/*
+ * Copy the run of bytes at the start of data that needs no unslipping
+ * straight into the receive buffer. Returns the number of bytes taken,
+ * zero if the first byte has to go through h5_unslip_one_byte().
+ */
+static size_t h5_unslip_run(struct h5 *h5, const u8 *data, size_t count)
+{
+	size_t len = 0;
+
+	if (test_bit(H5_RX_ESC, &h5->flags))
+		return 0;
+
+	count = min(count, h5->rx_pending);
+	while (len < count && data[len] != SLIP_DELIMITER &&
+	       data[len] != SLIP_ESC)
+		len++;
+
+	if (len) {
+		skb_put_data(h5->rx_skb, data, len);
+		h5->rx_pending -= len;
+	}
+
+	return len;
+}
+
 static void h5_reset_rx(struct h5 *h5)
 {
 	if (h5->rx_skb) {
@@ -573,6 +660,13 @@ static int h5_recv(struct hci_uart *hu, const void *data, int count)
 				continue;
 			}
 
+			processed = h5_unslip_run(h5, ptr, count);
+			if (processed) {
+				ptr += processed;
+				count -= processed;
+				continue;
+			}
+
 			h5_unslip_one_byte(h5, *ptr);
 
 			ptr++; count--;
@@ -711,6 +805,7 @@ static struct sk_buff *h5_prepare_pkt(struct hci_uart *hu, u8 pkt_type,
 	if (pkt_type == HCI_ACLDATA_PKT || pkt_type == HCI_COMMAND_PKT) {
 		hdr[0] |= 1 << 7;
 		hdr[0] |= h5->tx_seq;
+		h5->tx_time[h5->tx_seq] = ktime_get();
 		h5->tx_seq = (h5->tx_seq + 1) % 8;
 	}
 
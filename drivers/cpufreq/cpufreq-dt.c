@@ -15,15 +15,27 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/netdevice.h>
 #include <linux/of.h>
 #include <linux/pm_opp.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
 #include <linux/slab.h>
 #include <linux/thermal.h>
+#include <linux/workqueue.h>
 
 #include "cpufreq-dt.h"
 
+/*
+ * On a receive burst the network core tells us long before schedutil
+ * sees the softirq time as utilisation. Pin the policy at its highest
+ * frequency for net_boost_ms after the last burst, then let the
+ * governor bring it back down.
+ */
+static unsigned int net_boost_ms;
+module_param(net_boost_ms, uint, 0644);
+MODULE_PARM_DESC(net_boost_ms, "Run at max frequency for this long after a network receive burst (0 = off)");
+
 struct private_data {
 	struct list_head node;
 
@@ -32,6 +44,15 @@ struct private_data {
 	struct cpufreq_frequency_table *freq_table;
 	bool have_static_opps;
 	int opp_token;
+
+	/* network receive boost */
+	struct freq_qos_request boost_req;
+	struct work_struct boost_work;
+	struct delayed_work boost_decay;
+	unsigned long boost_until;
+	unsigned long boost_active;
+	unsigned int boost_freq;
+	bool boost_ready;
 };
 
 static LIST_HEAD(priv_list);
@@ -54,6 +75,57 @@ static struct private_data *cpufreq_dt_find_data(int cpu)
 	return NULL;
 }
 
+static void dt_cpufreq_boost_work(struct work_struct *work)
+{
+	struct private_data *priv = container_of(work, struct private_data,
+						 boost_work);
+
+	freq_qos_update_request(&priv->boost_req, priv->boost_freq);
+	schedule_delayed_work(&priv->boost_decay,
+			      msecs_to_jiffies(READ_ONCE(net_boost_ms)));
+}
+
+static void dt_cpufreq_boost_decay(struct work_struct *work)
+{
+	struct private_data *priv = container_of(to_delayed_work(work),
+						 struct private_data,
+						 boost_decay);
+	long left = READ_ONCE(priv->boost_until) - jiffies;
+
+	/* Still busy, keep the boost for another round */
+	if (left > 0) {
+		schedule_delayed_work(&priv->boost_decay, left);
+		return;
+	}
+
+	freq_qos_update_request(&priv->boost_req, FREQ_QOS_MIN_DEFAULT_VALUE);
+	clear_bit(0, &priv->boost_active);
+}
+
+static int dt_cpufreq_net_notify(struct notifier_block *nb,
+				 unsigned long cpu, void *data)
+{
+	unsigned int hold = READ_ONCE(net_boost_ms);
+	struct private_data *priv;
+
+	if (!hold)
+		return NOTIFY_DONE;
+
+	priv = cpufreq_dt_find_data(cpu);
+	if (!priv || !READ_ONCE(priv->boost_ready))
+		return NOTIFY_DONE;
+
+	WRITE_ONCE(priv->boost_until, jiffies + msecs_to_jiffies(hold));
+	if (!test_and_set_bit(0, &priv->boost_active))
+		queue_work(system_highpri_wq, &priv->boost_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block dt_cpufreq_net_nb = {
+	.notifier_call = dt_cpufreq_net_notify,
+};
+
 static int set_target(struct cpufreq_policy *policy, unsigned int index)
 {
 	struct private_data *priv = policy->driver_data;
@@ -143,6 +215,13 @@ static int cpufreq_init(struct cpufreq_policy *policy)
 		cpufreq_dt_attr[1] = &cpufreq_freq_attr_scaling_boost_freqs;
 	}
 
+	priv->boost_freq = policy->cpuinfo.max_freq;
+	if (freq_qos_add_request(&policy->constraints, &priv->boost_req,
+				 FREQ_QOS_MIN, FREQ_QOS_MIN_DEFAULT_VALUE) < 0)
+		dev_warn(cpu_dev, "network boost not available\n");
+	else
+		WRITE_ONCE(priv->boost_ready, true);
+
 	return 0;
 
 out_clk_put:
@@ -168,6 +247,18 @@ static int cpufreq_offline(struct cpufreq_policy *policy)
 
 static int cpufreq_exit(struct cpufreq_policy *policy)
 {
+	struct private_data *priv = policy->driver_data;
+
+	if (priv->boost_ready) {
+		WRITE_ONCE(priv->boost_ready, false);
+		/* the notifier runs under RCU, let it finish */
+		synchronize_rcu();
+		cancel_work_sync(&priv->boost_work);
+		cancel_delayed_work_sync(&priv->boost_decay);
+		clear_bit(0, &priv->boost_active);
+		freq_qos_remove_request(&priv->boost_req);
+	}
+
 	clk_put(policy->clk);
 	return 0;
 }
@@ -213,6 +304,8 @@ static int dt_cpufreq_early_init(struct device *dev, int cpu)
 
 	cpumask_set_cpu(cpu, priv->cpus);
 	priv->cpu_dev = cpu_dev;
+	INIT_WORK(&priv->boost_work, dt_cpufreq_boost_work);
+	INIT_DELAYED_WORK(&priv->boost_decay, dt_cpufreq_boost_decay);
 
 	/*
 	 * OPP layer will be taking care of regulators now, but it needs to know
@@ -343,6 +436,9 @@ static int dt_cpufreq_probe(struct platform_device *pdev)
 		goto err;
 	}
 
+	if (IS_ENABLED(CONFIG_NET))
+		register_netdev_rx_pressure_notifier(&dt_cpufreq_net_nb);
+
 	return 0;
 err:
 	dt_cpufreq_release();
@@ -351,6 +447,8 @@ err:
 
 static int dt_cpufreq_remove(struct platform_device *pdev)
 {
+	if (IS_ENABLED(CONFIG_NET))
+		unregister_netdev_rx_pressure_notifier(&dt_cpufreq_net_nb);
 	cpufreq_unregister_driver(&dt_cpufreq_driver);
 	dt_cpufreq_release();
 	return 0;
@@ -430,6 +430,10 @@ static int sun4i_ss_probe(struct platform_device *pdev)
 	platform_set_drvdata(pdev, ss);
 
 	spin_lock_init(&ss->slock);
+#ifdef CONFIG_CRYPTO_DEV_SUN4I_SS_PRNG
+	spin_lock_init(&ss->prng_lock);
+	INIT_WORK(&ss->prng_work, sun4i_ss_prng_work);
+#endif
 
 	err = sun4i_ss_pm_init(ss);
 	if (err)
@@ -505,6 +509,9 @@ error_alg:
 			break;
 		}
 	}
+#ifdef CONFIG_CRYPTO_DEV_SUN4I_SS_PRNG
+	cancel_work_sync(&ss->prng_work);
+#endif
 error_pm:
 	sun4i_ss_pm_exit(ss);
 	return err;
@@ -528,6 +535,9 @@ static int sun4i_ss_remove(struct platform_device *pdev)
 			break;
 		}
 	}
+#ifdef CONFIG_CRYPTO_DEV_SUN4I_SS_PRNG
+	cancel_work_sync(&ss->prng_work);
+#endif
 
 	sun4i_ss_pm_exit(ss);
 	return 0;
@@ -1,43 +1,25 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 #include "sun4i-ss.h"
 
-int sun4i_ss_prng_seed(struct crypto_rng *tfm, const u8 *seed,
-		       unsigned int slen)
-{
-	struct sun4i_ss_alg_template *algt;
-	struct rng_alg *alg = crypto_rng_alg(tfm);
-
-	algt = container_of(alg, struct sun4i_ss_alg_template, alg.rng);
-	memcpy(algt->ss->seed, seed, slen);
-
-	return 0;
-}
+/*
+ * Small requests are served from a buffer that prng_work refills in
+ * SS_PRNG_BUF_LEN batches, so a storm of them does not serialize on the
+ * engine lock. Larger requests still go to the engine directly.
+ */
 
-int sun4i_ss_prng_generate(struct crypto_rng *tfm, const u8 *src,
-			   unsigned int slen, u8 *dst, unsigned int dlen)
+/* Run the engine for @todo bytes, @todo must be a multiple of 4 */
+static int sun4i_ss_prng_run(struct sun4i_ss_ctx *ss, u32 *data,
+			     unsigned int todo)
 {
-	struct sun4i_ss_alg_template *algt;
-	struct rng_alg *alg = crypto_rng_alg(tfm);
-	int i, err;
-	u32 v;
-	u32 *data = (u32 *)dst;
 	const u32 mode = SS_OP_PRNG | SS_PRNG_CONTINUE | SS_ENABLED;
 	size_t len;
-	struct sun4i_ss_ctx *ss;
-	unsigned int todo = (dlen / 4) * 4;
-
-	algt = container_of(alg, struct sun4i_ss_alg_template, alg.rng);
-	ss = algt->ss;
+	int i, err;
+	u32 v;
 
 	err = pm_runtime_resume_and_get(ss->dev);
 	if (err < 0)
 		return err;
 
-	if (IS_ENABLED(CONFIG_CRYPTO_DEV_SUN4I_SS_DEBUG)) {
-		algt->stat_req++;
-		algt->stat_bytes += todo;
-	}
-
 	spin_lock_bh(&ss->slock);
 
 	writel(mode, ss->base + SS_CTL);
@@ -67,3 +49,88 @@ int sun4i_ss_prng_generate(struct crypto_rng *tfm, const u8 *src,
 
 	return 0;
 }
+
+void sun4i_ss_prng_work(struct work_struct *work)
+{
+	struct sun4i_ss_ctx *ss = container_of(work, struct sun4i_ss_ctx,
+					       prng_work);
+	unsigned int n;
+
+	if (sun4i_ss_prng_run(ss, ss->prng_refill, SS_PRNG_BUF_LEN))
+		return;
+
+	spin_lock_bh(&ss->prng_lock);
+	n = SS_PRNG_BUF_LEN - ss->prng_avail;
+	memcpy((u8 *)ss->prng_buf + ss->prng_avail, ss->prng_refill, n);
+	ss->prng_avail = SS_PRNG_BUF_LEN;
+	spin_unlock_bh(&ss->prng_lock);
+
+	memzero_explicit(ss->prng_refill, SS_PRNG_BUF_LEN);
+}
+
+/* Take @dlen bytes from the buffer, false if there are not enough */
+static bool sun4i_ss_prng_take(struct sun4i_ss_ctx *ss, u8 *dst,
+			       unsigned int dlen)
+{
+	bool refill, ok = false;
+	u8 *p;
+
+	spin_lock_bh(&ss->prng_lock);
+	if (dlen <= ss->prng_avail) {
+		ss->prng_avail -= dlen;
+		p = (u8 *)ss->prng_buf + ss->prng_avail;
+		memcpy(dst, p, dlen);
+		memzero_explicit(p, dlen);
+		ok = true;
+	}
+	refill = ss->prng_avail < SS_PRNG_BUF_LEN / 2;
+	spin_unlock_bh(&ss->prng_lock);
+
+	if (refill)
+		schedule_work(&ss->prng_work);
+
+	return ok;
+}
+
+int sun4i_ss_prng_seed(struct crypto_rng *tfm, const u8 *seed,
+		       unsigned int slen)
+{
+	struct sun4i_ss_alg_template *algt;
+	struct rng_alg *alg = crypto_rng_alg(tfm);
+	struct sun4i_ss_ctx *ss;
+
+	algt = container_of(alg, struct sun4i_ss_alg_template, alg.rng);
+	ss = algt->ss;
+
+	/* Output buffered under the old seed must not be handed out */
+	cancel_work_sync(&ss->prng_work);
+	spin_lock_bh(&ss->prng_lock);
+	memcpy(ss->seed, seed, slen);
+	memzero_explicit(ss->prng_buf, ss->prng_avail);
+	ss->prng_avail = 0;
+	spin_unlock_bh(&ss->prng_lock);
+
+	return 0;
+}
+
+int sun4i_ss_prng_generate(struct crypto_rng *tfm, const u8 *src,
+			   unsigned int slen, u8 *dst, unsigned int dlen)
+{
+	struct sun4i_ss_alg_template *algt;
+	struct rng_alg *alg = crypto_rng_alg(tfm);
+	struct sun4i_ss_ctx *ss;
+	unsigned int todo = (dlen / 4) * 4;
+
+	algt = container_of(alg, struct sun4i_ss_alg_template, alg.rng);
+	ss = algt->ss;
+
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_SUN4I_SS_DEBUG)) {
+		algt->stat_req++;
+		algt->stat_bytes += todo;
+	}
+
+	if (todo <= SS_PRNG_SMALL && sun4i_ss_prng_take(ss, dst, todo))
+		return 0;
+
+	return sun4i_ss_prng_run(ss, (u32 *)dst, todo);
+}
@@ -23,6 +23,7 @@
 #include <linux/interrupt.h>
 #include <linux/delay.h>
 #include <linux/pm_runtime.h>
+#include <linux/workqueue.h>
 #include <crypto/md5.h>
 #include <crypto/skcipher.h>
 #include <crypto/sha1.h>
@@ -131,6 +132,10 @@
 #define SS_SEED_LEN 192
 #define SS_DATA_LEN 160
 
+/* Requests up to SS_PRNG_SMALL bytes are served from a prefilled buffer */
+#define SS_PRNG_BUF_LEN 4096
+#define SS_PRNG_SMALL 256
+
 /*
  * struct ss_variant - Describe SS hardware variant
  * @sha1_in_be:		The SHA1 digest is given by SS in BE, and so need to be inverted.
@@ -153,6 +158,11 @@ struct sun4i_ss_ctx {
 	spinlock_t slock; /* control the use of the device */
 #ifdef CONFIG_CRYPTO_DEV_SUN4I_SS_PRNG
 	u32 seed[SS_SEED_LEN / BITS_PER_LONG];
+	spinlock_t prng_lock; /* protects prng_buf and prng_avail */
+	unsigned int prng_avail;
+	u32 prng_buf[SS_PRNG_BUF_LEN / 4];
+	u32 prng_refill[SS_PRNG_BUF_LEN / 4]; /* only used by prng_work */
+	struct work_struct prng_work;
 #endif
 	struct dentry *dbgfs_dir;
 	struct dentry *dbgfs_stats;
@@ -234,3 +244,4 @@ int sun4i_ss_des3_setkey(struct crypto_skcipher *tfm, const u8 *key,
 int sun4i_ss_prng_generate(struct crypto_rng *tfm, const u8 *src,
 			   unsigned int slen, u8 *dst, unsigned int dlen);
 int sun4i_ss_prng_seed(struct crypto_rng *tfm, const u8 *seed, unsigned int slen);
+void sun4i_ss_prng_work(struct work_struct *work);
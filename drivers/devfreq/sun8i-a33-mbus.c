@@ -11,7 +11,9 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/pm_qos.h>
 #include <linux/property.h>
+#include <linux/soc/sunxi/sunxi_mbus.h>
 
 #define MBUS_CR				0x0000
 #define MBUS_CR_GET_DRAM_TYPE(x)	(((x) >> 16) & 0x7)
@@ -69,6 +71,12 @@
 #define DRAM_DXnGCR0_DXODT_DISABLED	(0x2 << 4)
 #define DRAM_DXnGCR0_DXEN		(0x1 << 0)
 
+/*
+ * With several masters interleaving, the DRAM rarely sustains more than
+ * about half of its nominal bandwidth. Size bandwidth requests for that.
+ */
+#define MBUS_BW_USABLE_PERCENT		50
+
 struct sun8i_a33_mbus_variant {
 	u32					min_dram_divider;
 	u32					max_dram_divider;
@@ -85,6 +93,9 @@ struct sun8i_a33_mbus {
 	struct devfreq				*devfreq_dram;
 	struct devfreq_simple_ondemand_data	gov_data;
 	struct devfreq_dev_profile		profile;
+	struct dev_pm_qos_request		bw_qos;
+	unsigned int				idle_polling_ms;
+	bool					burst;
 	u32					data_width;
 	u32					nominal_bw;
 	u32					odtmap;
@@ -102,6 +113,15 @@ static int pmu_period = 50000;
 module_param(pmu_period, int, 0644);
 MODULE_PARM_DESC(pmu_period, "Bandwidth measurement period (microseconds)");
 
+static unsigned int burst_polling_ms = 100;
+module_param(burst_polling_ms, uint, 0644);
+MODULE_PARM_DESC(burst_polling_ms, "Polling interval while the bus is busy (0 = same as idle)");
+
+/* Bandwidth requests from sunxi_mbus_bw_*_request(), in kB/s */
+static DEFINE_MUTEX(mbus_bw_lock);
+static struct sun8i_a33_mbus *mbus_bw_priv;
+static u64 mbus_bw_total;
+
 static u32 sun8i_a33_mbus_get_peak_bw(struct sun8i_a33_mbus *priv)
 {
 	/* Returns the peak transfer (in KiB) during any single PMU period. */
@@ -238,6 +258,36 @@ static int sun8i_a33_mbus_set_dram_target(struct device *dev,
 	return ret;
 }
 
+/*
+ * Poll faster while the bus is doing real work, so a burst is tracked at
+ * burst_polling_ms rather than at the idle interval. This runs under the
+ * devfreq lock, and the monitor picks up the new interval when it re-arms.
+ */
+static void sun8i_a33_mbus_update_polling(struct sun8i_a33_mbus *priv,
+					  unsigned long busy,
+					  unsigned long total)
+{
+	unsigned int threshold = priv->gov_data.upthreshold -
+				 priv->gov_data.downdifferential;
+	unsigned int fast = max(READ_ONCE(burst_polling_ms),
+				(unsigned int)(pmu_period / USEC_PER_MSEC));
+	bool busy_now = busy * 100 >= total * threshold;
+
+	/* The polling interval was changed through sysfs meanwhile. */
+	if (priv->burst && priv->profile.polling_ms != fast)
+		priv->burst = false;
+
+	if (!priv->burst && busy_now && READ_ONCE(burst_polling_ms) &&
+	    fast < priv->profile.polling_ms) {
+		priv->idle_polling_ms = priv->profile.polling_ms;
+		priv->profile.polling_ms = fast;
+		priv->burst = true;
+	} else if (priv->burst && !busy_now) {
+		priv->profile.polling_ms = priv->idle_polling_ms;
+		priv->burst = false;
+	}
+}
+
 static int sun8i_a33_mbus_get_dram_status(struct device *dev,
 					  struct devfreq_dev_status *stat)
 {
@@ -248,6 +298,7 @@ static int sun8i_a33_mbus_get_dram_status(struct device *dev,
 	stat->current_frequency	= priv->devfreq_dram->previous_freq;
 
 	sun8i_a33_mbus_restart_pmu_counters(priv);
+	sun8i_a33_mbus_update_polling(priv, stat->busy_time, stat->total_time);
 
 	dev_dbg(dev, "Using %lu/%lu (%lu%%) at %lu MHz\n",
 		stat->busy_time, stat->total_time,
@@ -257,6 +308,95 @@ static int sun8i_a33_mbus_get_dram_status(struct device *dev,
 	return 0;
 }
 
+/* Turn the summed bandwidth requests into a minimum DRAM frequency. */
+static void sun8i_a33_mbus_bw_apply(void)
+{
+	struct sun8i_a33_mbus *priv = mbus_bw_priv;
+	u64 khz;
+
+	lockdep_assert_held(&mbus_bw_lock);
+
+	if (!priv || !priv->data_width)
+		return;
+
+	/*
+	 * kB/s -> DDR transfers per millisecond, i.e. kHz of the DDR rate
+	 * that the DRAM clock is expressed in:
+	 *
+	 *      kB         transfer      100
+	 *   -------- * ------------ * -------
+	 *    second     data_width     usable
+	 */
+	khz = div_u64(mbus_bw_total * 100,
+		      priv->data_width * MBUS_BW_USABLE_PERCENT);
+
+	dev_pm_qos_update_request(&priv->bw_qos, min_t(u64, khz, S32_MAX));
+}
+
+/**
+ * sunxi_mbus_bw_add_request - ask for a minimum DRAM bandwidth
+ * @req: request, owned by the caller until it is removed again
+ * @kBps: bandwidth this master needs, in kB/s
+ *
+ * The DRAM clock is kept high enough for the sum of all requests,
+ * independently of what the bandwidth counters have seen so far. This
+ * lets e.g. a network driver raise the floor on link up, before the
+ * traffic arrives. May sleep.
+ */
+void sunxi_mbus_bw_add_request(struct sunxi_mbus_bw_req *req, u32 kBps)
+{
+	if (WARN_ON(req->active))
+		return;
+
+	mutex_lock(&mbus_bw_lock);
+	req->kBps = kBps;
+	req->active = true;
+	mbus_bw_total += kBps;
+	sun8i_a33_mbus_bw_apply();
+	mutex_unlock(&mbus_bw_lock);
+}
+EXPORT_SYMBOL_GPL(sunxi_mbus_bw_add_request);
+
+/**
+ * sunxi_mbus_bw_update_request - change a bandwidth request
+ * @req: request added with sunxi_mbus_bw_add_request()
+ * @kBps: new bandwidth, in kB/s
+ *
+ * May sleep.
+ */
+void sunxi_mbus_bw_update_request(struct sunxi_mbus_bw_req *req, u32 kBps)
+{
+	if (WARN_ON(!req->active) || req->kBps == kBps)
+		return;
+
+	mutex_lock(&mbus_bw_lock);
+	mbus_bw_total = mbus_bw_total - req->kBps + kBps;
+	req->kBps = kBps;
+	sun8i_a33_mbus_bw_apply();
+	mutex_unlock(&mbus_bw_lock);
+}
+EXPORT_SYMBOL_GPL(sunxi_mbus_bw_update_request);
+
+/**
+ * sunxi_mbus_bw_remove_request - drop a bandwidth request
+ * @req: request to remove, may be one that was never added
+ *
+ * May sleep.
+ */
+void sunxi_mbus_bw_remove_request(struct sunxi_mbus_bw_req *req)
+{
+	if (!req->active)
+		return;
+
+	mutex_lock(&mbus_bw_lock);
+	mbus_bw_total -= req->kBps;
+	req->kBps = 0;
+	req->active = false;
+	sun8i_a33_mbus_bw_apply();
+	mutex_unlock(&mbus_bw_lock);
+}
+EXPORT_SYMBOL_GPL(sunxi_mbus_bw_remove_request);
+
 static int sun8i_a33_mbus_hw_init(struct device *dev,
 				  struct sun8i_a33_mbus *priv,
 				  unsigned long ddr_freq)
@@ -444,6 +584,20 @@ static int sun8i_a33_mbus_probe(struct platform_device *pdev)
 	 */
 	priv->devfreq_dram->suspend_freq = priv->freq_table[0];
 
+	ret = dev_pm_qos_add_request(dev, &priv->bw_qos,
+				     DEV_PM_QOS_MIN_FREQUENCY,
+				     PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+	if (ret < 0) {
+		/* Bandwidth requests are ignored, load scaling still works. */
+		dev_warn(dev, "failed to add bandwidth QoS request: %d\n", ret);
+		return 0;
+	}
+
+	mutex_lock(&mbus_bw_lock);
+	mbus_bw_priv = priv;
+	sun8i_a33_mbus_bw_apply();
+	mutex_unlock(&mbus_bw_lock);
+
 	return 0;
 
 err_remove_opps:
@@ -465,6 +619,14 @@ static int sun8i_a33_mbus_remove(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	int ret;
 
+	mutex_lock(&mbus_bw_lock);
+	if (mbus_bw_priv == priv)
+		mbus_bw_priv = NULL;
+	mutex_unlock(&mbus_bw_lock);
+
+	if (dev_pm_qos_request_active(&priv->bw_qos))
+		dev_pm_qos_remove_request(&priv->bw_qos);
+
 	devfreq_remove_device(priv->devfreq_dram);
 
 	ret = sun8i_a33_mbus_set_dram_freq(priv, initial_freq);
@@ -488,6 +650,7 @@ static const struct sun8i_a33_mbus_variant sun50i_a64_mbus = {
 static const struct of_device_id sun8i_a33_mbus_of_match[] = {
 	{ .compatible = "allwinner,sun50i-a64-mbus", .data = &sun50i_a64_mbus },
 	{ .compatible = "allwinner,sun50i-h5-mbus", .data = &sun50i_a64_mbus },
+	{ .compatible = "allwinner,sun8i-h3-mbus", .data = &sun50i_a64_mbus },
 	{ },
 };
 MODULE_DEVICE_TABLE(of, sun8i_a33_mbus_of_match);
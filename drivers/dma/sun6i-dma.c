@@ -17,6 +17,7 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/reset.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 
@@ -103,7 +104,10 @@
  * Various hardware related defines
  */
 #define LLI_LAST_ITEM	0xfffff800
+#define LLI_CACHE_SIZE	32	/* free LLIs kept per virtual channel */
 #define NORMAL_WAIT	8
+/* The byte counter is 25 bits wide, keep segments a power of two below it */
+#define DMA_MAX_SEG_SIZE	SZ_16M
 #define DRQ_SDRAM	1
 #define LINEAR_MODE     0
 #define IO_MODE         1
@@ -171,6 +175,8 @@ struct sun6i_desc {
 	struct virt_dma_desc	vd;
 	dma_addr_t		p_lli;
 	struct sun6i_dma_lli	*v_lli;
+	bool			cyclic;
+	bool			period_irq;
 };
 
 struct sun6i_pchan {
@@ -189,6 +195,15 @@ struct sun6i_vchan {
 	u8			port;
 	u8			irq_type;
 	bool			cyclic;
+
+	/*
+	 * LLIs of freed descriptors, linked through their next fields, so
+	 * that preparing a transfer does not go to the dma_pool.
+	 */
+	spinlock_t		lli_lock;
+	struct sun6i_dma_lli	*lli_free;
+	dma_addr_t		lli_free_phys;
+	unsigned int		nr_lli_free;
 };
 
 struct sun6i_dma_dev {
@@ -404,15 +419,83 @@ static inline void sun6i_dma_dump_lli(struct sun6i_vchan *vchan,
 		v_lli->len, v_lli->para, v_lli->p_lli_next);
 }
 
-static void sun6i_dma_free_desc(struct virt_dma_desc *vd)
+static struct sun6i_dma_lli *sun6i_dma_lli_alloc(struct sun6i_dma_dev *sdev,
+						 struct sun6i_vchan *vchan,
+						 dma_addr_t *p_lli)
+{
+	struct sun6i_dma_lli *v_lli;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vchan->lli_lock, flags);
+	v_lli = vchan->lli_free;
+	if (v_lli) {
+		*p_lli = vchan->lli_free_phys;
+		vchan->lli_free = v_lli->v_lli_next;
+		vchan->lli_free_phys = v_lli->p_lli_next;
+		vchan->nr_lli_free--;
+	}
+	spin_unlock_irqrestore(&vchan->lli_lock, flags);
+
+	if (!v_lli)
+		v_lli = dma_pool_alloc(sdev->pool, GFP_DMA32 | GFP_NOWAIT,
+				       p_lli);
+
+	return v_lli;
+}
+
+static void sun6i_dma_lli_free(struct sun6i_dma_dev *sdev,
+			       struct sun6i_vchan *vchan,
+			       struct sun6i_dma_lli *v_lli, dma_addr_t p_lli)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&vchan->lli_lock, flags);
+	if (vchan->nr_lli_free < LLI_CACHE_SIZE) {
+		v_lli->v_lli_next = vchan->lli_free;
+		v_lli->p_lli_next = vchan->lli_free_phys;
+		vchan->lli_free = v_lli;
+		vchan->lli_free_phys = p_lli;
+		vchan->nr_lli_free++;
+		v_lli = NULL;
+	}
+	spin_unlock_irqrestore(&vchan->lli_lock, flags);
+
+	if (v_lli)
+		dma_pool_free(sdev->pool, v_lli, p_lli);
+}
+
+/* Give the LLI cache of a channel back to the pool */
+static void sun6i_dma_lli_drain(struct sun6i_dma_dev *sdev,
+				struct sun6i_vchan *vchan)
 {
-	struct sun6i_desc *txd = to_sun6i_desc(&vd->tx);
-	struct sun6i_dma_dev *sdev = to_sun6i_dma_dev(vd->tx.chan->device);
 	struct sun6i_dma_lli *v_lli, *v_next;
 	dma_addr_t p_lli, p_next;
+	unsigned long flags;
 
-	if (unlikely(!txd))
-		return;
+	spin_lock_irqsave(&vchan->lli_lock, flags);
+	v_lli = vchan->lli_free;
+	p_lli = vchan->lli_free_phys;
+	vchan->lli_free = NULL;
+	vchan->nr_lli_free = 0;
+	spin_unlock_irqrestore(&vchan->lli_lock, flags);
+
+	while (v_lli) {
+		v_next = v_lli->v_lli_next;
+		p_next = v_lli->p_lli_next;
+
+		dma_pool_free(sdev->pool, v_lli, p_lli);
+
+		v_lli = v_next;
+		p_lli = p_next;
+	}
+}
+
+static void sun6i_dma_free_lli_chain(struct sun6i_dma_dev *sdev,
+				     struct sun6i_vchan *vchan,
+				     struct sun6i_desc *txd)
+{
+	struct sun6i_dma_lli *v_lli, *v_next;
+	dma_addr_t p_lli, p_next;
 
 	p_lli = txd->p_lli;
 	v_lli = txd->v_lli;
@@ -421,12 +504,22 @@ static void sun6i_dma_free_desc(struct virt_dma_desc *vd)
 		v_next = v_lli->v_lli_next;
 		p_next = v_lli->p_lli_next;
 
-		dma_pool_free(sdev->pool, v_lli, p_lli);
+		sun6i_dma_lli_free(sdev, vchan, v_lli, p_lli);
 
 		v_lli = v_next;
 		p_lli = p_next;
 	}
+}
+
+static void sun6i_dma_free_desc(struct virt_dma_desc *vd)
+{
+	struct sun6i_desc *txd = to_sun6i_desc(&vd->tx);
+	struct sun6i_dma_dev *sdev = to_sun6i_dma_dev(vd->tx.chan->device);
+
+	if (unlikely(!txd))
+		return;
 
+	sun6i_dma_free_lli_chain(sdev, to_sun6i_vchan(vd->tx.chan), txd);
 	kfree(txd);
 }
 
@@ -456,7 +549,12 @@ static int sun6i_dma_start_desc(struct sun6i_vchan *vchan)
 	irq_reg = pchan->idx / DMA_IRQ_CHAN_NR;
 	irq_offset = pchan->idx % DMA_IRQ_CHAN_NR;
 
-	vchan->irq_type = vchan->cyclic ? DMA_IRQ_PKG : DMA_IRQ_QUEUE;
+	/* a reused descriptor may not be what was prepared last */
+	vchan->cyclic = pchan->desc->cyclic;
+	if (vchan->cyclic)
+		vchan->irq_type = pchan->desc->period_irq ? DMA_IRQ_PKG : 0;
+	else
+		vchan->irq_type = DMA_IRQ_QUEUE;
 
 	irq_val = readl(sdev->base + DMA_IRQ_EN(irq_reg));
 	irq_val &= ~((DMA_IRQ_HALF | DMA_IRQ_PKG | DMA_IRQ_QUEUE) <<
@@ -544,6 +642,7 @@ static irqreturn_t sun6i_dma_interrupt(int irq, void *dev_id)
 	struct sun6i_vchan *vchan;
 	struct sun6i_pchan *pchan;
 	int i, j, ret = IRQ_NONE;
+	bool idle = false;
 	u32 status;
 
 	for (i = 0; i < sdev->num_pchans / DMA_IRQ_CHAN_NR; i++) {
@@ -566,6 +665,14 @@ static irqreturn_t sun6i_dma_interrupt(int irq, void *dev_id)
 					spin_lock(&vchan->vc.lock);
 					vchan_cookie_complete(&pchan->desc->vd);
 					pchan->done = pchan->desc;
+					/*
+					 * Keep the channel busy from here,
+					 * only releasing it is left to the
+					 * tasklet.
+					 */
+					if (!vchan_next_desc(&vchan->vc) ||
+					    sun6i_dma_start_desc(vchan))
+						idle = true;
 					spin_unlock(&vchan->vc.lock);
 				}
 			}
@@ -573,11 +680,12 @@ static irqreturn_t sun6i_dma_interrupt(int irq, void *dev_id)
 			status = status >> DMA_IRQ_CHAN_WIDTH;
 		}
 
-		if (!atomic_read(&sdev->tasklet_shutdown))
-			tasklet_schedule(&sdev->task);
 		ret = IRQ_HANDLED;
 	}
 
+	if (idle && !atomic_read(&sdev->tasklet_shutdown))
+		tasklet_schedule(&sdev->task);
+
 	return ret;
 }
 
@@ -666,7 +774,7 @@ static struct dma_async_tx_descriptor *sun6i_dma_prep_dma_memcpy(
 	if (!txd)
 		return NULL;
 
-	v_lli = dma_pool_alloc(sdev->pool, GFP_DMA32 | GFP_NOWAIT, &p_lli);
+	v_lli = sun6i_dma_lli_alloc(sdev, vchan, &p_lli);
 	if (!v_lli) {
 		dev_err(sdev->slave.dev, "Failed to alloc lli memory\n");
 		goto err_txd_free;
@@ -725,7 +833,7 @@ static struct dma_async_tx_descriptor *sun6i_dma_prep_slave_sg(
 		return NULL;
 
 	for_each_sg(sgl, sg, sg_len, i) {
-		v_lli = dma_pool_alloc(sdev->pool, GFP_DMA32 | GFP_NOWAIT, &p_lli);
+		v_lli = sun6i_dma_lli_alloc(sdev, vchan, &p_lli);
 		if (!v_lli)
 			goto err_lli_free;
 
@@ -772,9 +880,7 @@ static struct dma_async_tx_descriptor *sun6i_dma_prep_slave_sg(
 	return vchan_tx_prep(&vchan->vc, &txd->vd, flags);
 
 err_lli_free:
-	for (p_lli = txd->p_lli, v_lli = txd->v_lli; v_lli;
-	     p_lli = v_lli->p_lli_next, v_lli = v_lli->v_lli_next)
-		dma_pool_free(sdev->pool, v_lli, p_lli);
+	sun6i_dma_free_lli_chain(sdev, vchan, txd);
 	kfree(txd);
 	return NULL;
 }
@@ -808,7 +914,7 @@ static struct dma_async_tx_descriptor *sun6i_dma_prep_dma_cyclic(
 		return NULL;
 
 	for (i = 0; i < periods; i++) {
-		v_lli = dma_pool_alloc(sdev->pool, GFP_DMA32 | GFP_NOWAIT, &p_lli);
+		v_lli = sun6i_dma_lli_alloc(sdev, vchan, &p_lli);
 		if (!v_lli) {
 			dev_err(sdev->slave.dev, "Failed to alloc lli memory\n");
 			goto err_lli_free;
@@ -838,14 +944,19 @@ static struct dma_async_tx_descriptor *sun6i_dma_prep_dma_cyclic(
 
 	prev->p_lli_next = txd->p_lli;		/* cyclic list */
 
+	txd->cyclic = true;
+	/*
+	 * Without DMA_PREP_INTERRUPT the client (e.g. an ALSA stream opened
+	 * with no period wakeups) polls the position through the residue,
+	 * so don't raise an interrupt at the end of every period.
+	 */
+	txd->period_irq = !!(flags & DMA_PREP_INTERRUPT);
 	vchan->cyclic = true;
 
 	return vchan_tx_prep(&vchan->vc, &txd->vd, flags);
 
 err_lli_free:
-	for (p_lli = txd->p_lli, v_lli = txd->v_lli; v_lli;
-	     p_lli = v_lli->p_lli_next, v_lli = v_lli->v_lli_next)
-		dma_pool_free(sdev->pool, v_lli, p_lli);
+	sun6i_dma_free_lli_chain(sdev, vchan, txd);
 	kfree(txd);
 	return NULL;
 }
@@ -990,7 +1101,10 @@ static void sun6i_dma_issue_pending(struct dma_chan *chan)
 {
 	struct sun6i_dma_dev *sdev = to_sun6i_dma_dev(chan->device);
 	struct sun6i_vchan *vchan = to_sun6i_vchan(chan);
+	struct sun6i_pchan *pchan;
 	unsigned long flags;
+	bool start = false;
+	unsigned int i;
 
 	spin_lock_irqsave(&vchan->vc.lock, flags);
 
@@ -998,13 +1112,34 @@ static void sun6i_dma_issue_pending(struct dma_chan *chan)
 		spin_lock(&sdev->lock);
 
 		if (!vchan->phy && list_empty(&vchan->node)) {
-			list_add_tail(&vchan->node, &sdev->pending);
-			tasklet_schedule(&sdev->task);
+			/*
+			 * Take an idle physical channel right away, unless
+			 * other channels are already waiting for one.
+			 */
+			for (i = 0; list_empty(&sdev->pending) &&
+				    i < sdev->num_pchans; i++) {
+				pchan = &sdev->pchans[i];
+				if (pchan->vchan)
+					continue;
+
+				pchan->vchan = vchan;
+				vchan->phy = pchan;
+				start = true;
+				break;
+			}
+
+			if (!start) {
+				list_add_tail(&vchan->node, &sdev->pending);
+				tasklet_schedule(&sdev->task);
+			}
 			dev_dbg(chan2dev(chan), "vchan %p: issued\n",
 				&vchan->vc);
 		}
 
 		spin_unlock(&sdev->lock);
+
+		if (start)
+			sun6i_dma_start_desc(vchan);
 	} else {
 		dev_dbg(chan2dev(chan), "vchan %p: nothing to issue\n",
 			&vchan->vc);
@@ -1024,6 +1159,7 @@ static void sun6i_dma_free_chan_resources(struct dma_chan *chan)
 	spin_unlock_irqrestore(&sdev->lock, flags);
 
 	vchan_free_chan_resources(&vchan->vc);
+	sun6i_dma_lli_drain(sdev, vchan);
 }
 
 static struct dma_chan *sun6i_dma_of_xlate(struct of_phandle_args *dma_spec,
@@ -1356,8 +1492,12 @@ static int sun6i_dma_probe(struct platform_device *pdev)
 	sdc->slave.directions			= BIT(DMA_DEV_TO_MEM) |
 						  BIT(DMA_MEM_TO_DEV);
 	sdc->slave.residue_granularity		= DMA_RESIDUE_GRANULARITY_BURST;
+	sdc->slave.descriptor_reuse		= true;
 	sdc->slave.dev = &pdev->dev;
 
+	/* Lets cyclic clients such as ALSA use large periods */
+	dma_set_max_seg_size(&pdev->dev, DMA_MAX_SEG_SIZE);
+
 	sdc->num_pchans = sdc->cfg->nr_max_channels;
 	sdc->num_vchans = sdc->cfg->nr_max_vchans;
 	sdc->max_request = sdc->cfg->nr_max_requests;
@@ -1405,6 +1545,7 @@ static int sun6i_dma_probe(struct platform_device *pdev)
 		struct sun6i_vchan *vchan = &sdc->vchans[i];
 
 		INIT_LIST_HEAD(&vchan->node);
+		spin_lock_init(&vchan->lli_lock);
 		vchan->vc.desc_free = sun6i_dma_free_desc;
 		vchan_init(&vchan->vc, &sdc->slave);
 	}
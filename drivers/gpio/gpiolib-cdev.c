@@ -16,6 +16,8 @@
 #include <linux/irqreturn.h>
 #include <linux/kernel.h>
 #include <linux/kfifo.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/pinctrl/consumer.h>
@@ -23,6 +25,7 @@
 #include <linux/spinlock.h>
 #include <linux/timekeeping.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 #include <linux/hte.h>
 #include <uapi/linux/gpio.h>
@@ -48,6 +51,8 @@ static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_info), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_info_changed), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_event), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_values), 8));
+static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_edge_counts), 8));
+static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_event_ring), 8));
 
 /* Character device interface to GPIO.
  *
@@ -481,6 +486,9 @@ out_free_lh:
  * @raw_level: the line level at the time of event
  * @total_discard_seq: the running counter of the discarded events
  * @last_seqno: the last sequence number before debounce period expires
+ * @count_lock: protects @edge_count and @edge_ts_ns
+ * @edge_count: the number of edges counted in edge counting mode
+ * @edge_ts_ns: the timestamp of the last counted edge
  */
 struct line {
 	struct gpio_desc *desc;
@@ -546,6 +554,16 @@ struct line {
 	 */
 	u32 last_seqno;
 #endif /* CONFIG_HTE */
+	/*
+	 * -- edge counter specific fields --
+	 *
+	 * Updated from hard interrupt context by edge_count_irq_handler()
+	 * and process_hw_ts(), or by debounce_work_func(), and read by
+	 * linereq_get_edge_counts().
+	 */
+	spinlock_t count_lock;
+	u64 edge_count;
+	u64 edge_ts_ns;
 };
 
 /**
@@ -561,6 +579,11 @@ struct line {
  * the line_seqno is then the same and is cheaper to calculate.
  * @config_mutex: mutex for serializing ioctl() calls to ensure consistency
  * of configuration, particularly multi-step accesses to desc flags.
+ * @ring: the memory mapped event ring, replacing @events once allocated
+ * @ring_size: the size of the @ring mapping, in bytes
+ * @ring_mask: the number of elements in @ring, minus one
+ * @ring_head: the kernel's copy of the @ring head, as userspace may write
+ * anything to the mapping
  * @lines: the lines held by this line request, with @num_lines elements.
  */
 struct linereq {
@@ -572,9 +595,17 @@ struct linereq {
 	DECLARE_KFIFO_PTR(events, struct gpio_v2_line_event);
 	atomic_t seqno;
 	struct mutex config_mutex;
+	/* ring, ring_mask and ring_head are protected by wait.lock */
+	struct gpio_v2_line_event_ring *ring;
+	unsigned long ring_size;
+	u32 ring_mask;
+	u32 ring_head;
 	struct line lines[];
 };
 
+/* the largest event ring mapping accepted by linereq_mmap() */
+#define LINEREQ_RING_SIZE_MAX	(4 << 20)
+
 #define GPIO_V2_LINE_BIAS_FLAGS \
 	(GPIO_V2_LINE_FLAG_BIAS_PULL_UP | \
 	 GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN | \
@@ -601,25 +632,52 @@ struct linereq {
 	 GPIO_V2_LINE_EDGE_FLAGS | \
 	 GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME | \
 	 GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE | \
+	 GPIO_V2_LINE_FLAG_EDGE_COUNT | \
 	 GPIO_V2_LINE_BIAS_FLAGS)
 
 /* subset of flags relevant for edge detector configuration */
 #define GPIO_V2_LINE_EDGE_DETECTOR_FLAGS \
 	(GPIO_V2_LINE_FLAG_ACTIVE_LOW | \
 	 GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE | \
+	 GPIO_V2_LINE_FLAG_EDGE_COUNT | \
 	 GPIO_V2_LINE_EDGE_FLAGS)
 
+/*
+ * Returns false if the ring is full. Called with lr->wait.lock held.
+ */
+static bool linereq_ring_put(struct linereq *lr,
+			     struct gpio_v2_line_event *le)
+{
+	struct gpio_v2_line_event_ring *ring = lr->ring;
+	u32 head = lr->ring_head;
+
+	/* pairs with the userspace store-release of tail */
+	if (head - smp_load_acquire(&ring->tail) > lr->ring_mask)
+		return false;
+
+	ring->events[head & lr->ring_mask] = *le;
+	lr->ring_head = ++head;
+	/* pairs with the userspace load-acquire of head */
+	smp_store_release(&ring->head, head);
+
+	return true;
+}
+
 static void linereq_put_event(struct linereq *lr,
 			      struct gpio_v2_line_event *le)
 {
 	bool overflow = false;
 
 	spin_lock(&lr->wait.lock);
-	if (kfifo_is_full(&lr->events)) {
-		overflow = true;
-		kfifo_skip(&lr->events);
+	if (lr->ring) {
+		overflow = !linereq_ring_put(lr, le);
+	} else {
+		if (kfifo_is_full(&lr->events)) {
+			overflow = true;
+			kfifo_skip(&lr->events);
+		}
+		kfifo_in(&lr->events, le, 1);
 	}
-	kfifo_in(&lr->events, le, 1);
 	spin_unlock(&lr->wait.lock);
 	if (!overflow)
 		wake_up_poll(&lr->wait, EPOLLIN);
@@ -627,6 +685,16 @@ static void linereq_put_event(struct linereq *lr,
 		pr_debug_ratelimited("event FIFO is full - event dropped\n");
 }
 
+static void line_count_edge(struct line *line, u64 timestamp_ns)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&line->count_lock, flags);
+	line->edge_count++;
+	line->edge_ts_ns = timestamp_ns;
+	spin_unlock_irqrestore(&line->count_lock, flags);
+}
+
 static u64 line_event_timestamp(struct line *line)
 {
 	if (test_bit(FLAG_EVENT_CLOCK_REALTIME, &line->desc->flags))
@@ -713,6 +781,8 @@ static enum hte_return process_hw_ts(struct hte_ts_data *ts, void *p)
 		line->last_seqno = ts->seq;
 		mod_delayed_work(system_wq, &line->work,
 		  usecs_to_jiffies(READ_ONCE(line->desc->debounce_period_us)));
+	} else if (READ_ONCE(line->edflags) & GPIO_V2_LINE_FLAG_EDGE_COUNT) {
+		line_count_edge(line, ts->tsc);
 	} else {
 		if (unlikely(ts->seq < line->line_seqno))
 			return HTE_CB_HANDLED;
@@ -828,6 +898,19 @@ static irqreturn_t edge_irq_handler(int irq, void *p)
 	return IRQ_WAKE_THREAD;
 }
 
+/*
+ * Edge counting mode: account the edge in hardirq context and skip the
+ * thread wakeup and per edge event entirely.
+ */
+static irqreturn_t edge_count_irq_handler(int irq, void *p)
+{
+	struct line *line = p;
+
+	line_count_edge(line, line_event_timestamp(line));
+
+	return IRQ_HANDLED;
+}
+
 /*
  * returns the current debounced logical value.
  */
@@ -897,6 +980,11 @@ static void debounce_work_func(struct work_struct *work)
 	    ((eflags == GPIO_V2_LINE_FLAG_EDGE_FALLING) && level))
 		return;
 
+	if (edflags & GPIO_V2_LINE_FLAG_EDGE_COUNT) {
+		line_count_edge(line, line_event_timestamp(line));
+		return;
+	}
+
 	/* Do not leak kernel stack to userspace */
 	memset(&le, 0, sizeof(le));
 
@@ -1029,7 +1117,8 @@ static int edge_detector_setup(struct line *line,
 	int irq, ret;
 
 	eflags = edflags & GPIO_V2_LINE_EDGE_FLAGS;
-	if (eflags && !kfifo_initialized(&line->req->events)) {
+	if (eflags && !(edflags & GPIO_V2_LINE_FLAG_EDGE_COUNT) &&
+	    !kfifo_initialized(&line->req->events)) {
 		ret = kfifo_alloc(&line->req->events,
 				  line->req->event_buffer_size, GFP_KERNEL);
 		if (ret)
@@ -1061,6 +1150,17 @@ static int edge_detector_setup(struct line *line,
 	if (eflags & GPIO_V2_LINE_FLAG_EDGE_FALLING)
 		irqflags |= test_bit(FLAG_ACTIVE_LOW, &line->desc->flags) ?
 			IRQF_TRIGGER_RISING : IRQF_TRIGGER_FALLING;
+
+	if (edflags & GPIO_V2_LINE_FLAG_EDGE_COUNT) {
+		ret = request_irq(irq, edge_count_irq_handler, irqflags,
+				  line->req->label, line);
+		if (ret)
+			return ret;
+
+		line->irq = irq;
+		return 0;
+	}
+
 	irqflags |= IRQF_ONESHOT;
 
 	/* Request a thread to read the events */
@@ -1157,6 +1257,11 @@ static int gpio_v2_line_flags_validate(u64 flags)
 	    !(flags & GPIO_V2_LINE_FLAG_INPUT))
 		return -EINVAL;
 
+	/* Edge counting requires edge detection. */
+	if ((flags & GPIO_V2_LINE_FLAG_EDGE_COUNT) &&
+	    !(flags & GPIO_V2_LINE_EDGE_FLAGS))
+		return -EINVAL;
+
 	/*
 	 * Do not allow OPEN_SOURCE and OPEN_DRAIN flags in a single
 	 * request. If the hardware actually supports enabling both at the
@@ -1229,6 +1334,8 @@ static void gpio_v2_line_config_flags_to_desc_flags(u64 flags,
 		   flags & GPIO_V2_LINE_FLAG_EDGE_RISING);
 	assign_bit(FLAG_EDGE_FALLING, flagsp,
 		   flags & GPIO_V2_LINE_FLAG_EDGE_FALLING);
+	assign_bit(FLAG_EDGE_COUNT, flagsp,
+		   flags & GPIO_V2_LINE_FLAG_EDGE_COUNT);
 
 	assign_bit(FLAG_OPEN_DRAIN, flagsp,
 		   flags & GPIO_V2_LINE_FLAG_OPEN_DRAIN);
@@ -1434,6 +1541,49 @@ static long linereq_set_config(struct linereq *lr, void __user *ip)
 	return ret;
 }
 
+static long linereq_get_edge_counts(struct linereq *lr, void __user *ip)
+{
+	struct gpio_v2_line_edge_counts *lec;
+	unsigned long flags;
+	struct line *line;
+	unsigned int i;
+	long ret = 0;
+
+	lec = kzalloc(sizeof(*lec), GFP_KERNEL);
+	if (!lec)
+		return -ENOMEM;
+
+	if (copy_from_user(lec, ip, offsetof(typeof(*lec), counts))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+
+	if (lec->mask == 0) {
+		ret = -EINVAL;
+		goto out_free;
+	}
+
+	for (i = 0; i < lr->num_lines; i++) {
+		if (!(lec->mask & BIT_ULL(i)))
+			continue;
+
+		line = &lr->lines[i];
+		spin_lock_irqsave(&line->count_lock, flags);
+		lec->counts[i].count = line->edge_count;
+		lec->counts[i].timestamp_ns = line->edge_ts_ns;
+		if (lec->reset & BIT_ULL(i))
+			line->edge_count = 0;
+		spin_unlock_irqrestore(&line->count_lock, flags);
+	}
+
+	if (copy_to_user(ip, lec, sizeof(*lec)))
+		ret = -EFAULT;
+
+out_free:
+	kfree(lec);
+	return ret;
+}
+
 static long linereq_ioctl_unlocked(struct file *file, unsigned int cmd,
 				   unsigned long arg)
 {
@@ -1450,6 +1600,8 @@ static long linereq_ioctl_unlocked(struct file *file, unsigned int cmd,
 		return linereq_set_values(lr, ip);
 	case GPIO_V2_LINE_SET_CONFIG_IOCTL:
 		return linereq_set_config(lr, ip);
+	case GPIO_V2_LINE_GET_EDGE_COUNTS_IOCTL:
+		return linereq_get_edge_counts(lr, ip);
 	default:
 		return -EINVAL;
 	}
@@ -1472,6 +1624,18 @@ static long linereq_ioctl_compat(struct file *file, unsigned int cmd,
 }
 #endif
 
+static bool linereq_ring_empty(struct linereq *lr)
+{
+	bool empty = true;
+
+	spin_lock(&lr->wait.lock);
+	if (lr->ring)
+		empty = lr->ring_head == READ_ONCE(lr->ring->tail);
+	spin_unlock(&lr->wait.lock);
+
+	return empty;
+}
+
 static __poll_t linereq_poll_unlocked(struct file *file,
 				      struct poll_table_struct *wait)
 {
@@ -1484,7 +1648,8 @@ static __poll_t linereq_poll_unlocked(struct file *file,
 	poll_wait(file, &lr->wait, wait);
 
 	if (!kfifo_is_empty_spinlocked_noirqsave(&lr->events,
-						 &lr->wait.lock))
+						 &lr->wait.lock) ||
+	    !linereq_ring_empty(lr))
 		events = EPOLLIN | EPOLLRDNORM;
 
 	return events;
@@ -1562,6 +1727,57 @@ static ssize_t linereq_read(struct file *file, char __user *buf,
 				linereq_read_unlocked);
 }
 
+static int linereq_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct linereq *lr = file->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	struct gpio_v2_line_event_ring *ring;
+	u32 num_events;
+	int ret = 0;
+
+	if (!lr->gdev->chip)
+		return -ENODEV;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED) ||
+	    size < sizeof(*ring) || size > LINEREQ_RING_SIZE_MAX)
+		return -EINVAL;
+
+	num_events = (size - sizeof(*ring)) / sizeof(ring->events[0]);
+	if (num_events < 2)
+		return -EINVAL;
+	num_events = rounddown_pow_of_two(num_events);
+
+	mutex_lock(&lr->config_mutex);
+
+	/* the ring is allocated once, later mappings must share it */
+	if (lr->ring) {
+		if (size != lr->ring_size)
+			ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	ring = vmalloc_user(size);
+	if (!ring) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+	ring->num_events = num_events;
+
+	spin_lock(&lr->wait.lock);
+	lr->ring_size = size;
+	lr->ring_mask = num_events - 1;
+	lr->ring_head = 0;
+	lr->ring = ring;
+	spin_unlock(&lr->wait.lock);
+
+out_unlock:
+	if (!ret)
+		ret = remap_vmalloc_range(vma, lr->ring, 0);
+	mutex_unlock(&lr->config_mutex);
+
+	return ret;
+}
+
 static void linereq_free(struct linereq *lr)
 {
 	unsigned int i;
@@ -1573,6 +1789,7 @@ static void linereq_free(struct linereq *lr)
 		}
 	}
 	kfifo_free(&lr->events);
+	vfree(lr->ring);
 	kfree(lr->label);
 	put_device(&lr->gdev->dev);
 	kfree(lr);
@@ -1605,6 +1822,7 @@ static const struct file_operations line_fileops = {
 	.release = linereq_release,
 	.read = linereq_read,
 	.poll = linereq_poll,
+	.mmap = linereq_mmap,
 	.owner = THIS_MODULE,
 	.llseek = noop_llseek,
 	.unlocked_ioctl = linereq_ioctl,
@@ -1649,6 +1867,7 @@ static int linereq_create(struct gpio_device *gdev, void __user *ip)
 
 	for (i = 0; i < ulr.num_lines; i++) {
 		lr->lines[i].req = lr;
+		spin_lock_init(&lr->lines[i].count_lock);
 		WRITE_ONCE(lr->lines[i].sw_debounced, 0);
 		INIT_DELAYED_WORK(&lr->lines[i].work, debounce_work_func);
 	}
@@ -1727,14 +1946,15 @@ static int linereq_create(struct gpio_device *gdev, void __user *ip)
 			offset);
 	}
 
-	fd = get_unused_fd_flags(O_RDONLY | O_CLOEXEC);
+	/* writable so that the event ring tail can be mapped shared */
+	fd = get_unused_fd_flags(O_RDWR | O_CLOEXEC);
 	if (fd < 0) {
 		ret = fd;
 		goto out_free_linereq;
 	}
 
 	file = anon_inode_getfile("gpio-line", &line_fileops, lr,
-				  O_RDONLY | O_CLOEXEC);
+				  O_RDWR | O_CLOEXEC);
 	if (IS_ERR(file)) {
 		ret = PTR_ERR(file);
 		goto out_put_unused_fd;
@@ -2299,6 +2519,8 @@ static void gpio_desc_to_lineinfo(struct gpio_desc *desc,
 		info->flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
 	if (test_bit(FLAG_EDGE_FALLING, &desc->flags))
 		info->flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	if (test_bit(FLAG_EDGE_COUNT, &desc->flags))
+		info->flags |= GPIO_V2_LINE_FLAG_EDGE_COUNT;
 
 	if (test_bit(FLAG_EVENT_CLOCK_REALTIME, &desc->flags))
 		info->flags |= GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME;
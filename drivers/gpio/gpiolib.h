@@ -167,6 +167,7 @@ struct gpio_desc {
 #define FLAG_EDGE_FALLING    17	/* GPIO CDEV detects falling edge events */
 #define FLAG_EVENT_CLOCK_REALTIME	18 /* GPIO CDEV reports REALTIME timestamps in events */
 #define FLAG_EVENT_CLOCK_HTE		19 /* GPIO CDEV reports hardware timestamps in events */
+#define FLAG_EDGE_COUNT		20 /* GPIO CDEV counts edges instead of reporting events */
 
 	/* Connection label */
 	const char		*label;
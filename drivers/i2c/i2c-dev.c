@@ -27,9 +27,13 @@
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/notifier.h>
+#include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/timekeeping.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 /*
  * An i2c_dev represents an i2c_adapter ... an I2C or SMBus master, not a
@@ -46,6 +50,43 @@ struct i2c_dev {
 	struct cdev cdev;
 };
 
+/*
+ * Periodic read list of an open file, set up with I2C_POLL_SETUP. The
+ * list is run from a work item with the bus locked once per period, and
+ * the results are queued in a ring until I2C_POLL_READ fetches them.
+ */
+struct i2cdev_poll {
+	struct i2c_adapter *adap;
+	wait_queue_head_t *wait;
+	struct delayed_work work;
+	unsigned long period;		/* jiffies */
+	unsigned long next;
+
+	spinlock_t lock;		/* protects the ring */
+	unsigned int head, tail;	/* free running */
+	u32 lost;
+	struct i2c_poll_sample ring[I2C_POLL_RING_SIZE];
+
+	unsigned int nentries;
+	struct i2c_poll_entry entries[];
+};
+
+/*
+ * Per open file state. The client comes first and is what
+ * file->private_data points to, so all existing paths keep using it.
+ */
+struct i2cdev_file {
+	struct i2c_client client;
+	struct mutex poll_lock;		/* protects poll */
+	struct i2cdev_poll *poll;
+	wait_queue_head_t poll_wait;
+};
+
+static inline struct i2cdev_file *to_i2cdev_file(struct i2c_client *client)
+{
+	return container_of(client, struct i2cdev_file, client);
+}
+
 #define I2C_MINORS	(MINORMASK + 1)
 static LIST_HEAD(i2c_dev_list);
 static DEFINE_SPINLOCK(i2c_dev_list_lock);
@@ -389,6 +430,187 @@ static noinline int i2cdev_ioctl_smbus(struct i2c_client *client,
 	return res;
 }
 
+static void i2cdev_poll_push(struct i2cdev_poll *poll,
+			     const struct i2c_poll_sample *sample)
+{
+	spin_lock(&poll->lock);
+	if (poll->head - poll->tail == I2C_POLL_RING_SIZE) {
+		poll->tail++;
+		poll->lost++;
+	}
+	poll->ring[poll->head++ % I2C_POLL_RING_SIZE] = *sample;
+	spin_unlock(&poll->lock);
+}
+
+static void i2cdev_poll_work(struct work_struct *work)
+{
+	struct i2cdev_poll *poll = container_of(to_delayed_work(work),
+						struct i2cdev_poll, work);
+	struct i2c_poll_sample sample;
+	struct i2c_msg msgs[2];
+	unsigned int i;
+	int ret;
+
+	/* One bus lock for the whole list, so a sweep is not interleaved */
+	i2c_lock_bus(poll->adap, I2C_LOCK_SEGMENT);
+	for (i = 0; i < poll->nentries; i++) {
+		struct i2c_poll_entry *e = &poll->entries[i];
+
+		/* All of it ends up in userspace */
+		memset(&sample, 0, sizeof(sample));
+
+		msgs[0].addr = e->addr;
+		msgs[0].flags = 0;
+		msgs[0].len = 1;
+		msgs[0].buf = &e->reg;
+		msgs[1].addr = e->addr;
+		msgs[1].flags = I2C_M_RD;
+		msgs[1].len = e->len;
+		msgs[1].buf = sample.data;
+
+		ret = __i2c_transfer(poll->adap, msgs, ARRAY_SIZE(msgs));
+
+		sample.timestamp = ktime_get_ns();
+		sample.index = i;
+		sample.status = ret == ARRAY_SIZE(msgs) ? 0 :
+				ret < 0 ? ret : -EIO;
+		sample.len = sample.status ? 0 : e->len;
+		i2cdev_poll_push(poll, &sample);
+	}
+	i2c_unlock_bus(poll->adap, I2C_LOCK_SEGMENT);
+
+	/* Keep the period on schedule, skip what was missed on overruns */
+	poll->next += poll->period;
+	if (time_after_eq(jiffies, poll->next))
+		poll->next = jiffies + poll->period;
+	queue_delayed_work(system_wq, &poll->work, poll->next - jiffies);
+
+	/* The file outlives the work, see i2cdev_poll_stop() */
+	wake_up_interruptible(poll->wait);
+}
+
+/* Called with f->poll_lock held */
+static void i2cdev_poll_stop(struct i2cdev_file *f)
+{
+	if (!f->poll)
+		return;
+
+	cancel_delayed_work_sync(&f->poll->work);
+	kfree(f->poll);
+	f->poll = NULL;
+}
+
+static int i2cdev_ioctl_poll_setup(struct i2cdev_file *f,
+				   struct i2c_poll_setup *setup)
+{
+	struct i2c_adapter *adap = f->client.adapter;
+	struct i2cdev_poll *poll;
+	unsigned int i;
+	int ret;
+
+	if (!setup->nentries || !setup->period_us) {
+		mutex_lock(&f->poll_lock);
+		i2cdev_poll_stop(f);
+		mutex_unlock(&f->poll_lock);
+		return 0;
+	}
+
+	if (setup->nentries > I2C_POLL_MAX_ENTRIES)
+		return -EINVAL;
+
+	if (!i2c_check_functionality(adap, I2C_FUNC_I2C))
+		return -EOPNOTSUPP;
+
+	poll = kzalloc(struct_size(poll, entries, setup->nentries),
+		       GFP_KERNEL);
+	if (!poll)
+		return -ENOMEM;
+
+	if (copy_from_user(poll->entries, u64_to_user_ptr(setup->entries),
+			   setup->nentries * sizeof(*poll->entries))) {
+		ret = -EFAULT;
+		goto err_free;
+	}
+
+	for (i = 0; i < setup->nentries; i++) {
+		struct i2c_poll_entry *e = &poll->entries[i];
+
+		if (e->addr > 0x7f || !e->len || e->len > I2C_POLL_MAX_LEN) {
+			ret = -EINVAL;
+			goto err_free;
+		}
+		/* Same rule as I2C_SLAVE: hands off devices with a driver */
+		if (i2cdev_check_addr(adap, e->addr)) {
+			ret = -EBUSY;
+			goto err_free;
+		}
+	}
+
+	poll->adap = adap;
+	poll->wait = &f->poll_wait;
+	poll->nentries = setup->nentries;
+	poll->period = max(usecs_to_jiffies(setup->period_us), 1UL);
+	spin_lock_init(&poll->lock);
+	INIT_DELAYED_WORK(&poll->work, i2cdev_poll_work);
+
+	mutex_lock(&f->poll_lock);
+	i2cdev_poll_stop(f);
+	f->poll = poll;
+	poll->next = jiffies;
+	queue_delayed_work(system_wq, &poll->work, 0);
+	mutex_unlock(&f->poll_lock);
+
+	return 0;
+
+err_free:
+	kfree(poll);
+	return ret;
+}
+
+static int i2cdev_ioctl_poll_read(struct i2cdev_file *f,
+				  struct i2c_poll_read *rd)
+{
+	struct i2c_poll_sample __user *usample;
+	struct i2c_poll_sample sample;
+	struct i2cdev_poll *poll;
+	unsigned int n = 0;
+	int ret = 0;
+
+	usample = u64_to_user_ptr(rd->samples);
+
+	mutex_lock(&f->poll_lock);
+	poll = f->poll;
+	if (!poll) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	spin_lock(&poll->lock);
+	rd->lost = poll->lost;
+	poll->lost = 0;
+	spin_unlock(&poll->lock);
+
+	while (n < rd->nsamples) {
+		spin_lock(&poll->lock);
+		if (poll->head == poll->tail) {
+			spin_unlock(&poll->lock);
+			break;
+		}
+		sample = poll->ring[poll->tail++ % I2C_POLL_RING_SIZE];
+		spin_unlock(&poll->lock);
+
+		if (copy_to_user(usample + n, &sample, sizeof(sample))) {
+			ret = -EFAULT;
+			break;
+		}
+		n++;
+	}
+	rd->nsamples = n;
+out:
+	mutex_unlock(&f->poll_lock);
+	return ret;
+}
+
 static long i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct i2c_client *client = file->private_data;
@@ -484,6 +706,26 @@ static long i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		 */
 		client->adapter->timeout = msecs_to_jiffies(arg * 10);
 		break;
+	case I2C_POLL_SETUP: {
+		struct i2c_poll_setup setup;
+
+		if (copy_from_user(&setup, (void __user *)arg, sizeof(setup)))
+			return -EFAULT;
+		return i2cdev_ioctl_poll_setup(to_i2cdev_file(client), &setup);
+	}
+	case I2C_POLL_READ: {
+		struct i2c_poll_read rd;
+		int ret;
+
+		if (copy_from_user(&rd, (void __user *)arg, sizeof(rd)))
+			return -EFAULT;
+		ret = i2cdev_ioctl_poll_read(to_i2cdev_file(client), &rd);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &rd, sizeof(rd)))
+			return -EFAULT;
+		return 0;
+	}
 	default:
 		/* NOTE:  returning a fault code here could cause trouble
 		 * in buggy userspace code.  Some old kernel bugs returned
@@ -574,6 +816,9 @@ static long compat_i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned lo
 					  data32.size,
 					  compat_ptr(data32.data));
 	}
+	case I2C_POLL_SETUP:
+	case I2C_POLL_READ:
+		return i2cdev_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
 	default:
 		return i2cdev_ioctl(file, cmd, arg);
 	}
@@ -582,11 +827,27 @@ static long compat_i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned lo
 #define compat_i2cdev_ioctl NULL
 #endif
 
+static __poll_t i2cdev_poll(struct file *file, poll_table *wait)
+{
+	struct i2cdev_file *f = to_i2cdev_file(file->private_data);
+	__poll_t mask = 0;
+
+	poll_wait(file, &f->poll_wait, wait);
+
+	mutex_lock(&f->poll_lock);
+	if (f->poll && READ_ONCE(f->poll->head) != READ_ONCE(f->poll->tail))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	mutex_unlock(&f->poll_lock);
+
+	return mask;
+}
+
 static int i2cdev_open(struct inode *inode, struct file *file)
 {
 	unsigned int minor = iminor(inode);
 	struct i2c_client *client;
 	struct i2c_adapter *adap;
+	struct i2cdev_file *f;
 
 	adap = i2c_get_adapter(minor);
 	if (!adap)
@@ -599,11 +860,15 @@ static int i2cdev_open(struct inode *inode, struct file *file)
 	 * or I2C core code!!  It just holds private copies of addressing
 	 * information and maybe a PEC flag.
 	 */
-	client = kzalloc(sizeof(*client), GFP_KERNEL);
-	if (!client) {
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f) {
 		i2c_put_adapter(adap);
 		return -ENOMEM;
 	}
+	mutex_init(&f->poll_lock);
+	init_waitqueue_head(&f->poll_wait);
+
+	client = &f->client;
 	snprintf(client->name, I2C_NAME_SIZE, "i2c-dev %d", adap->nr);
 
 	client->adapter = adap;
@@ -615,9 +880,14 @@ static int i2cdev_open(struct inode *inode, struct file *file)
 static int i2cdev_release(struct inode *inode, struct file *file)
 {
 	struct i2c_client *client = file->private_data;
+	struct i2cdev_file *f = to_i2cdev_file(client);
+
+	mutex_lock(&f->poll_lock);
+	i2cdev_poll_stop(f);
+	mutex_unlock(&f->poll_lock);
 
 	i2c_put_adapter(client->adapter);
-	kfree(client);
+	kfree(f);
 	file->private_data = NULL;
 
 	return 0;
@@ -630,6 +900,7 @@ static const struct file_operations i2cdev_fops = {
 	.write		= i2cdev_write,
 	.unlocked_ioctl	= i2cdev_ioctl,
 	.compat_ioctl	= compat_i2cdev_ioctl,
+	.poll		= i2cdev_poll,
 	.open		= i2cdev_open,
 	.release	= i2cdev_release,
 };
@@ -35,8 +35,11 @@
 #include <linux/delay.h>
 
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/driver.h>
 #include <linux/iio/machine.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/mfd/sun4i-gpadc.h>
 
 static unsigned int sun4i_gpadc_chan_select(unsigned int chan)
@@ -311,15 +314,39 @@ struct sun4i_gpadc_iio {
 	struct mutex			mutex;
 	struct thermal_zone_device	*tzd;
 	struct device			*sensor_device;
+	/* set while the buffer owns the ADC, protected by mutex */
+	bool				buffered;
+	/* FS_DIV conversion rate setting used by the buffer */
+	unsigned int			fs_div;
+	u32				fifo[SUN4I_GPADC_FIFO_DEPTH];
+	struct {
+		u16			data;
+		s64			timestamp __aligned(8);
+	} scan;
 };
 
+/* ADC input clock, see sun4i_gpadc_sample_start() */
+#define SUN4I_GPADC_CLKIN		6000000
+
+/* conversion rate is CLKIN / 2^(20 - FS_DIV) */
+#define SUN4I_GPADC_FS_DIV_MAX		15
+#define SUN4I_GPADC_FS_DIV_DEFAULT	7
+
 #define SUN4I_GPADC_ADC_CHANNEL(_channel, _name) {		\
 	.type = IIO_VOLTAGE,					\
 	.indexed = 1,						\
 	.channel = _channel,					\
 	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),		\
 	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE),	\
+	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
 	.datasheet_name = _name,				\
+	.scan_index = _channel,					\
+	.scan_type = {						\
+		.sign = 'u',					\
+		.realbits = 12,					\
+		.storagebits = 16,				\
+		.endianness = IIO_CPU,				\
+	},							\
 }
 
 static struct iio_map sun4i_gpadc_hwmon_maps[] = {
@@ -341,7 +368,9 @@ static const struct iio_chan_spec sun4i_gpadc_channels[] = {
 				      BIT(IIO_CHAN_INFO_SCALE) |
 				      BIT(IIO_CHAN_INFO_OFFSET),
 		.datasheet_name = "temp_adc",
+		.scan_index = -1,
 	},
+	IIO_CHAN_SOFT_TIMESTAMP(4),
 };
 
 static const struct iio_chan_spec sun4i_gpadc_channels_no_temp[] = {
@@ -349,6 +378,15 @@ static const struct iio_chan_spec sun4i_gpadc_channels_no_temp[] = {
 	SUN4I_GPADC_ADC_CHANNEL(1, "adc_chan1"),
 	SUN4I_GPADC_ADC_CHANNEL(2, "adc_chan2"),
 	SUN4I_GPADC_ADC_CHANNEL(3, "adc_chan3"),
+	IIO_CHAN_SOFT_TIMESTAMP(4),
+};
+
+/*
+ * The A10 and A13 select a single ADC input by number, so the buffer
+ * samples one channel at a time on every variant.
+ */
+static const unsigned long sun4i_gpadc_scan_masks[] = {
+	BIT(0), BIT(1), BIT(2), BIT(3), 0
 };
 
 static const struct iio_chan_spec sun8i_a33_gpadc_channels[] = {
@@ -432,6 +470,12 @@ static int sun4i_gpadc_read(struct iio_dev *indio_dev, int channel, int *val,
 
 	mutex_lock(&info->mutex);
 
+	/* the buffer keeps the ADC converting on its own channel */
+	if (info->buffered) {
+		mutex_unlock(&info->mutex);
+		return -EBUSY;
+	}
+
 	ret = sun4i_prepare_for_irq(indio_dev, channel, irq);
 	if (ret)
 		goto err;
@@ -516,13 +560,23 @@ static int sun4i_gpadc_temp_scale(struct iio_dev *indio_dev, int *val)
 	return 0;
 }
 
+static unsigned int sun4i_gpadc_rate(unsigned int fs_div)
+{
+	return SUN4I_GPADC_CLKIN >> (20 - fs_div);
+}
+
 static int sun4i_gpadc_read_raw(struct iio_dev *indio_dev,
 				struct iio_chan_spec const *chan, int *val,
 				int *val2, long mask)
 {
+	struct sun4i_gpadc_iio *info = iio_priv(indio_dev);
 	int ret;
 
 	switch (mask) {
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*val = sun4i_gpadc_rate(READ_ONCE(info->fs_div));
+
+		return IIO_VAL_INT;
 	case IIO_CHAN_INFO_OFFSET:
 		ret = sun4i_gpadc_temp_offset(indio_dev, val);
 		if (ret)
@@ -560,10 +614,167 @@ static int sun4i_gpadc_read_raw(struct iio_dev *indio_dev,
 	return -EINVAL;
 }
 
+static int sun4i_gpadc_write_raw(struct iio_dev *indio_dev,
+				 struct iio_chan_spec const *chan, int val,
+				 int val2, long mask)
+{
+	struct sun4i_gpadc_iio *info = iio_priv(indio_dev);
+	unsigned int fs_div;
+	int ret = 0;
+
+	if (mask != IIO_CHAN_INFO_SAMP_FREQ || val <= 0)
+		return -EINVAL;
+
+	/* the fastest rate not above the requested one */
+	for (fs_div = SUN4I_GPADC_FS_DIV_MAX; fs_div > 0; fs_div--)
+		if (sun4i_gpadc_rate(fs_div) <= val)
+			break;
+
+	mutex_lock(&info->mutex);
+	if (info->buffered)
+		ret = -EBUSY;
+	else
+		WRITE_ONCE(info->fs_div, fs_div);
+	mutex_unlock(&info->mutex);
+
+	return ret;
+}
+
 static const struct iio_info sun4i_gpadc_iio_info = {
 	.read_raw = sun4i_gpadc_read_raw,
+	.write_raw = sun4i_gpadc_write_raw,
+};
+
+static int sun4i_gpadc_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct sun4i_gpadc_iio *info = iio_priv(indio_dev);
+	unsigned int channel;
+	int ret;
+
+	channel = find_first_bit(indio_dev->active_scan_mask,
+				 indio_dev->masklength);
+
+	mutex_lock(&info->mutex);
+
+	ret = pm_runtime_resume_and_get(indio_dev->dev.parent);
+	if (ret)
+		goto err_unlock;
+
+	ret = regmap_write(info->regmap, SUN4I_GPADC_CTRL0,
+			   SUN4I_GPADC_CTRL0_ADC_CLK_DIVIDER(2) |
+			   SUN4I_GPADC_CTRL0_FS_DIV(info->fs_div) |
+			   SUNXI_THS_ACQ0(63));
+	if (ret)
+		goto err_put;
+
+	ret = regmap_write(info->regmap, SUN4I_GPADC_CTRL1,
+			   info->data->tp_mode_en |
+			   info->data->tp_adc_select |
+			   info->data->adc_chan_select(channel));
+	if (ret)
+		goto err_put;
+
+	info->buffered = true;
+	mutex_unlock(&info->mutex);
+
+	/*
+	 * Let the IP settle after the mode and channel change, then start
+	 * from an empty FIFO.
+	 */
+	msleep(100);
+
+	return regmap_update_bits(info->regmap, SUN4I_GPADC_INT_FIFOC,
+				  SUN4I_GPADC_INT_FIFOC_TP_FIFO_FLUSH,
+				  SUN4I_GPADC_INT_FIFOC_TP_FIFO_FLUSH);
+
+err_put:
+	pm_runtime_put_autosuspend(indio_dev->dev.parent);
+err_unlock:
+	mutex_unlock(&info->mutex);
+
+	return ret;
+}
+
+static int sun4i_gpadc_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct sun4i_gpadc_iio *info = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&info->mutex);
+
+	/* back to the configuration single reads expect */
+	ret = info->data->sample_start(info);
+	info->buffered = false;
+
+	pm_runtime_mark_last_busy(indio_dev->dev.parent);
+	pm_runtime_put_autosuspend(indio_dev->dev.parent);
+
+	mutex_unlock(&info->mutex);
+
+	return ret;
+}
+
+static const struct iio_buffer_setup_ops sun4i_gpadc_buffer_ops = {
+	.postenable = sun4i_gpadc_buffer_postenable,
+	.predisable = sun4i_gpadc_buffer_predisable,
 };
 
+/*
+ * The ADC converts continuously into its FIFO while the buffer is enabled,
+ * so each trigger drains every sample gathered since the previous one in a
+ * single burst. A slow trigger, such as an hrtimer at a few tens of Hz, can
+ * then capture at kHz rates. Sample timestamps are spread back from the
+ * trigger timestamp at the conversion period.
+ */
+static irqreturn_t sun4i_gpadc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct sun4i_gpadc_iio *info = iio_priv(indio_dev);
+	unsigned int status, count, i;
+	s64 period, timestamp;
+
+	if (regmap_read(info->regmap, SUN4I_GPADC_INT_FIFOS, &status))
+		goto out;
+
+	if (status & SUN4I_GPADC_INT_FIFOS_FIFO_OVERRUN_PENDING) {
+		/*
+		 * Samples were lost and the timestamps of those left cannot
+		 * be trusted, so start again from an empty FIFO.
+		 */
+		dev_dbg_ratelimited(&indio_dev->dev, "FIFO overrun\n");
+		regmap_write(info->regmap, SUN4I_GPADC_INT_FIFOS,
+			     SUN4I_GPADC_INT_FIFOS_FIFO_OVERRUN_PENDING);
+		regmap_update_bits(info->regmap, SUN4I_GPADC_INT_FIFOC,
+				   SUN4I_GPADC_INT_FIFOC_TP_FIFO_FLUSH,
+				   SUN4I_GPADC_INT_FIFOC_TP_FIFO_FLUSH);
+		goto out;
+	}
+
+	count = min_t(unsigned int, SUN4I_GPADC_INT_FIFOS_RXA_CNT(status),
+		      SUN4I_GPADC_FIFO_DEPTH);
+	if (!count)
+		goto out;
+
+	if (regmap_noinc_read(info->regmap, SUN4I_GPADC_DATA, info->fifo,
+			      count * sizeof(info->fifo[0])))
+		goto out;
+
+	period = NSEC_PER_SEC / sun4i_gpadc_rate(info->fs_div);
+	timestamp = pf->timestamp - (count - 1) * period;
+
+	for (i = 0; i < count; i++, timestamp += period) {
+		info->scan.data = info->fifo[i] & GENMASK(11, 0);
+		iio_push_to_buffers_with_timestamp(indio_dev, &info->scan,
+						   timestamp);
+	}
+
+out:
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static irqreturn_t sun4i_gpadc_temp_data_irq_handler(int irq, void *dev_id)
 {
 	struct sun4i_gpadc_iio *info = dev_id;
@@ -1008,6 +1219,17 @@ static int sun4i_gpadc_probe_mfd(struct platform_device *pdev,
 	if (ret < 0)
 		return ret;
 
+	info->fs_div = SUN4I_GPADC_FS_DIV_DEFAULT;
+	indio_dev->available_scan_masks = sun4i_gpadc_scan_masks;
+	ret = devm_iio_triggered_buffer_setup(&pdev->dev, indio_dev,
+					      iio_pollfunc_store_time,
+					      sun4i_gpadc_trigger_handler,
+					      &sun4i_gpadc_buffer_ops);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to set up triggered buffer\n");
+		return ret;
+	}
+
 	if (IS_ENABLED(CONFIG_THERMAL_OF)) {
 		ret = iio_map_array_register(indio_dev, sun4i_gpadc_hwmon_maps);
 		if (ret < 0) {
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LED trigger for block device activity
+ *
+ * Unlike the disk trigger, which is called from the I/O path for every
+ * request, this one polls the block device's I/O counters from a
+ * delayed work and blinks the LED once when they moved since the last
+ * poll. Nothing in the I/O path knows about the LED.
+ *
+ *  device_name	block device to watch, e.g. mmcblk0 or /dev/sda1
+ *  interval	blink on/off time and half the poll period, in ms
+ *  read, write	which kind of I/O makes the LED blink
+ */
+
+#include <linux/atomic.h>
+#include <linux/blkdev.h>
+#include <linux/device.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/leds.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/part_stat.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+
+#define BLKDEV_TRIG_NAME_MAX	64
+
+enum blkdev_trig_mode {
+	BLKDEV_TRIG_READ,
+	BLKDEV_TRIG_WRITE,
+};
+
+struct blkdev_trig_data {
+	struct mutex lock;
+	struct led_classdev *led_cdev;
+	struct block_device *bdev;
+	char device_name[BLKDEV_TRIG_NAME_MAX];
+	atomic_t interval;		/* in jiffies */
+	unsigned long last_ios;
+	unsigned long mode;
+	struct delayed_work work;
+};
+
+static unsigned long blkdev_trig_ios(struct blkdev_trig_data *data)
+{
+	unsigned long ios = 0;
+
+	if (test_bit(BLKDEV_TRIG_READ, &data->mode))
+		ios += part_stat_read(data->bdev, ios[STAT_READ]);
+	if (test_bit(BLKDEV_TRIG_WRITE, &data->mode)) {
+		ios += part_stat_read(data->bdev, ios[STAT_WRITE]);
+		ios += part_stat_read(data->bdev, ios[STAT_DISCARD]);
+		ios += part_stat_read(data->bdev, ios[STAT_FLUSH]);
+	}
+
+	return ios;
+}
+
+static void blkdev_trig_work(struct work_struct *work)
+{
+	struct blkdev_trig_data *data =
+		container_of(work, struct blkdev_trig_data, work.work);
+	unsigned long interval = atomic_read(&data->interval);
+	unsigned long ios = blkdev_trig_ios(data);
+
+	if (ios != data->last_ios) {
+		unsigned long delay = jiffies_to_msecs(interval);
+
+		data->last_ios = ios;
+		led_blink_set_oneshot(data->led_cdev, &delay, &delay, 0);
+	}
+
+	schedule_delayed_work(&data->work, interval * 2);
+}
+
+/* Called with data->lock held */
+static void blkdev_trig_restart(struct blkdev_trig_data *data)
+{
+	cancel_delayed_work_sync(&data->work);
+	led_set_brightness(data->led_cdev, LED_OFF);
+
+	if (!data->bdev)
+		return;
+
+	data->last_ios = blkdev_trig_ios(data);
+	schedule_delayed_work(&data->work, 0);
+}
+
+static ssize_t device_name_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+	ssize_t len;
+
+	mutex_lock(&data->lock);
+	len = sprintf(buf, "%s\n", data->device_name);
+	mutex_unlock(&data->lock);
+
+	return len;
+}
+
+static ssize_t device_name_store(struct device *dev,
+				 struct device_attribute *attr, const char *buf,
+				 size_t size)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+	char name[BLKDEV_TRIG_NAME_MAX];
+	char path[BLKDEV_TRIG_NAME_MAX + 5];
+	struct block_device *bdev = NULL;
+
+	if (size >= BLKDEV_TRIG_NAME_MAX)
+		return -EINVAL;
+
+	strscpy(name, buf, size + 1);
+	strim(name);
+
+	if (name[0]) {
+		snprintf(path, sizeof(path), "%s%s",
+			 name[0] == '/' ? "" : "/dev/", name);
+		bdev = blkdev_get_by_path(path, FMODE_READ, NULL);
+		if (IS_ERR(bdev))
+			return PTR_ERR(bdev);
+	}
+
+	mutex_lock(&data->lock);
+	cancel_delayed_work_sync(&data->work);
+	if (data->bdev)
+		blkdev_put(data->bdev, FMODE_READ);
+	data->bdev = bdev;
+	strscpy(data->device_name, name, sizeof(data->device_name));
+	blkdev_trig_restart(data);
+	mutex_unlock(&data->lock);
+
+	return size;
+}
+
+static DEVICE_ATTR_RW(device_name);
+
+static ssize_t blkdev_trig_mode_show(struct device *dev, char *buf,
+				     enum blkdev_trig_mode mode)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", test_bit(mode, &data->mode));
+}
+
+static ssize_t blkdev_trig_mode_store(struct device *dev, const char *buf,
+				      size_t size, enum blkdev_trig_mode mode)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+	bool state;
+	int ret;
+
+	ret = kstrtobool(buf, &state);
+	if (ret)
+		return ret;
+
+	mutex_lock(&data->lock);
+	if (state)
+		set_bit(mode, &data->mode);
+	else
+		clear_bit(mode, &data->mode);
+	blkdev_trig_restart(data);
+	mutex_unlock(&data->lock);
+
+	return size;
+}
+
+static ssize_t read_show(struct device *dev,
+			 struct device_attribute *attr, char *buf)
+{
+	return blkdev_trig_mode_show(dev, buf, BLKDEV_TRIG_READ);
+}
+
+static ssize_t read_store(struct device *dev,
+			  struct device_attribute *attr, const char *buf,
+			  size_t size)
+{
+	return blkdev_trig_mode_store(dev, buf, size, BLKDEV_TRIG_READ);
+}
+
+static DEVICE_ATTR_RW(read);
+
+static ssize_t write_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	return blkdev_trig_mode_show(dev, buf, BLKDEV_TRIG_WRITE);
+}
+
+static ssize_t write_store(struct device *dev,
+			   struct device_attribute *attr, const char *buf,
+			   size_t size)
+{
+	return blkdev_trig_mode_store(dev, buf, size, BLKDEV_TRIG_WRITE);
+}
+
+static DEVICE_ATTR_RW(write);
+
+static ssize_t interval_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n",
+		       jiffies_to_msecs(atomic_read(&data->interval)));
+}
+
+static ssize_t interval_store(struct device *dev,
+			      struct device_attribute *attr, const char *buf,
+			      size_t size)
+{
+	struct blkdev_trig_data *data = led_trigger_get_drvdata(dev);
+	unsigned long value;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &value);
+	if (ret)
+		return ret;
+
+	/* impose some basic bounds on the timer interval */
+	if (value < 5 || value > 10000)
+		return -EINVAL;
+
+	mutex_lock(&data->lock);
+	atomic_set(&data->interval, msecs_to_jiffies(value));
+	blkdev_trig_restart(data);
+	mutex_unlock(&data->lock);
+
+	return size;
+}
+
+static DEVICE_ATTR_RW(interval);
+
+static struct attribute *blkdev_trig_attrs[] = {
+	&dev_attr_device_name.attr,
+	&dev_attr_read.attr,
+	&dev_attr_write.attr,
+	&dev_attr_interval.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(blkdev_trig);
+
+static int blkdev_trig_activate(struct led_classdev *led_cdev)
+{
+	struct blkdev_trig_data *data;
+
+	data = kzalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	mutex_init(&data->lock);
+	INIT_DELAYED_WORK(&data->work, blkdev_trig_work);
+	data->led_cdev = led_cdev;
+	atomic_set(&data->interval, msecs_to_jiffies(50));
+	set_bit(BLKDEV_TRIG_READ, &data->mode);
+	set_bit(BLKDEV_TRIG_WRITE, &data->mode);
+
+	led_set_trigger_data(led_cdev, data);
+
+	return 0;
+}
+
+static void blkdev_trig_deactivate(struct led_classdev *led_cdev)
+{
+	struct blkdev_trig_data *data = led_get_trigger_data(led_cdev);
+
+	cancel_delayed_work_sync(&data->work);
+	if (data->bdev)
+		blkdev_put(data->bdev, FMODE_READ);
+
+	kfree(data);
+}
+
+static struct led_trigger blkdev_led_trigger = {
+	.name = "blkdev",
+	.activate = blkdev_trig_activate,
+	.deactivate = blkdev_trig_deactivate,
+	.groups = blkdev_trig_groups,
+};
+
+module_led_trigger(blkdev_led_trigger);
+
+MODULE_DESCRIPTION("Block device activity LED trigger, polled");
+MODULE_LICENSE("GPL");
@@ -550,6 +550,111 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
 }
 
+/*
+ * Handle a data block whose digest (in verity_io_real_digest()) does not
+ * match verity_io_want_digest(): reread it, try FEC, then apply the error
+ * mode.  Returns 0 if the data may be used.
+ */
+static int verity_handle_data_hash_mismatch(struct dm_verity *v,
+					    struct dm_verity_io *io,
+					    struct bio *bio, sector_t blkno,
+					    struct bvec_iter start)
+{
+	if (static_branch_unlikely(&use_tasklet_enabled) && io->in_tasklet) {
+		/*
+		 * Error handling code (FEC included) cannot be run in a
+		 * tasklet since it may sleep, so fallback to work-queue.
+		 */
+		return -EAGAIN;
+	}
+
+	if (verity_recheck(v, io, start, blkno) == 0) {
+		if (v->validated_blocks)
+			set_bit(blkno, v->validated_blocks);
+		return 0;
+	}
+
+#if defined(CONFIG_DM_VERITY_FEC)
+	if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA, blkno,
+			      NULL, &start) == 0)
+		return 0;
+#endif
+
+	if (bio->bi_status) {
+		/*
+		 * Error correction failed; Just return error
+		 */
+		return -EIO;
+	}
+
+	if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA, blkno))
+		return -EIO;
+
+	return 0;
+}
+
+struct verity_mb_block {
+	sector_t blkno;
+	struct bvec_iter start;
+	struct bio_vec bv;
+};
+
+/*
+ * Hash a batch of data blocks, each contained in one page, with a single
+ * crypto_shash_finup_mb() call and check them against the wanted digests
+ * already stored with verity_io_mb_digest().
+ */
+static int verity_verify_mb(struct dm_verity *v, struct dm_verity_io *io,
+			    struct bio *bio, struct verity_mb_block *blocks,
+			    unsigned int n)
+{
+	const u8 *data[DM_VERITY_MAX_MB_MSGS];
+	u8 *outs[DM_VERITY_MAX_MB_MSGS];
+	SHASH_DESC_ON_STACK(desc, v->mb_tfm);
+	unsigned int i;
+	int r;
+
+	desc->tfm = v->mb_tfm;
+	memcpy(shash_desc_ctx(desc), v->mb_state,
+	       crypto_shash_descsize(v->mb_tfm));
+
+	for (i = 0; i < n; i++) {
+		data[i] = bvec_kmap_local(&blocks[i].bv);
+		outs[i] = verity_io_mb_digest(v, io, i, true);
+	}
+
+	r = crypto_shash_finup_mb(desc, data, 1 << v->data_dev_block_bits,
+				  outs, n);
+
+	while (i--)
+		kunmap_local(data[i]);
+
+	if (unlikely(r < 0)) {
+		DMERR("verity_verify_mb crypto op failed: %d", r);
+		return r;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (likely(memcmp(outs[i], verity_io_mb_digest(v, io, i, false),
+				  v->digest_size) == 0)) {
+			if (v->validated_blocks)
+				set_bit(blocks[i].blkno, v->validated_blocks);
+			continue;
+		}
+
+		memcpy(verity_io_want_digest(v, io),
+		       verity_io_mb_digest(v, io, i, false), v->digest_size);
+		memcpy(verity_io_real_digest(v, io), outs[i], v->digest_size);
+		r = verity_handle_data_hash_mismatch(v, io, bio,
+						     blocks[i].blkno,
+						     blocks[i].start);
+		if (unlikely(r))
+			return r;
+	}
+
+	return 0;
+}
+
 /*
  * Verify one "dm_verity_io" structure.
  */
@@ -562,7 +667,9 @@ static int verity_verify_io(struct dm_verity_io *io)
 	struct bvec_iter *iter;
 	struct crypto_wait wait;
 	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
-	unsigned int b;
+	struct verity_mb_block mb[DM_VERITY_MAX_MB_MSGS];
+	unsigned int block_size = 1 << v->data_dev_block_bits;
+	unsigned int b, n_mb = 0;
 
 	if (static_branch_unlikely(&use_tasklet_enabled) && io->in_tasklet) {
 		/*
@@ -586,6 +693,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 		}
 
 		r = verity_hash_for_block(v, io, cur_block,
+					  v->mb_tfm ?
+					  verity_io_mb_digest(v, io, n_mb, false) :
 					  verity_io_want_digest(v, io),
 					  &is_zero);
 		if (unlikely(r < 0))
@@ -604,6 +713,31 @@ static int verity_verify_io(struct dm_verity_io *io)
 			continue;
 		}
 
+		if (v->mb_tfm) {
+			struct bio_vec bv = bio_iter_iovec(bio, *iter);
+
+			if (likely(bv.bv_len >= block_size)) {
+				bv.bv_len = block_size;
+				mb[n_mb].blkno = cur_block;
+				mb[n_mb].start = *iter;
+				mb[n_mb].bv = bv;
+				verity_bv_skip_block(v, io, iter);
+
+				if (++n_mb == v->mb_max_msgs) {
+					r = verity_verify_mb(v, io, bio, mb, n_mb);
+					if (unlikely(r))
+						return r;
+					n_mb = 0;
+				}
+				continue;
+			}
+
+			/* block straddles pages, hash it on its own */
+			memcpy(verity_io_want_digest(v, io),
+			       verity_io_mb_digest(v, io, n_mb, false),
+			       v->digest_size);
+		}
+
 		r = verity_hash_init(v, req, &wait, !io->in_tasklet);
 		if (unlikely(r < 0))
 			return r;
@@ -623,35 +757,17 @@ static int verity_verify_io(struct dm_verity_io *io)
 			if (v->validated_blocks)
 				set_bit(cur_block, v->validated_blocks);
 			continue;
-		} else if (static_branch_unlikely(&use_tasklet_enabled) &&
-			   io->in_tasklet) {
-			/*
-			 * Error handling code (FEC included) cannot be run in a
-			 * tasklet since it may sleep, so fallback to work-queue.
-			 */
-			return -EAGAIN;
-		} else if (verity_recheck(v, io, start, cur_block) == 0) {
-			if (v->validated_blocks)
-				set_bit(cur_block, v->validated_blocks);
-			continue;
-#if defined(CONFIG_DM_VERITY_FEC)
-		} else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
-					     cur_block, NULL, &start) == 0) {
-			continue;
-#endif
-		} else {
-			if (bio->bi_status) {
-				/*
-				 * Error correction failed; Just return error
-				 */
-				return -EIO;
-			}
-			if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA,
-					      cur_block))
-				return -EIO;
 		}
+
+		r = verity_handle_data_hash_mismatch(v, io, bio, cur_block,
+						     start);
+		if (unlikely(r))
+			return r;
 	}
 
+	if (n_mb)
+		return verity_verify_mb(v, io, bio, mb, n_mb);
+
 	return 0;
 }
 
@@ -999,6 +1115,9 @@ static void verity_dtr(struct dm_target *ti)
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
 
+	kfree_sensitive(v->mb_state);
+	crypto_free_shash(v->mb_tfm);
+
 	kfree(v->alg_name);
 
 	if (v->hash_dev)
@@ -1069,6 +1188,59 @@ out:
 	return r;
 }
 
+/*
+ * If the hash is also available as a synchronous shash that can hash
+ * several messages at once, use it to verify data blocks in batches.  Only
+ * for format version 1 and later, where the salt comes first and so can be
+ * hashed once up front.
+ */
+static int verity_setup_mb(struct dm_verity *v)
+{
+	struct crypto_shash *tfm;
+	int r;
+
+	if (!v->version)
+		return 0;
+
+	tfm = crypto_alloc_shash(crypto_ahash_driver_name(v->tfm), 0, 0);
+	if (IS_ERR(tfm))
+		return 0;
+
+	if (crypto_shash_mb_max_msgs(tfm) < 2) {
+		crypto_free_shash(tfm);
+		return 0;
+	}
+
+	v->mb_state = kmalloc(crypto_shash_descsize(tfm), GFP_KERNEL);
+	if (!v->mb_state) {
+		crypto_free_shash(tfm);
+		return -ENOMEM;
+	}
+
+	{
+		SHASH_DESC_ON_STACK(desc, tfm);
+
+		desc->tfm = tfm;
+		r = crypto_shash_init(desc) ?:
+		    crypto_shash_update(desc, v->salt, v->salt_size);
+		memcpy(v->mb_state, shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		shash_desc_zero(desc);
+	}
+	if (r) {
+		crypto_free_shash(tfm);
+		return r;
+	}
+
+	v->mb_tfm = tfm;
+	v->mb_max_msgs = min_t(unsigned int, crypto_shash_mb_max_msgs(tfm),
+			       DM_VERITY_MAX_MB_MSGS);
+	DMINFO("%s verifying up to %u blocks at once", v->alg_name,
+	       v->mb_max_msgs);
+
+	return 0;
+}
+
 static inline bool verity_is_verity_mode(const char *arg_name)
 {
 	return (!strcasecmp(arg_name, DM_VERITY_OPT_LOGGING) ||
@@ -1474,8 +1646,17 @@ static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	r = verity_setup_mb(v);
+	if (r) {
+		ti->error = "Cannot set up batched hashing";
+		goto bad;
+	}
+
 	ti->per_io_data_size = sizeof(struct dm_verity_io) +
 				v->ahash_reqsize + v->digest_size * 2;
+	if (v->mb_tfm)
+		ti->per_io_data_size += v->digest_size * 2 *
+					DM_VERITY_MAX_MB_MSGS;
 
 	r = verity_fec_ctr(v);
 	if (r)
@@ -40,6 +40,8 @@ struct dm_verity {
 	struct dm_bufio_client *bufio;
 	char *alg_name;
 	struct crypto_ahash *tfm;
+	struct crypto_shash *mb_tfm;	/* tfm hashing several blocks at once */
+	u8 *mb_state;		/* mb_tfm state after hashing the salt */
 	u8 *root_digest;	/* digest of the root block */
 	u8 *salt;		/* salt: its size is salt_size */
 	u8 *zero_digest;	/* digest for a zero block */
@@ -57,6 +59,7 @@ struct dm_verity {
 	bool use_tasklet:1;	/* try to verify in tasklet before work-queue */
 	unsigned int digest_size;	/* digest size for the current hash algorithm */
 	unsigned int ahash_reqsize;/* the size of temporary space for crypto */
+	unsigned int mb_max_msgs;	/* data blocks hashed per mb_tfm call */
 	enum verity_mode mode;	/* mode for handling verification errors */
 	unsigned int corrupted_errs;/* Number of errors for corrupted blocks */
 
@@ -99,6 +102,9 @@ struct dm_verity_io {
 	 *
 	 * To access them use: verity_io_hash_req(), verity_io_real_digest()
 	 * and verity_io_want_digest().
+	 *
+	 * If v->mb_tfm is set, they are followed by the wanted and real
+	 * digests of a batch, see verity_io_mb_digest().
 	 */
 };
 
@@ -120,6 +126,16 @@ static inline u8 *verity_io_want_digest(struct dm_verity *v,
 	return (u8 *)(io + 1) + v->ahash_reqsize + v->digest_size;
 }
 
+#define DM_VERITY_MAX_MB_MSGS	4
+
+static inline u8 *verity_io_mb_digest(struct dm_verity *v,
+				      struct dm_verity_io *io,
+				      unsigned int i, bool real)
+{
+	return verity_io_want_digest(v, io) +
+	       (1 + i + (real ? DM_VERITY_MAX_MB_MSGS : 0)) * v->digest_size;
+}
+
 extern int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
 			       struct bvec_iter *iter,
 			       int (*process)(struct dm_verity *v,
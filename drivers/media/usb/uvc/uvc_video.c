@@ -991,6 +991,16 @@ size_t uvc_video_stats_dump(struct uvc_streaming *stream, char *buf,
 			   stream->stats.stream.min_sof,
 			   stream->stats.stream.max_sof,
 			   scr_sof_freq / 1000, scr_sof_freq % 1000);
+	count += scnprintf(buf + count, size - count,
+			   "dropped: %u\noverflow: %u\n",
+			   stream->stats.stream.nb_dropped,
+			   stream->stats.stream.nb_overflow);
+	count += scnprintf(buf + count, size - count,
+			   "decode: %u URBs, %llu us total, %llu us max\n",
+			   stream->stats.stream.nb_urbs,
+			   div_u64(stream->stats.stream.decode_ns, NSEC_PER_USEC),
+			   div_u64(stream->stats.stream.max_decode_ns,
+				   NSEC_PER_USEC));
 
 	return count;
 }
@@ -1082,6 +1092,7 @@ static int uvc_video_decode_start(struct uvc_streaming *stream,
 	 * NULL.
 	 */
 	if (buf == NULL) {
+		stream->stats.stream.nb_dropped++;
 		stream->last_fid = fid;
 		return -ENODATA;
 	}
@@ -1224,6 +1235,7 @@ static void uvc_video_decode_data(struct uvc_urb *uvc_urb,
 	if (len > maxlen) {
 		uvc_dbg(uvc_urb->stream->dev, FRAME,
 			"Frame complete (overflow)\n");
+		uvc_urb->stream->stats.stream.nb_overflow++;
 		buf->error = 1;
 		buf->state = UVC_BUF_STATE_READY;
 	}
@@ -1582,6 +1594,7 @@ static void uvc_video_complete(struct urb *urb)
 	struct uvc_buffer *buf = NULL;
 	struct uvc_buffer *buf_meta = NULL;
 	unsigned long flags;
+	u64 start, delta;
 	int ret;
 
 	switch (urb->status) {
@@ -1628,7 +1641,14 @@ static void uvc_video_complete(struct urb *urb)
 	 * Process the URB headers, and optionally queue expensive memcpy tasks
 	 * to be deferred to a work queue.
 	 */
+	start = ktime_get_ns();
 	stream->decode(uvc_urb, buf, buf_meta);
+	delta = ktime_get_ns() - start;
+
+	stream->stats.stream.nb_urbs++;
+	stream->stats.stream.decode_ns += delta;
+	if (delta > stream->stats.stream.max_decode_ns)
+		stream->stats.stream.max_decode_ns = delta;
 
 	/* If no async work is needed, resubmit the URB immediately. */
 	if (!uvc_urb->async_operations) {
@@ -1663,6 +1683,7 @@ static void uvc_free_urb_buffers(struct uvc_streaming *stream)
 	}
 
 	stream->urb_size = 0;
+	stream->nr_urbs = 0;
 }
 
 static bool uvc_alloc_urb_buffer(struct uvc_streaming *stream,
@@ -1704,6 +1725,7 @@ static bool uvc_alloc_urb_buffer(struct uvc_streaming *stream,
 static int uvc_alloc_urb_buffers(struct uvc_streaming *stream,
 	unsigned int size, unsigned int psize, gfp_t gfp_flags)
 {
+	unsigned int nr_urbs;
 	unsigned int npackets;
 	unsigned int i;
 
@@ -1711,6 +1733,9 @@ static int uvc_alloc_urb_buffers(struct uvc_streaming *stream,
 	if (stream->urb_size)
 		return stream->urb_size / psize;
 
+	nr_urbs = clamp_t(unsigned int, READ_ONCE(uvc_urbs_param), 2,
+			  UVC_MAX_URBS);
+
 	/*
 	 * Compute the number of packets. Bulk endpoints might transfer UVC
 	 * payloads across multiple URBs.
@@ -1722,8 +1747,9 @@ static int uvc_alloc_urb_buffers(struct uvc_streaming *stream,
 	/* Retry allocations until one succeed. */
 	for (; npackets > 1; npackets /= 2) {
 		stream->urb_size = psize * npackets;
+		stream->nr_urbs = nr_urbs;
 
-		for (i = 0; i < UVC_URBS; ++i) {
+		for (i = 0; i < nr_urbs; ++i) {
 			struct uvc_urb *uvc_urb = &stream->uvc_urb[i];
 
 			if (!uvc_alloc_urb_buffer(stream, uvc_urb, gfp_flags)) {
@@ -1734,10 +1760,10 @@ static int uvc_alloc_urb_buffers(struct uvc_streaming *stream,
 			uvc_urb->stream = stream;
 		}
 
-		if (i == UVC_URBS) {
+		if (i == nr_urbs) {
 			uvc_dbg(stream->dev, VIDEO,
 				"Allocated %u URB buffers of %ux%u bytes each\n",
-				UVC_URBS, npackets, psize);
+				nr_urbs, npackets, psize);
 			return npackets;
 		}
 	}
@@ -47,8 +47,9 @@
 
 #define DRIVER_VERSION		"1.1.1"
 
-/* Number of isochronous URBs. */
+/* Default and maximum number of isochronous/bulk URBs. */
 #define UVC_URBS		5
+#define UVC_MAX_URBS		16
 /* Maximum number of packets per URB. */
 #define UVC_MAX_PACKETS		32
 /* Maximum status buffer size in bytes of interrupt URB. */
@@ -380,6 +381,12 @@ struct uvc_stats_stream {
 	unsigned int scr_sof;		/* STC.SOF of the last packet */
 	unsigned int min_sof;		/* Minimum STC.SOF value */
 	unsigned int max_sof;		/* Maximum STC.SOF value */
+
+	unsigned int nb_dropped;	/* Number of payloads without a buffer */
+	unsigned int nb_overflow;	/* Number of payloads truncated by a full buffer */
+	unsigned int nb_urbs;		/* Number of completed URBs */
+	u64 decode_ns;			/* Time spent decoding completed URBs */
+	u64 max_decode_ns;		/* Longest decode of a single URB */
 };
 
 #define UVC_METADATA_BUF_SIZE 10240
@@ -474,7 +481,8 @@ struct uvc_streaming {
 		u32 max_payload_size;
 	} bulk;
 
-	struct uvc_urb uvc_urb[UVC_URBS];
+	struct uvc_urb uvc_urb[UVC_MAX_URBS];
+	unsigned int nr_urbs;
 	unsigned int urb_size;
 
 	u32 sequence;
@@ -511,7 +519,7 @@ struct uvc_streaming {
 
 #define for_each_uvc_urb(uvc_urb, uvc_streaming) \
 	for ((uvc_urb) = &(uvc_streaming)->uvc_urb[0]; \
-	     (uvc_urb) < &(uvc_streaming)->uvc_urb[UVC_URBS]; \
+	     (uvc_urb) < &(uvc_streaming)->uvc_urb[(uvc_streaming)->nr_urbs]; \
 	     ++(uvc_urb))
 
 static inline u32 uvc_urb_index(const struct uvc_urb *uvc_urb)
@@ -613,6 +621,7 @@ struct uvc_driver {
 
 extern unsigned int uvc_clock_param;
 extern unsigned int uvc_no_drop_param;
+extern unsigned int uvc_urbs_param;
 extern unsigned int uvc_dbg_param;
 extern unsigned int uvc_timeout_param;
 extern unsigned int uvc_hw_timestamps_param;
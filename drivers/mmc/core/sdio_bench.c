@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *  linux/drivers/mmc/core/sdio_bench.c
+ *
+ *  Raw SDIO read benchmark shared by the debug files of SDIO function
+ *  drivers. Writing "<size> <count>" to the file times <count> reads of
+ *  <size> bytes done by the driver's read callback; reading it lists the
+ *  last runs, one per line:
+ *
+ *  size count errors total_us kB/s lat_min_us lat_avg_us lat_max_us
+ *
+ *  The transfers run in the writing task, so its CPU time, e.g. from
+ *  getrusage() once the writer exits, is the host CPU cost of the run.
+ */
+
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mmc/sdio_bench.h>
+#include <linux/sched/signal.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+/**
+ *	sdio_bench_init - set up a benchmark for a driver
+ *	@bench: benchmark state, embedded in the driver's private data
+ *	@read: does one transfer, returns 0 on success
+ *	@max_size: largest transfer the driver can do in one go
+ *	@size_align: transfer sizes must be a multiple of this
+ */
+void sdio_bench_init(struct sdio_bench *bench,
+		     int (*read)(struct sdio_bench *bench, void *buf, u32 size),
+		     u32 max_size, u32 size_align)
+{
+	memset(bench, 0, sizeof(*bench));
+	bench->read = read;
+	bench->max_size = max_size;
+	bench->size_align = size_align ?: 1;
+	mutex_init(&bench->lock);
+}
+EXPORT_SYMBOL_GPL(sdio_bench_init);
+
+static int sdio_bench_run(struct sdio_bench *bench,
+			  struct sdio_bench_result *res)
+{
+	ktime_t start, t0;
+	void *buf;
+	u64 lat;
+	u32 i;
+
+	buf = kmalloc(res->size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	res->lat_min_ns = U64_MAX;
+	start = ktime_get();
+	for (i = 0; i < res->count; i++) {
+		t0 = ktime_get();
+		if (bench->read(bench, buf, res->size))
+			res->errors++;
+		lat = ktime_to_ns(ktime_sub(ktime_get(), t0));
+
+		res->lat_min_ns = min(res->lat_min_ns, lat);
+		res->lat_max_ns = max(res->lat_max_ns, lat);
+
+		if (fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+	res->count = i;
+	res->total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kfree(buf);
+	return 0;
+}
+
+/**
+ *	sdio_bench_write - parse "<size> <count>" and run the benchmark
+ *	@bench: benchmark state
+ *	@ubuf: user buffer written to the debug file
+ *	@count: length of @ubuf
+ *
+ *	The caller checks that the device can do I/O. Returns @count, or a
+ *	negative error code.
+ */
+ssize_t sdio_bench_write(struct sdio_bench *bench, const char __user *ubuf,
+			 size_t count)
+{
+	struct sdio_bench_result res = { };
+	char buf[32];
+	int ret;
+
+	if (!count || count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%u %u", &res.size, &res.count) != 2 ||
+	    !res.size || res.size > bench->max_size ||
+	    res.size % bench->size_align ||
+	    !res.count || res.count > SDIO_BENCH_MAX_COUNT)
+		return -EINVAL;
+
+	mutex_lock(&bench->lock);
+	ret = sdio_bench_run(bench, &res);
+	if (!ret) {
+		bench->runs[bench->nr_runs % SDIO_BENCH_RUNS] = res;
+		bench->nr_runs++;
+	}
+	mutex_unlock(&bench->lock);
+
+	return ret ? ret : count;
+}
+EXPORT_SYMBOL_GPL(sdio_bench_write);
+
+/**
+ *	sdio_bench_show - list the last runs
+ *	@m: seq_file of the debug file
+ *	@bench: benchmark state
+ */
+void sdio_bench_show(struct seq_file *m, struct sdio_bench *bench)
+{
+	struct sdio_bench_result *r;
+	unsigned int i, first;
+	u64 total;
+
+	seq_puts(m, "size count errors total_us kB/s lat_min_us lat_avg_us lat_max_us\n");
+
+	mutex_lock(&bench->lock);
+	first = bench->nr_runs > SDIO_BENCH_RUNS ?
+		bench->nr_runs - SDIO_BENCH_RUNS : 0;
+	for (i = first; i < bench->nr_runs; i++) {
+		r = &bench->runs[i % SDIO_BENCH_RUNS];
+		if (!r->count)
+			continue;
+		total = max_t(u64, r->total_ns, 1);
+
+		seq_printf(m, "%u %u %u %llu %llu %llu %llu %llu\n",
+			   r->size, r->count, r->errors,
+			   div_u64(total, NSEC_PER_USEC),
+			   div64_u64((u64)r->size * r->count * NSEC_PER_SEC,
+				     total * 1024),
+			   div_u64(r->lat_min_ns, NSEC_PER_USEC),
+			   div_u64(div_u64(total, r->count), NSEC_PER_USEC),
+			   div_u64(r->lat_max_ns, NSEC_PER_USEC));
+	}
+	mutex_unlock(&bench->lock);
+}
+EXPORT_SYMBOL_GPL(sdio_bench_show);
@@ -11,6 +11,7 @@
 
 #include <linux/clk.h>
 #include <linux/clk/sunxi-ng.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
@@ -18,6 +19,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/mmc/card.h>
 #include <linux/mmc/core.h>
 #include <linux/mmc/host.h>
@@ -35,6 +37,7 @@
 #include <linux/reset.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/soc/sunxi/sunxi_mbus.h>
 #include <linux/spinlock.h>
 
 /* register offset definitions */
@@ -243,6 +246,33 @@ struct sunxi_idma_des {
 	__le32 buf_addr_ptr2;
 };
 
+/*
+ * The descriptor memory holds two chains, so pre_req can build the chain
+ * of the next request while the IDMAC walks the chain of the current one.
+ * A slot has room for 1024 descriptors, enough for a max_blk_count
+ * request made of single pages.
+ */
+#define SUNXI_MMC_DES_SLOTS	2
+#define SUNXI_MMC_DES_SLOT_SIZE	(1024 * sizeof(struct sunxi_idma_des))
+
+/*
+ * SDIO transfers of at most sdio_poll_bytes are completed by polling the
+ * raw interrupt status from the request path, for up to
+ * SUNXI_MMC_POLL_US, before falling back to the interrupt.
+ */
+static unsigned int sdio_poll_bytes;
+module_param(sdio_poll_bytes, uint, 0644);
+MODULE_PARM_DESC(sdio_poll_bytes, "Poll for completion of SDIO transfers up to this size (0 = never)");
+
+#define SUNXI_MMC_POLL_US	200
+
+/* data->host_cookie: who mapped the scatterlist */
+enum sunxi_mmc_cookie {
+	COOKIE_UNMAPPED,
+	COOKIE_MAPPED,		/* mapped by sunxi_mmc_request() */
+	COOKIE_PRE_MAPPED,	/* mapped by sunxi_mmc_pre_req() */
+};
+
 struct sunxi_mmc_cfg {
 	u32 idma_des_size_bits;
 	u32 idma_des_shift;
@@ -286,11 +316,22 @@ struct sunxi_mmc_host {
 	int		irq;
 	u32		int_sum;
 	u32		sdio_imask;
+	u32		req_imask;	/* interrupts the request waits for */
+	bool		poll;		/* request completed by polling */
 
 	/* dma */
 	dma_addr_t	sg_dma;
 	void		*sg_cpu;
 	bool		wait_dma;
+	int		idma_slot;	/* chain used by the last transfer */
+	struct mmc_data	*pre_data;	/* built ahead in the other slot */
+	int		des_last[SUNXI_MMC_DES_SLOTS]; /* unlinked descriptor */
+
+	/* statistics, exported through debugfs */
+	u64		stat_reqs;
+	u64		stat_bytes;
+	u64		stat_descs;
+	u32		stat_max_descs;
 
 	struct mmc_request *mrq;
 	struct mmc_request *manual_stop_mrq;
@@ -301,6 +342,9 @@ struct sunxi_mmc_host {
 
 	/* timings */
 	bool		use_new_timings;
+
+	/* DRAM bandwidth the bus can move at the current clock */
+	struct sunxi_mbus_bw_req bw_req;
 };
 
 static int sunxi_mmc_reset_host(struct sunxi_mmc_host *host)
@@ -356,13 +400,45 @@ static int sunxi_mmc_init_host(struct sunxi_mmc_host *host)
 	return 0;
 }
 
-static void sunxi_mmc_init_idma_des(struct sunxi_mmc_host *host,
-				    struct mmc_data *data)
+/*
+ * Link every descriptor of each slot to the one after it once, so that
+ * building a chain only has to fill in the buffers and unlink its last
+ * descriptor.
+ */
+static void sunxi_mmc_link_idma_des(struct sunxi_mmc_host *host)
 {
-	struct sunxi_idma_des *pdes = (struct sunxi_idma_des *)host->sg_cpu;
+	int n = SUNXI_MMC_DES_SLOT_SIZE / sizeof(struct sunxi_idma_des);
+	struct sunxi_idma_des *pdes = host->sg_cpu;
 	dma_addr_t next_desc = host->sg_dma;
+	int i, slot;
+
+	for (slot = 0; slot < SUNXI_MMC_DES_SLOTS; slot++) {
+		for (i = 0; i < n; i++, pdes++) {
+			next_desc += sizeof(struct sunxi_idma_des);
+			pdes->buf_addr_ptr2 =
+				cpu_to_le32(next_desc >>
+					    host->cfg->idma_des_shift);
+		}
+		host->des_last[slot] = -1;
+	}
+}
+
+static void sunxi_mmc_init_idma_des(struct sunxi_mmc_host *host,
+				    struct mmc_data *data, int slot)
+{
+	struct sunxi_idma_des *pdes = host->sg_cpu +
+				      slot * SUNXI_MMC_DES_SLOT_SIZE;
+	dma_addr_t next_desc = host->sg_dma + slot * SUNXI_MMC_DES_SLOT_SIZE;
 	int i, max_len = (1 << host->cfg->idma_des_size_bits);
 
+	/* Relink the descriptor the previous chain in this slot ended on */
+	i = host->des_last[slot];
+	if (i >= 0) {
+		next_desc += (i + 1) * sizeof(struct sunxi_idma_des);
+		pdes[i].buf_addr_ptr2 =
+			cpu_to_le32(next_desc >> host->cfg->idma_des_shift);
+	}
+
 	for (i = 0; i < data->sg_len; i++) {
 		pdes[i].config = cpu_to_le32(SDXC_IDMAC_DES0_CH |
 					     SDXC_IDMAC_DES0_OWN |
@@ -373,13 +449,9 @@ static void sunxi_mmc_init_idma_des(struct sunxi_mmc_host *host,
 		else
 			pdes[i].buf_size = cpu_to_le32(data->sg[i].length);
 
-		next_desc += sizeof(struct sunxi_idma_des);
 		pdes[i].buf_addr_ptr1 =
 			cpu_to_le32(sg_dma_address(&data->sg[i]) >>
 				    host->cfg->idma_des_shift);
-		pdes[i].buf_addr_ptr2 =
-			cpu_to_le32(next_desc >>
-				    host->cfg->idma_des_shift);
 	}
 
 	pdes[0].config |= cpu_to_le32(SDXC_IDMAC_DES0_FD);
@@ -387,6 +459,7 @@ static void sunxi_mmc_init_idma_des(struct sunxi_mmc_host *host,
 					  SDXC_IDMAC_DES0_ER);
 	pdes[i - 1].config &= cpu_to_le32(~SDXC_IDMAC_DES0_DIC);
 	pdes[i - 1].buf_addr_ptr2 = 0;
+	host->des_last[slot] = i - 1;
 
 	/*
 	 * Avoid the io-store starting the idmac hitting io-mem before the
@@ -413,6 +486,8 @@ static int sunxi_mmc_map_dma(struct sunxi_mmc_host *host,
 			dev_err(mmc_dev(host->mmc),
 				"unaligned scatterlist: os %x length %d\n",
 				sg->offset, sg->length);
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len, mmc_get_dma_dir(data));
 			return -EINVAL;
 		}
 	}
@@ -420,12 +495,41 @@ static int sunxi_mmc_map_dma(struct sunxi_mmc_host *host,
 	return 0;
 }
 
+static void sunxi_mmc_unmap_dma(struct sunxi_mmc_host *host,
+				struct mmc_data *data, int cookie)
+{
+	if (data->host_cookie != cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+		     mmc_get_dma_dir(data));
+	data->host_cookie = COOKIE_UNMAPPED;
+}
+
 static void sunxi_mmc_start_dma(struct sunxi_mmc_host *host,
 				struct mmc_data *data)
 {
 	u32 rval;
 
-	sunxi_mmc_init_idma_des(host, data);
+	/*
+	 * The chain of a request prepared by pre_req is already in the
+	 * other slot. Anything else is built in the slot of the transfer
+	 * that just finished, leaving a prepared chain alone.
+	 */
+	if (data == host->pre_data) {
+		host->idma_slot ^= 1;
+		host->pre_data = NULL;
+	} else {
+		sunxi_mmc_init_idma_des(host, data, host->idma_slot);
+	}
+	mmc_writel(host, REG_DLBA,
+		   (host->sg_dma + host->idma_slot * SUNXI_MMC_DES_SLOT_SIZE) >>
+		   host->cfg->idma_des_shift);
+
+	host->stat_reqs++;
+	host->stat_bytes += data->blksz * data->blocks;
+	host->stat_descs += data->sg_len;
+	host->stat_max_descs = max(host->stat_max_descs, data->sg_len);
 
 	rval = mmc_readl(host, REG_GCTRL);
 	rval |= SDXC_DMA_ENABLE_BIT;
@@ -435,7 +539,7 @@ static void sunxi_mmc_start_dma(struct sunxi_mmc_host *host,
 
 	mmc_writel(host, REG_DMAC, SDXC_IDMAC_SOFT_RESET);
 
-	if (!(data->flags & MMC_DATA_WRITE))
+	if (!(data->flags & MMC_DATA_WRITE) && !host->poll)
 		mmc_writel(host, REG_IDIE, SDXC_IDMAC_RECEIVE_INTERRUPT);
 
 	mmc_writel(host, REG_DMAC,
@@ -552,8 +656,7 @@ static irqreturn_t sunxi_mmc_finalize_request(struct sunxi_mmc_host *host)
 		mmc_writel(host, REG_GCTRL, rval);
 		rval |= SDXC_FIFO_RESET;
 		mmc_writel(host, REG_GCTRL, rval);
-		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
-			     mmc_get_dma_dir(data));
+		sunxi_mmc_unmap_dma(host, data, COOKIE_MAPPED);
 	}
 
 	mmc_writel(host, REG_RINTR, 0xffff);
@@ -561,10 +664,41 @@ static irqreturn_t sunxi_mmc_finalize_request(struct sunxi_mmc_host *host)
 	host->mrq = NULL;
 	host->int_sum = 0;
 	host->wait_dma = false;
+	host->poll = false;
 
 	return host->manual_stop_mrq ? IRQ_WAKE_THREAD : IRQ_HANDLED;
 }
 
+/*
+ * Account new interrupt status to the current request, with host->lock
+ * held. Returns true once the request can be finalized.
+ */
+static bool sunxi_mmc_update_request(struct sunxi_mmc_host *host,
+				     u32 msk_int, u32 idma_int)
+{
+	if (idma_int & SDXC_IDMAC_RECEIVE_INTERRUPT)
+		host->wait_dma = false;
+
+	host->int_sum |= msk_int;
+
+	/* Wait for COMMAND_DONE on RESPONSE_TIMEOUT before finalize */
+	if ((host->int_sum & SDXC_RESP_TIMEOUT) &&
+			!(host->int_sum & SDXC_COMMAND_DONE)) {
+		host->req_imask = SDXC_COMMAND_DONE;
+		if (!host->poll)
+			mmc_writel(host, REG_IMASK,
+				   host->sdio_imask | SDXC_COMMAND_DONE);
+	}
+	/* Don't wait for dma on error */
+	else if (host->int_sum & SDXC_INTERRUPT_ERROR_BIT)
+		return true;
+	else if ((host->int_sum & SDXC_INTERRUPT_DONE_BIT) &&
+			!host->wait_dma)
+		return true;
+
+	return false;
+}
+
 static irqreturn_t sunxi_mmc_irq(int irq, void *dev_id)
 {
 	struct sunxi_mmc_host *host = dev_id;
@@ -583,24 +717,8 @@ static irqreturn_t sunxi_mmc_irq(int irq, void *dev_id)
 		host->mrq, msk_int, idma_int);
 
 	mrq = host->mrq;
-	if (mrq) {
-		if (idma_int & SDXC_IDMAC_RECEIVE_INTERRUPT)
-			host->wait_dma = false;
-
-		host->int_sum |= msk_int;
-
-		/* Wait for COMMAND_DONE on RESPONSE_TIMEOUT before finalize */
-		if ((host->int_sum & SDXC_RESP_TIMEOUT) &&
-				!(host->int_sum & SDXC_COMMAND_DONE))
-			mmc_writel(host, REG_IMASK,
-				   host->sdio_imask | SDXC_COMMAND_DONE);
-		/* Don't wait for dma on error */
-		else if (host->int_sum & SDXC_INTERRUPT_ERROR_BIT)
-			finalize = true;
-		else if ((host->int_sum & SDXC_INTERRUPT_DONE_BIT) &&
-				!host->wait_dma)
-			finalize = true;
-	}
+	if (mrq)
+		finalize = sunxi_mmc_update_request(host, msk_int, idma_int);
 
 	if (msk_int & SDXC_SDIO_INTERRUPT)
 		sdio_int = true;
@@ -616,8 +734,10 @@ static irqreturn_t sunxi_mmc_irq(int irq, void *dev_id)
 	if (finalize && ret == IRQ_HANDLED)
 		mmc_request_done(host->mmc, mrq);
 
-	if (sdio_int)
-		mmc_signal_sdio_irq(host->mmc);
+	if (sdio_int) {
+		host->mmc->ops->enable_sdio_irq(host->mmc, 0);
+		sdio_signal_irq(host->mmc);
+	}
 
 	return ret;
 }
@@ -658,6 +778,59 @@ static irqreturn_t sunxi_mmc_handle_manual_stop(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Busy-wait for a small SDIO transfer, which takes a few microseconds on
+ * the bus, rather than sleeping on its interrupt. The interrupts of the
+ * request stay masked while polling. If it does not finish in time they
+ * are unmasked and the interrupt handler completes it as usual.
+ */
+static void sunxi_mmc_poll_request(struct sunxi_mmc_host *host,
+				   struct mmc_request *mrq)
+{
+	ktime_t timeout = ktime_add_us(ktime_get(), SUNXI_MMC_POLL_US);
+	irqreturn_t ret = IRQ_NONE;
+	unsigned long iflags;
+	u32 raw_int, idma_int;
+
+	for (;;) {
+		spin_lock_irqsave(&host->lock, iflags);
+
+		/* Completed by the interrupt handler meanwhile */
+		if (host->mrq != mrq || !host->poll)
+			break;
+
+		idma_int = mmc_readl(host, REG_IDST);
+		raw_int = mmc_readl(host, REG_RINTR) &
+			  (host->req_imask | SDXC_INTERRUPT_ERROR_BIT);
+		mmc_writel(host, REG_RINTR, raw_int);
+		mmc_writel(host, REG_IDST, idma_int);
+
+		if (sunxi_mmc_update_request(host, raw_int, idma_int)) {
+			ret = sunxi_mmc_finalize_request(host);
+			break;
+		}
+
+		if (ktime_after(ktime_get(), timeout)) {
+			host->poll = false;
+			if (host->wait_dma)
+				mmc_writel(host, REG_IDIE,
+					   SDXC_IDMAC_RECEIVE_INTERRUPT);
+			mmc_writel(host, REG_IMASK,
+				   host->sdio_imask | host->req_imask);
+			break;
+		}
+
+		spin_unlock_irqrestore(&host->lock, iflags);
+		cpu_relax();
+	}
+	spin_unlock_irqrestore(&host->lock, iflags);
+
+	if (ret == IRQ_HANDLED)
+		mmc_request_done(host->mmc, mrq);
+	else if (ret == IRQ_WAKE_THREAD)
+		sunxi_mmc_handle_manual_stop(host->irq, host);
+}
+
 static int sunxi_mmc_oclk_onoff(struct sunxi_mmc_host *host, u32 oclk_en)
 {
 	unsigned long expire = jiffies + msecs_to_jiffies(750);
@@ -945,6 +1118,27 @@ static void sunxi_mmc_card_power(struct sunxi_mmc_host *host,
 	}
 }
 
+static void sunxi_mmc_update_bw_req(struct sunxi_mmc_host *host,
+				    struct mmc_ios *ios)
+{
+	u32 kBps;
+
+	if (ios->power_mode == MMC_POWER_OFF || !ios->clock) {
+		sunxi_mbus_bw_remove_request(&host->bw_req);
+		return;
+	}
+
+	kBps = ios->clock / 1000 * (1 << ios->bus_width) / 8;
+	if (ios->timing == MMC_TIMING_UHS_DDR50 ||
+	    ios->timing == MMC_TIMING_MMC_DDR52)
+		kBps *= 2;
+
+	if (host->bw_req.active)
+		sunxi_mbus_bw_update_request(&host->bw_req, kBps);
+	else
+		sunxi_mbus_bw_add_request(&host->bw_req, kBps);
+}
+
 static void sunxi_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 {
 	struct sunxi_mmc_host *host = mmc_priv(mmc);
@@ -958,6 +1152,8 @@ static void sunxi_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 
 	if (ios->power_mode == MMC_POWER_UP)
 		sunxi_mmc_init_host(host);
+
+	sunxi_mmc_update_bw_req(host, ios);
 }
 
 static int sunxi_mmc_volt_switch(struct mmc_host *mmc, struct mmc_ios *ios)
@@ -1003,6 +1199,30 @@ static void sunxi_mmc_enable_sdio_irq(struct mmc_host *mmc, int enable)
 		//pm_runtime_put_noidle(host->mmc->parent);
 }
 
+static void sunxi_mmc_ack_sdio_irq(struct mmc_host *mmc)
+{
+	sunxi_mmc_enable_sdio_irq(mmc, 1);
+}
+
+/* Only short SDIO commands are worth spinning for */
+static bool sunxi_mmc_can_poll(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct mmc_data *data = mrq->data;
+
+	if (!sdio_poll_bytes || mrq->stop || !mmc->card ||
+	    !mmc_card_sdio(mmc->card))
+		return false;
+
+	switch (mrq->cmd->opcode) {
+	case SD_IO_RW_DIRECT:
+		return true;
+	case SD_IO_RW_EXTENDED:
+		return data && data->blksz * data->blocks <= sdio_poll_bytes;
+	default:
+		return false;
+	}
+}
+
 static void sunxi_mmc_hw_reset(struct mmc_host *mmc)
 {
 	struct sunxi_mmc_host *host = mmc_priv(mmc);
@@ -1021,6 +1241,7 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	u32 imask = SDXC_INTERRUPT_ERROR_BIT;
 	u32 cmd_val = SDXC_START | (cmd->opcode & 0x3f);
 	bool wait_dma = host->wait_dma;
+	bool poll = sunxi_mmc_can_poll(mmc, mrq);
 	int ret;
 
 	/* Check for set_ios errors (should never happen) */
@@ -1030,7 +1251,7 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		return;
 	}
 
-	if (data) {
+	if (data && data->host_cookie != COOKIE_PRE_MAPPED) {
 		ret = sunxi_mmc_map_dma(host, data);
 		if (ret < 0) {
 			dev_err(mmc_dev(mmc), "map DMA failed\n");
@@ -1039,6 +1260,7 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 			mmc_request_done(mmc, mrq);
 			return;
 		}
+		data->host_cookie = COOKIE_MAPPED;
 	}
 
 	if (cmd->opcode == MMC_GO_IDLE_STATE) {
@@ -1084,8 +1306,7 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		spin_unlock_irqrestore(&host->lock, iflags);
 
 		if (data)
-			dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
-				     mmc_get_dma_dir(data));
+			sunxi_mmc_unmap_dma(host, data, COOKIE_MAPPED);
 
 		dev_err(mmc_dev(mmc), "request already pending\n");
 		mrq->cmd->error = -EBUSY;
@@ -1093,6 +1314,7 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		return;
 	}
 
+	host->poll = poll;
 	if (data) {
 		mmc_writel(host, REG_BLKSZ, data->blksz);
 		mmc_writel(host, REG_BCNTR, data->blksz * data->blocks);
@@ -1101,11 +1323,53 @@ static void sunxi_mmc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	host->mrq = mrq;
 	host->wait_dma = wait_dma;
-	mmc_writel(host, REG_IMASK, host->sdio_imask | imask);
+	host->req_imask = imask;
+	mmc_writel(host, REG_IMASK, host->sdio_imask | (poll ? 0 : imask));
 	mmc_writel(host, REG_CARG, cmd->arg);
 	mmc_writel(host, REG_CMDR, cmd_val);
 
 	spin_unlock_irqrestore(&host->lock, iflags);
+
+	if (poll)
+		sunxi_mmc_poll_request(host, mrq);
+}
+
+/*
+ * Map the next request and build its descriptor chain while the current
+ * request is still transferring, so sunxi_mmc_request() only has to
+ * point the IDMAC at it.
+ */
+static void sunxi_mmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct sunxi_mmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	data->host_cookie = COOKIE_UNMAPPED;
+	if (sunxi_mmc_map_dma(host, data))
+		return;
+	data->host_cookie = COOKIE_PRE_MAPPED;
+
+	if (!host->pre_data) {
+		sunxi_mmc_init_idma_des(host, data, host->idma_slot ^ 1);
+		host->pre_data = data;
+	}
+}
+
+static void sunxi_mmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			       int err)
+{
+	struct sunxi_mmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	if (host->pre_data == data)
+		host->pre_data = NULL;
+	sunxi_mmc_unmap_dma(host, data, COOKIE_PRE_MAPPED);
 }
 
 static int sunxi_mmc_card_busy(struct mmc_host *mmc)
@@ -1115,12 +1379,56 @@ static int sunxi_mmc_card_busy(struct mmc_host *mmc)
 	return !!(mmc_readl(host, REG_STAS) & SDXC_CARD_DATA_BUSY);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int sunxi_mmc_stats_show(struct seq_file *s, void *v)
+{
+	struct sunxi_mmc_host *host = s->private;
+	u64 reqs, bytes, descs;
+	u32 max_descs;
+
+	spin_lock_irq(&host->lock);
+	reqs = host->stat_reqs;
+	bytes = host->stat_bytes;
+	descs = host->stat_descs;
+	max_descs = host->stat_max_descs;
+	spin_unlock_irq(&host->lock);
+
+	seq_printf(s, "requests:\t%llu\n", reqs);
+	seq_printf(s, "bytes:\t%llu\n", bytes);
+	seq_printf(s, "avg request size:\t%llu\n",
+		   reqs ? div64_u64(bytes, reqs) : 0);
+	seq_printf(s, "avg descriptors:\t%llu\n",
+		   reqs ? div64_u64(descs, reqs) : 0);
+	seq_printf(s, "max descriptors:\t%u\n", max_descs);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sunxi_mmc_stats);
+
+static void sunxi_mmc_init_debugfs(struct sunxi_mmc_host *host)
+{
+	struct dentry *root = host->mmc->debugfs_root;
+
+	if (!root)
+		return;
+
+	debugfs_create_file("stats", 0444, root, host, &sunxi_mmc_stats_fops);
+}
+#else
+static void sunxi_mmc_init_debugfs(struct sunxi_mmc_host *host)
+{
+}
+#endif
+
 static const struct mmc_host_ops sunxi_mmc_ops = {
 	.request	 = sunxi_mmc_request,
+	.pre_req	 = sunxi_mmc_pre_req,
+	.post_req	 = sunxi_mmc_post_req,
 	.set_ios	 = sunxi_mmc_set_ios,
 	.get_ro		 = mmc_gpio_get_ro,
 	.get_cd		 = mmc_gpio_get_cd,
 	.enable_sdio_irq = sunxi_mmc_enable_sdio_irq,
+	.ack_sdio_irq	 = sunxi_mmc_ack_sdio_irq,
 	.start_signal_voltage_switch = sunxi_mmc_volt_switch,
 	.card_hw_reset	 = sunxi_mmc_hw_reset,
 	.card_busy	 = sunxi_mmc_card_busy,
@@ -1400,13 +1708,16 @@ static int sunxi_mmc_probe(struct platform_device *pdev)
 	if (ret)
 		goto error_free_host;
 
-	host->sg_cpu = dma_alloc_coherent(&pdev->dev, PAGE_SIZE,
+	host->sg_cpu = dma_alloc_coherent(&pdev->dev,
+					  SUNXI_MMC_DES_SLOTS *
+					  SUNXI_MMC_DES_SLOT_SIZE,
 					  &host->sg_dma, GFP_KERNEL);
 	if (!host->sg_cpu) {
 		dev_err(&pdev->dev, "Failed to allocate DMA descriptor mem\n");
 		ret = -ENOMEM;
 		goto error_free_host;
 	}
+	sunxi_mmc_link_idma_des(host);
 
 	if (host->cfg->ccu_has_timings_switch) {
 		/*
@@ -1435,7 +1746,8 @@ static int sunxi_mmc_probe(struct platform_device *pdev)
 	mmc->ops		= &sunxi_mmc_ops;
 	mmc->max_blk_count	= 8192;
 	mmc->max_blk_size	= 4096;
-	mmc->max_segs		= PAGE_SIZE / sizeof(struct sunxi_idma_des);
+	mmc->max_segs		= SUNXI_MMC_DES_SLOT_SIZE /
+				  sizeof(struct sunxi_idma_des);
 	mmc->max_seg_size	= (1 << host->cfg->idma_des_size_bits);
 	mmc->max_req_size	= mmc->max_seg_size * mmc->max_segs;
 	/* 400kHz ~ 52MHz */
@@ -1443,6 +1755,7 @@ static int sunxi_mmc_probe(struct platform_device *pdev)
 	mmc->f_max		= 52000000;
 	mmc->caps	       |= MMC_CAP_MMC_HIGHSPEED | MMC_CAP_SD_HIGHSPEED |
 				  MMC_CAP_SDIO_IRQ;
+	mmc->caps2	       |= MMC_CAP2_SDIO_IRQ_NOTHREAD;
 
 	/*
 	 * Some H5 and H6 devices do not have signal traces precise enough to
@@ -1492,6 +1805,8 @@ static int sunxi_mmc_probe(struct platform_device *pdev)
 	if (ret)
 		goto error_free_dma;
 
+	sunxi_mmc_init_debugfs(host);
+
 	dev_info(&pdev->dev, "initialized, max. request size: %u KB%s\n",
 		 mmc->max_req_size >> 10,
 		 host->use_new_timings ? ", uses new timings mode" : "");
@@ -1499,7 +1814,9 @@ static int sunxi_mmc_probe(struct platform_device *pdev)
 	return 0;
 
 error_free_dma:
-	dma_free_coherent(&pdev->dev, PAGE_SIZE, host->sg_cpu, host->sg_dma);
+	dma_free_coherent(&pdev->dev,
+			  SUNXI_MMC_DES_SLOTS * SUNXI_MMC_DES_SLOT_SIZE,
+			  host->sg_cpu, host->sg_dma);
 error_free_host:
 	mmc_free_host(mmc);
 	return ret;
@@ -1511,12 +1828,15 @@ static int sunxi_mmc_remove(struct platform_device *pdev)
 	struct sunxi_mmc_host *host = mmc_priv(mmc);
 
 	mmc_remove_host(mmc);
+	sunxi_mbus_bw_remove_request(&host->bw_req);
 	//pm_runtime_disable(&pdev->dev);
 	//if (!pm_runtime_status_suspended(&pdev->dev)) {
 		disable_irq(host->irq);
 		sunxi_mmc_disable(host);
 	//}
-	dma_free_coherent(&pdev->dev, PAGE_SIZE, host->sg_cpu, host->sg_dma);
+	dma_free_coherent(&pdev->dev,
+			  SUNXI_MMC_DES_SLOTS * SUNXI_MMC_DES_SLOT_SIZE,
+			  host->sg_cpu, host->sg_dma);
 	mmc_free_host(mmc);
 
 	return 0;
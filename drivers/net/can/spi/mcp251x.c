@@ -22,6 +22,7 @@
 #include <linux/bitfield.h>
 #include <linux/can/core.h>
 #include <linux/can/dev.h>
+#include <linux/can/rx-offload.h>
 #include <linux/clk.h>
 #include <linux/completion.h>
 #include <linux/delay.h>
@@ -201,8 +202,20 @@
 #define SPI_TRANSFER_BUF_LEN	(6 + CAN_FRAME_MAX_DATA_LEN)
 #define CAN_FRAME_MAX_BITS	128
 
+/* Batched RX: CANINTF and EFLG, then both RX buffers in a single READ
+ * (RXB1 follows RXB0 after the CANSTAT/CANCTRL mirrors at 0x6e/0x6f).
+ */
+#define RXB_STRIDE		0x10
+#define RX_BATCH_STAT_LEN	4
+#define RX_BATCH_DATA_LEN	(2 + RXB_STRIDE + SPI_TRANSFER_BUF_LEN)
+#define RX_BATCH_LEN		(RX_BATCH_STAT_LEN + RX_BATCH_DATA_LEN)
+
 #define TX_ECHO_SKB_MAX	1
 
+#define MCP251X_NAPI_WEIGHT	32
+/* Hand queued frames to NAPI at least this often during a long IST run */
+#define MCP251X_RX_FLUSH	8
+
 #define MCP251X_OST_DELAY_MS	(5)
 
 #define DEVICE_NAME "mcp251x"
@@ -227,6 +240,7 @@ enum mcp251x_model {
 
 struct mcp251x_priv {
 	struct can_priv	   can;
+	struct can_rx_offload offload;
 	struct net_device *net;
 	struct spi_device *spi;
 	enum mcp251x_model model;
@@ -236,8 +250,24 @@ struct mcp251x_priv {
 	u8 *spi_tx_buf;
 	u8 *spi_rx_buf;
 
+	/* Prepared message for the batched RX path, see mcp251x_rx_batch() */
+	bool rx_batch;
+	struct spi_message rx_msg;
+	struct spi_transfer rx_xfer[2];
+	u8 *rx_tx_buf;
+	u8 *rx_rx_buf;
+
+	/* Flag clear issued with spi_async() after a batched RX */
+	struct spi_message clr_msg;
+	struct spi_transfer clr_xfer[2];
+	u8 *clr_buf;
+	struct completion clr_done;
+
 	struct sk_buff *tx_skb;
 
+	/* CLOCK_MONOTONIC time of the hard IRQ that started the IST */
+	ktime_t irq_ts;
+
 	struct workqueue_struct *wq;
 	struct work_struct tx_work;
 	struct work_struct restart_work;
@@ -692,12 +722,21 @@ static void mcp251x_hw_rx_frame(struct spi_device *spi, u8 *buf,
 	}
 }
 
-static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx)
+/* Key used by rx-offload to sort frames, from a CLOCK_MONOTONIC stamp */
+static inline u32 mcp251x_ts_key(ktime_t ts)
+{
+	return (u32)ktime_to_ns(ts);
+}
+
+/* Queue the frame in @buf, laid out as the RXBn registers, to rx-offload.
+ * @ts is the earliest software time stamp we have for it.
+ */
+static void mcp251x_hw_rx_skb(struct spi_device *spi, const u8 *buf,
+			      ktime_t ts)
 {
 	struct mcp251x_priv *priv = spi_get_drvdata(spi);
 	struct sk_buff *skb;
 	struct can_frame *frame;
-	u8 buf[SPI_TRANSFER_BUF_LEN];
 
 	skb = alloc_can_skb(priv->net, &frame);
 	if (!skb) {
@@ -706,7 +745,6 @@ static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx)
 		return;
 	}
 
-	mcp251x_hw_rx_frame(spi, buf, buf_idx);
 	if (buf[RXBSIDL_OFF] & RXBSIDL_IDE) {
 		/* Extended ID format */
 		frame->can_id = CAN_EFF_FLAG;
@@ -731,14 +769,156 @@ static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx)
 	}
 	/* Data length */
 	frame->len = can_cc_dlc2len(buf[RXBDLC_OFF] & RXBDLC_LEN_MASK);
-	if (!(frame->can_id & CAN_RTR_FLAG)) {
+	if (!(frame->can_id & CAN_RTR_FLAG))
 		memcpy(frame->data, buf + RXBDAT_OFF, frame->len);
 
-		priv->net->stats.rx_bytes += frame->len;
+	skb->tstamp = ktime_mono_to_real(ts);
+	if (can_rx_offload_queue_timestamp(&priv->offload, skb,
+					   mcp251x_ts_key(ts)))
+		priv->net->stats.rx_fifo_errors++;
+}
+
+static void mcp251x_hw_rx(struct spi_device *spi, int buf_idx, ktime_t ts)
+{
+	u8 buf[SPI_TRANSFER_BUF_LEN];
+
+	mcp251x_hw_rx_frame(spi, buf, buf_idx);
+	mcp251x_hw_rx_skb(spi, buf, ts);
+}
+
+/* Read CANINTF, EFLG and both RX buffers with the prepared message.
+ * Plain READs are used so that no RXnIF is cleared behind our back: a
+ * frame landing in a buffer after CANINTF was sampled stays flagged and
+ * is picked up by the next round. Returns a pointer to RXB0, RXB1 is at
+ * RXB_STRIDE past it.
+ */
+static const u8 *mcp251x_rx_batch(struct spi_device *spi, u8 *intf,
+				  u8 *eflag)
+{
+	struct mcp251x_priv *priv = spi_get_drvdata(spi);
+	int ret;
+
+	ret = spi_sync(spi, &priv->rx_msg);
+	if (ret) {
+		dev_err(&spi->dev, "spi transfer failed: ret = %d\n", ret);
+		*intf = 0;
+		*eflag = 0;
+		return NULL;
+	}
+
+	*intf = priv->rx_rx_buf[2];
+	*eflag = priv->rx_rx_buf[3];
+	return priv->rx_rx_buf + RX_BATCH_STAT_LEN + 2;
+}
+
+static void mcp251x_clr_complete(void *context)
+{
+	struct mcp251x_priv *priv = context;
+
+	if (priv->clr_msg.status)
+		dev_err_ratelimited(&priv->spi->dev,
+				    "spi flag clear failed: ret = %d\n",
+				    priv->clr_msg.status);
+	complete(&priv->clr_done);
+}
+
+/* Clear @intf in CANINTF and @eflag in EFLG without waiting for it. The
+ * next register access is queued behind it on the same device, so the
+ * IST does not need to wait before reading the flags again.
+ */
+static void mcp251x_clr_async(struct spi_device *spi, u8 intf, u8 eflag)
+{
+	struct mcp251x_priv *priv = spi_get_drvdata(spi);
+	u8 *buf = priv->clr_buf;
+	int ret;
+
+	if (!intf && !eflag)
+		return;
+
+	/* the previous clear may still own the message */
+	wait_for_completion(&priv->clr_done);
+
+	spi_message_init(&priv->clr_msg);
+	priv->clr_msg.complete = mcp251x_clr_complete;
+	priv->clr_msg.context = priv;
+	memset(priv->clr_xfer, 0, sizeof(priv->clr_xfer));
+	if (intf) {
+		buf[0] = INSTRUCTION_BIT_MODIFY;
+		buf[1] = CANINTF;
+		buf[2] = intf;
+		buf[3] = 0x00;
+		priv->clr_xfer[0].tx_buf = buf;
+		priv->clr_xfer[0].len = 4;
+		priv->clr_xfer[0].cs_change = !!eflag;
+		spi_message_add_tail(&priv->clr_xfer[0], &priv->clr_msg);
+	}
+	if (eflag) {
+		buf[4] = INSTRUCTION_BIT_MODIFY;
+		buf[5] = EFLG;
+		buf[6] = eflag;
+		buf[7] = 0x00;
+		priv->clr_xfer[1].tx_buf = buf + 4;
+		priv->clr_xfer[1].len = 4;
+		spi_message_add_tail(&priv->clr_xfer[1], &priv->clr_msg);
+	}
+
+	ret = spi_async(spi, &priv->clr_msg);
+	if (ret) {
+		dev_err(&spi->dev, "spi flag clear failed: ret = %d\n", ret);
+		complete(&priv->clr_done);
 	}
-	priv->net->stats.rx_packets++;
+}
+
+/* Wait for an outstanding mcp251x_clr_async() */
+static void mcp251x_clr_sync(struct mcp251x_priv *priv)
+{
+	if (!priv->rx_batch)
+		return;
 
-	netif_rx(skb);
+	wait_for_completion(&priv->clr_done);
+	complete(&priv->clr_done);
+}
+
+static int mcp251x_rx_batch_init(struct mcp251x_priv *priv)
+{
+	struct spi_device *spi = priv->spi;
+	struct device *dev = &spi->dev;
+
+	/* The MCP2510 is read register by register, see
+	 * mcp251x_hw_rx_frame(), and half duplex controllers cannot do a
+	 * READ in a single transfer.
+	 */
+	if (mcp251x_is_2510(spi) ||
+	    spi->controller->flags & SPI_CONTROLLER_HALF_DUPLEX)
+		return 0;
+
+	priv->rx_tx_buf = devm_kzalloc(dev, RX_BATCH_LEN, GFP_KERNEL);
+	priv->rx_rx_buf = devm_kzalloc(dev, RX_BATCH_LEN, GFP_KERNEL);
+	priv->clr_buf = devm_kzalloc(dev, 8, GFP_KERNEL);
+	if (!priv->rx_tx_buf || !priv->rx_rx_buf || !priv->clr_buf)
+		return -ENOMEM;
+
+	priv->rx_tx_buf[0] = INSTRUCTION_READ;
+	priv->rx_tx_buf[1] = CANINTF;
+	priv->rx_xfer[0].tx_buf = priv->rx_tx_buf;
+	priv->rx_xfer[0].rx_buf = priv->rx_rx_buf;
+	priv->rx_xfer[0].len = RX_BATCH_STAT_LEN;
+	priv->rx_xfer[0].cs_change = 1;
+
+	priv->rx_tx_buf[RX_BATCH_STAT_LEN] = INSTRUCTION_READ;
+	priv->rx_tx_buf[RX_BATCH_STAT_LEN + 1] = RXBCTRL(0);
+	priv->rx_xfer[1].tx_buf = priv->rx_tx_buf + RX_BATCH_STAT_LEN;
+	priv->rx_xfer[1].rx_buf = priv->rx_rx_buf + RX_BATCH_STAT_LEN;
+	priv->rx_xfer[1].len = RX_BATCH_DATA_LEN;
+
+	spi_message_init_with_transfers(&priv->rx_msg, priv->rx_xfer,
+					ARRAY_SIZE(priv->rx_xfer));
+
+	init_completion(&priv->clr_done);
+	complete(&priv->clr_done);
+	priv->rx_batch = true;
+
+	return 0;
 }
 
 static void mcp251x_hw_sleep(struct spi_device *spi)
@@ -954,9 +1134,12 @@ static int mcp251x_stop(struct net_device *net)
 
 	priv->force_quit = 1;
 	free_irq(spi->irq, priv);
+	can_rx_offload_disable(&priv->offload);
 
 	mutex_lock(&priv->mcp_lock);
 
+	mcp251x_clr_sync(priv);
+
 	/* Disable and clear pending interrupts */
 	mcp251x_write_2regs(spi, CANINTE, 0x00, 0x00);
 
@@ -974,8 +1157,10 @@ static int mcp251x_stop(struct net_device *net)
 	return 0;
 }
 
-static void mcp251x_error_skb(struct net_device *net, int can_id, int data1)
+static void mcp251x_error_skb(struct net_device *net, int can_id, int data1,
+			      ktime_t ts)
 {
+	struct mcp251x_priv *priv = netdev_priv(net);
 	struct sk_buff *skb;
 	struct can_frame *frame;
 
@@ -983,7 +1168,10 @@ static void mcp251x_error_skb(struct net_device *net, int can_id, int data1)
 	if (skb) {
 		frame->can_id |= can_id;
 		frame->data[1] = data1;
-		netif_rx(skb);
+		skb->tstamp = ktime_mono_to_real(ts);
+		if (can_rx_offload_queue_timestamp(&priv->offload, skb,
+						   mcp251x_ts_key(ts)))
+			net->stats.rx_fifo_errors++;
 	} else {
 		netdev_err(net, "cannot allocate error skb\n");
 	}
@@ -1050,16 +1238,30 @@ static void mcp251x_restart_work_handler(struct work_struct *ws)
 		mcp251x_write_reg(spi, TXBCTRL(0), 0);
 		mcp251x_clean(net);
 		netif_wake_queue(net);
-		mcp251x_error_skb(net, CAN_ERR_RESTARTED, 0);
+		mcp251x_error_skb(net, CAN_ERR_RESTARTED, 0, ktime_get());
+		can_rx_offload_threaded_irq_finish(&priv->offload);
 	}
 	mutex_unlock(&priv->mcp_lock);
 }
 
+/* Take the earliest software time stamp of the frames the IST will read */
+static irqreturn_t mcp251x_can_irq(int irq, void *dev_id)
+{
+	struct mcp251x_priv *priv = dev_id;
+
+	priv->irq_ts = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 {
 	struct mcp251x_priv *priv = dev_id;
 	struct spi_device *spi = priv->spi;
 	struct net_device *net = priv->net;
+	struct can_rx_offload *offload = &priv->offload;
+	/* later rounds read frames that came in after the hard IRQ */
+	ktime_t ts = priv->irq_ts;
+	unsigned int queued = 0;
 
 	mutex_lock(&priv->mcp_lock);
 	while (!priv->force_quit) {
@@ -1068,11 +1270,28 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 		u8 clear_intf = 0;
 		int can_id = 0, data1 = 0;
 
+		if (queued >= MCP251X_RX_FLUSH) {
+			can_rx_offload_threaded_irq_finish(offload);
+			queued = 0;
+		}
+
+		if (priv->rx_batch) {
+			const u8 *rxb = mcp251x_rx_batch(spi, &intf, &eflag);
+
+			if (intf & CANINTF_RX0IF)
+				mcp251x_hw_rx_skb(spi, rxb, ts);
+			if (intf & CANINTF_RX1IF)
+				mcp251x_hw_rx_skb(spi, rxb + RXB_STRIDE, ts);
+			/* read with plain READs, so clear them ourselves */
+			clear_intf |= intf & CANINTF_RX;
+			goto rx_done;
+		}
+
 		mcp251x_read_2regs(spi, CANINTF, &intf, &eflag);
 
 		/* receive buffer 0 */
 		if (intf & CANINTF_RX0IF) {
-			mcp251x_hw_rx(spi, 0);
+			mcp251x_hw_rx(spi, 0, ts);
 			/* Free one buffer ASAP
 			 * (The MCP2515/25625 does this automatically.)
 			 */
@@ -1095,23 +1314,31 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 
 		/* receive buffer 1 */
 		if (intf & CANINTF_RX1IF) {
-			mcp251x_hw_rx(spi, 1);
+			mcp251x_hw_rx(spi, 1, ts);
 			/* The MCP2515/25625 does this automatically. */
 			if (mcp251x_is_2510(spi))
 				clear_intf |= CANINTF_RX1IF;
 		}
 
+rx_done:
 		/* mask out flags we don't care about */
 		intf &= CANINTF_RX | CANINTF_TX | CANINTF_ERR;
 
 		/* any error or tx interrupt we need to clear? */
 		if (intf & (CANINTF_ERR | CANINTF_TX))
 			clear_intf |= intf & (CANINTF_ERR | CANINTF_TX);
-		if (clear_intf)
-			mcp251x_write_bits(spi, CANINTF, clear_intf, 0x00);
+		if (priv->rx_batch) {
+			mcp251x_clr_async(spi, clear_intf,
+					  eflag & (EFLG_RX0OVR | EFLG_RX1OVR) ?
+					  eflag : 0);
+		} else {
+			if (clear_intf)
+				mcp251x_write_bits(spi, CANINTF, clear_intf,
+						   0x00);
 
-		if (eflag & (EFLG_RX0OVR | EFLG_RX1OVR))
-			mcp251x_write_bits(spi, EFLG, eflag, 0x00);
+			if (eflag & (EFLG_RX0OVR | EFLG_RX1OVR))
+				mcp251x_write_bits(spi, EFLG, eflag, 0x00);
+		}
 
 		/* Update can state */
 		if (eflag & EFLG_TXBO) {
@@ -1168,7 +1395,7 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 				can_id |= CAN_ERR_CRTL;
 				data1 |= CAN_ERR_CRTL_RX_OVERFLOW;
 			}
-			mcp251x_error_skb(net, can_id, data1);
+			mcp251x_error_skb(net, can_id, data1, ts);
 		}
 
 		if (priv->can.state == CAN_STATE_BUS_OFF) {
@@ -1186,14 +1413,21 @@ static irqreturn_t mcp251x_can_ist(int irq, void *dev_id)
 
 		if (intf & CANINTF_TX) {
 			if (priv->tx_busy) {
+				u32 key = mcp251x_ts_key(ts);
+
 				net->stats.tx_packets++;
-				net->stats.tx_bytes += can_get_echo_skb(net, 0,
-									NULL);
+				net->stats.tx_bytes +=
+					can_rx_offload_get_echo_skb(offload, 0,
+								    key, NULL);
 				priv->tx_busy = false;
 			}
 			netif_wake_queue(net);
 		}
+
+		queued += hweight8(intf & (CANINTF_RX | CANINTF_TX));
+		ts = ktime_get();
 	}
+	can_rx_offload_threaded_irq_finish(offload);
 	mutex_unlock(&priv->mcp_lock);
 	return IRQ_HANDLED;
 }
@@ -1221,12 +1455,14 @@ static int mcp251x_open(struct net_device *net)
 	if (!dev_fwnode(&spi->dev))
 		flags = IRQF_TRIGGER_FALLING;
 
-	ret = request_threaded_irq(spi->irq, NULL, mcp251x_can_ist,
+	can_rx_offload_enable(&priv->offload);
+
+	ret = request_threaded_irq(spi->irq, mcp251x_can_irq, mcp251x_can_ist,
 				   flags | IRQF_ONESHOT, dev_name(&spi->dev),
 				   priv);
 	if (ret) {
 		dev_err(&spi->dev, "failed to acquire irq %d\n", spi->irq);
-		goto out_close;
+		goto out_rx_offload_disable;
 	}
 
 	ret = mcp251x_hw_wake(spi);
@@ -1247,6 +1483,8 @@ static int mcp251x_open(struct net_device *net)
 out_free_irq:
 	free_irq(spi->irq, priv);
 	mcp251x_hw_sleep(spi);
+out_rx_offload_disable:
+	can_rx_offload_disable(&priv->offload);
 out_close:
 	mcp251x_power_enable(priv->transceiver, 0);
 	close_candev(net);
@@ -1396,6 +1634,10 @@ static int mcp251x_can_probe(struct spi_device *spi)
 		goto error_probe;
 	}
 
+	ret = mcp251x_rx_batch_init(priv);
+	if (ret)
+		goto error_probe;
+
 	SET_NETDEV_DEV(net, &spi->dev);
 
 	/* Here is OK to not lock the MCP, no one knows about it yet */
@@ -1409,10 +1651,15 @@ static int mcp251x_can_probe(struct spi_device *spi)
 
 	mcp251x_hw_sleep(spi);
 
-	ret = register_candev(net);
+	ret = can_rx_offload_add_manual(net, &priv->offload,
+					MCP251X_NAPI_WEIGHT);
 	if (ret)
 		goto error_probe;
 
+	ret = register_candev(net);
+	if (ret)
+		goto out_rx_offload_del;
+
 	ret = mcp251x_gpio_setup(priv);
 	if (ret)
 		goto out_unregister_candev;
@@ -1423,6 +1670,9 @@ static int mcp251x_can_probe(struct spi_device *spi)
 out_unregister_candev:
 	unregister_candev(net);
 
+out_rx_offload_del:
+	can_rx_offload_del(&priv->offload);
+
 error_probe:
 	destroy_workqueue(priv->wq);
 	priv->wq = NULL;
@@ -1444,6 +1694,7 @@ static void mcp251x_can_remove(struct spi_device *spi)
 	struct net_device *net = priv->net;
 
 	unregister_candev(net);
+	can_rx_offload_del(&priv->offload);
 
 	mcp251x_power_enable(priv->power, 0);
 
@@ -51,6 +51,7 @@
 #include <linux/can.h>
 #include <linux/can/dev.h>
 #include <linux/can/error.h>
+#include <linux/can/rx-offload.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/ethtool.h>
@@ -62,6 +63,7 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/reset.h>
+#include <linux/timer.h>
 
 #define DRV_NAME "sun4i_can"
 
@@ -203,6 +205,14 @@
 #define SUN4I_CAN_MAX_IRQ	20
 #define SUN4I_MODE_MAX_RETRIES	100
 
+#define SUN4I_CAN_NAPI_WEIGHT	32
+
+/* A noisy bus can raise bus errors back to back. Past this many in one
+ * jiffy the bus-error interrupt is masked for SUN4I_CAN_BERR_QUIET_MS.
+ */
+#define SUN4I_CAN_BERR_MAX	8
+#define SUN4I_CAN_BERR_QUIET_MS	10
+
 /**
  * struct sun4ican_quirks - Differences between SoC variants.
  *
@@ -221,6 +231,11 @@ struct sun4ican_priv {
 	struct reset_control *reset;
 	spinlock_t cmdreg_lock;	/* lock for concurrent cmd register writes */
 	int acp_offset;
+	struct can_rx_offload offload;
+	/* bus-error interrupt rate limiting */
+	struct timer_list berr_timer;
+	unsigned long berr_jiffies;
+	unsigned int berr_count;
 };
 
 static const struct can_bittiming_const sun4ican_bittiming_const = {
@@ -329,6 +344,23 @@ static int sun4ican_get_berr_counter(const struct net_device *dev,
 	return 0;
 }
 
+static u32 sun4i_can_inten(const struct sun4ican_priv *priv)
+{
+	if (priv->can.ctrlmode & CAN_CTRLMODE_BERR_REPORTING)
+		return 0xFF;
+
+	return 0xFF & ~SUN4I_INTEN_BERR;
+}
+
+static void sun4i_can_berr_timer(struct timer_list *t)
+{
+	struct sun4ican_priv *priv = from_timer(priv, t, berr_timer);
+
+	if (priv->can.state != CAN_STATE_STOPPED)
+		writel(sun4i_can_inten(priv),
+		       priv->base + SUN4I_REG_INTEN_ADDR);
+}
+
 static int sun4i_can_start(struct net_device *dev)
 {
 	struct sun4ican_priv *priv = netdev_priv(dev);
@@ -350,11 +382,8 @@ static int sun4i_can_start(struct net_device *dev)
 	writel(0, priv->base + SUN4I_REG_ERRC_ADDR);
 
 	/* enable interrupts */
-	if (priv->can.ctrlmode & CAN_CTRLMODE_BERR_REPORTING)
-		writel(0xFF, priv->base + SUN4I_REG_INTEN_ADDR);
-	else
-		writel(0xFF & ~SUN4I_INTEN_BERR,
-		       priv->base + SUN4I_REG_INTEN_ADDR);
+	priv->berr_count = 0;
+	writel(sun4i_can_inten(priv), priv->base + SUN4I_REG_INTEN_ADDR);
 
 	/* enter the selected mode */
 	mod_reg_val = readl(priv->base + SUN4I_REG_MSEL_ADDR);
@@ -474,10 +503,15 @@ static netdev_tx_t sun4ican_start_xmit(struct sk_buff *skb, struct net_device *d
 	return NETDEV_TX_OK;
 }
 
-static void sun4i_can_rx(struct net_device *dev)
+/* Key used by rx-offload to sort frames, from a CLOCK_MONOTONIC stamp */
+static inline u32 sun4i_can_ts_key(ktime_t ts)
+{
+	return (u32)ktime_to_ns(ts);
+}
+
+static void sun4i_can_rx(struct net_device *dev, ktime_t ts)
 {
 	struct sun4ican_priv *priv = netdev_priv(dev);
-	struct net_device_stats *stats = &dev->stats;
 	struct can_frame *cf;
 	struct sk_buff *skb;
 	u8 fi;
@@ -487,8 +521,11 @@ static void sun4i_can_rx(struct net_device *dev)
 
 	/* create zero'ed CAN frame buffer */
 	skb = alloc_can_skb(dev, &cf);
-	if (!skb)
+	if (!skb) {
+		dev->stats.rx_dropped++;
+		sun4i_can_write_cmdreg(priv, SUN4I_CMD_RELEASE_RBUF);
 		return;
+	}
 
 	fi = readl(priv->base + SUN4I_REG_BUF0_ADDR);
 	cf->len = can_cc_dlc2len(fi & 0x0F);
@@ -511,19 +548,41 @@ static void sun4i_can_rx(struct net_device *dev)
 	} else {
 		for (i = 0; i < cf->len; i++)
 			cf->data[i] = readl(priv->base + dreg + i * 4);
-
-		stats->rx_bytes += cf->len;
 	}
-	stats->rx_packets++;
 
 	cf->can_id = id;
 
 	sun4i_can_write_cmdreg(priv, SUN4I_CMD_RELEASE_RBUF);
 
-	netif_rx(skb);
+	/* rx-offload accounts rx_packets and rx_bytes */
+	if (can_rx_offload_queue_timestamp(&priv->offload, skb,
+					   sun4i_can_ts_key(ts)))
+		dev->stats.rx_fifo_errors++;
+}
+
+/* Mask the bus-error interrupt for a while once it fires faster than
+ * SUN4I_CAN_BERR_MAX per jiffy, so that a noisy bus cannot keep the CPU
+ * in this handler. Error counters and state changes still come through
+ * the warning and passive interrupts.
+ */
+static void sun4i_can_berr_throttle(struct sun4ican_priv *priv)
+{
+	if (priv->berr_jiffies != jiffies) {
+		priv->berr_jiffies = jiffies;
+		priv->berr_count = 0;
+	}
+
+	if (++priv->berr_count < SUN4I_CAN_BERR_MAX)
+		return;
+
+	writel(sun4i_can_inten(priv) & ~SUN4I_INTEN_BERR,
+	       priv->base + SUN4I_REG_INTEN_ADDR);
+	mod_timer(&priv->berr_timer,
+		  jiffies + msecs_to_jiffies(SUN4I_CAN_BERR_QUIET_MS));
 }
 
-static int sun4i_can_err(struct net_device *dev, u8 isrc, u8 status)
+static int sun4i_can_err(struct net_device *dev, u8 isrc, u8 status,
+			 ktime_t ts)
 {
 	struct sun4ican_priv *priv = netdev_priv(dev);
 	struct net_device_stats *stats = &dev->stats;
@@ -581,6 +640,7 @@ static int sun4i_can_err(struct net_device *dev, u8 isrc, u8 status)
 		netdev_dbg(dev, "bus error interrupt\n");
 		priv->can.can_stats.bus_error++;
 		stats->rx_errors++;
+		sun4i_can_berr_throttle(priv);
 
 		if (likely(skb)) {
 			ecc = readl(priv->base + SUN4I_REG_STA_ADDR);
@@ -638,10 +698,13 @@ static int sun4i_can_err(struct net_device *dev, u8 isrc, u8 status)
 			can_bus_off(dev);
 	}
 
-	if (likely(skb))
-		netif_rx(skb);
-	else
+	if (likely(skb)) {
+		if (can_rx_offload_queue_timestamp(&priv->offload, skb,
+						   sun4i_can_ts_key(ts)))
+			stats->rx_fifo_errors++;
+	} else {
 		return -ENOMEM;
+	}
 
 	return 0;
 }
@@ -652,19 +715,25 @@ static irqreturn_t sun4i_can_interrupt(int irq, void *dev_id)
 	struct sun4ican_priv *priv = netdev_priv(dev);
 	struct net_device_stats *stats = &dev->stats;
 	u8 isrc, status;
+	ktime_t ts;
 	int n = 0;
 
 	while ((isrc = readl(priv->base + SUN4I_REG_INT_ADDR)) &&
 	       (n < SUN4I_CAN_MAX_IRQ)) {
 		n++;
+		ts = ktime_get();
 		status = readl(priv->base + SUN4I_REG_STA_ADDR);
 
 		if (isrc & SUN4I_INT_WAKEUP)
 			netdev_warn(dev, "wakeup interrupt\n");
 
 		if (isrc & SUN4I_INT_TBUF_VLD) {
+			u32 key = sun4i_can_ts_key(ts);
+
 			/* transmission complete interrupt */
-			stats->tx_bytes += can_get_echo_skb(dev, 0, NULL);
+			stats->tx_bytes +=
+				can_rx_offload_get_echo_skb(&priv->offload, 0,
+							    key, NULL);
 			stats->tx_packets++;
 			netif_wake_queue(dev);
 		}
@@ -673,7 +742,7 @@ static irqreturn_t sun4i_can_interrupt(int irq, void *dev_id)
 			/* receive interrupt - don't read if overrun occurred */
 			while (status & SUN4I_STA_RBUF_RDY) {
 				/* RX buffer is not empty */
-				sun4i_can_rx(dev);
+				sun4i_can_rx(dev, ts);
 				status = readl(priv->base + SUN4I_REG_STA_ADDR);
 			}
 		}
@@ -681,7 +750,7 @@ static irqreturn_t sun4i_can_interrupt(int irq, void *dev_id)
 		    (SUN4I_INT_DATA_OR | SUN4I_INT_ERR_WRN | SUN4I_INT_BUS_ERR |
 		     SUN4I_INT_ERR_PASSIVE | SUN4I_INT_ARB_LOST)) {
 			/* error interrupt */
-			if (sun4i_can_err(dev, isrc, status))
+			if (sun4i_can_err(dev, isrc, status, ts))
 				netdev_err(dev, "can't allocate buffer - clearing pending interrupts\n");
 		}
 		/* clear interrupts */
@@ -691,6 +760,8 @@ static irqreturn_t sun4i_can_interrupt(int irq, void *dev_id)
 	if (n >= SUN4I_CAN_MAX_IRQ)
 		netdev_dbg(dev, "%d messages handled in ISR", n);
 
+	can_rx_offload_irq_finish(&priv->offload);
+
 	return (n) ? IRQ_HANDLED : IRQ_NONE;
 }
 
@@ -704,6 +775,8 @@ static int sun4ican_open(struct net_device *dev)
 	if (err)
 		return err;
 
+	can_rx_offload_enable(&priv->offload);
+
 	/* register interrupt handler */
 	err = request_irq(dev->irq, sun4i_can_interrupt, 0, dev->name, dev);
 	if (err) {
@@ -742,6 +815,7 @@ exit_clock:
 exit_soft_reset:
 	free_irq(dev->irq, dev);
 exit_irq:
+	can_rx_offload_disable(&priv->offload);
 	close_candev(dev);
 	return err;
 }
@@ -752,10 +826,12 @@ static int sun4ican_close(struct net_device *dev)
 
 	netif_stop_queue(dev);
 	sun4i_can_stop(dev);
+	del_timer_sync(&priv->berr_timer);
 	clk_disable_unprepare(priv->clk);
 	reset_control_assert(priv->reset);
 
 	free_irq(dev->irq, dev);
+	can_rx_offload_disable(&priv->offload);
 	close_candev(dev);
 
 	return 0;
@@ -809,8 +885,10 @@ MODULE_DEVICE_TABLE(of, sun4ican_of_match);
 static int sun4ican_remove(struct platform_device *pdev)
 {
 	struct net_device *dev = platform_get_drvdata(pdev);
+	struct sun4ican_priv *priv = netdev_priv(dev);
 
 	unregister_netdev(dev);
+	can_rx_offload_del(&priv->offload);
 	free_candev(dev);
 
 	return 0;
@@ -889,15 +967,21 @@ static int sun4ican_probe(struct platform_device *pdev)
 	priv->reset = reset;
 	priv->acp_offset = quirks->acp_offset;
 	spin_lock_init(&priv->cmdreg_lock);
+	timer_setup(&priv->berr_timer, sun4i_can_berr_timer, 0);
 
 	platform_set_drvdata(pdev, dev);
 	SET_NETDEV_DEV(dev, &pdev->dev);
 
+	err = can_rx_offload_add_manual(dev, &priv->offload,
+					SUN4I_CAN_NAPI_WEIGHT);
+	if (err)
+		goto exit_free;
+
 	err = register_candev(dev);
 	if (err) {
 		dev_err(&pdev->dev, "registering %s failed (err=%d)\n",
 			DRV_NAME, err);
-		goto exit_free;
+		goto exit_rx_offload_del;
 	}
 
 	dev_info(&pdev->dev, "device registered (base=%p, irq=%d)\n",
@@ -905,6 +989,8 @@ static int sun4ican_probe(struct platform_device *pdev)
 
 	return 0;
 
+exit_rx_offload_del:
+	can_rx_offload_del(&priv->offload);
 exit_free:
 	free_candev(dev);
 exit:
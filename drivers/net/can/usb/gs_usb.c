@@ -24,6 +24,7 @@
 #include <linux/can.h>
 #include <linux/can/dev.h>
 #include <linux/can/error.h>
+#include <linux/can/rx-offload.h>
 
 /* Device specific constants */
 #define USB_GS_USB_1_VENDOR_ID 0x1d50
@@ -277,6 +278,9 @@ struct gs_host_frame {
 #define GS_MAX_TX_URBS 10
 /* Only launch a max of GS_MAX_RX_URBS usb requests at a time. */
 #define GS_MAX_RX_URBS 30
+/* Upper bound for the rx_frames_per_urb module parameter. */
+#define GS_MAX_RX_FRAMES_PER_URB 16
+#define GS_NAPI_WEIGHT 32
 /* Maximum number of interfaces the driver supports per device.
  * Current hardware only supports 3 interfaces. The future may vary.
  */
@@ -314,6 +318,8 @@ struct gs_can {
 
 	struct usb_anchor tx_submitted;
 	atomic_t active_tx_urbs;
+
+	struct can_rx_offload offload;
 };
 
 /* usb interface struct */
@@ -325,6 +331,11 @@ struct gs_usb {
 	u8 active_channels;
 };
 
+static unsigned int rx_frames_per_urb = 1;
+module_param(rx_frames_per_urb, uint, 0644);
+MODULE_PARM_DESC(rx_frames_per_urb,
+		 "Host frames per RX URB, for firmware that batches them (default: 1)");
+
 /* 'allocate' a tx context.
  * returns a valid tx context or NULL if there is no space.
  */
@@ -520,45 +531,38 @@ static void gs_usb_set_timestamp(struct gs_can *dev, struct sk_buff *skb,
 	return;
 }
 
-static void gs_usb_receive_bulk_callback(struct urb *urb)
+/* Size of @hf on the wire, as sent by the device for its channel. */
+static unsigned int gs_usb_rx_frame_len(const struct gs_can *dev,
+					const struct gs_host_frame *hf)
 {
-	struct gs_usb *usbcan = urb->context;
-	struct gs_can *dev;
-	struct net_device *netdev;
-	int rc;
-	struct net_device_stats *stats;
-	struct gs_host_frame *hf = urb->transfer_buffer;
+	if (hf->flags & GS_CAN_FLAG_FD) {
+		if (dev->feature & GS_CAN_FEATURE_HW_TIMESTAMP)
+			return struct_size(hf, canfd_ts, 1);
+		return struct_size(hf, canfd, 1);
+	}
+
+	if (dev->feature & GS_CAN_FEATURE_HW_TIMESTAMP)
+		return struct_size(hf, classic_can_ts, 1);
+	return struct_size(hf, classic_can, 1);
+}
+
+/* Turn one host frame into a rx or echo skb for rx-offload. The caller
+ * kicks NAPI once the whole URB has been parsed.
+ */
+static void gs_usb_rx_frame(struct gs_can *dev, const struct gs_host_frame *hf)
+{
+	struct net_device *netdev = dev->netdev;
+	struct net_device_stats *stats = &netdev->stats;
 	struct gs_tx_context *txc;
 	struct can_frame *cf;
 	struct canfd_frame *cfd;
 	struct sk_buff *skb;
-
-	BUG_ON(!usbcan);
-
-	switch (urb->status) {
-	case 0: /* success */
-		break;
-	case -ENOENT:
-	case -ESHUTDOWN:
-		return;
-	default:
-		/* do not resubmit aborted urbs. eg: when device goes down */
-		return;
-	}
-
-	/* device reports out of range channel id */
-	if (hf->channel >= GS_MAX_INTF)
-		goto device_detach;
-
-	dev = usbcan->canch[hf->channel];
-
-	netdev = dev->netdev;
-	stats = &netdev->stats;
-
-	if (!netif_device_present(netdev))
-		return;
+	unsigned int len;
 
 	if (hf->echo_id == -1) { /* normal rx */
+		if (!netif_running(netdev))
+			return;
+
 		if (hf->flags & GS_CAN_FLAG_FD) {
 			skb = alloc_canfd_skb(dev->netdev, &cfd);
 			if (!skb)
@@ -589,16 +593,15 @@ static void gs_usb_receive_bulk_callback(struct urb *urb)
 
 		gs_usb_set_timestamp(dev, skb, hf);
 
-		netdev->stats.rx_packets++;
-		netdev->stats.rx_bytes += hf->can_dlc;
-
-		netif_rx(skb);
+		/* rx-offload accounts rx_packets and rx_bytes */
+		if (can_rx_offload_queue_tail(&dev->offload, skb))
+			stats->rx_fifo_errors++;
 	} else { /* echo_id == hf->echo_id */
 		if (hf->echo_id >= GS_MAX_TX_URBS) {
 			netdev_err(netdev,
 				   "Unexpected out of range echo id %u\n",
 				   hf->echo_id);
-			goto resubmit_urb;
+			return;
 		}
 
 		txc = gs_get_tx_context(dev, hf->echo_id);
@@ -608,15 +611,24 @@ static void gs_usb_receive_bulk_callback(struct urb *urb)
 			netdev_err(netdev,
 				   "Unexpected unused echo id %u\n",
 				   hf->echo_id);
-			goto resubmit_urb;
+			return;
 		}
 
 		skb = dev->can.echo_skb[hf->echo_id];
 		gs_usb_set_timestamp(dev, skb, hf);
 
-		netdev->stats.tx_packets++;
-		netdev->stats.tx_bytes += can_get_echo_skb(netdev, hf->echo_id,
-							   NULL);
+		/* Echoes go through the same NAPI queue as received frames,
+		 * so they stay in order and are delivered in batches.
+		 */
+		skb = __can_get_echo_skb(netdev, hf->echo_id, &len, NULL);
+		if (skb) {
+			stats->tx_packets++;
+			stats->tx_bytes += len;
+			if (can_rx_offload_queue_tail(&dev->offload, skb)) {
+				stats->rx_errors++;
+				stats->tx_fifo_errors++;
+			}
+		}
 
 		gs_free_tx_context(txc);
 
@@ -631,18 +643,83 @@ static void gs_usb_receive_bulk_callback(struct urb *urb)
 
 		skb = alloc_can_err_skb(netdev, &cf);
 		if (!skb)
-			goto resubmit_urb;
+			return;
 
 		cf->can_id |= CAN_ERR_CRTL;
 		cf->len = CAN_ERR_DLC;
 		cf->data[1] = CAN_ERR_CRTL_RX_OVERFLOW;
-		netif_rx(skb);
+		if (can_rx_offload_queue_tail(&dev->offload, skb))
+			stats->rx_fifo_errors++;
+	}
+}
+
+static void gs_usb_rx_offload_finish(struct gs_usb *usbcan,
+				     unsigned long channels)
+{
+	unsigned int i;
+
+	for_each_set_bit(i, &channels, GS_MAX_INTF)
+		can_rx_offload_irq_finish(&usbcan->canch[i]->offload);
+}
+
+static void gs_usb_receive_bulk_callback(struct urb *urb)
+{
+	struct gs_usb *usbcan = urb->context;
+	struct gs_host_frame *hf = urb->transfer_buffer;
+	unsigned long channels = 0;
+	unsigned int offset = 0;
+	struct gs_can *dev;
+	int rc;
+
+	BUG_ON(!usbcan);
+
+	switch (urb->status) {
+	case 0: /* success */
+		break;
+	case -ENOENT:
+	case -ESHUTDOWN:
+		return;
+	default:
+		/* do not resubmit aborted urbs. eg: when device goes down */
+		return;
 	}
 
- resubmit_urb:
+	/* The first frame is handled the way it always was. Firmware that
+	 * packs more frames into one transfer gets them parsed as long as
+	 * they fit completely in what was received.
+	 */
+	do {
+		hf = urb->transfer_buffer + offset;
+
+		/* device reports out of range channel id */
+		if (hf->channel >= GS_MAX_INTF) {
+			gs_usb_rx_offload_finish(usbcan, channels);
+			goto device_detach;
+		}
+
+		dev = usbcan->canch[hf->channel];
+
+		if (offset &&
+		    offset + gs_usb_rx_frame_len(dev, hf) > urb->actual_length)
+			break;
+
+		if (!netif_device_present(dev->netdev)) {
+			gs_usb_rx_offload_finish(usbcan, channels);
+			return;
+		}
+
+		gs_usb_rx_frame(dev, hf);
+		channels |= BIT(hf->channel);
+
+		offset += gs_usb_rx_frame_len(dev, hf);
+	} while (offset + sizeof(*hf) <= urb->actual_length);
+
+	gs_usb_rx_offload_finish(usbcan, channels);
+
+	hf = urb->transfer_buffer;
 	usb_fill_bulk_urb(urb, usbcan->udev,
 			  usb_rcvbulkpipe(usbcan->udev, GS_USB_ENDPOINT_IN),
-			  hf, dev->parent->hf_size_rx,
+			  hf, urb->transfer_buffer_length,
 			  gs_usb_receive_bulk_callback, usbcan);
 
 	rc = usb_submit_urb(urb, GFP_ATOMIC);
@@ -835,6 +912,7 @@ static int gs_can_open(struct net_device *netdev)
 	};
 	struct gs_host_frame *hf;
 	struct urb *urb = NULL;
+	unsigned int rx_size;
 	u32 ctrlmode;
 	u32 flags = 0;
 	int rc, i;
@@ -843,6 +921,8 @@ static int gs_can_open(struct net_device *netdev)
 	if (rc)
 		return rc;
 
+	can_rx_offload_enable(&dev->offload);
+
 	ctrlmode = dev->can.ctrlmode;
 	if (ctrlmode & CAN_CTRLMODE_FD) {
 		flags |= GS_CAN_MODE_FD;
@@ -859,6 +939,9 @@ static int gs_can_open(struct net_device *netdev)
 	}
 
 	if (!parent->active_channels) {
+		rx_size = clamp(rx_frames_per_urb, 1U,
+				GS_MAX_RX_FRAMES_PER_URB) * parent->hf_size_rx;
+
 		for (i = 0; i < GS_MAX_RX_URBS; i++) {
 			u8 *buf;
 
@@ -870,8 +953,7 @@ static int gs_can_open(struct net_device *netdev)
 			}
 
 			/* alloc rx buffer */
-			buf = kmalloc(dev->parent->hf_size_rx,
-				      GFP_KERNEL);
+			buf = kmalloc(rx_size, GFP_KERNEL);
 			if (!buf) {
 				netdev_err(netdev,
 					   "No memory left for USB buffer\n");
@@ -884,8 +966,7 @@ static int gs_can_open(struct net_device *netdev)
 					  dev->udev,
 					  usb_rcvbulkpipe(dev->udev,
 							  GS_USB_ENDPOINT_IN),
-					  buf,
-					  dev->parent->hf_size_rx,
+					  buf, rx_size,
 					  gs_usb_receive_bulk_callback, parent);
 			urb->transfer_flags |= URB_FREE_BUFFER;
 
@@ -963,6 +1044,7 @@ out_usb_kill_anchored_urbs:
 	if (!parent->active_channels)
 		usb_kill_anchored_urbs(&dev->tx_submitted);
 
+	can_rx_offload_disable(&dev->offload);
 	close_candev(netdev);
 
 	return rc;
@@ -990,6 +1072,8 @@ static int gs_can_close(struct net_device *netdev)
 	usb_kill_anchored_urbs(&dev->tx_submitted);
 	atomic_set(&dev->active_tx_urbs, 0);
 
+	can_rx_offload_disable(&dev->offload);
+
 	dev->can.state = CAN_STATE_STOPPED;
 
 	/* reset the device */
@@ -1301,16 +1385,22 @@ static struct gs_can *gs_make_candev(unsigned int channel,
 
 	SET_NETDEV_DEV(netdev, &intf->dev);
 
+	rc = can_rx_offload_add_manual(netdev, &dev->offload, GS_NAPI_WEIGHT);
+	if (rc)
+		goto out_free_candev;
+
 	rc = register_candev(dev->netdev);
 	if (rc) {
 		dev_err(&intf->dev,
 			"Couldn't register candev for channel %d (%pe)\n",
 			channel, ERR_PTR(rc));
-		goto out_free_candev;
+		goto out_rx_offload_del;
 	}
 
 	return dev;
 
+ out_rx_offload_del:
+	can_rx_offload_del(&dev->offload);
  out_free_candev:
 	free_candev(dev->netdev);
 	return ERR_PTR(rc);
@@ -1320,6 +1410,7 @@ static void gs_destroy_candev(struct gs_can *dev)
 {
 	unregister_candev(dev->netdev);
 	usb_kill_anchored_urbs(&dev->tx_submitted);
+	can_rx_offload_del(&dev->offload);
 	free_candev(dev->netdev);
 }
 
@@ -58,14 +58,24 @@
 #undef FRAME_FILTER_DEBUG
 /* #define FRAME_FILTER_DEBUG */
 
+/* Ring occupancy histogram: 0-25%, 25-50%, 50-75%, 75-100% of the ring */
+#define STMMAC_RING_OCC_BUCKETS	4
+
 struct stmmac_txq_stats {
 	unsigned long tx_pkt_n;
 	unsigned long tx_normal_irq_n;
+	unsigned long tx_underflow_irq_n;
+	unsigned long tx_napi_budget_n;
+	unsigned long tx_ring_occ[STMMAC_RING_OCC_BUCKETS];
 };
 
 struct stmmac_rxq_stats {
 	unsigned long rx_pkt_n;
 	unsigned long rx_normal_irq_n;
+	unsigned long rx_buf_unav_irq_n;
+	unsigned long rx_napi_budget_n;
+	unsigned long rx_refill_deferred_n;
+	unsigned long rx_ring_occ[STMMAC_RING_OCC_BUCKETS];
 };
 
 /* Extra statistic and debug information exposed by ethtool */
@@ -292,6 +302,9 @@ struct stmmac_safety_stats {
 #define STMMAC_TX_MAX_FRAMES	256
 #define STMMAC_TX_FRAMES	25
 #define STMMAC_RX_FRAMES	0
+/* SW Rx coalesce parameters, for cores without RI Watchdog */
+#define STMMAC_COAL_RX_TIMER	0
+#define STMMAC_MAX_COAL_RX_TICK	10000
 
 /* Packets types */
 enum packets_types {
@@ -19,7 +19,9 @@
 #include <linux/pm_runtime.h>
 #include <linux/regulator/consumer.h>
 #include <linux/regmap.h>
+#include <linux/soc/sunxi/sunxi_mbus.h>
 #include <linux/stmmac.h>
+#include <linux/suspend.h>
 
 #include "stmmac.h"
 #include "stmmac_platform.h"
@@ -79,6 +81,11 @@ struct sunxi_priv_data {
 	bool internal_phy_powered;
 	bool use_internal_phy;
 	void *mux_handle;
+	struct sunxi_mbus_bw_req bw_req;
+	/* MAC left running as wakeup source, registers to restore */
+	bool wol_armed;
+	u32 wol_frm_flt;
+	u32 wol_int_en;
 };
 
 /* EMAC clock register @ 0x30 in the "system control" address range */
@@ -193,6 +200,7 @@ static const struct emac_variant emac_variant_h6 = {
 #define EMAC_FRM_FLT_RXALL              BIT(0)
 #define EMAC_FRM_FLT_CTL                BIT(13)
 #define EMAC_FRM_FLT_MULTICAST          BIT(16)
+#define EMAC_FRM_FLT_NOBCAST            BIT(17)
 
 /* Used in RX_CTL1*/
 #define EMAC_RX_MD              BIT(1)
@@ -446,6 +454,7 @@ static int sun8i_dwmac_dma_interrupt(void __iomem *ioaddr,
 	if (v & EMAC_TX_INT) {
 		ret |= handle_tx;
 		x->tx_normal_irq_n++;
+		x->txq_stats[chan].tx_normal_irq_n++;
 	}
 
 	if (v & EMAC_TX_DMA_STOP_INT)
@@ -460,6 +469,7 @@ static int sun8i_dwmac_dma_interrupt(void __iomem *ioaddr,
 	if (v & EMAC_TX_UNDERFLOW_INT) {
 		ret |= tx_hard_error;
 		x->tx_undeflow_irq++;
+		x->txq_stats[chan].tx_underflow_irq_n++;
 	}
 
 	if (v & EMAC_TX_EARLY_INT)
@@ -468,10 +478,13 @@ static int sun8i_dwmac_dma_interrupt(void __iomem *ioaddr,
 	if (v & EMAC_RX_INT) {
 		ret |= handle_rx;
 		x->rx_normal_irq_n++;
+		x->rxq_stats[chan].rx_normal_irq_n++;
 	}
 
-	if (v & EMAC_RX_BUF_UA_INT)
+	if (v & EMAC_RX_BUF_UA_INT) {
 		x->rx_buf_unav_irq++;
+		x->rxq_stats[chan].rx_buf_unav_irq_n++;
+	}
 
 	if (v & EMAC_RX_DMA_STOP_INT)
 		x->rx_process_stopped_irq++;
@@ -1036,10 +1049,24 @@ static void sun8i_dwmac_unset_syscon(struct sunxi_priv_data *gmac)
 	regmap_field_write(gmac->regmap_field, reg);
 }
 
+/* Let the DRAM clock follow the link rate, in both directions */
+static void sun8i_dwmac_fix_speed(void *priv, unsigned int speed)
+{
+	struct sunxi_priv_data *gmac = priv;
+	u32 kBps = speed * 2 * 1000 / 8;
+
+	if (gmac->bw_req.active)
+		sunxi_mbus_bw_update_request(&gmac->bw_req, kBps);
+	else
+		sunxi_mbus_bw_add_request(&gmac->bw_req, kBps);
+}
+
 static void sun8i_dwmac_exit(struct platform_device *pdev, void *priv)
 {
 	struct sunxi_priv_data *gmac = priv;
 
+	sunxi_mbus_bw_remove_request(&gmac->bw_req);
+
 	if (gmac->variant->soc_has_internal_phy)
 		sun8i_dwmac_unpower_internal_phy(gmac);
 
@@ -1047,6 +1074,70 @@ static void sun8i_dwmac_exit(struct platform_device *pdev, void *priv)
 	regulator_disable(gmac->regulator_phy_io);
 }
 
+#ifdef CONFIG_PM_SLEEP
+/* The EMAC has no PMT block to match wake frames while stopped. For
+ * suspend-to-idle keep it running instead: PHY powered, link up, DMA
+ * rings in place, and let the first received frame raise the RX
+ * interrupt that wakes the system. That frame is then delivered as
+ * usual, and resume does not wait for reset and autonegotiation.
+ */
+static int sun8i_dwmac_suspend(struct device *dev, void *priv)
+{
+	struct sunxi_priv_data *gmac = priv;
+	struct net_device *ndev = dev_get_drvdata(dev);
+	struct stmmac_priv *spriv = netdev_priv(ndev);
+	void __iomem *ioaddr = spriv->ioaddr;
+	u32 v;
+
+	if (!netif_running(ndev) || !device_may_wakeup(dev) ||
+	    !spriv->wolopts || pm_suspend_target_state != PM_SUSPEND_TO_IDLE)
+		return 0;
+
+	netif_device_detach(ndev);
+
+	/* Only the perfect filter slots, starting with our own address.
+	 * Magic packets can't be matched in hardware; they are mostly
+	 * broadcast, so let broadcast wake us too and the stack sort it out.
+	 */
+	gmac->wol_frm_flt = readl(ioaddr + EMAC_RX_FRM_FLT);
+	v = EMAC_FRM_FLT_CTL;
+	if (!(spriv->wolopts & WAKE_MAGIC))
+		v |= EMAC_FRM_FLT_NOBCAST;
+	writel(v, ioaddr + EMAC_RX_FRM_FLT);
+
+	gmac->wol_int_en = readl(ioaddr + EMAC_INT_EN);
+	writel(EMAC_RX_INT, ioaddr + EMAC_INT_EN);
+
+	/* stmmac_set_wol() already armed the interrupt for wakeup */
+	spriv->irq_wake = 1;
+	gmac->wol_armed = true;
+
+	return 1;
+}
+
+static int sun8i_dwmac_resume(struct device *dev, void *priv)
+{
+	struct sunxi_priv_data *gmac = priv;
+	struct net_device *ndev = dev_get_drvdata(dev);
+	struct stmmac_priv *spriv = netdev_priv(ndev);
+	void __iomem *ioaddr = spriv->ioaddr;
+
+	if (!gmac->wol_armed)
+		return 0;
+
+	gmac->wol_armed = false;
+	spriv->irq_wake = 0;
+
+	writel(gmac->wol_frm_flt, ioaddr + EMAC_RX_FRM_FLT);
+	writel(gmac->wol_int_en | EMAC_RX_INT | EMAC_TX_INT,
+	       ioaddr + EMAC_INT_EN);
+
+	netif_device_attach(ndev);
+
+	return 1;
+}
+#endif
+
 static void sun8i_dwmac_set_mac_loopback(void __iomem *ioaddr, bool enable)
 {
 	u32 value = readl(ioaddr + EMAC_BASIC_CTL0);
@@ -1233,10 +1324,19 @@ static int sun8i_dwmac_probe(struct platform_device *pdev)
 	plat_dat->rx_coe = STMMAC_RX_COE_TYPE2;
 	plat_dat->tx_coe = 1;
 	plat_dat->has_sun8i = true;
+	/* No TSO engine: let the driver segment TCP on its own */
+	plat_dat->sw_tso_en = true;
 	plat_dat->bsp_priv = gmac;
 	plat_dat->init = sun8i_dwmac_init;
 	plat_dat->exit = sun8i_dwmac_exit;
 	plat_dat->setup = sun8i_dwmac_setup;
+	plat_dat->fix_mac_speed = sun8i_dwmac_fix_speed;
+#ifdef CONFIG_PM_SLEEP
+	plat_dat->suspend = sun8i_dwmac_suspend;
+	plat_dat->resume = sun8i_dwmac_resume;
+#endif
+	/* wake on LAN through the RX interrupt, see sun8i_dwmac_suspend() */
+	plat_dat->pmt = 1;
 	plat_dat->tx_fifo_size = 4096;
 	plat_dat->rx_fifo_size = 16384;
 
@@ -1354,6 +1454,8 @@ static struct platform_driver sun8i_dwmac_driver = {
 		.name           = "dwmac-sun8i",
 		.pm		= &stmmac_pltfr_pm_ops,
 		.of_match_table = sun8i_dwmac_match,
+		/* network critical: never queue behind asynchronous probes */
+		.probe_type	= PROBE_FORCE_SYNCHRONOUS,
 	},
 };
 module_platform_driver(sun8i_dwmac_driver);
@@ -185,6 +185,11 @@ static int dwmac4_get_tx_owner(struct dma_desc *p)
 	return (le32_to_cpu(p->des3) & TDES3_OWN) >> TDES3_OWN_SHIFT;
 }
 
+static int dwmac4_get_rx_owner(struct dma_desc *p)
+{
+	return (le32_to_cpu(p->des3) & RDES3_OWN) >> 31;
+}
+
 static void dwmac4_set_tx_owner(struct dma_desc *p)
 {
 	p->des3 |= cpu_to_le32(TDES3_OWN);
@@ -554,6 +559,7 @@ const struct stmmac_desc_ops dwmac4_desc_ops = {
 	.rx_status = dwmac4_wrback_get_rx_status,
 	.get_tx_len = dwmac4_rd_get_tx_len,
 	.get_tx_owner = dwmac4_get_tx_owner,
+	.get_rx_owner = dwmac4_get_rx_owner,
 	.set_tx_owner = dwmac4_set_tx_owner,
 	.set_rx_owner = dwmac4_set_rx_owner,
 	.get_tx_ls = dwmac4_get_tx_ls,
@@ -287,6 +287,11 @@ static int enh_desc_get_tx_owner(struct dma_desc *p)
 	return (le32_to_cpu(p->des0) & ETDES0_OWN) >> 31;
 }
 
+static int enh_desc_get_rx_owner(struct dma_desc *p)
+{
+	return (le32_to_cpu(p->des0) & RDES0_OWN) >> 31;
+}
+
 static void enh_desc_set_tx_owner(struct dma_desc *p)
 {
 	p->des0 |= cpu_to_le32(ETDES0_OWN);
@@ -457,6 +462,7 @@ const struct stmmac_desc_ops enh_desc_ops = {
 	.init_rx_desc = enh_desc_init_rx_desc,
 	.init_tx_desc = enh_desc_init_tx_desc,
 	.get_tx_owner = enh_desc_get_tx_owner,
+	.get_rx_owner = enh_desc_get_rx_owner,
 	.release_tx_desc = enh_desc_release_tx_desc,
 	.prepare_tx_desc = enh_desc_prepare_tx_desc,
 	.set_tx_ic = enh_desc_set_tx_ic,
@@ -155,6 +155,11 @@ static int ndesc_get_tx_owner(struct dma_desc *p)
 	return (le32_to_cpu(p->des0) & TDES0_OWN) >> 31;
 }
 
+static int ndesc_get_rx_owner(struct dma_desc *p)
+{
+	return (le32_to_cpu(p->des0) & RDES0_OWN) >> 31;
+}
+
 static void ndesc_set_tx_owner(struct dma_desc *p)
 {
 	p->des0 |= cpu_to_le32(TDES0_OWN);
@@ -309,6 +314,7 @@ const struct stmmac_desc_ops ndesc_ops = {
 	.init_rx_desc = ndesc_init_rx_desc,
 	.init_tx_desc = ndesc_init_tx_desc,
 	.get_tx_owner = ndesc_get_tx_owner,
+	.get_rx_owner = ndesc_get_rx_owner,
 	.release_tx_desc = ndesc_release_tx_desc,
 	.prepare_tx_desc = ndesc_prepare_tx_desc,
 	.set_tx_ic = ndesc_set_tx_ic,
@@ -12,6 +12,7 @@
 #define STMMAC_RESOURCE_NAME   "stmmaceth"
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/hrtimer.h>
 #include <linux/if_vlan.h>
 #include <linux/stmmac.h>
@@ -41,6 +42,7 @@ enum stmmac_txbuf_type {
 	STMMAC_TXBUF_T_XDP_TX,
 	STMMAC_TXBUF_T_XDP_NDO,
 	STMMAC_TXBUF_T_XSK_TX,
+	STMMAC_TXBUF_T_NETPOLL,
 };
 
 struct stmmac_tx_info {
@@ -77,6 +79,9 @@ struct stmmac_tx_queue {
 	dma_addr_t dma_tx_phy;
 	dma_addr_t tx_tail_addr;
 	u32 mss;
+	/* Per-entry header buffers for software TSO */
+	char *tso_hdrs;
+	dma_addr_t tso_hdrs_phy;
 };
 
 struct stmmac_rx_buffer {
@@ -100,6 +105,7 @@ struct stmmac_rx_queue {
 	struct page_pool *page_pool;
 	struct stmmac_rx_buffer *buf_pool;
 	struct stmmac_priv *priv_data;
+	unsigned int frag_sz;
 	struct dma_extended_desc *dma_erx;
 	struct dma_desc *dma_rx ____cacheline_aligned_in_smp;
 	unsigned int cur_rx;
@@ -114,6 +120,19 @@ struct stmmac_rx_queue {
 		unsigned int len;
 		unsigned int error;
 	} state;
+	/* Early software RX timestamp, see stmmac_rx_irq_tstamp() */
+	ktime_t irq_tstamp;		/* CLOCK_MONOTONIC */
+	unsigned int irq_tstamp_cnt;
+	bool irq_tstamp_skb;		/* also use it for skb->tstamp */
+};
+
+/* Adaptive interrupt moderation (lib/dim) state of one direction */
+struct stmmac_net_dim {
+	u16 use_dim;
+	u16 event_ctr;
+	unsigned long packets;
+	unsigned long bytes;
+	struct dim dim;
 };
 
 struct stmmac_channel {
@@ -123,6 +142,12 @@ struct stmmac_channel {
 	struct stmmac_priv *priv_data;
 	spinlock_t lock;
 	u32 index;
+	struct stmmac_net_dim rx_dim;
+	struct stmmac_net_dim tx_dim;
+	/* SW RX interrupt hold-off for cores without RIWT */
+	struct hrtimer rx_holdoff_timer;
+	/* TX IRQ left masked while RX NAPI is busy polled, protected by lock */
+	bool tx_irq_busy_poll;
 };
 
 struct stmmac_tc_entry {
@@ -205,10 +230,14 @@ struct stmmac_priv {
 	u32 tx_coal_frames[MTL_MAX_TX_QUEUES];
 	u32 tx_coal_timer[MTL_MAX_TX_QUEUES];
 	u32 rx_coal_frames[MTL_MAX_TX_QUEUES];
+	u32 rx_coal_timer[MTL_MAX_RX_QUEUES];
 
 	int hwts_tx_en;
 	bool tx_path_in_lpi_mode;
 	bool tso;
+	bool sw_tso;
+	/* No TX COE: stmmac_xmit() computes L4 checksums itself */
+	bool sw_csum;
 	int sph;
 	int sph_cap;
 	u32 sarc_type;
@@ -324,6 +353,14 @@ struct stmmac_priv {
 	/* XDP BPF Program */
 	unsigned long *af_xdp_zc_qps;
 	struct bpf_prog *xdp_prog;
+
+#ifdef CONFIG_NET_POLL_CONTROLLER
+	/* Bounce buffers for netpoll TX, used in order on queue 0 */
+	void *np_buf;
+	dma_addr_t np_buf_dma;
+	unsigned int np_next;
+	unsigned int np_inflight;
+#endif
 };
 
 enum stmmac_state {
@@ -355,6 +392,10 @@ bool stmmac_eee_init(struct stmmac_priv *priv);
 int stmmac_reinit_queues(struct net_device *dev, u32 rx_cnt, u32 tx_cnt);
 int stmmac_reinit_ringparam(struct net_device *dev, u32 rx_size, u32 tx_size);
 int stmmac_bus_clks_config(struct stmmac_priv *priv, bool enabled);
+void stmmac_set_rx_coalesce(struct stmmac_priv *priv, u32 queue, u32 usecs,
+			    u32 frames);
+void stmmac_set_tx_coalesce(struct stmmac_priv *priv, u32 queue, u32 usecs,
+			    u32 frames);
 void stmmac_fpe_handshake(struct stmmac_priv *priv, bool enable);
 
 static inline bool stmmac_xdp_is_enabled(struct stmmac_priv *priv)
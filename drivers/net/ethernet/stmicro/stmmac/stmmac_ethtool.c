@@ -14,6 +14,7 @@
 #include <linux/mii.h>
 #include <linux/phylink.h>
 #include <linux/net_tstamp.h>
+#include <net/page_pool.h>
 #include <asm/io.h>
 
 #include "stmmac.h"
@@ -272,12 +273,25 @@ static const struct stmmac_stats stmmac_mmc[] = {
 static const char stmmac_qstats_tx_string[][ETH_GSTRING_LEN] = {
 	"tx_pkt_n",
 	"tx_irq_n",
+	"tx_underflow_irq_n",
+	"tx_napi_budget_n",
+	"tx_ring_occ_0_25",
+	"tx_ring_occ_25_50",
+	"tx_ring_occ_50_75",
+	"tx_ring_occ_75_100",
 #define STMMAC_TXQ_STATS ARRAY_SIZE(stmmac_qstats_tx_string)
 };
 
 static const char stmmac_qstats_rx_string[][ETH_GSTRING_LEN] = {
 	"rx_pkt_n",
 	"rx_irq_n",
+	"rx_buf_unav_irq_n",
+	"rx_napi_budget_n",
+	"rx_refill_deferred_n",
+	"rx_ring_occ_0_25",
+	"rx_ring_occ_25_50",
+	"rx_ring_occ_50_75",
+	"rx_ring_occ_75_100",
 #define STMMAC_RXQ_STATS ARRAY_SIZE(stmmac_qstats_rx_string)
 };
 
@@ -565,6 +579,24 @@ static void stmmac_get_per_qstats(struct stmmac_priv *priv, u64 *data)
 	}
 }
 
+/* One set of page_pool counters, summed over the RX queues */
+static void stmmac_get_pp_stats(struct stmmac_priv *priv, u64 *data)
+{
+#ifdef CONFIG_PAGE_POOL_STATS
+	struct page_pool_stats stats = {};
+	u32 q;
+
+	for (q = 0; q < priv->plat->rx_queues_to_use; q++) {
+		struct page_pool *pool = priv->dma_conf.rx_queue[q].page_pool;
+
+		if (pool)
+			page_pool_get_stats(pool, &stats);
+	}
+
+	page_pool_ethtool_stats_get(data, &stats);
+#endif
+}
+
 static void stmmac_get_ethtool_stats(struct net_device *dev,
 				 struct ethtool_stats *dummy, u64 *data)
 {
@@ -616,6 +648,9 @@ static void stmmac_get_ethtool_stats(struct net_device *dev,
 			     sizeof(u64)) ? (*(u64 *)p) : (*(u32 *)p);
 	}
 	stmmac_get_per_qstats(priv, &data[j]);
+	j += STMMAC_TXQ_STATS * tx_queues_count +
+	     STMMAC_RXQ_STATS * rx_queues_count;
+	stmmac_get_pp_stats(priv, &data[j]);
 }
 
 static int stmmac_get_sset_count(struct net_device *netdev, int sset)
@@ -629,7 +664,8 @@ static int stmmac_get_sset_count(struct net_device *netdev, int sset)
 	case ETH_SS_STATS:
 		len = STMMAC_STATS_LEN +
 		      STMMAC_TXQ_STATS * tx_cnt +
-		      STMMAC_RXQ_STATS * rx_cnt;
+		      STMMAC_RXQ_STATS * rx_cnt +
+		      page_pool_ethtool_stats_get_count();
 
 		if (priv->dma_cap.rmon)
 			len += STMMAC_MMC_STATS_LEN;
@@ -705,6 +741,10 @@ static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 			p += ETH_GSTRING_LEN;
 		}
 		stmmac_get_qstats_string(priv, p);
+		p += (STMMAC_TXQ_STATS * priv->plat->tx_queues_to_use +
+		      STMMAC_RXQ_STATS * priv->plat->rx_queues_to_use) *
+		     ETH_GSTRING_LEN;
+		page_pool_ethtool_stats_get_strings(p);
 		break;
 	case ETH_SS_TEST:
 		stmmac_selftest_get_strings(priv, p);
@@ -851,6 +891,45 @@ static u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv)
 	return (riwt * 256) / (clk / 1000000);
 }
 
+/**
+ * stmmac_set_rx_coalesce - program the RX interrupt moderation of a queue
+ * @priv: driver private structure
+ * @queue: RX queue index
+ * @usecs: interrupt delay in usecs
+ * @frames: frames per interrupt, only used by cores with RI Watchdog
+ * Description: used by ethtool and by the adaptive (dim) moderation. Cores
+ * without RI Watchdog get a SW hold-off timer instead.
+ */
+void stmmac_set_rx_coalesce(struct stmmac_priv *priv, u32 queue, u32 usecs,
+			    u32 frames)
+{
+	if (priv->use_riwt) {
+		u32 rx_riwt = clamp_t(u32, stmmac_usec2riwt(usecs, priv),
+				      MIN_DMA_RIWT, MAX_DMA_RIWT);
+
+		priv->rx_riwt[queue] = rx_riwt;
+		stmmac_rx_watchdog(priv, priv->ioaddr, rx_riwt, queue);
+		priv->rx_coal_frames[queue] = frames;
+	} else {
+		priv->rx_coal_timer[queue] = min_t(u32, usecs,
+						   STMMAC_MAX_COAL_RX_TICK);
+	}
+}
+
+/**
+ * stmmac_set_tx_coalesce - program the TX interrupt moderation of a queue
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * @usecs: TX mitigation timer in usecs
+ * @frames: frames per TX completion interrupt
+ */
+void stmmac_set_tx_coalesce(struct stmmac_priv *priv, u32 queue, u32 usecs,
+			    u32 frames)
+{
+	priv->tx_coal_timer[queue] = min_t(u32, usecs, STMMAC_MAX_COAL_TX_TICK);
+	priv->tx_coal_frames[queue] = min_t(u32, frames, STMMAC_TX_MAX_FRAMES);
+}
+
 static int __stmmac_get_coalesce(struct net_device *dev,
 				 struct ethtool_coalesce *ec,
 				 int queue)
@@ -872,6 +951,8 @@ static int __stmmac_get_coalesce(struct net_device *dev,
 	if (queue < tx_cnt) {
 		ec->tx_coalesce_usecs = priv->tx_coal_timer[queue];
 		ec->tx_max_coalesced_frames = priv->tx_coal_frames[queue];
+		ec->use_adaptive_tx_coalesce =
+			priv->channel[queue].tx_dim.use_dim;
 	} else {
 		ec->tx_coalesce_usecs = 0;
 		ec->tx_max_coalesced_frames = 0;
@@ -881,11 +962,18 @@ static int __stmmac_get_coalesce(struct net_device *dev,
 		ec->rx_max_coalesced_frames = priv->rx_coal_frames[queue];
 		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt[queue],
 							 priv);
+	} else if (queue < rx_cnt) {
+		ec->rx_max_coalesced_frames = 0;
+		ec->rx_coalesce_usecs = priv->rx_coal_timer[queue];
 	} else {
 		ec->rx_max_coalesced_frames = 0;
 		ec->rx_coalesce_usecs = 0;
 	}
 
+	if (queue < rx_cnt)
+		ec->use_adaptive_rx_coalesce =
+			priv->channel[queue].rx_dim.use_dim;
+
 	return 0;
 }
 
@@ -903,6 +991,63 @@ static int stmmac_get_per_queue_coalesce(struct net_device *dev, u32 queue,
 	return __stmmac_get_coalesce(dev, ec, queue);
 }
 
+static void stmmac_set_queue_rx_coalesce(struct stmmac_priv *priv,
+					 struct ethtool_coalesce *ec,
+					 u32 queue)
+{
+	struct stmmac_net_dim *ndim = &priv->channel[queue].rx_dim;
+	struct dim_cq_moder moder;
+
+	if (ec->use_adaptive_rx_coalesce) {
+		if (!ndim->use_dim) {
+			moder = net_dim_get_rx_moderation(ndim->dim.mode,
+							  ndim->dim.profile_ix);
+			stmmac_set_rx_coalesce(priv, queue, moder.usec,
+					       moder.pkts);
+			ndim->use_dim = true;
+		}
+		return;
+	}
+
+	if (ndim->use_dim) {
+		ndim->use_dim = false;
+		cancel_work_sync(&ndim->dim.work);
+	}
+
+	if (priv->use_riwt && !ec->rx_coalesce_usecs)
+		return;
+
+	stmmac_set_rx_coalesce(priv, queue, ec->rx_coalesce_usecs,
+			       ec->rx_max_coalesced_frames);
+}
+
+static void stmmac_set_queue_tx_coalesce(struct stmmac_priv *priv,
+					 struct ethtool_coalesce *ec,
+					 u32 queue)
+{
+	struct stmmac_net_dim *ndim = &priv->channel[queue].tx_dim;
+	struct dim_cq_moder moder;
+
+	if (ec->use_adaptive_tx_coalesce) {
+		if (!ndim->use_dim) {
+			moder = net_dim_get_tx_moderation(ndim->dim.mode,
+							  ndim->dim.profile_ix);
+			stmmac_set_tx_coalesce(priv, queue, moder.usec,
+					       moder.pkts);
+			ndim->use_dim = true;
+		}
+		return;
+	}
+
+	if (ndim->use_dim) {
+		ndim->use_dim = false;
+		cancel_work_sync(&ndim->dim.work);
+	}
+
+	stmmac_set_tx_coalesce(priv, queue, ec->tx_coalesce_usecs,
+			       ec->tx_max_coalesced_frames);
+}
+
 static int __stmmac_set_coalesce(struct net_device *dev,
 				 struct ethtool_coalesce *ec,
 				 int queue)
@@ -913,6 +1058,7 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 	u32 max_cnt;
 	u32 rx_cnt;
 	u32 tx_cnt;
+	u32 i;
 
 	rx_cnt = priv->plat->rx_queues_to_use;
 	tx_cnt = priv->plat->tx_queues_to_use;
@@ -923,53 +1069,36 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 	else if (queue >= max_cnt)
 		return -EINVAL;
 
-	if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
-		rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
+	if (!ec->use_adaptive_rx_coalesce) {
+		if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
+			rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
 
-		if ((rx_riwt > MAX_DMA_RIWT) || (rx_riwt < MIN_DMA_RIWT))
+			if ((rx_riwt > MAX_DMA_RIWT) || (rx_riwt < MIN_DMA_RIWT))
+				return -EINVAL;
+		} else if (!priv->use_riwt &&
+			   ec->rx_coalesce_usecs > STMMAC_MAX_COAL_RX_TICK) {
 			return -EINVAL;
-
-		if (all_queues) {
-			int i;
-
-			for (i = 0; i < rx_cnt; i++) {
-				priv->rx_riwt[i] = rx_riwt;
-				stmmac_rx_watchdog(priv, priv->ioaddr,
-						   rx_riwt, i);
-				priv->rx_coal_frames[i] =
-					ec->rx_max_coalesced_frames;
-			}
-		} else if (queue < rx_cnt) {
-			priv->rx_riwt[queue] = rx_riwt;
-			stmmac_rx_watchdog(priv, priv->ioaddr,
-					   rx_riwt, queue);
-			priv->rx_coal_frames[queue] =
-				ec->rx_max_coalesced_frames;
 		}
 	}
 
-	if ((ec->tx_coalesce_usecs == 0) &&
-	    (ec->tx_max_coalesced_frames == 0))
-		return -EINVAL;
+	if (!ec->use_adaptive_tx_coalesce) {
+		if ((ec->tx_coalesce_usecs == 0) &&
+		    (ec->tx_max_coalesced_frames == 0))
+			return -EINVAL;
 
-	if ((ec->tx_coalesce_usecs > STMMAC_MAX_COAL_TX_TICK) ||
-	    (ec->tx_max_coalesced_frames > STMMAC_TX_MAX_FRAMES))
-		return -EINVAL;
+		if ((ec->tx_coalesce_usecs > STMMAC_MAX_COAL_TX_TICK) ||
+		    (ec->tx_max_coalesced_frames > STMMAC_TX_MAX_FRAMES))
+			return -EINVAL;
+	}
 
-	if (all_queues) {
-		int i;
+	for (i = 0; i < max_cnt; i++) {
+		if (!all_queues && i != queue)
+			continue;
 
-		for (i = 0; i < tx_cnt; i++) {
-			priv->tx_coal_frames[i] =
-				ec->tx_max_coalesced_frames;
-			priv->tx_coal_timer[i] =
-				ec->tx_coalesce_usecs;
-		}
-	} else if (queue < tx_cnt) {
-		priv->tx_coal_frames[queue] =
-			ec->tx_max_coalesced_frames;
-		priv->tx_coal_timer[queue] =
-			ec->tx_coalesce_usecs;
+		if (i < rx_cnt)
+			stmmac_set_queue_rx_coalesce(priv, ec, i);
+		if (i < tx_cnt)
+			stmmac_set_queue_tx_coalesce(priv, ec, i);
 	}
 
 	return 0;
@@ -1157,7 +1286,8 @@ static int stmmac_set_tunable(struct net_device *dev,
 
 static const struct ethtool_ops stmmac_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.begin = stmmac_check_if_running,
 	.get_drvinfo = stmmac_ethtool_getdrvinfo,
 	.get_msglevel = stmmac_ethtool_getmsglevel,
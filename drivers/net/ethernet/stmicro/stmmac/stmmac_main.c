@@ -27,6 +27,7 @@
 #include <linux/if.h>
 #include <linux/if_vlan.h>
 #include <linux/dma-mapping.h>
+#include <linux/highmem.h>
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
 #include <linux/prefetch.h>
@@ -36,14 +37,19 @@
 #include <linux/seq_file.h>
 #endif /* CONFIG_DEBUG_FS */
 #include <linux/net_tstamp.h>
+#include <linux/netpoll.h>
 #include <linux/phylink.h>
 #include <linux/udp.h>
 #include <linux/bpf_trace.h>
 #include <net/pkt_cls.h>
+#include <net/pkt_latency.h>
+#include <net/tso.h>
 #include <net/xdp_sock_drv.h>
 #include "stmmac_ptp.h"
 #include "stmmac.h"
 #include "stmmac_xdp.h"
+#define CREATE_TRACE_POINTS
+#include "stmmac_trace.h"
 #include <linux/reset.h>
 #include <linux/of_mdio.h>
 #include "dwmac1000.h"
@@ -77,11 +83,18 @@ MODULE_PARM_DESC(phyaddr, "Physical device address");
 #define STMMAC_TX_THRESH(x)	((x)->dma_conf.dma_tx_size / 4)
 #define STMMAC_RX_THRESH(x)	((x)->dma_conf.dma_rx_size / 4)
 
+/* netpoll TX bounce buffers, see stmmac_netpoll_xmit() */
+#define STMMAC_NETPOLL_BUFS	16
+#define STMMAC_NETPOLL_BUF_SZ	1536
+
 /* Limit to make sure XDP TX and slow path can coexist */
 #define STMMAC_XSK_TX_BUDGET_MAX	256
 #define STMMAC_TX_XSK_AVAIL		16
 #define STMMAC_RX_FILL_BATCH		16
 
+/* Size of one RX buffer when a page_pool page is split between descriptors */
+#define STMMAC_RX_FRAG_SZ		SZ_2K
+
 #define STMMAC_XDP_PASS		0
 #define STMMAC_XDP_CONSUMED	BIT(0)
 #define STMMAC_XDP_TX		BIT(1)
@@ -106,6 +119,8 @@ module_param(buf_sz, int, 0644);
 MODULE_PARM_DESC(buf_sz, "DMA buffer size");
 
 #define	STMMAC_RX_COPYBREAK	256
+/* Max headers pulled into the linear part of a zero-copy RX skb */
+#define	STMMAC_RX_HDR_LEN	256
 
 static const u32 default_msg_level = (NETIF_MSG_DRV | NETIF_MSG_PROBE |
 				      NETIF_MSG_LINK | NETIF_MSG_IFUP |
@@ -124,6 +139,16 @@ static unsigned int chain_mode;
 module_param(chain_mode, int, 0444);
 MODULE_PARM_DESC(chain_mode, "To use chain instead of ring mode");
 
+/* Take software RX timestamps in the DMA interrupt rather than leaving them
+ * to the stack, which only stamps the frames once NAPI gets to them
+ */
+static bool early_rx_tstamp;
+module_param(early_rx_tstamp, bool, 0644);
+MODULE_PARM_DESC(early_rx_tstamp, "Software RX timestamps at interrupt time");
+
+/* Most RX descriptors looked at in hard IRQ context for early_rx_tstamp */
+#define STMMAC_RX_TSTAMP_SCAN	64
+
 static irqreturn_t stmmac_interrupt(int irq, void *dev_id);
 /* For MSI interrupts handling */
 static irqreturn_t stmmac_mac_interrupt(int irq, void *dev_id);
@@ -135,6 +160,8 @@ static void stmmac_reset_tx_queue(struct stmmac_priv *priv, u32 queue);
 static void stmmac_reset_queues_param(struct stmmac_priv *priv);
 static void stmmac_tx_timer_arm(struct stmmac_priv *priv, u32 queue);
 static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue);
+static struct xsk_buff_pool *stmmac_get_xsk_pool(struct stmmac_priv *priv,
+						u32 queue);
 static void stmmac_set_dma_operation_mode(struct stmmac_priv *priv, u32 txmode,
 					  u32 rxmode, u32 chan);
 
@@ -218,10 +245,15 @@ static void __stmmac_disable_all_queues(struct stmmac_priv *priv)
 			continue;
 		}
 
-		if (queue < rx_queues_cnt)
+		if (queue < rx_queues_cnt) {
 			napi_disable(&ch->rx_napi);
-		if (queue < tx_queues_cnt)
+			hrtimer_cancel(&ch->rx_holdoff_timer);
+			cancel_work_sync(&ch->rx_dim.dim.work);
+		}
+		if (queue < tx_queues_cnt) {
 			napi_disable(&ch->tx_napi);
+			cancel_work_sync(&ch->tx_dim.dim.work);
+		}
 	}
 }
 
@@ -374,6 +406,21 @@ static inline u32 stmmac_tx_avail(struct stmmac_priv *priv, u32 queue)
 	return avail;
 }
 
+/**
+ * stmmac_ring_occ_update - account one ring occupancy sample
+ * @hist: per-queue histogram, STMMAC_RING_OCC_BUCKETS entries
+ * @used: descriptors in use
+ * @size: ring size
+ */
+static inline void stmmac_ring_occ_update(unsigned long *hist,
+					  unsigned int used,
+					  unsigned int size)
+{
+	unsigned int bucket = used * STMMAC_RING_OCC_BUCKETS / size;
+
+	hist[min_t(unsigned int, bucket, STMMAC_RING_OCC_BUCKETS - 1)]++;
+}
+
 /**
  * stmmac_rx_dirty - Get RX queue dirty
  * @priv: driver private structure
@@ -1352,20 +1399,30 @@ static void stmmac_clear_rx_descriptors(struct stmmac_priv *priv,
 					u32 queue)
 {
 	struct stmmac_rx_queue *rx_q = &dma_conf->rx_queue[queue];
+	struct xsk_buff_pool *xsk_pool = stmmac_get_xsk_pool(priv, queue);
+	unsigned int buf_sz = dma_conf->dma_buf_sz;
 	int i;
 
+	/* Cores without a DMA level buffer size (e.g. sun8i) only know
+	 * the size advertised by the descriptor: it must not exceed the
+	 * XSK frame.
+	 */
+	if (xsk_pool)
+		buf_sz = min_t(unsigned int, buf_sz,
+			       xsk_pool_get_rx_frame_size(xsk_pool));
+
 	/* Clear the RX descriptors */
 	for (i = 0; i < dma_conf->dma_rx_size; i++)
 		if (priv->extend_desc)
 			stmmac_init_rx_desc(priv, &rx_q->dma_erx[i].basic,
 					priv->use_riwt, priv->mode,
 					(i == dma_conf->dma_rx_size - 1),
-					dma_conf->dma_buf_sz);
+					buf_sz);
 		else
 			stmmac_init_rx_desc(priv, &rx_q->dma_rx[i],
 					priv->use_riwt, priv->mode,
 					(i == dma_conf->dma_rx_size - 1),
-					dma_conf->dma_buf_sz);
+					buf_sz);
 }
 
 /**
@@ -1422,6 +1479,37 @@ static void stmmac_clear_descriptors(struct stmmac_priv *priv,
 		stmmac_clear_tx_descriptors(priv, dma_conf, queue);
 }
 
+/**
+ * stmmac_rx_page_alloc - get a page (or page fragment) for an RX buffer
+ * @priv: driver private structure
+ * @rx_q: RX queue
+ * @buf: RX buffer to fill
+ * @gfp: gfp flags
+ * Description: when the queue runs in page split mode, several descriptors
+ * share one page_pool page and @buf gets a STMMAC_RX_FRAG_SZ slice of it.
+ * Otherwise it owns a whole page starting at the XDP headroom (if any).
+ */
+static struct page *stmmac_rx_page_alloc(struct stmmac_priv *priv,
+					 struct stmmac_rx_queue *rx_q,
+					 struct stmmac_rx_buffer *buf,
+					 gfp_t gfp)
+{
+	unsigned int offset;
+
+	if (rx_q->frag_sz) {
+		buf->page = page_pool_alloc_frag(rx_q->page_pool, &offset,
+						 rx_q->frag_sz, gfp);
+		if (buf->page)
+			buf->page_offset = offset;
+	} else {
+		buf->page = page_pool_alloc_pages(rx_q->page_pool, gfp);
+		if (buf->page)
+			buf->page_offset = stmmac_rx_offset(priv);
+	}
+
+	return buf->page;
+}
+
 /**
  * stmmac_init_rx_buffers - init the RX descriptor buffer.
  * @priv: driver private structure
@@ -1445,12 +1533,8 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv,
 	if (priv->dma_cap.host_dma_width <= 32)
 		gfp |= GFP_DMA32;
 
-	if (!buf->page) {
-		buf->page = page_pool_alloc_pages(rx_q->page_pool, gfp);
-		if (!buf->page)
-			return -ENOMEM;
-		buf->page_offset = stmmac_rx_offset(priv);
-	}
+	if (!buf->page && !stmmac_rx_page_alloc(priv, rx_q, buf, gfp))
+		return -ENOMEM;
 
 	if (priv->sph && !buf->sec_page) {
 		buf->sec_page = page_pool_alloc_pages(rx_q->page_pool, gfp);
@@ -1508,7 +1592,8 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv,
 	struct stmmac_tx_queue *tx_q = &dma_conf->tx_queue[queue];
 
 	if (tx_q->tx_skbuff_dma[i].buf &&
-	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_XDP_TX) {
+	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_XDP_TX &&
+	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_NETPOLL) {
 		if (tx_q->tx_skbuff_dma[i].map_as_page)
 			dma_unmap_page(priv->device,
 				       tx_q->tx_skbuff_dma[i].buf,
@@ -1531,6 +1616,12 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv,
 	if (tx_q->tx_skbuff_dma[i].buf_type == STMMAC_TXBUF_T_XSK_TX)
 		tx_q->xsk_frames_done++;
 
+#ifdef CONFIG_NET_POLL_CONTROLLER
+	if (tx_q->tx_skbuff_dma[i].buf &&
+	    tx_q->tx_skbuff_dma[i].buf_type == STMMAC_TXBUF_T_NETPOLL)
+		priv->np_inflight--;
+#endif
+
 	if (tx_q->tx_skbuff[i] &&
 	    tx_q->tx_skbuff_dma[i].buf_type == STMMAC_TXBUF_T_SKB) {
 		dev_kfree_skb_any(tx_q->tx_skbuff[i]);
@@ -1978,6 +2069,13 @@ static void __free_dma_tx_desc_resources(struct stmmac_priv *priv,
 
 	dma_free_coherent(priv->device, size, addr, tx_q->dma_tx_phy);
 
+	if (tx_q->tso_hdrs) {
+		dma_free_coherent(priv->device,
+				  dma_conf->dma_tx_size * TSO_HEADER_SIZE,
+				  tx_q->tso_hdrs, tx_q->tso_hdrs_phy);
+		tx_q->tso_hdrs = NULL;
+	}
+
 	kfree(tx_q->tx_skbuff_dma);
 	kfree(tx_q->tx_skbuff);
 }
@@ -2018,6 +2116,17 @@ static int __alloc_dma_rx_desc_resources(struct stmmac_priv *priv,
 	rx_q->queue_index = queue;
 	rx_q->priv_data = priv;
 
+	/* For standard MTU frames, without XDP and Split Header, the page
+	 * would be mostly unused: split it between several descriptors.
+	 * The whole page is synced for the device once all the fragments
+	 * have been given back to the pool.
+	 */
+	rx_q->frag_sz = 0;
+	if (!xdp_prog && !priv->sph_cap && !PAGE_POOL_DMA_USE_PP_FRAG_COUNT &&
+	    dma_conf->dma_buf_sz <= STMMAC_RX_FRAG_SZ &&
+	    PAGE_SIZE >= 2 * STMMAC_RX_FRAG_SZ)
+		rx_q->frag_sz = STMMAC_RX_FRAG_SZ;
+
 	pp_params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
 	pp_params.pool_size = dma_conf->dma_rx_size;
 	num_pages = DIV_ROUND_UP(dma_conf->dma_buf_sz, PAGE_SIZE);
@@ -2027,6 +2136,10 @@ static int __alloc_dma_rx_desc_resources(struct stmmac_priv *priv,
 	pp_params.dma_dir = xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
 	pp_params.offset = stmmac_rx_offset(priv);
 	pp_params.max_len = STMMAC_MAX_RX_BUF_SIZE(num_pages);
+	if (rx_q->frag_sz) {
+		pp_params.flags |= PP_FLAG_PAGE_FRAG;
+		pp_params.max_len = PAGE_SIZE;
+	}
 
 	rx_q->page_pool = page_pool_create(&pp_params);
 	if (IS_ERR(rx_q->page_pool)) {
@@ -2153,6 +2266,16 @@ static int __alloc_dma_tx_desc_resources(struct stmmac_priv *priv,
 	else
 		tx_q->dma_tx = addr;
 
+	if (priv->sw_tso) {
+		tx_q->tso_hdrs = dma_alloc_coherent(priv->device,
+						    dma_conf->dma_tx_size *
+						    TSO_HEADER_SIZE,
+						    &tx_q->tso_hdrs_phy,
+						    GFP_KERNEL);
+		if (!tx_q->tso_hdrs)
+			return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -2298,6 +2421,7 @@ static void stmmac_enable_all_dma_irq(struct stmmac_priv *priv)
 		unsigned long flags;
 
 		spin_lock_irqsave(&ch->lock, flags);
+		ch->tx_irq_busy_poll = false;
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
 	}
@@ -2538,11 +2662,17 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[queue];
 	unsigned int bytes_compl = 0, pkts_compl = 0;
 	unsigned int entry, xmits = 0, count = 0;
+	unsigned int ring_used;
 
 	__netif_tx_lock_bh(netdev_get_tx_queue(priv->dev, queue));
 
 	priv->xstats.tx_clean++;
 
+	ring_used = priv->dma_conf.dma_tx_size - 1 -
+		    stmmac_tx_avail(priv, queue);
+	stmmac_ring_occ_update(priv->xstats.txq_stats[queue].tx_ring_occ,
+			       ring_used, priv->dma_conf.dma_tx_size);
+
 	tx_q->xsk_frames_done = 0;
 
 	entry = tx_q->dirty_tx;
@@ -2602,6 +2732,14 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 				stmmac_get_tx_hwtstamp(priv, p, skb);
 		}
 
+#ifdef CONFIG_NET_POLL_CONTROLLER
+		if (tx_q->tx_skbuff_dma[entry].buf_type == STMMAC_TXBUF_T_NETPOLL) {
+			priv->np_inflight--;
+			tx_q->tx_skbuff_dma[entry].buf = 0;
+			tx_q->tx_skbuff_dma[entry].len = 0;
+		}
+#endif
+
 		if (likely(tx_q->tx_skbuff_dma[entry].buf &&
 			   tx_q->tx_skbuff_dma[entry].buf_type != STMMAC_TXBUF_T_XDP_TX)) {
 			if (tx_q->tx_skbuff_dma[entry].map_as_page)
@@ -2657,6 +2795,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	netdev_tx_completed_queue(netdev_get_tx_queue(priv->dev, queue),
 				  pkts_compl, bytes_compl);
 
+	priv->channel[queue].tx_dim.packets += pkts_compl;
+	priv->channel[queue].tx_dim.bytes += bytes_compl;
+
 	if (unlikely(netif_tx_queue_stopped(netdev_get_tx_queue(priv->dev,
 								queue))) &&
 	    stmmac_tx_avail(priv, queue) > STMMAC_TX_THRESH(priv)) {
@@ -2700,6 +2841,8 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 
 	__netif_tx_unlock_bh(netdev_get_tx_queue(priv->dev, queue));
 
+	trace_stmmac_tx_poll(priv->dev, queue, count, budget, ring_used);
+
 	/* Combine decisions from TX clean and XSK TX */
 	return max(count, xmits);
 }
@@ -2776,6 +2919,52 @@ static bool stmmac_safety_feat_interrupt(struct stmmac_priv *priv)
 	return false;
 }
 
+/**
+ * stmmac_rx_irq_tstamp - software timestamp the frames an RX IRQ reports
+ * @priv: driver private structure
+ * @queue: RX queue index
+ * @skb_tstamp: use the time for skb->tstamp, not only for pkt_latency
+ * Description: called from the DMA interrupt, before NAPI is scheduled.
+ * Notes the time and how many descriptors starting at cur_rx the DMA has
+ * already completed. stmmac_rx() gives the frames ending in those
+ * descriptors this timestamp, so the NAPI poll delay does not show up in
+ * them. Frames that arrive after the interrupt are stamped by the stack
+ * as usual.
+ */
+static void stmmac_rx_irq_tstamp(struct stmmac_priv *priv, u32 queue,
+				 bool skb_tstamp)
+{
+	struct stmmac_rx_queue *rx_q = &priv->dma_conf.rx_queue[queue];
+	unsigned int entry = rx_q->cur_rx;
+	unsigned int avail, cnt = 0;
+
+	rx_q->irq_tstamp = ktime_get();
+	rx_q->irq_tstamp_skb = skb_tstamp;
+
+	/* Descriptors between dirty_rx and cur_rx are not owned by the DMA
+	 * but have not been refilled either, do not mistake them for frames.
+	 */
+	avail = priv->dma_conf.dma_rx_size - stmmac_rx_dirty(priv, queue) - 1;
+	avail = min_t(unsigned int, avail, STMMAC_RX_TSTAMP_SCAN);
+
+	while (cnt < avail) {
+		struct dma_desc *p;
+
+		if (priv->extend_desc)
+			p = (struct dma_desc *)(rx_q->dma_erx + entry);
+		else
+			p = rx_q->dma_rx + entry;
+
+		if (stmmac_get_rx_owner(priv, p))
+			break;
+
+		cnt++;
+		entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_rx_size);
+	}
+
+	rx_q->irq_tstamp_cnt = cnt;
+}
+
 static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan, u32 dir)
 {
 	int status = stmmac_dma_interrupt_status(priv, priv->ioaddr,
@@ -2792,9 +2981,17 @@ static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan, u32 dir)
 
 	if ((status & handle_rx) && (chan < priv->plat->rx_queues_to_use)) {
 		if (napi_schedule_prep(rx_napi)) {
+			bool skb_tstamp = READ_ONCE(early_rx_tstamp) &&
+					  !priv->hwts_rx_en;
+
+			/* NAPI is not running, so cur_rx is stable */
+			if ((skb_tstamp || net_pkt_stage_enabled()) &&
+			    !rx_q->xsk_pool)
+				stmmac_rx_irq_tstamp(priv, chan, skb_tstamp);
 			spin_lock_irqsave(&ch->lock, flags);
 			stmmac_disable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 			spin_unlock_irqrestore(&ch->lock, flags);
+			ch->rx_dim.event_ctr++;
 			__napi_schedule(rx_napi);
 		}
 	}
@@ -2804,6 +3001,7 @@ static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan, u32 dir)
 			spin_lock_irqsave(&ch->lock, flags);
 			stmmac_disable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 			spin_unlock_irqrestore(&ch->lock, flags);
+			ch->tx_dim.event_ctr++;
 			__napi_schedule(tx_napi);
 		}
 	}
@@ -3009,12 +3207,110 @@ static enum hrtimer_restart stmmac_tx_timer(struct hrtimer *t)
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_disable_dma_irq(priv, priv->ioaddr, ch->index, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
+		ch->tx_dim.event_ctr++;
 		__napi_schedule(napi);
 	}
 
 	return HRTIMER_NORESTART;
 }
 
+/**
+ * stmmac_rx_holdoff_arm - arm the SW RX interrupt hold-off
+ * @priv: driver private structure
+ * @chan: channel index
+ * @work_done: number of frames handled by the last poll
+ * Description:
+ * Cores without the RX interrupt watchdog (e.g. the sun8i EMAC) raise one
+ * interrupt per received frame. When a RX coalesce time is configured, keep
+ * the RX interrupt masked after NAPI completes and poll again once the
+ * timer expires. The interrupt is only unmasked after an empty poll.
+ * Return: true if the timer was armed and the RX interrupt must stay masked.
+ */
+static bool stmmac_rx_holdoff_arm(struct stmmac_priv *priv, u32 chan,
+				  int work_done)
+{
+	struct stmmac_channel *ch = &priv->channel[chan];
+	u32 rx_coal_timer = priv->rx_coal_timer[chan];
+
+	if (priv->use_riwt || !rx_coal_timer || !work_done)
+		return false;
+
+	hrtimer_start(&ch->rx_holdoff_timer,
+		      STMMAC_COAL_TIMER(rx_coal_timer),
+		      HRTIMER_MODE_REL);
+
+	return true;
+}
+
+/**
+ * stmmac_rx_holdoff_timer - SW RX interrupt hold-off expiry
+ * @t: data pointer
+ * Description:
+ * This is the timer handler to poll the RX ring while the RX interrupt is
+ * still masked.
+ */
+static enum hrtimer_restart stmmac_rx_holdoff_timer(struct hrtimer *t)
+{
+	struct stmmac_channel *ch =
+		container_of(t, struct stmmac_channel, rx_holdoff_timer);
+
+	if (likely(napi_schedule_prep(&ch->rx_napi))) {
+		ch->rx_dim.event_ctr++;
+		__napi_schedule(&ch->rx_napi);
+	}
+
+	return HRTIMER_NORESTART;
+}
+
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_net_dim *ndim =
+		container_of(dim, struct stmmac_net_dim, dim);
+	struct stmmac_channel *ch =
+		container_of(ndim, struct stmmac_channel, rx_dim);
+	struct dim_cq_moder cur_profile =
+		net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+
+	stmmac_set_rx_coalesce(ch->priv_data, ch->index, cur_profile.usec,
+			       cur_profile.pkts);
+	dim->state = DIM_START_MEASURE;
+}
+
+static void stmmac_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_net_dim *ndim =
+		container_of(dim, struct stmmac_net_dim, dim);
+	struct stmmac_channel *ch =
+		container_of(ndim, struct stmmac_channel, tx_dim);
+	struct dim_cq_moder cur_profile =
+		net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+
+	stmmac_set_tx_coalesce(ch->priv_data, ch->index, cur_profile.usec,
+			       cur_profile.pkts);
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * stmmac_net_dim_update - feed one NAPI completion to lib/dim
+ * @ndim: RX or TX adaptive moderation state
+ * Description:
+ * Called when NAPI completes. The dim work then reprograms the coalesce
+ * parameters of the channel when the traffic profile changed.
+ */
+static void stmmac_net_dim_update(struct stmmac_net_dim *ndim)
+{
+	struct dim_sample dim_sample = {};
+
+	if (!ndim->use_dim)
+		return;
+
+	dim_update_sample(ndim->event_ctr, ndim->packets, ndim->bytes,
+			  &dim_sample);
+	net_dim(&ndim->dim, dim_sample);
+}
+
 /**
  * stmmac_init_coalesce - init mitigation options.
  * @priv: driver private structure
@@ -3039,8 +3335,10 @@ static void stmmac_init_coalesce(struct stmmac_priv *priv)
 		tx_q->txtimer.function = stmmac_tx_timer;
 	}
 
-	for (chan = 0; chan < rx_channel_count; chan++)
+	for (chan = 0; chan < rx_channel_count; chan++) {
 		priv->rx_coal_frames[chan] = STMMAC_RX_FRAMES;
+		priv->rx_coal_timer[chan] = STMMAC_COAL_RX_TIMER;
+	}
 }
 
 static void stmmac_set_rings_length(struct stmmac_priv *priv)
@@ -4072,6 +4370,20 @@ static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue)
 	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
 }
 
+/**
+ * stmmac_tx_kick - let the DMA fetch the descriptors queued so far
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * Description: issues the transmit poll demand (or tail pointer update)
+ * that has been deferred while the stack announced more frames with
+ * netdev_xmit_more().
+ */
+static void stmmac_tx_kick(struct stmmac_priv *priv, u32 queue)
+{
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+	stmmac_flush_tx_descriptors(priv, queue);
+}
+
 /**
  *  stmmac_tso_xmit - Tx entry point of the driver for oversized frames (TSO)
  *  @skb : the socket buffer
@@ -4137,6 +4449,8 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		/* Don't leave frames deferred by xmit_more behind */
+		stmmac_tx_kick(priv, queue);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -4316,20 +4630,338 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 		print_pkt(skb->data, skb_headlen(skb));
 	}
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_flush_tx_descriptors(priv, queue);
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more()))
+		stmmac_tx_kick(priv, queue);
 	stmmac_tx_timer_arm(priv, queue);
 
 	return NETDEV_TX_OK;
 
 dma_map_err:
 	dev_err(priv->device, "Tx dma map failed\n");
+	stmmac_tx_kick(priv, queue);
+	dev_kfree_skb(skb);
+	priv->dev->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
+static struct dma_desc *stmmac_sw_tso_get_desc(struct stmmac_priv *priv,
+					       struct stmmac_tx_queue *tx_q,
+					       unsigned int entry)
+{
+	if (priv->extend_desc)
+		return &tx_q->dma_etx[entry].basic;
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		return &tx_q->dma_entx[entry].basic;
+
+	return &tx_q->dma_tx[entry];
+}
+
+static void stmmac_sw_tso_fill_desc(struct stmmac_priv *priv,
+				    struct stmmac_tx_queue *tx_q,
+				    unsigned int entry, dma_addr_t des,
+				    unsigned int len, bool is_fs, bool ls,
+				    bool tx_own, unsigned int seg_len)
+{
+	struct dma_desc *desc = stmmac_sw_tso_get_desc(priv, tx_q, entry);
+
+	tx_q->tx_skbuff_dma[entry].map_as_page = false;
+	tx_q->tx_skbuff_dma[entry].len = len;
+	tx_q->tx_skbuff_dma[entry].last_segment = ls;
+	tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+
+	stmmac_set_desc_addr(priv, desc, des);
+	stmmac_prepare_tx_desc(priv, desc, is_fs, len, true, priv->mode,
+			       tx_own, ls, seg_len);
+}
+
+/**
+ *  stmmac_sw_tso_xmit - Tx entry point for TCP GSO frames without HW TSO
+ *  @skb : the socket buffer
+ *  @dev : device pointer
+ *  Description: this is the transmit function used on cores that have no
+ *  TSO engine (e.g. sun8i EMAC). The frame is segmented by the driver
+ *  with the net/core/tso.c helpers: for each segment, the protocol
+ *  headers are built into the per-entry header buffer of the ring and the
+ *  payload descriptors point at the original skb data. Checksums are left
+ *  to the TX COE. The whole chain is handed to the DMA at once, by setting
+ *  the OWN bit of the very first descriptor last.
+ */
+static netdev_tx_t stmmac_sw_tso_xmit(struct sk_buff *skb,
+				      struct net_device *dev)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	u32 queue = skb_get_queue_mapping(skb);
+	unsigned int first_entry, entry, i;
+	int hdr_len, total_len, segs = 0;
+	struct stmmac_tx_queue *tx_q;
+	struct tso_t tso;
+	bool set_ic;
+
+	tx_q = &priv->dma_conf.tx_queue[queue];
+
+	/* stmmac_features_check() bounds this below the wake threshold */
+	if (unlikely(stmmac_tx_avail(priv, queue) < tso_count_descs(skb))) {
+		netif_tx_stop_queue(netdev_get_tx_queue(dev, queue));
+		/* Don't leave frames deferred by xmit_more behind */
+		stmmac_tx_kick(priv, queue);
+		return NETDEV_TX_BUSY;
+	}
+
+	hdr_len = tso_start(skb, &tso);
+	total_len = skb->len - hdr_len;
+
+	first_entry = tx_q->cur_tx;
+	entry = first_entry;
+	WARN_ON(tx_q->tx_skbuff[first_entry]);
+
+	while (total_len > 0) {
+		int data_left = min_t(int, skb_shinfo(skb)->gso_size,
+				      total_len);
+		unsigned int seg_len = hdr_len + data_left;
+		char *hdr = tx_q->tso_hdrs + entry * TSO_HEADER_SIZE;
+
+		total_len -= data_left;
+		segs++;
+
+		/* Header buffers are not unmapped by stmmac_tx_clean() */
+		tso_build_hdr(skb, hdr, &tso, data_left, total_len == 0);
+		tx_q->tx_skbuff_dma[entry].buf = 0;
+		stmmac_sw_tso_fill_desc(priv, tx_q, entry,
+					tx_q->tso_hdrs_phy +
+					entry * TSO_HEADER_SIZE,
+					hdr_len, true, false,
+					entry != first_entry, seg_len);
+
+		while (data_left > 0) {
+			int size = min_t(int, tso.size, data_left);
+			dma_addr_t des;
+
+			entry = STMMAC_GET_ENTRY(entry,
+						 priv->dma_conf.dma_tx_size);
+
+			des = dma_map_single(priv->device, tso.data, size,
+					     DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, des))
+				goto dma_map_err;
+
+			data_left -= size;
+			tx_q->tx_skbuff_dma[entry].buf = des;
+			stmmac_sw_tso_fill_desc(priv, tx_q, entry, des, size,
+						false, !data_left, true,
+						seg_len);
+
+			tso_build_data(skb, &tso, size);
+		}
+
+		if (total_len)
+			entry = STMMAC_GET_ENTRY(entry,
+						 priv->dma_conf.dma_tx_size);
+	}
+
+	/* Only the last descriptor gets to point to the skb. */
+	tx_q->tx_skbuff[entry] = skb;
+
+	tx_q->tx_count_frames += segs;
+	if (!priv->tx_coal_frames[queue])
+		set_ic = false;
+	else if (segs > priv->tx_coal_frames[queue])
+		set_ic = true;
+	else if ((tx_q->tx_count_frames %
+		  priv->tx_coal_frames[queue]) < segs)
+		set_ic = true;
+	else
+		set_ic = false;
+
+	if (set_ic) {
+		tx_q->tx_count_frames = 0;
+		stmmac_set_tx_ic(priv,
+				 stmmac_sw_tso_get_desc(priv, tx_q, entry));
+		priv->xstats.tx_set_ic_bit++;
+	}
+
+	tx_q->cur_tx = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size);
+
+	if (unlikely(stmmac_tx_avail(priv, queue) <= (MAX_SKB_FRAGS + 1))) {
+		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
+			  __func__);
+		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+	}
+
+	dev->stats.tx_bytes += skb->len;
+	priv->xstats.tx_tso_frames++;
+	priv->xstats.tx_tso_nfrags += skb_shinfo(skb)->nr_frags;
+
+	skb_tx_timestamp(skb);
+
+	/* All the segments are ready, the headers included: grant the DMA */
+	dma_wmb();
+	stmmac_set_tx_owner(priv, stmmac_sw_tso_get_desc(priv, tx_q,
+							 first_entry));
+
+	/* Ring the doorbell once per burst of frames */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more()))
+		stmmac_tx_kick(priv, queue);
+	stmmac_tx_timer_arm(priv, queue);
+
+	return NETDEV_TX_OK;
+
+dma_map_err:
+	netdev_err(priv->dev, "Tx DMA map failed\n");
+
+	/* Nothing has been given to the DMA yet, undo the whole chain */
+	for (i = first_entry; i != entry;
+	     i = STMMAC_GET_ENTRY(i, priv->dma_conf.dma_tx_size)) {
+		struct stmmac_tx_info *tx_info = &tx_q->tx_skbuff_dma[i];
+
+		if (tx_info->buf)
+			dma_unmap_single(priv->device, tx_info->buf,
+					 tx_info->len, DMA_TO_DEVICE);
+		tx_info->buf = 0;
+		tx_info->len = 0;
+		tx_info->last_segment = false;
+		stmmac_release_tx_desc(priv,
+				       stmmac_sw_tso_get_desc(priv, tx_q, i),
+				       priv->mode);
+	}
+
+	stmmac_tx_kick(priv, queue);
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
 	return NETDEV_TX_OK;
 }
 
+static netdev_features_t stmmac_features_check(struct sk_buff *skb,
+					       struct net_device *dev,
+					       netdev_features_t features)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	features = vlan_features_check(skb, features);
+
+	/* Software TSO needs the headers to fit in a TSO_HEADER_SIZE buffer
+	 * and the whole chain to fit in the ring once the queue is woken up,
+	 * otherwise fall back to the GSO layer.
+	 */
+	if (priv->sw_tso && skb_is_gso(skb) &&
+	    (skb_tcp_all_headers(skb) > TSO_HEADER_SIZE ||
+	     tso_count_descs(skb) > STMMAC_TX_THRESH(priv)))
+		features &= ~NETIF_F_GSO_MASK;
+
+	return features;
+}
+
+/* Add the fragment data to a checksum started at skb_checksum_start() */
+static __wsum stmmac_csum_frag(const skb_frag_t *frag, __wsum csum,
+			       int pos)
+{
+	u32 p_off, p_len, copied;
+	struct page *p;
+	u8 *vaddr;
+
+	skb_frag_foreach_page(frag, skb_frag_off(frag), skb_frag_size(frag),
+			      p, p_off, p_len, copied) {
+		vaddr = kmap_local_page(p);
+		csum = csum_block_add(csum, csum_partial(vaddr + p_off,
+							 p_len, 0),
+				      pos + copied);
+		kunmap_local(vaddr);
+	}
+
+	return csum;
+}
+
+#ifdef CONFIG_NET_POLL_CONTROLLER
+/* netpoll runs from panics and with interrupts off: copy its frames into
+ * preallocated coherent buffers instead of mapping them, one descriptor
+ * each, and leave the rest of the TX path alone.
+ */
+static netdev_tx_t stmmac_netpoll_xmit(struct stmmac_priv *priv,
+				       struct sk_buff *skb)
+{
+	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[0];
+	unsigned int entry = tx_q->cur_tx;
+	unsigned int off, len = skb->len;
+	struct dma_desc *desc;
+
+	if (priv->np_inflight >= STMMAC_NETPOLL_BUFS ||
+	    stmmac_tx_avail(priv, 0) <= STMMAC_TX_THRESH(priv))
+		return NETDEV_TX_BUSY;
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb)) {
+		dev_kfree_skb_any(skb);
+		priv->dev->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+
+	off = priv->np_next * STMMAC_NETPOLL_BUF_SZ;
+	skb_copy_bits(skb, 0, priv->np_buf + off, len);
+	dev_consume_skb_any(skb);
+
+	if (likely(priv->extend_desc))
+		desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		desc = &tx_q->dma_entx[entry].basic;
+	else
+		desc = tx_q->dma_tx + entry;
+
+	tx_q->tx_skbuff[entry] = NULL;
+	tx_q->tx_skbuff_dma[entry].buf = priv->np_buf_dma + off;
+	tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_NETPOLL;
+	tx_q->tx_skbuff_dma[entry].map_as_page = false;
+	tx_q->tx_skbuff_dma[entry].len = len;
+	tx_q->tx_skbuff_dma[entry].last_segment = true;
+	tx_q->tx_skbuff_dma[entry].is_jumbo = false;
+
+	stmmac_set_desc_addr(priv, desc, priv->np_buf_dma + off);
+	/* Frame data must be visible before the descriptor is owned */
+	dma_wmb();
+	stmmac_prepare_tx_desc(priv, desc, 1, len, false, priv->mode,
+			       true, true, len);
+	/* Reclaim through the normal interrupt once back from netpoll */
+	stmmac_set_tx_ic(priv, desc);
+
+	priv->np_next = (priv->np_next + 1) % STMMAC_NETPOLL_BUFS;
+	priv->np_inflight++;
+
+	tx_q->cur_tx = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size);
+	stmmac_tx_kick(priv, 0);
+
+	return NETDEV_TX_OK;
+}
+
+static int stmmac_netpoll_setup(struct net_device *dev,
+				struct netpoll_info *npinfo)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	/* Kept until the driver goes away, frames may still be in flight */
+	if (priv->np_buf)
+		return 0;
+
+	priv->np_buf = dma_alloc_coherent(priv->device,
+					  STMMAC_NETPOLL_BUFS *
+					  STMMAC_NETPOLL_BUF_SZ,
+					  &priv->np_buf_dma, GFP_KERNEL);
+	if (!priv->np_buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void stmmac_netpoll_free(struct stmmac_priv *priv)
+{
+	if (!priv->np_buf)
+		return;
+
+	dma_free_coherent(priv->device,
+			  STMMAC_NETPOLL_BUFS * STMMAC_NETPOLL_BUF_SZ,
+			  priv->np_buf, priv->np_buf_dma);
+	priv->np_buf = NULL;
+}
+#endif
+
 /**
  *  stmmac_xmit - Tx entry point of the driver
  *  @skb : the socket buffer
@@ -4350,8 +4982,9 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	struct dma_edesc *tbs_desc = NULL;
 	struct dma_desc *desc, *first;
 	struct stmmac_tx_queue *tx_q;
-	bool has_vlan, set_ic;
-	int entry, first_tx;
+	bool has_vlan, set_ic, sw_csum = false;
+	int entry, first_tx, csum_pos = 0;
+	__wsum csum = 0;
 	dma_addr_t des;
 
 	tx_q = &priv->dma_conf.tx_queue[queue];
@@ -4360,6 +4993,12 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (priv->tx_path_in_lpi_mode && priv->eee_sw_timer_en)
 		stmmac_disable_eee_mode(priv);
 
+#ifdef CONFIG_NET_POLL_CONTROLLER
+	if (unlikely(netpoll_tx_running(dev)) && priv->np_buf && !queue &&
+	    skb->len <= STMMAC_NETPOLL_BUF_SZ)
+		return stmmac_netpoll_xmit(priv, skb);
+#endif
+
 	/* Manage oversized TCP frames for GMAC4 device */
 	if (skb_is_gso(skb) && priv->tso) {
 		if (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6))
@@ -4368,6 +5007,42 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 			return stmmac_tso_xmit(skb, dev);
 	}
 
+	if (skb_is_gso(skb) && priv->sw_tso &&
+	    (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6)))
+		return stmmac_sw_tso_xmit(skb, dev);
+
+	enh_desc = priv->plat->enh_desc;
+	/* To program the descriptors according to the size of the frame */
+	if (enh_desc)
+		is_jumbo = stmmac_is_jumbo_frm(priv, skb->len, enh_desc);
+
+	/* No TX COE: the checksum is summed while the fragments are mapped
+	 * and stored in the header before the linear part is mapped, so
+	 * the payload is neither copied nor walked twice. A page changed
+	 * under a zero-copy send only costs a retransmission, as with the
+	 * data changing under a COE engine. Jumbo frames are mapped by
+	 * the ring/chain code, so let the stack do them.
+	 */
+	if (priv->sw_csum && skb->ip_summed == CHECKSUM_PARTIAL) {
+		csum_pos = skb_checksum_start_offset(skb);
+		if (unlikely(is_jumbo || csum_pos + skb->csum_offset +
+			     sizeof(__sum16) > nopaged_len)) {
+			if (skb_checksum_help(skb))
+				goto drop;
+			nopaged_len = skb_headlen(skb);
+			nfrags = skb_shinfo(skb)->nr_frags;
+		} else {
+			if (skb_ensure_writable(skb, csum_pos +
+						skb->csum_offset +
+						sizeof(__sum16)))
+				goto drop;
+			csum = csum_partial(skb->data + csum_pos,
+					    nopaged_len - csum_pos, 0);
+			csum_pos = nopaged_len - csum_pos;
+			sw_csum = true;
+		}
+	}
+
 	if (unlikely(stmmac_tx_avail(priv, queue) < nfrags + 1)) {
 		if (!netif_tx_queue_stopped(netdev_get_tx_queue(dev, queue))) {
 			netif_tx_stop_queue(netdev_get_tx_queue(priv->dev,
@@ -4377,6 +5052,8 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		/* Don't leave frames deferred by xmit_more behind */
+		stmmac_tx_kick(priv, queue);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -4387,7 +5064,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	first_entry = entry;
 	WARN_ON(tx_q->tx_skbuff[first_entry]);
 
-	csum_insertion = (skb->ip_summed == CHECKSUM_PARTIAL);
+	csum_insertion = !sw_csum && (skb->ip_summed == CHECKSUM_PARTIAL);
 
 	if (likely(priv->extend_desc))
 		desc = (struct dma_desc *)(tx_q->dma_etx + entry);
@@ -4401,11 +5078,6 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (has_vlan)
 		stmmac_set_desc_vlan(priv, first, STMMAC_VLAN_INSERT);
 
-	enh_desc = priv->plat->enh_desc;
-	/* To program the descriptors according to the size of the frame */
-	if (enh_desc)
-		is_jumbo = stmmac_is_jumbo_frm(priv, skb->len, enh_desc);
-
 	if (unlikely(is_jumbo)) {
 		entry = stmmac_jumbo_frm(priv, tx_q, skb, csum_insertion);
 		if (unlikely(entry < 0) && (entry != -EINVAL))
@@ -4432,6 +5104,11 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		if (dma_mapping_error(priv->device, des))
 			goto dma_map_err; /* should reuse desc w/o issues */
 
+		if (sw_csum) {
+			csum = stmmac_csum_frag(frag, csum, csum_pos);
+			csum_pos += len;
+		}
+
 		tx_q->tx_skbuff_dma[entry].buf = des;
 
 		stmmac_set_desc_addr(priv, desc, des);
@@ -4521,6 +5198,13 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (likely(!is_jumbo)) {
 		bool last_segment = (nfrags == 0);
 
+		if (sw_csum) {
+			*(__sum16 *)(skb_checksum_start(skb) +
+				     skb->csum_offset) =
+				csum_fold(csum) ?: CSUM_MANGLED_0;
+			skb->ip_summed = CHECKSUM_NONE;
+		}
+
 		des = dma_map_single(priv->device, skb->data,
 				     nopaged_len, DMA_TO_DEVICE);
 		if (dma_mapping_error(priv->device, des))
@@ -4557,17 +5241,18 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	stmmac_set_tx_owner(priv, first);
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_enable_dma_transmission(priv, priv->ioaddr);
-
-	stmmac_flush_tx_descriptors(priv, queue);
+	/* Ring the doorbell once per burst of frames */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more()))
+		stmmac_tx_kick(priv, queue);
 	stmmac_tx_timer_arm(priv, queue);
 
 	return NETDEV_TX_OK;
 
 dma_map_err:
 	netdev_err(priv->dev, "Tx DMA map failed\n");
+	stmmac_tx_kick(priv, queue);
+drop:
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
 	return NETDEV_TX_OK;
@@ -4591,6 +5276,37 @@ static void stmmac_rx_vlan(struct net_device *dev, struct sk_buff *skb)
 	}
 }
 
+/**
+ * stmmac_rx_copy_vlan - copy the head of a frame into the skb
+ * @dev: net device
+ * @skb: socket buffer, with an empty linear area
+ * @data: start of the frame
+ * @len: bytes to copy
+ * Description: same as stmmac_rx_vlan(), but the outer VLAN tag is
+ * dropped while copying instead of being memmove'd out afterwards.
+ */
+static void stmmac_rx_copy_vlan(struct net_device *dev, struct sk_buff *skb,
+				const void *data, unsigned int len)
+{
+	const struct vlan_ethhdr *veth = data;
+	__be16 vlan_proto = veth->h_vlan_proto;
+
+	if (len >= VLAN_ETH_HLEN &&
+	    ((vlan_proto == htons(ETH_P_8021Q) &&
+	      dev->features & NETIF_F_HW_VLAN_CTAG_RX) ||
+	     (vlan_proto == htons(ETH_P_8021AD) &&
+	      dev->features & NETIF_F_HW_VLAN_STAG_RX))) {
+		skb_put_data(skb, data, ETH_ALEN * 2);
+		skb_put_data(skb, data + ETH_ALEN * 2 + VLAN_HLEN,
+			     len - ETH_ALEN * 2 - VLAN_HLEN);
+		__vlan_hwaccel_put_tag(skb, vlan_proto,
+				       ntohs(veth->h_vlan_TCI));
+		return;
+	}
+
+	skb_put_data(skb, data, len);
+}
+
 /**
  * stmmac_rx_refill - refill used skb preallocated buffers
  * @priv: driver private structure
@@ -4618,11 +5334,8 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 		else
 			p = rx_q->dma_rx + entry;
 
-		if (!buf->page) {
-			buf->page = page_pool_alloc_pages(rx_q->page_pool, gfp);
-			if (!buf->page)
-				break;
-		}
+		if (!buf->page && !stmmac_rx_page_alloc(priv, rx_q, buf, gfp))
+			break;
 
 		if (priv->sph && !buf->sec_page) {
 			buf->sec_page = page_pool_alloc_pages(rx_q->page_pool, gfp);
@@ -4660,6 +5373,12 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 	rx_q->rx_tail_addr = rx_q->dma_rx_phy +
 			    (rx_q->dirty_rx * sizeof(struct dma_desc));
 	stmmac_set_rx_tail_ptr(priv, priv->ioaddr, rx_q->rx_tail_addr, queue);
+
+	/* Out of buffers: the remaining entries wait for the next poll */
+	if (unlikely(dirty >= 0)) {
+		priv->xstats.rxq_stats[queue].rx_refill_deferred_n++;
+		trace_stmmac_rx_refill_deferred(priv->dev, queue, dirty + 1);
+	}
 }
 
 static unsigned int stmmac_rx_buf1_len(struct stmmac_priv *priv,
@@ -5197,8 +5916,9 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	int status = 0, coe = priv->hw->rx_csum;
 	unsigned int next_entry = rx_q->cur_rx;
 	enum dma_data_direction dma_dir;
-	unsigned int desc_size;
+	unsigned int desc_size, ring_used;
 	struct sk_buff *skb = NULL;
+	bool irq_tstamp = false;
 	struct xdp_buff xdp;
 	int xdp_status = 0;
 	int buf_sz;
@@ -5262,6 +5982,11 @@ read_again:
 		if (unlikely(status & dma_own))
 			break;
 
+		/* Was this descriptor already complete at the last IRQ? */
+		irq_tstamp = rx_q->irq_tstamp_cnt > 0;
+		if (irq_tstamp)
+			rx_q->irq_tstamp_cnt--;
+
 		rx_q->cur_rx = STMMAC_GET_ENTRY(rx_q->cur_rx,
 						priv->dma_conf.dma_rx_size);
 		next_entry = rx_q->cur_rx;
@@ -5368,32 +6093,73 @@ read_again:
 		}
 
 		if (!skb) {
+			bool copybreak, xdp_prog = stmmac_xdp_is_enabled(priv);
+			unsigned int hlen;
+
 			/* XDP program may expand or reduce tail */
 			buf1_len = xdp.data_end - xdp.data;
+			copybreak = buf1_len <= priv->rx_copybreak;
+
+			/* Above the copybreak only the headers are copied */
+			hlen = buf1_len;
+			if (!copybreak && !xdp_prog)
+				hlen = eth_get_headlen(priv->dev, xdp.data,
+						       STMMAC_RX_HDR_LEN);
 
-			skb = napi_alloc_skb(&ch->rx_napi, buf1_len);
+			skb = napi_alloc_skb(&ch->rx_napi, hlen);
 			if (!skb) {
 				priv->dev->stats.rx_dropped++;
 				count++;
 				goto drain_data;
 			}
+			if (irq_tstamp)
+				net_pkt_stage_rx(skb, rx_q->irq_tstamp);
+			else
+				net_pkt_stage(skb, PKTLAT_RX);
 
 			/* XDP program may adjust header */
-			skb_copy_to_linear_data(skb, xdp.data, buf1_len);
-			skb_put(skb, buf1_len);
-
-			/* Data payload copied into SKB, page ready for recycle */
-			page_pool_recycle_direct(rx_q->page_pool, buf->page);
-			buf->page = NULL;
+			stmmac_rx_copy_vlan(priv->dev, skb, xdp.data, hlen);
+
+			if (hlen < buf1_len) {
+				/* Payload stays in the page, owned by the SKB */
+				skb_add_rx_frag(skb, 0, buf->page,
+						xdp.data + hlen -
+						page_address(buf->page),
+						buf1_len - hlen,
+						rx_q->frag_sz ? : priv->dma_conf.dma_buf_sz);
+				skb_mark_for_recycle(skb);
+				buf->page = NULL;
+			} else if (copybreak && !xdp_prog) {
+				/* Small frame copied: the CPU only read the
+				 * buffer, hand it back to the DMA as it is.
+				 */
+				dma_sync_single_for_device(priv->device,
+							   buf->addr, buf1_len,
+							   dma_dir);
+			} else {
+				/* Data payload copied into SKB, page ready
+				 * for recycle
+				 */
+				page_pool_recycle_direct(rx_q->page_pool,
+							 buf->page);
+				buf->page = NULL;
+			}
 		} else if (buf1_len) {
 			dma_sync_single_for_cpu(priv->device, buf->addr,
 						buf1_len, dma_dir);
 			skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags,
 					buf->page, buf->page_offset, buf1_len,
-					priv->dma_conf.dma_buf_sz);
+					rx_q->frag_sz ? : priv->dma_conf.dma_buf_sz);
 
-			/* Data payload appended into SKB */
-			page_pool_release_page(rx_q->page_pool, buf->page);
+			/* Data payload appended into SKB. A split page is
+			 * shared with other descriptors, so it cannot be
+			 * unmapped here: let the skb give it back to the pool.
+			 */
+			if (rx_q->frag_sz)
+				skb_mark_for_recycle(skb);
+			else
+				page_pool_release_page(rx_q->page_pool,
+						       buf->page);
 			buf->page = NULL;
 		}
 
@@ -5418,7 +6184,11 @@ drain_data:
 		/* Got entire packet into SKB. Finish it. */
 
 		stmmac_get_rx_hwtstamp(priv, p, np, skb);
-		stmmac_rx_vlan(priv->dev, skb);
+		if (irq_tstamp && rx_q->irq_tstamp_skb)
+			skb->tstamp = ktime_mono_to_real(rx_q->irq_tstamp);
+		/* The outer tag has usually been popped by the copy already */
+		if (!skb_vlan_tag_present(skb))
+			stmmac_rx_vlan(priv->dev, skb);
 		skb->protocol = eth_type_trans(skb, priv->dev);
 
 		if (unlikely(!coe))
@@ -5435,6 +6205,8 @@ drain_data:
 
 		priv->dev->stats.rx_packets++;
 		priv->dev->stats.rx_bytes += len;
+		ch->rx_dim.packets++;
+		ch->rx_dim.bytes += len;
 		count++;
 	}
 
@@ -5447,6 +6219,11 @@ drain_data:
 
 	stmmac_finalize_xdp_rx(priv, xdp_status);
 
+	ring_used = stmmac_rx_dirty(priv, queue);
+	stmmac_ring_occ_update(priv->xstats.rxq_stats[queue].rx_ring_occ,
+			       ring_used, priv->dma_conf.dma_rx_size);
+	trace_stmmac_rx_poll(priv->dev, queue, count, limit, ring_used);
+
 	stmmac_rx_refill(priv, queue);
 
 	priv->xstats.rx_pkt_n += count;
@@ -5460,14 +6237,45 @@ static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 	struct stmmac_channel *ch =
 		container_of(napi, struct stmmac_channel, rx_napi);
 	struct stmmac_priv *priv = ch->priv_data;
+	unsigned long flags;
 	u32 chan = ch->index;
 	int work_done;
 
 	priv->xstats.napi_poll++;
 
+	/* An application owns this NAPI through busy polling: reap the TX
+	 * completions here and keep the TX interrupt masked until the NAPI
+	 * is polled from softirq again, so that nothing but the poll loop
+	 * runs on this queue.
+	 */
+	if (test_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state) &&
+	    chan < priv->plat->tx_queues_to_use) {
+		spin_lock_irqsave(&ch->lock, flags);
+		if (!ch->tx_irq_busy_poll) {
+			stmmac_disable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
+			ch->tx_irq_busy_poll = true;
+		}
+		spin_unlock_irqrestore(&ch->lock, flags);
+
+		stmmac_tx_clean(priv, budget, chan);
+	} else if (READ_ONCE(ch->tx_irq_busy_poll)) {
+		spin_lock_irqsave(&ch->lock, flags);
+		if (ch->tx_irq_busy_poll) {
+			ch->tx_irq_busy_poll = false;
+			stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
+		}
+		spin_unlock_irqrestore(&ch->lock, flags);
+	}
+
 	work_done = stmmac_rx(priv, budget, chan);
+	if (work_done >= budget)
+		priv->xstats.rxq_stats[chan].rx_napi_budget_n++;
+
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
-		unsigned long flags;
+		stmmac_net_dim_update(&ch->rx_dim);
+
+		if (stmmac_rx_holdoff_arm(priv, chan, work_done))
+			return work_done;
 
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
@@ -5489,12 +6297,18 @@ static int stmmac_napi_poll_tx(struct napi_struct *napi, int budget)
 
 	work_done = stmmac_tx_clean(priv, budget, chan);
 	work_done = min(work_done, budget);
+	if (work_done >= budget)
+		priv->xstats.txq_stats[chan].tx_napi_budget_n++;
 
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		stmmac_net_dim_update(&ch->tx_dim);
+
+		/* Busy polling RX NAPI takes care of TX completions */
 		spin_lock_irqsave(&ch->lock, flags);
-		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
+		if (!ch->tx_irq_busy_poll)
+			stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
 	}
 
@@ -5521,8 +6335,13 @@ static int stmmac_napi_poll_rxtx(struct napi_struct *napi, int budget)
 	/* If either TX or RX work is not complete, return budget
 	 * and keep pooling
 	 */
-	if (rxtx_done >= budget)
+	if (rxtx_done >= budget) {
+		if (rx_done >= budget)
+			priv->xstats.rxq_stats[chan].rx_napi_budget_n++;
+		if (tx_done >= budget)
+			priv->xstats.txq_stats[chan].tx_napi_budget_n++;
 		return budget;
+	}
 
 	/* all work done, exit the polling mode */
 	if (napi_complete_done(napi, rxtx_done)) {
@@ -5645,8 +6464,13 @@ static netdev_features_t stmmac_fix_features(struct net_device *dev,
 	if (priv->plat->rx_coe == STMMAC_RX_COE_NONE)
 		features &= ~NETIF_F_RXCSUM;
 
+	/* Without TX COE the checksum is computed by stmmac_xmit() itself:
+	 * keeping the feature keeps SG, so sendpage/splice to a socket can
+	 * hand page cache pages down to the descriptors without a copy.
+	 */
 	if (!priv->plat->tx_coe)
-		features &= ~NETIF_F_CSUM_MASK;
+		features &= ~(NETIF_F_CSUM_MASK &
+			      ~(NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM));
 
 	/* Some GMAC devices have a bugged Jumbo frame support that
 	 * needs to have the Tx COE disabled for oversized frames
@@ -6462,6 +7286,7 @@ void stmmac_disable_rx_queue(struct stmmac_priv *priv, u32 queue)
 	stmmac_disable_dma_irq(priv, priv->ioaddr, queue, 1, 0);
 	spin_unlock_irqrestore(&ch->lock, flags);
 
+	hrtimer_cancel(&ch->rx_holdoff_timer);
 	stmmac_stop_rx_dma(priv, queue);
 	__free_dma_rx_desc_resources(priv, &priv->dma_conf, queue);
 }
@@ -6750,6 +7575,7 @@ int stmmac_xsk_wakeup(struct net_device *dev, u32 queue, u32 flags)
 static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_open = stmmac_open,
 	.ndo_start_xmit = stmmac_xmit,
+	.ndo_features_check = stmmac_features_check,
 	.ndo_stop = stmmac_release,
 	.ndo_change_mtu = stmmac_change_mtu,
 	.ndo_fix_features = stmmac_fix_features,
@@ -6761,6 +7587,7 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_select_queue = stmmac_select_queue,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = stmmac_poll_controller,
+	.ndo_netpoll_setup = stmmac_netpoll_setup,
 #endif
 	.ndo_set_mac_address = stmmac_set_mac_address,
 	.ndo_vlan_rx_add_vid = stmmac_vlan_rx_add_vid,
@@ -6870,6 +7697,8 @@ static int stmmac_hw_init(struct stmmac_priv *priv)
 	}
 	if (priv->plat->tx_coe)
 		dev_info(priv->device, "TX Checksum insertion supported\n");
+	else
+		priv->sw_csum = true;
 
 	if (priv->plat->pmt) {
 		dev_info(priv->device, "Wake-Up On Lan supported\n");
@@ -6920,10 +7749,19 @@ static void stmmac_napi_add(struct net_device *dev)
 
 		if (queue < priv->plat->rx_queues_to_use) {
 			netif_napi_add(dev, &ch->rx_napi, stmmac_napi_poll_rx);
+
+			hrtimer_init(&ch->rx_holdoff_timer, CLOCK_MONOTONIC,
+				     HRTIMER_MODE_REL);
+			ch->rx_holdoff_timer.function = stmmac_rx_holdoff_timer;
+			INIT_WORK(&ch->rx_dim.dim.work, stmmac_rx_dim_work);
+			ch->rx_dim.dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 		}
 		if (queue < priv->plat->tx_queues_to_use) {
 			netif_napi_add_tx(dev, &ch->tx_napi,
 					  stmmac_napi_poll_tx);
+
+			INIT_WORK(&ch->tx_dim.dim.work, stmmac_tx_dim_work);
+			ch->tx_dim.dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 		}
 		if (queue < priv->plat->rx_queues_to_use &&
 		    queue < priv->plat->tx_queues_to_use) {
@@ -7233,6 +8071,10 @@ int stmmac_dvr_probe(struct device *device,
 			ndev->hw_features |= NETIF_F_GSO_UDP_L4;
 		priv->tso = true;
 		dev_info(priv->device, "TSO feature enabled\n");
+	} else if (priv->plat->sw_tso_en && priv->plat->tx_coe) {
+		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
+		priv->sw_tso = true;
+		dev_info(priv->device, "Software TSO feature enabled\n");
 	}
 
 	if (priv->dma_cap.sphen && !priv->plat->sph_disable) {
@@ -7277,6 +8119,11 @@ int stmmac_dvr_probe(struct device *device,
 	}
 
 	ndev->features |= ndev->hw_features | NETIF_F_HIGHDMA;
+	/* Forwarded UDP is aggregated into fraglist skbs, which are cheap to
+	 * split again by software GSO on egress. Can be turned off with
+	 * ethtool -K <dev> rx-gro-list off.
+	 */
+	ndev->features |= NETIF_F_GRO_FRAGLIST;
 	ndev->watchdog_timeo = msecs_to_jiffies(watchdog);
 #ifdef STMMAC_VLAN_TAG_USED
 	/* Both mac100 and gmac support receive VLAN tag detection */
@@ -7441,6 +8288,9 @@ int stmmac_dvr_remove(struct device *dev)
 	stmmac_mac_set(priv, priv->ioaddr, false);
 	netif_carrier_off(ndev);
 	unregister_netdev(ndev);
+#ifdef CONFIG_NET_POLL_CONTROLLER
+	stmmac_netpoll_free(priv);
+#endif
 
 #ifdef CONFIG_DEBUG_FS
 	stmmac_exit_fs(ndev);
@@ -7542,6 +8392,7 @@ static void stmmac_reset_rx_queue(struct stmmac_priv *priv, u32 queue)
 
 	rx_q->cur_rx = 0;
 	rx_q->dirty_rx = 0;
+	rx_q->irq_tstamp_cnt = 0;
 }
 
 static void stmmac_reset_tx_queue(struct stmmac_priv *priv, u32 queue)
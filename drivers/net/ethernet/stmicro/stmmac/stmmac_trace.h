@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Tracepoints for the stmmac driver datapath.
+ *
+ * They are meant to tell ring starvation (the DMA ran out of buffers,
+ * refill could not keep up) apart from CPU starvation (NAPI keeps
+ * exhausting its budget).
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM stmmac
+
+#if !defined(_STMMAC_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _STMMAC_TRACE_H_
+
+#include <linux/netdevice.h>
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(stmmac_napi_poll_template,
+
+	TP_PROTO(const struct net_device *dev, u32 queue, int work_done,
+		 int budget, unsigned int ring_used),
+
+	TP_ARGS(dev, queue, work_done, budget, ring_used),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name)
+		__field(u32, queue)
+		__field(int, work_done)
+		__field(int, budget)
+		__field(unsigned int, ring_used)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name);
+		__entry->queue = queue;
+		__entry->work_done = work_done;
+		__entry->budget = budget;
+		__entry->ring_used = ring_used;
+	),
+
+	TP_printk("%s: queue=%u work_done=%d budget=%d ring_used=%u",
+		  __get_str(name), __entry->queue, __entry->work_done,
+		  __entry->budget, __entry->ring_used)
+);
+
+DEFINE_EVENT(stmmac_napi_poll_template, stmmac_rx_poll,
+	TP_PROTO(const struct net_device *dev, u32 queue, int work_done,
+		 int budget, unsigned int ring_used),
+	TP_ARGS(dev, queue, work_done, budget, ring_used)
+);
+
+DEFINE_EVENT(stmmac_napi_poll_template, stmmac_tx_poll,
+	TP_PROTO(const struct net_device *dev, u32 queue, int work_done,
+		 int budget, unsigned int ring_used),
+	TP_ARGS(dev, queue, work_done, budget, ring_used)
+);
+
+TRACE_EVENT(stmmac_rx_refill_deferred,
+
+	TP_PROTO(const struct net_device *dev, u32 queue, unsigned int pending),
+
+	TP_ARGS(dev, queue, pending),
+
+	TP_STRUCT__entry(
+		__string(name, dev->name)
+		__field(u32, queue)
+		__field(unsigned int, pending)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, dev->name);
+		__entry->queue = queue;
+		__entry->pending = pending;
+	),
+
+	TP_printk("%s: queue=%u pending=%u",
+		  __get_str(name), __entry->queue, __entry->pending)
+);
+
+#endif /* _STMMAC_TRACE_H_ */
+
+/* This must be outside ifdef _STMMAC_TRACE_H_ */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ../../drivers/net/ethernet/stmicro/stmmac/stmmac_trace
+#include <trace/define_trace.h>
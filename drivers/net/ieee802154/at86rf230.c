@@ -23,6 +23,9 @@
 #include <linux/skbuff.h>
 #include <linux/of_gpio.h>
 #include <linux/ieee802154.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 #include <net/mac802154.h>
 #include <net/cfg802154.h>
@@ -72,8 +75,6 @@ struct at86rf230_state_change {
 	u8 from_state;
 	u8 to_state;
 	int trac;
-
-	bool free;
 };
 
 struct at86rf230_local {
@@ -95,6 +96,22 @@ struct at86rf230_local {
 	u8 tx_retry;
 	struct sk_buff *tx_skb;
 	struct at86rf230_state_change tx;
+
+	/* Interrupt handling context, owned by the interrupt path from
+	 * at86rf230_isr() until the interrupt is enabled again. irq_msg
+	 * reads the IRQ status and, in the same burst, either the whole
+	 * frame buffer or the TRAC status into irq.buf.
+	 */
+	struct at86rf230_state_change irq;
+	struct spi_message irq_msg;
+	struct spi_transfer irq_trx[2];
+	u8 irq_status[2];
+	ktime_t irq_time;
+
+	u64 rx_frames;
+	u64 rx_latency_ns;
+	u64 rx_latency_max_ns;
+	struct dentry *debugfs_root;
 };
 
 #define AT86RF2XX_NUMREGS 0x3F
@@ -330,8 +347,8 @@ at86rf230_async_error_recover_complete(void *context)
 	struct at86rf230_state_change *ctx = context;
 	struct at86rf230_local *lp = ctx->lp;
 
-	if (ctx->free)
-		kfree(ctx);
+	if (ctx == &lp->irq)
+		enable_irq(ctx->irq);
 
 	if (lp->was_tx) {
 		lp->was_tx = 0;
@@ -646,7 +663,7 @@ at86rf230_tx_complete(void *context)
 	else
 		ieee802154_xmit_error(lp->hw, lp->tx_skb, ctx->trac);
 
-	kfree(ctx);
+	enable_irq(ctx->irq);
 }
 
 static void
@@ -684,6 +701,17 @@ at86rf230_tx_trac_check(void *context)
 	at86rf230_async_state_change(lp, ctx, STATE_TX_ON, at86rf230_tx_on);
 }
 
+static void
+at86rf230_rx_latency(struct at86rf230_local *lp)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), lp->irq_time));
+
+	lp->rx_frames++;
+	lp->rx_latency_ns += ns;
+	if (ns > lp->rx_latency_max_ns)
+		lp->rx_latency_max_ns = ns;
+}
+
 static void
 at86rf230_rx_read_frame_complete(void *context)
 {
@@ -693,6 +721,8 @@ at86rf230_rx_read_frame_complete(void *context)
 	struct sk_buff *skb;
 	u8 len, lqi;
 
+	ctx->trx.len = 2;
+
 	len = buf[1];
 	if (!ieee802154_is_valid_psdu_len(len)) {
 		dev_vdbg(&lp->spi->dev, "corrupted frame received\n");
@@ -703,13 +733,16 @@ at86rf230_rx_read_frame_complete(void *context)
 	skb = dev_alloc_skb(IEEE802154_MTU);
 	if (!skb) {
 		dev_vdbg(&lp->spi->dev, "failed to allocate sk_buff\n");
-		kfree(ctx);
+		enable_irq(ctx->irq);
 		return;
 	}
 
 	skb_put_data(skb, buf + 2, len);
 	ieee802154_rx_irqsafe(lp->hw, skb, lqi);
-	kfree(ctx);
+	at86rf230_rx_latency(lp);
+
+	/* the frame is out of ctx->buf, the next interrupt may reuse it */
+	enable_irq(ctx->irq);
 }
 
 static void
@@ -731,37 +764,36 @@ at86rf230_rx_trac_check(void *context)
 }
 
 static void
-at86rf230_irq_trx_end(void *context)
+at86rf230_irq_complete(void *context)
 {
-	struct at86rf230_state_change *ctx = context;
-	struct at86rf230_local *lp = ctx->lp;
+	struct at86rf230_local *lp = context;
+	struct at86rf230_state_change *ctx = &lp->irq;
+	bool got_trac = lp->irq_trx[1].len == 2;
+	u8 irq = lp->irq_status[1];
 
-	if (lp->is_tx) {
-		lp->is_tx = 0;
-		at86rf230_async_read_reg(lp, RG_TRX_STATE, ctx,
-					 at86rf230_tx_trac_check);
-	} else {
-		at86rf230_async_read_reg(lp, RG_TRX_STATE, ctx,
-					 at86rf230_rx_trac_check);
+	if (!(irq & IRQ_TRX_END)) {
+		dev_err(&lp->spi->dev, "not supported irq %02x received\n",
+			irq);
+		enable_irq(ctx->irq);
+		return;
 	}
-}
 
-static void
-at86rf230_irq_status(void *context)
-{
-	struct at86rf230_state_change *ctx = context;
-	struct at86rf230_local *lp = ctx->lp;
-	const u8 *buf = ctx->buf;
-	u8 irq = buf[1];
-
-	enable_irq(lp->spi->irq);
-
-	if (irq & IRQ_TRX_END) {
-		at86rf230_irq_trx_end(ctx);
+	/* The burst was chosen from is_tx when the interrupt fired. If a
+	 * transmission started or was aborted since, fetch what is still
+	 * missing.
+	 */
+	if (lp->is_tx) {
+		lp->is_tx = 0;
+		if (got_trac)
+			at86rf230_tx_trac_check(ctx);
+		else
+			at86rf230_async_read_reg(lp, RG_TRX_STATE, ctx,
+						 at86rf230_tx_trac_check);
 	} else {
-		dev_err(&lp->spi->dev, "not supported irq %02x received\n",
-			irq);
-		kfree(ctx);
+		if (got_trac)
+			at86rf230_rx_trac_check(ctx);
+		else
+			at86rf230_rx_read_frame_complete(ctx);
 	}
 }
 
@@ -781,33 +813,53 @@ at86rf230_setup_spi_messages(struct at86rf230_local *lp,
 	state->timer.function = at86rf230_async_state_timer;
 }
 
+static void
+at86rf230_setup_irq_message(struct at86rf230_local *lp)
+{
+	at86rf230_setup_spi_messages(lp, &lp->irq);
+
+	spi_message_init(&lp->irq_msg);
+	lp->irq_msg.context = lp;
+	lp->irq_msg.complete = at86rf230_irq_complete;
+
+	lp->irq_trx[0].len = 2;
+	lp->irq_trx[0].tx_buf = lp->irq_status;
+	lp->irq_trx[0].rx_buf = lp->irq_status;
+	lp->irq_trx[0].cs_change = 1;
+	spi_message_add_tail(&lp->irq_trx[0], &lp->irq_msg);
+
+	lp->irq_trx[1].len = 2;
+	lp->irq_trx[1].tx_buf = lp->irq.buf;
+	lp->irq_trx[1].rx_buf = lp->irq.buf;
+	spi_message_add_tail(&lp->irq_trx[1], &lp->irq_msg);
+}
+
 static irqreturn_t at86rf230_isr(int irq, void *data)
 {
 	struct at86rf230_local *lp = data;
-	struct at86rf230_state_change *ctx;
 	int rc;
 
 	disable_irq_nosync(irq);
 
-	ctx = kzalloc(sizeof(*ctx), GFP_ATOMIC);
-	if (!ctx) {
-		enable_irq(irq);
-		return IRQ_NONE;
-	}
-
-	at86rf230_setup_spi_messages(lp, ctx);
-	/* tell on error handling to free ctx */
-	ctx->free = true;
+	lp->irq_time = ktime_get();
 
-	ctx->buf[0] = (RG_IRQ_STATUS & CMD_REG_MASK) | CMD_REG;
-	ctx->msg.complete = at86rf230_irq_status;
-	rc = spi_async(lp->spi, &ctx->msg);
-	if (rc) {
-		at86rf230_async_error(lp, ctx, rc);
-		enable_irq(irq);
-		return IRQ_NONE;
+	/* Read the IRQ status together with what TRX_END will need, so
+	 * that a received frame costs a single SPI message.
+	 */
+	lp->irq_status[0] = (RG_IRQ_STATUS & CMD_REG_MASK) | CMD_REG;
+	if (lp->is_tx) {
+		lp->irq.buf[0] = (RG_TRX_STATE & CMD_REG_MASK) | CMD_REG;
+		lp->irq_trx[1].len = 2;
+	} else {
+		lp->irq.buf[0] = CMD_FB;
+		lp->irq_trx[1].len = AT86RF2XX_MAX_BUF;
 	}
 
+	rc = spi_async(lp->spi, &lp->irq_msg);
+	if (rc)
+		/* recovery enables the interrupt again */
+		at86rf230_async_error(lp, &lp->irq, rc);
+
 	return IRQ_HANDLED;
 }
 
@@ -1542,6 +1594,33 @@ not_supp:
 	return rc;
 }
 
+static int at86rf230_rx_latency_show(struct seq_file *file, void *offset)
+{
+	struct at86rf230_local *lp = file->private;
+	u64 frames = lp->rx_frames;
+
+	seq_printf(file, "frames:\t\t%llu\n", frames);
+	seq_printf(file, "avg_ns:\t\t%llu\n",
+		   frames ? div64_u64(lp->rx_latency_ns, frames) : 0);
+	seq_printf(file, "max_ns:\t\t%llu\n", lp->rx_latency_max_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(at86rf230_rx_latency);
+
+static void at86rf230_debugfs_init(struct at86rf230_local *lp)
+{
+	char debugfs_dir_name[DNAME_INLINE_LEN + 1];
+
+	snprintf(debugfs_dir_name, sizeof(debugfs_dir_name), "at86rf230-%s",
+		 dev_name(&lp->spi->dev));
+
+	lp->debugfs_root = debugfs_create_dir(debugfs_dir_name, NULL);
+	/* interrupt to hand over of the frame to mac802154 */
+	debugfs_create_file("rx_latency", 0444, lp->debugfs_root, lp,
+			    &at86rf230_rx_latency_fops);
+}
+
 static int at86rf230_probe(struct spi_device *spi)
 {
 	struct ieee802154_hw *hw;
@@ -1605,6 +1684,7 @@ static int at86rf230_probe(struct spi_device *spi)
 
 	at86rf230_setup_spi_messages(lp, &lp->state);
 	at86rf230_setup_spi_messages(lp, &lp->tx);
+	at86rf230_setup_irq_message(lp);
 
 	rc = at86rf230_detect_device(lp);
 	if (rc < 0)
@@ -1642,6 +1722,8 @@ static int at86rf230_probe(struct spi_device *spi)
 	if (rc)
 		goto free_dev;
 
+	at86rf230_debugfs_init(lp);
+
 	return rc;
 
 free_dev:
@@ -1656,6 +1738,7 @@ static void at86rf230_remove(struct spi_device *spi)
 
 	/* mask all at86rf230 irq's */
 	at86rf230_write_subreg(lp, SR_IRQ_MASK, 0);
+	debugfs_remove_recursive(lp->debugfs_root);
 	ieee802154_unregister_hw(lp->hw);
 	ieee802154_free_hw(lp->hw);
 	dev_dbg(&spi->dev, "unregistered at86rf230\n");
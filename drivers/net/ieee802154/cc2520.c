@@ -14,6 +14,7 @@
 #include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/skbuff.h>
+#include <linux/debugfs.h>
 #include <linux/of_gpio.h>
 #include <linux/ieee802154.h>
 #include <linux/crc-ccitt.h>
@@ -40,6 +41,9 @@
 
 #define	CC2520_FREG_MASK	0x3F
 
+/* 127 octets at 250 kb/s plus the CCA, with a generous margin */
+#define	CC2520_TX_TIMEOUT_MS	20
+
 /* status byte values */
 #define	CC2520_STATUS_XOSC32M_STABLE	BIT(7)
 #define	CC2520_STATUS_RSSI_VALID	BIT(6)
@@ -198,6 +202,9 @@
 #define FRMCTRL1_SET_RXENMASK_ON_TX	BIT(0)
 #define FRMCTRL1_IGNORE_TX_UNDERF	BIT(1)
 
+/* CC2520_FSMSTAT1 */
+#define FSMSTAT1_SAMPLED_CCA		BIT(3)
+
 /* Driver private information */
 struct cc2520_private {
 	struct spi_device *spi;		/* SPI device structure */
@@ -211,6 +218,11 @@ struct cc2520_private {
 	spinlock_t lock;		/* Lock for is_tx*/
 	struct completion tx_complete;	/* Work completion for Tx */
 	bool promiscuous;               /* Flag for promiscuous mode */
+	u64 tx_frames;			/* Frames sent */
+	u64 tx_cca_fails;		/* STXONCCA found the channel busy */
+	u64 tx_timeouts;		/* No SFD seen for a started TX */
+	u64 rx_crc_errors;		/* Frames dropped on CRC */
+	struct dentry *debugfs_root;
 };
 
 /* Generic Functions */
@@ -518,14 +530,36 @@ cc2520_tx(struct ieee802154_hw *hw, struct sk_buff *skb)
 	if (rc)
 		goto err;
 
-	rc = wait_for_completion_interruptible(&priv->tx_complete);
+	/* STXONCCA is silently ignored on a busy channel, in which case no
+	 * SFD interrupt will ever come. SAMPLED_CCA holds the CCA result the
+	 * strobe was taken on.
+	 */
+	rc = cc2520_read_register(priv, CC2520_FSMSTAT1, &status);
+	if (rc)
+		goto err;
+
+	if (!(status & FSMSTAT1_SAMPLED_CCA)) {
+		priv->tx_cca_fails++;
+		rc = -EBUSY;
+		goto err;
+	}
+
+	rc = wait_for_completion_interruptible_timeout(&priv->tx_complete,
+			msecs_to_jiffies(CC2520_TX_TIMEOUT_MS));
+	if (!rc) {
+		priv->tx_timeouts++;
+		rc = -ETIMEDOUT;
+	}
 	if (rc < 0)
 		goto err;
 
-	cc2520_cmd_strobe(priv, CC2520_CMD_SFLUSHTX);
-	cc2520_cmd_strobe(priv, CC2520_CMD_SRXON);
+	/* SET_RXENMASK_ON_TX puts the radio back into RX once the frame is
+	 * out, and the TX FIFO gets flushed before the next frame anyway, so
+	 * there is nothing left to strobe here.
+	 */
+	priv->tx_frames++;
 
-	return rc;
+	return 0;
 err:
 	spin_lock_irqsave(&priv->lock, flags);
 	priv->is_tx = 0;
@@ -576,6 +610,7 @@ static int cc2520_rx(struct cc2520_private *priv)
 
 		/* If we failed CRC drop the packet in the driver layer. */
 		if (!crc_ok) {
+			priv->rx_crc_errors++;
 			dev_dbg(&priv->spi->dev, "CRC check failed\n");
 			kfree_skb(skb);
 			return -EINVAL;
@@ -912,6 +947,31 @@ static irqreturn_t cc2520_sfd_isr(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+static int cc2520_stats_show(struct seq_file *file, void *offset)
+{
+	struct cc2520_private *priv = file->private;
+
+	seq_printf(file, "tx_frames:\t%llu\n", priv->tx_frames);
+	seq_printf(file, "tx_cca_fails:\t%llu\n", priv->tx_cca_fails);
+	seq_printf(file, "tx_timeouts:\t%llu\n", priv->tx_timeouts);
+	seq_printf(file, "rx_crc_errors:\t%llu\n", priv->rx_crc_errors);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cc2520_stats);
+
+static void cc2520_debugfs_init(struct cc2520_private *priv)
+{
+	char debugfs_dir_name[DNAME_INLINE_LEN + 1];
+
+	snprintf(debugfs_dir_name, sizeof(debugfs_dir_name), "cc2520-%s",
+		 dev_name(&priv->spi->dev));
+
+	priv->debugfs_root = debugfs_create_dir(debugfs_dir_name, NULL);
+	debugfs_create_file("stats", 0444, priv->debugfs_root, priv,
+			    &cc2520_stats_fops);
+}
+
 static int cc2520_get_platform_data(struct spi_device *spi,
 				    struct cc2520_platform_data *pdata)
 {
@@ -1206,6 +1266,8 @@ static int cc2520_probe(struct spi_device *spi)
 	if (ret)
 		goto err_hw_init;
 
+	cc2520_debugfs_init(priv);
+
 	return 0;
 
 err_hw_init:
@@ -1218,6 +1280,7 @@ static void cc2520_remove(struct spi_device *spi)
 {
 	struct cc2520_private *priv = spi_get_drvdata(spi);
 
+	debugfs_remove_recursive(priv->debugfs_root);
 	mutex_destroy(&priv->buffer_mutex);
 	flush_work(&priv->fifop_irqwork);
 
@@ -7,6 +7,7 @@
  */
 
 #include <linux/spi/spi.h>
+#include <linux/debugfs.h>
 #include <linux/interrupt.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
@@ -65,6 +66,10 @@
 #define REG_WAKECON	0x22
 #define REG_FROMOFFSET	0x23
 #define REG_TXSTAT	0x24  /* TX MAC Status Register */
+#define TXSTAT_TXNRETRY_SHIFT	6
+#define TXSTAT_TXNRETRY_MASK	0xC0
+#define TXSTAT_CCAFAIL		BIT(5)
+#define TXSTAT_TXNSTAT		BIT(0)
 #define REG_TXBCON1	0x25
 #define REG_GATECLK	0x26
 #define REG_TXTIME	0x27
@@ -208,12 +213,10 @@ struct mrf24j40 {
 	u8 tx_len_buf[2];
 	struct spi_transfer tx_len_trx;
 	struct spi_transfer tx_buf_trx;
-	struct sk_buff *tx_skb;
-
-	/* post transmit message to send frame out  */
-	struct spi_message tx_post_msg;
+	/* TXNCON write which sends the frame out, same message as above */
 	u8 tx_post_buf[2];
 	struct spi_transfer tx_post_trx;
+	struct sk_buff *tx_skb;
 
 	/* for protect/unprotect/read length rxfifo */
 	struct spi_message rx_msg;
@@ -229,10 +232,19 @@ struct mrf24j40 {
 	u8 rx_fifo_buf[RX_FIFO_SIZE];
 	struct spi_transfer rx_fifo_buf_trx;
 
-	/* isr handling for reading intstat */
+	/* isr handling for reading intstat and txstat */
 	struct spi_message irq_msg;
 	u8 irq_buf[2];
 	struct spi_transfer irq_trx;
+	u8 irq_txstat_buf[2];
+	struct spi_transfer irq_txstat_trx;
+
+	/* transmit statistics, updated from the irq message completion */
+	u64 tx_frames;
+	u64 tx_retries;
+	u64 tx_cca_fails;
+	u64 tx_no_acks;
+	struct dentry *debugfs_root;
 };
 
 /* regmap information for short address register access */
@@ -540,23 +552,11 @@ static const struct regmap_bus mrf24j40_long_regmap_bus = {
 static void write_tx_buf_complete(void *context)
 {
 	struct mrf24j40 *devrec = context;
-	__le16 fc = ieee802154_get_fc_from_skb(devrec->tx_skb);
-	u8 val = BIT_TXNTRIG;
-	int ret;
-
-	if (ieee802154_is_secen(fc))
-		val |= BIT_TXNSECEN;
-
-	if (ieee802154_is_ackreq(fc))
-		val |= BIT_TXNACKREQ;
-
-	devrec->tx_post_msg.complete = NULL;
-	devrec->tx_post_buf[0] = MRF24J40_WRITESHORT(REG_TXNCON);
-	devrec->tx_post_buf[1] = val;
 
-	ret = spi_async(devrec->spi, &devrec->tx_post_msg);
-	if (ret)
+	if (devrec->tx_msg.status) {
 		dev_err(printdev(devrec), "SPI write Failed for transmit buf\n");
+		ieee802154_xmit_hw_error(devrec->hw, devrec->tx_skb);
+	}
 }
 
 /* This function relies on an undocumented write method. Once a write command
@@ -565,6 +565,8 @@ static void write_tx_buf_complete(void *context)
 static int write_tx_buf(struct mrf24j40 *devrec, u16 reg,
 			const u8 *data, size_t length)
 {
+	__le16 fc = ieee802154_get_fc_from_skb(devrec->tx_skb);
+	u8 val = BIT_TXNTRIG;
 	u16 cmd;
 	int ret;
 
@@ -582,6 +584,19 @@ static int write_tx_buf(struct mrf24j40 *devrec, u16 reg,
 	devrec->tx_buf_trx.tx_buf = data;
 	devrec->tx_buf_trx.len = length;
 
+	/* Trigger the transmission from the same message, so the frame goes
+	 * out as soon as the FIFO is loaded and no extra completion has to
+	 * run in between.
+	 */
+	if (ieee802154_is_secen(fc))
+		val |= BIT_TXNSECEN;
+
+	if (ieee802154_is_ackreq(fc))
+		val |= BIT_TXNACKREQ;
+
+	devrec->tx_post_buf[0] = MRF24J40_WRITESHORT(REG_TXNCON);
+	devrec->tx_post_buf[1] = val;
+
 	ret = spi_async(devrec->spi, &devrec->tx_msg);
 	if (ret)
 		dev_err(printdev(devrec), "SPI write Failed for TX buf\n");
@@ -1017,6 +1032,33 @@ static const struct ieee802154_ops mrf24j40_ops = {
 	.set_promiscuous_mode = mrf24j40_set_promiscuous_mode,
 };
 
+static void mrf24j40_tx_complete(struct mrf24j40 *devrec)
+{
+	u8 txstat = devrec->irq_txstat_buf[1];
+
+	devrec->tx_frames++;
+	devrec->tx_retries += (txstat & TXSTAT_TXNRETRY_MASK) >>
+			      TXSTAT_TXNRETRY_SHIFT;
+
+	if (!(txstat & TXSTAT_TXNSTAT)) {
+		ieee802154_xmit_complete(devrec->hw, devrec->tx_skb, false);
+		return;
+	}
+
+	/* The MAC already did the CSMA-CA backoffs and the retransmissions
+	 * when no ACK came back, report why it gave up.
+	 */
+	if (txstat & TXSTAT_CCAFAIL) {
+		devrec->tx_cca_fails++;
+		ieee802154_xmit_error(devrec->hw, devrec->tx_skb,
+				      IEEE802154_CHANNEL_ACCESS_FAILURE);
+	} else {
+		devrec->tx_no_acks++;
+		ieee802154_xmit_error(devrec->hw, devrec->tx_skb,
+				      IEEE802154_NO_ACK);
+	}
+}
+
 static void mrf24j40_intstat_complete(void *context)
 {
 	struct mrf24j40 *devrec = context;
@@ -1031,7 +1073,7 @@ static void mrf24j40_intstat_complete(void *context)
 
 	/* Check for TX complete */
 	if (intstat & BIT_TXNIF)
-		ieee802154_xmit_complete(devrec->hw, devrec->tx_skb, false);
+		mrf24j40_tx_complete(devrec);
 
 	/* Check for Rx */
 	if (intstat & BIT_RXIF)
@@ -1047,6 +1089,8 @@ static irqreturn_t mrf24j40_isr(int irq, void *data)
 
 	devrec->irq_buf[0] = MRF24J40_READSHORT(REG_INTSTAT);
 	devrec->irq_buf[1] = 0;
+	devrec->irq_txstat_buf[0] = MRF24J40_READSHORT(REG_TXSTAT);
+	devrec->irq_txstat_buf[1] = 0;
 
 	/* Read the interrupt status */
 	ret = spi_async(devrec->spi, &devrec->irq_msg);
@@ -1189,13 +1233,11 @@ mrf24j40_setup_tx_spi_messages(struct mrf24j40 *devrec)
 	devrec->tx_len_trx.len = 2;
 	devrec->tx_len_trx.tx_buf = devrec->tx_len_buf;
 	spi_message_add_tail(&devrec->tx_len_trx, &devrec->tx_msg);
+	devrec->tx_buf_trx.cs_change = 1;
 	spi_message_add_tail(&devrec->tx_buf_trx, &devrec->tx_msg);
-
-	spi_message_init(&devrec->tx_post_msg);
-	devrec->tx_post_msg.context = devrec;
 	devrec->tx_post_trx.len = 2;
 	devrec->tx_post_trx.tx_buf = devrec->tx_post_buf;
-	spi_message_add_tail(&devrec->tx_post_trx, &devrec->tx_post_msg);
+	spi_message_add_tail(&devrec->tx_post_trx, &devrec->tx_msg);
 }
 
 static void
@@ -1230,7 +1272,37 @@ mrf24j40_setup_irq_spi_messages(struct mrf24j40 *devrec)
 	devrec->irq_trx.len = 2;
 	devrec->irq_trx.tx_buf = devrec->irq_buf;
 	devrec->irq_trx.rx_buf = devrec->irq_buf;
+	devrec->irq_trx.cs_change = 1;
 	spi_message_add_tail(&devrec->irq_trx, &devrec->irq_msg);
+	devrec->irq_txstat_trx.len = 2;
+	devrec->irq_txstat_trx.tx_buf = devrec->irq_txstat_buf;
+	devrec->irq_txstat_trx.rx_buf = devrec->irq_txstat_buf;
+	spi_message_add_tail(&devrec->irq_txstat_trx, &devrec->irq_msg);
+}
+
+static int mrf24j40_tx_stats_show(struct seq_file *file, void *offset)
+{
+	struct mrf24j40 *devrec = file->private;
+
+	seq_printf(file, "frames:\t\t%llu\n", devrec->tx_frames);
+	seq_printf(file, "retries:\t%llu\n", devrec->tx_retries);
+	seq_printf(file, "cca_fails:\t%llu\n", devrec->tx_cca_fails);
+	seq_printf(file, "no_acks:\t%llu\n", devrec->tx_no_acks);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mrf24j40_tx_stats);
+
+static void mrf24j40_debugfs_init(struct mrf24j40 *devrec)
+{
+	char debugfs_dir_name[DNAME_INLINE_LEN + 1];
+
+	snprintf(debugfs_dir_name, sizeof(debugfs_dir_name), "mrf24j40-%s",
+		 dev_name(&devrec->spi->dev));
+
+	devrec->debugfs_root = debugfs_create_dir(debugfs_dir_name, NULL);
+	debugfs_create_file("tx_stats", 0444, devrec->debugfs_root, devrec,
+			    &mrf24j40_tx_stats_fops);
 }
 
 static void  mrf24j40_phy_setup(struct mrf24j40 *devrec)
@@ -1348,6 +1420,8 @@ static int mrf24j40_probe(struct spi_device *spi)
 	if (ret)
 		goto err_register_device;
 
+	mrf24j40_debugfs_init(devrec);
+
 	return 0;
 
 err_register_device:
@@ -1362,6 +1436,7 @@ static void mrf24j40_remove(struct spi_device *spi)
 
 	dev_dbg(printdev(devrec), "remove\n");
 
+	debugfs_remove_recursive(devrec->debugfs_root);
 	ieee802154_unregister_hw(devrec->hw);
 	ieee802154_free_hw(devrec->hw);
 	/* TODO: Will ieee802154_free_device() wait until ->xmit() is
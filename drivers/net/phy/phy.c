@@ -38,6 +38,18 @@
 
 #define PHY_STATE_TIME	HZ
 
+/* Polling interval for PHYs without an interrupt, PHY_STATE_TIME if 0 */
+static unsigned int phy_poll_ms;
+module_param_named(poll_ms, phy_poll_ms, uint, 0644);
+MODULE_PARM_DESC(poll_ms, "Link polling interval in ms for PHYs without interrupt (0: 1s)");
+
+static unsigned long phy_poll_interval(void)
+{
+	unsigned int ms = READ_ONCE(phy_poll_ms);
+
+	return ms ? max(msecs_to_jiffies(ms), 1UL) : PHY_STATE_TIME;
+}
+
 #define PHY_STATE_STR(_state)			\
 	case PHY_##_state:			\
 		return __stringify(_state);	\
@@ -1255,7 +1267,7 @@ void phy_state_machine(struct work_struct *work)
 	 */
 	mutex_lock(&phydev->lock);
 	if (phy_polling_mode(phydev) && phy_is_started(phydev))
-		phy_queue_state_machine(phydev, PHY_STATE_TIME);
+		phy_queue_state_machine(phydev, phy_poll_interval());
 	mutex_unlock(&phydev->lock);
 }
 
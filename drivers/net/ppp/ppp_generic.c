@@ -48,6 +48,7 @@
 #include <net/slhc_vj.h>
 #include <linux/atomic.h>
 #include <linux/refcount.h>
+#include <linux/workqueue.h>
 
 #include <linux/nsproxy.h>
 #include <net/net_namespace.h>
@@ -150,6 +151,13 @@ struct ppp {
 #endif /* CONFIG_PPP_FILTER */
 	struct net	*ppp_net;	/* the net we belong to */
 	struct ppp_link_stats stats64;	/* 64 bit network stats */
+	spinlock_t	xclock;		/* xc_state vs. the compress worker */
+	struct sk_buff_head xcq;	/* frames waiting for the compressor */
+	bool		xc_busy;	/* worker holds a frame from xcq */
+	struct sk_buff_head xsq;	/* compressed frames ready to send */
+	struct sk_buff_head rcq;	/* frames waiting to be decompressed */
+	struct work_struct xcomp_work;	/* runs the compressor */
+	struct work_struct rcomp_work;	/* runs the decompressor */
 };
 
 /*
@@ -200,6 +208,15 @@ struct ppp_config {
  * before you modify them.
  * The lock ordering is: channel.upl -> ppp.wlock -> ppp.rlock ->
  * channel.downl.
+ *
+ * CCP (de)compression runs from the ppp_comp_wq workers rather than
+ * inline. Each unit has one work item per direction, so frames keep
+ * their order; different units are compressed on different CPUs.
+ * ppp.xclock is the innermost lock and protects the transmit
+ * compressor state and ppp.xstate while the worker uses them without
+ * ppp.wlock. Frames move from xcq to the worker and from the worker to
+ * xsq under ppp.wlock only, so the xmit path sees them in order.
+ * The decompressor still runs under ppp.rlock, one frame at a time.
  */
 
 static DEFINE_MUTEX(ppp_mutex);
@@ -238,6 +255,9 @@ struct ppp_net {
 /* We limit the length of ppp->file.rq to this (arbitrary) value */
 #define PPP_MAX_RQLEN	32
 
+/* Frames queued up for, or coming back from, a CCP worker */
+#define PPP_MAX_COMPQ	32
+
 /*
  * Maximum number of multilink fragments queued up.
  * This has to be large enough to cope with the maximum latency of
@@ -265,6 +285,8 @@ static void ppp_receive_frame(struct ppp *ppp, struct sk_buff *skb,
 			      struct channel *pch);
 static void ppp_receive_error(struct ppp *ppp);
 static void ppp_receive_nonmp_frame(struct ppp *ppp, struct sk_buff *skb);
+static void ppp_comp_work(struct work_struct *work);
+static void ppp_decomp_work(struct work_struct *work);
 static struct sk_buff *ppp_decompress_frame(struct ppp *ppp,
 					    struct sk_buff *skb);
 #ifdef CONFIG_PPP_MULTILINK
@@ -297,6 +319,8 @@ static const struct net_device_ops ppp_netdev_ops;
 
 static struct class *ppp_class;
 
+static struct workqueue_struct *ppp_comp_wq;
+
 /* per net-namespace data */
 static inline struct ppp_net *ppp_pernet(struct net *net)
 {
@@ -1237,6 +1261,12 @@ static int ppp_dev_configure(struct net *src_net, struct net_device *dev,
 	INIT_LIST_HEAD(&ppp->channels);
 	spin_lock_init(&ppp->rlock);
 	spin_lock_init(&ppp->wlock);
+	spin_lock_init(&ppp->xclock);
+	skb_queue_head_init(&ppp->xcq);
+	skb_queue_head_init(&ppp->xsq);
+	skb_queue_head_init(&ppp->rcq);
+	INIT_WORK(&ppp->xcomp_work, ppp_comp_work);
+	INIT_WORK(&ppp->rcomp_work, ppp_decomp_work);
 
 	ppp->xmit_recursion = alloc_percpu(int);
 	if (!ppp->xmit_recursion) {
@@ -1400,10 +1430,16 @@ static int __init ppp_init(void)
 		goto out_chrdev;
 	}
 
+	ppp_comp_wq = alloc_workqueue("ppp_comp", WQ_UNBOUND, 0);
+	if (!ppp_comp_wq) {
+		err = -ENOMEM;
+		goto out_class;
+	}
+
 	err = rtnl_link_register(&ppp_link_ops);
 	if (err) {
 		pr_err("failed to register rtnetlink PPP handler\n");
-		goto out_class;
+		goto out_wq;
 	}
 
 	/* not a big deal if we fail here :-) */
@@ -1411,6 +1447,8 @@ static int __init ppp_init(void)
 
 	return 0;
 
+out_wq:
+	destroy_workqueue(ppp_comp_wq);
 out_class:
 	class_destroy(ppp_class);
 out_chrdev:
@@ -1458,6 +1496,17 @@ ppp_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	put_unaligned_be16(proto, pp);
 
 	skb_scrub_packet(skb, !net_eq(ppp->ppp_net, dev_net(dev)));
+
+	/* More packets follow in this batch: just queue this one, the last
+	 * packet of the batch takes the xmit lock once and sends them all
+	 * down the channel. Not while recursing, so the recursion check in
+	 * ppp_xmit_process() still sees every packet.
+	 */
+	if (netdev_xmit_more() && !__this_cpu_read(*ppp->xmit_recursion)) {
+		skb_queue_tail(&ppp->file.xq, skb);
+		return NETDEV_TX_OK;
+	}
+
 	ppp_xmit_process(ppp, skb);
 
 	return NETDEV_TX_OK;
@@ -1465,6 +1514,9 @@ ppp_start_xmit(struct sk_buff *skb, struct net_device *dev)
  outf:
 	kfree_skb(skb);
 	++dev->stats.tx_dropped;
+	/* don't strand what the rest of the batch queued */
+	if (!netdev_xmit_more() && !skb_queue_empty_lockless(&ppp->file.xq))
+		ppp_xmit_process(ppp, NULL);
 	return NETDEV_TX_OK;
 }
 
@@ -1558,6 +1610,13 @@ static void ppp_dev_uninit(struct net_device *dev)
 	ppp->closing = 1;
 	ppp_unlock(ppp);
 
+	/* nothing queues more CCP work once closing is set */
+	cancel_work_sync(&ppp->xcomp_work);
+	cancel_work_sync(&ppp->rcomp_work);
+	skb_queue_purge(&ppp->xcq);
+	skb_queue_purge(&ppp->xsq);
+	skb_queue_purge(&ppp->rcq);
+
 	mutex_lock(&pn->all_ppp_mutex);
 	unit_put(&pn->units_idr, ppp->file.index);
 	mutex_unlock(&pn->all_ppp_mutex);
@@ -1632,6 +1691,20 @@ static void ppp_setup(struct net_device *dev)
  * Transmit-side routines.
  */
 
+static void ppp_send_ready(struct ppp *ppp, struct sk_buff *skb);
+
+/* Frames are waiting for, or held by, the compress worker */
+static bool ppp_comp_pending(struct ppp *ppp)
+{
+	return !skb_queue_empty(&ppp->xcq) || ppp->xc_busy;
+}
+
+static bool ppp_comp_busy(struct ppp *ppp)
+{
+	return skb_queue_len(&ppp->xcq) + skb_queue_len(&ppp->xsq) >=
+	       PPP_MAX_COMPQ;
+}
+
 /* Called to do any work queued up on the transmit side that can now be done */
 static void __ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
 {
@@ -1639,14 +1712,19 @@ static void __ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
 	if (!ppp->closing) {
 		ppp_push(ppp);
 
+		/* frames back from the compressor go first */
+		while (!ppp->xmit_pending && skb_peek(&ppp->xsq))
+			ppp_send_ready(ppp, skb_dequeue(&ppp->xsq));
+
 		if (skb)
 			skb_queue_tail(&ppp->file.xq, skb);
-		while (!ppp->xmit_pending &&
+		while (!ppp->xmit_pending && !ppp_comp_busy(ppp) &&
 		       (skb = skb_dequeue(&ppp->file.xq)))
 			ppp_send_frame(ppp, skb);
 		/* If there's no work left to do, tell the core net
 		   code that we can accept some more. */
-		if (!ppp->xmit_pending && !skb_peek(&ppp->file.xq))
+		if (!ppp->xmit_pending && !skb_peek(&ppp->file.xq) &&
+		    !ppp_comp_busy(ppp))
 			netif_wake_queue(ppp->dev);
 		else
 			netif_stop_queue(ppp->dev);
@@ -1810,33 +1888,54 @@ ppp_send_frame(struct ppp *ppp, struct sk_buff *skb)
 		break;
 
 	case PPP_CCP:
-		/* peek at outbound CCP frames */
-		ppp_ccp_peek(ppp, skb, 0);
+		/* peek at outbound CCP frames, the worker does it for
+		 * frames queued behind data it has not compressed yet
+		 */
+		if (!ppp_comp_pending(ppp))
+			ppp_ccp_peek(ppp, skb, 0);
 		break;
 	}
 
-	/* try to do packet compression */
-	if ((ppp->xstate & SC_COMP_RUN) && ppp->xc_state &&
-	    proto != PPP_LCP && proto != PPP_CCP) {
-		if (!(ppp->flags & SC_CCP_UP) && (ppp->flags & SC_MUST_COMP)) {
-			if (net_ratelimit())
-				netdev_err(ppp->dev,
-					   "ppp: compression required but "
-					   "down - pkt dropped.\n");
-			goto drop;
-		}
-		skb = pad_compress_skb(ppp, skb);
-		if (!skb)
-			goto drop;
+	/*
+	 * Packet compression is left to the compress worker. LCP and CCP
+	 * frames are never compressed, but still queue behind frames the
+	 * worker holds: a CCP Reset-Ack must not overtake data compressed
+	 * before the reset, nor the reset hit the compressor before it.
+	 */
+	if (ppp_comp_pending(ppp) ||
+	    (proto != PPP_LCP && proto != PPP_CCP &&
+	     (ppp->xstate & SC_COMP_RUN) && ppp->xc_state)) {
+		skb_queue_tail(&ppp->xcq, skb);
+		queue_work(ppp_comp_wq, &ppp->xcomp_work);
+		return;
 	}
 
+	ppp_send_ready(ppp, skb);
+	return;
+
+ drop:
+	kfree_skb(skb);
+	++ppp->dev->stats.tx_errors;
+}
+
+/*
+ * Hand a frame that needs no more processing to the channel(s).
+ * The caller should have locked the xmit path,
+ * and xmit_pending should be 0.
+ */
+static void
+ppp_send_ready(struct ppp *ppp, struct sk_buff *skb)
+{
 	/*
 	 * If we are waiting for traffic (demand dialling),
 	 * queue it up for pppd to receive.
 	 */
 	if (ppp->flags & SC_LOOP_TRAFFIC) {
-		if (ppp->file.rq.qlen > PPP_MAX_RQLEN)
-			goto drop;
+		if (ppp->file.rq.qlen > PPP_MAX_RQLEN) {
+			kfree_skb(skb);
+			++ppp->dev->stats.tx_errors;
+			return;
+		}
 		skb_queue_tail(&ppp->file.rq, skb);
 		wake_up_interruptible(&ppp->file.rwait);
 		return;
@@ -1844,11 +1943,75 @@ ppp_send_frame(struct ppp *ppp, struct sk_buff *skb)
 
 	ppp->xmit_pending = skb;
 	ppp_push(ppp);
-	return;
+}
 
- drop:
-	kfree_skb(skb);
-	++ppp->dev->stats.tx_errors;
+/* Called with xclock held; returns NULL if the frame was dropped. */
+static struct sk_buff *
+ppp_compress_frame(struct ppp *ppp, struct sk_buff *skb)
+{
+	if (!(ppp->xstate & SC_COMP_RUN) || !ppp->xc_state)
+		return skb;
+
+	if (!(ppp->flags & SC_CCP_UP) && (ppp->flags & SC_MUST_COMP)) {
+		if (net_ratelimit())
+			netdev_err(ppp->dev,
+				   "ppp: compression required but "
+				   "down - pkt dropped.\n");
+		kfree_skb(skb);
+		return NULL;
+	}
+
+	return pad_compress_skb(ppp, skb);
+}
+
+/*
+ * Compress the frames ppp_send_frame() queued on xcq, in order, and
+ * feed them back to the xmit path. Only xclock is held while the
+ * compressor runs, so other frames can still be sent meanwhile; xc_busy
+ * keeps ppp_send_frame() queueing behind the frame being compressed.
+ * LCP and CCP frames pass through uncompressed; CCP frames are peeked
+ * at here, so that a reset applies between the frames around it.
+ */
+static void ppp_comp_work(struct work_struct *work)
+{
+	struct ppp *ppp = container_of(work, struct ppp, xcomp_work);
+	struct sk_buff *skb;
+	int proto;
+
+	for (;;) {
+		ppp_xmit_lock(ppp);
+		skb = skb_dequeue(&ppp->xcq);
+		if (!skb) {
+			ppp_xmit_unlock(ppp);
+			break;
+		}
+
+		proto = PPP_PROTO(skb);
+		if (proto == PPP_CCP || proto == PPP_LCP) {
+			if (proto == PPP_CCP)
+				ppp_ccp_peek(ppp, skb, 0);
+			skb_queue_tail(&ppp->xsq, skb);
+			ppp_xmit_unlock(ppp);
+		} else {
+			ppp->xc_busy = true;
+			ppp_xmit_unlock(ppp);
+
+			spin_lock_bh(&ppp->xclock);
+			skb = ppp_compress_frame(ppp, skb);
+			spin_unlock_bh(&ppp->xclock);
+
+			ppp_xmit_lock(ppp);
+			ppp->xc_busy = false;
+			if (skb)
+				skb_queue_tail(&ppp->xsq, skb);
+			else
+				++ppp->dev->stats.tx_errors;
+			ppp_xmit_unlock(ppp);
+		}
+
+		ppp_xmit_process(ppp, NULL);
+		cond_resched();
+	}
 }
 
 /*
@@ -2370,7 +2533,7 @@ ppp_receive_error(struct ppp *ppp)
 }
 
 static void
-ppp_receive_nonmp_frame(struct ppp *ppp, struct sk_buff *skb)
+__ppp_receive_nonmp_frame(struct ppp *ppp, struct sk_buff *skb)
 {
 	struct sk_buff *ns;
 	int proto, len, npi;
@@ -2513,6 +2676,51 @@ ppp_receive_nonmp_frame(struct ppp *ppp, struct sk_buff *skb)
 	ppp_receive_error(ppp);
 }
 
+/*
+ * While a decompressor runs, every frame goes through the decompress
+ * worker so that the frames it passes up stay in order.
+ */
+static void
+ppp_receive_nonmp_frame(struct ppp *ppp, struct sk_buff *skb)
+{
+	if ((ppp->rc_state && (ppp->rstate & SC_DECOMP_RUN) &&
+	     (ppp->rstate & (SC_DC_FERROR | SC_DC_ERROR)) == 0) ||
+	    !skb_queue_empty(&ppp->rcq)) {
+		if (skb_queue_len(&ppp->rcq) >= PPP_MAX_COMPQ) {
+			kfree_skb(skb);
+			++ppp->dev->stats.rx_dropped;
+			return;
+		}
+		skb_queue_tail(&ppp->rcq, skb);
+		queue_work(ppp_comp_wq, &ppp->rcomp_work);
+		return;
+	}
+
+	__ppp_receive_nonmp_frame(ppp, skb);
+}
+
+static void ppp_decomp_work(struct work_struct *work)
+{
+	struct ppp *ppp = container_of(work, struct ppp, rcomp_work);
+	struct sk_buff *skb;
+
+	for (;;) {
+		/* dequeue under rlock, or a frame could overtake this one */
+		ppp_recv_lock(ppp);
+		skb = skb_dequeue(&ppp->rcq);
+		if (!skb) {
+			ppp_recv_unlock(ppp);
+			break;
+		}
+		if (!ppp->closing)
+			__ppp_receive_nonmp_frame(ppp, skb);
+		else
+			kfree_skb(skb);
+		ppp_recv_unlock(ppp);
+		cond_resched();
+	}
+}
+
 static struct sk_buff *
 ppp_decompress_frame(struct ppp *ppp, struct sk_buff *skb)
 {
@@ -3041,11 +3249,13 @@ ppp_set_compress(struct ppp *ppp, struct ppp_option_data *data)
 		state = cp->comp_alloc(ccp_option, data->length);
 		if (state) {
 			ppp_xmit_lock(ppp);
+			spin_lock(&ppp->xclock);
 			ppp->xstate &= ~SC_COMP_RUN;
 			ocomp = ppp->xcomp;
 			ostate = ppp->xc_state;
 			ppp->xcomp = cp;
 			ppp->xc_state = state;
+			spin_unlock(&ppp->xclock);
 			ppp_xmit_unlock(ppp);
 			if (ostate) {
 				ocomp->comp_free(ostate);
@@ -3080,7 +3290,8 @@ ppp_set_compress(struct ppp *ppp, struct ppp_option_data *data)
 
 /*
  * Look at a CCP packet and update our state accordingly.
- * We assume the caller has the xmit or recv path locked.
+ * We assume the caller has the xmit or recv path locked; xclock is
+ * taken around xstate changes as the compress worker holds neither.
  */
 static void
 ppp_ccp_peek(struct ppp *ppp, struct sk_buff *skb, int inbound)
@@ -3102,10 +3313,12 @@ ppp_ccp_peek(struct ppp *ppp, struct sk_buff *skb, int inbound)
 		 * Remember:
 		 * A ConfReq indicates what the sender would like to receive
 		 */
-		if(inbound)
+		if(inbound) {
 			/* He is proposing what I should send */
+			spin_lock(&ppp->xclock);
 			ppp->xstate &= ~SC_COMP_RUN;
-		else
+			spin_unlock(&ppp->xclock);
+		} else
 			/* I am proposing to what he should send */
 			ppp->rstate &= ~SC_DECOMP_RUN;
 
@@ -3117,7 +3330,9 @@ ppp_ccp_peek(struct ppp *ppp, struct sk_buff *skb, int inbound)
 		 * CCP is going down, both directions of transmission
 		 */
 		ppp->rstate &= ~SC_DECOMP_RUN;
+		spin_lock(&ppp->xclock);
 		ppp->xstate &= ~SC_COMP_RUN;
+		spin_unlock(&ppp->xclock);
 		break;
 
 	case CCP_CONFACK:
@@ -3141,11 +3356,12 @@ ppp_ccp_peek(struct ppp *ppp, struct sk_buff *skb, int inbound)
 			}
 		} else {
 			/* we will soon start sending compressed packets */
-			if (!ppp->xc_state)
-				break;
-			if (ppp->xcomp->comp_init(ppp->xc_state, dp, len,
+			spin_lock(&ppp->xclock);
+			if (ppp->xc_state &&
+			    ppp->xcomp->comp_init(ppp->xc_state, dp, len,
 					ppp->file.index, 0, ppp->debug))
 				ppp->xstate |= SC_COMP_RUN;
+			spin_unlock(&ppp->xclock);
 		}
 		break;
 
@@ -3159,8 +3375,10 @@ ppp_ccp_peek(struct ppp *ppp, struct sk_buff *skb, int inbound)
 				ppp->rstate &= ~SC_DC_ERROR;
 			}
 		} else {
+			spin_lock(&ppp->xclock);
 			if (ppp->xc_state && (ppp->xstate & SC_COMP_RUN))
 				ppp->xcomp->comp_reset(ppp->xc_state);
+			spin_unlock(&ppp->xclock);
 		}
 		break;
 	}
@@ -3174,11 +3392,13 @@ ppp_ccp_closed(struct ppp *ppp)
 	struct compressor *xcomp, *rcomp;
 
 	ppp_lock(ppp);
+	spin_lock(&ppp->xclock);
 	ppp->flags &= ~(SC_CCP_OPEN | SC_CCP_UP);
 	ppp->xstate = 0;
 	xcomp = ppp->xcomp;
 	xstate = ppp->xc_state;
 	ppp->xc_state = NULL;
+	spin_unlock(&ppp->xclock);
 	ppp->rstate = 0;
 	rcomp = ppp->rcomp;
 	rstate = ppp->rc_state;
@@ -3552,6 +3772,7 @@ static void __exit ppp_cleanup(void)
 	device_destroy(ppp_class, MKDEV(PPP_MAJOR, 0));
 	class_destroy(ppp_class);
 	unregister_pernet_device(&ppp_net_ops);
+	destroy_workqueue(ppp_comp_wq);
 }
 
 /*
@@ -87,6 +87,9 @@ static const struct cdc_ncm_stats cdc_ncm_gstrings_stats[] = {
 	CDC_NCM_SIMPLE_STAT(tx_ntbs),
 	CDC_NCM_SIMPLE_STAT(rx_overhead),
 	CDC_NCM_SIMPLE_STAT(rx_ntbs),
+	CDC_NCM_STAT("tx_adapt_gap_nsecs", tx_adapt_gap),
+	CDC_NCM_STAT("tx_adapt_timer_nsecs", tx_adapt_interval),
+	CDC_NCM_STAT("tx_adapt_ntb_size", tx_adapt_size),
 };
 
 #define CDC_NCM_LOW_MEM_MAX_CNT 10
@@ -356,6 +359,48 @@ static ssize_t ndp_to_end_store(struct device *d,  struct device_attribute *attr
 }
 static DEVICE_ATTR_RW(ndp_to_end);
 
+static ssize_t tx_adaptive_show(struct device *d, struct device_attribute *attr, char *buf)
+{
+	struct usbnet *dev = netdev_priv(to_net_dev(d));
+	struct cdc_ncm_ctx *ctx = (struct cdc_ncm_ctx *)dev->data[0];
+
+	return sprintf(buf, "%c\n", ctx->drvflags & CDC_NCM_FLAG_TX_ADAPTIVE ? 'Y' : 'N');
+}
+
+static ssize_t tx_adaptive_store(struct device *d,  struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct usbnet *dev = netdev_priv(to_net_dev(d));
+	struct cdc_ncm_ctx *ctx = (struct cdc_ncm_ctx *)dev->data[0];
+	bool enable;
+
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	/* no change? */
+	if (enable == !!(ctx->drvflags & CDC_NCM_FLAG_TX_ADAPTIVE))
+		return len;
+
+	/* flush pending data before changing flag */
+	netif_tx_lock_bh(dev->net);
+	usbnet_start_xmit(NULL, dev->net);
+	spin_lock_bh(&ctx->mtx);
+	if (enable) {
+		/* start from sparse traffic and full size NTBs */
+		ctx->tx_adapt_last = ktime_get_ns();
+		ctx->tx_adapt_gap = ctx->timer_interval;
+		ctx->tx_adapt_interval = CDC_NCM_TIMER_INTERVAL_MIN * NSEC_PER_USEC;
+		ctx->tx_adapt_size = ctx->tx_max;
+		ctx->drvflags |= CDC_NCM_FLAG_TX_ADAPTIVE;
+	} else {
+		ctx->drvflags &= ~CDC_NCM_FLAG_TX_ADAPTIVE;
+	}
+	spin_unlock_bh(&ctx->mtx);
+	netif_tx_unlock_bh(dev->net);
+
+	return len;
+}
+static DEVICE_ATTR_RW(tx_adaptive);
+
 #define NCM_PARM_ATTR(name, format, tocpu)				\
 static ssize_t cdc_ncm_show_##name(struct device *d, struct device_attribute *attr, char *buf) \
 { \
@@ -382,6 +427,7 @@ static struct attribute *cdc_ncm_sysfs_attrs[] = {
 	&dev_attr_rx_max.attr,
 	&dev_attr_tx_max.attr,
 	&dev_attr_tx_timer_usecs.attr,
+	&dev_attr_tx_adaptive.attr,
 	&dev_attr_bmNtbFormatsSupported.attr,
 	&dev_attr_dwNtbInMaxSize.attr,
 	&dev_attr_wNdpInDivisor.attr,
@@ -1072,6 +1118,53 @@ static int cdc_ncm_bind(struct usbnet *dev, struct usb_interface *intf)
 	return cdc_ncm_bind_common(dev, intf, CDC_NCM_DATA_ALTSETTING_NCM, 0);
 }
 
+/* Adaptive TX: the coalescing timer follows the datagram arrival rate, so
+ * that it waits for about CDC_NCM_ADAPT_DATAGRAMS datagrams but never longer
+ * than tx_timer_usecs. Traffic too sparse to be batched within that time
+ * is sent right away instead.
+ */
+static void cdc_ncm_tx_adapt_arrival(struct cdc_ncm_ctx *ctx)
+{
+	u64 now = ktime_get_ns();
+	u64 interval;
+	u32 gap;
+
+	gap = min_t(u64, now - ctx->tx_adapt_last, ctx->timer_interval);
+	ctx->tx_adapt_last = now;
+
+	/* moving average with a weight of 1/8 */
+	ctx->tx_adapt_gap = ctx->tx_adapt_gap - (ctx->tx_adapt_gap >> 3) +
+			    (gap >> 3);
+
+	interval = (u64)ctx->tx_adapt_gap * CDC_NCM_ADAPT_DATAGRAMS;
+	if (interval > ctx->timer_interval)
+		interval = 0;
+	ctx->tx_adapt_interval = max_t(u64, interval,
+				       CDC_NCM_TIMER_INTERVAL_MIN * NSEC_PER_USEC);
+}
+
+/* An NTB which filled up asks for a full size one next, otherwise the
+ * next one is sized to twice what the last one carried. It must still
+ * hold a datagram of the largest size.
+ */
+static void cdc_ncm_tx_adapt_size(struct cdc_ncm_ctx *ctx, u32 len, bool full)
+{
+	u32 min_size;
+
+	if (full) {
+		ctx->tx_adapt_size = ctx->tx_max;
+		return;
+	}
+
+	min_size = ctx->max_datagram_size + 2 * ctx->max_ndp_size +
+		   ctx->tx_modulus + ctx->tx_ndp_modulus +
+		   sizeof(struct usb_cdc_ncm_nth32);
+	min_size = max_t(u32, min_size, USB_CDC_NCM_NTB_MIN_OUT_SIZE);
+
+	ctx->tx_adapt_size = clamp_t(u32, roundup_pow_of_two(2 * len),
+				     min(min_size, ctx->tx_max), ctx->tx_max);
+}
+
 static void cdc_ncm_align_tail(struct sk_buff *skb, size_t modulus, size_t remainder, size_t max)
 {
 	size_t align = ALIGN(skb->len, modulus) - skb->len + remainder;
@@ -1212,6 +1305,8 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 	u8 ready2send = 0;
 	u32 delayed_ndp_size;
 	size_t padding_count;
+	bool adaptive = ctx->drvflags & CDC_NCM_FLAG_TX_ADAPTIVE;
+	bool full = false;
 
 	/* When our NDP gets written in cdc_ncm_ndp(), then skb_out->len gets updated
 	 * accordingly. Otherwise, we should check here.
@@ -1224,6 +1319,9 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 	else
 		delayed_ndp_size = 0;
 
+	if (adaptive && skb && ctx->timer_interval)
+		cdc_ncm_tx_adapt_arrival(ctx);
+
 	/* if there is a remaining skb, it gets priority */
 	if (skb != NULL) {
 		swap(skb, ctx->tx_rem_skb);
@@ -1238,7 +1336,10 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 	/* allocate a new OUT skb */
 	if (!skb_out) {
 		if (ctx->tx_low_mem_val == 0) {
-			ctx->tx_curr_size = ctx->tx_max;
+			if (adaptive)
+				ctx->tx_curr_size = min(ctx->tx_adapt_size, ctx->tx_max);
+			else
+				ctx->tx_curr_size = ctx->tx_max;
 			skb_out = alloc_skb(ctx->tx_curr_size, GFP_ATOMIC);
 			/* If the memory allocation fails we will wait longer
 			 * each time before attempting another full size
@@ -1331,6 +1432,7 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 				ctx->tx_rem_sign = sign;
 				skb = NULL;
 				ready2send = 1;
+				full = true;
 				ctx->tx_reason_ntb_full++;	/* count reason for transmitting */
 			}
 			break;
@@ -1361,6 +1463,7 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 		/* send now if this NDP is full */
 		if (index >= CDC_NCM_DPT_DATAGRAMS_MAX) {
 			ready2send = 1;
+			full = true;
 			ctx->tx_reason_ndp_full++;	/* count reason for transmitting */
 			break;
 		}
@@ -1385,14 +1488,18 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 		/* wait for more frames */
 		/* push variables */
 		ctx->tx_curr_skb = skb_out;
-		/* set the pending count */
-		if (n < CDC_NCM_RESTART_TIMER_DATAGRAM_CNT)
+		/* set the pending count, the adaptive interval already
+		 * accounts for the arrival rate
+		 */
+		if (!adaptive && n < CDC_NCM_RESTART_TIMER_DATAGRAM_CNT)
 			ctx->tx_timer_pending = CDC_NCM_TIMER_PENDING_CNT;
 		goto exit_no_skb;
 
 	} else {
-		if (n == ctx->tx_max_datagrams)
+		if (n == ctx->tx_max_datagrams) {
+			full = true;
 			ctx->tx_reason_max_datagram++;	/* count reason for transmitting */
+		}
 		/* frame goes out */
 		/* variables will be reset at next call */
 	}
@@ -1452,6 +1559,9 @@ cdc_ncm_fill_tx_frame(struct usbnet *dev, struct sk_buff *skb, __le32 sign)
 	ctx->tx_overhead += skb_out->len - ctx->tx_curr_frame_payload;
 	ctx->tx_ntbs++;
 
+	if (adaptive)
+		cdc_ncm_tx_adapt_size(ctx, skb_out->len, full);
+
 	/* usbnet will count all the framing overhead by default.
 	 * Adjust the stats so that the tx_bytes counter show real
 	 * payload data instead.
@@ -1479,7 +1589,8 @@ static void cdc_ncm_tx_timeout_start(struct cdc_ncm_ctx *ctx)
 	/* start timer, if not already started */
 	if (!(hrtimer_active(&ctx->tx_timer) || atomic_read(&ctx->stop)))
 		hrtimer_start(&ctx->tx_timer,
-				ctx->timer_interval,
+				(ctx->drvflags & CDC_NCM_FLAG_TX_ADAPTIVE) ?
+				ctx->tx_adapt_interval : ctx->timer_interval,
 				HRTIMER_MODE_REL);
 }
 
@@ -20,6 +20,9 @@
 #include <linux/usb/usbnet.h>
 #include <linux/usb/cdc-wdm.h>
 #include <linux/u64_stats_sync.h>
+#include <linux/hrtimer.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 
 /* This driver supports wwan (3G/LTE/?) devices using a vendor
  * specific management protocol called Qualcomm MSM Interface (QMI) -
@@ -75,6 +78,25 @@ struct qmimux_priv {
 	u8 mux_id;
 };
 
+/* QMAP uplink aggregation, shared by all the mux devices of a link.
+ * The sizes must match what was negotiated with the modem using
+ * QMI WDA, a max_size of 0 sends one datagram per URB.
+ */
+struct qmimux_ul_agg {
+	spinlock_t lock;	/* protects everything below */
+	struct hrtimer timer;
+	struct net_device *real_dev;
+	struct sk_buff *skb;
+	u32 count;
+	u32 max_size;
+	u32 max_datagrams;
+	u32 timeout_us;
+};
+
+#define QMIMUX_UL_AGG_MAX_SIZE		SZ_64K
+#define QMIMUX_UL_AGG_MAX_DATAGRAMS	64
+#define QMIMUX_UL_AGG_TIMEOUT_US	400	/* same as cdc_ncm */
+
 static int qmimux_open(struct net_device *dev)
 {
 	struct qmimux_priv *priv = netdev_priv(dev);
@@ -94,13 +116,105 @@ static int qmimux_stop(struct net_device *dev)
 	return 0;
 }
 
+/* The caller must hold agg->lock */
+static struct sk_buff *qmimux_ul_agg_take(struct qmimux_ul_agg *agg)
+{
+	struct sk_buff *skb = agg->skb;
+
+	agg->skb = NULL;
+	agg->count = 0;
+	return skb;
+}
+
+static void qmimux_ul_agg_flush(struct qmimux_ul_agg *agg)
+{
+	struct sk_buff *skb;
+
+	spin_lock_bh(&agg->lock);
+	skb = qmimux_ul_agg_take(agg);
+	spin_unlock_bh(&agg->lock);
+
+	if (skb)
+		dev_queue_xmit(skb);
+}
+
+static enum hrtimer_restart qmimux_ul_agg_timer(struct hrtimer *timer)
+{
+	struct qmimux_ul_agg *agg = container_of(timer, struct qmimux_ul_agg,
+						 timer);
+
+	qmimux_ul_agg_flush(agg);
+	return HRTIMER_NORESTART;
+}
+
+/* Pack the datagram, padded to 4 bytes, after the previous ones. The
+ * aggregate goes out when the next datagram does not fit, when it
+ * holds max_datagrams or when the timer fires.
+ */
+static netdev_tx_t qmimux_ul_agg_xmit(struct sk_buff *skb,
+				      struct net_device *dev,
+				      struct qmimux_ul_agg *agg)
+{
+	struct qmimux_priv *priv = netdev_priv(dev);
+	unsigned int len = skb->len, pad_len = ALIGN(len, 4) - len;
+	unsigned int size = sizeof(struct qmimux_hdr) + len + pad_len;
+	struct sk_buff *full = NULL, *flush = NULL;
+	struct qmimux_hdr *hdr;
+
+	spin_lock_bh(&agg->lock);
+
+	if (agg->skb && skb_tailroom(agg->skb) < size)
+		flush = qmimux_ul_agg_take(agg);
+
+	if (!agg->skb) {
+		agg->skb = netdev_alloc_skb(agg->real_dev, agg->max_size);
+		if (!agg->skb) {
+			spin_unlock_bh(&agg->lock);
+			dev->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			goto out;
+		}
+		agg->skb->protocol = htons(ETH_P_MAP);
+	}
+
+	hdr = skb_put(agg->skb, sizeof(*hdr));
+	hdr->pad = pad_len;
+	hdr->mux_id = priv->mux_id;
+	hdr->pkt_len = cpu_to_be16(len + pad_len);
+	skb_copy_bits(skb, 0, skb_put(agg->skb, len), len);
+	skb_put_zero(agg->skb, pad_len);
+
+	if (++agg->count >= agg->max_datagrams)
+		full = qmimux_ul_agg_take(agg);
+	else if (!hrtimer_is_queued(&agg->timer))
+		hrtimer_start(&agg->timer, us_to_ktime(agg->timeout_us),
+			      HRTIMER_MODE_REL_SOFT);
+
+	spin_unlock_bh(&agg->lock);
+
+	dev_sw_netstats_tx_add(dev, 1, len);
+	dev_consume_skb_any(skb);
+out:
+	if (flush)
+		dev_queue_xmit(flush);
+	if (full)
+		dev_queue_xmit(full);
+
+	return NETDEV_TX_OK;
+}
+
 static netdev_tx_t qmimux_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct qmimux_priv *priv = netdev_priv(dev);
+	struct usbnet *usbdev = netdev_priv(priv->real_dev);
+	struct qmimux_ul_agg *agg = usbdev->driver_priv;
 	unsigned int len = skb->len;
 	struct qmimux_hdr *hdr;
 	netdev_tx_t ret;
 
+	if (sizeof(*hdr) + ALIGN(len, 4) <= READ_ONCE(agg->max_size))
+		return qmimux_ul_agg_xmit(skb, dev, agg);
+
 	hdr = skb_push(skb, sizeof(struct qmimux_hdr));
 	hdr->pad = 0;
 	hdr->mux_id = priv->mux_id;
@@ -165,6 +279,7 @@ static int qmimux_rx_fixup(struct usbnet *dev, struct sk_buff *skb)
 	struct net_device *net;
 	struct sk_buff *skbn;
 	u8 qmimux_hdr_sz = sizeof(*hdr);
+	__be16 proto;
 
 	while (offset + qmimux_hdr_sz < skb->len) {
 		hdr = (struct qmimux_hdr *)(skb->data + offset);
@@ -187,30 +302,36 @@ static int qmimux_rx_fixup(struct usbnet *dev, struct sk_buff *skb)
 		net = qmimux_find_dev(dev, hdr->mux_id);
 		if (!net)
 			goto skip;
-		skbn = netdev_alloc_skb(net, pkt_len + LL_MAX_HEADER);
-		if (!skbn)
-			return 0;
 
 		switch (skb->data[offset + qmimux_hdr_sz] & 0xf0) {
 		case 0x40:
-			skbn->protocol = htons(ETH_P_IP);
+			proto = htons(ETH_P_IP);
 			break;
 		case 0x60:
-			skbn->protocol = htons(ETH_P_IPV6);
+			proto = htons(ETH_P_IPV6);
 			break;
 		default:
 			/* not ip - do not know what to do */
 			goto skip;
 		}
 
-		skb_reserve(skbn, LL_MAX_HEADER);
-		skb_put_data(skbn, skb->data + offset + qmimux_hdr_sz, pkt_len);
-		if (netif_rx(skbn) != NET_RX_SUCCESS) {
-			net->stats.rx_errors++;
+		/* The datagrams keep pointing into the URB buffer, so each
+		 * clone keeps the truesize of the whole buffer it pins.
+		 */
+		skbn = skb_clone(skb, GFP_ATOMIC);
+		if (!skbn)
 			return 0;
-		} else {
-			dev_sw_netstats_rx_add(net, pkt_len);
-		}
+
+		skb_pull(skbn, offset + qmimux_hdr_sz);
+		skb_trim(skbn, pkt_len);
+		skb_reset_mac_header(skbn);
+		memset(skbn->cb, 0, sizeof(skbn->cb));
+		skbn->protocol = proto;
+		skbn->dev = net;
+
+		/* rx_fixup runs from the usbnet NAPI poll */
+		napi_gro_receive(&dev->napi, skbn);
+		dev_sw_netstats_rx_add(net, pkt_len);
 
 skip:
 		offset += len + qmimux_hdr_sz;
@@ -516,16 +637,116 @@ static ssize_t pass_through_store(struct device *d,
 	return len;
 }
 
+static struct qmimux_ul_agg *qmimux_ul_agg_of(struct device *d)
+{
+	struct usbnet *dev = netdev_priv(to_net_dev(d));
+
+	return dev->driver_priv;
+}
+
+/* the pending aggregate was built with the old limits */
+static void qmimux_ul_agg_set(struct qmimux_ul_agg *agg, u32 *field, u32 val)
+{
+	struct sk_buff *skb;
+
+	spin_lock_bh(&agg->lock);
+	skb = qmimux_ul_agg_take(agg);
+	WRITE_ONCE(*field, val);
+	spin_unlock_bh(&agg->lock);
+
+	if (skb)
+		dev_queue_xmit(skb);
+}
+
+static ssize_t ul_agg_max_size_show(struct device *d,
+				    struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", qmimux_ul_agg_of(d)->max_size);
+}
+
+static ssize_t ul_agg_max_size_store(struct device *d,
+				     struct device_attribute *attr,
+				     const char *buf, size_t len)
+{
+	struct qmimux_ul_agg *agg = qmimux_ul_agg_of(d);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val))
+		return -EINVAL;
+
+	/* 0 disables aggregation */
+	if (val && (val < sizeof(struct qmimux_hdr) + ETH_DATA_LEN ||
+		    val > QMIMUX_UL_AGG_MAX_SIZE))
+		return -EINVAL;
+
+	qmimux_ul_agg_set(agg, &agg->max_size, val);
+	return len;
+}
+
+static ssize_t ul_agg_max_datagrams_show(struct device *d,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	return sysfs_emit(buf, "%u\n", qmimux_ul_agg_of(d)->max_datagrams);
+}
+
+static ssize_t ul_agg_max_datagrams_store(struct device *d,
+					  struct device_attribute *attr,
+					  const char *buf, size_t len)
+{
+	struct qmimux_ul_agg *agg = qmimux_ul_agg_of(d);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val))
+		return -EINVAL;
+
+	if (!val || val > QMIMUX_UL_AGG_MAX_DATAGRAMS)
+		return -EINVAL;
+
+	qmimux_ul_agg_set(agg, &agg->max_datagrams, val);
+	return len;
+}
+
+static ssize_t ul_agg_timeout_usecs_show(struct device *d,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	return sysfs_emit(buf, "%u\n", qmimux_ul_agg_of(d)->timeout_us);
+}
+
+static ssize_t ul_agg_timeout_usecs_store(struct device *d,
+					  struct device_attribute *attr,
+					  const char *buf, size_t len)
+{
+	struct qmimux_ul_agg *agg = qmimux_ul_agg_of(d);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val))
+		return -EINVAL;
+
+	if (!val || val > USEC_PER_SEC)
+		return -EINVAL;
+
+	qmimux_ul_agg_set(agg, &agg->timeout_us, val);
+	return len;
+}
+
 static DEVICE_ATTR_RW(raw_ip);
 static DEVICE_ATTR_RW(add_mux);
 static DEVICE_ATTR_RW(del_mux);
 static DEVICE_ATTR_RW(pass_through);
+static DEVICE_ATTR_RW(ul_agg_max_size);
+static DEVICE_ATTR_RW(ul_agg_max_datagrams);
+static DEVICE_ATTR_RW(ul_agg_timeout_usecs);
 
 static struct attribute *qmi_wwan_sysfs_attrs[] = {
 	&dev_attr_raw_ip.attr,
 	&dev_attr_add_mux.attr,
 	&dev_attr_del_mux.attr,
 	&dev_attr_pass_through.attr,
+	&dev_attr_ul_agg_max_size.attr,
+	&dev_attr_ul_agg_max_datagrams.attr,
+	&dev_attr_ul_agg_timeout_usecs.attr,
 	NULL,
 };
 
@@ -752,6 +973,7 @@ static int qmi_wwan_bind(struct usbnet *dev, struct usb_interface *intf)
 	struct usb_driver *driver = driver_of(intf);
 	struct qmi_wwan_state *info = (void *)&dev->data;
 	struct usb_cdc_parsed_header hdr;
+	struct qmimux_ul_agg *agg;
 
 	BUILD_BUG_ON((sizeof(((struct usbnet *)0)->data) <
 		      sizeof(struct qmi_wwan_state)));
@@ -760,6 +982,18 @@ static int qmi_wwan_bind(struct usbnet *dev, struct usb_interface *intf)
 	info->control = intf;
 	info->data = intf;
 
+	agg = kzalloc(sizeof(*agg), GFP_KERNEL);
+	if (!agg)
+		return -ENOMEM;
+
+	spin_lock_init(&agg->lock);
+	hrtimer_init(&agg->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	agg->timer.function = qmimux_ul_agg_timer;
+	agg->real_dev = dev->net;
+	agg->max_datagrams = QMIMUX_UL_AGG_MAX_DATAGRAMS;
+	agg->timeout_us = QMIMUX_UL_AGG_TIMEOUT_US;
+	dev->driver_priv = agg;
+
 	/* and a number of CDC descriptors */
 	cdc_parse_cdc_header(&hdr, intf, buf, len);
 	cdc_union = hdr.usb_cdc_union_desc;
@@ -843,6 +1077,10 @@ static int qmi_wwan_bind(struct usbnet *dev, struct usb_interface *intf)
 	dev->net->netdev_ops = &qmi_wwan_netdev_ops;
 	dev->net->sysfs_groups[0] = &qmi_wwan_sysfs_attr_group;
 err:
+	if (status < 0) {
+		kfree(dev->driver_priv);
+		dev->driver_priv = NULL;
+	}
 	return status;
 }
 
@@ -851,6 +1089,7 @@ static void qmi_wwan_unbind(struct usbnet *dev, struct usb_interface *intf)
 	struct qmi_wwan_state *info = (void *)&dev->data;
 	struct usb_driver *driver = driver_of(intf);
 	struct usb_interface *other;
+	struct qmimux_ul_agg *agg;
 
 	if (info->subdriver && info->subdriver->disconnect)
 		info->subdriver->disconnect(info->control);
@@ -876,6 +1115,13 @@ static void qmi_wwan_unbind(struct usbnet *dev, struct usb_interface *intf)
 	info->subdriver = NULL;
 	info->data = NULL;
 	info->control = NULL;
+
+	/* the mux devices are gone, nothing can queue anymore */
+	agg = dev->driver_priv;
+	hrtimer_cancel(&agg->timer);
+	dev_kfree_skb(agg->skb);
+	kfree(agg);
+	dev->driver_priv = NULL;
 }
 
 /* suspend/resume wrappers calling both usbnet and the cdc-wdm
@@ -928,7 +1174,7 @@ err:
 
 static const struct driver_info	qmi_wwan_info = {
 	.description	= "WWAN/QMI device",
-	.flags		= FLAG_WWAN | FLAG_SEND_ZLP,
+	.flags		= FLAG_WWAN | FLAG_SEND_ZLP | FLAG_NAPI,
 	.bind		= qmi_wwan_bind,
 	.unbind		= qmi_wwan_unbind,
 	.manage_power	= qmi_wwan_manage_power,
@@ -937,7 +1183,7 @@ static const struct driver_info	qmi_wwan_info = {
 
 static const struct driver_info	qmi_wwan_info_quirk_dtr = {
 	.description	= "WWAN/QMI device",
-	.flags		= FLAG_WWAN | FLAG_SEND_ZLP,
+	.flags		= FLAG_WWAN | FLAG_SEND_ZLP | FLAG_NAPI,
 	.bind		= qmi_wwan_bind,
 	.unbind		= qmi_wwan_unbind,
 	.manage_power	= qmi_wwan_manage_power,
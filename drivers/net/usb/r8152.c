@@ -26,8 +26,17 @@
 #include <linux/atomic.h>
 #include <linux/acpi.h>
 #include <linux/firmware.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <linux/ptr_ring.h>
+#include <linux/scatterlist.h>
 #include <crypto/hash.h>
 #include <linux/usb/r8152.h>
+#include <linux/soc/sunxi/sunxi_mbus.h>
+#include <net/page_pool.h>
+#include <net/pkt_latency.h>
+#include <net/xdp.h>
 
 /* Information for net-next */
 #define NETNEXT_VERSION		"12"
@@ -751,7 +760,21 @@ enum rtl_register_content {
 #define RX_ALIGN		8
 
 #define RTL8152_RX_MAX_PENDING	4096
+#define RTL8152_RX_MAX_INFLIGHT	64
 #define RTL8152_RXFG_HEADSZ	256
+#define RTL8152_TX_SG_NUM	(2 * (MAX_SKB_FRAGS + 2))
+
+/* XDP runs on a page_pool page holding a copy of one frame */
+#define R8152_XDP_POOL_SIZE	256
+#define R8152_XDP_TX_RING	256
+/* bytes queued by ndo_xdp_xmit() before a flush kicks a busy tx path */
+#define R8152_XDP_TX_BATCH	(agg_buf_sz / 2)
+#define R8152_XDP_MAX_FRAME	(PAGE_SIZE - XDP_PACKET_HEADROOM - \
+				 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
+#define R8152_XDP_PASS		0
+#define R8152_XDP_TX		BIT(0)
+#define R8152_XDP_REDIRECT	BIT(1)
 
 #define INTR_LINK		0x0004
 
@@ -857,6 +880,8 @@ struct tx_agg {
 	struct r8152 *context;
 	void *buffer;
 	void *head;
+	struct scatterlist *sg;
+	struct sk_buff_head tx_skbs;	/* skbs whose frags are in sg */
 	u32 skb_num;
 	u32 skb_len;
 };
@@ -876,6 +901,7 @@ struct r8152 {
 	struct delayed_work schedule, hw_phy_work;
 	struct mii_if_info mii;
 	struct mutex control;	/* use for hw setting */
+	struct sunxi_mbus_bw_req bw_req;
 #ifdef CONFIG_PM_SLEEP
 	struct notifier_block pm_notifier;
 #endif
@@ -929,16 +955,25 @@ struct r8152 {
 
 	atomic_t rx_count;
 
+	struct bpf_prog *xdp_prog;
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+	struct ptr_ring xdp_tx_ring;
+	atomic_t xdp_tx_bytes;
+
 	bool eee_en;
 	int intr_interval;
 	u32 saved_wolopts;
 	u32 msg_enable;
 	u32 tx_qlen;
+	u32 tx_sg_num;
 	u32 coalesce;
 	u32 advertising;
 	u32 rx_buf_sz;
+	u32 rx_buf_sz_max;
 	u32 rx_copybreak;
 	u32 rx_pending;
+	u32 rx_inflight;
 	u32 fc_pause_on, fc_pause_off;
 
 	unsigned int pipe_in, pipe_out, pipe_intr, pipe_ctrl_in, pipe_ctrl_out;
@@ -1803,6 +1838,14 @@ static void read_bulk_callback(struct urb *urb)
 	r8152_submit_rx(tp, agg, GFP_ATOMIC);
 }
 
+static void r8152_tx_agg_free_skbs(struct tx_agg *agg)
+{
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(&agg->tx_skbs)))
+		dev_kfree_skb_any(skb);
+}
+
 static void write_bulk_callback(struct urb *urb)
 {
 	struct net_device_stats *stats;
@@ -1831,6 +1874,8 @@ static void write_bulk_callback(struct urb *urb)
 		stats->tx_bytes += agg->skb_len;
 	}
 
+	r8152_tx_agg_free_skbs(agg);
+
 	spin_lock_irqsave(&tp->tx_lock, flags);
 	list_add_tail(&agg->list, &tp->tx_free);
 	spin_unlock_irqrestore(&tp->tx_lock, flags);
@@ -1846,7 +1891,8 @@ static void write_bulk_callback(struct urb *urb)
 	if (test_bit(RTL8152_INACCESSIBLE, &tp->flags))
 		return;
 
-	if (!skb_queue_empty(&tp->tx_queue))
+	if (!skb_queue_empty(&tp->tx_queue) ||
+	    !__ptr_ring_empty(&tp->xdp_tx_ring))
 		tasklet_schedule(&tp->tx_tl);
 }
 
@@ -1977,6 +2023,36 @@ free_rx:
 	return NULL;
 }
 
+static void r8152_xdp_frame_free(void *ptr)
+{
+	xdp_return_frame(ptr);
+}
+
+static int r8152_xdp_rxq_init(struct r8152 *tp, int node)
+{
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.pool_size = R8152_XDP_POOL_SIZE,
+		.nid = node,
+		.dev = &tp->intf->dev,
+	};
+	int ret;
+
+	tp->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(tp->page_pool)) {
+		ret = PTR_ERR(tp->page_pool);
+		tp->page_pool = NULL;
+		return ret;
+	}
+
+	ret = xdp_rxq_info_reg(&tp->xdp_rxq, tp->netdev, 0, tp->napi.napi_id);
+	if (ret)
+		return ret;
+
+	return xdp_rxq_info_reg_mem_model(&tp->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					  tp->page_pool);
+}
+
 static void free_all_mem(struct r8152 *tp)
 {
 	struct rx_agg *agg, *agg_next;
@@ -1992,6 +2068,15 @@ static void free_all_mem(struct r8152 *tp)
 
 	WARN_ON(atomic_read(&tp->rx_count));
 
+	ptr_ring_cleanup(&tp->xdp_tx_ring, r8152_xdp_frame_free);
+	atomic_set(&tp->xdp_tx_bytes, 0);
+
+	if (xdp_rxq_info_is_reg(&tp->xdp_rxq))
+		xdp_rxq_info_unreg(&tp->xdp_rxq);
+
+	page_pool_destroy(tp->page_pool);
+	tp->page_pool = NULL;
+
 	for (i = 0; i < RTL8152_MAX_TX; i++) {
 		usb_free_urb(tp->tx_info[i].urb);
 		tp->tx_info[i].urb = NULL;
@@ -1999,6 +2084,10 @@ static void free_all_mem(struct r8152 *tp)
 		kfree(tp->tx_info[i].buffer);
 		tp->tx_info[i].buffer = NULL;
 		tp->tx_info[i].head = NULL;
+
+		r8152_tx_agg_free_skbs(&tp->tx_info[i]);
+		kfree(tp->tx_info[i].sg);
+		tp->tx_info[i].sg = NULL;
 	}
 
 	usb_free_urb(tp->intr_urb);
@@ -2027,7 +2116,14 @@ static int alloc_all_mem(struct r8152 *tp)
 	skb_queue_head_init(&tp->rx_queue);
 	atomic_set(&tp->rx_count, 0);
 
-	for (i = 0; i < RTL8152_MAX_RX; i++) {
+	/* free_all_mem() always cleans up the ring, so set it up first */
+	if (ptr_ring_init(&tp->xdp_tx_ring, R8152_XDP_TX_RING, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (r8152_xdp_rxq_init(tp, node))
+		goto err1;
+
+	for (i = 0; i < tp->rx_inflight; i++) {
 		if (!alloc_rx_agg(tp, GFP_KERNEL))
 			goto err1;
 	}
@@ -2059,8 +2155,21 @@ static int alloc_all_mem(struct r8152 *tp)
 		tp->tx_info[i].urb = urb;
 		tp->tx_info[i].buffer = buf;
 		tp->tx_info[i].head = tx_agg_align(buf);
+		__skb_queue_head_init(&tp->tx_info[i].tx_skbs);
 
 		list_add_tail(&tp->tx_info[i].list, &tp->tx_free);
+
+		if (tp->tx_sg_num) {
+			struct scatterlist *sg;
+
+			sg = kmalloc_array_node(tp->tx_sg_num, sizeof(*sg),
+						GFP_KERNEL, node);
+			if (!sg)
+				goto err1;
+
+			sg_init_table(sg, tp->tx_sg_num);
+			tp->tx_info[i].sg = sg;
+		}
 	}
 
 	tp->intr_urb = usb_alloc_urb(0, GFP_KERNEL);
@@ -2252,11 +2361,52 @@ unavailable:
 	return ret;
 }
 
+/* r8152_tx_agg_fill_xdp()
+ * Copy the queued XDP frames into the tx aggregation buffer. They need
+ * neither checksum offload nor vlan insertion.
+ */
+static u8 *r8152_tx_agg_fill_xdp(struct r8152 *tp, struct tx_agg *agg,
+				 u8 *tx_data)
+{
+	struct ptr_ring *ring = &tp->xdp_tx_ring;
+	int remain = agg_buf_sz;
+
+	while (remain >= ETH_ZLEN + sizeof(struct tx_desc)) {
+		struct tx_desc *tx_desc;
+		struct xdp_frame *xdpf;
+
+		xdpf = __ptr_ring_peek(ring);
+		if (!xdpf || xdpf->len + sizeof(*tx_desc) > remain)
+			break;
+
+		xdpf = __ptr_ring_consume(ring);
+		atomic_sub(xdpf->len, &tp->xdp_tx_bytes);
+
+		tx_data = tx_agg_align(tx_data);
+		tx_desc = (struct tx_desc *)tx_data;
+		tx_desc->opts2 = 0;
+		tx_desc->opts1 = cpu_to_le32(xdpf->len | TX_FS | TX_LS);
+		tx_data += sizeof(*tx_desc);
+
+		memcpy(tx_data, xdpf->data, xdpf->len);
+		tx_data += xdpf->len;
+		agg->skb_len += xdpf->len;
+		agg->skb_num++;
+
+		xdp_return_frame(xdpf);
+
+		remain = agg_buf_sz - (int)(tx_agg_align(tx_data) - agg->head);
+	}
+
+	return tx_data;
+}
+
 static int r8152_tx_agg_fill(struct r8152 *tp, struct tx_agg *agg)
 {
 	struct sk_buff_head skb_head, *tx_queue = &tp->tx_queue;
-	int remain, ret;
-	u8 *tx_data;
+	unsigned int frag_len = 0;
+	int remain, ret, n_sg = 0;
+	u8 *tx_data, *run;
 
 	__skb_queue_head_init(&skb_head);
 	spin_lock(&tx_queue->lock);
@@ -2266,7 +2416,24 @@ static int r8152_tx_agg_fill(struct r8152 *tp, struct tx_agg *agg)
 	tx_data = agg->head;
 	agg->skb_num = 0;
 	agg->skb_len = 0;
-	remain = agg_buf_sz;
+
+	/* only the tasklet consumes the ring, but keep its lock for clarity */
+	spin_lock(&tp->xdp_tx_ring.consumer_lock);
+	tx_data = r8152_tx_agg_fill_xdp(tp, agg, tx_data);
+	spin_unlock(&tp->xdp_tx_ring.consumer_lock);
+
+	/* With scatter-gather, the descriptors and the linear part of the skbs
+	 * are copied into agg->head while their frags are described by agg->sg.
+	 * frag_len counts the bytes of the bulk transfer which are not in
+	 * agg->head, so that the descriptors stay TX_ALIGN aligned in the
+	 * stream seen by the device. run is where the current sg entry of
+	 * agg->head starts.
+	 */
+	if (agg->urb->num_sgs)
+		sg_unmark_end(&agg->sg[agg->urb->num_sgs - 1]);
+	run = agg->head;
+
+	remain = agg_buf_sz - (int)(tx_agg_align(tx_data) - agg->head);
 
 	while (remain >= ETH_ZLEN + sizeof(struct tx_desc)) {
 		struct tx_desc *tx_desc;
@@ -2284,7 +2451,14 @@ static int r8152_tx_agg_fill(struct r8152 *tp, struct tx_agg *agg)
 			break;
 		}
 
-		tx_data = tx_agg_align(tx_data);
+		/* the agg->head entries around the frags need two more */
+		if (tp->tx_sg_num &&
+		    n_sg + skb_shinfo(skb)->nr_frags + 2 > tp->tx_sg_num) {
+			__skb_queue_head(&skb_head, skb);
+			break;
+		}
+
+		tx_data = (u8 *)tx_agg_align(tx_data + frag_len) - frag_len;
 		tx_desc = (struct tx_desc *)tx_data;
 
 		if (r8152_tx_csum(tp, tx_desc, skb, skb->len)) {
@@ -2297,22 +2471,52 @@ static int r8152_tx_agg_fill(struct r8152 *tp, struct tx_agg *agg)
 		tx_data += sizeof(*tx_desc);
 
 		len = skb->len;
-		if (skb_copy_bits(skb, 0, tx_data, len) < 0) {
-			struct net_device_stats *stats = &tp->netdev->stats;
+		if (tp->tx_sg_num && skb_shinfo(skb)->nr_frags &&
+		    !skb_has_frag_list(skb)) {
+			unsigned int headlen = skb_headlen(skb);
+			int i;
 
-			stats->tx_dropped++;
-			dev_kfree_skb_any(skb);
-			tx_data -= sizeof(*tx_desc);
-			continue;
-		}
+			memcpy(tx_data, skb->data, headlen);
+			tx_data += headlen;
+			sg_set_buf(&agg->sg[n_sg++], run, tx_data - run);
 
-		tx_data += len;
-		agg->skb_len += len;
-		agg->skb_num += skb_shinfo(skb)->gso_segs ?: 1;
+			for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+				skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
 
-		dev_kfree_skb_any(skb);
+				sg_set_page(&agg->sg[n_sg++],
+					    skb_frag_page(frag),
+					    skb_frag_size(frag),
+					    skb_frag_off(frag));
+			}
 
-		remain = agg_buf_sz - (int)(tx_agg_align(tx_data) - agg->head);
+			frag_len += len - headlen;
+			run = tx_data;
+
+			agg->skb_len += len;
+			agg->skb_num += skb_shinfo(skb)->gso_segs ?: 1;
+
+			/* freed by write_bulk_callback() */
+			__skb_queue_tail(&agg->tx_skbs, skb);
+		} else {
+			if (skb_copy_bits(skb, 0, tx_data, len) < 0) {
+				struct net_device_stats *stats;
+
+				stats = &tp->netdev->stats;
+				stats->tx_dropped++;
+				dev_kfree_skb_any(skb);
+				tx_data -= sizeof(*tx_desc);
+				continue;
+			}
+
+			tx_data += len;
+			agg->skb_len += len;
+			agg->skb_num += skb_shinfo(skb)->gso_segs ?: 1;
+
+			dev_kfree_skb_any(skb);
+		}
+
+		remain = agg_buf_sz -
+			 (int)(tx_agg_align(tx_data + frag_len) - agg->head);
 
 		if (tp->dell_tb_rx_agg_bug)
 			break;
@@ -2337,14 +2541,28 @@ static int r8152_tx_agg_fill(struct r8152 *tp, struct tx_agg *agg)
 		goto out_tx_fill;
 
 	usb_fill_bulk_urb(agg->urb, tp->udev, tp->pipe_out,
-			  agg->head, (int)(tx_data - (u8 *)agg->head),
+			  agg->head,
+			  (int)(tx_data - (u8 *)agg->head) + frag_len,
 			  (usb_complete_t)write_bulk_callback, agg);
 
+	if (n_sg) {
+		if (tx_data > run)
+			sg_set_buf(&agg->sg[n_sg++], run, tx_data - run);
+		sg_mark_end(&agg->sg[n_sg - 1]);
+		agg->urb->sg = agg->sg;
+	} else {
+		agg->urb->sg = NULL;
+	}
+	agg->urb->num_sgs = n_sg;
+
 	ret = usb_submit_urb(agg->urb, GFP_ATOMIC);
 	if (ret < 0)
 		usb_autopm_put_interface_async(tp->intf);
 
 out_tx_fill:
+	if (ret < 0)
+		r8152_tx_agg_free_skbs(agg);
+
 	return ret;
 }
 
@@ -2379,7 +2597,7 @@ return_result:
 
 static inline bool rx_count_exceed(struct r8152 *tp)
 {
-	return atomic_read(&tp->rx_count) > RTL8152_MAX_RX;
+	return atomic_read(&tp->rx_count) > tp->rx_inflight;
 }
 
 static inline int agg_offset(struct rx_agg *agg, void *addr)
@@ -2417,12 +2635,101 @@ static struct rx_agg *rtl_get_free_rx(struct r8152 *tp, gfp_t mflags)
 	return agg_free;
 }
 
+static void r8152_xdp_tx_kick(struct r8152 *tp)
+{
+	if (test_bit(SELECTIVE_SUSPEND, &tp->flags)) {
+		set_bit(SCHEDULE_TASKLET, &tp->flags);
+		schedule_delayed_work(&tp->schedule, 0);
+	} else {
+		usb_mark_last_busy(tp->udev);
+		tasklet_schedule(&tp->tx_tl);
+	}
+}
+
+/* r8152_xdp_rx()
+ * The rx aggregation buffer packs several frames without any headroom, so
+ * copy the frame into a page_pool page and run the program there. On
+ * XDP_PASS the skb is built around that page, so there is no second copy.
+ */
+static struct sk_buff *r8152_xdp_rx(struct r8152 *tp, struct bpf_prog *prog,
+				    struct rx_desc *rx_desc, void *data,
+				    unsigned int len, u32 *xdp_status)
+{
+	struct net_device *netdev = tp->netdev;
+	struct net_device_stats *stats = &netdev->stats;
+	struct xdp_frame *xdpf;
+	struct sk_buff *skb;
+	struct xdp_buff xdp;
+	struct page *page;
+	u32 act;
+
+	if (unlikely(len > R8152_XDP_MAX_FRAME))
+		goto drop;
+
+	page = page_pool_dev_alloc_pages(tp->page_pool);
+	if (unlikely(!page))
+		goto drop;
+
+	memcpy(page_address(page) + XDP_PACKET_HEADROOM, data, len);
+
+	xdp_init_buff(&xdp, PAGE_SIZE, &tp->xdp_rxq);
+	xdp_prepare_buff(&xdp, page_address(page), XDP_PACKET_HEADROOM, len,
+			 false);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		skb = build_skb(xdp.data_hard_start, PAGE_SIZE);
+		if (unlikely(!skb))
+			break;
+
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		skb_put(skb, xdp.data_end - xdp.data);
+		skb->ip_summed = r8152_rx_csum(tp, rx_desc);
+		return skb;
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(&xdp);
+		if (unlikely(!xdpf) || ptr_ring_produce(&tp->xdp_tx_ring, xdpf))
+			goto out_failure;
+		atomic_add(xdpf->len, &tp->xdp_tx_bytes);
+		*xdp_status |= R8152_XDP_TX;
+		goto consumed;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(netdev, &xdp, prog))
+			goto out_failure;
+		*xdp_status |= R8152_XDP_REDIRECT;
+		goto consumed;
+	default:
+		bpf_warn_invalid_xdp_action(netdev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(netdev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	page_pool_recycle_direct(tp->page_pool, page);
+drop:
+	stats->rx_dropped++;
+	return NULL;
+
+consumed:
+	stats->rx_packets++;
+	stats->rx_bytes += xdp.data_end - xdp.data;
+	return NULL;
+}
+
 static int rx_bottom(struct r8152 *tp, int budget)
 {
 	unsigned long flags;
 	struct list_head *cursor, *next, rx_queue;
 	int ret = 0, work_done = 0;
 	struct napi_struct *napi = &tp->napi;
+	struct bpf_prog *xdp_prog = READ_ONCE(tp->xdp_prog);
+	u32 xdp_status = R8152_XDP_PASS;
 
 	if (!skb_queue_empty(&tp->rx_queue)) {
 		while (work_done < budget) {
@@ -2492,10 +2799,24 @@ static int rx_bottom(struct r8152 *tp, int budget)
 			pkt_len -= ETH_FCS_LEN;
 			rx_data += sizeof(struct rx_desc);
 
+			if (xdp_prog) {
+				skb = r8152_xdp_rx(tp, xdp_prog, rx_desc,
+						   rx_data, pkt_len,
+						   &xdp_status);
+				if (!skb)
+					goto find_next_rx;
+				goto rx_skb;
+			}
+
+			/* Only the protocol headers are copied into the skb,
+			 * the payload keeps referencing the aggregation page
+			 * which is recycled once all its frames are freed.
+			 */
 			if (!agg_free || tp->rx_copybreak > pkt_len)
 				rx_frag_head_sz = pkt_len;
 			else
-				rx_frag_head_sz = tp->rx_copybreak;
+				rx_frag_head_sz = eth_get_headlen(netdev, rx_data,
+								  tp->rx_copybreak);
 
 			skb = napi_alloc_skb(napi, rx_frag_head_sz);
 			if (!skb) {
@@ -2516,6 +2837,8 @@ static int rx_bottom(struct r8152 *tp, int budget)
 				get_page(agg->page);
 			}
 
+rx_skb:
+			net_pkt_stage(skb, PKTLAT_RX);
 			skb->protocol = eth_type_trans(skb, netdev);
 			rtl_rx_vlan_tag(rx_desc, skb);
 			if (work_done < budget) {
@@ -2563,6 +2886,12 @@ submit:
 		spin_unlock_irqrestore(&tp->rx_lock, flags);
 	}
 
+	if (xdp_status & R8152_XDP_REDIRECT)
+		xdp_do_flush();
+
+	if (xdp_status & R8152_XDP_TX)
+		r8152_xdp_tx_kick(tp);
+
 out1:
 	return work_done;
 }
@@ -2575,7 +2904,8 @@ static void tx_bottom(struct r8152 *tp)
 		struct net_device *netdev = tp->netdev;
 		struct tx_agg *agg;
 
-		if (skb_queue_empty(&tp->tx_queue))
+		if (skb_queue_empty(&tp->tx_queue) &&
+		    __ptr_ring_empty(&tp->xdp_tx_ring))
 			break;
 
 		agg = r8152_get_tx_agg(tp);
@@ -2931,8 +3261,8 @@ static int rtl_start_rx(struct r8152 *tp)
 	list_for_each_entry_safe(agg, agg_next, &tmp_list, info_list) {
 		INIT_LIST_HEAD(&agg->list);
 
-		/* Only RTL8152_MAX_RX rx_agg need to be submitted. */
-		if (++i > RTL8152_MAX_RX) {
+		/* Only rx_inflight rx_agg need to be submitted. */
+		if (++i > tp->rx_inflight) {
 			spin_lock_irqsave(&tp->rx_lock, flags);
 			list_add_tail(&agg->list, &tp->rx_used);
 			spin_unlock_irqrestore(&tp->rx_lock, flags);
@@ -2950,6 +3280,15 @@ static int rtl_start_rx(struct r8152 *tp)
 	list_splice(&tmp_list, &tp->rx_info);
 	spin_unlock_irqrestore(&tp->rx_lock, flags);
 
+	/* rx_inflight may have been raised by ethtool -G */
+	for (; !ret && i < tp->rx_inflight; i++) {
+		agg = alloc_rx_agg(tp, GFP_KERNEL);
+		if (!agg)
+			break;
+
+		ret = r8152_submit_rx(tp, agg, GFP_KERNEL);
+	}
+
 	return ret;
 }
 
@@ -2972,7 +3311,7 @@ static int rtl_stop_rx(struct r8152 *tp)
 	spin_unlock_irqrestore(&tp->rx_lock, flags);
 
 	list_for_each_entry_safe(agg, agg_next, &tmp_list, info_list) {
-		/* At least RTL8152_MAX_RX rx_agg have the page_count being
+		/* At least rx_inflight rx_agg have the page_count being
 		 * equal to 1, so the other ones could be freed safely.
 		 */
 		if (page_count(agg->page) > 1)
@@ -6680,6 +7019,31 @@ static void r8156_mdio_force_mode(struct r8152 *tp)
 	}
 }
 
+/* Tell the memory bus what the link can move, in both directions */
+static void rtl_update_bw_req(struct r8152 *tp, u16 speed)
+{
+	u32 mbps;
+
+	if (!(speed & LINK_STATUS)) {
+		sunxi_mbus_bw_remove_request(&tp->bw_req);
+		return;
+	}
+
+	if (speed & _2500bps)
+		mbps = 2500;
+	else if (speed & _1000bps)
+		mbps = 1000;
+	else if (speed & _100bps)
+		mbps = 100;
+	else
+		mbps = 10;
+
+	if (tp->bw_req.active)
+		sunxi_mbus_bw_update_request(&tp->bw_req, mbps * 2 * 1000 / 8);
+	else
+		sunxi_mbus_bw_add_request(&tp->bw_req, mbps * 2 * 1000 / 8);
+}
+
 static void set_carrier(struct r8152 *tp)
 {
 	struct net_device *netdev = tp->netdev;
@@ -6687,6 +7051,7 @@ static void set_carrier(struct r8152 *tp)
 	u16 speed;
 
 	speed = rtl8152_get_speed(tp);
+	rtl_update_bw_req(tp, speed);
 
 	if (speed & LINK_STATUS) {
 		if (!netif_carrier_ok(netdev)) {
@@ -6889,6 +7254,9 @@ static int rtl8152_close(struct net_device *netdev)
 	napi_disable(&tp->napi);
 	netif_stop_queue(netdev);
 
+	/* wait for the in-flight ndo_xdp_xmit() calls of other devices */
+	synchronize_net();
+
 	res = usb_autopm_get_interface(tp->intf);
 	if (res < 0 || test_bit(RTL8152_INACCESSIBLE, &tp->flags)) {
 		rtl_drop_queued_tx(tp);
@@ -6905,6 +7273,7 @@ static int rtl8152_close(struct net_device *netdev)
 		usb_autopm_put_interface(tp->intf);
 
 	free_all_mem(tp);
+	sunxi_mbus_bw_remove_request(&tp->bw_req);
 
 	return res;
 }
@@ -8779,12 +9148,25 @@ static int rtl8152_get_sset_count(struct net_device *dev, int sset)
 {
 	switch (sset) {
 	case ETH_SS_STATS:
-		return ARRAY_SIZE(rtl8152_gstrings);
+		return ARRAY_SIZE(rtl8152_gstrings) +
+		       page_pool_ethtool_stats_get_count();
 	default:
 		return -EOPNOTSUPP;
 	}
 }
 
+static void r8152_get_pp_stats(struct r8152 *tp, u64 *data)
+{
+#ifdef CONFIG_PAGE_POOL_STATS
+	struct page_pool_stats stats = {};
+
+	if (tp->page_pool)
+		page_pool_get_stats(tp->page_pool, &stats);
+
+	page_pool_ethtool_stats_get(data, &stats);
+#endif
+}
+
 static void rtl8152_get_ethtool_stats(struct net_device *dev,
 				      struct ethtool_stats *stats, u64 *data)
 {
@@ -8811,6 +9193,8 @@ static void rtl8152_get_ethtool_stats(struct net_device *dev,
 	data[10] = le32_to_cpu(tally.rx_multicast);
 	data[11] = le16_to_cpu(tally.tx_aborted);
 	data[12] = le16_to_cpu(tally.tx_underrun);
+
+	r8152_get_pp_stats(tp, &data[ARRAY_SIZE(rtl8152_gstrings)]);
 }
 
 static void rtl8152_get_strings(struct net_device *dev, u32 stringset, u8 *data)
@@ -8818,6 +9202,8 @@ static void rtl8152_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 	switch (stringset) {
 	case ETH_SS_STATS:
 		memcpy(data, rtl8152_gstrings, sizeof(rtl8152_gstrings));
+		page_pool_ethtool_stats_get_strings(data +
+						    sizeof(rtl8152_gstrings));
 		break;
 	}
 }
@@ -9087,6 +9473,7 @@ static void rtl8152_get_ringparam(struct net_device *netdev,
 
 	ring->rx_max_pending = RTL8152_RX_MAX_PENDING;
 	ring->rx_pending = tp->rx_pending;
+	kernel_ring->rx_buf_len = tp->rx_buf_sz;
 }
 
 static int rtl8152_set_ringparam(struct net_device *netdev,
@@ -9095,22 +9482,80 @@ static int rtl8152_set_ringparam(struct net_device *netdev,
 				 struct netlink_ext_ack *extack)
 {
 	struct r8152 *tp = netdev_priv(netdev);
+	u32 rx_buf_sz = kernel_ring->rx_buf_len ? : tp->rx_buf_sz;
+	u32 rx_inflight;
+	int ret;
 
 	if (ring->rx_pending < (RTL8152_MAX_RX * 2))
 		return -EINVAL;
 
-	if (tp->rx_pending != ring->rx_pending) {
-		if (netdev->flags & IFF_UP) {
-			mutex_lock(&tp->control);
-			napi_disable(&tp->napi);
-			tp->rx_pending = ring->rx_pending;
-			napi_enable(&tp->napi);
-			mutex_unlock(&tp->control);
-		} else {
-			tp->rx_pending = ring->rx_pending;
+	/* The aggregation must hold at least one frame of the largest MTU */
+	if (rx_buf_sz > tp->rx_buf_sz_max ||
+	    rx_buf_sz < max_t(u32, PAGE_SIZE,
+			      rx_reserved_size(netdev->max_mtu))) {
+		NL_SET_ERR_MSG_MOD(extack, "rx-buf-len out of range");
+		return -EINVAL;
+	}
+
+	/* One in ten of the aggregations of the pool is kept in flight */
+	rx_inflight = clamp_t(u32, ring->rx_pending / 10, RTL8152_MAX_RX,
+			      RTL8152_RX_MAX_INFLIGHT);
+
+	if (!(netdev->flags & IFF_UP)) {
+		/* The rx_agg are allocated again by rtl8152_open() */
+		tp->rx_pending = ring->rx_pending;
+		tp->rx_inflight = rx_inflight;
+		tp->rx_buf_sz = rx_buf_sz;
+		return 0;
+	}
+
+	if (tp->rx_pending == ring->rx_pending && tp->rx_buf_sz == rx_buf_sz)
+		return 0;
+
+	ret = usb_autopm_get_interface(tp->intf);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&tp->control);
+	napi_disable(&tp->napi);
+
+	tp->rx_pending = ring->rx_pending;
+
+	if (tp->rx_inflight != rx_inflight || tp->rx_buf_sz != rx_buf_sz) {
+		netif_stop_queue(netdev);
+		tp->rtl_ops.disable(tp);
+
+		tp->rx_inflight = rx_inflight;
+		if (tp->rx_buf_sz != rx_buf_sz) {
+			struct rx_agg *agg, *agg_next;
+			struct list_head tmp_list;
+			unsigned long flags;
+
+			/* The pages still used by skbs are released with them */
+			INIT_LIST_HEAD(&tmp_list);
+			spin_lock_irqsave(&tp->rx_lock, flags);
+			list_splice_init(&tp->rx_info, &tmp_list);
+			spin_unlock_irqrestore(&tp->rx_lock, flags);
+			list_for_each_entry_safe(agg, agg_next, &tmp_list,
+						 info_list)
+				free_rx_agg(tp, agg);
+
+			tp->rx_buf_sz = rx_buf_sz;
 		}
+
+		/* rtl_start_rx() allocates the missing rx_agg */
+		tp->rtl_ops.enable(tp);
+		rtl_start_rx(tp);
+		clear_bit(RTL8152_SET_RX_MODE, &tp->flags);
+		_rtl8152_set_rx_mode(netdev);
+		netif_wake_queue(netdev);
 	}
 
+	napi_enable(&tp->napi);
+	mutex_unlock(&tp->control);
+
+	usb_autopm_put_interface(tp->intf);
+
 	return 0;
 }
 
@@ -9189,6 +9634,7 @@ out:
 
 static const struct ethtool_ops ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS,
+	.supported_ring_params = ETHTOOL_RING_USE_RX_BUF_LEN,
 	.get_drvinfo = rtl8152_get_drvinfo,
 	.get_link = ethtool_op_get_link,
 	.nway_reset = rtl8152_nway_reset,
@@ -9262,6 +9708,11 @@ static int rtl8152_change_mtu(struct net_device *dev, int new_mtu)
 	struct r8152 *tp = netdev_priv(dev);
 	int ret;
 
+	if (tp->xdp_prog && new_mtu + VLAN_ETH_HLEN > R8152_XDP_MAX_FRAME) {
+		netdev_warn(dev, "MTU %d is too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	switch (tp->version) {
 	case RTL_VER_01:
 	case RTL_VER_02:
@@ -9305,6 +9756,93 @@ static int rtl8152_change_mtu(struct net_device *dev, int new_mtu)
 	return ret;
 }
 
+static int rtl8152_xdp_setup(struct r8152 *tp, struct bpf_prog *prog,
+			     struct netlink_ext_ack *extack)
+{
+	struct net_device *netdev = tp->netdev;
+	struct bpf_prog *old_prog;
+
+	if (prog && netdev->mtu + VLAN_ETH_HLEN > R8152_XDP_MAX_FRAME) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	old_prog = xchg(&tp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int rtl8152_bpf(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	struct r8152 *tp = netdev_priv(netdev);
+
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return rtl8152_xdp_setup(tp, bpf->prog, bpf->extack);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/* Whether all tx aggregations are free, i.e. no bulk-out urb is in flight
+ * whose completion would pick up what is left in the xdp tx ring.
+ */
+static bool r8152_tx_idle(struct r8152 *tp)
+{
+	struct list_head *cursor;
+	unsigned long flags;
+	int n = 0;
+
+	spin_lock_irqsave(&tp->tx_lock, flags);
+	list_for_each(cursor, &tp->tx_free)
+		n++;
+	spin_unlock_irqrestore(&tp->tx_lock, flags);
+
+	return n == RTL8152_MAX_TX;
+}
+
+static int rtl8152_xdp_xmit(struct net_device *netdev, int num_frames,
+			    struct xdp_frame **frames, u32 flags)
+{
+	struct r8152 *tp = netdev_priv(netdev);
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!test_bit(WORK_ENABLE, &tp->flags) ||
+		     !netif_carrier_ok(netdev)))
+		return -ENETDOWN;
+
+	for (i = 0; i < num_frames; i++) {
+		struct xdp_frame *xdpf = frames[i];
+
+		if (xdpf->len > agg_buf_sz - sizeof(struct tx_desc))
+			break;
+
+		if (ptr_ring_produce_bh(&tp->xdp_tx_ring, xdpf))
+			break;
+
+		atomic_add(xdpf->len, &tp->xdp_tx_bytes);
+		nxmit++;
+	}
+
+	/* devmap flushes at the end of every NAPI poll of the ingress device,
+	 * which often carries only a couple of frames. While a bulk-out urb
+	 * is in flight its completion reschedules the tasklet anyway, so
+	 * only kick it once enough bytes are queued to fill a good part of
+	 * an aggregation buffer, and the device gets fewer, larger urbs.
+	 */
+	if ((flags & XDP_XMIT_FLUSH) &&
+	    (atomic_read(&tp->xdp_tx_bytes) >= R8152_XDP_TX_BATCH ||
+	     r8152_tx_idle(tp)))
+		r8152_xdp_tx_kick(tp);
+
+	return nxmit;
+}
+
 static const struct net_device_ops rtl8152_netdev_ops = {
 	.ndo_open		= rtl8152_open,
 	.ndo_stop		= rtl8152_close,
@@ -9317,6 +9855,8 @@ static const struct net_device_ops rtl8152_netdev_ops = {
 	.ndo_change_mtu		= rtl8152_change_mtu,
 	.ndo_validate_addr	= eth_validate_addr,
 	.ndo_features_check	= rtl8152_features_check,
+	.ndo_bpf		= rtl8152_bpf,
+	.ndo_xdp_xmit		= rtl8152_xdp_xmit,
 };
 
 static void rtl8152_unload(struct r8152 *tp)
@@ -9723,6 +10263,15 @@ static int rtl8152_probe(struct usb_interface *intf,
 	netdev->netdev_ops = &rtl8152_netdev_ops;
 	netdev->watchdog_timeo = RTL8152_TX_TIMEOUT;
 
+	/* The frames are packed back to back in the bulk transfer, so the
+	 * frags can only be described when the host controller accepts sg
+	 * entries of any length.
+	 */
+	if (usb_device_no_sg_constraint(udev) &&
+	    udev->bus->sg_tablesize >= MAX_SKB_FRAGS + 2)
+		tp->tx_sg_num = min_t(u32, udev->bus->sg_tablesize,
+				      RTL8152_TX_SG_NUM);
+
 	netdev->features |= NETIF_F_RXCSUM | NETIF_F_IP_CSUM | NETIF_F_SG |
 			    NETIF_F_TSO | NETIF_F_FRAGLIST | NETIF_F_IPV6_CSUM |
 			    NETIF_F_TSO6 | NETIF_F_HW_VLAN_CTAG_RX |
@@ -9734,6 +10283,8 @@ static int rtl8152_probe(struct usb_interface *intf,
 	netdev->vlan_features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_TSO |
 				NETIF_F_HIGHDMA | NETIF_F_FRAGLIST |
 				NETIF_F_IPV6_CSUM | NETIF_F_TSO6;
+	/* forwarded UDP is aggregated into fraglist skbs, split on egress */
+	netdev->features |= NETIF_F_GRO_FRAGLIST;
 
 	if (tp->version == RTL_VER_01) {
 		netdev->features &= ~NETIF_F_RXCSUM;
@@ -9806,6 +10357,8 @@ static int rtl8152_probe(struct usb_interface *intf,
 
 	tp->rx_copybreak = RTL8152_RXFG_HEADSZ;
 	tp->rx_pending = 10 * RTL8152_MAX_RX;
+	tp->rx_inflight = RTL8152_MAX_RX;
+	tp->rx_buf_sz_max = tp->rx_buf_sz;
 
 	intf->needs_remote_wakeup = 1;
 
@@ -9920,6 +10473,8 @@ static struct usb_driver rtl8152_driver = {
 	.post_reset =	rtl8152_post_reset,
 	.supports_autosuspend = 1,
 	.disable_hub_initiated_lpm = 1,
+	/* network critical: never queue behind asynchronous probes */
+	.drvwrap.driver.probe_type = PROBE_FORCE_SYNCHRONOUS,
 };
 
 static int rtl8152_cfgselector_probe(struct usb_device *udev)
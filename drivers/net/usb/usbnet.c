@@ -345,6 +345,12 @@ void usbnet_skb_return (struct usbnet *dev, struct sk_buff *skb)
 	if (skb_defer_rx_timestamp(skb))
 		return;
 
+	/* with FLAG_NAPI, this is only called from usbnet_poll() */
+	if (dev->driver_info->flags & FLAG_NAPI) {
+		napi_gro_receive(&dev->napi, skb);
+		return;
+	}
+
 	status = netif_rx (skb);
 	if (status != NET_RX_SUCCESS)
 		netif_dbg(dev, rx_err, dev->net,
@@ -429,6 +435,17 @@ static void __usbnet_queue_skb(struct sk_buff_head *list,
 
 /*-------------------------------------------------------------------------*/
 
+/* FLAG_NAPI minidrivers handle the done queue from NAPI instead of
+ * the tasklet, so that received packets go through GRO.
+ */
+static inline void usbnet_bh_schedule(struct usbnet *dev)
+{
+	if (dev->driver_info->flags & FLAG_NAPI)
+		napi_schedule(&dev->napi);
+	else
+		tasklet_schedule(&dev->bh);
+}
+
 /* some LK 2.4 HCDs oopsed if we freed or resubmitted urbs from
  * completion callbacks.  2.5 should have fixed those bugs...
  */
@@ -453,7 +470,7 @@ static enum skb_state defer_bh(struct usbnet *dev, struct sk_buff *skb,
 
 	__skb_queue_tail(&dev->done, skb);
 	if (dev->done.qlen == 1)
-		tasklet_schedule(&dev->bh);
+		usbnet_bh_schedule(dev);
 	spin_unlock(&dev->done.lock);
 	spin_unlock_irqrestore(&list->lock, flags);
 	return old_state;
@@ -478,9 +495,30 @@ EXPORT_SYMBOL_GPL(usbnet_defer_kevent);
 
 static void rx_complete (struct urb *urb);
 
-static int rx_submit (struct usbnet *dev, struct urb *urb, gfp_t flags)
+/* fill @skbs with up to @n rx buffers, returns how many were allocated */
+static int rx_alloc_skbs(struct usbnet *dev, struct sk_buff **skbs, int n,
+			 gfp_t flags)
+{
+	unsigned int	pad = 0;
+	int		i;
+
+	if (!test_bit(EVENT_NO_IP_ALIGN, &dev->flags))
+		pad = NET_IP_ALIGN;
+
+	n = netdev_alloc_skb_bulk(dev->net, dev->rx_urb_size + pad, flags,
+				  skbs, n);
+	for (i = 0; i < n; i++)
+		skb_reserve(skbs[i], pad);
+
+	return n;
+}
+
+/* queue @urb with @skb, or a freshly allocated buffer if @skb is NULL;
+ * both are released on failure
+ */
+static int rx_submit_skb(struct usbnet *dev, struct urb *urb,
+			 struct sk_buff *skb, gfp_t flags)
 {
-	struct sk_buff		*skb;
 	struct skb_data		*entry;
 	int			retval = 0;
 	unsigned long		lockflags;
@@ -488,14 +526,17 @@ static int rx_submit (struct usbnet *dev, struct urb *urb, gfp_t flags)
 
 	/* prevent rx skb allocation when error ratio is high */
 	if (test_bit(EVENT_RX_KILL, &dev->flags)) {
+		dev_kfree_skb_any(skb);
 		usb_free_urb(urb);
 		return -ENOLINK;
 	}
 
-	if (test_bit(EVENT_NO_IP_ALIGN, &dev->flags))
-		skb = __netdev_alloc_skb(dev->net, size, flags);
-	else
-		skb = __netdev_alloc_skb_ip_align(dev->net, size, flags);
+	if (!skb) {
+		if (test_bit(EVENT_NO_IP_ALIGN, &dev->flags))
+			skb = __netdev_alloc_skb(dev->net, size, flags);
+		else
+			skb = __netdev_alloc_skb_ip_align(dev->net, size, flags);
+	}
 	if (!skb) {
 		netif_dbg(dev, rx_err, dev->net, "no rx skb\n");
 		usbnet_defer_kevent (dev, EVENT_RX_MEMORY);
@@ -535,7 +576,7 @@ static int rx_submit (struct usbnet *dev, struct urb *urb, gfp_t flags)
 		default:
 			netif_dbg(dev, rx_err, dev->net,
 				  "rx submit, %d\n", retval);
-			tasklet_schedule (&dev->bh);
+			usbnet_bh_schedule(dev);
 			break;
 		case 0:
 			__usbnet_queue_skb(&dev->rxq, skb, rx_start);
@@ -552,6 +593,11 @@ static int rx_submit (struct usbnet *dev, struct urb *urb, gfp_t flags)
 	return retval;
 }
 
+static int rx_submit (struct usbnet *dev, struct urb *urb, gfp_t flags)
+{
+	return rx_submit_skb(dev, urb, NULL, flags);
+}
+
 
 /*-------------------------------------------------------------------------*/
 
@@ -661,6 +707,12 @@ block:
 			set_bit(EVENT_RX_KILL, &dev->flags);
 	}
 
+	/* NAPI resubmits the urb from usbnet_poll(), in batches */
+	if (urb && (dev->driver_info->flags & FLAG_NAPI)) {
+		entry->urb = urb;
+		urb = NULL;
+	}
+
 	state = defer_bh(dev, skb, &dev->rxq, state);
 
 	if (urb) {
@@ -692,12 +744,14 @@ void usbnet_resume_rx(struct usbnet *dev)
 
 	clear_bit(EVENT_RX_PAUSED, &dev->flags);
 
-	while ((skb = skb_dequeue(&dev->rxq_pause)) != NULL) {
+	/* usbnet_poll() passes the paused skbs up itself */
+	while (!(dev->driver_info->flags & FLAG_NAPI) &&
+	       (skb = skb_dequeue(&dev->rxq_pause)) != NULL) {
 		usbnet_skb_return(dev, skb);
 		num++;
 	}
 
-	tasklet_schedule(&dev->bh);
+	usbnet_bh_schedule(dev);
 
 	netif_dbg(dev, rx_status, dev->net,
 		  "paused rx queue disabled, %d skbs requeued\n", num);
@@ -766,7 +820,7 @@ void usbnet_unlink_rx_urbs(struct usbnet *dev)
 {
 	if (netif_running(dev->net)) {
 		(void) unlink_urbs (dev, &dev->rxq);
-		tasklet_schedule(&dev->bh);
+		usbnet_bh_schedule(dev);
 	}
 }
 EXPORT_SYMBOL_GPL(usbnet_unlink_rx_urbs);
@@ -849,7 +903,10 @@ int usbnet_stop (struct net_device *net)
 	/* deferred work (timer, softirq, task) must also stop */
 	dev->flags = 0;
 	del_timer_sync (&dev->delay);
-	tasklet_kill (&dev->bh);
+	if (info->flags & FLAG_NAPI)
+		napi_disable(&dev->napi);
+	else
+		tasklet_kill (&dev->bh);
 	cancel_work_sync(&dev->kevent);
 	if (!pm)
 		usb_autopm_put_interface(dev->intf);
@@ -934,7 +991,9 @@ int usbnet_open (struct net_device *net)
 	clear_bit(EVENT_RX_KILL, &dev->flags);
 
 	// delay posting reads until we're fully open
-	tasklet_schedule (&dev->bh);
+	if (info->flags & FLAG_NAPI)
+		napi_enable(&dev->napi);
+	usbnet_bh_schedule(dev);
 	if (info->manage_power) {
 		retval = info->manage_power(dev, 1);
 		if (retval < 0) {
@@ -1102,7 +1161,7 @@ static void __handle_link_change(struct usbnet *dev)
 		 */
 	} else {
 		/* submitting URBs for reading packets */
-		tasklet_schedule(&dev->bh);
+		usbnet_bh_schedule(dev);
 	}
 
 	/* hard_mtu or rx_urb_size may change during link change */
@@ -1176,7 +1235,7 @@ fail_halt:
 					   status);
 		} else {
 			clear_bit (EVENT_RX_HALT, &dev->flags);
-			tasklet_schedule (&dev->bh);
+			usbnet_bh_schedule(dev);
 		}
 	}
 
@@ -1201,7 +1260,7 @@ fail_halt:
 			usb_autopm_put_interface(dev->intf);
 fail_lowmem:
 			if (resched)
-				tasklet_schedule (&dev->bh);
+				usbnet_bh_schedule(dev);
 		}
 	}
 
@@ -1302,7 +1361,7 @@ void usbnet_tx_timeout (struct net_device *net, unsigned int txqueue)
 	struct usbnet		*dev = netdev_priv(net);
 
 	unlink_urbs (dev, &dev->txq);
-	tasklet_schedule (&dev->bh);
+	usbnet_bh_schedule(dev);
 	/* this needs to be handled individually because the generic layer
 	 * doesn't know what is sufficient and could not restore private
 	 * information if a remedy of an unconditional reset were used.
@@ -1494,54 +1553,88 @@ EXPORT_SYMBOL_GPL(usbnet_start_xmit);
 
 static int rx_alloc_submit(struct usbnet *dev, gfp_t flags)
 {
+	struct sk_buff	*skbs[10];
 	struct urb	*urb;
-	int		i;
+	int		i, n, want;
 	int		ret = 0;
 
+	if (test_bit(EVENT_RX_KILL, &dev->flags))
+		return -ENOLINK;
+
 	/* don't refill the queue all at once */
-	for (i = 0; i < 10 && dev->rxq.qlen < RX_QLEN(dev); i++) {
+	want = min_t(int, ARRAY_SIZE(skbs), RX_QLEN(dev) - dev->rxq.qlen);
+	if (want <= 0)
+		return 0;
+
+	n = rx_alloc_skbs(dev, skbs, want, flags);
+	for (i = 0; i < n; i++) {
 		urb = usb_alloc_urb(0, flags);
-		if (urb != NULL) {
-			ret = rx_submit(dev, urb, flags);
-			if (ret)
-				goto err;
-		} else {
+		if (urb == NULL) {
 			ret = -ENOMEM;
 			goto err;
 		}
+		ret = rx_submit_skb(dev, urb, skbs[i], flags);
+		if (ret) {
+			i++;
+			goto err;
+		}
+	}
+	if (n < want) {
+		netif_dbg(dev, rx_err, dev->net, "no rx skb\n");
+		usbnet_defer_kevent(dev, EVENT_RX_MEMORY);
+		ret = -ENOMEM;
 	}
 err:
+	/* buffers left over after a failed submission */
+	if (i < n)
+		napi_consume_skb_bulk(skbs + i, n - i, 0);
 	return ret;
 }
 
 /*-------------------------------------------------------------------------*/
 
-// tasklet (work deferred from completions, in_irq) or timer
+// tasklet (work deferred from completions, in_irq), timer or NAPI
 
-static void usbnet_bh (struct timer_list *t)
+static int __usbnet_bh(struct usbnet *dev, int budget)
 {
-	struct usbnet		*dev = from_timer(dev, t, delay);
 	struct sk_buff		*skb;
 	struct skb_data		*entry;
+	struct urb		*urb;
+	struct sk_buff		*done[16];
+	int			work_done = 0;
+	int			n_done = 0;
 
-	while ((skb = skb_dequeue (&dev->done))) {
+	while (work_done < budget && (skb = skb_dequeue (&dev->done))) {
 		entry = (struct skb_data *) skb->cb;
 		switch (entry->state) {
 		case rx_done:
 			entry->state = rx_cleanup;
+			/* only set for FLAG_NAPI, see rx_complete() */
+			urb = entry->urb;
+			entry->urb = NULL;
 			rx_process (dev, skb);
+			if (urb && !rx_submit(dev, urb, GFP_ATOMIC))
+				usb_mark_last_busy(dev->udev);
+			work_done++;
 			continue;
 		case tx_done:
 			kfree(entry->urb->sg);
 			fallthrough;
 		case rx_cleanup:
 			usb_free_urb (entry->urb);
-			dev_kfree_skb (skb);
+			/* completed buffers go back to the NAPI cache in bulk */
+			done[n_done++] = skb;
+			if (n_done == ARRAY_SIZE(done)) {
+				napi_consume_skb_bulk(done, n_done, budget);
+				n_done = 0;
+			}
 			continue;
 		default:
 			netdev_dbg(dev->net, "bogus skb state %d\n", entry->state);
 		}
 	}
+	if (n_done)
+		napi_consume_skb_bulk(done, n_done, budget);
 
 	/* restart RX again after disabling due to high error rate */
 	clear_bit(EVENT_RX_KILL, &dev->flags);
@@ -1564,24 +1657,56 @@ static void usbnet_bh (struct timer_list *t)
 
 		if (temp < RX_QLEN(dev)) {
 			if (rx_alloc_submit(dev, GFP_ATOMIC) == -ENOLINK)
-				return;
+				return work_done;
 			if (temp != dev->rxq.qlen)
 				netif_dbg(dev, link, dev->net,
 					  "rxqlen %d --> %d\n",
 					  temp, dev->rxq.qlen);
 			if (dev->rxq.qlen < RX_QLEN(dev))
-				tasklet_schedule (&dev->bh);
+				usbnet_bh_schedule(dev);
 		}
 		if (dev->txq.qlen < TX_QLEN (dev))
 			netif_wake_queue (dev->net);
 	}
+
+	return work_done;
+}
+
+static void usbnet_bh (struct timer_list *t)
+{
+	struct usbnet		*dev = from_timer(dev, t, delay);
+
+	if (dev->driver_info->flags & FLAG_NAPI)
+		napi_schedule(&dev->napi);
+	else
+		__usbnet_bh(dev, INT_MAX);
 }
 
 static void usbnet_bh_tasklet(struct tasklet_struct *t)
 {
 	struct usbnet *dev = from_tasklet(dev, t, bh);
 
-	usbnet_bh(&dev->delay);
+	__usbnet_bh(dev, INT_MAX);
+}
+
+static int usbnet_poll(struct napi_struct *napi, int budget)
+{
+	struct usbnet *dev = container_of(napi, struct usbnet, napi);
+	struct sk_buff *skb;
+	int work_done;
+
+	while (!test_bit(EVENT_RX_PAUSED, &dev->flags) &&
+	       (skb = skb_dequeue(&dev->rxq_pause)) != NULL)
+		usbnet_skb_return(dev, skb);
+
+	work_done = __usbnet_bh(dev, budget);
+
+	/* defer_bh() only schedules NAPI when the done queue was empty */
+	if (work_done < budget && napi_complete_done(napi, work_done) &&
+	    !skb_queue_empty(&dev->done))
+		napi_schedule(napi);
+
+	return work_done;
 }
 
 
@@ -1717,6 +1842,8 @@ usbnet_probe (struct usb_interface *udev, const struct usb_device_id *prod)
 	skb_queue_head_init (&dev->done);
 	skb_queue_head_init(&dev->rxq_pause);
 	tasklet_setup(&dev->bh, usbnet_bh_tasklet);
+	if (info->flags & FLAG_NAPI)
+		netif_napi_add(net, &dev->napi, usbnet_poll);
 	INIT_WORK (&dev->kevent, usbnet_deferred_kevent);
 	init_usb_anchor(&dev->deferred);
 	timer_setup(&dev->delay, usbnet_bh, 0);
@@ -1946,7 +2073,7 @@ int usbnet_resume (struct usb_interface *intf)
 
 			if (!(dev->txq.qlen >= TX_QLEN(dev)))
 				netif_tx_wake_all_queues(dev->net);
-			tasklet_schedule (&dev->bh);
+			usbnet_bh_schedule(dev);
 		}
 	}
 
@@ -21,6 +21,7 @@
 	#include <linux/mmc/sdio_ids.h>
 	#include <linux/mmc/host.h>
 	#include <linux/mmc/card.h>
+	#include <linux/mmc/sdio_bench.h>
 
 	#ifdef CONFIG_PLATFORM_SPRD
 		#include <linux/gpio.h>
@@ -47,6 +48,8 @@ typedef struct sdio_data {
 	unsigned int clock;
 	unsigned int timing;
 	u8	sd3_bus_mode;
+
+	struct sdio_bench bench;	/* raw CMD53 reads, see rtw_sdio_bench() */
 #endif
 
 #ifdef DBG_SDIO
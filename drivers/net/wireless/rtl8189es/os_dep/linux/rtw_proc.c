@@ -451,6 +451,31 @@ static int proc_get_sdio_card_info(struct seq_file *m, void *v)
 	return 0;
 }
 
+static int proc_get_sdio_bench(struct seq_file *m, void *v)
+{
+	struct net_device *dev = m->private;
+	_adapter *adapter = (_adapter *)rtw_netdev_priv(dev);
+
+	sdio_bench_show(m, &adapter_to_dvobj(adapter)->intf_data.bench);
+
+	return 0;
+}
+
+/* "<size> <count>": time <count> raw CMD53 reads of <size> bytes */
+static ssize_t proc_set_sdio_bench(struct file *file, const char __user *buffer, size_t count, loff_t *pos, void *data)
+{
+	struct net_device *dev = data;
+	_adapter *adapter = (_adapter *)rtw_netdev_priv(dev);
+
+	if (!buffer)
+		return -EFAULT;
+
+	if (RTW_CANNOT_IO(adapter) || rtw_is_drv_stopped(adapter))
+		return -EIO;
+
+	return sdio_bench_write(&adapter_to_dvobj(adapter)->intf_data.bench, buffer, count);
+}
+
 #ifdef DBG_SDIO
 static int proc_get_sdio_dbg(struct seq_file *m, void *v)
 {
@@ -4396,6 +4421,7 @@ const struct rtw_proc_hdl adapter_proc_hdls[] = {
 	RTW_PROC_HDL_SSEQ("sd_f0_reg_dump", proc_get_sd_f0_reg_dump, NULL),
 	RTW_PROC_HDL_SSEQ("sdio_local_reg_dump", proc_get_sdio_local_reg_dump, NULL),
 	RTW_PROC_HDL_SSEQ("sdio_card_info", proc_get_sdio_card_info, NULL),
+	RTW_PROC_HDL_SSEQ("sdio_bench", proc_get_sdio_bench, proc_set_sdio_bench),
 #ifdef DBG_SDIO
 	RTW_PROC_HDL_SSEQ("sdio_dbg", proc_get_sdio_dbg, proc_set_sdio_dbg),
 #endif /* DBG_SDIO */
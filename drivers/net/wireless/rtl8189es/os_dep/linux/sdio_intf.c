@@ -654,6 +654,7 @@ static struct dvobj_priv *sdio_dvobj_init(struct sdio_func *func, const struct s
 
 	psdio = &dvobj->intf_data;
 	psdio->func = func;
+	sdio_bench_init(&psdio->bench, rtw_sdio_bench, 65536, 1);
 
 	if (sdio_init(dvobj) != _SUCCESS) {
 		goto free_dvobj;
@@ -1344,4 +1344,23 @@ int __must_check rtw_sdio_raw_write(struct dvobj_priv *d, unsigned int addr,
 
 	return linux_io_err_to_drv_err(error);
 }
+
+/**
+ *	rtw_sdio_bench - One raw CMD53 read for the SDIO benchmark
+ *	@bench: benchmark state in the driver object's SDIO data
+ *	@buf: destination buffer
+ *	@size: bytes to read
+ *
+ *	Reads @size bytes at a fixed address from REG_SYS_CFG, a read only
+ *	register, so that only the bus transfer is measured and nothing on
+ *	the chip changes. Timing is done by the mmc core's sdio_bench_write().
+ *	Returns 0 on success.
+ */
+int rtw_sdio_bench(struct sdio_bench *bench, void *buf, u32 size)
+{
+	struct dvobj_priv *d = container_of(bench, struct dvobj_priv, intf_data.bench);
+	u32 addr = (WLAN_IOREG_DEVICE_ID << 13) | (REG_SYS_CFG & WLAN_IOREG_MSK);
+
+	return rtw_sdio_raw_read(d, addr, buf, size, _TRUE);
+}
 #endif
@@ -53,6 +53,7 @@ int __must_check rtw_sdio_raw_read(struct dvobj_priv *d, unsigned int addr,
 				void *buf, size_t len, bool fixed);
 int __must_check rtw_sdio_raw_write(struct dvobj_priv *d, unsigned int addr,
 				void *buf, size_t len, bool fixed);
+int rtw_sdio_bench(struct sdio_bench *bench, void *buf, u32 size);
 
 #endif /* __SDIO_OPS_LINUX_H__ */
 
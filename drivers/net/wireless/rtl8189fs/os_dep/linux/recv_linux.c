@@ -86,7 +86,16 @@ int rtw_os_alloc_recvframe(_adapter *padapter, union recv_frame *precvframe, u8
 		alloc_sz += 14;
 	}
 
-	pkt_copy = rtw_skb_alloc(alloc_sz);
+#ifdef CONFIG_RTW_NAPI
+	/* The recv tasklet runs in softirq context: take the frame from the
+	 * per-cpu NAPI page-frag cache rather than kmalloc'ing a new head,
+	 * and GRO can later merge these heads as frags without copying. */
+	if (padapter->registrypriv.en_napi
+	    && padapter->napi_state == NAPI_ENABLE && in_serving_softirq())
+		pkt_copy = napi_alloc_skb(&padapter->napi, alloc_sz);
+	else
+#endif
+		pkt_copy = rtw_skb_alloc(alloc_sz);
 
 	if (pkt_copy) {
 		pkt_copy->dev = padapter->pnetdev;
@@ -359,6 +368,8 @@ static int napi_recv(_adapter *padapter, int budget)
 			if (rtw_napi_gro_receive(&padapter->napi, pskb) != GRO_DROP)
 				rx_ok = _TRUE;
 #else
+			/* GRO_DROP is gone, napi_gro_receive() always consumes skb */
+			rtw_napi_gro_receive(&padapter->napi, pskb);
 			rx_ok = _TRUE;
 #endif
 			goto next;
@@ -389,7 +400,8 @@ int rtw_recv_napi_poll(struct napi_struct *napi, int budget)
 
 	work_done = napi_recv(padapter, budget);
 	if (work_done < budget) {
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 19, 0)) && defined(CONFIG_PCI_HCI)
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 19, 0))
+		/* Lets the core honour gro_flush_timeout for SDIO/USB too */
 		napi_complete_done(napi, work_done);
 #else
 		napi_complete(napi);
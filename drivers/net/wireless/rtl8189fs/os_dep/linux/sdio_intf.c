@@ -139,6 +139,10 @@ static struct sdio_drv_priv sdio_drvpriv = {
 #endif
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 29))
 		.pm = &rtw_sdio_pm_ops,
+#endif
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 2, 0))
+		/* firmware download and MAC init take a while, probe off the boot path */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 #endif
 	}
 };
@@ -546,6 +550,7 @@ static struct dvobj_priv *sdio_dvobj_init(struct sdio_func *func, const struct s
 
 	psdio = &dvobj->intf_data;
 	psdio->func = func;
+	sdio_bench_init(&psdio->bench, rtw_sdio_bench, 65536, 1);
 
 	if (sdio_init(dvobj) != _SUCCESS) {
 		goto free_dvobj;
@@ -1223,6 +1223,9 @@ struct _ADAPTER {
 #ifdef CONFIG_BT_COEXIST_SOCKET_TRX
 	struct bt_coex_info coex_info;
 #endif /* CONFIG_BT_COEXIST_SOCKET_TRX */
+#ifdef CONFIG_BT_COEXIST
+	struct btcoex_adapt btc_adapt;
+#endif /* CONFIG_BT_COEXIST */
 
 	ERROR_CODE		LastError; /* <20130613, Kordan> Only the functions associated with MP records the error code by now. */
 
@@ -435,6 +435,37 @@ u8 rtw_btcoex_get_pg_rfe_type(PADAPTER padapter);
 u8 rtw_btcoex_is_tfbga_package_type(PADAPTER padapter);
 u8 rtw_btcoex_get_ant_div_cfg(PADAPTER padapter);
 
+/* Adaptive PS-TDMA, see os_dep/linux/rtw_btcoex_adapt.c */
+#define BTC_ADAPT_BUCKETS	10
+
+struct btc_adapt_slot {
+	u32 periods;
+	u64 wl_ms;
+	u64 bt_ms;
+	u64 wl_bytes;
+	u64 bt_pkts;
+};
+
+struct btcoex_adapt {
+	_adapter *adapter;
+	struct delayed_work work;
+	u8 enabled;
+	u8 tdma_on;
+	u8 wl_slot;	/* Wi-Fi ms of the TDMA cycle */
+	u8 bt_share;	/* BT percent of the TDMA cycle */
+	u8 idle_periods;
+	u32 bt_duty;
+	u32 wl_backlog;
+	u32 h2c_cnt;
+	u64 last_tx_bytes;
+	struct btc_adapt_slot slot[BTC_ADAPT_BUCKETS];
+};
+
+extern int rtw_btcoex_adapt;
+void rtw_btcoex_adapt_start(_adapter *padapter);
+void rtw_btcoex_adapt_stop(_adapter *padapter);
+void rtw_btcoex_adapt_dump(void *sel, _adapter *padapter);
+
 /* ==================================================
  * Below Functions are called by BT-Coex
  * ================================================== */
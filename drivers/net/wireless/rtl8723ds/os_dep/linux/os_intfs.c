@@ -2788,6 +2788,11 @@ int _netdev_open(struct net_device *pnetdev)
 	netdev_br_init(pnetdev);
 #endif /* CONFIG_BR_EXT */
 
+#ifdef CONFIG_BT_COEXIST
+	if (rtw_btcoex_adapt)
+		rtw_btcoex_adapt_start(padapter);
+#endif /* CONFIG_BT_COEXIST */
+
 #ifdef CONFIG_BT_COEXIST_SOCKET_TRX
 	if (is_primary_adapter(padapter) && (_TRUE == pHalData->EEPROMBluetoothCoexist)) {
 		rtw_btcoex_init_socket(padapter);
@@ -2998,6 +3003,9 @@ static int netdev_close(struct net_device *pnetdev)
 #endif /* CONFIG_BT_COEXIST_SOCKET_TRX */
 
 	RTW_INFO(FUNC_NDEV_FMT" , bup=%d\n", FUNC_NDEV_ARG(pnetdev), padapter->bup);
+#ifdef CONFIG_BT_COEXIST
+	rtw_btcoex_adapt_stop(padapter);
+#endif /* CONFIG_BT_COEXIST */
 #ifndef CONFIG_PLATFORM_INTEL_BYT
 	if (pwrctl->bInternalAutoSuspend == _TRUE) {
 		/* rtw_pwr_wakeup(padapter); */
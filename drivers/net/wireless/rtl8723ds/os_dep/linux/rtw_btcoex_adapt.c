@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * Copyright(c) 2007 - 2017 Realtek Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ *****************************************************************************/
+#define _RTW_BTCOEX_ADAPT_C_
+
+#include <drv_types.h>
+
+#ifdef CONFIG_BT_COEXIST
+/*
+ * Adaptive PS-TDMA for shared antenna combo chips
+ *
+ * The coex mechanism picks one of a few fixed PS-TDMA cases from the BT
+ * profile, so a BLE scan that uses a few percent of the air still takes
+ * its full BT slot away from Wi-Fi. When enabled, this takes the coex
+ * mechanism into manual control and sizes the Wi-Fi slot of the 100ms
+ * TDMA cycle itself, every BTC_ADAPT_PERIOD_MS:
+ *
+ *  - BT duty cycle is estimated from the PTA hi/lo priority packet
+ *    counters, charging BTC_ADAPT_BT_PKT_US of air per packet;
+ *  - BT gets its duty plus BTC_ADAPT_BT_MARGIN, within
+ *    [BTC_ADAPT_BT_MIN, BTC_ADAPT_BT_MAX] percent;
+ *  - with little Wi-Fi backlog BT may have up to half the cycle, with
+ *    a deep backlog only what it needs;
+ *  - TDMA is turned off while BT stays silent.
+ *
+ * Per Wi-Fi slot length the time spent, Wi-Fi bytes sent and BT packets
+ * seen are kept, see rtw_btcoex_adapt_dump().
+ */
+
+#define BTC_ADAPT_PERIOD_MS	200
+#define BTC_ADAPT_CYCLE_MS	100	/* PS-TDMA cycle, one beacon interval */
+#define BTC_ADAPT_BT_PKT_US	400	/* air time charged per BT packet */
+#define BTC_ADAPT_BT_MIN	10	/* BT share of the cycle, in percent */
+#define BTC_ADAPT_BT_MAX	70
+#define BTC_ADAPT_BT_MARGIN	10
+#define BTC_ADAPT_BT_IDLE	50	/* BT share with no Wi-Fi backlog */
+#define BTC_ADAPT_IDLE_PERIODS	5	/* silent periods before TDMA off */
+
+/* PTA packet counters, [15:0] TX and [31:16] RX */
+#define REG_BTC_HIPRI_CNT	0x0770
+#define REG_BTC_LOPRI_CNT	0x0774
+#define REG_BTC_CNT_CTRL	0x076E
+#define BTC_CNT_RESET		0x0C
+
+int rtw_btcoex_adapt = 0;
+module_param(rtw_btcoex_adapt, int, 0644);
+MODULE_PARM_DESC(rtw_btcoex_adapt, "Adaptive BT/Wi-Fi PS-TDMA on shared antenna, 0:off, 1:on");
+
+static void btc_adapt_set_tdma(_adapter *padapter, struct btcoex_adapt *a, u8 on, u8 wl_slot)
+{
+	u8 parm[5] = {0};
+
+	if (on == a->tdma_on && (!on || wl_slot == a->wl_slot))
+		return;
+
+	if (on) {
+		parm[0] = 0x61;
+		parm[1] = wl_slot;
+		parm[2] = 0x03;
+		parm[3] = 0x11;
+		parm[4] = 0x11;
+	}
+
+	if (rtw_hal_fill_h2c_cmd(padapter, H2C_B_TYPE_TDMA, sizeof(parm), parm) != _SUCCESS)
+		return;
+
+	a->tdma_on = on;
+	a->wl_slot = on ? wl_slot : BTC_ADAPT_CYCLE_MS;
+	a->h2c_cnt++;
+}
+
+static u32 btc_adapt_bt_pkts(_adapter *padapter)
+{
+	u32 hi, lo;
+
+	hi = rtw_read32(padapter, REG_BTC_HIPRI_CNT);
+	lo = rtw_read32(padapter, REG_BTC_LOPRI_CNT);
+	rtw_write8(padapter, REG_BTC_CNT_CTRL, BTC_CNT_RESET);
+
+	return (hi & 0xFFFF) + (hi >> 16) + (lo & 0xFFFF) + (lo >> 16);
+}
+
+static void btc_adapt_work(struct work_struct *work)
+{
+	struct btcoex_adapt *a = container_of(work, struct btcoex_adapt, work.work);
+	_adapter *padapter = a->adapter;
+	struct pwrctrl_priv *pwrctl = adapter_to_pwrctl(padapter);
+	struct xmit_priv *pxmitpriv = &padapter->xmitpriv;
+	struct btc_adapt_slot *slot;
+	u32 bt_pkts, duty, backlog, target;
+	u64 tx_bytes;
+
+	/* Registers are not reachable while the fw holds the chip in 32K */
+	if (RTW_CANNOT_IO(padapter) || pwrctl->rf_pwrstate != rf_on
+	    || pwrctl->bFwCurrentInPSMode)
+		goto resched;
+
+	bt_pkts = btc_adapt_bt_pkts(padapter);
+	tx_bytes = pxmitpriv->tx_bytes;
+
+	/* Account the period that just ended to the slot it ran with */
+	slot = &a->slot[min_t(int, a->wl_slot * BTC_ADAPT_BUCKETS / BTC_ADAPT_CYCLE_MS, BTC_ADAPT_BUCKETS - 1)];
+	slot->periods++;
+	slot->wl_ms += BTC_ADAPT_PERIOD_MS * a->wl_slot / BTC_ADAPT_CYCLE_MS;
+	slot->bt_ms += BTC_ADAPT_PERIOD_MS * (BTC_ADAPT_CYCLE_MS - a->wl_slot) / BTC_ADAPT_CYCLE_MS;
+	slot->wl_bytes += tx_bytes - a->last_tx_bytes;
+	slot->bt_pkts += bt_pkts;
+	a->last_tx_bytes = tx_bytes;
+
+	duty = min_t(u32, bt_pkts * BTC_ADAPT_BT_PKT_US / (BTC_ADAPT_PERIOD_MS * 10), 100);
+	backlog = NR_XMITFRAME - pxmitpriv->free_xmitframe_cnt;
+	a->bt_duty = duty;
+	a->wl_backlog = backlog;
+
+	if (!bt_pkts) {
+		if (a->idle_periods < BTC_ADAPT_IDLE_PERIODS)
+			a->idle_periods++;
+	} else
+		a->idle_periods = 0;
+
+	if (a->idle_periods >= BTC_ADAPT_IDLE_PERIODS) {
+		a->bt_share = BTC_ADAPT_BT_MIN;
+		btc_adapt_set_tdma(padapter, a, _FALSE, 0);
+		goto resched;
+	}
+
+	target = duty + BTC_ADAPT_BT_MARGIN;
+	if (backlog < NR_XMITFRAME / 8)
+		target = max_t(u32, target, BTC_ADAPT_BT_IDLE);
+	target = clamp_t(u32, target, BTC_ADAPT_BT_MIN, BTC_ADAPT_BT_MAX);
+
+	/* Give BT more at once, take it back gradually */
+	if (target > a->bt_share)
+		a->bt_share = target;
+	else
+		a->bt_share = (3 * a->bt_share + target) / 4;
+
+	btc_adapt_set_tdma(padapter, a, _TRUE,
+		BTC_ADAPT_CYCLE_MS * (100 - a->bt_share) / 100);
+
+resched:
+	queue_delayed_work(system_freezable_wq, &a->work, msecs_to_jiffies(BTC_ADAPT_PERIOD_MS));
+}
+
+/* Only the primary adapter of a single antenna BT combo chip runs this */
+void rtw_btcoex_adapt_start(_adapter *padapter)
+{
+	struct btcoex_adapt *a = &padapter->btc_adapt;
+
+	if (a->enabled || !is_primary_adapter(padapter)
+	    || !rtw_btcoex_get_bt_coexist(padapter) || !rtw_btcoex_1Ant(padapter))
+		return;
+
+	_rtw_memset(a, 0, sizeof(*a));
+	a->adapter = padapter;
+	a->wl_slot = BTC_ADAPT_CYCLE_MS;
+	a->bt_share = BTC_ADAPT_BT_MIN;
+	a->last_tx_bytes = padapter->xmitpriv.tx_bytes;
+	INIT_DELAYED_WORK(&a->work, btc_adapt_work);
+
+	rtw_btcoex_SetManualControl(padapter, _TRUE);
+	a->enabled = 1;
+	queue_delayed_work(system_freezable_wq, &a->work, 0);
+
+	RTW_INFO(FUNC_ADPT_FMT" adaptive PS-TDMA on\n", FUNC_ADPT_ARG(padapter));
+}
+
+void rtw_btcoex_adapt_stop(_adapter *padapter)
+{
+	struct btcoex_adapt *a = &padapter->btc_adapt;
+
+	if (!a->enabled)
+		return;
+
+	cancel_delayed_work_sync(&a->work);
+	a->enabled = 0;
+
+	/* The coex mechanism sets its own TDMA case on its next run */
+	if (!RTW_CANNOT_IO(padapter))
+		btc_adapt_set_tdma(padapter, a, _FALSE, 0);
+	rtw_btcoex_SetManualControl(padapter, _FALSE);
+
+	RTW_INFO(FUNC_ADPT_FMT" adaptive PS-TDMA off\n", FUNC_ADPT_ARG(padapter));
+}
+
+void rtw_btcoex_adapt_dump(void *sel, _adapter *padapter)
+{
+	struct btcoex_adapt *a = &padapter->btc_adapt;
+	struct btc_adapt_slot *slot;
+	int i;
+
+	RTW_PRINT_SEL(sel, "enabled=%u tdma=%u wl_slot=%ums bt_share=%u%% bt_duty=%u%% wl_backlog=%u h2c=%u\n"
+		, a->enabled, a->tdma_on, a->wl_slot, a->bt_share
+		, a->bt_duty, a->wl_backlog, a->h2c_cnt);
+
+	/* Throughput over the Wi-Fi part of the time, BT packet rate over the rest */
+	RTW_PRINT_SEL(sel, "%-10s %8s %12s %12s\n", "wl_slot_ms", "periods", "wl_kbps", "bt_pkt/s");
+	for (i = 0; i < BTC_ADAPT_BUCKETS; i++) {
+		slot = &a->slot[i];
+		if (!slot->periods)
+			continue;
+
+		RTW_PRINT_SEL(sel, "%3u-%-6u %8u %12llu %12llu\n"
+			, BTC_ADAPT_CYCLE_MS * i / BTC_ADAPT_BUCKETS
+			, BTC_ADAPT_CYCLE_MS * (i + 1) / BTC_ADAPT_BUCKETS
+			, slot->periods
+			, div64_u64(slot->wl_bytes * 8, max_t(u64, slot->wl_ms, 1))
+			, div64_u64(slot->bt_pkts * 1000, max_t(u64, slot->bt_ms, 1)));
+	}
+}
+#endif /* CONFIG_BT_COEXIST */
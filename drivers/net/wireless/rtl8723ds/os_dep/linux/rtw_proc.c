@@ -1711,6 +1711,49 @@ ssize_t proc_set_btinfo_evt(struct file *file, const char __user *buffer, size_t
 	return count;
 }
 
+static int proc_get_btcoex_adapt(struct seq_file *m, void *v)
+{
+	struct net_device *dev = m->private;
+	_adapter *padapter = (_adapter *)rtw_netdev_priv(dev);
+
+	rtw_btcoex_adapt_dump(m, padapter);
+
+	return 0;
+}
+
+static ssize_t proc_set_btcoex_adapt(struct file *file, const char __user *buffer, size_t count, loff_t *pos, void *data)
+{
+	struct net_device *dev = data;
+	_adapter *padapter = (_adapter *)rtw_netdev_priv(dev);
+	char tmp[8];
+	int enable;
+
+	if (count < 1)
+		return -EFAULT;
+
+	if (count >= sizeof(tmp)) {
+		rtw_warn_on(1);
+		return -EFAULT;
+	}
+
+	if (buffer && !copy_from_user(tmp, buffer, count)) {
+		int num;
+
+		tmp[count] = '\0';
+		num = sscanf(tmp, "%d", &enable);
+
+		if (num != 1)
+			return -EINVAL;
+
+		if (!enable)
+			rtw_btcoex_adapt_stop(padapter);
+		else if (padapter->netif_up)
+			rtw_btcoex_adapt_start(padapter);
+	}
+
+	return count;
+}
+
 static u8 btreg_read_type = 0;
 static u16 btreg_read_addr = 0;
 static int btreg_read_error = 0;
@@ -2220,6 +2263,7 @@ const struct rtw_proc_hdl adapter_proc_hdls[] = {
 #ifdef CONFIG_BT_COEXIST
 	RTW_PROC_HDL_SSEQ("btcoex_dbg", proc_get_btcoex_dbg, proc_set_btcoex_dbg),
 	RTW_PROC_HDL_SSEQ("btcoex", proc_get_btcoex_info, NULL),
+	RTW_PROC_HDL_SSEQ("btcoex_adapt", proc_get_btcoex_adapt, proc_set_btcoex_adapt),
 	RTW_PROC_HDL_SSEQ("btinfo_evt", NULL, proc_set_btinfo_evt),
 	RTW_PROC_HDL_SSEQ("btreg_read", proc_get_btreg_read, proc_set_btreg_read),
 	RTW_PROC_HDL_SSEQ("btreg_write", proc_get_btreg_write, proc_set_btreg_write),
@@ -770,6 +770,8 @@ void usb_read_port_complete(struct urb *purb, struct pt_regs *regs)
 			rtw_reset_continual_io_error(adapter_to_dvobj(padapter));
 
 			precvbuf->transfer_len = purb->actual_length;
+			rtw_usb_rx_agg_account(&precvpriv->usb_rx_agg,
+					       purb->actual_length);
 
 			rtw_enqueue_recvbuf(precvbuf, &precvpriv->recv_buf_pending_queue);
 
@@ -923,6 +925,8 @@ void usb_read_port_complete(struct urb *purb, struct pt_regs *regs)
 			rtw_reset_continual_io_error(adapter_to_dvobj(padapter));
 
 			precvbuf->transfer_len = purb->actual_length;
+			rtw_usb_rx_agg_account(&precvpriv->usb_rx_agg,
+					       purb->actual_length);
 			skb_put(precvbuf->pskb, purb->actual_length);
 			skb_queue_tail(&precvpriv->rx_skb_queue, precvbuf->pskb);
 
@@ -998,8 +1002,10 @@ u32 usb_read_port(struct intf_hdl *pintfhdl, u32 addr, u32 cnt, u8 *rmem)
 		SIZE_PTR alignment = 0;
 
 		precvbuf->pskb = skb_dequeue(&precvpriv->free_recv_skb_queue);
-		if (NULL != precvbuf->pskb)
+		if (NULL != precvbuf->pskb) {
+			precvpriv->usb_rx_agg.skb_recycled++;
 			goto recv_buf_hook;
+		}
 
 		#ifndef CONFIG_FIX_NR_BULKIN_BUFFER
 		precvbuf->pskb = rtw_skb_alloc(MAX_RECVBUF_SZ + RECVBUFF_ALIGN_SZ);
@@ -1009,9 +1015,11 @@ u32 usb_read_port(struct intf_hdl *pintfhdl, u32 addr, u32 cnt, u8 *rmem)
 			if (0)
 				RTW_INFO("usb_read_port() enqueue precvbuf=%p\n", precvbuf);
 			/* enqueue precvbuf and wait for free skb */
+			precvpriv->usb_rx_agg.skb_starved++;
 			rtw_enqueue_recvbuf(precvbuf, &precvpriv->recv_buf_pending_queue);
 			goto exit;
 		}
+		precvpriv->usb_rx_agg.skb_alloc++;
 
 		tmpaddr = (SIZE_PTR)precvbuf->pskb->data;
 		alignment = tmpaddr & (RECVBUFF_ALIGN_SZ - 1);
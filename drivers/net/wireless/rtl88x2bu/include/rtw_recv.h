@@ -313,6 +313,43 @@ using enter_critical section to protect
 #define DBG_RX_BH_TRACKING 0
 #endif
 
+#ifdef CONFIG_USB_HCI
+/*
+ * Bulk-in transfer statistics. With USB RX aggregation one bulk-in
+ * transfer carries several frames, so the length histogram is a direct
+ * measure of how deep aggregation gets.
+ * Buckets: <=2K, <=4K, <=8K, <=16K, <=32K, larger
+ */
+#define RTW_USB_RX_AGG_HIST_NUM 6
+struct rtw_usb_rx_agg_stats {
+	u32 urb_cnt;
+	u64 byte_cnt;
+	u32 max_len;
+	u32 len_hist[RTW_USB_RX_AGG_HIST_NUM];
+	u32 skb_recycled;	/* reused from free_recv_skb_queue */
+	u32 skb_alloc;		/* bulk-in skb freshly allocated */
+	u32 skb_starved;	/* no skb, recv_buf parked until one returns */
+};
+
+static inline void rtw_usb_rx_agg_account(struct rtw_usb_rx_agg_stats *st,
+					  u32 len)
+{
+	u32 idx = 0;
+
+	if (len > 2048) {
+		idx = ilog2((len - 1) >> 11) + 1;
+		if (idx >= RTW_USB_RX_AGG_HIST_NUM)
+			idx = RTW_USB_RX_AGG_HIST_NUM - 1;
+	}
+
+	st->urb_cnt++;
+	st->byte_cnt += len;
+	if (len > st->max_len)
+		st->max_len = len;
+	st->len_hist[idx]++;
+}
+#endif /* CONFIG_USB_HCI */
+
 struct recv_priv {
 	_lock	lock;
 
@@ -385,6 +422,9 @@ struct recv_priv {
 
 	struct sk_buff_head free_recv_skb_queue;
 	struct sk_buff_head rx_skb_queue;
+#ifdef CONFIG_USB_HCI
+	struct rtw_usb_rx_agg_stats usb_rx_agg;
+#endif
 #ifdef CONFIG_RTW_NAPI
 		struct sk_buff_head rx_napi_skb_queue;
 #endif 
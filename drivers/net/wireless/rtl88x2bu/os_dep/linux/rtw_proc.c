@@ -3950,6 +3950,45 @@ int proc_dump_pattern_cam(struct seq_file *m, void *v)
 }
 #endif
 
+#ifdef CONFIG_USB_HCI
+static int proc_get_usb_rx_agg(struct seq_file *m, void *v)
+{
+	struct net_device *dev = m->private;
+	_adapter *adapter = (_adapter *)rtw_netdev_priv(dev);
+	struct recv_priv *precvpriv = &adapter->recvpriv;
+	struct rtw_usb_rx_agg_stats st = precvpriv->usb_rx_agg;
+	static const char * const bucket[RTW_USB_RX_AGG_HIST_NUM] = {
+		"<=2K", "<=4K", "<=8K", "<=16K", "<=32K", ">32K"
+	};
+	int i;
+
+	RTW_PRINT_SEL(m, "rxagg_mode=%u (1:DMA, 2:USB)\n",
+		      adapter->registrypriv.usb_rxagg_mode);
+	RTW_PRINT_SEL(m, "urb=%u, bytes=%llu, avg_len=%llu, max_len=%u\n",
+		      st.urb_cnt, st.byte_cnt,
+		      st.urb_cnt ? div_u64(st.byte_cnt, st.urb_cnt) : 0,
+		      st.max_len);
+	for (i = 0; i < RTW_USB_RX_AGG_HIST_NUM; i++)
+		RTW_PRINT_SEL(m, "len %-5s: %u\n", bucket[i], st.len_hist[i]);
+	RTW_PRINT_SEL(m, "skb recycled=%u, alloc=%u, starved=%u\n",
+		      st.skb_recycled, st.skb_alloc, st.skb_starved);
+
+	return 0;
+}
+
+static ssize_t proc_set_usb_rx_agg(struct file *file, const char __user *buffer, size_t count, loff_t *pos, void *data)
+{
+	struct net_device *dev = data;
+	_adapter *adapter = (_adapter *)rtw_netdev_priv(dev);
+
+	/* any write clears the counters */
+	_rtw_memset(&adapter->recvpriv.usb_rx_agg, 0,
+		    sizeof(adapter->recvpriv.usb_rx_agg));
+
+	return count;
+}
+#endif /* CONFIG_USB_HCI */
+
 static int proc_get_napi_info(struct seq_file *m, void *v)
 {
 	struct net_device *dev = m->private;
@@ -5576,6 +5615,9 @@ const struct rtw_proc_hdl adapter_proc_hdls[] = {
 	RTW_PROC_HDL_SSEQ("trx_share_mode", proc_get_trx_share_mode, NULL),
 #endif
 	RTW_PROC_HDL_SSEQ("napi_info", proc_get_napi_info, NULL),
+#ifdef CONFIG_USB_HCI
+	RTW_PROC_HDL_SSEQ("usb_rx_agg", proc_get_usb_rx_agg, proc_set_usb_rx_agg),
+#endif
 #ifdef CONFIG_RTW_NAPI_DYNAMIC
 	RTW_PROC_HDL_SSEQ("napi_th", proc_get_napi_info, proc_set_napi_th),
 #endif /* CONFIG_RTW_NAPI_DYNAMIC */
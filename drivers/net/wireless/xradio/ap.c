@@ -48,9 +48,7 @@ int xradio_sta_add(struct ieee80211_hw *hw, struct ieee80211_vif *vif,
 	struct xradio_vif *priv = xrwl_get_vif_from_ieee80211(vif);
 	struct xradio_link_entry *entry;
 	struct sk_buff *skb;
-#ifdef AP_AGGREGATE_FW_FIX
 	struct xradio_common *hw_priv = hw->priv;
-#endif
 
 	if (priv->mode != NL80211_IFTYPE_AP) {
 		return 0;
@@ -72,8 +70,9 @@ int xradio_sta_add(struct ieee80211_hw *hw, struct ieee80211_vif *vif,
 	}
 	entry->status = XRADIO_LINK_HARD;
 	while ((skb = skb_dequeue(&entry->rx_queue)))
-		ieee80211_rx_irqsafe(priv->hw, skb);
+		xradio_rx_deliver(hw_priv, skb);
 	spin_unlock_bh(&priv->ps_state_lock);
+	xradio_rx_kick(hw_priv);
 
 #ifdef AP_AGGREGATE_FW_FIX
 	hw_priv->connected_sta_cnt++;
@@ -11,12 +11,22 @@
 
 #include <net/mac80211.h>
 #include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
 
 #include "xradio.h"
 #include "bh.h"
 #include "hwio.h"
 #include "wsm.h"
 #include "sdio.h"
+#include "main.h"
+
+/* RX skbs are preallocated outside the SDIO read path, see rx_pool */
+#define XRADIO_RX_POOL_SIZE	16
+#define XRADIO_RX_POOL_BUF	(SDIO_BLOCK_SIZE << 2)
+/* frames queued for NAPI before the bh stops to schedule it */
+#define XRADIO_RX_BATCH		8
 
 /* TODO: Verify these numbers with WSM specification. */
 #define DOWNLOAD_BLOCK_SIZE_WR	(0x1000 - 4)
@@ -39,11 +49,20 @@ typedef int (*xradio_wsm_handler)(struct xradio_common *hw_priv, u8 *data, size_
 int wsm_release_buffer_to_fw(struct xradio_vif *priv, int count);
 #endif
 static int xradio_bh(void *arg);
+static int xradio_rx_napi_poll(struct napi_struct *napi, int budget);
+static void xradio_rx_pool_refill(struct xradio_common *hw_priv, gfp_t gfp);
 
 int xradio_register_bh(struct xradio_common *hw_priv)
 {
 	int ret = 0;
 
+	skb_queue_head_init(&hw_priv->rx_napi_queue);
+	skb_queue_head_init(&hw_priv->rx_pool);
+	xradio_rx_pool_refill(hw_priv, GFP_KERNEL);
+	init_dummy_netdev(&hw_priv->napi_dev);
+	netif_napi_add(&hw_priv->napi_dev, &hw_priv->napi, xradio_rx_napi_poll);
+	napi_enable(&hw_priv->napi);
+
 	atomic_set(&hw_priv->bh_tx, 0);
 	atomic_set(&hw_priv->bh_term, 0);
 	atomic_set(&hw_priv->bh_suspend, XRADIO_BH_RESUMED);
@@ -56,6 +75,9 @@ int xradio_register_bh(struct xradio_common *hw_priv)
 	if (IS_ERR(hw_priv->bh_thread)) {
 		ret = PTR_ERR(hw_priv->bh_thread);
 		hw_priv->bh_thread = NULL;
+		napi_disable(&hw_priv->napi);
+		netif_napi_del(&hw_priv->napi);
+		skb_queue_purge(&hw_priv->rx_pool);
 	}
 
 	return ret;
@@ -73,9 +95,62 @@ void xradio_unregister_bh(struct xradio_common *hw_priv)
 #ifdef HAS_PUT_TASK_STRUCT
 	put_task_struct(thread);
 #endif
+	napi_disable(&hw_priv->napi);
+	netif_napi_del(&hw_priv->napi);
+	skb_queue_purge(&hw_priv->rx_napi_queue);
+	skb_queue_purge(&hw_priv->rx_pool);
 	dev_dbg(hw_priv->pdev, "Unregister success.\n");
 }
 
+/*
+ * SDIO transfers sleep, so reading frames stays in the bh thread, which
+ * also keeps RX and TX on the bus serialised.  What moves to NAPI is
+ * handing them to mac80211: frames read during one exchange are passed
+ * up together with ieee80211_rx_list(), instead of one
+ * ieee80211_rx_irqsafe() (and tasklet round trip) per frame.
+ */
+void xradio_rx_deliver(struct xradio_common *hw_priv, struct sk_buff *skb)
+{
+	skb_queue_tail(&hw_priv->rx_napi_queue, skb);
+}
+
+void xradio_rx_kick(struct xradio_common *hw_priv)
+{
+	if (skb_queue_empty(&hw_priv->rx_napi_queue))
+		return;
+
+	/* let the softirq run as soon as we drop back out of BH-off */
+	local_bh_disable();
+	napi_schedule(&hw_priv->napi);
+	local_bh_enable();
+}
+
+static int xradio_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct xradio_common *hw_priv = container_of(napi,
+						     struct xradio_common, napi);
+	struct sk_buff *skb;
+	LIST_HEAD(list);
+	int done = 0;
+
+	rcu_read_lock();
+	while (done < budget &&
+	       (skb = skb_dequeue(&hw_priv->rx_napi_queue))) {
+		ieee80211_rx_list(hw_priv->hw, NULL, skb, &list);
+		done++;
+	}
+	rcu_read_unlock();
+	netif_receive_skb_list(&list);
+
+	xradio_rx_pool_refill(hw_priv, GFP_ATOMIC);
+
+	if (done < budget && napi_complete_done(napi, done) &&
+	    !skb_queue_empty(&hw_priv->rx_napi_queue))
+		napi_schedule(napi);
+
+	return done;
+}
+
 void xradio_irq_handler(struct xradio_common *hw_priv)
 {
 	xradio_bh_wakeup(hw_priv);
@@ -309,11 +384,37 @@ static inline int xradio_put_resv_skb(struct xradio_common *hw_priv,
 	return 1; /* sbk not put to reserve*/
 }
 
+/* Top the pool back up from NAPI context, after frames were handed on. */
+static void xradio_rx_pool_refill(struct xradio_common *hw_priv, gfp_t gfp)
+{
+	struct sk_buff *skbs[XRADIO_RX_POOL_SIZE];
+	size_t alloc_len = XRADIO_RX_POOL_BUF + WSM_TX_EXTRA_HEADROOM + 8 + 12;
+	int i, n;
+
+	n = XRADIO_RX_POOL_SIZE - skb_queue_len(&hw_priv->rx_pool);
+	if (n <= 0)
+		return;
+
+	n = netdev_alloc_skb_bulk(NULL, alloc_len, gfp, skbs, n);
+	for (i = 0; i < n; i++) {
+		skb_reserve(skbs[i], WSM_TX_EXTRA_HEADROOM + 8 /* TKIP IV */
+				     - WSM_RX_EXTRA_HEADROOM);
+		skb_queue_tail(&hw_priv->rx_pool, skbs[i]);
+	}
+}
+
 static struct sk_buff *xradio_get_skb(struct xradio_common *hw_priv, size_t len)
 {
 	struct sk_buff *skb = NULL;
 	size_t alloc_len = (len > SDIO_BLOCK_SIZE) ? len : SDIO_BLOCK_SIZE;
 
+	if (len <= XRADIO_RX_POOL_BUF && (len > SDIO_BLOCK_SIZE ||
+	    !hw_priv->skb_cache)) {
+		skb = skb_dequeue(&hw_priv->rx_pool);
+		if (skb)
+			return skb;
+	}
+
 	/* TKIP IV + TKIP ICV and MIC - Piggyback.*/
 	alloc_len += WSM_TX_EXTRA_HEADROOM + 8 + 12- 2;
 	if (len > SDIO_BLOCK_SIZE || !hw_priv->skb_cache) {
@@ -543,6 +644,7 @@ static int xradio_bh_rx(struct xradio_common *hw_priv, u16* nextlen) {
 		dev_err(hw_priv->pdev, "firmware exception!\n");
 		wsm_handle_exception(hw_priv, &data[sizeof(*wsm)],
 				wsm_len - sizeof(*wsm));
+		hw_priv->bh_error = 1;
 		ret = -1;
 		goto out;
 	}
@@ -639,83 +741,113 @@ static void xradio_bh_tx_dump(struct device *dev, u8 *data, size_t len){
 #endif
 }
 
-static int xradio_bh_tx(struct xradio_common *hw_priv){
-	int txavailable;
-	int txburst;
+static int xradio_bh_tx_one(struct xradio_common *hw_priv, int *txburst)
+{
 	int vif_selected;
 	struct wsm_hdr *wsm;
 	size_t tx_len;
 	int ret;
 	u8 *data;
 
-	BUG_ON(hw_priv->hw_bufs_used > hw_priv->wsm_caps.numInpChBufs);
-	txavailable = hw_priv->wsm_caps.numInpChBufs - hw_priv->hw_bufs_used;
-	if (txavailable) {
-		/* Wake up the devices */
-		if (hw_priv->device_can_sleep) {
-			ret = xradio_device_wakeup(hw_priv);
-			if (WARN_ON(ret < 0)) {
-				return -1;
-			} else if (ret) {
-				hw_priv->device_can_sleep = false;
-			} else { /* Wait for "awake" interrupt */
-				dev_dbg(hw_priv->pdev,
-						"need to wait for device to wake before doing tx\n");
-				return 0;
-			}
+	/* Increase Tx buffer*/
+	wsm_alloc_tx_buffer(hw_priv);
+
+	/* Get data to send and send it. */
+	ret = wsm_get_tx(hw_priv, &data, &tx_len, txburst, &vif_selected);
+	if (ret <= 0) {
+		wsm_release_tx_buffer(hw_priv, 1);
+		if (WARN_ON(ret < 0)) {
+			dev_err(hw_priv->pdev, "wsm_get_tx=%d.\n", ret);
+			return -ENOMEM;
 		}
-		/* Increase Tx buffer*/
-		wsm_alloc_tx_buffer(hw_priv);
-
-		/* Get data to send and send it. */
-		ret = wsm_get_tx(hw_priv, &data, &tx_len, &txburst, &vif_selected);
-		if (ret <= 0) {
-			wsm_release_tx_buffer(hw_priv, 1);
-			if (WARN_ON(ret < 0)) {
-				dev_err(hw_priv->pdev, "wsm_get_tx=%d.\n", ret);
-				return -ENOMEM;
-			} else {
-				return 0;
-			}
-		} else {
-			wsm = (struct wsm_hdr *) data;
-			BUG_ON(tx_len < sizeof(*wsm));
-			BUG_ON(__le32_to_cpu(wsm->len) != tx_len);
-
-			/* Align tx length and check it. */
-			if (tx_len <= 8)
-			tx_len = 16;
-			tx_len = sdio_align_len(hw_priv, tx_len);
-
-			/* Check if not exceeding XRADIO capabilities */
-			if (tx_len > EFFECTIVE_BUF_SIZE) {
-				dev_warn(hw_priv->pdev, "Write aligned len: %zu\n", tx_len);
-			}
+		return 0;
+	}
 
-			/* Make sequence number. */
-			wsm->id &= __cpu_to_le32(~WSM_TX_SEQ(WSM_TX_SEQ_MAX));
-			wsm->id |= cpu_to_le32(WSM_TX_SEQ(hw_priv->wsm_tx_seq));
+	wsm = (struct wsm_hdr *) data;
+	BUG_ON(tx_len < sizeof(*wsm));
+	BUG_ON(__le32_to_cpu(wsm->len) != tx_len);
 
-			/* Send the data to devices. */
-			if (WARN_ON(xradio_data_write(hw_priv, data, tx_len))) {
-				wsm_release_tx_buffer(hw_priv, 1);
-				dev_err(hw_priv->pdev, "xradio_data_write failed\n");
-				return -EIO;
-			}
+	/* Align tx length and check it. */
+	if (tx_len <= 8)
+		tx_len = 16;
+	tx_len = sdio_align_len(hw_priv, tx_len);
 
-			xradio_bh_tx_dump(hw_priv->pdev, data, tx_len);
+	/* Check if not exceeding XRADIO capabilities */
+	if (tx_len > EFFECTIVE_BUF_SIZE) {
+		dev_warn(hw_priv->pdev, "Write aligned len: %zu\n", tx_len);
+	}
 
-			/* Process after data have sent. */
-			if (vif_selected != -1) {
-				hw_priv->hw_bufs_used_vif[vif_selected]++;
-			}
-			wsm_txed(hw_priv, data);
-			hw_priv->wsm_tx_seq = (hw_priv->wsm_tx_seq + 1) & WSM_TX_SEQ_MAX;
+	/* Make sequence number. */
+	wsm->id &= __cpu_to_le32(~WSM_TX_SEQ(WSM_TX_SEQ_MAX));
+	wsm->id |= cpu_to_le32(WSM_TX_SEQ(hw_priv->wsm_tx_seq));
 
-			return 1;
-		}
-	} else
+	/* Send the data to devices. */
+	if (WARN_ON(xradio_data_write(hw_priv, data, tx_len))) {
+		wsm_release_tx_buffer(hw_priv, 1);
+		dev_err(hw_priv->pdev, "xradio_data_write failed\n");
+		return -EIO;
+	}
+
+	xradio_bh_tx_dump(hw_priv->pdev, data, tx_len);
+
+	/* Process after data have sent. */
+	if (vif_selected != -1) {
+		hw_priv->hw_bufs_used_vif[vif_selected]++;
+	}
+	wsm_txed(hw_priv, data);
+	hw_priv->wsm_tx_seq = (hw_priv->wsm_tx_seq + 1) & WSM_TX_SEQ_MAX;
+
+	return 1;
+}
+
+/*
+ * Each WSM message has to go into its own firmware input buffer (the
+ * buffer id is part of the SDIO address), so frames cannot be packed
+ * into one CMD53.  What can be saved is everything around the write:
+ * keep the host claimed and keep writing while the firmware has free
+ * input buffers, instead of polling the control register for RX after
+ * every single frame.
+ */
+static int xradio_bh_tx(struct xradio_common *hw_priv){
+	int txavailable;
+	int txburst;
+	int sent = 0;
+	int ret = 0;
+
+	BUG_ON(hw_priv->hw_bufs_used > hw_priv->wsm_caps.numInpChBufs);
+	txavailable = hw_priv->wsm_caps.numInpChBufs - hw_priv->hw_bufs_used;
+	if (!txavailable)
 		return 0;
+
+	/* Wake up the devices */
+	if (hw_priv->device_can_sleep) {
+		ret = xradio_device_wakeup(hw_priv);
+		if (WARN_ON(ret < 0)) {
+			return -1;
+		} else if (ret) {
+			hw_priv->device_can_sleep = false;
+		} else { /* Wait for "awake" interrupt */
+			dev_dbg(hw_priv->pdev,
+					"need to wait for device to wake before doing tx\n");
+			return 0;
+		}
+	}
+
+	sdio_lock(hw_priv);
+	while (hw_priv->hw_bufs_used < hw_priv->wsm_caps.numInpChBufs &&
+	       !kthread_should_stop()) {
+		txburst = hw_priv->wsm_caps.numInpChBufs -
+			  hw_priv->hw_bufs_used;
+		ret = xradio_bh_tx_one(hw_priv, &txburst);
+		if (ret <= 0)
+			break;
+		sent++;
+	}
+	sdio_unlock(hw_priv);
+
+	if (ret < 0)
+		return ret;
+	return sent ? 1 : 0;
 }
 
 static int xradio_bh_exchange(struct xradio_common *hw_priv) {
@@ -740,7 +872,34 @@ static int xradio_bh_exchange(struct xradio_common *hw_priv) {
 		if (rxdone < 0) {
 			break;
 		}
+		/* don't let a long exchange sit on received frames */
+		if (skb_queue_len(&hw_priv->rx_napi_queue) >= XRADIO_RX_BATCH)
+			xradio_rx_kick(hw_priv);
 	} while ((txdone > 0 || rxdone > 0) && !kthread_should_stop());
+
+	xradio_rx_kick(hw_priv);
+	return 0;
+}
+
+/*
+ * The firmware is gone but nothing above it is broken.  Fail the command
+ * that was waiting on it and sit here while xradio_restart_work() brings
+ * the chip back; it clears bh_error once the new firmware is loaded.
+ */
+static int xradio_bh_park(struct xradio_common *hw_priv)
+{
+	long status;
+
+	dev_err(hw_priv->pdev, "bh parked on error\n");
+	wsm_cmd_abort(hw_priv);
+	xradio_restart_schedule(hw_priv);
+
+	status = wait_event_interruptible(hw_priv->bh_wq,
+			!hw_priv->bh_error || kthread_should_stop());
+	if (status < 0 || kthread_should_stop())
+		return -1;
+
+	dev_info(hw_priv->pdev, "bh resumed after firmware restart\n");
 	return 0;
 }
 
@@ -760,9 +919,13 @@ static int xradio_bh(void *arg)
 					wake = atomic_xchg(&hw_priv->bh_tx, 0);
 					term = kthread_should_stop();
 					suspend = atomic_read(&hw_priv->bh_suspend);
-					(wake || term || suspend);}), timeout);
+					(wake || term || suspend || hw_priv->bh_error);}),
+					timeout);
 
-		if (wake) {
+		if (hw_priv->bh_error && !term) {
+			if (xradio_bh_park(hw_priv) < 0)
+				break;
+		} else if (wake) {
 			if(xradio_bh_exchange(hw_priv) < 0){
 				break;
 			}
@@ -794,7 +957,7 @@ static int xradio_bh(void *arg)
 				if (pending && timeout < 0) {
 					dev_err(hw_priv->pdev, "query_txpkt_timeout:%ld!\n",
 							timeout);
-					break;
+					hw_priv->bh_error = 1;
 				}
 			} //else if (!txpending){
 			  //if (hw_priv->powersave_enabled && !hw_priv->device_can_sleep && !atomic_read(&hw_priv->recent_scan)) {
@@ -836,3 +999,72 @@ static int xradio_bh(void *arg)
 
 	return 0;
 }
+
+/*
+ * SDIO benchmark
+ *
+ * Writing "<size> <count>" to the sdio_bench debugfs file does <count>
+ * reads of <size> bytes from the firmware's shared RAM through the APB
+ * data port, each one an address write, a prefetch and a CMD53 of
+ * <size> bytes, i.e. what a register access or the firmware download
+ * costs on this host. Timing and reporting are done by the mmc core, see
+ * drivers/mmc/core/sdio_bench.c. Nothing is written to the device; the
+ * bh thread keeps running and takes the bus between transfers.
+ */
+static int xradio_sdio_bench_read(struct sdio_bench *bench, void *buf,
+                                  u32 size)
+{
+	struct xradio_common *hw_priv =
+		container_of(bench, struct xradio_common, sdio_bench);
+
+	return xradio_apb_read(hw_priv, APB_ADDR(DOWNLOAD_FIFO_OFFSET),
+	                       buf, size);
+}
+
+void xradio_sdio_bench_init(struct xradio_common *hw_priv)
+{
+	sdio_bench_init(&hw_priv->sdio_bench, xradio_sdio_bench_read,
+	                0x2000 - 4, 4);
+}
+
+static ssize_t xradio_sdio_bench_write(struct file *file,
+                                       const char __user *ubuf,
+                                       size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct xradio_common *hw_priv = s->private;
+
+	if (!hw_priv->driver_ready || hw_priv->bh_error)
+		return -EIO;
+
+	return sdio_bench_write(&hw_priv->sdio_bench, ubuf, count);
+}
+
+static int xradio_sdio_bench_show(struct seq_file *s, void *unused)
+{
+	struct xradio_common *hw_priv = s->private;
+
+	sdio_bench_show(s, &hw_priv->sdio_bench);
+	return 0;
+}
+
+static int xradio_sdio_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xradio_sdio_bench_show, inode->i_private);
+}
+
+static const struct file_operations xradio_sdio_bench_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xradio_sdio_bench_open,
+	.read		= seq_read,
+	.write		= xradio_sdio_bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void xradio_sdio_bench_debugfs_init(struct xradio_common *hw_priv)
+{
+	debugfs_create_file("sdio_bench", 0600,
+			    hw_priv->hw->wiphy->debugfsdir, hw_priv,
+			    &xradio_sdio_bench_fops);
+}
@@ -33,4 +33,8 @@ int xradio_init_resv_skb(struct xradio_common *hw_priv);
 void xradio_deinit_resv_skb(struct xradio_common *hw_priv);
 int xradio_realloc_resv_skb(struct xradio_common *hw_priv,
 							struct sk_buff *skb);
+void xradio_rx_deliver(struct xradio_common *hw_priv, struct sk_buff *skb);
+void xradio_rx_kick(struct xradio_common *hw_priv);
+void xradio_sdio_bench_init(struct xradio_common *hw_priv);
+void xradio_sdio_bench_debugfs_init(struct xradio_common *hw_priv);
 #endif /* XRADIO_BH_H */
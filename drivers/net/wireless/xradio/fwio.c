@@ -13,6 +13,8 @@
 #include <linux/vmalloc.h>
 #include <linux/sched.h>
 #include <linux/firmware.h>
+#include <linux/crc32.h>
+#include <linux/completion.h>
 
 #include "xradio.h"
 #include "fwio.h"
@@ -20,6 +22,9 @@
 #include "bh.h"
 #include "sdio.h"
 
+/* Firmware is pushed to the FIFO in bursts of this many bytes. */
+#define DOWNLOAD_BURST_SIZE	(4 * DOWNLOAD_BLOCK_SIZE)
+
 /* Macroses are local. */
 #define APB_WRITE(reg, val) \
 	do { \
@@ -63,6 +68,75 @@
 	} while (0)
 
 
+/* A firmware file requested in the background, see xradio_fw_fetch() */
+struct xradio_fw_file {
+	const struct firmware	*fw;
+	struct completion	done;
+};
+
+/*
+ * Firmware files stay cached for the lifetime of the module, so that a
+ * restart after a firmware crash does not go back to the filesystem.
+ * The CRC of the image is taken during the first download and checked
+ * on every later one. The lock is held across xradio_load_firmware().
+ */
+static struct {
+	struct mutex		lock;
+	struct xradio_fw_file	boot;
+	struct xradio_fw_file	image;
+	struct xradio_fw_file	sdd;
+	u32			image_crc;
+	bool			image_crc_valid;
+} fw_cache = {
+	.lock = __MUTEX_INITIALIZER(fw_cache.lock),
+};
+
+/*
+ * Files not cached yet are requested in the background as soon as the
+ * chip revision is known, so the filesystem reads overlap with each
+ * other and with the DPLL and wakeup waits.
+ */
+static void xradio_fw_fetch_done(const struct firmware *fw, void *context)
+{
+	struct xradio_fw_file *f = context;
+
+	f->fw = fw;
+	complete(&f->done);
+}
+
+static void xradio_fw_fetch(struct xradio_common *hw_priv,
+			    struct xradio_fw_file *f, const char *path)
+{
+	init_completion(&f->done);
+	if (f->fw ||
+	    request_firmware_nowait(THIS_MODULE, FW_ACTION_UEVENT, path,
+				    hw_priv->pdev, GFP_KERNEL, f,
+				    xradio_fw_fetch_done))
+		complete(&f->done);
+}
+
+static const struct firmware *xradio_fw_wait(struct xradio_fw_file *f)
+{
+	wait_for_completion(&f->done);
+	return f->fw;
+}
+
+static void xradio_fw_drop(struct xradio_fw_file *f)
+{
+	release_firmware(f->fw);
+	f->fw = NULL;
+}
+
+void xradio_fw_cache_release(void)
+{
+	mutex_lock(&fw_cache.lock);
+	xradio_fw_drop(&fw_cache.boot);
+	xradio_fw_drop(&fw_cache.image);
+	xradio_fw_drop(&fw_cache.sdd);
+	fw_cache.image_crc_valid = false;
+	mutex_unlock(&fw_cache.lock);
+}
+
 static int xradio_get_hw_type(u32 config_reg_val, int *major_revision)
 {
 	int hw_type  = -1;
@@ -87,27 +161,18 @@ static int xradio_get_hw_type(u32 config_reg_val, int *major_revision)
 static int xradio_parse_sdd(struct xradio_common *hw_priv, u32 *dpll)
 {
 	int ret = 0;
-	const char *sdd_path = NULL;
 	struct xradio_sdd *pElement = NULL;
 	int parsedLength = 0;
 
-	BUG_ON(hw_priv->sdd != NULL);
+	/* The file is owned by fw_cache, hw_priv->sdd only borrows it. */
+	if (WARN_ON(hw_priv->sdd))
+		return -EBUSY;
 
-	/* select and load sdd file depend on hardware version. */
-	switch (hw_priv->hw_revision) {
-	case XR819_HW_REV0:
-		sdd_path = XR819_SDD_FILE;
-		break;
-	default:
-		dev_dbg(hw_priv->pdev, "unknown hardware version.\n");
-		return ret;
-	}
-
-	ret = request_firmware(&hw_priv->sdd, sdd_path, hw_priv->pdev);
-	if (unlikely(ret)) {
+	hw_priv->sdd = xradio_fw_wait(&fw_cache.sdd);
+	if (unlikely(!hw_priv->sdd)) {
 		dev_dbg(hw_priv->pdev, "can't load sdd file %s.\n",
-				sdd_path);
-		return ret;
+				XR819_SDD_FILE);
+		return -ENOENT;
 	}
 
 	//parse SDD config.
@@ -185,23 +250,14 @@ static int xradio_parse_sdd(struct xradio_common *hw_priv, u32 *dpll)
 
 static int xradio_firmware(struct xradio_common *hw_priv)
 {
-	int ret, block, num_blocks;
+	int ret;
 	unsigned i;
 	u32 val32;
 	u32 put = 0, get = 0;
+	u32 crc = 0;
 	u8 *buf = NULL;
-	const char *fw_path;
-	const struct firmware *firmware = NULL;
+	const struct firmware *firmware;
 
-	switch (hw_priv->hw_revision) {
-	case XR819_HW_REV0:
-		fw_path = XR819_FIRMWARE;
-		break;
-	default:
-		dev_dbg(hw_priv->pdev, "invalid silicon revision %d.\n",
-				hw_priv->hw_revision);
-		return -EINVAL;
-	}
 	/* Initialize common registers */
 	APB_WRITE(DOWNLOAD_IMAGE_SIZE_REG, DOWNLOAD_ARE_YOU_HERE);
 	APB_WRITE(DOWNLOAD_PUT_REG, 0);
@@ -218,16 +274,17 @@ static int xradio_firmware(struct xradio_common *hw_priv)
 	val32 &= ~HIF_CONFIG_CPU_CLK_DIS_BIT;
 	REG_WRITE(HIF_CONFIG_REG_ID, val32);
 
-	/* Load a firmware file */
-	ret = request_firmware(&firmware, fw_path, hw_priv->pdev);
-	if (ret) {
+	/* Wait for the firmware file */
+	firmware = xradio_fw_wait(&fw_cache.image);
+	if (!firmware) {
 		dev_dbg(hw_priv->pdev, "can't load firmware file %s.\n",
-				fw_path);
+				XR819_FIRMWARE);
+		ret = -ENOENT;
 		goto error;
 	}
 	BUG_ON(!firmware->data);
 
-	buf = kmalloc(DOWNLOAD_BLOCK_SIZE, GFP_KERNEL);
+	buf = kmalloc(DOWNLOAD_BURST_SIZE, GFP_KERNEL);
 	if (!buf) {
 		dev_dbg(hw_priv->pdev, "can't allocate firmware buffer.\n");
 		ret = -ENOMEM;
@@ -247,49 +304,49 @@ static int xradio_firmware(struct xradio_common *hw_priv)
 		goto error;
 	}
 
-	/* Calculcate number of download blocks */
-	num_blocks = (firmware->size - 1) / DOWNLOAD_BLOCK_SIZE + 1;
-
 	/* Updating the length in Download Ctrl Area */
 	val32 = firmware->size; /* Explicit cast from size_t to u32 */
 	APB_WRITE(DOWNLOAD_IMAGE_SIZE_REG, val32);
 
-	/* Firmware downloading loop */
-	for (block = 0; block < num_blocks ; block++) {
+	/*
+	 * Firmware downloading loop. Bursts are a multiple of the block size
+	 * and never straddle the end of the FIFO. The bootloader is only
+	 * asked for its progress when the FIFO may be too full for the next
+	 * burst, not once per block.
+	 */
+	while (put < firmware->size) {
 		size_t tx_size;
 		size_t block_size;
 
-		/* check the download status */
-		APB_READ(DOWNLOAD_STATUS_REG, val32);
-		if (val32 != DOWNLOAD_PENDING) {
-			dev_dbg(hw_priv->pdev, "bootloader reported error %d.\n",
-					val32);
-			ret = -EIO;
-			goto error;
-		}
+		block_size = min_t(size_t, firmware->size - put,
+				   DOWNLOAD_BURST_SIZE);
+		tx_size = ALIGN(block_size, DOWNLOAD_BLOCK_SIZE);
 
-		/* loop until put - get <= 24K */
-		for (i = 0; i < 100; i++) {
-			APB_READ(DOWNLOAD_GET_REG, get);
-			if ((put - get) <= (DOWNLOAD_FIFO_SIZE - DOWNLOAD_BLOCK_SIZE))
-				break;
+		for (i = 0; put - get > DOWNLOAD_FIFO_SIZE - tx_size; i++) {
+			if (i == 100) {
+				dev_dbg(hw_priv->pdev, "Timeout waiting for FIFO.\n");
+				ret = -ETIMEDOUT;
+				goto error;
+			}
 			mdelay(i);
-		}
 
-		if ((put - get) > (DOWNLOAD_FIFO_SIZE - DOWNLOAD_BLOCK_SIZE)) {
-			dev_dbg(hw_priv->pdev, "Timeout waiting for FIFO.\n");
-			ret = -ETIMEDOUT;
-			goto error;
+			/* check the download status */
+			APB_READ(DOWNLOAD_STATUS_REG, val32);
+			if (val32 != DOWNLOAD_PENDING) {
+				dev_dbg(hw_priv->pdev, "bootloader reported error %d.\n",
+						val32);
+				ret = -EIO;
+				goto error;
+			}
+			APB_READ(DOWNLOAD_GET_REG, get);
 		}
 
-		/* calculate the block size */
-		tx_size = block_size = min((size_t)(firmware->size - put), (size_t)DOWNLOAD_BLOCK_SIZE);
 		memcpy(buf, &firmware->data[put], block_size);
+		if (block_size < tx_size)
+			memset(&buf[block_size], 0, tx_size - block_size);
 
-		if (block_size < DOWNLOAD_BLOCK_SIZE) {
-			memset(&buf[block_size], 0, DOWNLOAD_BLOCK_SIZE - block_size);
-			tx_size = DOWNLOAD_BLOCK_SIZE;
-		}
+		/* Checksum the image in the same pass that copies it out. */
+		crc = crc32_le(crc, buf, block_size);
 
 		/* send the block to sram */
 		ret = xradio_apb_write(hw_priv, APB_ADDR(DOWNLOAD_FIFO_OFFSET + (put & (DOWNLOAD_FIFO_SIZE - 1))), 
@@ -304,6 +361,18 @@ static int xradio_firmware(struct xradio_common *hw_priv)
 		APB_WRITE(DOWNLOAD_PUT_REG, put);
 	} /* End of firmware download loop */
 
+	/* A cached image that changed in memory must not be used again. */
+	if (!fw_cache.image_crc_valid) {
+		fw_cache.image_crc = crc;
+		fw_cache.image_crc_valid = true;
+	} else if (crc != fw_cache.image_crc) {
+		dev_err(hw_priv->pdev, "cached firmware image is corrupted.\n");
+		xradio_fw_drop(&fw_cache.image);
+		fw_cache.image_crc_valid = false;
+		ret = -EIO;
+		goto error;
+	}
+
 	/* Wait for the download completion */
 	for (i = 0; i < 300; i += 1 + i / 2) {
 		APB_READ(DOWNLOAD_STATUS_REG, val32);
@@ -324,27 +393,23 @@ static int xradio_firmware(struct xradio_common *hw_priv)
 error:
 	if(buf)
 		kfree(buf);
-	if (firmware) {
-		release_firmware(firmware);
-	}
 	return ret;
 }
 
 static int xradio_bootloader(struct xradio_common *hw_priv)
 {
-	const char *bl_path = XR819_BOOTLOADER;
 	u32  addr = AHB_MEMORY_ADDRESS;
-	int ret;
+	int ret = 0;
 	u32 i;
 	u32 *data;
 	const struct firmware *bootloader;
 
-	/* Load a bootloader file */
-	ret = request_firmware(&bootloader, bl_path, hw_priv->pdev);
-	if (ret) {
+	/* Wait for the bootloader file */
+	bootloader = xradio_fw_wait(&fw_cache.boot);
+	if (!bootloader) {
 		dev_dbg(hw_priv->pdev, "can't load bootloader file %s.\n",
-				bl_path);
-		goto error;
+				XR819_BOOTLOADER);
+		return -ENOENT;
 	}
 
 	/* Down bootloader. */
@@ -356,10 +421,7 @@ static int xradio_bootloader(struct xradio_common *hw_priv)
 	dev_dbg(hw_priv->pdev, "Bootloader complete\n");
 
 error:
-	if(bootloader) {
-		release_firmware(bootloader);
-	}
-	return ret;  
+	return ret;
 }
 
 bool test_retry = false;
@@ -399,11 +461,16 @@ int xradio_load_firmware(struct xradio_common *hw_priv)
 				major_revision);
 		return -ENOTSUPP;
 	}
-	
+
+	mutex_lock(&fw_cache.lock);
+	xradio_fw_fetch(hw_priv, &fw_cache.sdd, XR819_SDD_FILE);
+	xradio_fw_fetch(hw_priv, &fw_cache.boot, XR819_BOOTLOADER);
+	xradio_fw_fetch(hw_priv, &fw_cache.image, XR819_FIRMWARE);
+
 	//load sdd file, and get config from it.
 	ret = xradio_parse_sdd(hw_priv, &dpll);
 	if (ret < 0) {
-		return ret;
+		goto out;
 	}
 
 	//set dpll initial value and check.
@@ -539,22 +606,24 @@ int xradio_load_firmware(struct xradio_common *hw_priv)
 	 * not able to get an interrupt */
 	mdelay(10);
 	xradio_reg_read_32(hw_priv, HIF_CONFIG_REG_ID, &val32);
+	xradio_fw_wait(&fw_cache.boot);
+	xradio_fw_wait(&fw_cache.image);
+	mutex_unlock(&fw_cache.lock);
 	return 0;
 
 unsubscribe:
 out:
-	if (hw_priv->sdd) {
-		release_firmware(hw_priv->sdd);
-		hw_priv->sdd = NULL;
-	}
+	/* let outstanding requests land in the cache before unlocking */
+	xradio_fw_wait(&fw_cache.sdd);
+	xradio_fw_wait(&fw_cache.boot);
+	xradio_fw_wait(&fw_cache.image);
+	mutex_unlock(&fw_cache.lock);
+	hw_priv->sdd = NULL;
 	return ret;
 }
 
 int xradio_dev_deinit(struct xradio_common *hw_priv)
 {
-	if (hw_priv->sdd) {
-		release_firmware(hw_priv->sdd);
-		hw_priv->sdd = NULL;
-	}
+	hw_priv->sdd = NULL;
 	return 0;
 }
@@ -29,5 +29,6 @@ struct xradio_sdd {
 struct xradio_common;
 int xradio_load_firmware(struct xradio_common *hw_priv);
 int xradio_dev_deinit(struct xradio_common *hw_priv);
+void xradio_fw_cache_release(void);
 
 #endif
@@ -25,6 +25,11 @@
 #include "scan.h"
 #include "pm.h"
 #include "sdio.h"
+#include "main.h"
+
+/* firmware restarts allowed before we stop trying, see xradio_restart_schedule() */
+#define XRADIO_RESTART_MAX	3
+#define XRADIO_RESTART_WINDOW	(60 * HZ)
 
 /* TODO: use rates and channels from the device */
 #define RATETAB_ENT(_rate, _rateid, _flags)		\
@@ -135,6 +140,7 @@ static const struct ieee80211_ops xradio_ops = {
 	.add_interface     = xradio_add_interface,
 	.remove_interface  = xradio_remove_interface,
 	.change_interface  = xradio_change_interface,
+	.reconfig_complete = xradio_reconfig_complete,
 	.tx                = xradio_tx,
 	.hw_scan           = xradio_hw_scan,
 #ifdef ROAM_OFFLOAD
@@ -163,9 +169,7 @@ static const struct ieee80211_ops xradio_ops = {
 	/*.channel_switch	 = xradio_channel_switch,		*/
 	.remain_on_channel = xradio_remain_on_channel,
 	.cancel_remain_on_channel = xradio_cancel_remain_on_channel,
-#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0))
-	.wake_tx_queue		= ieee80211_handle_wake_tx_queue,
-#endif 	
+	.wake_tx_queue     = xradio_wake_tx_queue,
 };
 
 
@@ -212,6 +216,142 @@ static void xradio_set_ifce_comb(struct xradio_common *hw_priv,
 	hw->wiphy->n_iface_combinations = 3;
 }
 
+/* Bring a freshly loaded firmware into service, shared by probe and restart. */
+static int xradio_firmware_start(struct xradio_common *hw_priv)
+{
+	u16 ctrl_reg;
+	int if_id;
+
+	/* Set sdio blocksize. */
+	sdio_lock(hw_priv);
+	WARN_ON(sdio_set_blk_size(hw_priv,
+			SDIO_BLOCK_SIZE));
+	sdio_unlock(hw_priv);
+
+	if (wait_event_interruptible_timeout(hw_priv->wsm_startup_done,
+				hw_priv->wsm_caps.firmwareReady, 3*HZ) <= 0) {
+
+		/* TODO: Needs to find how to reset device */
+		/*       in QUEUE mode properly.           */
+		dev_dbg(hw_priv->pdev, "Firmware Startup Timeout!\n");
+		return -ETIMEDOUT;
+	}
+	dev_dbg(hw_priv->pdev, "Firmware Startup Done.\n");
+
+	/* Keep device wake up. */
+	WARN_ON(xradio_reg_write_16(hw_priv, HIF_CONTROL_REG_ID, HIF_CTRL_WUP_BIT));
+	if (xradio_reg_read_16(hw_priv,HIF_CONTROL_REG_ID, &ctrl_reg))
+		WARN_ON(xradio_reg_read_16(hw_priv,HIF_CONTROL_REG_ID, &ctrl_reg));
+	WARN_ON(!(ctrl_reg & HIF_CTRL_RDY_BIT));
+
+	/* Set device mode parameter. */
+	for (if_id = 0; if_id < xrwl_get_nr_hw_ifaces(hw_priv); if_id++) {
+		/* Set low-power mode. */
+		WARN_ON(wsm_set_operational_mode(hw_priv, &defaultoperationalmode, if_id));
+		/* Enable multi-TX confirmation */
+		WARN_ON(wsm_use_multi_tx_conf(hw_priv, true, if_id));
+	}
+
+	return 0;
+}
+
+/*
+ * Warm restart after a firmware exception or a dead bus.  Instead of
+ * tearing the whole device down, power cycle the chip, boot the firmware
+ * again from the copy cached in fwio.c and let ieee80211_restart_hw()
+ * replay interfaces, BSS state, stations and keys.  Frames the old
+ * firmware never confirmed are requeued and go out once mac80211 has
+ * finished, see xradio_reconfig_complete().
+ */
+static void xradio_restart_work(struct work_struct *work)
+{
+	struct xradio_common *hw_priv =
+		container_of(work, struct xradio_common, restart_work);
+	int i;
+	int ret;
+
+	dev_warn(hw_priv->pdev, "restarting firmware (%d)\n",
+		 hw_priv->restart_count);
+
+	/* keep data off the bus until mac80211 is done reconfiguring */
+	if (!hw_priv->restart_pending) {
+		hw_priv->restart_pending = true;
+		wsm_lock_tx_async(hw_priv);
+	}
+	xradio_reset_vifs(hw_priv);
+
+	for (i = 0; i < 4; i++)
+		xradio_queue_requeue_all(&hw_priv->tx_queue[i]);
+	hw_priv->hw_bufs_used = 0;
+	for (i = 0; i < XRWL_MAX_VIFS; i++)
+		hw_priv->hw_bufs_used_vif[i] = 0;
+	hw_priv->wsm_tx_seq = 0;
+	hw_priv->wsm_rx_seq = 0;
+	hw_priv->buf_id_tx = 0;
+	hw_priv->buf_id_rx = 0;
+	hw_priv->wsm_caps.firmwareReady = 0;
+
+	/*
+	 * If the firmware died before xradio_setup_mac() ran, the SDD file
+	 * is still borrowed from the first boot; it stays in the firmware
+	 * cache, so just let go of it.
+	 */
+	hw_priv->sdd = NULL;
+
+	ret = sdio_reset_card(hw_priv);
+	if (ret) {
+		dev_err(hw_priv->pdev, "chip reset failed (%d)\n", ret);
+		goto fail;
+	}
+	ret = xradio_load_firmware(hw_priv);
+	if (ret) {
+		dev_err(hw_priv->pdev, "firmware reload failed (%d)\n", ret);
+		goto fail;
+	}
+
+	/* the bh thread has to run for the startup indication */
+	hw_priv->bh_error = 0;
+	wake_up(&hw_priv->bh_wq);
+
+	ret = xradio_firmware_start(hw_priv);
+	if (!ret)
+		ret = tx_policy_reupload(hw_priv);
+	if (ret) {
+		dev_err(hw_priv->pdev, "firmware restart failed (%d)\n", ret);
+		hw_priv->bh_error = 1;
+		wake_up(&hw_priv->bh_wq);
+		goto fail;
+	}
+
+	ieee80211_restart_hw(hw_priv->hw);
+	return;
+
+fail:
+	/*
+	 * mac80211 will not reconfigure, so xradio_reconfig_complete() never
+	 * runs: release TX here, the dead bus drops whatever gets through.
+	 */
+	hw_priv->restart_pending = false;
+	wsm_unlock_tx(hw_priv);
+}
+
+/* Called by the parked bh thread, gives up on a crash loop. */
+void xradio_restart_schedule(struct xradio_common *hw_priv)
+{
+	if (!hw_priv->driver_ready)
+		return;
+
+	if (time_after(jiffies, hw_priv->restart_stamp + XRADIO_RESTART_WINDOW))
+		hw_priv->restart_count = 0;
+	if (hw_priv->restart_count >= XRADIO_RESTART_MAX) {
+		dev_err(hw_priv->pdev, "firmware keeps crashing, giving up\n");
+		return;
+	}
+	hw_priv->restart_count++;
+	hw_priv->restart_stamp = jiffies;
+	schedule_work(&hw_priv->restart_work);
+}
+
 struct ieee80211_hw *xradio_init_common(size_t hw_priv_data_len)
 {
 	int i;
@@ -341,11 +481,13 @@ struct ieee80211_hw *xradio_init_common(size_t hw_priv_data_len)
 	mutex_init(&hw_priv->wsm_oper_lock);
 	atomic_set(&hw_priv->tx_lock, 0);
 	sema_init(&hw_priv->tx_lock_sem, 1);
+	xradio_sdio_bench_init(hw_priv);
 
 	hw_priv->workqueue = create_singlethread_workqueue(XRADIO_WORKQUEUE);
 	sema_init(&hw_priv->scan.lock, 1);
 	sema_init(&hw_priv->scan.status_lock,1);
 	INIT_WORK(&hw_priv->scan.work, xradio_scan_work);
+	INIT_DELAYED_WORK(&hw_priv->scan.slice_work, xradio_scan_slice_work);
 #ifdef ROAM_OFFLOAD
 	INIT_WORK(&hw_priv->scan.swork, xradio_sched_scan_work);
 #endif /*ROAM_OFFLOAD*/
@@ -354,6 +496,7 @@ struct ieee80211_hw *xradio_init_common(size_t hw_priv_data_len)
 	INIT_DELAYED_WORK(&hw_priv->rem_chan_timeout, xradio_rem_chan_timeout);
 	INIT_WORK(&hw_priv->tx_policy_upload_work, tx_policy_upload_work);
 	atomic_set(&hw_priv->upload_count, 0);
+	tasklet_setup(&hw_priv->txq_tasklet, xradio_txq_tasklet);
 	memset(&hw_priv->connet_time, 0, sizeof(hw_priv->connet_time));
 
 	spin_lock_init(&hw_priv->event_queue_lock);
@@ -418,6 +561,7 @@ struct ieee80211_hw *xradio_init_common(size_t hw_priv_data_len)
 	hw_priv->query_packetID = 0;
 	atomic_set(&hw_priv->query_cnt, 0);
 	INIT_WORK(&hw_priv->query_work, wsm_query_work);
+	INIT_WORK(&hw_priv->restart_work, xradio_restart_work);
 
 #ifdef CONFIG_XRADIO_SUSPEND_POWER_OFF
 	atomic_set(&hw_priv->suspend_state, XRADIO_RESUME);
@@ -435,6 +579,7 @@ void xradio_free_common(struct ieee80211_hw *dev)
 
 	cancel_work_sync(&hw_priv->query_work);
 	del_timer_sync(&hw_priv->ba_timer);
+	tasklet_kill(&hw_priv->txq_tasklet);
 	mutex_destroy(&hw_priv->wsm_oper_lock);
 	mutex_destroy(&hw_priv->conf_mutex);
 	mutex_destroy(&hw_priv->wsm_cmd_mux);
@@ -479,6 +624,9 @@ int xradio_register_common(struct ieee80211_hw *dev)
 	}
 	dev_dbg(hw_priv->pdev, "is registered as '%s'\n",
 	           wiphy_name(dev->wiphy));
+	tx_policy_debugfs_init(hw_priv);
+	xradio_scan_debugfs_init(hw_priv);
+	xradio_sdio_bench_debugfs_init(hw_priv);
 
 	hw_priv->driver_ready = 1;
 	wake_up(&hw_priv->wsm_startup_done);
@@ -489,18 +637,19 @@ void xradio_unregister_common(struct ieee80211_hw *dev)
 {
 	struct xradio_common *hw_priv = dev->priv;
 
+	/* no firmware restarts once we are going away */
+	hw_priv->driver_ready = 0;
+	cancel_work_sync(&hw_priv->restart_work);
+
 	if (wiphy_dev(dev->wiphy)) {
 	ieee80211_unregister_hw(dev);
 		SET_IEEE80211_DEV(dev, NULL);
 	}
-	hw_priv->driver_ready = 0;
 }
 
 int xradio_core_init(struct sdio_func* func)
 {
 	int err = -ENOMEM;
-	u16 ctrl_reg;
-	int if_id;
 	struct ieee80211_hw *dev;
 	struct xradio_common *hw_priv;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
@@ -568,36 +717,9 @@ int xradio_core_init(struct sdio_func* func)
 		goto err3;
 	}
 
-	/* Set sdio blocksize. */
-	sdio_lock(hw_priv);
-	WARN_ON(sdio_set_blk_size(hw_priv,
-			SDIO_BLOCK_SIZE));
-	sdio_unlock(hw_priv);
-
-	if (wait_event_interruptible_timeout(hw_priv->wsm_startup_done,
-				hw_priv->wsm_caps.firmwareReady, 3*HZ) <= 0) {
-
-		/* TODO: Needs to find how to reset device */
-		/*       in QUEUE mode properly.           */
-		dev_dbg(hw_priv->pdev, "Firmware Startup Timeout!\n");
-		err = -ETIMEDOUT;
+	err = xradio_firmware_start(hw_priv);
+	if (err)
 		goto err4;
-	}
-	dev_dbg(hw_priv->pdev, "Firmware Startup Done.\n");
-
-	/* Keep device wake up. */
-	WARN_ON(xradio_reg_write_16(hw_priv, HIF_CONTROL_REG_ID, HIF_CTRL_WUP_BIT));
-	if (xradio_reg_read_16(hw_priv,HIF_CONTROL_REG_ID, &ctrl_reg))
-		WARN_ON(xradio_reg_read_16(hw_priv,HIF_CONTROL_REG_ID, &ctrl_reg));
-	WARN_ON(!(ctrl_reg & HIF_CTRL_RDY_BIT));
-
-	/* Set device mode parameter. */
-	for (if_id = 0; if_id < xrwl_get_nr_hw_ifaces(hw_priv); if_id++) {
-		/* Set low-power mode. */
-		WARN_ON(wsm_set_operational_mode(hw_priv, &defaultoperationalmode, if_id));
-		/* Enable multi-TX confirmation */
-		WARN_ON(wsm_use_multi_tx_conf(hw_priv, true, if_id));
-	}
 
 	/* Register wireless net device. */
 	err = xradio_register_common(dev);
@@ -3,5 +3,6 @@
 
 int xradio_core_init(struct sdio_func* func);
 void xradio_core_deinit(struct sdio_func* func);
+void xradio_restart_schedule(struct xradio_common *hw_priv);
 
 #endif
\ No newline at end of file
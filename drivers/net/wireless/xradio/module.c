@@ -3,6 +3,7 @@
 #include "xradio.h"
 #include "debug.h"
 #include "sdio.h"
+#include "fwio.h"
 
 MODULE_AUTHOR("XRadioTech");
 MODULE_DESCRIPTION("XRadioTech WLAN driver core");
@@ -21,6 +22,7 @@ static int __init xradio_core_entry(void)
 static void __exit xradio_core_exit(void)
 {
 	xradio_sdio_unregister();
+	xradio_fw_cache_release();
 }
 
 module_init(xradio_core_entry);
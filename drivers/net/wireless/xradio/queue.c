@@ -17,8 +17,10 @@
 /* private */ struct xradio_queue_item
 {
 	struct list_head	head;
+	struct list_head	link_head;
 	struct sk_buff		*skb;
 	u32			packetID;
+	u32			seq;
 	unsigned long		queue_timestamp;
 	unsigned long		xmit_timestamp;
 	struct xradio_txpriv	txpriv;
@@ -75,28 +77,64 @@ static inline u32 xradio_queue_make_packet_id(u8 queue_generation, u8 queue_id,
 		((u32)queue_generation << 28);
 }
 
-static void xradio_queue_post_gc(struct xradio_queue_stats *stats,
+/*
+ * Expired and flushed items are parked on gc_list with their skb still
+ * attached, so the destructor can run without queue->lock held. They go
+ * back to the free pool afterwards; nothing is copied or allocated.
+ */
+static void xradio_queue_post_gc(struct xradio_queue *queue,
 				 struct list_head *gc_list)
 {
+	struct xradio_queue_stats *stats = queue->stats;
 	struct xradio_queue_item *item;
 
-	while (!list_empty(gc_list)) {
-		item = list_first_entry(
-			gc_list, struct xradio_queue_item, head);
-		list_del(&item->head);
+	if (list_empty(gc_list))
+		return;
+
+	list_for_each_entry(item, gc_list, head) {
 		stats->skb_dtor(stats->hw_priv, item->skb, &item->txpriv);
-		kfree(item);
+		item->skb = NULL;
 	}
+
+	spin_lock_bh(&queue->lock);
+	list_splice_tail_init(gc_list, &queue->free_pool);
+	spin_unlock_bh(&queue->lock);
 }
 
 static void xradio_queue_register_post_gc(struct list_head *gc_list,
 				     struct xradio_queue_item *item)
 {
-	struct xradio_queue_item *gc_item;
-	gc_item = kmalloc(sizeof(struct xradio_queue_item), GFP_KERNEL);
-	BUG_ON(!gc_item);
-	memcpy(gc_item, item, sizeof(struct xradio_queue_item));
-	list_add_tail(&gc_item->head, gc_list);
+	list_del_init(&item->link_head);
+	list_move_tail(&item->head, gc_list);
+}
+
+/*
+ * Oldest queued (not pending) frame of if_id among the links in
+ * link_id_map. Every link keeps its own FIFO, so this costs one list
+ * head per active link instead of a walk over the whole AC queue,
+ * which under AP load is mostly frames for sleeping stations.
+ */
+static struct xradio_queue_item *
+__xradio_queue_get_oldest(struct xradio_queue *queue, int if_id,
+			  u32 link_id_map)
+{
+	struct xradio_queue_item *item, *oldest = NULL;
+	size_t map_capacity = queue->stats->map_capacity;
+	struct list_head *head;
+	int i;
+
+	for (i = 0; i < map_capacity; ++i) {
+		if (!(link_id_map & BIT(i)))
+			continue;
+		head = &queue->link_queue[if_id][i];
+		if (list_empty(head))
+			continue;
+		item = list_first_entry(head, struct xradio_queue_item,
+					link_head);
+		if (!oldest || (s32)(item->seq - oldest->seq) < 0)
+			oldest = item;
+	}
+	return oldest;
 }
 
 static void __xradio_queue_gc(struct xradio_queue *queue,
@@ -132,8 +170,6 @@ static void __xradio_queue_gc(struct xradio_queue *queue,
 		//	spin_unlock(&priv->vif_lock);
 		//}
 		xradio_queue_register_post_gc(head, item);
-		item->skb = NULL;
-		list_move_tail(&item->head, &queue->free_pool);
 	}
 
 	if (wakeup_stats)
@@ -170,7 +206,7 @@ static void xradio_queue_gc(unsigned long arg)
 	spin_lock_bh(&queue->lock);
 	__xradio_queue_gc(queue, &list, true);
 	spin_unlock_bh(&queue->lock);
-	xradio_queue_post_gc(queue->stats, &list);
+	xradio_queue_post_gc(queue, &list);
 }
 
 int xradio_queue_stats_init(struct xradio_queue_stats *stats,
@@ -205,7 +241,7 @@ int xradio_queue_init(struct xradio_queue *queue,
 		      size_t capacity,
 		      unsigned long ttl)
 {
-	int i;
+	int i, j;
 
 	memset(queue, 0, sizeof(*queue));
 	queue->stats = stats;
@@ -233,17 +269,27 @@ int xradio_queue_init(struct xradio_queue *queue,
 		queue->link_map_cache[i] =
 				kzalloc(sizeof(int) * stats->map_capacity,
 					GFP_KERNEL);
-		if (!queue->link_map_cache[i]) {
-			for (; i >= 0; i--)
+		queue->link_queue[i] =
+				kmalloc_array(stats->map_capacity,
+					      sizeof(struct list_head),
+					      GFP_KERNEL);
+		if (!queue->link_map_cache[i] || !queue->link_queue[i]) {
+			for (; i >= 0; i--) {
 				kfree(queue->link_map_cache[i]);
+				kfree(queue->link_queue[i]);
+			}
 			kfree(queue->pool);
 			queue->pool = NULL;
 			return -ENOMEM;
 		}
+		for (j = 0; j < stats->map_capacity; ++j)
+			INIT_LIST_HEAD(&queue->link_queue[i][j]);
 	}
 
-	for (i = 0; i < capacity; ++i)
+	for (i = 0; i < capacity; ++i) {
+		INIT_LIST_HEAD(&queue->pool[i].link_head);
 		list_add_tail(&queue->pool[i].head, &queue->free_pool);
+	}
 
 	return 0;
 }
@@ -266,8 +312,6 @@ int xradio_queue_clear(struct xradio_queue *queue, int if_id)
 		WARN_ON(!item->skb);
 		if (XRWL_ALL_IFS == if_id || item->txpriv.if_id == if_id) {
 			xradio_queue_register_post_gc(&gc_list, item);
-			item->skb = NULL;
-			list_move_tail(&item->head, &queue->free_pool);
 			cnt++;
 		}
 	}
@@ -309,7 +353,7 @@ int xradio_queue_clear(struct xradio_queue *queue, int if_id)
 	}
 	spin_unlock_bh(&queue->lock);
 	wake_up(&stats->wait_link_id_empty);
-	xradio_queue_post_gc(stats, &gc_list);
+	xradio_queue_post_gc(queue, &gc_list);
 	return 0;
 }
 
@@ -334,6 +378,8 @@ void xradio_queue_deinit(struct xradio_queue *queue)
 	for (i = 0; i < XRWL_MAX_VIFS; i++) {
 		kfree(queue->link_map_cache[i]);
 		queue->link_map_cache[i] = NULL;
+		kfree(queue->link_queue[i]);
+		queue->link_queue[i] = NULL;
 	}
 	queue->pool = NULL;
 	queue->capacity = 0;
@@ -384,6 +430,9 @@ int xradio_queue_put(struct xradio_queue *queue, struct sk_buff *skb,
 		BUG_ON(item->skb);
 
 		list_move_tail(&item->head, &queue->queue);
+		list_add_tail(&item->link_head,
+			&queue->link_queue[txpriv->if_id][txpriv->link_id]);
+		item->seq = queue->seq++;
 		item->skb = skb;
 		item->txpriv = *txpriv;
 		item->generation  = 1; /* avoid packet ID is 0.*/
@@ -452,19 +501,16 @@ int xradio_queue_get(struct xradio_queue *queue,
 	bool wakeup_stats = false;
 
 	spin_lock_bh(&queue->lock);
-	list_for_each_entry(item, &queue->queue, head) {
-		if ((item->txpriv.if_id == if_id) &&
-			(link_id_map & BIT(item->txpriv.link_id))) {
-			ret = 0;
-			break;
-		}
-	}
+	item = __xradio_queue_get_oldest(queue, if_id, link_id_map);
+	if (item)
+		ret = 0;
 
 	if (!WARN_ON(ret)) {
 		*tx = (struct wsm_tx *)item->skb->data;
 		*tx_info = IEEE80211_SKB_CB(item->skb);
 		*txpriv = &item->txpriv;
 		(*tx)->packetID = __cpu_to_le32(item->packetID);
+		list_del_init(&item->link_head);
 		list_move_tail(&item->head, &queue->pending);
 		++queue->num_pending;
 		++queue->num_pending_vif[item->txpriv.if_id];
@@ -544,6 +590,8 @@ int xradio_queue_requeue(struct xradio_queue *queue, u32 packetID, bool check)
 			queue_generation, queue_id, item_generation, item_id,
 			if_id, link_id);
 		list_move(&item->head, &queue->queue);
+		list_add(&item->link_head, &queue->link_queue[if_id]
+			 [item->txpriv.link_id]);
 #if 0
 		txrx_printk(XRADIO_DBG_ERROR, "queue_requeue queue %d, %d, %d\n",
 		queue->num_queued,
@@ -583,6 +631,9 @@ int xradio_queue_requeue_all(struct xradio_queue *queue)
 			item->generation, item - queue->pool,
 			item->txpriv.if_id, item->txpriv.raw_link_id);
 		list_move(&item->head, &queue->queue);
+		list_add(&item->link_head,
+			 &queue->link_queue[item->txpriv.if_id]
+			 [item->txpriv.link_id]);
 	}
 	spin_unlock_bh(&queue->lock);
 
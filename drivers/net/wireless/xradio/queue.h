@@ -40,8 +40,10 @@ struct xradio_queue {
 	struct list_head          queue;
 	struct list_head          free_pool;
 	struct list_head          pending;
+	struct list_head         *link_queue[XRWL_MAX_VIFS];
 	int                       tx_locked_cnt;
 	int                      *link_map_cache[XRWL_MAX_VIFS];
+	u32                       seq;
 	bool                      overfull;
 	spinlock_t                lock;
 	u8                        queue_id;
@@ -396,10 +396,10 @@ void xradio_rx_cb(struct xradio_vif *priv,
 			skb_queue_tail(&entry->rx_queue, skb);
 			dev_warn(priv->hw_priv->pdev, "***skb_queue_tail\n");
 		} else
-			ieee80211_rx_irqsafe(priv->hw, skb);
+			xradio_rx_deliver(hw_priv, skb);
 		spin_unlock_bh(&priv->ps_state_lock);
 	} else {
-		ieee80211_rx_irqsafe(priv->hw, skb);
+		xradio_rx_deliver(hw_priv, skb);
 	}
 	*skb_p = NULL;
 
@@ -10,6 +10,8 @@
  */
 
 #include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "xradio.h"
 #include "scan.h"
 #include "sta.h"
@@ -51,6 +53,36 @@ static void xradio_remove_wps_p2p_ie(struct wsm_template_frame *frame)
 	}
 }
 
+/*
+ * While any interface is associated or serving as AP, scan a few
+ * channels at a time and go back to the operating channel in between,
+ * so traffic stalls for one slice instead of the whole scan.
+ */
+static bool xradio_scan_need_slicing(struct xradio_common *hw_priv)
+{
+	struct xradio_vif *vif;
+	int i;
+
+	xradio_for_each_vif(hw_priv, vif, i) {
+		if (!vif)
+			continue;
+		if (vif->join_status == XRADIO_JOIN_STATUS_STA ||
+		    vif->join_status == XRADIO_JOIN_STATUS_AP)
+			return true;
+	}
+	return false;
+}
+
+/* TX is being released after a scan (slice), account the stall */
+static void xradio_scan_stall_end(struct xradio_common *hw_priv)
+{
+	u32 held = ktime_us_delta(ktime_get(), hw_priv->scan.stall_start);
+
+	hw_priv->scan.stats.stall_us_total += held;
+	hw_priv->scan.stats.stall_us_max =
+		max(hw_priv->scan.stats.stall_us_max, held);
+}
+
 static int xradio_scan_start(struct xradio_vif *priv, struct wsm_scan *scan)
 {
 	int ret, i;
@@ -212,8 +244,10 @@ int xradio_hw_scan(struct ieee80211_hw *hw,
 	}
 
 	wsm_vif_lock_tx(priv);
+	hw_priv->scan.stall_start = ktime_get();
 
 	BUG_ON(hw_priv->scan.req);
+	hw_priv->scan.sliced  = xradio_scan_need_slicing(hw_priv);
 	hw_priv->scan.req     = req;
 	hw_priv->scan.n_ssids = 0;
 	hw_priv->scan.status  = 0;
@@ -354,7 +388,7 @@ void xradio_scan_work(struct work_struct *work)
 		//.scanFlags = WSM_SCAN_FLAG_SPLIT_METHOD, /* TODO:COMBO */
 	};
 	bool first_run;
-	int i;
+	int i, max_ch;
 	const u32 ProbeRequestTime  = 2;
 	const u32 ChannelRemainTime = 15;
 	u32 maxChannelTime;
@@ -434,6 +468,8 @@ void xradio_scan_work(struct work_struct *work)
 
 		hw_priv->scan.req = NULL;
 		xradio_scan_restart_delayed(priv);
+		xradio_scan_stall_end(hw_priv);
+		hw_priv->scan.stats.scans++;
 		wsm_unlock_tx(hw_priv);
 		mutex_unlock(&hw_priv->conf_mutex);
 		memset(&scan_info, 0, sizeof(scan_info));
@@ -446,9 +482,12 @@ void xradio_scan_work(struct work_struct *work)
 		struct ieee80211_channel *first = *hw_priv->scan.curr;
 		bool passiveScan = first->flags & IEEE80211_CHAN_NO_IR;
 
+		max_ch = hw_priv->scan.sliced ? XRADIO_SCAN_SLICE_CHANNELS :
+		                                WSM_SCAN_MAX_NUM_OF_CHANNELS;
+
 		//verify that all channels to be scanned are same band, active/passive & power
 		for (it = hw_priv->scan.curr + 1, i = 1;
-		     it != hw_priv->scan.end && i < WSM_SCAN_MAX_NUM_OF_CHANNELS;
+		     it != hw_priv->scan.end && i < max_ch;
 		     ++it, ++i) {
 			if ((*it)->band != first->band)
 				break;
@@ -668,6 +707,45 @@ static void xradio_scan_restart_delayed(struct xradio_vif *priv)
 	}
 }
 
+/*
+ * Between two slices release TX for XRADIO_SCAN_SLICE_DWELL, so queued
+ * frames go out on the operating channel. slice_work takes TX again,
+ * which flushes what the firmware still holds, and starts the next one.
+ */
+static bool xradio_scan_slice_pause(struct xradio_common *hw_priv)
+{
+	if (!hw_priv->scan.sliced || !hw_priv->scan.req ||
+	    hw_priv->scan.curr == hw_priv->scan.end ||
+	    hw_priv->scan.status < 0)
+		return false;
+
+	mutex_lock(&hw_priv->conf_mutex);
+	xradio_scan_stall_end(hw_priv);
+	hw_priv->scan.stats.slices++;
+	mutex_unlock(&hw_priv->conf_mutex);
+
+	wsm_unlock_tx(hw_priv);
+	queue_delayed_work(hw_priv->workqueue, &hw_priv->scan.slice_work,
+	                   XRADIO_SCAN_SLICE_DWELL);
+	return true;
+}
+
+void xradio_scan_slice_work(struct work_struct *work)
+{
+	struct xradio_common *hw_priv =
+		container_of(work, struct xradio_common, scan.slice_work.work);
+	struct xradio_vif *priv;
+
+	priv = __xrwl_hwpriv_to_vifpriv(hw_priv, hw_priv->scan.if_id);
+	if (priv)
+		wsm_vif_lock_tx(priv);
+	else
+		wsm_lock_tx(hw_priv);
+	hw_priv->scan.stall_start = ktime_get();
+
+	xradio_scan_work(&hw_priv->scan.work);
+}
+
 static void xradio_scan_complete(struct xradio_common *hw_priv, int if_id)
 {
 	struct xradio_vif *priv;
@@ -687,7 +765,7 @@ static void xradio_scan_complete(struct xradio_common *hw_priv, int if_id)
 		hw_priv->scan.direct_probe = 0;
 		up(&hw_priv->scan.lock);
 		wsm_unlock_tx(hw_priv);
-	} else {
+	} else if (!xradio_scan_slice_pause(hw_priv)) {
 		xradio_scan_work(&hw_priv->scan.work);
 	}
 }
@@ -897,3 +975,27 @@ void xradio_probe_work(struct work_struct *work)
 
 	return;
 }
+
+static int xradio_scan_stats_show(struct seq_file *s, void *unused)
+{
+	struct xradio_common *hw_priv = s->private;
+	struct xradio_scan_stats st;
+
+	mutex_lock(&hw_priv->conf_mutex);
+	st = hw_priv->scan.stats;
+	mutex_unlock(&hw_priv->conf_mutex);
+
+	seq_printf(s, "scans:          %u\n", st.scans);
+	seq_printf(s, "slices:         %u\n", st.slices);
+	seq_printf(s, "stall_us_total: %llu\n", st.stall_us_total);
+	seq_printf(s, "stall_us_max:   %u\n", st.stall_us_max);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(xradio_scan_stats);
+
+void xradio_scan_debugfs_init(struct xradio_common *hw_priv)
+{
+	debugfs_create_file("scan", 0444,
+			    hw_priv->hw->wiphy->debugfsdir, hw_priv,
+			    &xradio_scan_stats_fops);
+}
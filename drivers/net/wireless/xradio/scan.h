@@ -14,6 +14,7 @@
 #define SCAN_H_INCLUDED
 
 #include <linux/semaphore.h>
+#include <linux/ktime.h>
 #include "wsm.h"
 
 /* external */ struct sk_buff;
@@ -24,6 +25,17 @@
 
 #define SCAN_MAX_DELAY      (3*HZ)   //3s, add by yangfh for connect
 
+/* Sliced scan: channels per slice and time back on the operating channel */
+#define XRADIO_SCAN_SLICE_CHANNELS	2
+#define XRADIO_SCAN_SLICE_DWELL		(HZ / 20)
+
+struct xradio_scan_stats {
+	u32 scans;
+	u32 slices;		/* returns to the operating channel */
+	u64 stall_us_total;	/* TX held locked for scanning */
+	u32 stall_us_max;
+};
+
 struct xradio_scan {
 	struct semaphore lock;
 	struct work_struct work;
@@ -47,6 +59,11 @@ struct xradio_scan {
 	struct delayed_work probe_work;
 	int direct_probe;
 	u8 if_id;
+	/* Sliced scanning while associated or serving as AP */
+	struct delayed_work slice_work;
+	bool sliced;
+	ktime_t stall_start;
+	struct xradio_scan_stats stats;
 };
 
 int xradio_hw_scan(struct ieee80211_hw *hw, struct ieee80211_vif *vif,
@@ -60,6 +77,7 @@ void xradio_hw_sched_scan_stop(struct xradio_common *priv);
 void xradio_sched_scan_work(struct work_struct *work);
 #endif /*ROAM_OFFLOAD*/
 void xradio_scan_work(struct work_struct *work);
+void xradio_scan_slice_work(struct work_struct *work);
 void xradio_scan_timeout(struct work_struct *work);
 void xradio_scan_complete_cb(struct xradio_common *priv,
                              struct wsm_scan_complete *arg);
@@ -68,4 +86,6 @@ void xradio_scan_complete_cb(struct xradio_common *priv,
 /* Raw probe requests TX workaround					*/
 void xradio_probe_work(struct work_struct *work);
 
+void xradio_scan_debugfs_init(struct xradio_common *hw_priv);
+
 #endif
@@ -121,6 +121,31 @@ static int sdio_enableint(struct sdio_func* func)
 	return ret;
 }
 
+/*
+ * Power cycle the chip back into its bootloader after a firmware crash.
+ * With only our function on the card the MMC core resets it in place,
+ * so the sdio_func and everything hanging off it stay valid.
+ */
+int sdio_reset_card(struct xradio_common *self)
+{
+	struct sdio_func *func = self->sdio_func;
+	int ret;
+
+	sdio_claim_host(func);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0))
+	ret = mmc_hw_reset(func->card);
+#else
+	ret = mmc_hw_reset(func->card->host);
+#endif
+	if (!ret)
+		ret = sdio_enable_func(func);
+	sdio_release_host(func);
+	if (ret)
+		return ret > 0 ? -ENODEV : ret;
+
+	return sdio_enableint(func);
+}
+
 int sdio_pm(struct xradio_common *self, bool  suspend)
 {
 	int ret = 0;
@@ -244,6 +269,8 @@ static struct sdio_driver sdio_driver = {
 	.drv = {
 			.owner = THIS_MODULE,
 			.pm = &sdio_pm_ops,
+			/* firmware download takes a while, don't hold up boot */
+			.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	}
 };
 
@@ -10,6 +10,7 @@ int sdio_data_read(struct xradio_common *self, unsigned int addr, void *dst,
 int sdio_data_write(struct xradio_common *self, unsigned int addr, const void *src,
 		int count);
 int sdio_pm(struct xradio_common *self, bool  suspend);
+int sdio_reset_card(struct xradio_common *self);
 
 int xradio_sdio_register(void);
 void xradio_sdio_unregister(void);
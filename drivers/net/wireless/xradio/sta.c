@@ -173,6 +173,71 @@ void xradio_stop(struct ieee80211_hw *dev)
 	mutex_unlock(&hw_priv->conf_mutex);
 }
 
+void xradio_reconfig_complete(struct ieee80211_hw *dev,
+			      enum ieee80211_reconfig_type reconfig_type)
+{
+	struct xradio_common *hw_priv = dev->priv;
+
+	if (reconfig_type != IEEE80211_RECONFIG_TYPE_RESTART ||
+	    !hw_priv->restart_pending)
+		return;
+
+	/* mac80211 has replayed everything, release the requeued frames */
+	hw_priv->restart_pending = false;
+	wsm_unlock_tx(hw_priv);
+	dev_info(hw_priv->pdev, "firmware restart complete\n");
+}
+
+/*
+ * Firmware restart: the new firmware knows no interfaces, keys or
+ * stations.  Forget ours without talking to it, ieee80211_restart_hw()
+ * adds everything back through the usual callbacks.
+ */
+void xradio_reset_vifs(struct xradio_common *hw_priv)
+{
+	struct xradio_vif *priv;
+	int i;
+
+	while (down_trylock(&hw_priv->scan.lock)) {
+		/* Scan is in progress. Force it to stop. */
+		hw_priv->scan.req = NULL;
+		schedule();
+	}
+	up(&hw_priv->scan.lock);
+
+	cancel_delayed_work_sync(&hw_priv->scan.probe_work);
+	cancel_delayed_work_sync(&hw_priv->scan.timeout);
+	flush_workqueue(hw_priv->workqueue);
+	del_timer_sync(&hw_priv->ba_timer);
+
+	mutex_lock(&hw_priv->conf_mutex);
+	xradio_for_each_vif(hw_priv, priv, i) {
+		if (!priv)
+			continue;
+		atomic_set(&priv->enabled, 0);
+		if (atomic_xchg(&priv->delayed_unjoin, 0))
+			wsm_unlock_tx(hw_priv);
+		cancel_work_sync(&priv->unjoin_work);
+		cancel_delayed_work_sync(&priv->join_timeout);
+		cancel_delayed_work_sync(&priv->bss_loss_work);
+		cancel_delayed_work_sync(&priv->connection_loss_work);
+		cancel_delayed_work_sync(&priv->link_id_gc_work);
+		cancel_delayed_work_sync(&priv->set_cts_work);
+		cancel_delayed_work_sync(&priv->pending_offchanneltx_work);
+		del_timer_sync(&priv->mcast_timeout);
+
+		spin_lock(&hw_priv->vif_list_lock);
+		hw_priv->vif_list[i] = NULL;
+		hw_priv->if_id_slot &= ~BIT(i);
+		atomic_dec(&hw_priv->num_vifs);
+		spin_unlock(&hw_priv->vif_list_lock);
+		memset(priv, 0, sizeof(struct xradio_vif));
+	}
+	xradio_free_keys(hw_priv);
+	hw_priv->is_go_thru_go_neg = false;
+	mutex_unlock(&hw_priv->conf_mutex);
+}
+
 int xradio_add_interface(struct ieee80211_hw *dev,
 			 struct ieee80211_vif *vif)
 {
@@ -1259,8 +1324,7 @@ int xradio_setup_mac(struct xradio_common *hw_priv)
 			ret |= WARN_ON(wsm_configuration(hw_priv, &cfg,
 				       if_id));
 		}
-		/* wsm_configuration only once, so release it */
-		release_firmware(hw_priv->sdd);
+		/* wsm_configuration only once, the file stays cached in fwio.c */
 		hw_priv->sdd = NULL;
 	}
 
@@ -38,6 +38,8 @@ int xradio_change_interface(struct ieee80211_hw *dev,
                             struct ieee80211_vif *vif,
                             enum nl80211_iftype new_type,
                             bool p2p);
+void xradio_reconfig_complete(struct ieee80211_hw *dev,
+                              enum ieee80211_reconfig_type reconfig_type);
 int xradio_config(struct ieee80211_hw *dev, u32 changed);
 int xradio_change_interface(struct ieee80211_hw *dev,
                             struct ieee80211_vif *vif,
@@ -106,6 +108,7 @@ void xradio_tx_failure_work(struct work_struct *work);
 /* Internal API								*/
 
 int xradio_setup_mac(struct xradio_common *hw_priv);
+void xradio_reset_vifs(struct xradio_common *hw_priv);
 void xradio_join_work(struct work_struct *work);
 void xradio_join_timeout(struct work_struct *work);
 void xradio_unjoin_work(struct work_struct *work);
@@ -12,6 +12,8 @@
 #include <net/mac80211.h>
 #include <linux/etherdevice.h>
 #include <linux/skbuff.h>
+#include <linux/jhash.h>
+#include <linux/debugfs.h>
 
 #include "xradio.h"
 #include "wsm.h"
@@ -176,21 +178,23 @@ static inline bool tx_policy_is_equal(const struct tx_policy *wanted,
 	return !memcmp(wanted->raw, cached->raw, 12);
 }
 
+static inline struct hlist_head *
+tx_policy_bucket(struct tx_policy_cache *cache, u32 hash)
+{
+	return &cache->hash[hash & (ARRAY_SIZE(cache->hash) - 1)];
+}
+
 static int tx_policy_find(struct tx_policy_cache *cache,
 				const struct tx_policy *wanted)
 {
-	/* O(n) complexity. Not so good, but there's only 8 entries in
-	 * the cache.
-	 * Also lru helps to reduce search time. */
+	/* Every entry holding a policy, used or free, is hashed, so a
+	 * lookup only compares against entries with the same hash. */
 	struct tx_policy_cache_entry *it;
-	/* Search for policy in "used" list */
-	list_for_each_entry(it, &cache->used, link) {
-		if (tx_policy_is_equal(wanted, &it->policy))
-			return it - cache->cache;
-	}
-	/* Then - in "free list" */
-	list_for_each_entry(it, &cache->free, link) {
-		if (tx_policy_is_equal(wanted, &it->policy))
+
+	hlist_for_each_entry(it, tx_policy_bucket(cache, wanted->hash),
+			     hnode) {
+		if (it->policy.hash == wanted->hash &&
+		    tx_policy_is_equal(wanted, &it->policy))
 			return it - cache->cache;
 	}
 	return -1;
@@ -226,8 +230,10 @@ void tx_policy_init(struct xradio_common *hw_priv)
 	INIT_LIST_HEAD(&cache->used);
 	INIT_LIST_HEAD(&cache->free);
 
-	for (i = 0; i < TX_POLICY_CACHE_SIZE; ++i)
+	for (i = 0; i < TX_POLICY_CACHE_SIZE; ++i) {
+		INIT_HLIST_NODE(&cache->cache[i].hnode);
 		list_add(&cache->cache[i].link, &cache->free);
+	}
 }
 
 static int tx_policy_get(struct xradio_common *hw_priv,
@@ -249,12 +255,14 @@ static int tx_policy_get(struct xradio_common *hw_priv,
 		txrx_printk(XRADIO_DBG_NIY, "[TX policy] robust rate=%d\n", rate);
 	} else
 		tx_policy_build(hw_priv, &wanted, rates, IEEE80211_TX_MAX_RATES);
+	wanted.hash = jhash(wanted.raw, sizeof(wanted.raw), 0);
 
 	spin_lock_bh(&cache->lock);
 	idx = tx_policy_find(cache, &wanted);
 	if (idx >= 0) {
 		txrx_printk(XRADIO_DBG_MSG, "[TX policy] Used TX policy: %d\n",
 					idx);
+		cache->stats.hits++;
 		*renew = false;
 	} else {
 		struct tx_policy_cache_entry *entry;
@@ -266,9 +274,13 @@ static int tx_policy_get(struct xradio_common *hw_priv,
 		/* If policy is not found create a new one
 		 * using the oldest entry in "free" list */
 		*renew = true;
+		cache->stats.misses++;
 		entry = list_entry(cache->free.prev,
 			struct tx_policy_cache_entry, link);
 		entry->policy = wanted;
+		hlist_del_init(&entry->hnode);
+		hlist_add_head(&entry->hnode,
+			       tx_policy_bucket(cache, wanted.hash));
 		idx = entry - cache->cache;
 		txrx_printk(XRADIO_DBG_MSG, "[TX policy] New TX policy: %d\n",
 					idx);
@@ -348,6 +360,8 @@ static int tx_policy_upload(struct xradio_common *hw_priv)
 			++arg.hdr.numTxRatePolicies;
 		}
 	}
+	cache->stats.uploads++;
+	cache->stats.uploaded += arg.hdr.numTxRatePolicies;
 	spin_unlock_bh(&cache->lock);
 	atomic_set(&hw_priv->upload_count, 0);
 	
@@ -358,13 +372,67 @@ static int tx_policy_upload(struct xradio_common *hw_priv)
 	return wsm_set_tx_rate_retry_policy(hw_priv, &arg, if_id);
 }
 
+/* A restarted firmware has an empty policy table, send it ours again. */
+int tx_policy_reupload(struct xradio_common *hw_priv)
+{
+	struct tx_policy_cache *cache = &hw_priv->tx_policy_cache;
+	int i;
+
+	spin_lock_bh(&cache->lock);
+	for (i = 0; i < TX_POLICY_CACHE_SIZE; ++i)
+		cache->cache[i].policy.uploaded = 0;
+	spin_unlock_bh(&cache->lock);
+
+	return tx_policy_upload(hw_priv);
+}
+
 void tx_policy_upload_work(struct work_struct *work)
 {
 	struct xradio_common *hw_priv =
 		container_of(work, struct xradio_common, tx_policy_upload_work);
+	struct tx_policy_cache *cache = &hw_priv->tx_policy_cache;
+	u32 held;
 
 	WARN_ON(tx_policy_upload(hw_priv));
 	wsm_unlock_tx(hw_priv);
+
+	held = ktime_us_delta(ktime_get(), cache->lock_start);
+	spin_lock_bh(&cache->lock);
+	cache->stats.lock_us_total += held;
+	cache->stats.lock_us_max = max(cache->stats.lock_us_max, held);
+	spin_unlock_bh(&cache->lock);
+}
+
+static int tx_policy_stats_show(struct seq_file *s, void *unused)
+{
+	struct xradio_common *hw_priv = s->private;
+	struct tx_policy_cache *cache = &hw_priv->tx_policy_cache;
+	struct tx_policy_cache_stats st;
+	int used = 0;
+	struct tx_policy_cache_entry *it;
+
+	spin_lock_bh(&cache->lock);
+	st = cache->stats;
+	list_for_each_entry(it, &cache->used, link)
+		used++;
+	spin_unlock_bh(&cache->lock);
+
+	seq_printf(s, "used:          %d/%d\n", used, TX_POLICY_CACHE_SIZE);
+	seq_printf(s, "hits:          %u\n", st.hits);
+	seq_printf(s, "misses:        %u\n", st.misses);
+	seq_printf(s, "uploads:       %u\n", st.uploads);
+	seq_printf(s, "uploaded:      %u\n", st.uploaded);
+	seq_printf(s, "lock_us_total: %llu\n", st.lock_us_total);
+	seq_printf(s, "lock_us_max:   %u\n", st.lock_us_max);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tx_policy_stats);
+
+void tx_policy_debugfs_init(struct xradio_common *hw_priv)
+{
+	debugfs_create_file("tx_policy", 0444,
+			    hw_priv->hw->wiphy->debugfsdir, hw_priv,
+			    &tx_policy_stats_fops);
 }
 
 /* ******************************************************************** */
@@ -761,6 +829,7 @@ xradio_tx_h_rate_policy(struct xradio_common *hw_priv, struct xradio_txinfo *t,
 		/* xradio_tx_queues_lock(priv); */
 		/* Definetly better. TODO. */
 		if (atomic_add_return(1, &hw_priv->upload_count) == 1) {
+			hw_priv->tx_policy_cache.lock_start = ktime_get();
 			wsm_lock_tx_async(hw_priv);
 			if (queue_work(hw_priv->workqueue,
 				  &hw_priv->tx_policy_upload_work) <= 0) {
@@ -1031,6 +1100,72 @@ drop:
 	return;
 }
 
+/*
+ * mac80211 TXQ scheduling. The driver keeps at most XRADIO_TXQ_LIMIT
+ * frames per AC in its own queues, so a slow station cannot fill them up
+ * and hold everybody else up. mac80211 picks which station goes next
+ * (airtime fairness), and the pull is restarted from TX confirm.
+ * Scheduling rounds must not overlap, so they all run from one tasklet.
+ */
+static inline bool xradio_txq_has_room(struct xradio_common *hw_priv, int ac)
+{
+	return READ_ONCE(hw_priv->tx_queue[ac].num_queued) < XRADIO_TXQ_LIMIT;
+}
+
+static void xradio_txq_schedule(struct xradio_common *hw_priv, int ac)
+{
+	struct ieee80211_hw *hw = hw_priv->hw;
+	struct ieee80211_tx_control control = {};
+	struct ieee80211_txq *txq;
+	struct sk_buff *skb;
+
+	ieee80211_txq_schedule_start(hw, ac);
+	while (xradio_txq_has_room(hw_priv, ac) &&
+	       (txq = ieee80211_next_txq(hw, ac))) {
+		while (xradio_txq_has_room(hw_priv, ac) &&
+		       (skb = ieee80211_tx_dequeue(hw, txq))) {
+			control.sta = txq->sta;
+			xradio_tx(hw, &control, skb);
+		}
+		ieee80211_return_txq(hw, txq, false);
+	}
+	ieee80211_txq_schedule_end(hw, ac);
+}
+
+void xradio_txq_tasklet(struct tasklet_struct *t)
+{
+	struct xradio_common *hw_priv = from_tasklet(hw_priv, t, txq_tasklet);
+	int ac;
+
+	for (ac = 0; ac < AC_QUEUE_NUM; ++ac)
+		xradio_txq_schedule(hw_priv, ac);
+}
+
+void xradio_wake_tx_queue(struct ieee80211_hw *dev,
+			  struct ieee80211_txq *txq)
+{
+	struct xradio_common *hw_priv = dev->priv;
+
+	tasklet_schedule(&hw_priv->txq_tasklet);
+}
+
+/* mediaDelay is the time the frame spent on the air, retries included */
+static void xradio_tx_register_airtime(struct xradio_vif *priv,
+				       struct ieee80211_hdr *frame,
+				       u8 tid, u32 airtime)
+{
+	struct ieee80211_sta *sta;
+
+	if (!airtime || is_multicast_ether_addr(frame->addr1))
+		return;
+
+	rcu_read_lock();
+	sta = ieee80211_find_sta(priv->vif, frame->addr1);
+	if (sta)
+		ieee80211_sta_register_airtime(sta, tid, airtime, 0);
+	rcu_read_unlock();
+}
+
 void xradio_tx_confirm_cb(struct xradio_common *hw_priv,
 			  struct wsm_tx_confirm *arg)
 {
@@ -1145,6 +1280,8 @@ void xradio_tx_confirm_cb(struct xradio_common *hw_priv,
 			if (tx_count)
 				++tx_count;
 		}
+		xradio_tx_register_airtime(priv, frame, txpriv->tid,
+					   arg->mediaDelay);
 		spin_unlock(&priv->vif_lock);
 
 		tx->status.ampdu_len = 1;
@@ -1220,6 +1357,8 @@ rate_table_full:
 		
 
 		xradio_queue_remove(queue, arg->packetID);
+		if (xradio_txq_has_room(hw_priv, queue_id))
+			tasklet_schedule(&hw_priv->txq_tasklet);
 	}
 }
 
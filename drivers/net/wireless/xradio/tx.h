@@ -13,6 +13,7 @@
 #define XRADIO_TXRX_H
 
 #include <linux/list.h>
+#include <linux/ktime.h>
 
 /* extern */ struct ieee80211_hw;
 /* extern */ struct sk_buff;
@@ -27,6 +28,7 @@ struct tx_policy {
 		__le32 tbl[3];
 		u8 raw[12];
 	};
+	u32 hash;		/* jhash of raw[] */
 	u8  usage_count;	/* --// -- */
 	u8  retry_count;	/* --// -- */
 	u8  uploaded;
@@ -35,14 +37,28 @@ struct tx_policy {
 struct tx_policy_cache_entry {
 	struct tx_policy policy;
 	struct list_head link;
+	struct hlist_node hnode;
+};
+
+struct tx_policy_cache_stats {
+	u32 hits;
+	u32 misses;
+	u32 uploads;		/* upload work runs */
+	u32 uploaded;		/* policies sent to the device */
+	u64 lock_us_total;	/* TX held locked for uploads */
+	u32 lock_us_max;
 };
 
 #define TX_POLICY_CACHE_SIZE	(8)
+#define TX_POLICY_HASH_BITS	(4)
 struct tx_policy_cache {
 	struct tx_policy_cache_entry cache[TX_POLICY_CACHE_SIZE];
+	struct hlist_head hash[1 << TX_POLICY_HASH_BITS];
 	struct list_head used;
 	struct list_head free;
 	spinlock_t lock;
+	ktime_t lock_start;
+	struct tx_policy_cache_stats stats;
 };
 
 /* ******************************************************************** */
@@ -54,6 +70,8 @@ struct tx_policy_cache {
  */
 void tx_policy_init(struct xradio_common *hw_priv);
 void tx_policy_upload_work(struct work_struct *work);
+int tx_policy_reupload(struct xradio_common *hw_priv);
+void tx_policy_debugfs_init(struct xradio_common *hw_priv);
 
 /* ******************************************************************** */
 /* TX implementation							*/
@@ -61,6 +79,13 @@ void tx_policy_upload_work(struct work_struct *work);
 u32 xradio_rate_mask_to_wsm(struct xradio_common *hw_priv,
 			       u32 rates);
 void xradio_tx(struct ieee80211_hw *dev, struct ieee80211_tx_control *control, struct sk_buff *skb);
+
+/* Frames per AC the driver takes from mac80211 before leaving the rest
+ * in the TXQs, where fq_codel and airtime fairness can see them. */
+#define XRADIO_TXQ_LIMIT	(16)
+void xradio_wake_tx_queue(struct ieee80211_hw *dev,
+			  struct ieee80211_txq *txq);
+void xradio_txq_tasklet(struct tasklet_struct *t);
 void xradio_skb_dtor(struct xradio_common *hw_priv,
 		     struct sk_buff *skb,
 		     const struct xradio_txpriv *txpriv);
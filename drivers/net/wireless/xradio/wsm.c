@@ -1805,6 +1805,18 @@ int wsm_cmd_send(struct xradio_common *hw_priv,
 	return ret;
 }
 
+/* Fail the command in flight, its confirm is never coming. */
+void wsm_cmd_abort(struct xradio_common *hw_priv)
+{
+	spin_lock(&hw_priv->wsm_cmd.lock);
+	hw_priv->wsm_cmd.ptr = NULL;
+	hw_priv->wsm_cmd.arg = NULL;
+	hw_priv->wsm_cmd.ret = -ETIMEDOUT;
+	hw_priv->wsm_cmd.done = 1;
+	spin_unlock(&hw_priv->wsm_cmd.lock);
+	wake_up(&hw_priv->wsm_cmd_wq);
+}
+
 /* ******************************************************************** */
 /* WSM TX port control							*/
 
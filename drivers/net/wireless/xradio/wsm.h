@@ -2294,6 +2294,7 @@ void wsm_unlock_tx(struct xradio_common *hw_priv);
 /* WSM / BH API								*/
 
 int wsm_handle_exception(struct xradio_common *hw_priv, u8 * data, size_t len);
+void wsm_cmd_abort(struct xradio_common *hw_priv);
 int wsm_handle_rx(struct xradio_common *hw_priv, int id, struct wsm_hdr *wsm,
 		  struct sk_buff **skb_p);
 void wms_send_deauth_to_self(struct xradio_common *hw_priv, struct xradio_vif *priv);
@@ -18,6 +18,7 @@
 #include <linux/workqueue.h>
 #include <linux/sched.h>
 #include <linux/atomic.h>
+#include <linux/mmc/sdio_bench.h>
 #include <net/mac80211.h>
 
 //Macroses for Driver parameters.
@@ -218,6 +219,21 @@ struct xradio_common {
 	wait_queue_head_t		bh_wq;
 	wait_queue_head_t		bh_evt_wq;
 
+	/* Firmware restart after bh_error, see xradio_restart_work() */
+	struct work_struct		restart_work;
+	bool				restart_pending;
+	int				restart_count;
+	unsigned long			restart_stamp;
+
+	/* RX delivery to mac80211, see xradio_rx_napi_poll() */
+	struct net_device		napi_dev;
+	struct napi_struct		napi;
+	struct sk_buff_head		rx_napi_queue;
+	struct sk_buff_head		rx_pool;
+
+	/* debugfs SDIO benchmark, see bh.c */
+	struct sdio_bench		sdio_bench;
+
 
 	int				buf_id_tx;	/* byte */
 	int				buf_id_rx;	/* byte */
@@ -270,6 +286,9 @@ struct xradio_common {
 	struct work_struct tx_policy_upload_work;
 	atomic_t upload_count;
 
+	/* pulls frames from the mac80211 TXQs, see xradio_txq_tasklet() */
+	struct tasklet_struct txq_tasklet;
+
 	/* cryptographic engine information */
 
 	/* bit field of glowing LEDs */
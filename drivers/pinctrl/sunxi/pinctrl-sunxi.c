@@ -960,6 +960,82 @@ static void sunxi_pinctrl_gpio_set(struct gpio_chip *chip,
 	raw_spin_unlock_irqrestore(&pctl->lock, flags);
 }
 
+/* Lines of one bank in a gpiolib bitmap, banks never straddle a long. */
+static u32 sunxi_pinctrl_bank_bits(const unsigned long *bitmap, u32 bank)
+{
+	u32 first = bank * PINS_PER_BANK;
+
+	return bitmap[first / BITS_PER_LONG] >> (first % BITS_PER_LONG);
+}
+
+static int sunxi_pinctrl_gpio_get_multiple(struct gpio_chip *chip,
+					   unsigned long *mask,
+					   unsigned long *bits)
+{
+	struct sunxi_pinctrl *pctl = gpiochip_get_data(chip);
+	u32 nbanks = DIV_ROUND_UP(chip->ngpio, PINS_PER_BANK);
+	u32 bank, reg, shift, dmask, want, val, first;
+	unsigned long *word;
+	unsigned int offset;
+
+	/* IRQ lines have to be remuxed for reading, one at a time */
+	if (pctl->desc->irq_read_needs_mux) {
+		for_each_set_bit(offset, mask, chip->ngpio)
+			__assign_bit(offset, bits,
+				     sunxi_pinctrl_gpio_get(chip, offset));
+		return 0;
+	}
+
+	for (bank = 0; bank < nbanks; bank++) {
+		want = sunxi_pinctrl_bank_bits(mask, bank);
+		if (!want)
+			continue;
+
+		sunxi_data_reg(pctl, bank * PINS_PER_BANK, &reg, &shift, &dmask);
+		val = readl(pctl->membase + reg) & want;
+
+		first = bank * PINS_PER_BANK;
+		word = &bits[first / BITS_PER_LONG];
+		*word &= ~((unsigned long)want << (first % BITS_PER_LONG));
+		*word |= (unsigned long)val << (first % BITS_PER_LONG);
+	}
+
+	return 0;
+}
+
+static void sunxi_pinctrl_gpio_set_multiple(struct gpio_chip *chip,
+					    unsigned long *mask,
+					    unsigned long *bits)
+{
+	struct sunxi_pinctrl *pctl = gpiochip_get_data(chip);
+	u32 nbanks = DIV_ROUND_UP(chip->ngpio, PINS_PER_BANK);
+	u32 bank, reg, shift, dmask, want, set, val;
+	unsigned long flags;
+
+	for (bank = 0; bank < nbanks; bank++) {
+		want = sunxi_pinctrl_bank_bits(mask, bank);
+		if (!want)
+			continue;
+
+		set = sunxi_pinctrl_bank_bits(bits, bank) & want;
+		sunxi_data_reg(pctl, bank * PINS_PER_BANK, &reg, &shift, &dmask);
+
+		/*
+		 * Owning every line of the bank means nobody else can be in
+		 * the middle of a read-modify-write of this register.
+		 */
+		if (want == U32_MAX) {
+			writel(set, pctl->membase + reg);
+			continue;
+		}
+
+		raw_spin_lock_irqsave(&pctl->lock, flags);
+		val = readl(pctl->membase + reg);
+		writel((val & ~want) | set, pctl->membase + reg);
+		raw_spin_unlock_irqrestore(&pctl->lock, flags);
+	}
+}
+
 static int sunxi_pinctrl_gpio_direction_output(struct gpio_chip *chip,
 					unsigned offset, int value)
 {
@@ -1209,12 +1285,21 @@ static const struct irq_domain_ops sunxi_pinctrl_irq_domain_ops = {
 	.xlate		= sunxi_pinctrl_irq_of_xlate,
 };
 
+/*
+ * Number of times the bank status is rescanned before returning to the
+ * parent interrupt controller. Edges that arrive while the previous ones
+ * are being handled, as with pulse counters running at tens of kHz, are
+ * then dispatched without taking the parent interrupt again.
+ */
+#define SUNXI_PINCTRL_IRQ_PASSES	4
+
 static void sunxi_pinctrl_irq_handler(struct irq_desc *desc)
 {
 	unsigned int irq = irq_desc_get_irq(desc);
 	struct irq_chip *chip = irq_desc_get_chip(desc);
 	struct sunxi_pinctrl *pctl = irq_desc_get_handler_data(desc);
-	unsigned long bank, reg, val;
+	unsigned long bank, reg, ctrl_reg, val;
+	int pass = 0;
 
 	for (bank = 0; bank < pctl->desc->irq_banks; bank++)
 		if (irq == pctl->irq[bank])
@@ -1225,14 +1310,25 @@ static void sunxi_pinctrl_irq_handler(struct irq_desc *desc)
 	chained_irq_enter(chip, desc);
 
 	reg = sunxi_irq_status_reg_from_bank(pctl->desc, bank);
-	val = readl(pctl->membase + reg);
+	ctrl_reg = sunxi_irq_ctrl_reg_from_bank(pctl->desc, bank);
+	/*
+	 * Status bits latch for disabled lines too; only dispatch enabled
+	 * ones, a masked level interrupt would otherwise be handled again
+	 * on every pass.
+	 */
+	val = readl(pctl->membase + reg) & readl(pctl->membase + ctrl_reg);
 
-	if (val) {
+	while (val) {
 		int irqoffset;
 
 		for_each_set_bit(irqoffset, &val, IRQ_PER_BANK)
 			generic_handle_domain_irq(pctl->domain,
 						  bank * IRQ_PER_BANK + irqoffset);
+
+		if (++pass == SUNXI_PINCTRL_IRQ_PASSES)
+			break;
+		val = readl(pctl->membase + reg) &
+		      readl(pctl->membase + ctrl_reg);
 	}
 
 	chained_irq_exit(chip, desc);
@@ -1576,6 +1672,8 @@ int sunxi_pinctrl_init_with_variant(struct platform_device *pdev,
 	pctl->chip->direction_output = sunxi_pinctrl_gpio_direction_output;
 	pctl->chip->get = sunxi_pinctrl_gpio_get;
 	pctl->chip->set = sunxi_pinctrl_gpio_set;
+	pctl->chip->get_multiple = sunxi_pinctrl_gpio_get_multiple;
+	pctl->chip->set_multiple = sunxi_pinctrl_gpio_set_multiple;
 	pctl->chip->of_xlate = sunxi_pinctrl_gpio_of_xlate;
 	pctl->chip->to_irq = sunxi_pinctrl_gpio_to_irq;
 	pctl->chip->of_gpio_n_cells = 3;
@@ -9,21 +9,33 @@
 
 #include <linux/bitfield.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
+#include <linux/slab.h>
 #include <linux/dmaengine.h>
 
 #include <linux/spi/spi.h>
+#include <linux/spi/spi-mem.h>
 
 #define SUN6I_AUTOSUSPEND_TIMEOUT	2000
 
+/*
+ * Devices opting in with "allwinner,poll-max-bytes" have their PIO
+ * transfers up to that size, and expected to last at most half of this,
+ * completed by polling the transfer complete status for up to
+ * SUN6I_POLL_US instead of sleeping until the interrupt.
+ */
+#define SUN6I_POLL_US			100
+
 #define SUN6I_FIFO_DEPTH		128
 #define SUN8I_FIFO_DEPTH		64
 
@@ -101,6 +113,18 @@ struct sun6i_spi {
 	u8			*rx_buf;
 	int			len;
 	unsigned long		fifo_depth;
+
+	/* statistics, exported through debugfs */
+	struct dentry		*debugfs;
+	u64			stat_polled;
+	u64			stat_poll_missed;
+	u64			stat_irq;
+	u64			stat_dma;
+};
+
+/* Per device state, from spi_get_ctldata() */
+struct sun6i_spi_chip {
+	u32			poll_max_len;
 };
 
 static inline u32 sun6i_spi_read(struct sun6i_spi *sspi, u32 reg)
@@ -236,11 +260,14 @@ static int sun6i_spi_prepare_dma(struct sun6i_spi *sspi,
 
 		dmaengine_slave_config(master->dma_tx, &txconf);
 
+		/*
+		 * The end of the transfer is signalled by the RX DMA
+		 * callback or by the controller, never by the TX DMA.
+		 */
 		txdesc = dmaengine_prep_slave_sg(master->dma_tx,
 						 tfr->tx_sg.sgl,
 						 tfr->tx_sg.nents,
-						 DMA_MEM_TO_DEV,
-						 DMA_PREP_INTERRUPT);
+						 DMA_MEM_TO_DEV, 0);
 		if (!txdesc) {
 			if (rxdesc)
 				dmaengine_terminate_sync(master->dma_rx);
@@ -261,28 +288,42 @@ static int sun6i_spi_prepare_dma(struct sun6i_spi *sspi,
 	return 0;
 }
 
-static int sun6i_spi_transfer_one(struct spi_master *master,
-				  struct spi_device *spi,
-				  struct spi_transfer *tfr)
+/*
+ * Run one transfer on the bus. With a header (@hdr_len != 0), the header
+ * is sent first from the TX FIFO and @tfr then only describes the data
+ * received right after it: the controller counts the header as its
+ * transmit phase and, with DHB set, only fills the RX FIFO afterwards,
+ * so a whole spi-mem read is a single controller transfer.
+ */
+static int sun6i_spi_do_transfer(struct spi_master *master,
+				 struct spi_device *spi,
+				 struct spi_transfer *tfr,
+				 const u8 *hdr, unsigned int hdr_len,
+				 bool use_dma)
 {
 	struct sun6i_spi *sspi = spi_master_get_devdata(master);
+	struct sun6i_spi_chip *chip = spi_get_ctldata(spi);
 	unsigned int mclk_rate, div, div_cdr1, div_cdr2, timeout;
 	unsigned int start, end, tx_time;
 	unsigned int trig_level;
 	unsigned int tx_len = 0, rx_len = 0;
-	bool use_dma;
+	unsigned int len = tfr->len + hdr_len;
+	bool poll;
 	int ret = 0;
 	u32 reg;
 
-	if (tfr->len > SUN6I_MAX_XFER_SIZE)
+	if (len > SUN6I_MAX_XFER_SIZE)
 		return -EINVAL;
 
 	reinit_completion(&sspi->done);
 	reinit_completion(&sspi->dma_rx_done);
-	sspi->tx_buf = tfr->tx_buf;
+	sspi->tx_buf = hdr_len ? hdr : tfr->tx_buf;
 	sspi->rx_buf = tfr->rx_buf;
-	sspi->len = tfr->len;
-	use_dma = master->can_dma ? master->can_dma(master, spi, tfr) : false;
+	sspi->len = hdr_len ?: tfr->len;
+	/* poll_max_len fits the FIFO, so no FIFO interrupt is needed either */
+	poll = !use_dma && chip && len <= chip->poll_max_len &&
+	       (u64)len * 8 * USEC_PER_SEC <=
+	       (u64)tfr->speed_hz * (SUN6I_POLL_US / 2);
 
 	/* Clear pending interrupts */
 	sun6i_spi_write(sspi, SUN6I_INT_STA_REG, ~0);
@@ -343,14 +384,15 @@ static int sun6i_spi_transfer_one(struct spi_master *master,
 
 	/*
 	 * If it's a TX only transfer, we don't want to fill the RX
-	 * FIFO with bogus data
+	 * FIFO with bogus data, nor with the bytes clocked in while
+	 * a header is sent.
 	 */
-	if (sspi->rx_buf) {
-		reg &= ~SUN6I_TFR_CTL_DHB;
+	if (sspi->rx_buf)
 		rx_len = tfr->len;
-	} else {
+	if (sspi->rx_buf && !hdr_len)
+		reg &= ~SUN6I_TFR_CTL_DHB;
+	else
 		reg |= SUN6I_TFR_CTL_DHB;
-	}
 
 	/* We want to control the chip select manually */
 	reg |= SUN6I_TFR_CTL_CS_MANUAL;
@@ -397,17 +439,18 @@ static int sun6i_spi_transfer_one(struct spi_master *master,
 
 	/* Setup the transfer now... */
 	if (sspi->tx_buf)
-		tx_len = tfr->len;
+		tx_len = sspi->len;
 
 	/* Setup the counters */
-	sun6i_spi_write(sspi, SUN6I_BURST_CNT_REG, tfr->len);
+	sun6i_spi_write(sspi, SUN6I_BURST_CNT_REG, len);
 	sun6i_spi_write(sspi, SUN6I_XMIT_CNT_REG, tx_len);
 	sun6i_spi_write(sspi, SUN6I_BURST_CTL_CNT_REG, tx_len);
 
-	if (!use_dma) {
-		/* Fill the TX FIFO */
+	/* Fill the TX FIFO, a header always fits in it */
+	if (!use_dma || hdr_len)
 		sun6i_spi_fill_fifo(sspi);
-	} else {
+
+	if (use_dma) {
 		ret = sun6i_spi_prepare_dma(sspi, tfr);
 		if (ret) {
 			dev_warn(&master->dev,
@@ -417,14 +460,22 @@ static int sun6i_spi_transfer_one(struct spi_master *master,
 		}
 	}
 
-	/* Enable the interrupts */
-	reg = SUN6I_INT_CTL_TC;
+	/*
+	 * Enable the interrupts. A DMA transfer with RX only waits for the
+	 * RX DMA callback, which implies the transfer is complete, so it
+	 * costs a single interrupt.
+	 */
+	reg = 0;
 
 	if (!use_dma) {
+		if (!poll)
+			reg |= SUN6I_INT_CTL_TC;
 		if (rx_len > sspi->fifo_depth)
 			reg |= SUN6I_INT_CTL_RF_RDY;
 		if (tx_len > sspi->fifo_depth)
 			reg |= SUN6I_INT_CTL_TF_ERQ;
+	} else if (!rx_len) {
+		reg |= SUN6I_INT_CTL_TC;
 	}
 
 	sun6i_spi_write(sspi, SUN6I_INT_CTL_REG, reg);
@@ -433,31 +484,47 @@ static int sun6i_spi_transfer_one(struct spi_master *master,
 	reg = sun6i_spi_read(sspi, SUN6I_TFR_CTL_REG);
 	sun6i_spi_write(sspi, SUN6I_TFR_CTL_REG, reg | SUN6I_TFR_CTL_XCH);
 
-	tx_time = max(tfr->len * 8 * 2 / (tfr->speed_hz / 1000), 100U);
+	tx_time = max(len * 8 * 2 / (tfr->speed_hz / 1000), 100U);
 	start = jiffies;
-	timeout = wait_for_completion_timeout(&sspi->done,
-					      msecs_to_jiffies(tx_time));
 
-	if (!use_dma) {
-		sun6i_spi_drain_fifo(sspi);
-	} else {
-		if (timeout && rx_len) {
-			/*
-			 * Even though RX on the peripheral side has finished
-			 * RX DMA might still be in flight
-			 */
-			timeout = wait_for_completion_timeout(&sspi->dma_rx_done,
-							      timeout);
-			if (!timeout)
-				dev_warn(&master->dev, "RX DMA timeout\n");
+	if (poll) {
+		ret = readl_poll_timeout_atomic(sspi->base_addr +
+						SUN6I_INT_STA_REG, reg,
+						reg & SUN6I_INT_CTL_TC, 0,
+						SUN6I_POLL_US);
+		if (!ret) {
+			sun6i_spi_write(sspi, SUN6I_INT_STA_REG,
+					SUN6I_INT_CTL_TC);
+			complete(&sspi->done);
+			sspi->stat_polled++;
+		} else {
+			/* The status is latched, so this cannot be missed */
+			ret = 0;
+			sun6i_spi_write(sspi, SUN6I_INT_CTL_REG,
+					SUN6I_INT_CTL_TC);
+			sspi->stat_poll_missed++;
 		}
+	} else if (use_dma) {
+		sspi->stat_dma++;
+	} else {
+		sspi->stat_irq++;
 	}
 
+	timeout = msecs_to_jiffies(tx_time);
+	if (use_dma && rx_len)
+		timeout = wait_for_completion_timeout(&sspi->dma_rx_done,
+						      timeout);
+	else
+		timeout = wait_for_completion_timeout(&sspi->done, timeout);
+
+	if (!use_dma)
+		sun6i_spi_drain_fifo(sspi);
+
 	end = jiffies;
 	if (!timeout) {
 		dev_warn(&master->dev,
 			 "%s: timeout transferring %u bytes@%iHz for %i(%i)ms",
-			 dev_name(&spi->dev), tfr->len, tfr->speed_hz,
+			 dev_name(&spi->dev), len, tfr->speed_hz,
 			 jiffies_to_msecs(end - start), tx_time);
 		ret = -ETIMEDOUT;
 	}
@@ -472,6 +539,99 @@ static int sun6i_spi_transfer_one(struct spi_master *master,
 	return ret;
 }
 
+static int sun6i_spi_transfer_one(struct spi_master *master,
+				  struct spi_device *spi,
+				  struct spi_transfer *tfr)
+{
+	bool use_dma;
+
+	use_dma = master->can_dma ? master->can_dma(master, spi, tfr) : false;
+
+	return sun6i_spi_do_transfer(master, spi, tfr, NULL, 0, use_dma);
+}
+
+/* Opcode, up to 4 address bytes and the dummy cycles of a fast read */
+#define SUN6I_SPI_MEM_HDR_MAX		16
+
+static bool sun6i_spi_mem_supports_op(struct spi_mem *mem,
+				      const struct spi_mem_op *op)
+{
+	if (op->cmd.buswidth > 1 || op->addr.buswidth > 1 ||
+	    op->dummy.buswidth > 1 || op->data.buswidth > 1)
+		return false;
+
+	if (op->cmd.nbytes + op->addr.nbytes + op->dummy.nbytes >
+	    SUN6I_SPI_MEM_HDR_MAX)
+		return false;
+
+	return spi_mem_default_supports_op(mem, op);
+}
+
+static int sun6i_spi_mem_adjust_op_size(struct spi_mem *mem,
+					struct spi_mem_op *op)
+{
+	unsigned int max = SUN6I_MAX_XFER_SIZE - op->cmd.nbytes -
+			   op->addr.nbytes - op->dummy.nbytes;
+
+	op->data.nbytes = min(op->data.nbytes, max);
+
+	return 0;
+}
+
+/*
+ * Only reads are worth handling here: the generic spi-mem path splits
+ * them into one transfer for the opcode, address and dummy bytes and
+ * one for the data, each with its own FIFO setup and completion. Doing
+ * both in a single controller transfer, with the data going through DMA,
+ * lets large reads run at the bus clock. Everything else goes back to
+ * the generic path, as do devices on a GPIO chip select: only the native
+ * one is driven here, the core toggles the GPIO around transfer_one.
+ */
+static int sun6i_spi_mem_exec_op(struct spi_mem *mem,
+				 const struct spi_mem_op *op)
+{
+	struct spi_device *spi = mem->spi;
+	struct spi_master *master = spi->master;
+	struct spi_transfer tfr = { };
+	u8 hdr[SUN6I_SPI_MEM_HDR_MAX];
+	unsigned int hdr_len = 0;
+	bool use_dma;
+	int ret, i;
+
+	if (op->data.dir != SPI_MEM_DATA_IN || !op->data.nbytes ||
+	    spi_get_csgpiod(spi, 0))
+		return -ENOTSUPP;
+
+	for (i = op->cmd.nbytes - 1; i >= 0; i--)
+		hdr[hdr_len++] = op->cmd.opcode >> (i * 8);
+	for (i = op->addr.nbytes - 1; i >= 0; i--)
+		hdr[hdr_len++] = op->addr.val >> (i * 8);
+	memset(hdr + hdr_len, 0xff, op->dummy.nbytes);
+	hdr_len += op->dummy.nbytes;
+
+	tfr.rx_buf = op->data.buf.in;
+	tfr.len = op->data.nbytes;
+	tfr.speed_hz = spi->max_speed_hz;
+
+	use_dma = master->can_dma && master->can_dma(master, spi, &tfr) &&
+		  !spi_controller_dma_map_mem_op_data(master, op, &tfr.rx_sg);
+
+	sun6i_spi_set_cs(spi, spi->mode & SPI_CS_HIGH);
+	ret = sun6i_spi_do_transfer(master, spi, &tfr, hdr, hdr_len, use_dma);
+	sun6i_spi_set_cs(spi, !(spi->mode & SPI_CS_HIGH));
+
+	if (use_dma)
+		spi_controller_dma_unmap_mem_op_data(master, op, &tfr.rx_sg);
+
+	return ret;
+}
+
+static const struct spi_controller_mem_ops sun6i_spi_mem_ops = {
+	.adjust_op_size	= sun6i_spi_mem_adjust_op_size,
+	.supports_op	= sun6i_spi_mem_supports_op,
+	.exec_op	= sun6i_spi_mem_exec_op,
+};
+
 static irqreturn_t sun6i_spi_handler(int irq, void *dev_id)
 {
 	struct sun6i_spi *sspi = dev_id;
@@ -558,6 +718,46 @@ static int sun6i_spi_runtime_suspend(struct device *dev)
 	return 0;
 }
 
+static int sun6i_spi_setup(struct spi_device *spi)
+{
+	struct sun6i_spi *sspi = spi_master_get_devdata(spi->master);
+	struct sun6i_spi_chip *chip = spi_get_ctldata(spi);
+	u32 len = 0;
+
+	if (!chip) {
+		chip = kzalloc(sizeof(*chip), GFP_KERNEL);
+		if (!chip)
+			return -ENOMEM;
+		spi_set_ctldata(spi, chip);
+	}
+
+	of_property_read_u32(spi->dev.of_node, "allwinner,poll-max-bytes",
+			     &len);
+	chip->poll_max_len = min_t(u32, len, sspi->fifo_depth);
+
+	return 0;
+}
+
+static void sun6i_spi_cleanup(struct spi_device *spi)
+{
+	kfree(spi_get_ctldata(spi));
+	spi_set_ctldata(spi, NULL);
+}
+
+static void sun6i_spi_init_debugfs(struct sun6i_spi *sspi)
+{
+	struct dentry *root;
+
+	root = debugfs_create_dir(dev_name(&sspi->master->dev), NULL);
+	debugfs_create_u64("polled_transfers", 0444, root,
+			   &sspi->stat_polled);
+	debugfs_create_u64("poll_missed_transfers", 0444, root,
+			   &sspi->stat_poll_missed);
+	debugfs_create_u64("irq_transfers", 0444, root, &sspi->stat_irq);
+	debugfs_create_u64("dma_transfers", 0444, root, &sspi->stat_dma);
+	sspi->debugfs = root;
+}
+
 static bool sun6i_spi_can_dma(struct spi_master *master,
 			      struct spi_device *spi,
 			      struct spi_transfer *xfer)
@@ -614,6 +814,8 @@ static int sun6i_spi_probe(struct platform_device *pdev)
 	master->min_speed_hz = 3 * 1000;
 	master->use_gpio_descriptors = true;
 	master->set_cs = sun6i_spi_set_cs;
+	master->setup = sun6i_spi_setup;
+	master->cleanup = sun6i_spi_cleanup;
 	master->transfer_one = sun6i_spi_transfer_one;
 	master->num_chipselect = 4;
 	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_CS_HIGH | SPI_LSB_FIRST;
@@ -621,6 +823,7 @@ static int sun6i_spi_probe(struct platform_device *pdev)
 	master->dev.of_node = pdev->dev.of_node;
 	master->auto_runtime_pm = true;
 	master->max_transfer_size = sun6i_spi_max_transfer_size;
+	master->mem_ops = &sun6i_spi_mem_ops;
 
 	sspi->hclk = devm_clk_get(&pdev->dev, "ahb");
 	if (IS_ERR(sspi->hclk)) {
@@ -694,6 +897,8 @@ static int sun6i_spi_probe(struct platform_device *pdev)
 		goto err_pm_disable;
 	}
 
+	sun6i_spi_init_debugfs(sspi);
+
 	return 0;
 
 err_pm_disable:
@@ -713,7 +918,9 @@ err_free_master:
 static int sun6i_spi_remove(struct platform_device *pdev)
 {
 	struct spi_master *master = platform_get_drvdata(pdev);
+	struct sun6i_spi *sspi = spi_master_get_devdata(master);
 
+	debugfs_remove_recursive(sspi->debugfs);
 	pm_runtime_force_suspend(&pdev->dev);
 
 	if (master->dma_tx)
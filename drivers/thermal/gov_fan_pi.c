@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *  fan_pi.c - PI fan control ahead of passive cooling
+ *
+ * Cooling devices on active trip points, i.e. fans, are driven by a PI
+ * controller instead of one step per poll once the trip is crossed. The
+ * controller does not look at the current temperature but at the one
+ * expected lookahead ms from now, extrapolated from the slope since the
+ * previous update of the zone, plus a bias that grows with CPU load. The fan therefore
+ * spins up while the zone is still heating towards the trip, and is
+ * fast enough by the time the zone would reach its passive trip and
+ * start throttling cpufreq.
+ *
+ * Passive and other trips are handled exactly like step_wise does.
+ *
+ * The gains are module parameters of their own, in cooling states per
+ * degree C (k_p) and per degree C and second (k_i), with FRAC_BITS
+ * fractional bits. The zone's k_pu and k_i belong to power_allocator and
+ * have other units. Zero selects the defaults below. Slope and integral
+ * use the time actually elapsed between updates, so interrupt driven
+ * zones without a polling delay work as well.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/minmax.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+
+#include "thermal_core.h"
+
+#define FRAC_BITS 10
+#define int_to_frac(x) ((x) << FRAC_BITS)
+
+#define FAN_PI_DEF_K_P		(int_to_frac(1) / 2)	/* 0.5 state / C */
+#define FAN_PI_DEF_K_I		(int_to_frac(1) / 20)	/* 0.05 state / C / s */
+
+/* Longest gap between updates that still counts fully for the integral */
+#define FAN_PI_MAX_DT_MS	10000
+
+static unsigned int k_p;
+module_param(k_p, uint, 0644);
+MODULE_PARM_DESC(k_p, "Proportional gain, states/C << 10, 0 for default");
+
+static unsigned int k_i;
+module_param(k_i, uint, 0644);
+MODULE_PARM_DESC(k_i, "Integral gain, states/C/s << 10, 0 for default");
+
+/* How far ahead to extrapolate the temperature */
+static unsigned int lookahead_ms = 10000;
+module_param(lookahead_ms, uint, 0644);
+MODULE_PARM_DESC(lookahead_ms, "Temperature extrapolation horizon in ms");
+
+/* Extra millicelsius the controller sees at 100% CPU load */
+static unsigned int load_bias = 5000;
+module_param(load_bias, uint, 0644);
+MODULE_PARM_DESC(load_bias, "Temperature bias at full CPU load, in mC");
+
+struct fan_pi_data {
+	s64 *integral;		/* per trip, in mC * ms */
+	int last_temp;		/* zone temperature at the previous update */
+	ktime_t last_update;	/* and when it was taken, 0 before the first */
+	s64 elapsed_ms;		/* since the previous update, for the integral */
+	int predicted;
+	unsigned long predict_stamp;
+	u64 idle_time;
+	u64 wall_time;
+	unsigned int load;
+	unsigned long load_stamp;
+};
+
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Average load of the online CPUs since the last poll, in percent. All
+ * active trips of one poll share the same sample.
+ */
+static unsigned int fan_pi_cpu_load(struct fan_pi_data *data)
+{
+	u64 idle = 0, wall = 0, cpu_wall, delta_idle, delta_wall;
+	unsigned int load = 0;
+	int cpu;
+
+	if (data->wall_time && data->load_stamp == jiffies)
+		return data->load;
+
+	for_each_online_cpu(cpu) {
+		idle += get_cpu_idle_time(cpu, &cpu_wall, 0);
+		wall += cpu_wall;
+	}
+
+	delta_idle = idle - data->idle_time;
+	delta_wall = wall - data->wall_time;
+	if (data->wall_time && delta_wall > delta_idle)
+		load = div64_u64(100 * (delta_wall - delta_idle), delta_wall);
+
+	data->idle_time = idle;
+	data->wall_time = wall;
+	data->load = load;
+	data->load_stamp = jiffies;
+
+	return load;
+}
+#else
+static unsigned int fan_pi_cpu_load(struct fan_pi_data *data)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Temperature expected lookahead_ms from now. All active trips of one
+ * update share the same prediction.
+ */
+static int fan_pi_predict(struct thermal_zone_device *tz,
+			  struct fan_pi_data *data)
+{
+	int temp = tz->temperature;
+	ktime_t now = ktime_get();
+	s64 slope_ext = 0;
+
+	if (data->last_update && data->predict_stamp == jiffies)
+		return data->predicted;
+
+	data->elapsed_ms = 0;
+	if (data->last_update) {
+		data->elapsed_ms = ktime_ms_delta(now, data->last_update);
+		if (data->elapsed_ms > 0)
+			slope_ext = div_s64((s64)(temp - data->last_temp) *
+					    lookahead_ms, data->elapsed_ms);
+		data->elapsed_ms = clamp_t(s64, data->elapsed_ms, 0,
+					   FAN_PI_MAX_DT_MS);
+	}
+
+	data->last_temp = temp;
+	data->last_update = now;
+	data->predict_stamp = jiffies;
+	data->predicted = temp + slope_ext +
+			  fan_pi_cpu_load(data) * load_bias / 100;
+
+	return data->predicted;
+}
+
+static void fan_pi_trip_update(struct thermal_zone_device *tz, int trip,
+			       int predicted, struct fan_pi_data *data)
+{
+	s64 kp = READ_ONCE(k_p) ?: FAN_PI_DEF_K_P;
+	s64 ki = READ_ONCE(k_i) ?: FAN_PI_DEF_K_I;
+	struct thermal_instance *instance;
+	int trip_temp, err;
+	s64 out;
+
+	tz->ops->get_trip_temp(tz, trip, &trip_temp);
+	err = predicted - trip_temp;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		unsigned long old_target = instance->target;
+		s64 imax;
+
+		if (instance->trip != trip)
+			continue;
+
+		/* Keep the integral term alone from exceeding the upper limit */
+		imax = div64_s64(int_to_frac((s64)instance->upper) * 1000 * 1000,
+				 ki);
+		data->integral[trip] = clamp_t(s64, data->integral[trip] +
+					       (s64)err * data->elapsed_ms,
+					       0, imax);
+
+		out = div_s64(kp * err +
+			      div_s64(ki * data->integral[trip], 1000), 1000);
+		out >>= FRAC_BITS;
+
+		if (out <= 0 && !data->integral[trip])
+			instance->target = THERMAL_NO_TARGET;
+		else
+			instance->target = clamp_t(s64, out, instance->lower,
+						   instance->upper);
+
+		dev_dbg(&instance->cdev->device,
+			"predicted=%d err=%d integral=%lld target=%ld\n",
+			predicted, err, data->integral[trip],
+			(long)instance->target);
+
+		if (instance->initialized && old_target == instance->target)
+			continue;
+
+		instance->initialized = true;
+		mutex_lock(&instance->cdev->lock);
+		instance->cdev->updated = false; /* cdev needs update */
+		mutex_unlock(&instance->cdev->lock);
+	}
+}
+
+static int fan_pi_bind(struct thermal_zone_device *tz)
+{
+	struct fan_pi_data *data;
+
+	data = kzalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	data->integral = kcalloc(max(tz->num_trips, 1), sizeof(*data->integral),
+				 GFP_KERNEL);
+	if (!data->integral) {
+		kfree(data);
+		return -ENOMEM;
+	}
+
+	tz->governor_data = data;
+
+	return 0;
+}
+
+static void fan_pi_unbind(struct thermal_zone_device *tz)
+{
+	struct fan_pi_data *data = tz->governor_data;
+
+	kfree(data->integral);
+	kfree(data);
+	tz->governor_data = NULL;
+}
+
+/**
+ * fan_pi_throttle - updates the cooling devices of one trip of a zone
+ * @tz: thermal_zone_device
+ * @trip: trip point index
+ *
+ * Active trips go through the PI controller, everything else through
+ * step_wise.
+ */
+static int fan_pi_throttle(struct thermal_zone_device *tz, int trip)
+{
+	struct fan_pi_data *data = tz->governor_data;
+	struct thermal_instance *instance;
+	enum thermal_trip_type type;
+
+	lockdep_assert_held(&tz->lock);
+
+	tz->ops->get_trip_type(tz, trip, &type);
+	if (type == THERMAL_TRIP_ACTIVE && trip < tz->num_trips)
+		fan_pi_trip_update(tz, trip, fan_pi_predict(tz, data), data);
+	else
+		step_wise_trip_update(tz, trip);
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node)
+		thermal_cdev_update(instance->cdev);
+
+	return 0;
+}
+
+static struct thermal_governor thermal_gov_fan_pi = {
+	.name		= "fan_pi",
+	.bind_to_tz	= fan_pi_bind,
+	.unbind_from_tz	= fan_pi_unbind,
+	.throttle	= fan_pi_throttle,
+};
+THERMAL_GOVERNOR_DECLARE(thermal_gov_fan_pi);
@@ -12,6 +12,7 @@
 #include <linux/clk.h>
 #include <linux/device.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/nvmem-consumer.h>
 #include <linux/of_device.h>
@@ -19,6 +20,7 @@
 #include <linux/regmap.h>
 #include <linux/reset.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/thermal.h>
 
 #include "thermal_hwmon.h"
@@ -33,6 +35,7 @@
 #define SUN8I_THS_CTRL2				0x40
 #define SUN8I_THS_IC				0x44
 #define SUN8I_THS_IS				0x48
+#define SUN8I_THS_ALARM_CTRL(x)			(0x50 + 0x4 * (x))
 #define SUN8I_THS_MFC				0x70
 #define SUN8I_THS_TEMP_CALIB			0x74
 #define SUN8I_THS_TEMP_DATA			0x80
@@ -49,6 +52,11 @@
 #define SUN8I_THS_CTRL0_T_ACQ0(x)		(GENMASK(15, 0) & (x))
 #define SUN8I_THS_CTRL2_T_ACQ1(x)		((GENMASK(15, 0) & (x)) << 16)
 #define SUN8I_THS_DATA_IRQ_STS(x)		BIT(x + 8)
+#define SUN8I_THS_ALARM_IRQ_EN(x)		BIT(x)
+#define SUN8I_THS_ALARM_IRQ_STS(x)		BIT(x)
+#define SUN8I_THS_ALARM_OFF_STS(x)		BIT(x + 12)
+#define SUN8I_THS_ALARM_T_HOT(x)		((GENMASK(11, 0) & (x)) << 16)
+#define SUN8I_THS_ALARM_T_HYST(x)		(GENMASK(11, 0) & (x))
 
 #define SUN50I_THS_CTRL0_T_ACQ(x)		((GENMASK(15, 0) & (x)) << 16)
 #define SUN50I_THS_FILTER_EN			BIT(2)
@@ -56,12 +64,33 @@
 #define SUN50I_H6_THS_PC_TEMP_PERIOD(x)		((GENMASK(19, 0) & (x)) << 12)
 #define SUN50I_H6_THS_DATA_IRQ_STS(x)		BIT(x)
 
+/* irq_ack() flags an alarm for sensor x with this bit, besides bit x */
+#define SUN8I_THS_ALARM_BIT(x)			((x) + MAX_SENSOR_NUM)
+
+/*
+ * Temperature trend: samples closer together than TREND_MIN_MS are not
+ * used for the rate, which is averaged over about four samples. Within
+ * +/- TREND_STABLE m°C/s the temperature counts as stable. Without a
+ * passive trip active, a sample only re-evaluates the zone if it is
+ * expected to leave the alarm window within TREND_HORIZON_MS.
+ */
+#define SUN8I_THS_TREND_MIN_MS			200
+#define SUN8I_THS_TREND_STABLE			50
+#define SUN8I_THS_TREND_HORIZON_MS		2000
+
 /* millidegree celsius */
 
 struct tsensor {
 	struct ths_device		*tmdev;
 	struct thermal_zone_device	*tzd;
 	int				id;
+
+	spinlock_t			lock;	/* protects the trend */
+	int				last_temp;
+	ktime_t				last_ts;
+	int				rate;	/* m°C/s */
+	int				alarm_low;
+	int				alarm_high;
 };
 
 struct ths_thermal_chip {
@@ -78,6 +107,8 @@ struct ths_thermal_chip {
 	unsigned long	(*irq_ack)(struct ths_device *tmdev);
 	int		(*calc_temp)(struct ths_device *tmdev,
 				     int id, int reg);
+	/* SUN8I_THS_ALARM_CTRL() hot/hysteresis alarms can be used */
+	bool		has_alarm;
 };
 
 struct ths_device {
@@ -115,9 +146,51 @@ static int sun50i_h616_calc_temp(struct ths_device *tmdev,
 	return (reg + tmdev->chip->offset) * tmdev->chip->scale;
 }
 
-static int sun8i_ths_get_temp(struct thermal_zone_device *tz, int *temp)
+/* Inverse of sun8i_ths_calc_temp(), for the alarm thresholds */
+static int sun8i_ths_temp_to_reg(struct ths_device *tmdev, int temp)
+{
+	int reg;
+
+	/* keep the trip window's INT_MAX ends from overflowing */
+	temp = clamp(temp, -40000, 150000) - tmdev->chip->ft_deviation;
+	reg = (tmdev->chip->offset - temp) * 10 / tmdev->chip->scale;
+
+	return clamp(reg, 0, (int)TEMP_CALIB_MASK);
+}
+
+static void sun8i_ths_trend_update(struct tsensor *s, int temp)
+{
+	ktime_t now = ktime_get();
+	s64 ms;
+	int rate;
+
+	spin_lock(&s->lock);
+	ms = ktime_ms_delta(now, s->last_ts);
+	if (!s->last_ts) {
+		s->last_temp = temp;
+		s->last_ts = now;
+	} else if (ms >= SUN8I_THS_TREND_MIN_MS) {
+		rate = div_s64((s64)(temp - s->last_temp) * 1000, ms);
+		WRITE_ONCE(s->rate, (3 * s->rate + rate) / 4);
+		s->last_temp = temp;
+		s->last_ts = now;
+	}
+	spin_unlock(&s->lock);
+}
+
+static enum thermal_trend sun8i_ths_trend(struct tsensor *s)
+{
+	int rate = READ_ONCE(s->rate);
+
+	if (rate > SUN8I_THS_TREND_STABLE)
+		return THERMAL_TREND_RAISING;
+	if (rate < -SUN8I_THS_TREND_STABLE)
+		return THERMAL_TREND_DROPPING;
+	return THERMAL_TREND_STABLE;
+}
+
+static int sun8i_ths_read_temp(struct tsensor *s, int *temp)
 {
-	struct tsensor *s = tz->devdata;
 	struct ths_device *tmdev = s->tmdev;
 	int val = 0;
 
@@ -142,10 +215,108 @@ static int sun8i_ths_get_temp(struct thermal_zone_device *tz, int *temp)
 	return 0;
 }
 
+static int sun8i_ths_get_temp(struct thermal_zone_device *tz, int *temp)
+{
+	struct tsensor *s = tz->devdata;
+	int ret;
+
+	ret = sun8i_ths_read_temp(s, temp);
+	if (!ret)
+		sun8i_ths_trend_update(s, *temp);
+
+	return ret;
+}
+
+/*
+ * The averaged rate, rather than the last two readings the core would
+ * compare otherwise, lets step_wise back off as soon as the zone cools.
+ */
+static int sun8i_ths_get_trend(struct thermal_zone_device *tz, int trip,
+			       enum thermal_trend *trend)
+{
+	*trend = sun8i_ths_trend(tz->devdata);
+
+	return 0;
+}
+
+/*
+ * Fire the alarm interrupt when the temperature rises above @high, and
+ * the alarm-off one when it falls back below @low.
+ */
+static int sun8i_ths_set_trips(struct thermal_zone_device *tz,
+			       int low, int high)
+{
+	struct tsensor *s = tz->devdata;
+	struct ths_device *tmdev = s->tmdev;
+	u32 en = SUN8I_THS_ALARM_IRQ_EN(s->id);
+
+	WRITE_ONCE(s->alarm_low, low);
+	WRITE_ONCE(s->alarm_high, high);
+
+	if (high == INT_MAX)
+		return regmap_update_bits(tmdev->regmap, SUN8I_THS_IC, en, 0);
+
+	regmap_write(tmdev->regmap, SUN8I_THS_ALARM_CTRL(s->id),
+		     SUN8I_THS_ALARM_T_HOT(sun8i_ths_temp_to_reg(tmdev, high)) |
+		     SUN8I_THS_ALARM_T_HYST(sun8i_ths_temp_to_reg(tmdev, low)));
+
+	return regmap_update_bits(tmdev->regmap, SUN8I_THS_IC, en, en);
+}
+
 static const struct thermal_zone_device_ops ths_ops = {
 	.get_temp = sun8i_ths_get_temp,
+	.get_trend = sun8i_ths_get_trend,
 };
 
+static const struct thermal_zone_device_ops ths_alarm_ops = {
+	.get_temp = sun8i_ths_get_temp,
+	.get_trend = sun8i_ths_get_trend,
+	.set_trips = sun8i_ths_set_trips,
+};
+
+static ssize_t temp_rate_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct thermal_zone_device *tz =
+		container_of(dev, struct thermal_zone_device, device);
+	struct tsensor *s = tz->devdata;
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(s->rate));
+}
+static DEVICE_ATTR_RO(temp_rate);
+
+static ssize_t temp_trend_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	static const char * const names[] = {
+		[THERMAL_TREND_STABLE] = "stable",
+		[THERMAL_TREND_RAISING] = "raising",
+		[THERMAL_TREND_DROPPING] = "dropping",
+	};
+	struct thermal_zone_device *tz =
+		container_of(dev, struct thermal_zone_device, device);
+
+	return sysfs_emit(buf, "%s\n", names[sun8i_ths_trend(tz->devdata)]);
+}
+static DEVICE_ATTR_RO(temp_trend);
+
+static struct attribute *ths_trend_attrs[] = {
+	&dev_attr_temp_rate.attr,
+	&dev_attr_temp_trend.attr,
+	NULL
+};
+
+static const struct attribute_group ths_trend_group = {
+	.attrs = ths_trend_attrs,
+};
+
+static void sun8i_ths_remove_trend_group(void *data)
+{
+	struct thermal_zone_device *tzd = data;
+
+	sysfs_remove_group(&tzd->device.kobj, &ths_trend_group);
+}
+
 static const struct regmap_config config = {
 	.reg_bits = 32,
 	.val_bits = 32,
@@ -162,11 +333,20 @@ static unsigned long sun8i_h3_irq_ack(struct ths_device *tmdev)
 	regmap_read(tmdev->regmap, SUN8I_THS_IS, &state);
 
 	for (i = 0; i < tmdev->chip->sensor_num; i++) {
+		u32 alarm = SUN8I_THS_ALARM_IRQ_STS(i) |
+			    SUN8I_THS_ALARM_OFF_STS(i);
+
 		if (state & SUN8I_THS_DATA_IRQ_STS(i)) {
 			regmap_write(tmdev->regmap, SUN8I_THS_IS,
 				     SUN8I_THS_DATA_IRQ_STS(i));
 			bitmap_set(&irq_bitmap, i, 1);
 		}
+		if (tmdev->chip->has_alarm && (state & alarm)) {
+			regmap_write(tmdev->regmap, SUN8I_THS_IS,
+				     state & alarm);
+			bitmap_set(&irq_bitmap, i, 1);
+			bitmap_set(&irq_bitmap, SUN8I_THS_ALARM_BIT(i), 1);
+		}
 	}
 
 	return irq_bitmap;
@@ -190,6 +370,28 @@ static unsigned long sun50i_h6_irq_ack(struct ths_device *tmdev)
 	return irq_bitmap;
 }
 
+/*
+ * With the hardware alarms armed, a plain data sample only needs the
+ * thermal core while a passive trip is being worked on, or when the
+ * trend says the temperature is about to leave the alarm window.
+ */
+static bool sun8i_ths_sample_needs_update(struct tsensor *s)
+{
+	int temp, ahead;
+
+	if (READ_ONCE(s->tzd->passive))
+		return true;
+
+	if (sun8i_ths_read_temp(s, &temp))
+		return false;
+
+	sun8i_ths_trend_update(s, temp);
+	ahead = temp + READ_ONCE(s->rate) * SUN8I_THS_TREND_HORIZON_MS / 1000;
+
+	return temp < READ_ONCE(s->alarm_low) ||
+	       ahead >= READ_ONCE(s->alarm_high);
+}
+
 static irqreturn_t sun8i_irq_thread(int irq, void *data)
 {
 	struct ths_device *tmdev = data;
@@ -197,8 +399,14 @@ static irqreturn_t sun8i_irq_thread(int irq, void *data)
 	int i;
 
 	for_each_set_bit(i, &irq_bitmap, tmdev->chip->sensor_num) {
-		thermal_zone_device_update(tmdev->sensor[i].tzd,
-					   THERMAL_EVENT_UNSPECIFIED);
+		struct tsensor *s = &tmdev->sensor[i];
+
+		if (tmdev->chip->has_alarm &&
+		    !test_bit(SUN8I_THS_ALARM_BIT(i), &irq_bitmap) &&
+		    !sun8i_ths_sample_needs_update(s))
+			continue;
+
+		thermal_zone_device_update(s->tzd, THERMAL_EVENT_UNSPECIFIED);
 	}
 
 	return IRQ_HANDLED;
@@ -592,11 +800,15 @@ static int sun8i_ths_register(struct ths_device *tmdev)
 	for (i = 0; i < tmdev->chip->sensor_num; i++) {
 		tmdev->sensor[i].tmdev = tmdev;
 		tmdev->sensor[i].id = i;
+		spin_lock_init(&tmdev->sensor[i].lock);
+		tmdev->sensor[i].alarm_low = -INT_MAX;
+		tmdev->sensor[i].alarm_high = INT_MAX;
 		tmdev->sensor[i].tzd =
 			devm_thermal_of_zone_register(tmdev->dev,
 						      i,
 						      &tmdev->sensor[i],
-						      &ths_ops);
+						      tmdev->chip->has_alarm ?
+						      &ths_alarm_ops : &ths_ops);
 		if (IS_ERR(tmdev->sensor[i].tzd)) {
 			dev_err(tmdev->dev,
 				"Failed to register sensor %d (%pe)\n",
@@ -607,6 +819,16 @@ static int sun8i_ths_register(struct ths_device *tmdev)
 		if (devm_thermal_add_hwmon_sysfs(tmdev->sensor[i].tzd))
 			dev_warn(tmdev->dev,
 				 "Failed to add hwmon sysfs attributes\n");
+
+		/* removed again before the devm zone unregistration */
+		if (sysfs_create_group(&tmdev->sensor[i].tzd->device.kobj,
+				       &ths_trend_group))
+			dev_warn(tmdev->dev,
+				 "Failed to add trend sysfs attributes\n");
+		else if (devm_add_action_or_reset(tmdev->dev,
+						  sun8i_ths_remove_trend_group,
+						  tmdev->sensor[i].tzd))
+			return -ENOMEM;
 	}
 
 	return 0;
@@ -684,6 +906,7 @@ static struct ths_thermal_chip sun8i_h3_ths = {
 	.init = sun8i_h3_thermal_init,
 	.irq_ack = sun8i_h3_irq_ack,
 	.calc_temp = sun8i_ths_calc_temp,
+	.has_alarm = true,
 };
 
 static const struct ths_thermal_chip sun8i_r40_ths = {
@@ -780,6 +1003,7 @@ static struct platform_driver ths_driver = {
 	.driver = {
 		.name = "sun8i-thermal",
 		.of_match_table = of_ths_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 module_platform_driver(ths_driver);
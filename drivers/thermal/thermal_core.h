@@ -70,6 +70,9 @@ void __thermal_cdev_update(struct thermal_cooling_device *cdev);
 
 int get_tz_trend(struct thermal_zone_device *tz, int trip);
 
+/* Used by the fan_pi governor for its non-active trips */
+void step_wise_trip_update(struct thermal_zone_device *tz, int trip);
+
 struct thermal_instance *
 get_thermal_instance(struct thermal_zone_device *tz,
 		     struct thermal_cooling_device *cdev,
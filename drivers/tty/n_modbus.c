@@ -0,0 +1,450 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Modbus RTU framing line discipline
+ *
+ * Modbus RTU has no frame delimiter: a frame ends when the line stays
+ * silent for 3.5 character times. Received bytes are collected until that
+ * gap is seen, and every read() then returns exactly one frame, optionally
+ * prefixed with the time its first byte came in. Each write() sends one
+ * frame. Bus direction is left to the serial driver's RS-485 support
+ * (TIOCSRS485), which switches RTS/DE around the transmission itself.
+ */
+
+#include <linux/hrtimer.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/tty.h>
+#include <linux/uaccess.h>
+#include <uapi/linux/n_modbus.h>
+
+#define MODBUS_RX_BUFS		16
+#define MODBUS_DEFAULT_GAP	35	/* tenths of a character */
+#define MODBUS_MAX_GAP		1000	/* keeps the gap time well in range */
+/* The specification fixes the gap at 1.75ms above 19200 baud */
+#define MODBUS_GAP_MAX_BAUD	19200
+#define MODBUS_GAP_FIXED_NS	(1750 * NSEC_PER_USEC)
+
+struct n_modbus_buf {
+	struct list_head	list;
+	unsigned int		count;		/* bytes in buf[], header too */
+	bool			hdr;		/* buf[] starts with a header */
+	bool			err;		/* framing error or overlong */
+	ktime_t			ts;
+	u8			buf[sizeof(struct modbus_frame_hdr) +
+				    MODBUS_MAX_FRAME];
+};
+
+struct n_modbus {
+	struct tty_struct	*tty;
+	spinlock_t		lock;		/* protects the lists and cur */
+	struct list_head	rx_free;
+	struct list_head	rx_done;
+	struct n_modbus_buf	*cur;		/* frame being received */
+	struct hrtimer		gap_timer;
+	ktime_t			gap_time;
+	struct modbus_config	cfg;
+	unsigned long		dropped;
+	struct n_modbus_buf	bufs[MODBUS_RX_BUFS];
+};
+
+static void n_modbus_update_gap(struct n_modbus *m)
+{
+	struct tty_struct *tty = m->tty;
+	unsigned int baud = tty_get_baud_rate(tty);
+	unsigned int gap = m->cfg.gap ? m->cfg.gap : MODBUS_DEFAULT_GAP;
+	u64 ns;
+
+	/* Independent of the frame size; a custom gap scales the 1.75ms */
+	if (!baud || baud > MODBUS_GAP_MAX_BAUD) {
+		ns = div_u64(MODBUS_GAP_FIXED_NS * gap, MODBUS_DEFAULT_GAP);
+		m->gap_time = ns_to_ktime(ns);
+		return;
+	}
+
+	ns = (u64)tty_get_frame_size(tty->termios.c_cflag) * NSEC_PER_SEC * gap;
+	m->gap_time = ns_to_ktime(div_u64(ns, baud * 10));
+}
+
+/* Frame gap expired: the frame being received is complete */
+static enum hrtimer_restart n_modbus_gap(struct hrtimer *t)
+{
+	struct n_modbus *m = container_of(t, struct n_modbus, gap_timer);
+	struct modbus_frame_hdr *hdr;
+	struct n_modbus_buf *rbuf;
+	unsigned long flags;
+	bool wake = false;
+
+	spin_lock_irqsave(&m->lock, flags);
+	rbuf = m->cur;
+	m->cur = NULL;
+	if (rbuf) {
+		if (rbuf->err ||
+		    rbuf->count == (rbuf->hdr ? sizeof(*hdr) : 0)) {
+			list_add(&rbuf->list, &m->rx_free);
+		} else {
+			if (rbuf->hdr) {
+				hdr = (struct modbus_frame_hdr *)rbuf->buf;
+				memset(hdr, 0, sizeof(*hdr));
+				hdr->timestamp = ktime_to_ns(rbuf->ts);
+				hdr->len = rbuf->count - sizeof(*hdr);
+			}
+			list_add_tail(&rbuf->list, &m->rx_done);
+			wake = true;
+		}
+	}
+	spin_unlock_irqrestore(&m->lock, flags);
+
+	if (wake)
+		wake_up_interruptible(&m->tty->read_wait);
+
+	return HRTIMER_NORESTART;
+}
+
+static struct n_modbus_buf *n_modbus_get_buf(struct n_modbus *m)
+{
+	struct n_modbus_buf *rbuf;
+
+	rbuf = list_first_entry_or_null(&m->rx_free, struct n_modbus_buf,
+					list);
+	if (!rbuf) {
+		/* Nobody is reading, make room by dropping the oldest frame */
+		rbuf = list_first_entry_or_null(&m->rx_done,
+						struct n_modbus_buf, list);
+		if (!rbuf)
+			return NULL;
+		m->dropped++;
+	}
+	list_del(&rbuf->list);
+
+	rbuf->hdr = m->cfg.flags & MODBUS_FL_TIMESTAMP;
+	rbuf->count = rbuf->hdr ? sizeof(struct modbus_frame_hdr) : 0;
+	rbuf->err = false;
+	rbuf->ts = ktime_get_real();
+
+	return rbuf;
+}
+
+static void n_modbus_receive_buf(struct tty_struct *tty, const u8 *data,
+				 const char *flags, int count)
+{
+	struct n_modbus *m = tty->disc_data;
+	struct n_modbus_buf *rbuf;
+	unsigned long irqflags;
+	unsigned int room;
+	int i;
+
+	spin_lock_irqsave(&m->lock, irqflags);
+
+	if (!m->cur)
+		m->cur = n_modbus_get_buf(m);
+	rbuf = m->cur;
+
+	if (rbuf) {
+		for (i = 0; flags && i < count; i++)
+			if (flags[i] != TTY_NORMAL)
+				rbuf->err = true;
+
+		room = sizeof(rbuf->buf) - rbuf->count;
+		if (count > room) {
+			rbuf->err = true;
+			count = room;
+		}
+		memcpy(rbuf->buf + rbuf->count, data, count);
+		rbuf->count += count;
+	}
+
+	spin_unlock_irqrestore(&m->lock, irqflags);
+
+	/* Every byte received pushes the end of the frame further out */
+	hrtimer_start(&m->gap_timer, m->gap_time, HRTIMER_MODE_REL);
+}
+
+static ssize_t n_modbus_read(struct tty_struct *tty, struct file *file,
+			     u8 *kbuf, size_t nr, void **cookie,
+			     unsigned long offset)
+{
+	struct n_modbus *m = tty->disc_data;
+	struct n_modbus_buf *rbuf;
+	unsigned long flags;
+	ssize_t ret = 0;
+
+	/* Is this a repeated call for a frame we already found earlier? */
+	rbuf = *cookie;
+	if (rbuf)
+		goto have_rbuf;
+
+	for (;;) {
+		DEFINE_WAIT_FUNC(wait, woken_wake_function);
+
+		if (test_bit(TTY_OTHER_CLOSED, &tty->flags))
+			return -EIO;
+		if (tty_hung_up_p(file))
+			return 0;
+
+		spin_lock_irqsave(&m->lock, flags);
+		rbuf = list_first_entry_or_null(&m->rx_done,
+						struct n_modbus_buf, list);
+		if (rbuf)
+			list_del(&rbuf->list);
+		spin_unlock_irqrestore(&m->lock, flags);
+		if (rbuf)
+			break;
+
+		if (tty_io_nonblock(tty, file))
+			return -EAGAIN;
+
+		add_wait_queue(&tty->read_wait, &wait);
+		if (list_empty_careful(&m->rx_done))
+			wait_woken(&wait, TASK_INTERRUPTIBLE,
+				   MAX_SCHEDULE_TIMEOUT);
+		remove_wait_queue(&tty->read_wait, &wait);
+
+		if (signal_pending(current))
+			return -EINTR;
+	}
+
+have_rbuf:
+	/* Have we used it up entirely? */
+	if (offset >= rbuf->count)
+		goto done_with_rbuf;
+
+	/* More data to go, but can't copy any more? EOVERFLOW */
+	ret = -EOVERFLOW;
+	if (!nr)
+		goto done_with_rbuf;
+
+	/* Copy as much data as possible */
+	ret = rbuf->count - offset;
+	if (ret > nr)
+		ret = nr;
+	memcpy(kbuf, rbuf->buf + offset, ret);
+	offset += ret;
+
+	/* If we still have data left, we leave the frame in the cookie */
+	if (offset < rbuf->count) {
+		*cookie = rbuf;
+		return ret;
+	}
+
+done_with_rbuf:
+	*cookie = NULL;
+	spin_lock_irqsave(&m->lock, flags);
+	list_add(&rbuf->list, &m->rx_free);
+	spin_unlock_irqrestore(&m->lock, flags);
+
+	return ret;
+}
+
+static ssize_t n_modbus_write(struct tty_struct *tty, struct file *file,
+			      const u8 *data, size_t count)
+{
+	DEFINE_WAIT_FUNC(wait, woken_wake_function);
+	ssize_t ret = 0;
+	size_t done = 0;
+	int c;
+
+	if (count > MODBUS_MAX_FRAME)
+		return -EMSGSIZE;
+
+	/* Never start a frame that cannot be sent without a pause */
+	if (tty_io_nonblock(tty, file) && tty_write_room(tty) < count)
+		return -EAGAIN;
+
+	add_wait_queue(&tty->write_wait, &wait);
+	while (done < count) {
+		if (tty_hung_up_p(file)) {
+			ret = -EIO;
+			break;
+		}
+
+		set_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+		c = tty->ops->write(tty, data + done, count - done);
+		if (c < 0) {
+			ret = c;
+			break;
+		}
+		done += c;
+		if (done == count)
+			break;
+
+		wait_woken(&wait, TASK_INTERRUPTIBLE, MAX_SCHEDULE_TIMEOUT);
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+	}
+	remove_wait_queue(&tty->write_wait, &wait);
+
+	return done == count ? count : ret;
+}
+
+static void n_modbus_write_wakeup(struct tty_struct *tty)
+{
+	clear_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+}
+
+static void n_modbus_flush_buffer(struct tty_struct *tty)
+{
+	struct n_modbus *m = tty->disc_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&m->lock, flags);
+	list_splice_init(&m->rx_done, &m->rx_free);
+	if (m->cur) {
+		list_add(&m->cur->list, &m->rx_free);
+		m->cur = NULL;
+	}
+	spin_unlock_irqrestore(&m->lock, flags);
+}
+
+static int n_modbus_ioctl(struct tty_struct *tty, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct n_modbus *m = tty->disc_data;
+	struct n_modbus_buf *rbuf;
+	struct modbus_config cfg;
+	unsigned long flags;
+	int count;
+
+	switch (cmd) {
+	case FIONREAD:
+		/* report the size of the next frame */
+		spin_lock_irqsave(&m->lock, flags);
+		rbuf = list_first_entry_or_null(&m->rx_done,
+						struct n_modbus_buf, list);
+		count = rbuf ? rbuf->count : 0;
+		spin_unlock_irqrestore(&m->lock, flags);
+		return put_user(count, (int __user *)arg);
+
+	case MODBUSIOC_GETCONF:
+		if (copy_to_user((void __user *)arg, &m->cfg, sizeof(m->cfg)))
+			return -EFAULT;
+		return 0;
+
+	case MODBUSIOC_SETCONF:
+		if (copy_from_user(&cfg, (void __user *)arg, sizeof(cfg)))
+			return -EFAULT;
+		if (cfg.flags & ~MODBUS_FL_TIMESTAMP ||
+		    cfg.gap > MODBUS_MAX_GAP)
+			return -EINVAL;
+		m->cfg = cfg;
+		n_modbus_update_gap(m);
+		return 0;
+
+	default:
+		return n_tty_ioctl_helper(tty, cmd, arg);
+	}
+}
+
+static __poll_t n_modbus_poll(struct tty_struct *tty, struct file *filp,
+			      poll_table *wait)
+{
+	struct n_modbus *m = tty->disc_data;
+	__poll_t mask = 0;
+
+	poll_wait(filp, &tty->read_wait, wait);
+	poll_wait(filp, &tty->write_wait, wait);
+
+	if (!list_empty_careful(&m->rx_done))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (test_bit(TTY_OTHER_CLOSED, &tty->flags) || tty_hung_up_p(filp))
+		mask |= EPOLLHUP;
+	if (tty_write_room(tty) >= MODBUS_MAX_FRAME)
+		mask |= EPOLLOUT | EPOLLWRNORM;
+
+	return mask;
+}
+
+static void n_modbus_set_termios(struct tty_struct *tty,
+				 const struct ktermios *old)
+{
+	n_modbus_update_gap(tty->disc_data);
+}
+
+static int n_modbus_open(struct tty_struct *tty)
+{
+	struct n_modbus *m;
+	int i;
+
+	if (!tty->ops->write)
+		return -EOPNOTSUPP;
+
+	m = kzalloc(sizeof(*m), GFP_KERNEL);
+	if (!m)
+		return -ENOMEM;
+
+	m->tty = tty;
+	spin_lock_init(&m->lock);
+	INIT_LIST_HEAD(&m->rx_free);
+	INIT_LIST_HEAD(&m->rx_done);
+	for (i = 0; i < MODBUS_RX_BUFS; i++)
+		list_add(&m->bufs[i].list, &m->rx_free);
+	hrtimer_init(&m->gap_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	m->gap_timer.function = n_modbus_gap;
+
+	tty->disc_data = m;
+	tty->receive_room = 65536;
+	n_modbus_update_gap(m);
+
+	/* Flush any pending characters in the driver */
+	tty_driver_flush_buffer(tty);
+
+	return 0;
+}
+
+static void n_modbus_close(struct tty_struct *tty)
+{
+	struct n_modbus *m = tty->disc_data;
+
+	clear_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+	hrtimer_cancel(&m->gap_timer);
+
+	if (m->dropped)
+		pr_debug("%s: %lu frames dropped\n", tty->name, m->dropped);
+
+	tty->disc_data = NULL;
+	kfree(m);
+}
+
+static struct tty_ldisc_ops n_modbus_ldisc = {
+	.owner		= THIS_MODULE,
+	.num		= N_MODBUS,
+	.name		= "modbus",
+	.open		= n_modbus_open,
+	.close		= n_modbus_close,
+	.read		= n_modbus_read,
+	.write		= n_modbus_write,
+	.ioctl		= n_modbus_ioctl,
+	.poll		= n_modbus_poll,
+	.set_termios	= n_modbus_set_termios,
+	.receive_buf	= n_modbus_receive_buf,
+	.write_wakeup	= n_modbus_write_wakeup,
+	.flush_buffer	= n_modbus_flush_buffer,
+};
+
+static int __init n_modbus_init(void)
+{
+	int err;
+
+	err = tty_register_ldisc(&n_modbus_ldisc);
+	if (err)
+		pr_err("N_MODBUS: error registering line discipline: %d\n",
+		       err);
+
+	return err;
+}
+
+static void __exit n_modbus_exit(void)
+{
+	tty_unregister_ldisc(&n_modbus_ldisc);
+}
+
+module_init(n_modbus_init);
+module_exit(n_modbus_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Modbus RTU framing line discipline");
+MODULE_ALIAS_LDISC(N_MODBUS);
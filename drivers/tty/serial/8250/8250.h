@@ -8,6 +8,7 @@
  */
 
 #include <linux/bits.h>
+#include <linux/hrtimer.h>
 #include <linux/serial_8250.h>
 #include <linux/serial_reg.h>
 #include <linux/dmaengine.h>
@@ -48,6 +49,17 @@ struct uart_8250_dma {
 	size_t			rx_size;
 	size_t			tx_size;
 
+	/*
+	 * Hand RX data over once the line has been idle for this long, in
+	 * tenths of a character time. The UART only raises its character
+	 * timeout when data is left in the FIFO, which is not the case when
+	 * the DMA controller drained it. 0 leaves it to the UART.
+	 */
+	unsigned int		rx_idle_timeout;
+	struct hrtimer		rx_idle_timer;
+	size_t			rx_idle_count;
+	struct uart_8250_port	*port;		/* for the hrtimer callback */
+
 	unsigned char		tx_running;
 	unsigned char		tx_err;
 	unsigned char		rx_running;
@@ -38,24 +38,16 @@ static void __dma_tx_complete(void *param)
 	spin_unlock_irqrestore(&p->port.lock, flags);
 }
 
-static void __dma_rx_complete(void *param)
+static void __dma_rx_complete(struct uart_8250_port *p)
 {
-	struct uart_8250_port	*p = param;
 	struct uart_8250_dma	*dma = p->dma;
 	struct tty_port		*tty_port = &p->port.state->port;
 	struct dma_tx_state	state;
-	enum dma_status		dma_status;
 	int			count;
 
-	/*
-	 * New DMA Rx can be started during the completion handler before it
-	 * could acquire port's lock and it might still be ongoing. Don't to
-	 * anything in such case.
-	 */
-	dma_status = dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
-	if (dma_status == DMA_IN_PROGRESS)
-		return;
+	hrtimer_try_to_cancel(&dma->rx_idle_timer);
 
+	dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
 	count = dma->rx_size - state.residue;
 
 	tty_insert_flip_string(tty_port, dma->rx_buf, count);
@@ -72,11 +64,60 @@ static void dma_rx_complete(void *param)
 	unsigned long flags;
 
 	spin_lock_irqsave(&p->port.lock, flags);
-	if (dma->rx_running)
+	/*
+	 * New DMA Rx can be started during the completion handler before it
+	 * could acquire port's lock and it might still be ongoing. Don't do
+	 * anything in such case. A flush on the other hand pauses the
+	 * transfer, which not every DMA driver reports, so the check must
+	 * not be done there.
+	 */
+	if (dma->rx_running &&
+	    dmaengine_tx_status(dma->rxchan, dma->rx_cookie, NULL) !=
+	    DMA_IN_PROGRESS) {
 		__dma_rx_complete(p);
+		/* The buffer filled up, don't wait for an interrupt to rearm */
+		if (!dma->rx_running && (serial_lsr_in(p) & UART_LSR_DR))
+			dma->rx_dma(p);
+	}
 	spin_unlock_irqrestore(&p->port.lock, flags);
 }
 
+static void dma_rx_idle_start(struct uart_8250_dma *dma)
+{
+	u64 ns = (u64)READ_ONCE(dma->port->port.frame_time) *
+		 dma->rx_idle_timeout;
+
+	hrtimer_start(&dma->rx_idle_timer, ns_to_ktime(div_u64(ns, 10)),
+		      HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart dma_rx_idle(struct hrtimer *t)
+{
+	struct uart_8250_dma *dma = container_of(t, struct uart_8250_dma,
+						 rx_idle_timer);
+	struct uart_8250_port *p = dma->port;
+	struct dma_tx_state state;
+	unsigned long flags;
+	size_t count;
+
+	spin_lock_irqsave(&p->port.lock, flags);
+	if (dma->rx_running) {
+		dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
+		count = dma->rx_size - state.residue;
+
+		/* Nothing came in since the last check: end of frame */
+		if (count && count == dma->rx_idle_count) {
+			serial8250_rx_dma_flush(p);
+		} else {
+			dma->rx_idle_count = count;
+			dma_rx_idle_start(dma);
+		}
+	}
+	spin_unlock_irqrestore(&p->port.lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 int serial8250_tx_dma(struct uart_8250_port *p)
 {
 	struct uart_8250_dma		*dma = p->dma;
@@ -157,6 +198,11 @@ int serial8250_rx_dma(struct uart_8250_port *p)
 
 	dma_async_issue_pending(dma->rxchan);
 
+	if (dma->rx_idle_timeout) {
+		dma->rx_idle_count = 0;
+		dma_rx_idle_start(dma);
+	}
+
 	return 0;
 }
 
@@ -257,6 +303,10 @@ int serial8250_request_dma(struct uart_8250_port *p)
 		goto err;
 	}
 
+	dma->port = p;
+	hrtimer_init(&dma->rx_idle_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dma->rx_idle_timer.function = dma_rx_idle;
+
 	dev_dbg_ratelimited(p->port.dev, "got both dma channels\n");
 
 	return 0;
@@ -271,11 +321,17 @@ EXPORT_SYMBOL_GPL(serial8250_request_dma);
 void serial8250_release_dma(struct uart_8250_port *p)
 {
 	struct uart_8250_dma *dma = p->dma;
+	unsigned long flags;
 
 	if (!dma)
 		return;
 
 	/* Release RX resources */
+	spin_lock_irqsave(&p->port.lock, flags);
+	dma->rx_running = 0;
+	spin_unlock_irqrestore(&p->port.lock, flags);
+	hrtimer_cancel(&dma->rx_idle_timer);
+
 	dmaengine_terminate_sync(dma->rxchan);
 	dma_free_coherent(dma->rxchan->device->dev, dma->rx_size, dma->rx_buf,
 			  dma->rx_addr);
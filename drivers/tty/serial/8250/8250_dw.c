@@ -658,6 +658,19 @@ static int dw8250_probe(struct platform_device *pdev)
 	if (p->fifosize) {
 		data->data.dma.rxconf.src_maxburst = p->fifosize / 4;
 		data->data.dma.txconf.dst_maxburst = p->fifosize / 4;
+
+		/* RX DMA buffer, PAGE_SIZE by default */
+		val = 0;
+		device_property_read_u32(dev, "snps,rx-dma-size", &val);
+		data->data.dma.rx_size = val;
+
+		/*
+		 * Flush RX after this many tenths of a character time of
+		 * silence, e.g. 35 for the Modbus RTU inter-frame gap.
+		 */
+		device_property_read_u32(dev, "snps,rx-idle-timeout",
+					 &data->data.dma.rx_idle_timeout);
+
 		up->dma = &data->data.dma;
 	}
 
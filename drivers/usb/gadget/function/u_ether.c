@@ -66,6 +66,10 @@ struct eth_dev {
 
 	struct sk_buff_head	rx_frames;
 
+	/* frames handed from rx_complete() to eth_poll() */
+	struct napi_struct	napi;
+	struct sk_buff_head	rx_napi;
+
 	unsigned		qmult;
 
 	unsigned		header_len;
@@ -92,6 +96,8 @@ struct eth_dev {
 
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
+#define RX_NAPI_MAX	1000	/* frames waiting for eth_poll() */
+
 /* for dual-speed hardware, use deeper queues at high/super speed */
 static inline int qlen(struct usb_gadget *gadget, unsigned qmult)
 {
@@ -294,6 +300,12 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 				dev_kfree_skb_any(skb2);
 				goto next_frame;
 			}
+			if (!netif_running(dev->net) ||
+			    skb_queue_len(&dev->rx_napi) >= RX_NAPI_MAX) {
+				dev->net->stats.rx_dropped++;
+				dev_kfree_skb_any(skb2);
+				goto next_frame;
+			}
 			skb2->protocol = eth_type_trans(skb2, dev->net);
 			dev->net->stats.rx_packets++;
 			dev->net->stats.rx_bytes += skb2->len;
@@ -301,10 +313,11 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 			/* no buffer copies needed, unless hardware can't
 			 * use skb buffers.
 			 */
-			status = netif_rx(skb2);
+			skb_queue_tail(&dev->rx_napi, skb2);
 next_frame:
 			skb2 = skb_dequeue(&dev->rx_frames);
 		}
+		napi_schedule(&dev->napi);
 		break;
 
 	/* software-driven interface shutdown */
@@ -345,6 +358,28 @@ clean:
 		rx_submit(dev, req, GFP_ATOMIC);
 }
 
+/* The requests are still requeued from rx_complete(), so that
+ * gether_disconnect() can reclaim all of them with irqs blocked.
+ * Only passing the frames up the stack is deferred to NAPI, for GRO.
+ */
+static int eth_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	int		work_done = 0;
+
+	while (work_done < budget && (skb = skb_dequeue(&dev->rx_napi))) {
+		napi_gro_receive(napi, skb);
+		work_done++;
+	}
+
+	if (work_done < budget && napi_complete_done(napi, work_done) &&
+	    !skb_queue_empty(&dev->rx_napi))
+		napi_schedule(napi);
+
+	return work_done;
+}
+
 static int prealloc(struct list_head *list, struct usb_ep *ep, unsigned n)
 {
 	unsigned		i;
@@ -629,6 +664,7 @@ static int eth_open(struct net_device *net)
 	struct gether	*link;
 
 	DBG(dev, "%s\n", __func__);
+	napi_enable(&dev->napi);
 	if (netif_carrier_ok(dev->net))
 		eth_start(dev, GFP_KERNEL);
 
@@ -649,6 +685,9 @@ static int eth_stop(struct net_device *net)
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
 
+	napi_disable(&dev->napi);
+	skb_queue_purge(&dev->rx_napi);
+
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
 		dev->net->stats.rx_errors, dev->net->stats.tx_errors
@@ -769,6 +808,8 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	skb_queue_head_init(&dev->rx_napi);
+	netif_napi_add(net, &dev->napi, eth_poll);
 
 	/* network device setup */
 	dev->net = net;
@@ -840,6 +881,8 @@ struct net_device *gether_setup_name_default(const char *netname)
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	skb_queue_head_init(&dev->rx_napi);
+	netif_napi_add(net, &dev->napi, eth_poll);
 
 	/* network device setup */
 	dev->net = net;
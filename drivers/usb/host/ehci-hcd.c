@@ -19,6 +19,7 @@
 #include <linux/init.h>
 #include <linux/hrtimer.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/interrupt.h>
 #include <linux/usb.h>
 #include <linux/usb/hcd.h>
@@ -532,7 +533,9 @@ static int ehci_init(struct usb_hcd *hcd)
 	/* clear interrupt enables, set irq latency */
 	if (log2_irq_thresh < 0 || log2_irq_thresh > 6)
 		log2_irq_thresh = 0;
-	temp = 1 << (16 + log2_irq_thresh);
+	if (!ehci->irq_thresh)
+		ehci->irq_thresh = 1 << log2_irq_thresh;
+	temp = ehci->irq_thresh << 16;
 	if (HCC_PER_PORT_CHANGE_EVENT(hcc_params)) {
 		ehci->has_ppcd = 1;
 		ehci_dbg(ehci, "enable per-port change event\n");
@@ -752,9 +755,11 @@ restart:
 
 	cmd = ehci_readl(ehci, &ehci->regs->command);
 	bh = 0;
+	ehci->irq_count++;
 
 	/* normal [4.15.1.2] or error [4.15.1.1] completion */
 	if (likely ((status & (STS_INT|STS_ERR)) != 0)) {
+		ehci->irq_complete++;
 		if (likely ((status & STS_ERR) == 0)) {
 			INCR(ehci->stats.normal);
 		} else {
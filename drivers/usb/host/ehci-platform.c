@@ -25,6 +25,7 @@
 #include <linux/kernel.h>
 #include <linux/hrtimer.h>
 #include <linux/io.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -241,6 +242,7 @@ static int ehci_platform_probe(struct platform_device *dev)
 	struct ehci_platform_priv *priv;
 	struct ehci_hcd *ehci;
 	int err, irq, clk = 0;
+	u32 itc;
 
 	if (usb_disabled())
 		return -ENODEV;
@@ -294,6 +296,15 @@ static int ehci_platform_probe(struct platform_device *dev)
 					  "has-transaction-translator"))
 			hcd->has_tt = 1;
 
+		if (!of_property_read_u32(dev->dev.of_node,
+					  "itc-microframes", &itc)) {
+			if (is_power_of_2(itc) && itc <= 64)
+				ehci->irq_thresh = itc;
+			else
+				dev_warn(&dev->dev,
+					 "bad itc-microframes %u\n", itc);
+		}
+
 		if (of_device_is_compatible(dev->dev.of_node,
 					    "aspeed,ast2500-ehci") ||
 		    of_device_is_compatible(dev->dev.of_node,
@@ -146,6 +146,71 @@ out_unlock:
 static DEVICE_ATTR_RW(uframe_periodic_max);
 
 
+/*
+ * Display / Set the interrupt threshold, in microframes
+ */
+static ssize_t irq_threshold_show(struct device *dev,
+				  struct device_attribute *attr,
+				  char *buf)
+{
+	struct ehci_hcd		*ehci;
+
+	ehci = hcd_to_ehci(dev_get_drvdata(dev));
+	return sysfs_emit(buf, "%u\n", ehci->irq_thresh);
+}
+
+/*
+ * EHCI 1.0 (2.3.1) leaves changing ITC on a running controller
+ * undefined, but the driver rewrites USBCMD whenever a schedule is
+ * enabled anyway, so the new value reaches the hardware either way.
+ * Write it straight away rather than waiting for that.
+ */
+static ssize_t irq_threshold_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct ehci_hcd		*ehci;
+	unsigned		irq_thresh;
+	unsigned long		flags;
+
+	ehci = hcd_to_ehci(dev_get_drvdata(dev));
+	if (kstrtouint(buf, 0, &irq_thresh) < 0)
+		return -EINVAL;
+
+	if (!is_power_of_2(irq_thresh) || irq_thresh > 64)
+		return -EINVAL;
+
+	spin_lock_irqsave(&ehci->lock, flags);
+	ehci->irq_thresh = irq_thresh;
+	ehci->command &= ~CMD_ITC;
+	ehci->command |= irq_thresh << 16;
+	if (ehci->rh_state == EHCI_RH_RUNNING)
+		ehci_writel(ehci, ehci->command, &ehci->regs->command);
+	spin_unlock_irqrestore(&ehci->lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(irq_threshold);
+
+
+/*
+ * Display interrupt counts: all interrupts, and those that reported
+ * transfer completions (USBINT or USBERRINT).
+ */
+static ssize_t irq_stats_show(struct device *dev,
+			      struct device_attribute *attr,
+			      char *buf)
+{
+	struct ehci_hcd		*ehci;
+
+	ehci = hcd_to_ehci(dev_get_drvdata(dev));
+	return sysfs_emit(buf, "irqs %lu\ncomplete %lu\n",
+			  READ_ONCE(ehci->irq_count),
+			  READ_ONCE(ehci->irq_complete));
+}
+static DEVICE_ATTR_RO(irq_stats);
+
+
 static inline int create_sysfs_files(struct ehci_hcd *ehci)
 {
 	struct device	*controller = ehci_to_hcd(ehci)->self.controller;
@@ -158,6 +223,14 @@ static inline int create_sysfs_files(struct ehci_hcd *ehci)
 		goto out;
 
 	i = device_create_file(controller, &dev_attr_uframe_periodic_max);
+	if (i)
+		goto out;
+
+	i = device_create_file(controller, &dev_attr_irq_threshold);
+	if (i)
+		goto out;
+
+	i = device_create_file(controller, &dev_attr_irq_stats);
 out:
 	return i;
 }
@@ -171,4 +244,6 @@ static inline void remove_sysfs_files(struct ehci_hcd *ehci)
 		device_remove_file(controller, &dev_attr_companion);
 
 	device_remove_file(controller, &dev_attr_uframe_periodic_max);
+	device_remove_file(controller, &dev_attr_irq_threshold);
+	device_remove_file(controller, &dev_attr_irq_stats);
 }
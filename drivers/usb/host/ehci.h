@@ -201,6 +201,11 @@ struct ehci_hcd {			/* one per controller */
 	unsigned long		next_statechange;
 	ktime_t			last_periodic_enable;
 	u32			command;
+	u8			irq_thresh;	/* ITC in uframes */
+
+	/* interrupt rate, see the irq_stats attribute */
+	unsigned long		irq_count;
+	unsigned long		irq_complete;
 
 	/* SILICON QUIRKS */
 	unsigned		no_selective_suspend:1;
@@ -271,6 +271,17 @@ struct musb_context_registers {
 	struct musb_csr_regs index_regs[MUSB_C_NUM_EPS];
 };
 
+/*
+ * Host side bulk scheduling counters, one set per direction.
+ */
+struct musb_bulk_stats {
+	u32			dedicated;	/* qh got its own hw_ep */
+	u32			shared;		/* qh queued on bulk_ep */
+	u32			promoted;	/* qh moved off bulk_ep */
+	u32			nak_rotations;	/* bulk_ep turn ended by NAKs */
+	u32			burst_rotations; /* ... by bulk_burst urbs */
+};
+
 /*
  * struct musb - Driver instance data.
  */
@@ -312,6 +323,14 @@ struct musb {
 	struct list_head	control;	/* of musb_qh */
 	struct list_head	in_bulk;	/* of musb_qh */
 	struct list_head	out_bulk;	/* of musb_qh */
+
+	/* urbs a qh may complete on bulk_ep before the next qh on the
+	 * ring gets a turn; zero means only NAK timeouts rotate the ring.
+	 */
+#define MUSB_BULK_BURST		4
+	u32			bulk_burst;
+	struct musb_bulk_stats	bulk_stats[2];	/* indexed by is_in */
+
 	struct list_head	pending_list;	/* pending work list */
 
 	struct timer_list	otg_timer;
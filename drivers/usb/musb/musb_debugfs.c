@@ -321,6 +321,38 @@ static const struct file_operations musb_softconnect_fops = {
 	.release		= single_release,
 };
 
+static int musb_bulk_sched_show(struct seq_file *s, void *unused)
+{
+	struct musb		*musb = s->private;
+	struct musb_bulk_stats	*stats;
+	struct list_head	*head;
+	struct musb_qh		*qh;
+	unsigned long		flags;
+	unsigned int		queued;
+	int			is_in;
+
+	spin_lock_irqsave(&musb->lock, flags);
+	seq_printf(s, "bulk_ep %d, burst %u\n",
+		   musb->bulk_ep ? musb->bulk_ep->epnum : -1, musb->bulk_burst);
+	for (is_in = 1; is_in >= 0; is_in--) {
+		head = is_in ? &musb->in_bulk : &musb->out_bulk;
+		stats = &musb->bulk_stats[is_in];
+
+		queued = 0;
+		list_for_each_entry(qh, head, ring)
+			queued++;
+
+		seq_printf(s, "%s: queued %u dedicated %u shared %u promoted %u nak_rotations %u burst_rotations %u\n",
+			   is_in ? "in" : "out", queued, stats->dedicated,
+			   stats->shared, stats->promoted,
+			   stats->nak_rotations, stats->burst_rotations);
+	}
+	spin_unlock_irqrestore(&musb->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(musb_bulk_sched);
+
 void musb_init_debugfs(struct musb *musb)
 {
 	struct dentry *root;
@@ -333,6 +365,10 @@ void musb_init_debugfs(struct musb *musb)
 			    &musb_test_mode_fops);
 	debugfs_create_file("softconnect", S_IRUGO | S_IWUSR, root, musb,
 			    &musb_softconnect_fops);
+	debugfs_create_file("bulk_sched", S_IRUGO, root, musb,
+			    &musb_bulk_sched_fops);
+	debugfs_create_u32("bulk_burst", S_IRUGO | S_IWUSR, root,
+			   &musb->bulk_burst);
 }
 
 void /* __init_or_exit */ musb_exit_debugfs(struct musb *musb)
@@ -286,6 +286,71 @@ __acquires(musb->lock)
 	spin_lock(&musb->lock);
 }
 
+/*
+ * A bulk qh sharing bulk_ep gives up its turn after bulk_burst urbs even
+ * if its device never NAKs; a modem or disk streaming without a pause
+ * would otherwise keep every other qh on the ring waiting.
+ */
+static struct musb_qh *musb_bulk_rotate(struct musb *musb,
+		struct musb_hw_ep *ep, struct musb_qh *qh, int is_in)
+{
+	struct list_head	*head;
+	struct musb_qh		*next_qh;
+
+	head = is_in ? &musb->in_bulk : &musb->out_bulk;
+	if (!musb->bulk_burst || ++qh->burst < musb->bulk_burst)
+		return qh;
+	qh->burst = 0;
+
+	if (list_is_singular(head))
+		return qh;
+	next_qh = list_next_entry(qh, ring);
+	if (!next_qh->is_ready)
+		return qh;
+
+	list_move_tail(&qh->ring, head);
+	if (is_in)
+		ep->rx_reinit = 1;
+	else
+		ep->tx_reinit = 1;
+	musb->bulk_stats[is_in].burst_rotations++;
+	return next_qh;
+}
+
+/*
+ * A bulk qh just released its dedicated hw_ep.  Rather than leave that
+ * fifo idle while other bulk qhs take turns on bulk_ep, move the first
+ * waiting one that fits over to it.  The head of the ring is the qh
+ * bulk_ep is currently programmed for, so it stays where it is.
+ */
+static struct musb_qh *musb_bulk_promote(struct musb *musb,
+		struct musb_hw_ep *ep, int is_in)
+{
+	struct list_head	*head;
+	struct musb_qh		*qh;
+	u16			maxpacket;
+
+	head = is_in ? &musb->in_bulk : &musb->out_bulk;
+	maxpacket = is_in ? ep->max_packet_sz_rx : ep->max_packet_sz_tx;
+
+	list_for_each_entry(qh, head, ring) {
+		if (qh == first_qh(head) || !qh->is_ready)
+			continue;
+		if (qh->maxpacket * qh->hb_mult > maxpacket)
+			continue;
+
+		list_del(&qh->ring);
+		qh->mux = 0;
+		qh->burst = 0;
+		qh->intv_reg = 0;
+		qh->hw_ep = ep;
+		musb->bulk_stats[is_in].promoted++;
+		musb_dbg(musb, "qh %p promoted to ep%d", qh, ep->epnum);
+		return qh;
+	}
+	return NULL;
+}
+
 /*
  * Advance this hardware endpoint's queue, completing the specified URB and
  * advancing to either the next URB queued to that qh, or else invalidating
@@ -366,6 +431,11 @@ static void musb_advance_schedule(struct musb *musb, struct urb *urb,
 				qh = first_qh(head);
 				break;
 			}
+			if (qh->type == USB_ENDPOINT_XFER_BULK) {
+				kfree(qh);
+				qh = musb_bulk_promote(musb, ep, is_in);
+				break;
+			}
 			fallthrough;
 
 		case USB_ENDPOINT_XFER_ISOC:
@@ -378,6 +448,8 @@ static void musb_advance_schedule(struct musb *musb, struct urb *urb,
 			qh = NULL;
 			break;
 		}
+	} else if (qh && qh->mux == 1 && qh->type == USB_ENDPOINT_XFER_BULK) {
+		qh = musb_bulk_rotate(musb, ep, qh, is_in);
 	}
 
 	if (qh != NULL && qh->is_ready) {
@@ -945,6 +1017,8 @@ static void musb_bulk_nak_timeout(struct musb *musb, struct musb_hw_ep *ep,
 		}
 		toggle = musb->io.get_toggle(cur_qh, !is_in);
 		usb_settoggle(urb->dev, cur_qh->epnum, !is_in, toggle ? 1 : 0);
+		cur_qh->burst = 0;
+		musb->bulk_stats[is_in].nak_rotations++;
 
 		if (is_in) {
 			/* move cur_qh to end of queue */
@@ -2084,6 +2158,8 @@ static int musb_schedule(
 		if (qh->dev)
 			qh->intv_reg =
 				(USB_SPEED_HIGH == qh->dev->speed) ? 8 : 4;
+		qh->burst = 0;
+		musb->bulk_stats[is_in].shared++;
 		goto success;
 	} else if (best_end < 0) {
 		dev_err(musb->controller,
@@ -2096,6 +2172,8 @@ static int musb_schedule(
 	idle = 1;
 	qh->mux = 0;
 	hw_ep = musb->endpoints + best_end;
+	if (qh->type == USB_ENDPOINT_XFER_BULK)
+		musb->bulk_stats[is_in].dedicated++;
 	musb_dbg(musb, "qh %p periodic slot %d", qh, best_end);
 success:
 	if (head) {
@@ -2211,6 +2211,8 @@ static int ftdi_port_probe(struct usb_serial_port *port)
 	ftdi_set_max_packet_size(port);
 	if (read_latency_timer(port) < 0)
 		priv->latency = 16;
+	if (port->low_latency)
+		priv->flags |= ASYNC_LOW_LATENCY;
 	write_latency_timer(port);
 
 	result = ftdi_gpio_init(port);
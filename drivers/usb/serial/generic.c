@@ -327,7 +327,7 @@ int usb_serial_generic_submit_read_urbs(struct usb_serial_port *port,
 	int res;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(port->read_urbs); ++i) {
+	for (i = 0; i < port->num_read_urbs; ++i) {
 		res = usb_serial_generic_submit_read_urb(port, i, mem_flags);
 		if (res)
 			goto err;
@@ -413,6 +413,10 @@ void usb_serial_generic_read_bulk_callback(struct urb *urb)
 	 * usb_serial_generic_submit_read_urb().
 	 */
 	smp_mb__before_atomic();
+	/* Statistics only, so racing with a resubmit is fine */
+	port->read_completions++;
+	if (hweight_long(port->read_urbs_free) + 1 >= port->num_read_urbs)
+		port->read_starved++;
 	set_bit(i, &port->read_urbs_free);
 	/*
 	 * Make sure URB is marked as free before checking the throttled flag
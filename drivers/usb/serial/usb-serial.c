@@ -49,6 +49,21 @@
    drivers depend on it.
 */
 
+/*
+ * Keeping more than two bulk in urbs queued lets the host collect the
+ * next packet while the previous one is still being pushed to the tty,
+ * which matters with many small-packet adaptors on one host controller.
+ */
+static unsigned int read_urbs = 2;
+module_param(read_urbs, uint, 0644);
+MODULE_PARM_DESC(read_urbs, "Bulk in urbs per port (1-"
+		 __stringify(USB_SERIAL_MAX_READ_URBS) ")");
+
+static bool low_latency;
+module_param(low_latency, bool, 0644);
+MODULE_PARM_DESC(low_latency,
+		 "Configure devices for minimum receive latency (e.g. FTDI latency timer)");
+
 static DEFINE_IDR(serial_minors);
 static DEFINE_MUTEX(table_lock);
 static LIST_HEAD(usb_serial_driver_list);
@@ -98,6 +113,7 @@ static int allocate_minors(struct usb_serial *serial, int num_ports)
 			goto error;
 		port->minor = minor;
 		port->port_number = i;
+		port->low_latency = low_latency;
 	}
 	serial->minors_reserved = 1;
 	mutex_unlock(&table_lock);
@@ -779,12 +795,42 @@ static ssize_t port_number_show(struct device *dev,
 {
 	struct usb_serial_port *port = to_usb_serial_port(dev);
 
-	return sprintf(buf, "%u\n", port->port_number);
+	return sysfs_emit(buf, "%u\n", port->port_number);
 }
 static DEVICE_ATTR_RO(port_number);
 
+static ssize_t read_urbs_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct usb_serial_port *port = to_usb_serial_port(dev);
+
+	return sysfs_emit(buf, "%u\n", port->num_read_urbs);
+}
+static DEVICE_ATTR_RO(read_urbs);
+
+static ssize_t read_completions_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct usb_serial_port *port = to_usb_serial_port(dev);
+
+	return sysfs_emit(buf, "%lu\n", READ_ONCE(port->read_completions));
+}
+static DEVICE_ATTR_RO(read_completions);
+
+static ssize_t read_starved_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct usb_serial_port *port = to_usb_serial_port(dev);
+
+	return sysfs_emit(buf, "%lu\n", READ_ONCE(port->read_starved));
+}
+static DEVICE_ATTR_RO(read_starved);
+
 static struct attribute *usb_serial_port_attrs[] = {
 	&dev_attr_port_number.attr,
+	&dev_attr_read_urbs.attr,
+	&dev_attr_read_completions.attr,
+	&dev_attr_read_starved.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(usb_serial_port);
@@ -852,8 +898,9 @@ static int setup_port_bulk_in(struct usb_serial_port *port,
 	buffer_size = max_t(int, type->bulk_in_size, usb_endpoint_maxp(epd));
 	port->bulk_in_size = buffer_size;
 	port->bulk_in_endpointAddress = epd->bEndpointAddress;
+	port->num_read_urbs = clamp_val(read_urbs, 1, USB_SERIAL_MAX_READ_URBS);
 
-	for (i = 0; i < ARRAY_SIZE(port->read_urbs); ++i) {
+	for (i = 0; i < port->num_read_urbs; ++i) {
 		set_bit(i, &port->read_urbs_free);
 		port->read_urbs[i] = usb_alloc_urb(0, GFP_KERNEL);
 		if (!port->read_urbs[i])
@@ -1500,6 +1547,8 @@ int usb_serial_register_drivers(struct usb_serial_driver *const serial_drivers[]
 	udriver->resume = usb_serial_resume;
 	udriver->probe = usb_serial_probe;
 	udriver->disconnect = usb_serial_disconnect;
+	/* Port setup may talk to the device, keep it off the boot path. */
+	udriver->drvwrap.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS;
 
 	/* we only set the reset_resume field if the serial_driver has one */
 	for (sd = serial_drivers; *sd; ++sd) {
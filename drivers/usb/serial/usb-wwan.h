@@ -26,8 +26,10 @@ extern int usb_wwan_resume(struct usb_serial *serial);
 /* per port private data */
 
 #define N_IN_URB 4
+#define N_IN_URB_MAX 32
 #define N_OUT_URB 4
 #define IN_BUFLEN 4096
+#define IN_BUFLEN_MAX 65536
 #define OUT_BUFLEN 4096
 
 struct usb_wwan_intf_private {
@@ -42,8 +44,15 @@ struct usb_wwan_intf_private {
 
 struct usb_wwan_port_private {
 	/* Input endpoints and buffer for this port */
-	struct urb *in_urbs[N_IN_URB];
-	u8 *in_buffer[N_IN_URB];
+	struct urb *in_urbs[N_IN_URB_MAX];
+	u8 *in_buffer[N_IN_URB_MAX];
+	unsigned int num_in_urbs;
+	unsigned int in_buflen;
+	/* Bytes inserted into the flip buffer but not pushed yet */
+	spinlock_t rx_lock;
+	unsigned int rx_unpushed;
+	struct timer_list rx_push_timer;
+	struct usb_serial_port *port;
 	/* Output endpoints and buffer for this port */
 	struct urb *out_urbs[N_OUT_URB];
 	u8 *out_buffer[N_OUT_URB];
@@ -32,8 +32,13 @@
 #include <linux/usb/cdc.h>
 #include <linux/usb/serial.h>
 #include <linux/serial.h>
+#include <linux/timer.h>
 #include "usb-wwan.h"
 
+static unsigned int n_in_urbs = N_IN_URB;
+static unsigned int in_buflen = IN_BUFLEN;
+static unsigned int rx_push_bytes = 2 * IN_BUFLEN;
+
 /*
  * Generate DTR/RTS signals on the port using the SET_CONTROL_LINE_STATE request
  * in CDC ACM.
@@ -210,13 +215,55 @@ int usb_wwan_write(struct tty_struct *tty, struct usb_serial_port *port,
 }
 EXPORT_SYMBOL(usb_wwan_write);
 
+/*
+ * Pushing the flip buffer queues the ldisc flush work, so doing it for
+ * every read URB costs a work item per URB while a modem streams.  Full
+ * URBs mean more data is on its way; hold the push back until a short
+ * one ends the burst or rx_push_bytes have piled up.  The timer covers
+ * a burst that happens to end on a URB boundary.
+ */
+static void usb_wwan_rx_push(struct usb_serial_port *port, struct urb *urb)
+{
+	struct usb_wwan_port_private *portdata;
+	unsigned int limit = READ_ONCE(rx_push_bytes);
+	unsigned long flags;
+
+	portdata = usb_get_serial_port_data(port);
+
+	/* the timer pushes too; keep the flip buffer single-producer */
+	spin_lock_irqsave(&portdata->rx_lock, flags);
+	tty_insert_flip_string(&port->port, urb->transfer_buffer,
+			       urb->actual_length);
+	portdata->rx_unpushed += urb->actual_length;
+
+	if (!limit || urb->actual_length < urb->transfer_buffer_length ||
+	    portdata->rx_unpushed >= limit) {
+		portdata->rx_unpushed = 0;
+		tty_flip_buffer_push(&port->port);
+	} else if (!timer_pending(&portdata->rx_push_timer)) {
+		mod_timer(&portdata->rx_push_timer, jiffies + 1);
+	}
+	spin_unlock_irqrestore(&portdata->rx_lock, flags);
+}
+
+static void usb_wwan_rx_push_timer(struct timer_list *t)
+{
+	struct usb_wwan_port_private *portdata = from_timer(portdata, t,
+							    rx_push_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&portdata->rx_lock, flags);
+	portdata->rx_unpushed = 0;
+	tty_flip_buffer_push(&portdata->port->port);
+	spin_unlock_irqrestore(&portdata->rx_lock, flags);
+}
+
 static void usb_wwan_indat_callback(struct urb *urb)
 {
 	int err;
 	int endpoint;
 	struct usb_serial_port *port;
 	struct device *dev;
-	unsigned char *data = urb->transfer_buffer;
 	int status = urb->status;
 
 	endpoint = usb_pipeendpoint(urb->pipe);
@@ -231,11 +278,9 @@ static void usb_wwan_indat_callback(struct urb *urb)
 		if (status == -ESHUTDOWN || status == -ENOENT)
 			return;
 	} else {
-		if (urb->actual_length) {
-			tty_insert_flip_string(&port->port, data,
-					urb->actual_length);
-			tty_flip_buffer_push(&port->port);
-		} else
+		if (urb->actual_length)
+			usb_wwan_rx_push(port, urb);
+		else
 			dev_dbg(dev, "%s: empty read urb received\n", __func__);
 	}
 	/* Resubmit urb so we continue receiving */
@@ -342,7 +387,7 @@ int usb_wwan_open(struct tty_struct *tty, struct usb_serial_port *port)
 	}
 
 	/* Start reading from the IN endpoint */
-	for (i = 0; i < N_IN_URB; i++) {
+	for (i = 0; i < portdata->num_in_urbs; i++) {
 		urb = portdata->in_urbs[i];
 		if (!urb)
 			continue;
@@ -406,8 +451,9 @@ void usb_wwan_close(struct usb_serial_port *port)
 		usb_autopm_put_interface_async(serial->interface);
 	}
 
-	for (i = 0; i < N_IN_URB; i++)
+	for (i = 0; i < portdata->num_in_urbs; i++)
 		usb_kill_urb(portdata->in_urbs[i]);
+	del_timer_sync(&portdata->rx_push_timer);
 	for (i = 0; i < N_OUT_URB; i++)
 		usb_kill_urb(portdata->out_urbs[i]);
 	usb_kill_urb(port->interrupt_in_urb);
@@ -454,16 +500,24 @@ int usb_wwan_port_probe(struct usb_serial_port *port)
 		return -ENOMEM;
 
 	init_usb_anchor(&portdata->delayed);
-
-	for (i = 0; i < N_IN_URB; i++) {
-		buffer = (u8 *)__get_free_page(GFP_KERNEL);
+	spin_lock_init(&portdata->rx_lock);
+	timer_setup(&portdata->rx_push_timer, usb_wwan_rx_push_timer, 0);
+	portdata->port = port;
+	portdata->num_in_urbs = clamp_val(n_in_urbs, 1, N_IN_URB_MAX);
+	/* bulk_in_size is a positive int here, never below one packet */
+	portdata->in_buflen = max_t(unsigned int,
+				    min_t(unsigned int, in_buflen, IN_BUFLEN_MAX),
+				    port->bulk_in_size);
+
+	for (i = 0; i < portdata->num_in_urbs; i++) {
+		buffer = kmalloc(portdata->in_buflen, GFP_KERNEL);
 		if (!buffer)
 			goto bail_out_error;
 		portdata->in_buffer[i] = buffer;
 
 		urb = usb_wwan_setup_urb(port, port->bulk_in_endpointAddress,
 						USB_DIR_IN, port,
-						buffer, IN_BUFLEN,
+						buffer, portdata->in_buflen,
 						usb_wwan_indat_callback);
 		portdata->in_urbs[i] = urb;
 	}
@@ -491,9 +545,9 @@ bail_out_error2:
 		kfree(portdata->out_buffer[i]);
 	}
 bail_out_error:
-	for (i = 0; i < N_IN_URB; i++) {
+	for (i = 0; i < portdata->num_in_urbs; i++) {
 		usb_free_urb(portdata->in_urbs[i]);
-		free_page((unsigned long)portdata->in_buffer[i]);
+		kfree(portdata->in_buffer[i]);
 	}
 	kfree(portdata);
 
@@ -509,9 +563,9 @@ void usb_wwan_port_remove(struct usb_serial_port *port)
 	portdata = usb_get_serial_port_data(port);
 	usb_set_serial_port_data(port, NULL);
 
-	for (i = 0; i < N_IN_URB; i++) {
+	for (i = 0; i < portdata->num_in_urbs; i++) {
 		usb_free_urb(portdata->in_urbs[i]);
-		free_page((unsigned long)portdata->in_buffer[i]);
+		kfree(portdata->in_buffer[i]);
 	}
 	for (i = 0; i < N_OUT_URB; i++) {
 		usb_free_urb(portdata->out_urbs[i]);
@@ -534,8 +588,10 @@ static void stop_urbs(struct usb_serial *serial)
 		portdata = usb_get_serial_port_data(port);
 		if (!portdata)
 			continue;
-		for (j = 0; j < N_IN_URB; j++)
+		for (j = 0; j < portdata->num_in_urbs; j++)
 			usb_kill_urb(portdata->in_urbs[j]);
+		if (del_timer_sync(&portdata->rx_push_timer))
+			tty_flip_buffer_push(&port->port);
 		for (j = 0; j < N_OUT_URB; j++)
 			usb_kill_urb(portdata->out_urbs[j]);
 		usb_kill_urb(port->interrupt_in_urb);
@@ -631,7 +687,7 @@ int usb_wwan_resume(struct usb_serial *serial)
 		if (err)
 			err_count++;
 
-		for (j = 0; j < N_IN_URB; j++) {
+		for (j = 0; j < portdata->num_in_urbs; j++) {
 			urb = portdata->in_urbs[j];
 			err = usb_submit_urb(urb, GFP_ATOMIC);
 			if (err < 0) {
@@ -656,3 +712,11 @@ EXPORT_SYMBOL(usb_wwan_resume);
 MODULE_AUTHOR(DRIVER_AUTHOR);
 MODULE_DESCRIPTION(DRIVER_DESC);
 MODULE_LICENSE("GPL v2");
+
+module_param(n_in_urbs, uint, 0444);
+MODULE_PARM_DESC(n_in_urbs, "Number of read URBs per port (1-32)");
+module_param(in_buflen, uint, 0444);
+MODULE_PARM_DESC(in_buflen, "Size of each read URB buffer in bytes");
+module_param(rx_push_bytes, uint, 0644);
+MODULE_PARM_DESC(rx_push_bytes,
+		 "Bytes to collect before pushing to the tty (0 = every URB)");
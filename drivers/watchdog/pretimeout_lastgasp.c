@@ -0,0 +1,349 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Last gasp watchdog pretimeout governor
+ *
+ * Use the time between pretimeout and reset for what still helps after
+ * a lockup: get the kernel log into pstore, kick writeback of dirty
+ * data and tell a remote collector over netpoll that the board is about
+ * to reset.
+ *
+ * On panic, and on the pretimeout itself, the tail of the kernel log is
+ * also sent zstd compressed to the same target, in datagrams headed by
+ * struct lastgasp_dump_hdr. Buffers are allocated up front so the dump
+ * path does not allocate.
+ */
+
+#include <linux/fs.h>
+#include <linux/atomic.h>
+#include <linux/inetdevice.h>
+#include <linux/kernel.h>
+#include <linux/kmsg_dump.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/netpoll.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/utsname.h>
+#include <linux/watchdog.h>
+#include <linux/workqueue.h>
+#include <linux/zstd.h>
+
+#include "watchdog_pretimeout.h"
+
+static char target[256];
+module_param_string(target, target, sizeof(target), 0444);
+MODULE_PARM_DESC(target,
+	"Last gasp UDP target, netconsole syntax: [src-port]@[src-ip]/[dev],[tgt-port]@<tgt-ip>/[tgt-macaddr]");
+
+static unsigned int budget_ms = 100;
+module_param(budget_ms, uint, 0644);
+MODULE_PARM_DESC(budget_ms, "Time the whole last gasp may take (default 100ms)");
+
+static unsigned int dump_kb = 64;
+module_param(dump_kb, uint, 0444);
+MODULE_PARM_DESC(dump_kb, "Kernel log tail to send compressed, 0 to disable (default 64KiB)");
+
+#define LASTGASP_DUMP_LEVEL	1
+#define LASTGASP_DUMP_CHUNK	1024
+
+struct lastgasp_dump_hdr {
+	char	magic[4];	/* "LGZ1" */
+	__be16	seq;
+	__be16	count;
+	__be32	len;		/* compressed length */
+} __packed;
+
+static struct {
+	zstd_parameters	params;
+	zstd_cctx	*cctx;
+	void		*wksp;
+	char		*src;
+	size_t		src_size;
+	void		*dst;
+	size_t		dst_size;
+	char		pkt[sizeof(struct lastgasp_dump_hdr) + LASTGASP_DUMP_CHUNK];
+} *lastgasp_dump;
+
+/* set while the pretimeout runs, the dump then has to fit its budget */
+static u64 lastgasp_deadline;
+static atomic_t lastgasp_dumping = ATOMIC_INIT(0);
+
+static struct netpoll lastgasp_np = {
+	.name		= "lastgasp",
+	.dev_name	= "eth0",
+	.local_port	= 6665,
+	.remote_port	= 6666,
+	.remote_mac	= {0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+};
+
+/* lastgasp_np_ready is read locklessly from the pretimeout path */
+static DEFINE_MUTEX(lastgasp_np_lock);
+static bool lastgasp_np_configured;
+static bool lastgasp_np_ready;
+
+static void lastgasp_np_setup(struct work_struct *work)
+{
+	mutex_lock(&lastgasp_np_lock);
+	if (lastgasp_np_configured && !lastgasp_np_ready &&
+	    !netpoll_setup(&lastgasp_np))
+		WRITE_ONCE(lastgasp_np_ready, true);
+	mutex_unlock(&lastgasp_np_lock);
+}
+static DECLARE_WORK(lastgasp_np_setup_work, lastgasp_np_setup);
+
+static void lastgasp_np_cleanup(struct work_struct *work)
+{
+	mutex_lock(&lastgasp_np_lock);
+	if (lastgasp_np_ready) {
+		WRITE_ONCE(lastgasp_np_ready, false);
+		/* pretimeouts run with interrupts off, wait for any in flight */
+		synchronize_rcu();
+		netpoll_cleanup(&lastgasp_np);
+	}
+	mutex_unlock(&lastgasp_np_lock);
+}
+static DECLARE_WORK(lastgasp_np_cleanup_work, lastgasp_np_cleanup);
+
+/* netpoll needs an address on the device, set up once one shows up */
+static int lastgasp_inetaddr_event(struct notifier_block *nb,
+				   unsigned long event, void *ptr)
+{
+	struct in_ifaddr *ifa = ptr;
+	struct net_device *dev = ifa->ifa_dev->dev;
+
+	if (event == NETDEV_UP && lastgasp_np_configured &&
+	    !strncmp(dev->name, lastgasp_np.dev_name, IFNAMSIZ))
+		schedule_work(&lastgasp_np_setup_work);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block lastgasp_inetaddr_nb = {
+	.notifier_call	= lastgasp_inetaddr_event,
+};
+
+/* don't hold the device's unregistration up */
+static int lastgasp_netdev_event(struct notifier_block *nb,
+				 unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	if (event == NETDEV_UNREGISTER && READ_ONCE(lastgasp_np_ready) &&
+	    dev == lastgasp_np.dev)
+		schedule_work(&lastgasp_np_cleanup_work);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block lastgasp_netdev_nb = {
+	.notifier_call	= lastgasp_netdev_event,
+};
+
+static void lastgasp_kmsg_dump(struct kmsg_dumper *dumper,
+			       enum kmsg_dump_reason reason)
+{
+	struct lastgasp_dump_hdr *hdr = (void *)lastgasp_dump->pkt;
+	u64 deadline = READ_ONCE(lastgasp_deadline);
+	struct kmsg_dump_iter iter;
+	unsigned int seq, count;
+	size_t len, zlen, off;
+	unsigned long flags;
+
+	if (!READ_ONCE(lastgasp_np_ready) ||
+	    atomic_cmpxchg(&lastgasp_dumping, 0, 1))
+		return;
+
+	kmsg_dump_rewind(&iter);
+	if (!kmsg_dump_get_buffer(&iter, true, lastgasp_dump->src,
+				  lastgasp_dump->src_size, &len))
+		goto out;
+
+	zlen = zstd_compress_cctx(lastgasp_dump->cctx, lastgasp_dump->dst,
+				  lastgasp_dump->dst_size, lastgasp_dump->src,
+				  len, &lastgasp_dump->params);
+	if (zstd_is_error(zlen))
+		goto out;
+
+	count = DIV_ROUND_UP(zlen, LASTGASP_DUMP_CHUNK);
+	memcpy(hdr->magic, "LGZ1", sizeof(hdr->magic));
+	hdr->count = cpu_to_be16(count);
+	hdr->len = cpu_to_be32(zlen);
+
+	/* netpoll wants interrupts off, which an oops may not have done */
+	local_irq_save(flags);
+	for (seq = 0; seq < count; seq++) {
+		if (deadline && ktime_get_mono_fast_ns() > deadline)
+			break;
+
+		off = seq * LASTGASP_DUMP_CHUNK;
+		len = min_t(size_t, zlen - off, LASTGASP_DUMP_CHUNK);
+		hdr->seq = cpu_to_be16(seq);
+		memcpy(hdr + 1, lastgasp_dump->dst + off, len);
+		netpoll_send_udp(&lastgasp_np, lastgasp_dump->pkt,
+				 sizeof(*hdr) + len);
+	}
+	local_irq_restore(flags);
+out:
+	atomic_set(&lastgasp_dumping, 0);
+}
+
+static struct kmsg_dumper lastgasp_dumper = {
+	.dump		= lastgasp_kmsg_dump,
+	.max_reason	= KMSG_DUMP_PANIC,
+};
+
+static void lastgasp_dump_free(void)
+{
+	if (!lastgasp_dump)
+		return;
+
+	kvfree(lastgasp_dump->dst);
+	kvfree(lastgasp_dump->src);
+	kvfree(lastgasp_dump->wksp);
+	kfree(lastgasp_dump);
+	lastgasp_dump = NULL;
+}
+
+static int lastgasp_dump_alloc(void)
+{
+	size_t wksp_size;
+
+	lastgasp_dump = kzalloc(sizeof(*lastgasp_dump), GFP_KERNEL);
+	if (!lastgasp_dump)
+		return -ENOMEM;
+
+	lastgasp_dump->src_size = (size_t)dump_kb * SZ_1K;
+	lastgasp_dump->params = zstd_get_params(LASTGASP_DUMP_LEVEL,
+						lastgasp_dump->src_size);
+	wksp_size = zstd_cctx_workspace_bound(&lastgasp_dump->params.cParams);
+	lastgasp_dump->wksp = kvmalloc(wksp_size, GFP_KERNEL);
+	lastgasp_dump->src = kvmalloc(lastgasp_dump->src_size, GFP_KERNEL);
+	lastgasp_dump->dst_size = zstd_compress_bound(lastgasp_dump->src_size);
+	lastgasp_dump->dst = kvmalloc(lastgasp_dump->dst_size, GFP_KERNEL);
+	if (!lastgasp_dump->wksp || !lastgasp_dump->src || !lastgasp_dump->dst)
+		goto err;
+
+	lastgasp_dump->cctx = zstd_init_cctx(lastgasp_dump->wksp, wksp_size);
+	if (!lastgasp_dump->cctx)
+		goto err;
+
+	return 0;
+
+err:
+	lastgasp_dump_free();
+	return -ENOMEM;
+}
+
+/**
+ * pretimeout_lastgasp - Save what can be saved before the watchdog resets
+ * @wdd - watchdog_device
+ *
+ * Runs from the pretimeout interrupt or hrtimer.  Each step is skipped
+ * once budget_ms is spent, so the board still resets on time.
+ */
+static void pretimeout_lastgasp(struct watchdog_device *wdd)
+{
+	u64 start = ktime_get_mono_fast_ns();
+	u64 deadline = start + (u64)budget_ms * NSEC_PER_MSEC;
+	char msg[128];
+	int len;
+
+	pr_emerg("watchdog%d: pretimeout event, reset in %us\n",
+		 wdd->id, wdd->pretimeout);
+
+	/* writeback runs from a workqueue, start it before anything else */
+	emergency_sync();
+	WRITE_ONCE(lastgasp_deadline, deadline);
+	kmsg_dump(KMSG_DUMP_PANIC);
+	WRITE_ONCE(lastgasp_deadline, 0);
+
+	if (!READ_ONCE(lastgasp_np_ready))
+		return;
+	if (ktime_get_mono_fast_ns() > deadline) {
+		pr_emerg("watchdog%d: no time left for last gasp\n", wdd->id);
+		return;
+	}
+
+	len = scnprintf(msg, sizeof(msg),
+			"last gasp: %s watchdog%d reset in %us, up %llus\n",
+			init_utsname()->nodename, wdd->id, wdd->pretimeout,
+			div_u64(start, NSEC_PER_SEC));
+	netpoll_send_udp(&lastgasp_np, msg, len);
+}
+
+static struct watchdog_governor watchdog_gov_lastgasp = {
+	.name		= "lastgasp",
+	.pretimeout	= pretimeout_lastgasp,
+};
+
+static int __init watchdog_gov_lastgasp_register(void)
+{
+	char *opt;
+	int ret;
+
+	if (target[0]) {
+		opt = kstrdup(target, GFP_KERNEL);
+		if (!opt)
+			return -ENOMEM;
+		ret = netpoll_parse_options(&lastgasp_np, opt);
+		kfree(opt);
+		if (ret)
+			return ret;
+		lastgasp_np_configured = true;
+	}
+
+	if (lastgasp_np_configured && dump_kb) {
+		ret = lastgasp_dump_alloc();
+		if (ret)
+			return ret;
+	}
+
+	ret = register_inetaddr_notifier(&lastgasp_inetaddr_nb);
+	if (ret)
+		goto err_dump;
+	ret = register_netdevice_notifier(&lastgasp_netdev_nb);
+	if (ret)
+		goto err_inetaddr;
+
+	ret = watchdog_register_governor(&watchdog_gov_lastgasp);
+	if (ret)
+		goto err_netdev;
+
+	if (lastgasp_dump)
+		kmsg_dump_register(&lastgasp_dumper);
+
+	/* the device may already be up */
+	if (lastgasp_np_configured)
+		schedule_work(&lastgasp_np_setup_work);
+
+	return 0;
+
+err_netdev:
+	unregister_netdevice_notifier(&lastgasp_netdev_nb);
+err_inetaddr:
+	unregister_inetaddr_notifier(&lastgasp_inetaddr_nb);
+err_dump:
+	lastgasp_dump_free();
+	return ret;
+}
+
+static void __exit watchdog_gov_lastgasp_unregister(void)
+{
+	if (lastgasp_dump)
+		kmsg_dump_unregister(&lastgasp_dumper);
+	watchdog_unregister_governor(&watchdog_gov_lastgasp);
+	unregister_netdevice_notifier(&lastgasp_netdev_nb);
+	unregister_inetaddr_notifier(&lastgasp_inetaddr_nb);
+	cancel_work_sync(&lastgasp_np_setup_work);
+	flush_work(&lastgasp_np_cleanup_work);
+	lastgasp_np_cleanup(NULL);
+	lastgasp_dump_free();
+}
+module_init(watchdog_gov_lastgasp_register);
+module_exit(watchdog_gov_lastgasp_unregister);
+
+MODULE_DESCRIPTION("Last gasp watchdog pretimeout governor");
+MODULE_LICENSE("GPL");
@@ -13,6 +13,7 @@
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/init.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -20,6 +21,7 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/watchdog.h>
 
@@ -31,6 +33,9 @@
 
 #define WDT_MODE_EN             (1 << 0)
 
+#define WDT_IRQ_EN              (1 << 0)
+#define WDT_IRQ_PEND            (1 << 0)
+
 #define DRV_NAME		"sunxi-wdt"
 #define DRV_VERSION		"1.0"
 
@@ -49,12 +54,18 @@ struct sunxi_wdt_reg {
 	u8 wdt_reset_mask;
 	u8 wdt_reset_val;
 	u32 wdt_key_val;
+	/* interrupt-only config value, 0 if the block has no interrupt */
+	u8 wdt_irq_val;
+	u8 wdt_irq_en;
+	u8 wdt_irq_sta;
 };
 
 struct sunxi_wdt_dev {
 	struct watchdog_device wdt_dev;
 	void __iomem *wdt_base;
 	const struct sunxi_wdt_reg *wdt_regs;
+	spinlock_t lock;
+	bool has_irq;
 };
 
 /*
@@ -80,6 +91,86 @@ static const int wdt_timeout_map[] = {
 };
 
 
+/* Nearest interval the hardware can count, rounding up or down. */
+static unsigned int sunxi_wdt_valid_timeout(unsigned int timeout, bool up)
+{
+	timeout = clamp_t(unsigned int, timeout, WDT_MIN_TIMEOUT,
+			  WDT_MAX_TIMEOUT);
+	while (wdt_timeout_map[timeout] == 0)
+		timeout += up ? 1 : -1;
+
+	return timeout;
+}
+
+/*
+ * There is a single counter, so a pretimeout runs it twice: first in
+ * interrupt-only mode for timeout - pretimeout, then, re-armed from the
+ * interrupt, in reset mode for the pretimeout itself. Without the
+ * interrupt any pretimeout comes from the core's hrtimer and the counter
+ * always runs in reset mode for the whole timeout.
+ */
+static bool sunxi_wdt_split(struct sunxi_wdt_dev *sunxi_wdt)
+{
+	return sunxi_wdt->has_irq && sunxi_wdt->wdt_dev.pretimeout;
+}
+
+static void sunxi_wdt_arm(struct sunxi_wdt_dev *sunxi_wdt, bool pre)
+{
+	struct watchdog_device *wdt_dev = &sunxi_wdt->wdt_dev;
+	void __iomem *wdt_base = sunxi_wdt->wdt_base;
+	const struct sunxi_wdt_reg *regs = sunxi_wdt->wdt_regs;
+	unsigned int interval;
+	unsigned long flags;
+	u32 reg;
+
+	if (pre)
+		interval = sunxi_wdt_valid_timeout(wdt_dev->timeout -
+						   wdt_dev->pretimeout, false);
+	else if (sunxi_wdt_split(sunxi_wdt))
+		interval = sunxi_wdt_valid_timeout(wdt_dev->pretimeout, true);
+	else
+		interval = wdt_dev->timeout;
+
+	spin_lock_irqsave(&sunxi_wdt->lock, flags);
+
+	reg = readl(wdt_base + regs->wdt_cfg);
+	reg &= ~(regs->wdt_reset_mask);
+	reg |= pre ? regs->wdt_irq_val : regs->wdt_reset_val;
+	reg |= regs->wdt_key_val;
+	writel(reg, wdt_base + regs->wdt_cfg);
+
+	writel(pre ? WDT_IRQ_EN : 0, wdt_base + regs->wdt_irq_en);
+
+	reg = readl(wdt_base + regs->wdt_mode);
+	reg &= ~(WDT_TIMEOUT_MASK << regs->wdt_timeout_shift);
+	reg |= wdt_timeout_map[interval] << regs->wdt_timeout_shift;
+	reg |= regs->wdt_key_val;
+	writel(reg, wdt_base + regs->wdt_mode);
+
+	writel(WDT_CTRL_RELOAD, wdt_base + regs->wdt_ctrl);
+
+	spin_unlock_irqrestore(&sunxi_wdt->lock, flags);
+}
+
+static irqreturn_t sunxi_wdt_irq(int irq, void *data)
+{
+	struct sunxi_wdt_dev *sunxi_wdt = data;
+	void __iomem *wdt_base = sunxi_wdt->wdt_base;
+	const struct sunxi_wdt_reg *regs = sunxi_wdt->wdt_regs;
+	u32 sta;
+
+	sta = readl(wdt_base + regs->wdt_irq_sta);
+	if (!(sta & WDT_IRQ_PEND))
+		return IRQ_NONE;
+	writel(sta, wdt_base + regs->wdt_irq_sta);
+
+	/* arm the real reset first, whatever the governor ends up doing */
+	sunxi_wdt_arm(sunxi_wdt, false);
+	watchdog_notify_pretimeout(&sunxi_wdt->wdt_dev);
+
+	return IRQ_HANDLED;
+}
+
 static int sunxi_wdt_restart(struct watchdog_device *wdt_dev,
 			     unsigned long action, void *data)
 {
@@ -124,7 +215,10 @@ static int sunxi_wdt_ping(struct watchdog_device *wdt_dev)
 	void __iomem *wdt_base = sunxi_wdt->wdt_base;
 	const struct sunxi_wdt_reg *regs = sunxi_wdt->wdt_regs;
 
-	writel(WDT_CTRL_RELOAD, wdt_base + regs->wdt_ctrl);
+	if (sunxi_wdt_split(sunxi_wdt))
+		sunxi_wdt_arm(sunxi_wdt, true);
+	else
+		writel(WDT_CTRL_RELOAD, wdt_base + regs->wdt_ctrl);
 
 	return 0;
 }
@@ -141,6 +235,8 @@ static int sunxi_wdt_set_timeout(struct watchdog_device *wdt_dev,
 		timeout++;
 
 	sunxi_wdt->wdt_dev.timeout = timeout;
+	if (wdt_dev->pretimeout >= timeout)
+		wdt_dev->pretimeout = 0;
 
 	reg = readl(wdt_base + regs->wdt_mode);
 	reg &= ~(WDT_TIMEOUT_MASK << regs->wdt_timeout_shift);
@@ -160,6 +256,20 @@ static int sunxi_wdt_stop(struct watchdog_device *wdt_dev)
 	const struct sunxi_wdt_reg *regs = sunxi_wdt->wdt_regs;
 
 	writel(regs->wdt_key_val, wdt_base + regs->wdt_mode);
+	if (regs->wdt_irq_val)
+		writel(0, wdt_base + regs->wdt_irq_en);
+
+	return 0;
+}
+
+static int sunxi_wdt_set_pretimeout(struct watchdog_device *wdt_dev,
+				    unsigned int pretimeout)
+{
+	struct sunxi_wdt_dev *sunxi_wdt = watchdog_get_drvdata(wdt_dev);
+
+	wdt_dev->pretimeout = pretimeout;
+	if (watchdog_active(wdt_dev))
+		sunxi_wdt_arm(sunxi_wdt, sunxi_wdt_split(sunxi_wdt));
 
 	return 0;
 }
@@ -190,6 +300,9 @@ static int sunxi_wdt_start(struct watchdog_device *wdt_dev)
 	reg |= regs->wdt_key_val;
 	writel(reg, wdt_base + regs->wdt_mode);
 
+	if (sunxi_wdt_split(sunxi_wdt))
+		sunxi_wdt_arm(sunxi_wdt, true);
+
 	return 0;
 }
 
@@ -200,12 +313,21 @@ static const struct watchdog_info sunxi_wdt_info = {
 			  WDIOF_MAGICCLOSE,
 };
 
+static const struct watchdog_info sunxi_wdt_pretimeout_info = {
+	.identity	= DRV_NAME,
+	.options	= WDIOF_SETTIMEOUT |
+			  WDIOF_KEEPALIVEPING |
+			  WDIOF_MAGICCLOSE |
+			  WDIOF_PRETIMEOUT,
+};
+
 static const struct watchdog_ops sunxi_wdt_ops = {
 	.owner		= THIS_MODULE,
 	.start		= sunxi_wdt_start,
 	.stop		= sunxi_wdt_stop,
 	.ping		= sunxi_wdt_ping,
 	.set_timeout	= sunxi_wdt_set_timeout,
+	.set_pretimeout	= sunxi_wdt_set_pretimeout,
 	.restart	= sunxi_wdt_restart,
 };
 
@@ -225,6 +347,9 @@ static const struct sunxi_wdt_reg sun6i_wdt_reg = {
 	.wdt_timeout_shift = 4,
 	.wdt_reset_mask = 0x03,
 	.wdt_reset_val = 0x01,
+	.wdt_irq_val = 0x02,
+	.wdt_irq_en = 0x00,
+	.wdt_irq_sta = 0x04,
 };
 
 static const struct sunxi_wdt_reg sun20i_wdt_reg = {
@@ -235,6 +360,9 @@ static const struct sunxi_wdt_reg sun20i_wdt_reg = {
 	.wdt_reset_mask = 0x03,
 	.wdt_reset_val = 0x01,
 	.wdt_key_val = 0x16aa0000,
+	.wdt_irq_val = 0x02,
+	.wdt_irq_en = 0x00,
+	.wdt_irq_sta = 0x04,
 };
 
 static const struct of_device_id sunxi_wdt_dt_ids[] = {
@@ -249,6 +377,7 @@ static int sunxi_wdt_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct sunxi_wdt_dev *sunxi_wdt;
+	int irq;
 	int err;
 
 	sunxi_wdt = devm_kzalloc(dev, sizeof(*sunxi_wdt), GFP_KERNEL);
@@ -263,7 +392,27 @@ static int sunxi_wdt_probe(struct platform_device *pdev)
 	if (IS_ERR(sunxi_wdt->wdt_base))
 		return PTR_ERR(sunxi_wdt->wdt_base);
 
-	sunxi_wdt->wdt_dev.info = &sunxi_wdt_info;
+	spin_lock_init(&sunxi_wdt->lock);
+
+	/*
+	 * Without the interrupt a pretimeout can still come from the core's
+	 * hrtimer (CONFIG_WATCHDOG_HRTIMER_PRETIMEOUT).
+	 */
+	irq = sunxi_wdt->wdt_regs->wdt_irq_val ?
+	      platform_get_irq_optional(pdev, 0) : -ENXIO;
+	if (irq == -EPROBE_DEFER)
+		return irq;
+	if (irq > 0) {
+		writel(0, sunxi_wdt->wdt_base + sunxi_wdt->wdt_regs->wdt_irq_en);
+		err = devm_request_irq(dev, irq, sunxi_wdt_irq, 0, DRV_NAME,
+				       sunxi_wdt);
+		if (err)
+			dev_warn(dev, "no pretimeout interrupt: %d\n", err);
+		else
+			sunxi_wdt->has_irq = true;
+	}
+	sunxi_wdt->wdt_dev.info = sunxi_wdt->has_irq ?
+				  &sunxi_wdt_pretimeout_info : &sunxi_wdt_info;
 	sunxi_wdt->wdt_dev.ops = &sunxi_wdt_ops;
 	sunxi_wdt->wdt_dev.timeout = WDT_MAX_TIMEOUT;
 	sunxi_wdt->wdt_dev.max_timeout = WDT_MAX_TIMEOUT;
@@ -30,18 +30,39 @@
  */
 bool fscrypt_decrypt_bio(struct bio *bio)
 {
+	struct skcipher_request *req = NULL;
+	struct crypto_skcipher *tfm = NULL;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
+	int err = 0;
 
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int err = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
+		struct crypto_skcipher *page_tfm =
+			page->mapping->host->i_crypt_info->ci_enc_key.tfm;
+
+		/* One request for the whole bio, unless it mixes keys */
+		if (page_tfm != tfm) {
+			skcipher_request_free(req);
+			tfm = page_tfm;
+			req = skcipher_request_alloc(tfm, GFP_NOFS);
+			if (!req) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+
+		err = fscrypt_decrypt_pagecache_blocks_req(req, page,
+							   bv->bv_len,
 							   bv->bv_offset);
+		if (err)
+			break;
+	}
+	skcipher_request_free(req);
 
-		if (err) {
-			bio->bi_status = errno_to_blk_status(err);
-			return false;
-		}
+	if (err) {
+		bio->bi_status = errno_to_blk_status(err);
+		return false;
 	}
 	return true;
 }
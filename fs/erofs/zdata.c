@@ -1271,6 +1271,53 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	kvfree(bgq);
 }
 
+/*
+ * Independent pclusters of a large readahead can be decompressed in
+ * parallel: cut the chain into up to one share per online CPU and hand all
+ * shares but the first to other erofs_unzipd workers.
+ */
+static void z_erofs_split_decompressqueue(struct z_erofs_decompressqueue *io)
+{
+	struct z_erofs_decompressqueue *q = NULL, *nq;
+	struct z_erofs_pcluster *pcl, *prev = NULL;
+	z_erofs_next_pcluster_t owned;
+	unsigned int nr = 0, parts, per, i;
+
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL; ++nr) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+	}
+
+	parts = min(nr, num_online_cpus());
+	if (parts < 2)
+		return;
+	per = DIV_ROUND_UP(nr, parts);
+
+	owned = io->head;
+	for (i = 0; owned != Z_EROFS_PCLUSTER_TAIL; ++i) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+
+		if (i && !(i % per)) {
+			nq = kzalloc(sizeof(*nq), GFP_ATOMIC | __GFP_NOWARN);
+			if (!nq)
+				break;
+			INIT_WORK(&nq->u.work, z_erofs_decompressqueue_work);
+			nq->sb = io->sb;
+			nq->eio = io->eio;
+			nq->head = owned;
+			/* close the previous share */
+			WRITE_ONCE(prev->next, Z_EROFS_PCLUSTER_TAIL);
+			if (q)
+				queue_work(z_erofs_workqueue, &q->u.work);
+			q = nq;
+		}
+		prev = pcl;
+		owned = READ_ONCE(pcl->next);
+	}
+	if (q)
+		queue_work(z_erofs_workqueue, &q->u.work);
+}
+
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       int bios)
 {
@@ -1285,6 +1332,7 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 
 	if (atomic_add_return(bios, &io->pending_bios))
 		return;
+	z_erofs_split_decompressqueue(io);
 	/* Use workqueue and sync decompression for atomic contexts only */
 	if (in_atomic() || irqs_disabled()) {
 		queue_work(z_erofs_workqueue, &io->u.work);
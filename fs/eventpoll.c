@@ -37,6 +37,8 @@
 #include <linux/seq_file.h>
 #include <linux/compat.h>
 #include <linux/rculist.h>
+#include <linux/llist.h>
+#include <linux/interrupt.h>
 #include <net/busy_poll.h>
 
 /*
@@ -226,6 +228,15 @@ struct eventpoll {
 	/* tracks wakeup nests for lockdep validation */
 	u8 nests;
 #endif
+
+	/*
+	 * Batched wakeups: set while the wakeup of ->wq is queued on a CPU's
+	 * batch list, and a count of such queued wakeups that ep_free() has
+	 * to wait for.
+	 */
+	atomic_t batch_queued;
+	atomic_t batch_refs;
+	struct llist_node batch_node;
 };
 
 /* Wrapper struct used by poll queueing */
@@ -240,6 +251,20 @@ struct ep_pqueue {
 /* Maximum number of epoll watched descriptors, per user */
 static long max_user_watches __read_mostly;
 
+/*
+ * Defer the waiter wakeups done by ep_poll_callback() in softirq context to
+ * the end of the softirq run, so a NAPI burst wakes each waiter once.
+ */
+static int batch_wakeups __read_mostly;
+
+/* Eventpolls whose wakeup is pending on a CPU, and the tasklet doing it */
+struct ep_batch {
+	struct llist_head list;
+	struct tasklet_struct tasklet;
+};
+
+static DEFINE_PER_CPU(struct ep_batch, ep_batch);
+
 /*
  * This mutex is used to serialize ep_free() and eventpoll_release_file().
  */
@@ -317,6 +342,15 @@ static struct ctl_table epoll_table[] = {
 		.extra1		= &long_zero,
 		.extra2		= &long_max,
 	},
+	{
+		.procname	= "batch_wakeups",
+		.data		= &batch_wakeups,
+		.maxlen		= sizeof(batch_wakeups),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{ }
 };
 
@@ -783,6 +817,9 @@ static void ep_free(struct eventpoll *ep)
 	mutex_unlock(&ep->mtx);
 
 	mutex_unlock(&epmutex);
+
+	/* No callback can queue a batched wakeup anymore, drain them */
+	wait_var_event(&ep->batch_refs, !atomic_read(&ep->batch_refs));
 	mutex_destroy(&ep->mtx);
 	free_uid(ep->user);
 	wakeup_source_unregister(ep->ws);
@@ -1115,6 +1152,48 @@ static inline bool chain_epi_lockless(struct epitem *epi)
 	return true;
 }
 
+/*
+ * Runs once per softirq run on each CPU that queued wakeups, after the
+ * softirq that delivered the events (usually NET_RX) has finished its
+ * batch.
+ */
+static void ep_batch_wake_fn(struct tasklet_struct *t)
+{
+	/* Not this_cpu: the tasklet of an offlined CPU may run elsewhere */
+	struct ep_batch *b = from_tasklet(b, t, tasklet);
+	struct llist_node *list = llist_del_all(&b->list);
+	struct eventpoll *ep, *tmp;
+
+	llist_for_each_entry_safe(ep, tmp, list, batch_node) {
+		/* Events from here on queue a new wakeup */
+		atomic_set(&ep->batch_queued, 0);
+		smp_mb__after_atomic();
+		wake_up(&ep->wq);
+		/* ep may be freed as soon as the count drops to zero */
+		if (atomic_dec_and_test(&ep->batch_refs))
+			wake_up_var(&ep->batch_refs);
+	}
+}
+
+/*
+ * Queue the wakeup of @ep->wq to the end of the current softirq run.
+ * Returns false if the caller has to wake the waiters itself.
+ */
+static bool ep_batch_wake(struct eventpoll *ep)
+{
+	if (!READ_ONCE(batch_wakeups) || !in_serving_softirq())
+		return false;
+
+	if (!atomic_xchg(&ep->batch_queued, 1)) {
+		struct ep_batch *b = this_cpu_ptr(&ep_batch);
+
+		atomic_inc(&ep->batch_refs);
+		llist_add(&ep->batch_node, &b->list);
+		tasklet_schedule(&b->tasklet);
+	}
+	return true;
+}
+
 /*
  * This is the callback that is passed to the wait queue wakeup
  * mechanism. It is called by the stored file descriptors when they
@@ -1199,8 +1278,10 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 				ewake = 1;
 				break;
 			}
+			wake_up(&ep->wq);
+		} else if (!ep_batch_wake(ep)) {
+			wake_up(&ep->wq);
 		}
-		wake_up(&ep->wq);
 	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
@@ -2391,6 +2472,7 @@ COMPAT_SYSCALL_DEFINE6(epoll_pwait2, int, epfd,
 static int __init eventpoll_init(void)
 {
 	struct sysinfo si;
+	int cpu;
 
 	si_meminfo(&si);
 	/*
@@ -2415,6 +2497,13 @@ static int __init eventpoll_init(void)
 		sizeof(struct eppoll_entry), 0, SLAB_PANIC|SLAB_ACCOUNT, NULL);
 	epoll_sysctls_init();
 
+	for_each_possible_cpu(cpu) {
+		struct ep_batch *b = per_cpu_ptr(&ep_batch, cpu);
+
+		init_llist_head(&b->list);
+		tasklet_setup(&b->tasklet, ep_batch_wake_fn);
+	}
+
 	ephead_cache = kmem_cache_create("ep_head",
 		sizeof(struct epitems_head), 0, SLAB_PANIC|SLAB_ACCOUNT, NULL);
 
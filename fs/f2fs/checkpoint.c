@@ -1940,6 +1940,55 @@ void f2fs_flush_ckpt_thread(struct f2fs_sb_info *sbi)
 		io_schedule_timeout(DEFAULT_IO_TIMEOUT);
 }
 
+static void f2fs_cp_defer_work(struct work_struct *work)
+{
+	struct f2fs_sb_info *sbi = container_of(to_delayed_work(work),
+					struct f2fs_sb_info, cp_defer_work);
+	struct super_block *sb = sbi->sb;
+
+	if (f2fs_readonly(sb) || unlikely(f2fs_cp_error(sbi)))
+		return;
+
+	/* freeze does its own checkpoint */
+	if (!sb_start_write_trylock(sb))
+		return;
+	f2fs_sync_fs(sb, 1);
+	sb_end_write(sb);
+}
+
+/*
+ * cp_defer_window is opt-in and off by default, no profile turns it on.
+ * With it set, an fsync that checkpoints only because the mount options
+ * rule out roll-forward recovery (fastboot, two active logs) does not
+ * write one itself; the data is already on disk and a single checkpoint
+ * issued at the end of the window covers every fsync in between. A crash
+ * inside the window loses what those fsyncs covered. Reasons tied to the
+ * namespace, such as a parent that was never checkpointed or a rename
+ * that strict fsync has to recover, and reasons that affect the whole
+ * filesystem still checkpoint synchronously.
+ */
+bool f2fs_defer_checkpoint(struct f2fs_sb_info *sbi,
+			enum cp_reason_type reason)
+{
+	unsigned int window = F2FS_OPTION(sbi).cp_defer_window;
+
+	if (!window)
+		return false;
+
+	switch (reason) {
+	case CP_FASTBOOT_MODE:
+	case CP_SPEC_LOG_NUM:
+		break;
+	default:
+		return false;
+	}
+
+	/* keep the earliest deadline if a checkpoint is already pending */
+	queue_delayed_work(system_unbound_wq, &sbi->cp_defer_work,
+				window * HZ);
+	return true;
+}
+
 void f2fs_init_ckpt_req_control(struct f2fs_sb_info *sbi)
 {
 	struct ckpt_req_control *cprc = &sbi->cprc_info;
@@ -1951,4 +2000,5 @@ void f2fs_init_ckpt_req_control(struct f2fs_sb_info *sbi)
 	init_waitqueue_head(&cprc->ckpt_wait_queue);
 	init_llist_head(&cprc->issue_list);
 	spin_lock_init(&cprc->stat_lock);
+	INIT_DELAYED_WORK(&sbi->cp_defer_work, f2fs_cp_defer_work);
 }
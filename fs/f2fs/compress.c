@@ -14,6 +14,8 @@
 #include <linux/lz4.h>
 #include <linux/zstd.h>
 #include <linux/pagevec.h>
+#include <linux/local_lock.h>
+#include <linux/sched/mm.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -429,6 +431,98 @@ static int zstd_compress_pages(struct compress_ctx *cc)
 	return 0;
 }
 
+/*
+ * Decompression streams shared by all zstd inodes, one per CPU and cluster
+ * size, so that reading a cluster does not allocate a window-sized
+ * workspace. They are only used from task context, see
+ * f2fs_need_decompress_work(), so a local_lock is enough to own one.
+ */
+struct f2fs_zstd_dstreams {
+	local_lock_t lock;
+	void *workspace[MAX_COMPRESS_LOG_SIZE + 1];
+	zstd_dstream *stream[MAX_COMPRESS_LOG_SIZE + 1];
+};
+
+static DEFINE_PER_CPU(struct f2fs_zstd_dstreams, f2fs_zstd_dstreams) = {
+	.lock = INIT_LOCAL_LOCK(lock),
+};
+static DEFINE_MUTEX(f2fs_zstd_dstreams_mutex);
+static unsigned long f2fs_zstd_dstreams_ready;	/* bit per cluster size */
+
+static void zstd_free_percpu_dstreams(unsigned int log_size)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct f2fs_zstd_dstreams *ds =
+				per_cpu_ptr(&f2fs_zstd_dstreams, cpu);
+
+		kvfree(ds->workspace[log_size]);
+		ds->workspace[log_size] = NULL;
+		ds->stream[log_size] = NULL;
+	}
+}
+
+static bool zstd_get_percpu_dstreams(unsigned int log_size)
+{
+	unsigned int max_window_size = MAX_COMPRESS_WINDOW_SIZE(log_size);
+	unsigned int workspace_size;
+	unsigned int nofs_flag;
+	bool ret = true;
+	int cpu;
+
+	if (smp_load_acquire(&f2fs_zstd_dstreams_ready) & BIT(log_size))
+		return true;
+
+	/* first user of this cluster size must be able to sleep */
+	if (!in_task())
+		return false;
+
+	workspace_size = zstd_dstream_workspace_bound(max_window_size);
+
+	mutex_lock(&f2fs_zstd_dstreams_mutex);
+	if (f2fs_zstd_dstreams_ready & BIT(log_size))
+		goto out;
+
+	nofs_flag = memalloc_nofs_save();
+	for_each_possible_cpu(cpu) {
+		struct f2fs_zstd_dstreams *ds =
+				per_cpu_ptr(&f2fs_zstd_dstreams, cpu);
+
+		ds->workspace[log_size] = kvmalloc(workspace_size, GFP_KERNEL);
+		if (!ds->workspace[log_size])
+			break;
+		ds->stream[log_size] = zstd_init_dstream(max_window_size,
+						ds->workspace[log_size],
+						workspace_size);
+		if (!ds->stream[log_size])
+			break;
+	}
+	memalloc_nofs_restore(nofs_flag);
+
+	if (cpu < nr_cpu_ids) {
+		zstd_free_percpu_dstreams(log_size);
+		ret = false;
+		goto out;
+	}
+
+	smp_store_release(&f2fs_zstd_dstreams_ready,
+			f2fs_zstd_dstreams_ready | BIT(log_size));
+out:
+	mutex_unlock(&f2fs_zstd_dstreams_mutex);
+	return ret;
+}
+
+static void f2fs_destroy_zstd_dstreams(void)
+{
+	unsigned int log_size;
+
+	for (log_size = 0; log_size <= MAX_COMPRESS_LOG_SIZE; log_size++)
+		if (f2fs_zstd_dstreams_ready & BIT(log_size))
+			zstd_free_percpu_dstreams(log_size);
+	f2fs_zstd_dstreams_ready = 0;
+}
+
 static int zstd_init_decompress_ctx(struct decompress_io_ctx *dic)
 {
 	zstd_dstream *stream;
@@ -437,6 +531,13 @@ static int zstd_init_decompress_ctx(struct decompress_io_ctx *dic)
 	unsigned int max_window_size =
 			MAX_COMPRESS_WINDOW_SIZE(dic->log_cluster_size);
 
+	/* NULL private2 means: use this CPU's stream at decompress time */
+	if (zstd_get_percpu_dstreams(dic->log_cluster_size)) {
+		dic->private = NULL;
+		dic->private2 = NULL;
+		return 0;
+	}
+
 	workspace_size = zstd_dstream_workspace_bound(max_window_size);
 
 	workspace = f2fs_kvmalloc(F2FS_I_SB(dic->inode),
@@ -466,9 +567,9 @@ static void zstd_destroy_decompress_ctx(struct decompress_io_ctx *dic)
 	dic->private2 = NULL;
 }
 
-static int zstd_decompress_pages(struct decompress_io_ctx *dic)
+static int __zstd_decompress_pages(struct decompress_io_ctx *dic,
+				zstd_dstream *stream)
 {
-	zstd_dstream *stream = dic->private2;
 	zstd_in_buffer inbuf;
 	zstd_out_buffer outbuf;
 	int ret;
@@ -501,6 +602,26 @@ static int zstd_decompress_pages(struct decompress_io_ctx *dic)
 	return 0;
 }
 
+static int zstd_decompress_pages(struct decompress_io_ctx *dic)
+{
+	unsigned int log_size = dic->log_cluster_size;
+	zstd_dstream *stream;
+	int ret;
+
+	if (dic->private2)
+		return __zstd_decompress_pages(dic, dic->private2);
+
+	local_lock(&f2fs_zstd_dstreams.lock);
+	stream = this_cpu_read(f2fs_zstd_dstreams.stream[log_size]);
+	if (zstd_is_error(zstd_reset_dstream(stream)))
+		ret = -EIO;
+	else
+		ret = __zstd_decompress_pages(dic, stream);
+	local_unlock(&f2fs_zstd_dstreams.lock);
+
+	return ret;
+}
+
 static bool zstd_is_level_valid(int lvl)
 {
 	return lvl >= zstd_min_clevel() && lvl <= zstd_max_clevel();
@@ -515,6 +636,8 @@ static const struct f2fs_compress_ops f2fs_zstd_ops = {
 	.decompress_pages	= zstd_decompress_pages,
 	.is_level_valid		= zstd_is_level_valid,
 };
+#else
+static inline void f2fs_destroy_zstd_dstreams(void) { }
 #endif
 
 #ifdef CONFIG_F2FS_FS_LZO
@@ -822,6 +945,31 @@ out_end_io:
 	f2fs_decompress_end_io(dic, ret, in_task);
 }
 
+static void f2fs_decompress_work(struct work_struct *work)
+{
+	struct decompress_io_ctx *dic =
+		container_of(work, struct decompress_io_ctx, decompress_work);
+
+	f2fs_decompress_cluster(dic, true);
+}
+
+/*
+ * A cluster is decompressed right in the read completion context, unless
+ * that is not a task and either the bio completed several clusters, which
+ * then go to the unbound post-read workqueue to decompress in parallel, or
+ * the cluster is to be decompressed with a per-CPU zstd stream.
+ */
+static bool f2fs_need_decompress_work(struct decompress_io_ctx *dic,
+		bool in_task, bool batched)
+{
+	if (in_task || dic->failed)
+		return false;
+	if (batched)
+		return true;
+	return F2FS_I(dic->inode)->i_compress_algorithm == COMPRESS_ZSTD &&
+		!dic->private2;
+}
+
 /*
  * This is called when a page of a compressed cluster has been read from disk
  * (or failed to be read from disk).  It checks whether this page was the last
@@ -829,7 +977,7 @@ out_end_io:
  * (or in the case of a failure, cleans up without actually decompressing).
  */
 void f2fs_end_read_compressed_page(struct page *page, bool failed,
-		block_t blkaddr, bool in_task)
+		block_t blkaddr, bool in_task, bool batched)
 {
 	struct decompress_io_ctx *dic =
 			(struct decompress_io_ctx *)page_private(page);
@@ -843,8 +991,16 @@ void f2fs_end_read_compressed_page(struct page *page, bool failed,
 		f2fs_cache_compressed_page(sbi, page,
 					dic->inode->i_ino, blkaddr);
 
-	if (atomic_dec_and_test(&dic->remaining_pages))
-		f2fs_decompress_cluster(dic, in_task);
+	if (!atomic_dec_and_test(&dic->remaining_pages))
+		return;
+
+	if (f2fs_need_decompress_work(dic, in_task, batched)) {
+		INIT_WORK(&dic->decompress_work, f2fs_decompress_work);
+		queue_work(sbi->post_read_wq, &dic->decompress_work);
+		return;
+	}
+
+	f2fs_decompress_cluster(dic, in_task);
 }
 
 static bool is_page_in_cluster(struct compress_ctx *cc, pgoff_t index)
@@ -2090,6 +2246,7 @@ out:
 
 void f2fs_destroy_compress_cache(void)
 {
+	f2fs_destroy_zstd_dstreams();
 	f2fs_destroy_dic_cache();
 	f2fs_destroy_cic_cache();
 }
@@ -132,7 +132,7 @@ static void f2fs_finish_read_bio(struct bio *bio, bool in_task)
 		if (f2fs_is_compressed_page(page)) {
 			if (bio->bi_status)
 				f2fs_end_read_compressed_page(page, true, 0,
-							in_task);
+							in_task, false);
 			f2fs_put_page_dic(page, in_task);
 			continue;
 		}
@@ -230,13 +230,32 @@ static void f2fs_handle_step_decompress(struct bio_post_read_ctx *ctx,
 	struct bvec_iter_all iter_all;
 	bool all_compressed = true;
 	block_t blkaddr = ctx->fs_blkaddr;
+	void *last_dic = NULL;
+	unsigned int nr_clusters = 0;
+
+	/*
+	 * Readahead merges several clusters into one bio; let each of them
+	 * decompress on its own CPU rather than all of them in this context.
+	 */
+	if (!in_task) {
+		bio_for_each_segment_all(bv, ctx->bio, iter_all) {
+			struct page *page = bv->bv_page;
+
+			if (!f2fs_is_compressed_page(page) ||
+					(void *)page_private(page) == last_dic)
+				continue;
+			last_dic = (void *)page_private(page);
+			if (++nr_clusters > 1)
+				break;
+		}
+	}
 
 	bio_for_each_segment_all(bv, ctx->bio, iter_all) {
 		struct page *page = bv->bv_page;
 
 		if (f2fs_is_compressed_page(page))
 			f2fs_end_read_compressed_page(page, false, blkaddr,
-						      in_task);
+						      in_task, nr_clusters > 1);
 		else
 			all_compressed = false;
 
@@ -172,7 +172,9 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->avail_nids = NM_I(sbi)->available_nids;
 	si->alloc_nids = NM_I(sbi)->nid_cnt[PREALLOC_NID];
 	si->io_skip_bggc = sbi->io_skip_bggc;
+	si->disk_skip_bggc = sbi->disk_skip_bggc;
 	si->other_skip_bggc = sbi->other_skip_bggc;
+	si->low_space_bggc = sbi->low_space_bggc;
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
 		* 100 / (int)(sbi->user_block_count >> sbi->log_blocks_per_seg)
 		/ 2;
@@ -502,8 +504,10 @@ static int stat_show(struct seq_file *s, void *v)
 				si->bg_data_blks);
 		seq_printf(s, "  - node blocks : %d (%d)\n", si->node_blks,
 				si->bg_node_blks);
-		seq_printf(s, "BG skip : IO: %u, Other: %u\n",
-				si->io_skip_bggc, si->other_skip_bggc);
+		seq_printf(s, "BG skip : IO: %u, Disk: %u, Other: %u\n",
+				si->io_skip_bggc, si->disk_skip_bggc,
+				si->other_skip_bggc);
+		seq_printf(s, "BG low space : %u\n", si->low_space_bggc);
 		seq_puts(s, "\nExtent Cache (Read):\n");
 		seq_printf(s, "  - Hit Count: L1-1:%llu L1-2:%llu L2:%llu\n",
 				si->hit_largest, si->hit_cached[EX_READ],
@@ -170,6 +170,11 @@ struct f2fs_mount_info {
 					 * be aligned to this unit: block,
 					 * segment or section
 					 */
+	unsigned int cp_defer_window;	/*
+					 * seconds an fsync-triggered
+					 * checkpoint may be deferred,
+					 * 0 (off) unless mounted with it
+					 */
 	struct fscrypt_dummy_policy dummy_enc_policy; /* test dummy encryption */
 	block_t unusable_cap_perc;	/* percentage for cap */
 	block_t unusable_cap;		/* Amount of space allowed to be
@@ -848,6 +853,13 @@ struct f2fs_inode_info {
 
 	unsigned int atomic_write_cnt;
 	loff_t original_i_size;		/* original i_size before atomic write */
+
+#ifdef CONFIG_F2FS_IOSTAT
+	/* for per-file write amplification, in memory only */
+	atomic64_t i_app_write_bytes;	/* bytes written by the application */
+	atomic64_t i_data_write_bytes;	/* data bytes written to the device */
+	atomic64_t i_node_write_bytes;	/* node bytes written by fsync */
+#endif
 };
 
 static inline void get_read_extent_info(struct extent_info *ext,
@@ -1585,6 +1597,7 @@ struct decompress_io_ctx {
 	void *private2;			/* extra payload buffer */
 	struct work_struct verity_work;	/* work to verify the decompressed pages */
 	struct work_struct free_work;	/* work for late free this structure itself */
+	struct work_struct decompress_work;	/* work to decompress in task */
 };
 
 #define NULL_CLUSTER			((unsigned int)(~0))
@@ -1634,6 +1647,7 @@ struct f2fs_sb_info {
 	unsigned long last_time[MAX_TIME];	/* to store time in jiffies */
 	long interval_time[MAX_TIME];		/* to store thresholds */
 	struct ckpt_req_control cprc_info;	/* for checkpoint request control */
+	struct delayed_work cp_defer_work;	/* deferred fsync checkpoint */
 
 	struct inode_management im[MAX_INO_ENTRY];	/* manage inode cache */
 
@@ -1752,7 +1766,9 @@ struct f2fs_sb_info {
 	atomic_t atomic_files;			/* # of opened atomic file */
 	atomic_t max_aw_cnt;			/* max # of atomic writes */
 	unsigned int io_skip_bggc;		/* skip background gc for in-flight IO */
+	unsigned int disk_skip_bggc;		/* skip background gc for busy disk */
 	unsigned int other_skip_bggc;		/* skip background gc for other reasons */
+	unsigned int low_space_bggc;		/* background gc despite busy I/O */
 	unsigned int ndirty_inode[NR_INODE_TYPE];	/* # of dirty inodes */
 #endif
 	spinlock_t stat_lock;			/* lock for stat operations */
@@ -3767,6 +3783,8 @@ int f2fs_issue_checkpoint(struct f2fs_sb_info *sbi);
 int f2fs_start_ckpt_thread(struct f2fs_sb_info *sbi);
 void f2fs_stop_ckpt_thread(struct f2fs_sb_info *sbi);
 void f2fs_init_ckpt_req_control(struct f2fs_sb_info *sbi);
+bool f2fs_defer_checkpoint(struct f2fs_sb_info *sbi,
+			enum cp_reason_type reason);
 
 /*
  * data.c
@@ -3880,7 +3898,8 @@ struct f2fs_stat_info {
 	int bg_gc, nr_wb_cp_data, nr_wb_data;
 	int nr_rd_data, nr_rd_node, nr_rd_meta;
 	int nr_dio_read, nr_dio_write;
-	unsigned int io_skip_bggc, other_skip_bggc;
+	unsigned int io_skip_bggc, disk_skip_bggc, other_skip_bggc;
+	unsigned int low_space_bggc;
 	int nr_flushing, nr_flushed, flush_list_empty;
 	int nr_discarding, nr_discarded;
 	int nr_discard_cmd;
@@ -3926,7 +3945,9 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_call_count(si)		((si)->call_count++)
 #define stat_inc_bggc_count(si)		((si)->bg_gc++)
 #define stat_io_skip_bggc_count(sbi)	((sbi)->io_skip_bggc++)
+#define stat_disk_skip_bggc_count(sbi)	((sbi)->disk_skip_bggc++)
 #define stat_other_skip_bggc_count(sbi)	((sbi)->other_skip_bggc++)
+#define stat_low_space_bggc_count(sbi)	((sbi)->low_space_bggc++)
 #define stat_inc_dirty_inode(sbi, type)	((sbi)->ndirty_inode[type]++)
 #define stat_dec_dirty_inode(sbi, type)	((sbi)->ndirty_inode[type]--)
 #define stat_inc_total_hit(sbi, type)		(atomic64_inc(&(sbi)->total_hit_ext[type]))
@@ -4052,7 +4073,9 @@ void f2fs_update_sit_info(struct f2fs_sb_info *sbi);
 #define stat_inc_call_count(si)				do { } while (0)
 #define stat_inc_bggc_count(si)				do { } while (0)
 #define stat_io_skip_bggc_count(sbi)			do { } while (0)
+#define stat_disk_skip_bggc_count(sbi)			do { } while (0)
 #define stat_other_skip_bggc_count(sbi)			do { } while (0)
+#define stat_low_space_bggc_count(sbi)			do { } while (0)
 #define stat_inc_dirty_inode(sbi, type)			do { } while (0)
 #define stat_dec_dirty_inode(sbi, type)			do { } while (0)
 #define stat_inc_total_hit(sbi, type)			do { } while (0)
@@ -4237,7 +4260,7 @@ int f2fs_init_compress_mempool(void);
 void f2fs_destroy_compress_mempool(void);
 void f2fs_decompress_cluster(struct decompress_io_ctx *dic, bool in_task);
 void f2fs_end_read_compressed_page(struct page *page, bool failed,
-				block_t blkaddr, bool in_task);
+				block_t blkaddr, bool in_task, bool batched);
 bool f2fs_cluster_is_empty(struct compress_ctx *cc);
 bool f2fs_cluster_can_merge_page(struct compress_ctx *cc, pgoff_t index);
 bool f2fs_all_cluster_page_ready(struct compress_ctx *cc, struct page **pages,
@@ -4309,7 +4332,8 @@ static inline void f2fs_destroy_compress_mempool(void) { }
 static inline void f2fs_decompress_cluster(struct decompress_io_ctx *dic,
 				bool in_task) { }
 static inline void f2fs_end_read_compressed_page(struct page *page,
-				bool failed, block_t blkaddr, bool in_task)
+				bool failed, block_t blkaddr, bool in_task,
+				bool batched)
 {
 	WARN_ON_ONCE(1);
 }
@@ -323,6 +323,10 @@ go_write:
 	f2fs_up_read(&F2FS_I(inode)->i_sem);
 
 	if (cp_reason) {
+		/* bounded by cp_defer_window; flags stay set for next fsync */
+		if (f2fs_defer_checkpoint(sbi, cp_reason))
+			goto out;
+
 		/* all the dirty node pages should be flushed for POR */
 		ret = f2fs_sync_fs(inode->i_sb, 1);
 
@@ -3398,6 +3402,24 @@ static int f2fs_get_compress_blocks(struct file *filp, unsigned long arg)
 	return put_user(blocks, (u64 __user *)arg);
 }
 
+static int f2fs_ioc_get_write_amp(struct file *filp, unsigned long arg)
+{
+#ifdef CONFIG_F2FS_IOSTAT
+	struct f2fs_inode_info *fi = F2FS_I(file_inode(filp));
+	struct f2fs_file_wa wa;
+
+	wa.app_bytes = atomic64_read(&fi->i_app_write_bytes);
+	wa.data_bytes = atomic64_read(&fi->i_data_write_bytes);
+	wa.node_bytes = atomic64_read(&fi->i_node_write_bytes);
+
+	if (copy_to_user((struct f2fs_file_wa __user *)arg, &wa, sizeof(wa)))
+		return -EFAULT;
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 static int release_compress_blocks(struct dnode_of_data *dn, pgoff_t count)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(dn->inode);
@@ -4278,6 +4300,8 @@ static long __f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return f2fs_ioc_decompress_file(filp, arg);
 	case F2FS_IOC_COMPRESS_FILE:
 		return f2fs_ioc_compress_file(filp, arg);
+	case F2FS_IOC_GET_WRITE_AMP:
+		return f2fs_ioc_get_write_amp(filp, arg);
 	default:
 		return -ENOTTY;
 	}
@@ -4911,6 +4935,7 @@ long f2fs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case F2FS_IOC_SET_COMPRESS_OPTION:
 	case F2FS_IOC_DECOMPRESS_FILE:
 	case F2FS_IOC_COMPRESS_FILE:
+	case F2FS_IOC_GET_WRITE_AMP:
 		break;
 	default:
 		return -ENOIOCTLCMD;
@@ -28,6 +28,35 @@ static struct kmem_cache *victim_entry_slab;
 static unsigned int count_bits(const unsigned long *addr,
 				unsigned int offset, unsigned int len);
 
+/*
+ * The block layer stamps each partition and its whole disk with the
+ * jiffies of the last I/O start or completion, so this also sees I/O
+ * to other partitions on the same card.
+ */
+static bool __is_disk_idle(struct block_device *bdev, unsigned long idle)
+{
+	return time_after_eq(jiffies,
+			     READ_ONCE(bdev_whole(bdev)->bd_stamp) + idle);
+}
+
+static bool is_disk_idle(struct f2fs_sb_info *sbi)
+{
+	unsigned long idle = msecs_to_jiffies(sbi->gc_thread->disk_idle_time);
+	int i;
+
+	if (!idle)
+		return true;
+
+	if (!f2fs_is_multi_device(sbi))
+		return __is_disk_idle(sbi->sb->s_bdev, idle);
+
+	for (i = 0; i < sbi->s_ndevs; i++) {
+		if (!__is_disk_idle(FDEV(i).bdev, idle))
+			return false;
+	}
+	return true;
+}
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
@@ -111,6 +140,13 @@ static int gc_thread_func(void *data)
 			goto next;
 		}
 
+		if (gc_low_on_free_secs(sbi)) {
+			/* Running out of space, don't wait for idle I/O */
+			wait_ms = gc_th->urgent_sleep_time;
+			stat_low_space_bggc_count(sbi);
+			goto do_gc;
+		}
+
 		if (!is_idle(sbi, GC_TIME)) {
 			increase_sleep_time(gc_th, &wait_ms);
 			f2fs_up_write(&sbi->gc_lock);
@@ -118,6 +154,13 @@ static int gc_thread_func(void *data)
 			goto next;
 		}
 
+		if (!is_disk_idle(sbi)) {
+			increase_sleep_time(gc_th, &wait_ms);
+			f2fs_up_write(&sbi->gc_lock);
+			stat_disk_skip_bggc_count(sbi);
+			goto next;
+		}
+
 		if (has_enough_invalid_blocks(sbi))
 			decrease_sleep_time(gc_th, &wait_ms);
 		else
@@ -183,6 +226,8 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->disk_idle_time = DEF_GC_THREAD_DISK_IDLE_TIME;
+	gc_th->low_free_ratio = DEF_GC_THREAD_LOW_FREE_RATIO;
 
 	gc_th->gc_wake = 0;
 
@@ -1406,7 +1451,7 @@ static int move_data_block(struct inode *inode, block_t bidx,
 		goto put_page_out;
 	}
 
-	f2fs_update_iostat(fio.sbi, NULL, FS_GC_DATA_IO, F2FS_BLKSIZE);
+	f2fs_update_iostat(fio.sbi, inode, FS_GC_DATA_IO, F2FS_BLKSIZE);
 
 	f2fs_update_data_blkaddr(&dn, newaddr);
 	set_inode_flag(inode, FI_APPEND_WRITE);
@@ -14,6 +14,8 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_DISK_IDLE_TIME	0	/* ms, 0: f2fs I/O only */
+#define DEF_GC_THREAD_LOW_FREE_RATIO	0	/* % of free sections, 0: off */
 
 /* choose candidates from sections which has age of more than 7 days */
 #define DEF_GC_THREAD_AGE_THRESHOLD		(60 * 60 * 24 * 7)
@@ -42,6 +44,14 @@ struct f2fs_gc_kthread {
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
 
+	/*
+	 * Background GC also waits until the whole disk, i.e. other
+	 * partitions on it too, saw no I/O for disk_idle_time ms, unless
+	 * free sections dropped below low_free_ratio percent.
+	 */
+	unsigned int disk_idle_time;
+	unsigned int low_free_ratio;
+
 	/* for changing gc mode */
 	unsigned int gc_wake;
 
@@ -151,6 +161,14 @@ static inline void decrease_sleep_time(struct f2fs_gc_kthread *gc_th,
 		*wait -= min_time;
 }
 
+static inline bool gc_low_on_free_secs(struct f2fs_sb_info *sbi)
+{
+	unsigned int ratio = sbi->gc_thread->low_free_ratio;
+
+	return ratio && free_sections(sbi) < div_u64((u64)MAIN_SECS(sbi) *
+						       ratio, 100);
+}
+
 static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 {
 	block_t user_block_count = sbi->user_block_count;
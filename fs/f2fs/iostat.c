@@ -169,11 +169,41 @@ void f2fs_reset_iostat(struct f2fs_sb_info *sbi)
 	spin_unlock_irq(&sbi->iostat_lat_lock);
 }
 
+void f2fs_update_file_wa(struct inode *inode, enum iostat_type type,
+			unsigned long long io_bytes)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (!F2FS_I_SB(inode)->iostat_enable)
+		return;
+
+	switch (type) {
+	case APP_BUFFERED_IO:
+	case APP_DIRECT_IO:
+	case APP_MAPPED_IO:
+		atomic64_add(io_bytes, &fi->i_app_write_bytes);
+		break;
+	case FS_DATA_IO:
+	case FS_GC_DATA_IO:
+	case FS_CP_DATA_IO:
+		atomic64_add(io_bytes, &fi->i_data_write_bytes);
+		break;
+	case FS_NODE_IO:
+		atomic64_add(io_bytes, &fi->i_node_write_bytes);
+		break;
+	default:
+		break;
+	}
+}
+
 void f2fs_update_iostat(struct f2fs_sb_info *sbi, struct inode *inode,
 			enum iostat_type type, unsigned long long io_bytes)
 {
 	unsigned long flags;
 
+	if (inode)
+		f2fs_update_file_wa(inode, type, io_bytes);
+
 	if (!sbi->iostat_enable)
 		return;
 
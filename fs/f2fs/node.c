@@ -1849,8 +1849,11 @@ continue_unlock:
 		goto retry;
 	}
 out:
-	if (nwritten)
+	if (nwritten) {
+		f2fs_update_file_wa(inode, FS_NODE_IO,
+				(unsigned long long)nwritten * F2FS_BLKSIZE);
 		f2fs_submit_merged_write_cond(sbi, NULL, NULL, ino, NODE);
+	}
 	return ret ? -EIO : 0;
 }
 
@@ -161,6 +161,8 @@ enum {
 	Opt_nogc_merge,
 	Opt_discard_unit,
 	Opt_memory_mode,
+	Opt_cp_defer_window,
+	Opt_profile,
 	Opt_err,
 };
 
@@ -238,6 +240,8 @@ static match_table_t f2fs_tokens = {
 	{Opt_nogc_merge, "nogc_merge"},
 	{Opt_discard_unit, "discard_unit=%s"},
 	{Opt_memory_mode, "memory=%s"},
+	{Opt_cp_defer_window, "cp_defer_window=%u"},
+	{Opt_profile, "profile=%s"},
 	{Opt_err, NULL},
 };
 
@@ -1289,6 +1293,36 @@ static int parse_options(struct super_block *sb, char *options, bool is_remount)
 			}
 			kfree(name);
 			break;
+		case Opt_cp_defer_window:
+			if (args->from && match_int(args, &arg))
+				return -EINVAL;
+			if (arg < 0 || arg > 60) {
+				f2fs_err(sbi, "cp_defer_window should be 0 - 60 seconds");
+				return -EINVAL;
+			}
+			F2FS_OPTION(sbi).cp_defer_window = arg;
+			break;
+		case Opt_profile:
+			name = match_strdup(&args[0]);
+			if (!name)
+				return -ENOMEM;
+			if (!strcmp(name, "sdcard")) {
+				/*
+				 * Flash cards with a small FTL: keep every
+				 * log appending and discard whole sections.
+				 * fsync durability is left alone, see
+				 * cp_defer_window. Options given after the
+				 * profile still override it.
+				 */
+				F2FS_OPTION(sbi).fs_mode = FS_MODE_LFS;
+				F2FS_OPTION(sbi).discard_unit =
+						DISCARD_UNIT_SECTION;
+			} else if (strcmp(name, "default")) {
+				kfree(name);
+				return -EINVAL;
+			}
+			kfree(name);
+			break;
 		default:
 			f2fs_err(sbi, "Unrecognized mount option \"%s\" or missing value",
 				 p);
@@ -1412,6 +1446,11 @@ static struct inode *f2fs_alloc_inode(struct super_block *sb)
 	/* Initialize f2fs-specific inode info */
 	atomic_set(&fi->dirty_pages, 0);
 	atomic_set(&fi->i_compr_blocks, 0);
+#ifdef CONFIG_F2FS_IOSTAT
+	atomic64_set(&fi->i_app_write_bytes, 0);
+	atomic64_set(&fi->i_data_write_bytes, 0);
+	atomic64_set(&fi->i_node_write_bytes, 0);
+#endif
 	init_f2fs_rwsem(&fi->i_sem);
 	spin_lock_init(&fi->i_size_lock);
 	INIT_LIST_HEAD(&fi->dirty_list);
@@ -1580,6 +1619,9 @@ static void f2fs_put_super(struct super_block *sb)
 
 	f2fs_quota_off_umount(sb);
 
+	/* the checkpoint below covers any deferred one */
+	cancel_delayed_work_sync(&sbi->cp_defer_work);
+
 	/* prevent remaining shrinker jobs */
 	mutex_lock(&sbi->umount_mutex);
 
@@ -2069,6 +2111,10 @@ static int f2fs_show_options(struct seq_file *seq, struct dentry *root)
 	else if (F2FS_OPTION(sbi).memory_mode == MEMORY_MODE_LOW)
 		seq_printf(seq, ",memory=%s", "low");
 
+	if (F2FS_OPTION(sbi).cp_defer_window)
+		seq_printf(seq, ",cp_defer_window=%u",
+				F2FS_OPTION(sbi).cp_defer_window);
+
 	return 0;
 }
 
@@ -2091,6 +2137,7 @@ static void default_options(struct f2fs_sb_info *sbi)
 	F2FS_OPTION(sbi).compress_mode = COMPR_MODE_FS;
 	F2FS_OPTION(sbi).bggc_mode = BGGC_MODE_ON;
 	F2FS_OPTION(sbi).memory_mode = MEMORY_MODE_NORMAL;
+	F2FS_OPTION(sbi).cp_defer_window = 0;
 
 	sbi->sb->s_flags &= ~SB_INLINECRYPT;
 
@@ -35,6 +35,7 @@ struct timerfd_ctx {
 	} t;
 	ktime_t tintv;
 	ktime_t moffs;
+	u64 slack;
 	wait_queue_head_t wqh;
 	u64 ticks;
 	int clockid;
@@ -221,7 +222,8 @@ static int timerfd_setup(struct timerfd_ctx *ctx, int flags,
 			else
 				alarm_start_relative(&ctx->t.alarm, texp);
 		} else {
-			hrtimer_start(&ctx->t.tmr, texp, htmode);
+			hrtimer_start_range_ns(&ctx->t.tmr, texp, ctx->slack,
+					       htmode);
 		}
 
 		if (timerfd_canceled(ctx))
@@ -346,13 +348,32 @@ static void timerfd_show(struct seq_file *m, struct file *file)
 #define timerfd_show NULL
 #endif
 
-#ifdef CONFIG_CHECKPOINT_RESTORE
 static long timerfd_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct timerfd_ctx *ctx = file->private_data;
 	int ret = 0;
 
 	switch (cmd) {
+	/*
+	 * Let the timer fire up to slack ns late, from the next
+	 * timerfd_settime() on. The hrtimer core then serves all timers
+	 * whose windows overlap with one interrupt, and epoll reports
+	 * the whole batch with one wakeup.
+	 */
+	case TFD_IOC_SET_SLACK: {
+		u64 slack;
+
+		if (copy_from_user(&slack, (u64 __user *)arg, sizeof(slack)))
+			return -EFAULT;
+		if (isalarm(ctx) || slack > KTIME_MAX)
+			return -EINVAL;
+
+		spin_lock_irq(&ctx->wqh.lock);
+		ctx->slack = slack;
+		spin_unlock_irq(&ctx->wqh.lock);
+		break;
+	}
+#ifdef CONFIG_CHECKPOINT_RESTORE
 	case TFD_IOC_SET_TICKS: {
 		u64 ticks;
 
@@ -370,6 +391,7 @@ static long timerfd_ioctl(struct file *file, unsigned int cmd, unsigned long arg
 		spin_unlock_irq(&ctx->wqh.lock);
 		break;
 	}
+#endif
 	default:
 		ret = -ENOTTY;
 		break;
@@ -377,9 +399,6 @@ static long timerfd_ioctl(struct file *file, unsigned int cmd, unsigned long arg
 
 	return ret;
 }
-#else
-#define timerfd_ioctl NULL
-#endif
 
 static const struct file_operations timerfd_fops = {
 	.release	= timerfd_release,
@@ -188,11 +188,17 @@ struct shash_desc {
  * @exit_tfm: Deinitialize the cryptographic transformation object.
  *	      This is a counterpart to @init_tfm, used to remove
  *	      various changes set in @init_tfm.
+ * @finup_mb: **[optional]** Finish up to @mb_max_msgs equal length messages
+ *	      that all continue from the state in @desc, writing one digest
+ *	      per message. Implementations interleave the messages to make
+ *	      better use of SIMD units; @desc is left unchanged.
  * @digestsize: see struct ahash_alg
  * @statesize: see struct ahash_alg
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Maximum number of messages @finup_mb can take at once, or 1
+ *		 if it is not implemented.
  * @base: internally used
  */
 struct shash_alg {
@@ -210,8 +216,12 @@ struct shash_alg {
 		      unsigned int keylen);
 	int (*init_tfm)(struct crypto_shash *tfm);
 	void (*exit_tfm)(struct crypto_shash *tfm);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	/* These fields must match hash_alg_common. */
 	unsigned int digestsize
@@ -795,6 +805,18 @@ static inline unsigned int crypto_shash_statesize(struct crypto_shash *tfm)
 	return crypto_shash_alg(tfm)->statesize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - number of messages hashed in parallel
+ * @tfm: cipher handle
+ *
+ * Return: the largest batch crypto_shash_finup_mb() processes in one go;
+ *	   1 if the implementation hashes one message at a time.
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline u32 crypto_shash_get_flags(struct crypto_shash *tfm)
 {
 	return crypto_tfm_get_flags(crypto_shash_tfm(tfm));
@@ -998,6 +1020,25 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - finish hashing several messages at once
+ * @desc: state common to all messages, e.g. after hashing a salt; not
+ *	  modified
+ * @data: the remaining data of each message
+ * @len: length of each element of @data; all messages are the same length
+ * @outs: digest buffer for each message
+ * @num_msgs: number of messages, at most crypto_shash_mb_max_msgs()
+ *
+ * Equivalent to calling crypto_shash_finup() on a copy of @desc for each
+ * message, but lets the implementation interleave the messages.
+ *
+ * Context: Any context.
+ * Return: 0 if all digests were computed; < 0 if an error occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
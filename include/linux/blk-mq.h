@@ -294,6 +294,22 @@ enum blk_eh_timer_return {
 #define BLK_TAG_ALLOC_FIFO 0 /* allocate starting from 0 */
 #define BLK_TAG_ALLOC_RR 1 /* allocate starting from last allocated tag */
 
+/* Operation types with a completion latency histogram. */
+enum {
+	BLK_MQ_LAT_READ,
+	BLK_MQ_LAT_WRITE,
+	BLK_MQ_LAT_FLUSH,
+	BLK_MQ_LAT_DISCARD,
+	BLK_MQ_LAT_OPS,
+};
+
+/*
+ * Bucket 0 counts requests that completed in less than 2048 ns, bucket i
+ * (i > 0) those that took [1024 << i, 2048 << i) ns and the last bucket
+ * everything slower.
+ */
+#define BLK_MQ_LAT_BUCKETS	24
+
 /**
  * struct blk_mq_hw_ctx - State for a hardware queue facing the hardware
  * block device
@@ -410,6 +426,11 @@ struct blk_mq_hw_ctx {
 	unsigned long		queued;
 	/** @run: Number of dispatched requests. */
 	unsigned long		run;
+	/**
+	 * @lat_hist: log2 histogram of the time from request allocation to
+	 * completion, per operation type. Updated without locking.
+	 */
+	unsigned long		lat_hist[BLK_MQ_LAT_OPS][BLK_MQ_LAT_BUCKETS];
 
 	/** @numa_node: NUMA node the storage adapter has been connected to. */
 	unsigned int		numa_node;
@@ -111,6 +111,8 @@ struct bpf_map_ops {
 	u32 (*map_fd_sys_lookup_elem)(void *ptr);
 	void (*map_seq_show_elem)(struct bpf_map *map, void *key,
 				  struct seq_file *m);
+	/* Map type specific lines for /proc/<pid>/fdinfo */
+	void (*map_show_fdinfo)(const struct bpf_map *map, struct seq_file *m);
 	int (*map_check_btf)(const struct bpf_map *map,
 			     const struct btf *btf,
 			     const struct btf_type *key_type,
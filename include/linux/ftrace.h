@@ -1013,6 +1013,11 @@ extern int ftrace_graph_entry_stub(struct ftrace_graph_ent *trace);
 struct fgraph_ops {
 	trace_func_graph_ent_t		entryfunc;
 	trace_func_graph_ret_t		retfunc;
+	/*
+	 * Optional: hook only the functions in @filter_ops's filter hash
+	 * instead of those in set_ftrace_filter (the global ops).
+	 */
+	struct ftrace_ops		*filter_ops;
 };
 
 /*
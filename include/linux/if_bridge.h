@@ -59,6 +59,7 @@ struct br_ip_list {
 #define BR_MRP_LOST_IN_CONT	BIT(19)
 #define BR_TX_FWD_OFFLOAD	BIT(20)
 #define BR_PORT_LOCKED		BIT(21)
+#define BR_NF_SKIP		BIT(22)
 
 #define BR_DEFAULT_AGEING_TIME	(300 * HZ)
 
@@ -69,6 +69,7 @@
 #define SUN4I_GPADC_INT_FIFOS_TEMP_DATA_PENDING		BIT(18)
 #define SUN4I_GPADC_INT_FIFOS_FIFO_OVERRUN_PENDING	BIT(17)
 #define SUN4I_GPADC_INT_FIFOS_FIFO_DATA_PENDING		BIT(16)
+#define SUN4I_GPADC_INT_FIFOS_RXA_CNT(x)		(((x) >> 8) & GENMASK(5, 0))
 #define SUN4I_GPADC_INT_FIFOS_TP_IDLE_FLG		BIT(2)
 #define SUN4I_GPADC_INT_FIFOS_TP_UP_PENDING		BIT(1)
 #define SUN4I_GPADC_INT_FIFOS_TP_DOWN_PENDING		BIT(0)
@@ -77,6 +78,8 @@
 #define SUN4I_GPADC_TEMP_DATA				0x20
 #define SUN4I_GPADC_DATA				0x24
 
+#define SUN4I_GPADC_FIFO_DEPTH				32
+
 #define SUN4I_GPADC_IRQ_FIFO_DATA			1
 #define SUN4I_GPADC_IRQ_TEMP_DATA			2
 
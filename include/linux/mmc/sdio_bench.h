@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ *  include/linux/mmc/sdio_bench.h
+ *
+ *  Raw SDIO read benchmark for the debug files of SDIO function drivers
+ */
+
+#ifndef LINUX_MMC_SDIO_BENCH_H
+#define LINUX_MMC_SDIO_BENCH_H
+
+#include <linux/mutex.h>
+#include <linux/types.h>
+
+struct seq_file;
+
+#define SDIO_BENCH_RUNS		8	/* runs kept for reading back */
+#define SDIO_BENCH_MAX_COUNT	100000
+
+struct sdio_bench_result {
+	u32 size;
+	u32 count;
+	u32 errors;
+	u64 total_ns;
+	u64 lat_min_ns;
+	u64 lat_max_ns;
+};
+
+/*
+ * Embedded in the driver's private data. @read does one transfer of
+ * @size bytes into @buf and returns 0 on success; the driver gets back
+ * to its own data with container_of().
+ */
+struct sdio_bench {
+	int (*read)(struct sdio_bench *bench, void *buf, u32 size);
+	u32 max_size;
+	u32 size_align;
+	struct mutex lock;	/* one run at a time, protects runs[] */
+	struct sdio_bench_result runs[SDIO_BENCH_RUNS];
+	unsigned int nr_runs;
+};
+
+void sdio_bench_init(struct sdio_bench *bench,
+		     int (*read)(struct sdio_bench *bench, void *buf, u32 size),
+		     u32 max_size, u32 size_align);
+ssize_t sdio_bench_write(struct sdio_bench *bench, const char __user *ubuf,
+			 size_t count);
+void sdio_bench_show(struct seq_file *m, struct sdio_bench *bench);
+
+#endif /* LINUX_MMC_SDIO_BENCH_H */
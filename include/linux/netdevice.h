@@ -217,11 +217,17 @@ struct net_device_core_stats {
 #include <linux/cache.h>
 #include <linux/skbuff.h>
 
-#ifdef CONFIG_RPS
+/* per-cpu drop reason counters, allocated by register_netdevice() */
+struct net_device_drop_stats {
+	unsigned long	reasons[SKB_DROP_REASON_MAX];
+};
+
 #include <linux/static_key.h>
+#ifdef CONFIG_RPS
 extern struct static_key_false rps_needed;
 extern struct static_key_false rfs_needed;
 #endif
+extern struct static_key_false netdev_drop_stats_key;
 
 struct neighbour;
 struct neigh_parms;
@@ -520,6 +526,7 @@ static inline bool napi_complete(struct napi_struct *n)
 }
 
 int dev_set_threaded(struct net_device *dev, bool threaded);
+int dev_set_napi_fanout(struct net_device *dev, bool fanout);
 
 /**
  *	napi_disable - prevent NAPI from scheduling
@@ -1797,6 +1804,8 @@ enum netdev_ml_priv_type {
  *
  *	@core_stats:	core networking counters,
  *			do not use this in drivers
+ *	@drop_stats:	per drop reason counters of freed skbs,
+ *			do not use this in drivers
  *	@carrier_up_count:	Number of times the carrier has been up
  *	@carrier_down_count:	Number of times the carrier has been down
  *
@@ -1985,6 +1994,7 @@ enum netdev_ml_priv_type {
  *	@wol_enabled:	Wake-on-LAN is enabled
  *
  *	@threaded:	napi threaded mode is enabled
+ *	@napi_fanout:	received packets are spread over per-CPU threads
  *
  *	@net_notifier_list:	List of per-net netdev notifier block
  *				that follow this device when it is moved
@@ -2083,6 +2093,7 @@ struct net_device {
 	struct net_device_stats	stats; /* not used by modern drivers */
 
 	struct net_device_core_stats __percpu *core_stats;
+	struct net_device_drop_stats __percpu *drop_stats;
 
 	/* Stats to monitor link on/off, flapping */
 	atomic_t		carrier_up_count;
@@ -2343,6 +2354,7 @@ struct net_device {
 	bool			proto_down;
 	unsigned		wol_enabled:1;
 	unsigned		threaded:1;
+	unsigned		napi_fanout:1;
 
 	struct list_head	net_notifier_list;
 
@@ -2824,6 +2836,8 @@ const char *netdev_cmd_to_name(enum netdev_cmd cmd);
 
 int register_netdevice_notifier(struct notifier_block *nb);
 int unregister_netdevice_notifier(struct notifier_block *nb);
+int register_netdev_rx_pressure_notifier(struct notifier_block *nb);
+int unregister_netdev_rx_pressure_notifier(struct notifier_block *nb);
 int register_netdevice_notifier_net(struct net *net, struct notifier_block *nb);
 int unregister_netdevice_notifier_net(struct net *net,
 				      struct notifier_block *nb);
@@ -3945,6 +3959,22 @@ static inline struct net_device_core_stats __percpu *dev_core_stats(struct net_d
 	return netdev_core_stats_alloc(dev);
 }
 
+/* Count a drop against @dev, for callers that hold a reference on it or
+ * run in its RX/TX path. Off unless net.core.dev_drop_stats is set.
+ */
+static inline void dev_drop_stats_inc(struct net_device *dev,
+				      enum skb_drop_reason reason)
+{
+	struct net_device_drop_stats __percpu *p;
+
+	if (!static_branch_unlikely(&netdev_drop_stats_key))
+		return;
+
+	p = dev->drop_stats;
+	if (likely(p && (unsigned int)reason < SKB_DROP_REASON_MAX))
+		this_cpu_inc(p->reasons[reason]);
+}
+
 #define DEV_CORE_STATS_INC(FIELD)						\
 static inline void dev_core_stats_##FIELD##_inc(struct net_device *dev)		\
 {										\
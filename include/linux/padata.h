@@ -174,6 +174,12 @@ struct padata_instance {
 #define	PADATA_INIT	1
 #define	PADATA_RESET	2
 #define	PADATA_INVALID	4
+/*
+ * Run parallel callbacks with BHs enabled, so they may use kernel-mode SIMD
+ * on architectures where softirq context rules it out.  Set by the user
+ * right after padata_alloc(), before any object is parallelized.
+ */
+#define	PADATA_PARALLEL_BH	8
 };
 
 #ifdef CONFIG_PADATA
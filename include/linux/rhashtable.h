@@ -76,12 +76,18 @@ struct rhash_lock_head {};
 struct bucket_table {
 	unsigned int		size;
 	unsigned int		nest;
+	unsigned int		grow_thresh;
 	u32			hash_rnd;
 	struct list_head	walkers;
 	struct rcu_head		rcu;
 
 	struct bucket_table __rcu *future_tbl;
 
+	/* Progress of moving entries to future_tbl, under ht->mutex */
+	unsigned int		rehash;
+	unsigned int		rehash_slices;
+	u64			rehash_start;
+
 	struct lockdep_map	dep_map;
 
 	struct rhash_lock_head __rcu *buckets[] ____cacheline_aligned_in_smp;
@@ -175,15 +181,17 @@ static inline unsigned int rht_head_hashfn(
 }
 
 /**
- * rht_grow_above_75 - returns true if nelems > 0.75 * table-size
+ * rht_grow_above_75 - returns true if nelems is above the grow threshold
  * @ht:		hash table
  * @tbl:	current table
+ *
+ * The threshold is 75% of the table size unless set by @grow_percent.
  */
 static inline bool rht_grow_above_75(const struct rhashtable *ht,
 				     const struct bucket_table *tbl)
 {
-	/* Expand table when exceeding 75% load */
-	return atomic_read(&ht->nelems) > (tbl->size / 4 * 3) &&
+	/* Expand table when exceeding the grow threshold */
+	return atomic_read(&ht->nelems) > tbl->grow_thresh &&
 	       (!ht->p.max_size || tbl->size < ht->p.max_size);
 }
 
@@ -256,6 +264,8 @@ void *rhashtable_walk_next(struct rhashtable_iter *iter);
 void *rhashtable_walk_peek(struct rhashtable_iter *iter);
 void rhashtable_walk_stop(struct rhashtable_iter *iter) __releases(RCU);
 
+int rhashtable_presize(struct rhashtable *ht, unsigned int nelems);
+
 void rhashtable_free_and_destroy(struct rhashtable *ht,
 				 void (*free_fn)(void *ptr, void *arg),
 				 void *arg);
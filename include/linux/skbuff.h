@@ -840,6 +840,9 @@ typedef unsigned char *sk_buff_data_t;
  *	@network_header: Network layer header
  *	@mac_header: Link layer header
  *	@kcov_handle: KCOV remote handle for remote coverage collection
+ *	@pktlat_stamp: Ingress time for data plane latency profiling
+ *	@pktlat_last: Time of the last stage boundary, ns after @pktlat_stamp
+ *	@pktlat_point: Last stage boundary passed, see net/pkt_latency.h
  *	@tail: Tail pointer
  *	@end: End pointer
  *	@head: Head of buffer
@@ -1044,6 +1047,12 @@ struct sk_buff {
 	u64			kcov_handle;
 #endif
 
+#ifdef CONFIG_NET_PKT_LATENCY
+	u64			pktlat_stamp;
+	u32			pktlat_last;
+	u8			pktlat_point;
+#endif
+
 	); /* end headers group */
 
 	/* These elements must be at the end, see alloc_skb() for details.  */
@@ -3154,6 +3163,8 @@ static inline void *netdev_alloc_frag_align(unsigned int fragsz,
 
 struct sk_buff *__netdev_alloc_skb(struct net_device *dev, unsigned int length,
 				   gfp_t gfp_mask);
+int netdev_alloc_skb_bulk(struct net_device *dev, unsigned int length,
+			  gfp_t gfp_mask, struct sk_buff **skbs, int n);
 
 /**
  *	netdev_alloc_skb - allocate an skbuff for rx on a specific device
@@ -3231,6 +3242,7 @@ static inline struct sk_buff *napi_alloc_skb(struct napi_struct *napi,
 	return __napi_alloc_skb(napi, length, GFP_ATOMIC);
 }
 void napi_consume_skb(struct sk_buff *skb, int budget);
+void napi_consume_skb_bulk(struct sk_buff **skbs, unsigned int n, int budget);
 
 void napi_skb_free_stolen_head(struct sk_buff *skb);
 void __kfree_skb_defer(struct sk_buff *skb);
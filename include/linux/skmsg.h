@@ -63,6 +63,7 @@ struct sk_psock_progs {
 enum sk_psock_state_bits {
 	SK_PSOCK_TX_ENABLED,
 	SK_PSOCK_RX_STRP_ENABLED,
+	SK_PSOCK_RX_THROTTLED,
 };
 
 struct sk_psock_link {
@@ -89,6 +90,9 @@ struct sk_psock {
 	struct strparser		strp;
 #endif
 	struct sk_buff_head		ingress_skb;
+	atomic_t			backlog_bytes;
+	struct list_head		throttled;
+	struct list_head		throttle_node;
 	struct list_head		ingress_msg;
 	spinlock_t			ingress_lock;
 	unsigned long			state;
@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Allwinner MBUS bandwidth requests
+ *
+ * Bus masters that know their bandwidth needs in advance, e.g. a
+ * network interface on link up, can raise the DRAM clock floor before
+ * the MBUS devfreq driver sees the traffic in its counters.
+ */
+#ifndef __LINUX_SOC_SUNXI_MBUS_H
+#define __LINUX_SOC_SUNXI_MBUS_H
+
+#include <linux/kconfig.h>
+#include <linux/types.h>
+
+struct sunxi_mbus_bw_req {
+	u32	kBps;
+	bool	active;
+};
+
+#if IS_REACHABLE(CONFIG_ARM_SUN8I_A33_MBUS_DEVFREQ)
+void sunxi_mbus_bw_add_request(struct sunxi_mbus_bw_req *req, u32 kBps);
+void sunxi_mbus_bw_update_request(struct sunxi_mbus_bw_req *req, u32 kBps);
+void sunxi_mbus_bw_remove_request(struct sunxi_mbus_bw_req *req);
+#else
+static inline void sunxi_mbus_bw_add_request(struct sunxi_mbus_bw_req *req,
+					     u32 kBps) { }
+static inline void sunxi_mbus_bw_update_request(struct sunxi_mbus_bw_req *req,
+						u32 kBps) { }
+static inline void sunxi_mbus_bw_remove_request(struct sunxi_mbus_bw_req *req) { }
+#endif
+
+#endif /* __LINUX_SOC_SUNXI_MBUS_H */
@@ -402,6 +402,7 @@ struct tcp_sock {
 	u16 timeout_rehash;	/* Timeout-triggered rehash attempts */
 
 	u32 rcv_ooopack; /* Received out-of-order packets, for tcpinfo */
+	u32 acks_compressed; /* ACKs not sent thanks to compression */
 
 /* Receiver side RTT estimation */
 	u32 rcv_rtt_last_tsecr;
@@ -84,10 +84,14 @@
 #define CDC_NCM_TIMER_INTERVAL_MIN		5UL
 #define CDC_NCM_TIMER_INTERVAL_MAX		(U32_MAX / NSEC_PER_USEC)
 
+/* Adaptive TX coalescing waits for about this many datagrams */
+#define CDC_NCM_ADAPT_DATAGRAMS			4
+
 /* Driver flags */
 #define CDC_NCM_FLAG_NDP_TO_END			0x02	/* NDP is placed at end of frame */
 #define CDC_MBIM_FLAG_AVOID_ALTSETTING_TOGGLE	0x04	/* Avoid altsetting toggle during init */
 #define CDC_NCM_FLAG_PREFER_NTB32 0x08	/* prefer NDP32 over NDP16 */
+#define CDC_NCM_FLAG_TX_ADAPTIVE		0x10	/* TX timer and NTB size follow traffic */
 
 #define cdc_ncm_comm_intf_is_mbim(x)  ((x)->desc.bInterfaceSubClass == USB_CDC_SUBCLASS_MBIM && \
 				       (x)->desc.bInterfaceProtocol == USB_CDC_PROTO_NONE)
@@ -140,6 +144,12 @@ struct cdc_ncm_ctx {
 	u16 rx_seq;
 	u16 min_tx_pkt;
 
+	/* adaptive TX state */
+	u64 tx_adapt_last;	/* arrival of the last datagram, ns */
+	u32 tx_adapt_gap;	/* average datagram inter-arrival, ns */
+	u32 tx_adapt_interval;	/* current timer interval, ns */
+	u32 tx_adapt_size;	/* current NTB size */
+
 	/* statistics */
 	u32 tx_curr_frame_payload;
 	u32 tx_reason_ntb_full;
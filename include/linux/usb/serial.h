@@ -21,6 +21,9 @@
 #define USB_SERIAL_WRITE_BUSY	0
 #define USB_SERIAL_THROTTLED	1
 
+/* upper limit for the usbserial read_urbs parameter */
+#define USB_SERIAL_MAX_READ_URBS	8
+
 /**
  * usb_serial_port: structure for the specific ports of a device.
  * @serial: pointer back to the struct usb_serial owner of this port.
@@ -45,6 +48,10 @@
  * @bulk_in_buffers: pointers to the bulk in buffers for this port
  * @read_urbs: pointers to the bulk in urbs for this port
  * @read_urbs_free: status bitmap the for bulk in urbs
+ * @num_read_urbs: number of bulk in urbs kept in flight
+ * @read_completions: number of completed bulk in urbs
+ * @read_starved: completions that left no other bulk in urb queued
+ * @low_latency: driver should configure the device for low latency
  * @bulk_out_buffer: pointer to the bulk out buffer for this port.
  * @bulk_out_size: the size of the bulk_out_buffer, in bytes.
  * @write_urb: pointer to the bulk out struct urb for this port.
@@ -84,9 +91,13 @@ struct usb_serial_port {
 	struct urb		*read_urb;
 	__u8			bulk_in_endpointAddress;
 
-	unsigned char		*bulk_in_buffers[2];
-	struct urb		*read_urbs[2];
+	unsigned char		*bulk_in_buffers[USB_SERIAL_MAX_READ_URBS];
+	struct urb		*read_urbs[USB_SERIAL_MAX_READ_URBS];
 	unsigned long		read_urbs_free;
+	unsigned int		num_read_urbs;
+	unsigned long		read_completions;
+	unsigned long		read_starved;
+	bool			low_latency;
 
 	unsigned char		*bulk_out_buffer;
 	int			bulk_out_size;
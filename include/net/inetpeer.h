@@ -42,13 +42,14 @@ struct inet_peer {
 	u32			n_redirects;
 	unsigned long		rate_last;
 	/*
-	 * Once inet_peer is queued for deletion (refcnt == 0), following field
-	 * is not available: rid
+	 * Once inet_peer is queued for deletion (refcnt == 0), following fields
+	 * are not available: rid, frag_mem
 	 * We can share memory with rcu_head to help keep inet_peer small.
 	 */
 	union {
 		struct {
 			atomic_t			rid;		/* Frag reception counter */
+			atomic_t			frag_mem;	/* Reassembly memory held */
 		};
 		struct rcu_head         rcu;
 	};
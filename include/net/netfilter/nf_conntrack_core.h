@@ -84,6 +84,15 @@ void nf_conntrack_lock(spinlock_t *lock);
 
 extern spinlock_t nf_conntrack_expect_lock;
 
+/* gc worker tunables and run cost histogram, buckets are <32us, then
+ * powers of two up to 2ms and more.
+ */
+#define NF_CT_GC_HIST_NUM	8
+
+extern unsigned int nf_conntrack_gc_budget_us;
+extern u8 nf_conntrack_gc_lazy;
+extern unsigned long nf_conntrack_gc_hist[NF_CT_GC_HIST_NUM];
+
 /* ctnetlink code shared by both ctnetlink and nf_conntrack_bpf */
 
 static inline void __nf_ct_set_timeout(struct nf_conn *ct, u64 timeout)
@@ -147,6 +147,9 @@ struct flow_offload_tuple {
 			u32		hw_ifidx;
 			u8		h_source[ETH_ALEN];
 			u8		h_dest[ETH_ALEN];
+			/* PPPoE session pushed in software, 0 if none */
+			u16		pppoe_sid;
+			u32		pppoe_ifidx;
 		} out;
 		struct {
 			u32		iifidx;
@@ -174,6 +177,7 @@ enum nf_flow_flags {
 enum flow_offload_type {
 	NF_FLOW_OFFLOAD_UNSPEC	= 0,
 	NF_FLOW_OFFLOAD_ROUTE,
+	NF_FLOW_OFFLOAD_BRIDGE,
 };
 
 struct flow_offload {
@@ -212,6 +216,8 @@ struct nf_flow_route {
 			u32			hw_ifindex;
 			u8			h_source[ETH_ALEN];
 			u8			h_dest[ETH_ALEN];
+			u16			pppoe_sid;
+			u32			pppoe_ifindex;
 		} out;
 		enum flow_offload_xmit_type	xmit_type;
 	} tuple[FLOW_OFFLOAD_DIR_MAX];
@@ -276,6 +282,10 @@ nf_flow_table_offload_del_cb(struct nf_flowtable *flow_table,
 
 void flow_offload_route_init(struct flow_offload *flow,
 			     struct nf_flow_route *route);
+void flow_offload_bridge_init(struct flow_offload *flow,
+			      struct nf_flow_route *route);
+const struct net_device *nf_flow_bridge_port(const struct net_device *port,
+					     const u8 *daddr);
 
 int flow_offload_add(struct nf_flowtable *flow_table, struct flow_offload *flow);
 void flow_offload_refresh(struct nf_flowtable *flow_table,
@@ -308,6 +318,8 @@ unsigned int nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 				     const struct nf_hook_state *state);
 unsigned int nf_flow_offload_ipv6_hook(void *priv, struct sk_buff *skb,
 				       const struct nf_hook_state *state);
+unsigned int nf_flow_offload_bridge_hook(void *priv, struct sk_buff *skb,
+					 const struct nf_hook_state *state);
 
 #define MODULE_ALIAS_NF_FLOWTABLE(family)	\
 	MODULE_ALIAS("nf-flowtable-" __stringify(family))
@@ -325,6 +337,10 @@ void nf_flow_table_offload_flush_cleanup(struct nf_flowtable *flowtable);
 int nf_flow_table_offload_setup(struct nf_flowtable *flowtable,
 				struct net_device *dev,
 				enum flow_block_command cmd);
+int nf_flow_offload_xdp_setup(struct nf_flowtable *flowtable,
+			      struct net_device *dev,
+			      enum flow_block_command cmd);
+struct nf_flowtable *nf_flowtable_by_dev(const struct net_device *dev);
 int nf_flow_rule_route_ipv4(struct net *net, struct flow_offload *flow,
 			    enum flow_offload_tuple_dir dir,
 			    struct nf_flow_rule *flow_rule);
@@ -358,6 +374,16 @@ static inline __be16 nf_flow_pppoe_proto(const struct sk_buff *skb)
 #define NF_FLOW_TABLE_STAT_DEC_ATOMIC(net, count)	\
 	this_cpu_dec((net)->ft.stat->count)
 
+#if (IS_BUILTIN(CONFIG_NF_FLOW_TABLE) && IS_ENABLED(CONFIG_DEBUG_INFO_BTF)) || \
+    (IS_MODULE(CONFIG_NF_FLOW_TABLE) && IS_ENABLED(CONFIG_DEBUG_INFO_BTF_MODULES))
+int nf_flow_register_bpf(void);
+#else
+static inline int nf_flow_register_bpf(void)
+{
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_NF_FLOW_TABLE_PROCFS
 int nf_flow_table_init_proc(struct net *net);
 void nf_flow_table_fini_proc(struct net *net);
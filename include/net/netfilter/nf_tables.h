@@ -1102,6 +1102,21 @@ struct nft_stats {
 	struct u64_stats_sync	syncp;
 };
 
+/**
+ *	struct nft_chain_cost - evaluation cost of a base chain
+ *
+ *	@pkts: packets evaluated
+ *	@rules: rules evaluated, including those of jumped-to chains
+ *	@exprs: expressions evaluated
+ *	@syncp: u64 stats synchronization
+ */
+struct nft_chain_cost {
+	u64			pkts;
+	u64			rules;
+	u64			exprs;
+	struct u64_stats_sync	syncp;
+};
+
 struct nft_hook {
 	struct list_head	list;
 	struct nf_hook_ops	ops;
@@ -1126,6 +1141,7 @@ struct nft_base_chain {
 	u8				policy;
 	u8				flags;
 	struct nft_stats __percpu	*stats;
+	struct nft_chain_cost __percpu	*cost;
 	struct nft_chain		chain;
 	struct flow_block		flow_block;
 };
@@ -94,6 +94,7 @@ struct page_pool_alloc_stats {
 		    */
 	u64 refill; /* allocations via successful refill */
 	u64 waive;  /* failed refills due to numa zone mismatch */
+	u64 shared; /* slow-path pages taken from the shared cache */
 };
 
 struct page_pool_recycle_stats {
@@ -106,6 +107,8 @@ struct page_pool_recycle_stats {
 	u64 released_refcnt; /* page released because of elevated
 			      * refcnt
 			      */
+	u64 shared;	/* page handed to the per-CPU cache shared by pools */
+	u64 released;	/* page returned to the page allocator */
 };
 
 /* This struct wraps the above stats structs so users of the
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _NET_PKT_LATENCY_H
+#define _NET_PKT_LATENCY_H
+
+#include <linux/skbuff.h>
+#include <linux/tracepoint-defs.h>
+
+/*
+ * Stage boundaries of a forwarded packet, in path order. The time
+ * between two boundaries is one stage of net/core/pkt_latency.c.
+ *
+ * PKTLAT_CORE, PKTLAT_QUEUE and PKTLAT_DONE come from the existing
+ * netif_receive_skb, net_dev_queue and consume_skb tracepoints, the
+ * others from net_pkt_stage().
+ */
+enum pktlat_point {
+	PKTLAT_RX,		/* RX interrupt, or driver reaped it from the NIC */
+	PKTLAT_STACK,		/* handed to GRO or netif_receive_skb/rx */
+	PKTLAT_CORE,		/* __netif_receive_skb_core, after GRO/RPS */
+	PKTLAT_FWD,		/* routed or bridged, before the FORWARD hook */
+	PKTLAT_FWD_DONE,	/* FORWARD hook passed */
+	PKTLAT_QUEUE,		/* dev_queue_xmit() on the egress device */
+	PKTLAT_XMIT,		/* out of the qdisc, to ndo_start_xmit */
+	PKTLAT_DONE,		/* freed by TX completion */
+	PKTLAT_POINTS,
+};
+
+#ifdef CONFIG_NET_PKT_LATENCY
+
+DECLARE_TRACEPOINT(net_pkt_stage);
+
+void __net_pkt_stage(struct sk_buff *skb, enum pktlat_point point);
+void __net_pkt_stage_rx(struct sk_buff *skb, ktime_t stamp);
+
+static inline bool net_pkt_stage_enabled(void)
+{
+	return tracepoint_enabled(net_pkt_stage);
+}
+
+static inline void net_pkt_stage(struct sk_buff *skb, enum pktlat_point point)
+{
+	if (tracepoint_enabled(net_pkt_stage))
+		__net_pkt_stage(skb, point);
+}
+
+/* PKTLAT_RX at an earlier CLOCK_MONOTONIC time, e.g. the RX interrupt */
+static inline void net_pkt_stage_rx(struct sk_buff *skb, ktime_t stamp)
+{
+	if (tracepoint_enabled(net_pkt_stage))
+		__net_pkt_stage_rx(skb, stamp);
+}
+
+/* For skbs that are recycled without going through alloc_skb() */
+static inline void skb_pktlat_reset(struct sk_buff *skb)
+{
+	skb->pktlat_stamp = 0;
+}
+
+#else /* !CONFIG_NET_PKT_LATENCY */
+
+static inline bool net_pkt_stage_enabled(void)
+{
+	return false;
+}
+
+static inline void net_pkt_stage(struct sk_buff *skb, enum pktlat_point point)
+{
+}
+
+static inline void net_pkt_stage_rx(struct sk_buff *skb, ktime_t stamp)
+{
+}
+
+static inline void skb_pktlat_reset(struct sk_buff *skb)
+{
+}
+
+#endif /* CONFIG_NET_PKT_LATENCY */
+
+#endif /* _NET_PKT_LATENCY_H */
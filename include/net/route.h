@@ -108,6 +108,7 @@ struct ip_rt_acct {
 };
 
 struct rt_cache_stat {
+        unsigned int in_hit;
         unsigned int in_slow_tot;
         unsigned int in_slow_mc;
         unsigned int in_no_route;
@@ -116,6 +117,7 @@ struct rt_cache_stat {
         unsigned int in_martian_src;
         unsigned int out_slow_tot;
         unsigned int out_slow_mc;
+        unsigned int in_cache_miss;
 };
 
 extern struct ip_rt_acct __percpu *ip_rt_acct;
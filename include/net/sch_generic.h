@@ -388,6 +388,9 @@ struct tcf_proto_ops {
 	int			(*tmplt_dump)(struct sk_buff *skb,
 					      struct net *net,
 					      void *tmplt_priv);
+	int			(*head_dump)(struct net *net,
+					     struct tcf_proto *tp,
+					     struct sk_buff *skb);
 
 	struct module		*owner;
 	int			flags;
@@ -109,9 +109,12 @@ struct tls_sw_context_tx {
 	struct list_head tx_list;
 	atomic_t encrypt_pending;
 	u8 async_capable:1;
+	u32 tx_coalesce_us;
+	unsigned long tx_flush_at;
 
 #define BIT_TX_SCHEDULED	0
 #define BIT_TX_CLOSING		1
+#define BIT_TX_FLUSH		2
 	unsigned long tx_bitmask;
 };
 
@@ -146,6 +149,10 @@ struct tls_sw_context_rx {
 	atomic_t decrypt_pending;
 	struct sk_buff_head async_hold;
 	struct wait_queue_head wq;
+
+	/* Request memory reused by synchronous decrypts */
+	void *dec_mem;
+	unsigned int dec_mem_size;
 };
 
 struct tls_record_info {
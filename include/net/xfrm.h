@@ -1728,6 +1728,8 @@ struct xfrm_algo_desc *xfrm_ealg_get_byname(const char *name, int probe);
 struct xfrm_algo_desc *xfrm_calg_get_byname(const char *name, int probe);
 struct xfrm_algo_desc *xfrm_aead_get_byname(const char *name, int icv_len,
 					    int probe);
+struct crypto_aead *xfrm_alloc_aead(const struct xfrm_state *x,
+				    const char *name);
 
 static inline bool xfrm6_addr_equal(const xfrm_address_t *a,
 				    const xfrm_address_t *b)
@@ -313,6 +313,17 @@ DEFINE_EVENT(net_dev_rx_exit_template, netif_receive_skb_list_exit,
 	TP_ARGS(ret)
 );
 
+/*
+ * Data plane stage boundary, see include/net/pkt_latency.h. No event,
+ * only for probes such as the packet latency histograms.
+ */
+DECLARE_TRACE(net_pkt_stage,
+
+	TP_PROTO(struct sk_buff *skb, int point),
+
+	TP_ARGS(skb, point)
+);
+
 #endif /* _TRACE_NET_H */
 
 /* This part must be outside protection */
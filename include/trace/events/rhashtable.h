@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM rhashtable
+
+#if !defined(_TRACE_RHASHTABLE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_RHASHTABLE_H
+
+#include <linux/rhashtable-types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(rhashtable_resize,
+
+	TP_PROTO(const struct rhashtable *ht, unsigned int old_size,
+		 unsigned int new_size),
+
+	TP_ARGS(ht, old_size, new_size),
+
+	TP_STRUCT__entry(
+		__field(const void *,	ht)
+		__field(unsigned int,	old_size)
+		__field(unsigned int,	new_size)
+		__field(unsigned int,	nelems)
+	),
+
+	TP_fast_assign(
+		__entry->ht = ht;
+		__entry->old_size = old_size;
+		__entry->new_size = new_size;
+		__entry->nelems = atomic_read(&ht->nelems);
+	),
+
+	TP_printk("ht=%p size=%u->%u nelems=%u",
+		  __entry->ht, __entry->old_size, __entry->new_size,
+		  __entry->nelems)
+);
+
+TRACE_EVENT(rhashtable_rehash_done,
+
+	TP_PROTO(const struct rhashtable *ht, unsigned int old_size,
+		 unsigned int new_size, u64 duration_ns, unsigned int slices),
+
+	TP_ARGS(ht, old_size, new_size, duration_ns, slices),
+
+	TP_STRUCT__entry(
+		__field(const void *,	ht)
+		__field(unsigned int,	old_size)
+		__field(unsigned int,	new_size)
+		__field(u64,		duration_ns)
+		__field(unsigned int,	slices)
+	),
+
+	TP_fast_assign(
+		__entry->ht = ht;
+		__entry->old_size = old_size;
+		__entry->new_size = new_size;
+		__entry->duration_ns = duration_ns;
+		__entry->slices = slices;
+	),
+
+	TP_printk("ht=%p size=%u->%u duration_ns=%llu slices=%u",
+		  __entry->ht, __entry->old_size, __entry->new_size,
+		  __entry->duration_ns, __entry->slices)
+);
+
+#endif /* _TRACE_RHASHTABLE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -1213,6 +1213,9 @@ enum {
 	BPF_NOEXIST	= 1, /* create new element if it didn't exist */
 	BPF_EXIST	= 2, /* update existing element */
 	BPF_F_LOCK	= 4, /* spin_lock-ed map_lookup/map_update */
+	BPF_F_REPLACE_ALL = 8, /* LPM trie batch update: the batch atomically
+				* replaces the whole content of the map
+				*/
 };
 
 /* flags for BPF_MAP_CREATE command */
@@ -1253,6 +1256,18 @@ enum {
 
 /* Create a map that is suitable to be an inner map with dynamic max entries */
 	BPF_F_INNER_MAP		= (1U << 12),
+
+/* Instead of the LRU lists of a BPF_MAP_TYPE_LRU_[PERCPU_]HASH map, use a
+ * clock-style approximate LRU over the preallocated elements.  No lock is
+ * shared by all CPUs and no free elements are cached per CPU.
+ */
+	BPF_F_LRU_CLOCK		= (1U << 13),
+
+/* Put a table indexed by the first 16 bits of the key in front of an LPM
+ * trie, so that lookups skip the top of the trie.  Costs 2 pointers per
+ * table entry; rebuilt in the background after updates.
+ */
+	BPF_F_LPM_STRIDE	= (1U << 14),
 };
 
 /* Flags for BPF_PROG_QUERY. */
@@ -1324,6 +1339,13 @@ union bpf_attr {
 		 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits indicate the
 		 * number of hash functions (if 0, the bloom filter will default
 		 * to using 5 hash functions).
+		 *
+		 * BPF_MAP_TYPE_RINGBUF - adaptive wakeup policy: the lower 32
+		 * bits are a number of records, the upper 32 bits a time in
+		 * microseconds. If either is set, a submit without wakeup
+		 * flags wakes the consumer only once that many records are
+		 * pending, or that much time has passed since the first of
+		 * them.
 		 */
 		__u64	map_extra;
 	};
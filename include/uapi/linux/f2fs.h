@@ -42,6 +42,8 @@
 						struct f2fs_comp_option)
 #define F2FS_IOC_DECOMPRESS_FILE	_IO(F2FS_IOCTL_MAGIC, 23)
 #define F2FS_IOC_COMPRESS_FILE		_IO(F2FS_IOCTL_MAGIC, 24)
+#define F2FS_IOC_GET_WRITE_AMP		_IOR(F2FS_IOCTL_MAGIC, 25,	\
+						struct f2fs_file_wa)
 
 /*
  * should be same as XFS_IOC_GOINGDOWN.
@@ -95,4 +97,10 @@ struct f2fs_comp_option {
 	__u8 log_cluster_size;
 };
 
+struct f2fs_file_wa {
+	__u64 app_bytes;	/* bytes written by the application */
+	__u64 data_bytes;	/* data bytes written to the device */
+	__u64 node_bytes;	/* node bytes written on fsync */
+};
+
 #endif /* _UAPI_LINUX_F2FS_H */
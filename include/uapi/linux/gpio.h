@@ -68,6 +68,8 @@ struct gpiochip_info {
  * @GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME: line events contain REALTIME timestamps
  * @GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE: line events contain timestamps from
  * hardware timestamp engine
+ * @GPIO_V2_LINE_FLAG_EDGE_COUNT: detected edges are counted in the kernel
+ * instead of being reported as events, see &struct gpio_v2_line_edge_counts
  */
 enum gpio_v2_line_flag {
 	GPIO_V2_LINE_FLAG_USED			= _BITULL(0),
@@ -83,6 +85,7 @@ enum gpio_v2_line_flag {
 	GPIO_V2_LINE_FLAG_BIAS_DISABLED		= _BITULL(10),
 	GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME	= _BITULL(11),
 	GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE	= _BITULL(12),
+	GPIO_V2_LINE_FLAG_EDGE_COUNT		= _BITULL(13),
 };
 
 /**
@@ -300,6 +303,68 @@ struct gpio_v2_line_event {
 	__u32 padding[6];
 };
 
+/**
+ * struct gpio_v2_line_edge_count - Edge count of a single line
+ * @count: the number of edges detected since the line was requested or
+ * the count was last reset
+ * @timestamp_ns: the timestamp of the last counted edge, from the same
+ * clock as &struct gpio_v2_line_event.timestamp_ns, or 0 if there has
+ * been none
+ */
+struct gpio_v2_line_edge_count {
+	__aligned_u64 count;
+	__aligned_u64 timestamp_ns;
+};
+
+/**
+ * struct gpio_v2_line_edge_counts - Edge counts of GPIO lines, used with
+ * %GPIO_V2_LINE_GET_EDGE_COUNTS_IOCTL
+ * @mask: a bitmap identifying the lines to read, with each bit number
+ * corresponding to the index into &struct gpio_v2_line_request.offsets
+ * @reset: a bitmap identifying the lines, among those in @mask, whose
+ * count is reset to 0 after being read
+ * @counts: the edge counts, indexed the same way as @mask; entries for
+ * lines not in @mask are zeroed
+ *
+ * Lines requested with %GPIO_V2_LINE_FLAG_EDGE_COUNT count their edges in
+ * the interrupt handler rather than queueing an event for each one, which
+ * suits pulse counters and flow meters producing edges faster than
+ * userspace can read events.
+ */
+struct gpio_v2_line_edge_counts {
+	__aligned_u64 mask;
+	__aligned_u64 reset;
+	struct gpio_v2_line_edge_count counts[GPIO_V2_LINES_MAX];
+};
+
+/**
+ * struct gpio_v2_line_event_ring - Header of the memory mapped event ring
+ * @head: the number of events written by the kernel, updated by the kernel
+ * @tail: the number of events consumed, updated by userspace
+ * @num_events: the number of elements in @events, a power of two
+ * @padding: reserved for future use
+ * @events: the events, event n being at index n & (@num_events - 1)
+ *
+ * Mapping a line request file descriptor with mmap(MAP_SHARED) at offset 0
+ * allocates the ring, sized to hold as many events as fit in the mapping
+ * rounded down to a power of two. From then on, events are written to the
+ * ring instead of being queued for read(), and poll() reports %EPOLLIN
+ * while @head differs from @tail. Events that find the ring full are
+ * dropped.
+ *
+ * Userspace reads @head with acquire semantics, consumes the events
+ * before it and stores the new @tail with release semantics, so events
+ * can be drained without a system call.
+ */
+struct gpio_v2_line_event_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 num_events;
+	/* Space reserved for future use. */
+	__u32 padding[13];
+	struct gpio_v2_line_event events[];
+};
+
 /*
  * ABI v1
  *
@@ -514,6 +579,7 @@ struct gpioevent_data {
 #define GPIO_V2_LINE_SET_CONFIG_IOCTL _IOWR(0xB4, 0x0D, struct gpio_v2_line_config)
 #define GPIO_V2_LINE_GET_VALUES_IOCTL _IOWR(0xB4, 0x0E, struct gpio_v2_line_values)
 #define GPIO_V2_LINE_SET_VALUES_IOCTL _IOWR(0xB4, 0x0F, struct gpio_v2_line_values)
+#define GPIO_V2_LINE_GET_EDGE_COUNTS_IOCTL _IOWR(0xB4, 0x10, struct gpio_v2_line_edge_counts)
 
 /*
  * v1 ioctl()s
@@ -35,6 +35,8 @@
 #define I2C_RDWR	0x0707	/* Combined R/W transfer (one STOP only) */
 
 #define I2C_PEC		0x0708	/* != 0 to use PEC with SMBus */
+#define I2C_POLL_SETUP	0x0709	/* Periodic read list, see below */
+#define I2C_POLL_READ	0x070a	/* Fetch periodic read results */
 #define I2C_SMBUS	0x0720	/* SMBus transfer */
 
 
@@ -56,5 +58,46 @@ struct i2c_rdwr_ioctl_data {
 /* Originally defined with a typo, keep it for compatibility */
 #define  I2C_RDRW_IOCTL_MAX_MSGS	I2C_RDWR_IOCTL_MAX_MSGS
 
+/*
+ * Periodic read list, for polling many devices without one ioctl per
+ * register. Every period_us, each entry's register is written and len
+ * bytes are read back with a repeated start. One struct i2c_poll_sample
+ * per entry is queued in a ring, with the oldest ones dropped when it is
+ * full. Pointers are passed as __u64 so the layout is the same for
+ * 32-bit callers.
+ */
+#define I2C_POLL_MAX_ENTRIES	64
+#define I2C_POLL_MAX_LEN	32
+#define I2C_POLL_RING_SIZE	256
+
+struct i2c_poll_entry {
+	__u16 addr;		/* 7-bit slave address */
+	__u8 reg;		/* register to read from */
+	__u8 len;		/* bytes to read, up to I2C_POLL_MAX_LEN */
+};
+
+/* This is the structure as used in the I2C_POLL_SETUP ioctl call */
+struct i2c_poll_setup {
+	__u64 entries;		/* struct i2c_poll_entry __user * */
+	__u32 nentries;		/* 0 stops polling */
+	__u32 period_us;
+};
+
+struct i2c_poll_sample {
+	__u64 timestamp;	/* CLOCK_MONOTONIC in ns, after the read */
+	__u16 index;		/* entry in the read list */
+	__s16 status;		/* 0 or a negative errno */
+	__u8 len;		/* valid bytes in data */
+	__u8 unused[3];
+	__u8 data[I2C_POLL_MAX_LEN];
+};
+
+/* This is the structure as used in the I2C_POLL_READ ioctl call */
+struct i2c_poll_read {
+	__u64 samples;		/* struct i2c_poll_sample __user * */
+	__u32 nsamples;		/* room in samples, then samples returned */
+	__u32 lost;		/* samples dropped since the last call */
+};
+
 
 #endif /* _UAPI_LINUX_I2C_DEV_H */
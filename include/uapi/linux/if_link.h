@@ -1228,11 +1228,35 @@ enum {
 	IFLA_STATS_LINK_XSTATS_SLAVE,
 	IFLA_STATS_LINK_OFFLOAD_XSTATS,
 	IFLA_STATS_AF_SPEC,
+	IFLA_STATS_LINK_COMPACT,
 	__IFLA_STATS_MAX,
 };
 
 #define IFLA_STATS_MAX (__IFLA_STATS_MAX - 1)
 
+/* IFLA_STATS_LINK_COMPACT: the counters a monitoring agent polls, plus a
+ * cursor that changes whenever any packet counter does. Passing the
+ * cursor back in IFLA_STATS_GET_CURSORS suppresses unchanged devices.
+ */
+struct rtnl_link_stats_compact {
+	__u64	rx_packets;
+	__u64	tx_packets;
+	__u64	rx_bytes;
+	__u64	tx_bytes;
+	__u64	rx_errors;
+	__u64	tx_errors;
+	__u64	rx_dropped;
+	__u64	tx_dropped;
+	__u64	cursor;
+};
+
+/* Element of IFLA_STATS_GET_CURSORS */
+struct if_stats_cursor {
+	__u32	ifindex;
+	__u32	pad;
+	__u64	cursor;
+};
+
 #define IFLA_STATS_FILTER_BIT(ATTR)	(1 << (ATTR - 1))
 
 enum {
@@ -1241,6 +1265,10 @@ enum {
 				 * a filter mask for the corresponding group.
 				 */
 	IFLA_STATS_SET_OFFLOAD_XSTATS_L3_STATS, /* 0 or 1 as u8 */
+	IFLA_STATS_GET_IFINDEX_LIST, /* Array of __u32, dump only these */
+	IFLA_STATS_GET_CURSORS, /* Array of struct if_stats_cursor, dump
+				 * skips devices whose cursor is unchanged
+				 */
 	__IFLA_STATS_GETSET_MAX,
 };
 
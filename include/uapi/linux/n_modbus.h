@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_N_MODBUS_H
+#define _UAPI_LINUX_N_MODBUS_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* Largest Modbus RTU frame: address, PDU and CRC */
+#define MODBUS_MAX_FRAME	256
+
+struct modbus_config {
+	__u32 gap;		/* frame gap in tenths of a character, 0: 35,
+				 * at most 1000. Above 19200 baud it scales
+				 * the fixed 1.75ms gap instead. */
+	__u32 flags;
+	__u32 unused[6];	/* Padding for expansion */
+};
+
+/* Prefix every frame returned by read() with a struct modbus_frame_hdr */
+#define MODBUS_FL_TIMESTAMP	0x1
+
+struct modbus_frame_hdr {
+	__u64 timestamp;	/* CLOCK_REALTIME of the first byte, in ns */
+	__u16 len;		/* frame length, without this header */
+	__u16 unused[3];
+};
+
+#define MODBUSIOC_GETCONF	_IOR('M', 0xe0, struct modbus_config)
+#define MODBUSIOC_SETCONF	_IOW('M', 0xe1, struct modbus_config)
+
+#endif
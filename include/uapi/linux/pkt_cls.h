@@ -594,6 +594,10 @@ enum {
 
 	TCA_FLOWER_KEY_L2TPV3_SID,	/* be32 */
 
+	TCA_FLOWER_CACHE_HITS,		/* u64, per instance, dump only */
+	TCA_FLOWER_CACHE_MISSES,	/* u64, per instance, dump only */
+	TCA_FLOWER_PAD,
+
 	__TCA_FLOWER_MAX,
 };
 
@@ -842,6 +842,7 @@ enum {
 	TCA_FQ_CODEL_MEMORY_LIMIT,
 	TCA_FQ_CODEL_CE_THRESHOLD_SELECTOR,
 	TCA_FQ_CODEL_CE_THRESHOLD_MASK,
+	TCA_FQ_CODEL_FLOW_QUOTA,
 	__TCA_FQ_CODEL_MAX
 };
 
@@ -868,6 +869,9 @@ struct tc_fq_codel_qd_stats {
 	__u32	ce_mark;	/* packets above ce_threshold */
 	__u32	memory_usage;	/* in bytes */
 	__u32	drop_overmemory;
+	__u32	drop_flow_quota; /* packets dropped because their
+				  * flow was over flow_quota
+				  */
 };
 
 struct tc_fq_codel_cl_stats {
@@ -924,6 +928,8 @@ enum {
 
 	TCA_FQ_HORIZON_DROP,	/* drop packets beyond horizon, or cap their EDT */
 
+	TCA_FQ_PACING_SLACK,	/* release packets this early, in ns */
+
 	__TCA_FQ_MAX
 };
 
@@ -1071,6 +1077,15 @@ enum {
 
 #define TCA_ETF_MAX (__TCA_ETF_MAX - 1)
 
+/* Software mode only: how far behind txtime - delta packets were dequeued */
+struct tc_etf_xstats {
+	__u64	launched;	/* packets handed to the device */
+	__u64	expired;	/* packets dropped because txtime had passed */
+	__u64	launch_err_sum;	/* sum of launch errors, ns */
+	__u32	launch_err_max;	/* largest launch error, ns */
+	__u32	launch_err_last; /* launch error of the last packet, ns */
+};
+
 
 /* CAKE */
 enum {
@@ -1093,6 +1108,8 @@ enum {
 	TCA_CAKE_ACK_FILTER,
 	TCA_CAKE_SPLIT_GSO,
 	TCA_CAKE_FWMARK,
+	TCA_CAKE_FAST_HASH,
+	TCA_CAKE_PROFILE,
 	__TCA_CAKE_MAX
 };
 #define TCA_CAKE_MAX	(__TCA_CAKE_MAX - 1)
@@ -1115,6 +1132,12 @@ enum {
 	TCA_CAKE_STATS_DROP_NEXT_US,
 	TCA_CAKE_STATS_P_DROP,
 	TCA_CAKE_STATS_BLUE_TIMER_US,
+	TCA_CAKE_STATS_PROFILE_ENQUEUES,
+	TCA_CAKE_STATS_PROFILE_DEQUEUES,
+	TCA_CAKE_STATS_HASH_NS,
+	TCA_CAKE_STATS_ENQUEUE_NS,
+	TCA_CAKE_STATS_COBALT_NS,
+	TCA_CAKE_STATS_DEQUEUE_NS,
 	__TCA_CAKE_STATS_MAX
 };
 #define TCA_CAKE_STATS_MAX (__TCA_CAKE_STATS_MAX - 1)
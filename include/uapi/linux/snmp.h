@@ -292,6 +292,9 @@ enum
 	LINUX_MIB_TCPDSACKIGNOREDDUBIOUS,	/* TCPDSACKIgnoredDubious */
 	LINUX_MIB_TCPMIGRATEREQSUCCESS,		/* TCPMigrateReqSuccess */
 	LINUX_MIB_TCPMIGRATEREQFAILURE,		/* TCPMigrateReqFailure */
+	LINUX_MIB_IPREASMNOQUEUE,		/* IPReasmNoQueue */
+	LINUX_MIB_IPREASMDUPS,			/* IPReasmDups */
+	LINUX_MIB_IPREASMQUOTADROPS,		/* IPReasmQuotaDrops */
 	__LINUX_MIB_MAX
 };
 
@@ -327,6 +330,8 @@ enum
 	LINUX_MIB_XFRMFWDHDRERROR,		/* XfrmFwdHdrError*/
 	LINUX_MIB_XFRMOUTSTATEINVALID,		/* XfrmOutStateInvalid */
 	LINUX_MIB_XFRMACQUIREERROR,		/* XfrmAcquireError */
+	LINUX_MIB_XFRMPOLCACHEHIT,		/* XfrmPolCacheHit */
+	LINUX_MIB_XFRMPOLCACHEMISS,		/* XfrmPolCacheMiss */
 	__LINUX_MIB_XFRMMAX
 };
 
@@ -284,6 +284,9 @@ struct tcp_info {
 	__u32	tcpi_snd_wnd;	     /* peer's advertised receive window after
 				      * scaling (bytes)
 				      */
+	__u32	tcpi_acks_compressed; /* ACKs saved by SACK or LAN ACK
+				       * compression
+				       */
 };
 
 /* netlink attributes types for SCM_TIMESTAMPING_OPT_STATS */
@@ -33,5 +33,6 @@
 #define TFD_NONBLOCK O_NONBLOCK
 
 #define TFD_IOC_SET_TICKS	_IOW('T', 0, __u64)
+#define TFD_IOC_SET_SLACK	_IOW('T', 1, __u64)
 
 #endif /* _UAPI_LINUX_TIMERFD_H */
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 /* Copyright (c) 2016 Facebook
  */
+#include <linux/bitmap.h>
 #include <linux/cpumask.h>
 #include <linux/spinlock.h>
 #include <linux/percpu.h>
@@ -49,6 +50,16 @@ static void bpf_lru_node_clear_ref(struct bpf_lru_node *node)
 	WRITE_ONCE(node->ref, 0);
 }
 
+static bool bpf_lru_del_from_htab(struct bpf_lru *lru,
+				  struct bpf_lru_node *node)
+{
+	if (!lru->del_from_htab(lru->del_arg, node))
+		return false;
+
+	this_cpu_inc(*lru->nr_evictions);
+	return true;
+}
+
 static void bpf_lru_list_count_inc(struct bpf_lru_list *l,
 				   enum bpf_lru_list_type type)
 {
@@ -222,7 +233,7 @@ __bpf_lru_list_shrink_inactive(struct bpf_lru *lru,
 	list_for_each_entry_safe_reverse(node, tmp_node, inactive, list) {
 		if (bpf_lru_node_is_ref(node)) {
 			__bpf_lru_node_move(l, node, BPF_LRU_LIST_T_ACTIVE);
-		} else if (lru->del_from_htab(lru->del_arg, node)) {
+		} else if (bpf_lru_del_from_htab(lru, node)) {
 			__bpf_lru_node_move_to_free(l, node, free_list,
 						    tgt_free_type);
 			if (++nshrinked == tgt_nshrink)
@@ -281,7 +292,7 @@ static unsigned int __bpf_lru_list_shrink(struct bpf_lru *lru,
 
 	list_for_each_entry_safe_reverse(node, tmp_node, force_shrink_list,
 					 list) {
-		if (lru->del_from_htab(lru->del_arg, node)) {
+		if (bpf_lru_del_from_htab(lru, node)) {
 			__bpf_lru_node_move_to_free(l, node, free_list,
 						    tgt_free_type);
 			return 1;
@@ -387,7 +398,7 @@ ignore_ref:
 	list_for_each_entry_reverse(node, local_pending_list(loc_l),
 				    list) {
 		if ((!bpf_lru_node_is_ref(node) || force) &&
-		    lru->del_from_htab(lru->del_arg, node)) {
+		    bpf_lru_del_from_htab(lru, node)) {
 			list_del(&node->list);
 			return node;
 		}
@@ -496,9 +507,69 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	return node;
 }
 
+static struct bpf_lru_node *
+bpf_clock_lru_node(const struct bpf_clock_lru *clru, u32 idx)
+{
+	return clru->buf + clru->node_offset + (size_t)idx * clru->elem_size;
+}
+
+static struct bpf_lru_node *bpf_clock_lru_pop_free(struct bpf_lru *lru,
+						   u32 hash)
+{
+	struct bpf_clock_lru *clru = &lru->clock_lru;
+	struct pcpu_freelist_node *fnode;
+	struct bpf_lru_node *node;
+	u32 i;
+
+	fnode = pcpu_freelist_pop(&clru->freelist);
+	if (fnode) {
+		node = container_of(fnode, struct bpf_lru_node, fnode);
+		goto out;
+	}
+
+	/* Two full sweeps: the first one may only be clearing ref bits. */
+	for (i = 0; i < 2 * clru->nr_elems; i++) {
+		u32 idx = (u32)atomic_inc_return(&clru->hand) % clru->nr_elems;
+
+		bool evicted;
+
+		node = bpf_clock_lru_node(clru, idx);
+		if (READ_ONCE(node->type) != BPF_LRU_LIST_T_ACTIVE)
+			continue;
+
+		if (bpf_lru_node_is_ref(node)) {
+			bpf_lru_node_clear_ref(node);
+			continue;
+		}
+
+		/* Claim the node against other sweepers; the htab bucket
+		 * lock taken by del_from_htab() decides against a
+		 * concurrent delete, whose push_free then recycles it.
+		 */
+		if (test_and_set_bit_lock(idx, clru->claimed))
+			continue;
+
+		evicted = READ_ONCE(node->type) == BPF_LRU_LIST_T_ACTIVE &&
+			  bpf_lru_del_from_htab(lru, node);
+		clear_bit_unlock(idx, clru->claimed);
+		if (evicted)
+			goto out;
+	}
+
+	return NULL;
+
+out:
+	*(u32 *)((void *)node + lru->hash_offset) = hash;
+	bpf_lru_node_clear_ref(node);
+	WRITE_ONCE(node->type, BPF_LRU_LIST_T_ACTIVE);
+	return node;
+}
+
 struct bpf_lru_node *bpf_lru_pop_free(struct bpf_lru *lru, u32 hash)
 {
-	if (lru->percpu)
+	if (lru->clock)
+		return bpf_clock_lru_pop_free(lru, hash);
+	else if (lru->percpu)
 		return bpf_percpu_lru_pop_free(lru, hash);
 	else
 		return bpf_common_lru_pop_free(lru, hash);
@@ -553,9 +624,21 @@ static void bpf_percpu_lru_push_free(struct bpf_lru *lru,
 	raw_spin_unlock_irqrestore(&l->lock, flags);
 }
 
+static void bpf_clock_lru_push_free(struct bpf_lru *lru,
+				    struct bpf_lru_node *node)
+{
+	if (WARN_ON_ONCE(READ_ONCE(node->type) == BPF_LRU_LIST_T_FREE))
+		return;
+
+	WRITE_ONCE(node->type, BPF_LRU_LIST_T_FREE);
+	pcpu_freelist_push(&lru->clock_lru.freelist, &node->fnode);
+}
+
 void bpf_lru_push_free(struct bpf_lru *lru, struct bpf_lru_node *node)
 {
-	if (lru->percpu)
+	if (lru->clock)
+		bpf_clock_lru_push_free(lru, node);
+	else if (lru->percpu)
 		bpf_percpu_lru_push_free(lru, node);
 	else
 		bpf_common_lru_push_free(lru, node);
@@ -610,15 +693,52 @@ again:
 	}
 }
 
-void bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
-		      u32 elem_size, u32 nr_elems)
+static int bpf_clock_lru_populate(struct bpf_lru *lru, void *buf,
+				  u32 node_offset, u32 elem_size,
+				  u32 nr_elems)
+{
+	struct bpf_clock_lru *clru = &lru->clock_lru;
+	u32 i;
+
+	clru->claimed = bitmap_zalloc(nr_elems, GFP_USER | __GFP_NOWARN);
+	if (!clru->claimed)
+		return -ENOMEM;
+
+	clru->buf = buf;
+	clru->node_offset = node_offset;
+	clru->elem_size = elem_size;
+	clru->nr_elems = nr_elems;
+	atomic_set(&clru->hand, 0);
+
+	for (i = 0; i < nr_elems; i++) {
+		struct bpf_lru_node *node = bpf_clock_lru_node(clru, i);
+
+		node->type = BPF_LRU_LIST_T_FREE;
+		bpf_lru_node_clear_ref(node);
+	}
+
+	pcpu_freelist_populate(&clru->freelist,
+			       buf + node_offset +
+			       offsetof(struct bpf_lru_node, fnode),
+			       elem_size, nr_elems);
+
+	return 0;
+}
+
+int bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
+		     u32 elem_size, u32 nr_elems)
 {
-	if (lru->percpu)
+	if (lru->clock)
+		return bpf_clock_lru_populate(lru, buf, node_offset, elem_size,
+					      nr_elems);
+	else if (lru->percpu)
 		bpf_percpu_lru_populate(lru, buf, node_offset, elem_size,
 					nr_elems);
 	else
 		bpf_common_lru_populate(lru, buf, node_offset, elem_size,
 					nr_elems);
+
+	return 0;
 }
 
 static void bpf_lru_locallist_init(struct bpf_lru_locallist *loc_l, int cpu)
@@ -648,15 +768,28 @@ static void bpf_lru_list_init(struct bpf_lru_list *l)
 	raw_spin_lock_init(&l->lock);
 }
 
-int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
-		 del_from_htab_func del_from_htab, void *del_arg)
+int bpf_lru_init(struct bpf_lru *lru, bool percpu, bool clock,
+		 u32 hash_offset, del_from_htab_func del_from_htab,
+		 void *del_arg)
 {
-	int cpu;
+	int cpu, err;
+
+	lru->nr_evictions = alloc_percpu(unsigned long);
+	if (!lru->nr_evictions)
+		return -ENOMEM;
 
-	if (percpu) {
+	if (clock) {
+		err = pcpu_freelist_init(&lru->clock_lru.freelist);
+		if (err) {
+			free_percpu(lru->nr_evictions);
+			return err;
+		}
+	} else if (percpu) {
 		lru->percpu_lru = alloc_percpu(struct bpf_lru_list);
-		if (!lru->percpu_lru)
+		if (!lru->percpu_lru) {
+			free_percpu(lru->nr_evictions);
 			return -ENOMEM;
+		}
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_list *l;
@@ -669,8 +802,10 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 		struct bpf_common_lru *clru = &lru->common_lru;
 
 		clru->local_list = alloc_percpu(struct bpf_lru_locallist);
-		if (!clru->local_list)
+		if (!clru->local_list) {
+			free_percpu(lru->nr_evictions);
 			return -ENOMEM;
+		}
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_locallist *loc_l;
@@ -684,6 +819,7 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 	}
 
 	lru->percpu = percpu;
+	lru->clock = clock;
 	lru->del_from_htab = del_from_htab;
 	lru->del_arg = del_arg;
 	lru->hash_offset = hash_offset;
@@ -693,8 +829,24 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 
 void bpf_lru_destroy(struct bpf_lru *lru)
 {
-	if (lru->percpu)
+	if (lru->clock) {
+		pcpu_freelist_destroy(&lru->clock_lru.freelist);
+		bitmap_free(lru->clock_lru.claimed);
+	} else if (lru->percpu) {
 		free_percpu(lru->percpu_lru);
-	else
+	} else {
 		free_percpu(lru->common_lru.local_list);
+	}
+	free_percpu(lru->nr_evictions);
+}
+
+unsigned long bpf_lru_evictions(const struct bpf_lru *lru)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += *per_cpu_ptr(lru->nr_evictions, cpu);
+
+	return sum;
 }
@@ -7,6 +7,9 @@
 #include <linux/cache.h>
 #include <linux/list.h>
 #include <linux/spinlock_types.h>
+#include <linux/atomic.h>
+
+#include "percpu_freelist.h"
 
 #define NR_BPF_LRU_LIST_T	(3)
 #define NR_BPF_LRU_LIST_COUNT	(2)
@@ -22,7 +25,11 @@ enum bpf_lru_list_type {
 };
 
 struct bpf_lru_node {
-	struct list_head list;
+	union {
+		struct list_head list;
+		/* free nodes of a clock LRU sit on a percpu freelist */
+		struct pcpu_freelist_node fnode;
+	};
 	u16 cpu;
 	u8 type;
 	u8 ref;
@@ -48,18 +55,35 @@ struct bpf_common_lru {
 	struct bpf_lru_locallist __percpu *local_list;
 };
 
+/* Approximate LRU without any list: free nodes come from a percpu
+ * freelist and, once it runs dry, a clock hand sweeps the preallocated
+ * elements, clearing ref bits and evicting the first unreferenced one.
+ */
+struct bpf_clock_lru {
+	struct pcpu_freelist freelist;
+	unsigned long *claimed;	/* one bit per element, held by a sweeper */
+	void *buf;
+	u32 node_offset;
+	u32 elem_size;
+	u32 nr_elems;
+	atomic_t hand;
+};
+
 typedef bool (*del_from_htab_func)(void *arg, struct bpf_lru_node *node);
 
 struct bpf_lru {
 	union {
 		struct bpf_common_lru common_lru;
 		struct bpf_lru_list __percpu *percpu_lru;
+		struct bpf_clock_lru clock_lru;
 	};
 	del_from_htab_func del_from_htab;
 	void *del_arg;
+	unsigned long __percpu *nr_evictions;
 	unsigned int hash_offset;
 	unsigned int nr_scans;
 	bool percpu;
+	bool clock;
 };
 
 static inline void bpf_lru_node_set_ref(struct bpf_lru_node *node)
@@ -68,13 +92,15 @@ static inline void bpf_lru_node_set_ref(struct bpf_lru_node *node)
 		WRITE_ONCE(node->ref, 1);
 }
 
-int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
-		 del_from_htab_func del_from_htab, void *delete_arg);
-void bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
-		      u32 elem_size, u32 nr_elems);
+int bpf_lru_init(struct bpf_lru *lru, bool percpu, bool clock,
+		 u32 hash_offset, del_from_htab_func del_from_htab,
+		 void *delete_arg);
+int bpf_lru_populate(struct bpf_lru *lru, void *buf, u32 node_offset,
+		     u32 elem_size, u32 nr_elems);
 void bpf_lru_destroy(struct bpf_lru *lru);
 struct bpf_lru_node *bpf_lru_pop_free(struct bpf_lru *lru, u32 hash);
 void bpf_lru_push_free(struct bpf_lru *lru, struct bpf_lru_node *node);
 void bpf_lru_promote(struct bpf_lru *lru, struct bpf_lru_node *node);
+unsigned long bpf_lru_evictions(const struct bpf_lru *lru);
 
 #endif
@@ -29,6 +29,7 @@
 #include <linux/completion.h>
 #include <trace/events/xdp.h>
 #include <linux/btf_ids.h>
+#include <linux/seq_file.h>
 
 #include <linux/netdevice.h>   /* netif_receive_skb_list */
 #include <linux/etherdevice.h> /* eth_type_trans */
@@ -40,7 +41,8 @@
  * which queue in bpf_cpu_map_entry contains packets.
  */
 
-#define CPU_MAP_BULK_SIZE 8  /* 8 == one cacheline on 64-bit archs */
+/* One cacheline of frame pointers: 8 on 64-bit, 16 on 32-bit archs */
+#define CPU_MAP_BULK_SIZE (L1_CACHE_BYTES / sizeof(void *))
 struct bpf_cpu_map_entry;
 struct bpf_cpu_map;
 
@@ -49,6 +51,11 @@ struct xdp_bulk_queue {
 	struct list_head flush_node;
 	struct bpf_cpu_map_entry *obj;
 	unsigned int count;
+
+	/* shown in the map's fdinfo */
+	u64 enqueued;	/* frames moved to the remote CPU's queue */
+	u64 drops;	/* frames dropped because that queue was full */
+	u64 flushes;
 };
 
 /* Struct for every remote "destination" CPU in map */
@@ -73,6 +80,10 @@ struct bpf_cpu_map_entry {
 
 	struct work_struct kthread_stop_wq;
 	struct completion kthread_running;
+
+	/* only written by the kthread */
+	u64 kthread_pass;	/* xdp frames turned into skbs */
+	u64 kthread_drops;	/* frames dropped by the prog or alloc failures */
 };
 
 struct bpf_cpu_map {
@@ -397,6 +408,11 @@ static int cpu_map_kthread_run(void *data)
 		}
 		netif_receive_skb_list(&list);
 
+		WRITE_ONCE(rcpu->kthread_pass, rcpu->kthread_pass +
+			   nframes - kmem_alloc_drops);
+		WRITE_ONCE(rcpu->kthread_drops, rcpu->kthread_drops +
+			   stats.drop + kmem_alloc_drops);
+
 		/* Feedback loop via tracepoint */
 		trace_xdp_cpumap_kthread(rcpu->map_id, n, kmem_alloc_drops,
 					 sched, &stats);
@@ -644,6 +660,41 @@ static void cpu_map_free(struct bpf_map *map)
 	bpf_map_area_free(cmap);
 }
 
+/* Counters of the entries currently in the map; they go away with an entry */
+static void cpu_map_show_fdinfo(const struct bpf_map *map, struct seq_file *m)
+{
+	struct bpf_cpu_map *cmap = container_of(map, struct bpf_cpu_map, map);
+	u64 enqueued = 0, drops = 0, flushes = 0, pass = 0, kdrops = 0;
+	u32 i;
+	int cpu;
+
+	rcu_read_lock();
+	for (i = 0; i < cmap->map.max_entries; i++) {
+		struct bpf_cpu_map_entry *rcpu;
+
+		rcpu = rcu_dereference(cmap->cpu_map[i]);
+		if (!rcpu)
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			struct xdp_bulk_queue *bq = per_cpu_ptr(rcpu->bulkq, cpu);
+
+			enqueued += READ_ONCE(bq->enqueued);
+			drops += READ_ONCE(bq->drops);
+			flushes += READ_ONCE(bq->flushes);
+		}
+		pass += READ_ONCE(rcpu->kthread_pass);
+		kdrops += READ_ONCE(rcpu->kthread_drops);
+	}
+	rcu_read_unlock();
+
+	seq_printf(m, "enqueue:\t%llu\n", enqueued);
+	seq_printf(m, "enqueue_drop:\t%llu\n", drops);
+	seq_printf(m, "flush:\t%llu\n", flushes);
+	seq_printf(m, "kthread_pass:\t%llu\n", pass);
+	seq_printf(m, "kthread_drop:\t%llu\n", kdrops);
+}
+
 /* Elements are kept alive by RCU; either by rcu_read_lock() (from syscall) or
  * by local_bh_disable() (from XDP calls inside NAPI). The
  * rcu_read_lock_bh_held() below makes lockdep accept both.
@@ -704,6 +755,7 @@ const struct bpf_map_ops cpu_map_ops = {
 	.map_check_btf		= map_check_no_btf,
 	.map_btf_id		= &cpu_map_btf_ids[0],
 	.map_redirect		= cpu_map_redirect,
+	.map_show_fdinfo	= cpu_map_show_fdinfo,
 };
 
 static void bq_flush_to_queue(struct xdp_bulk_queue *bq)
@@ -736,6 +788,10 @@ static void bq_flush_to_queue(struct xdp_bulk_queue *bq)
 
 	__list_del_clearprev(&bq->flush_node);
 
+	bq->enqueued += processed - drops;
+	bq->drops += drops;
+	bq->flushes++;
+
 	/* Feedback loop via tracepoints */
 	trace_xdp_cpumap_enqueue(rcpu->map_id, processed, drops, to_cpu);
 }
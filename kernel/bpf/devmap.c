@@ -49,6 +49,7 @@
 #include <linux/filter.h>
 #include <trace/events/xdp.h>
 #include <linux/btf_ids.h>
+#include <linux/seq_file.h>
 
 #define DEV_CREATE_FLAG_MASK \
 	(BPF_F_NUMA_NODE | BPF_F_RDONLY | BPF_F_WRONLY)
@@ -59,9 +60,19 @@ struct xdp_dev_bulk_queue {
 	struct net_device *dev;
 	struct net_device *dev_rx;
 	struct bpf_prog *xdp_prog;
+	struct bpf_dtab *dtab;
 	unsigned int count;
 };
 
+/* Per-cpu redirect counters of a devmap, shown in the map's fdinfo */
+struct bpf_dtab_stats {
+	u64 redirect;		/* frames queued through this map */
+	u64 xmit;		/* frames accepted by ndo_xdp_xmit() */
+	u64 drop;		/* frames dropped by the devmap prog or the driver */
+	u64 flush;		/* bulk transmits */
+	u64 flush_full;		/* ... of which because the bulk queue filled up */
+};
+
 struct bpf_dtab_netdev {
 	struct net_device *dev; /* must be first member, due to tracepoint */
 	struct hlist_node index_hlist;
@@ -82,6 +93,8 @@ struct bpf_dtab {
 	spinlock_t index_lock;
 	unsigned int items;
 	u32 n_buckets;
+
+	struct bpf_dtab_stats __percpu *stats;
 };
 
 static DEFINE_PER_CPU(struct list_head, dev_flush_list);
@@ -168,8 +181,16 @@ static struct bpf_map *dev_map_alloc(union bpf_attr *attr)
 	if (!dtab)
 		return ERR_PTR(-ENOMEM);
 
+	dtab->stats = alloc_percpu_gfp(struct bpf_dtab_stats,
+				       GFP_USER | __GFP_ACCOUNT);
+	if (!dtab->stats) {
+		bpf_map_area_free(dtab);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	err = dev_map_init_map(dtab, attr);
 	if (err) {
+		free_percpu(dtab->stats);
 		bpf_map_area_free(dtab);
 		return ERR_PTR(err);
 	}
@@ -241,9 +262,33 @@ static void dev_map_free(struct bpf_map *map)
 		bpf_map_area_free(dtab->netdev_map);
 	}
 
+	free_percpu(dtab->stats);
 	bpf_map_area_free(dtab);
 }
 
+static void dev_map_show_fdinfo(const struct bpf_map *map, struct seq_file *m)
+{
+	struct bpf_dtab *dtab = container_of(map, struct bpf_dtab, map);
+	struct bpf_dtab_stats sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct bpf_dtab_stats *st = per_cpu_ptr(dtab->stats, cpu);
+
+		sum.redirect += READ_ONCE(st->redirect);
+		sum.xmit += READ_ONCE(st->xmit);
+		sum.drop += READ_ONCE(st->drop);
+		sum.flush += READ_ONCE(st->flush);
+		sum.flush_full += READ_ONCE(st->flush_full);
+	}
+
+	seq_printf(m, "redirect:\t%llu\n", sum.redirect);
+	seq_printf(m, "xmit:\t%llu\n", sum.xmit);
+	seq_printf(m, "drop:\t%llu\n", sum.drop);
+	seq_printf(m, "flush:\t%llu\n", sum.flush);
+	seq_printf(m, "flush_full:\t%llu\n", sum.flush_full);
+}
+
 static int dev_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
 	struct bpf_dtab *dtab = container_of(map, struct bpf_dtab, map);
@@ -402,6 +447,15 @@ static void bq_xmit_all(struct xdp_dev_bulk_queue *bq, u32 flags)
 		xdp_return_frame_rx_napi(bq->q[i]);
 
 out:
+	if (bq->dtab) {
+		struct bpf_dtab_stats *st = this_cpu_ptr(bq->dtab->stats);
+
+		st->xmit += sent;
+		st->drop += cnt - sent;
+		st->flush++;
+		if (!(flags & XDP_XMIT_FLUSH))
+			st->flush_full++;
+	}
 	bq->count = 0;
 	trace_xdp_devmap_xmit(bq->dev_rx, dev, sent, cnt - sent, err);
 }
@@ -419,6 +473,7 @@ void __dev_flush(void)
 		bq_xmit_all(bq, XDP_XMIT_FLUSH);
 		bq->dev_rx = NULL;
 		bq->xdp_prog = NULL;
+		bq->dtab = NULL;
 		__list_del_clearprev(&bq->flush_node);
 	}
 }
@@ -445,7 +500,8 @@ static void *__dev_map_lookup_elem(struct bpf_map *map, u32 key)
  * xdp_do_flush() in filter.c.
  */
 static void bq_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
-		       struct net_device *dev_rx, struct bpf_prog *xdp_prog)
+		       struct net_device *dev_rx, struct bpf_prog *xdp_prog,
+		       struct bpf_dtab *dtab)
 {
 	struct list_head *flush_list = this_cpu_ptr(&dev_flush_list);
 	struct xdp_dev_bulk_queue *bq = this_cpu_ptr(dev->xdp_bulkq);
@@ -458,20 +514,25 @@ static void bq_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
 	 * from net_device drivers NAPI func end.
 	 *
 	 * Do the same with xdp_prog and flush_list since these fields
-	 * are only ever modified together.
+	 * are only ever modified together. The transmit counters go to
+	 * the map that queued the first frame of this NAPI cycle.
 	 */
 	if (!bq->dev_rx) {
 		bq->dev_rx = dev_rx;
 		bq->xdp_prog = xdp_prog;
+		bq->dtab = dtab;
 		list_add(&bq->flush_node, flush_list);
 	}
 
+	if (dtab)
+		this_cpu_inc(dtab->stats->redirect);
+
 	bq->q[bq->count++] = xdpf;
 }
 
 static inline int __xdp_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
 				struct net_device *dev_rx,
-				struct bpf_prog *xdp_prog)
+				struct bpf_prog *xdp_prog, struct bpf_dtab *dtab)
 {
 	int err;
 
@@ -482,7 +543,7 @@ static inline int __xdp_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
 	if (unlikely(err))
 		return err;
 
-	bq_enqueue(dev, xdpf, dev_rx, xdp_prog);
+	bq_enqueue(dev, xdpf, dev_rx, xdp_prog, dtab);
 	return 0;
 }
 
@@ -520,7 +581,7 @@ static u32 dev_map_bpf_prog_run_skb(struct sk_buff *skb, struct bpf_dtab_netdev
 int dev_xdp_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
 		    struct net_device *dev_rx)
 {
-	return __xdp_enqueue(dev, xdpf, dev_rx, NULL);
+	return __xdp_enqueue(dev, xdpf, dev_rx, NULL, NULL);
 }
 
 int dev_map_enqueue(struct bpf_dtab_netdev *dst, struct xdp_frame *xdpf,
@@ -528,7 +589,7 @@ int dev_map_enqueue(struct bpf_dtab_netdev *dst, struct xdp_frame *xdpf,
 {
 	struct net_device *dev = dst->dev;
 
-	return __xdp_enqueue(dev, xdpf, dev_rx, dst->xdp_prog);
+	return __xdp_enqueue(dev, xdpf, dev_rx, dst->xdp_prog, dst->dtab);
 }
 
 static bool is_valid_dst(struct bpf_dtab_netdev *obj, struct xdp_frame *xdpf)
@@ -553,7 +614,7 @@ static int dev_map_enqueue_clone(struct bpf_dtab_netdev *obj,
 	if (!nxdpf)
 		return -ENOMEM;
 
-	bq_enqueue(obj->dev, nxdpf, dev_rx, obj->xdp_prog);
+	bq_enqueue(obj->dev, nxdpf, dev_rx, obj->xdp_prog, obj->dtab);
 
 	return 0;
 }
@@ -650,7 +711,8 @@ int dev_map_enqueue_multi(struct xdp_frame *xdpf, struct net_device *dev_rx,
 
 	/* consume the last copy of the frame */
 	if (last_dst)
-		bq_enqueue(last_dst->dev, xdpf, dev_rx, last_dst->xdp_prog);
+		bq_enqueue(last_dst->dev, xdpf, dev_rx, last_dst->xdp_prog,
+			   last_dst->dtab);
 	else
 		xdp_return_frame_rx_napi(xdpf); /* dtab is empty */
 
@@ -1019,6 +1081,7 @@ const struct bpf_map_ops dev_map_ops = {
 	.map_check_btf = map_check_no_btf,
 	.map_btf_id = &dev_map_btf_ids[0],
 	.map_redirect = dev_map_redirect,
+	.map_show_fdinfo = dev_map_show_fdinfo,
 };
 
 const struct bpf_map_ops dev_map_hash_ops = {
@@ -1032,6 +1095,7 @@ const struct bpf_map_ops dev_map_hash_ops = {
 	.map_check_btf = map_check_no_btf,
 	.map_btf_id = &dev_map_btf_ids[0],
 	.map_redirect = dev_hash_map_redirect,
+	.map_show_fdinfo = dev_map_show_fdinfo,
 };
 
 static void dev_map_hash_remove_netdev(struct bpf_dtab *dtab,
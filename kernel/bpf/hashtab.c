@@ -18,7 +18,7 @@
 
 #define HTAB_CREATE_FLAG_MASK						\
 	(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU | BPF_F_NUMA_NODE |	\
-	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED)
+	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED | BPF_F_LRU_CLOCK)
 
 #define BATCH_OPS(_name)			\
 	.map_lookup_batch =			\
@@ -338,6 +338,7 @@ skip_percpu_elems:
 	if (htab_is_lru(htab))
 		err = bpf_lru_init(&htab->lru,
 				   htab->map.map_flags & BPF_F_NO_COMMON_LRU,
+				   htab->map.map_flags & BPF_F_LRU_CLOCK,
 				   offsetof(struct htab_elem, hash) -
 				   offsetof(struct htab_elem, lru_node),
 				   htab_lru_map_delete_node,
@@ -348,14 +349,19 @@ skip_percpu_elems:
 	if (err)
 		goto free_elems;
 
-	if (htab_is_lru(htab))
-		bpf_lru_populate(&htab->lru, htab->elems,
-				 offsetof(struct htab_elem, lru_node),
-				 htab->elem_size, num_entries);
-	else
+	if (htab_is_lru(htab)) {
+		err = bpf_lru_populate(&htab->lru, htab->elems,
+				       offsetof(struct htab_elem, lru_node),
+				       htab->elem_size, num_entries);
+		if (err) {
+			bpf_lru_destroy(&htab->lru);
+			goto free_elems;
+		}
+	} else {
 		pcpu_freelist_populate(&htab->freelist,
 				       htab->elems + offsetof(struct htab_elem, fnode),
 				       htab->elem_size, num_entries);
+	}
 
 	return 0;
 
@@ -410,6 +416,7 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	 * nothing to do with the map's value.
 	 */
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
+	bool clock_lru = (attr->map_flags & BPF_F_LRU_CLOCK);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
 	bool zero_seed = (attr->map_flags & BPF_F_ZERO_SEED);
 	int numa_node = bpf_map_attr_numa_node(attr);
@@ -434,6 +441,9 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	if (!lru && percpu_lru)
 		return -EINVAL;
 
+	if (clock_lru && (!lru || percpu_lru))
+		return -EINVAL;
+
 	if (lru && !prealloc)
 		return -ENOTSUPP;
 
@@ -777,6 +787,14 @@ static void check_and_free_fields(struct bpf_htab *htab,
 		bpf_map_free_kptrs(&htab->map, map_value);
 }
 
+static void htab_lru_map_show_fdinfo(const struct bpf_map *map,
+				     struct seq_file *m)
+{
+	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+
+	seq_printf(m, "lru_evictions:\t%lu\n", bpf_lru_evictions(&htab->lru));
+}
+
 /* It is called from the bpf_lru_list when the LRU needs to delete
  * older elements from the htab.
  */
@@ -2230,6 +2248,7 @@ const struct bpf_map_ops htab_lru_map_ops = {
 	.map_delete_elem = htab_lru_map_delete_elem,
 	.map_gen_lookup = htab_lru_map_gen_lookup,
 	.map_seq_show_elem = htab_map_seq_show_elem,
+	.map_show_fdinfo = htab_lru_map_show_fdinfo,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
 	BATCH_OPS(htab_lru),
@@ -2400,6 +2419,7 @@ const struct bpf_map_ops htab_lru_percpu_map_ops = {
 	.map_delete_elem = htab_lru_map_delete_elem,
 	.map_lookup_percpu_elem = htab_lru_percpu_map_lookup_percpu_elem,
 	.map_seq_show_elem = htab_percpu_map_seq_show_elem,
+	.map_show_fdinfo = htab_lru_map_show_fdinfo,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_hash_elem,
 	BATCH_OPS(htab_lru_percpu),
@@ -9,9 +9,11 @@
 #include <linux/bpf.h>
 #include <linux/btf.h>
 #include <linux/err.h>
+#include <linux/irq_work.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <net/ipv6.h>
 #include <uapi/linux/btf.h>
 #include <linux/btf_ids.h>
@@ -29,6 +31,26 @@ struct lpm_trie_node {
 	u8				data[];
 };
 
+/* With BPF_F_LPM_STRIDE, lookups for keys of at least LPM_STRIDE_BITS bits
+ * start from an entry of a table indexed by the first LPM_STRIDE_BITS bits of
+ * the key: @best is the longest real node of at most LPM_STRIDE_BITS bits
+ * that matches, @start is the first node with a longer prefix on the path the
+ * walk from the root would take. The table points to trie nodes, so any
+ * change to the trie unpublishes it first and a worker rebuilds it later.
+ */
+#define LPM_STRIDE_BITS		16
+#define LPM_STRIDE_DELAY	(HZ / 10)
+
+struct lpm_stride_entry {
+	struct lpm_trie_node		*best;
+	struct lpm_trie_node		*start;
+};
+
+struct lpm_stride_table {
+	struct rcu_head			rcu;
+	struct lpm_stride_entry		ent[1U << LPM_STRIDE_BITS];
+};
+
 struct lpm_trie {
 	struct bpf_map			map;
 	struct lpm_trie_node __rcu	*root;
@@ -36,6 +58,12 @@ struct lpm_trie {
 	size_t				max_prefixlen;
 	size_t				data_size;
 	spinlock_t			lock;
+
+	/* BPF_F_LPM_STRIDE only */
+	struct lpm_stride_table __rcu	*stride;
+	struct delayed_work		stride_work;
+	struct irq_work			stride_irq_work;
+	u32				gen;
 };
 
 /* This trie implements a longest prefix match algorithm that can be used to
@@ -224,20 +252,38 @@ static size_t longest_prefix_match(const struct lpm_trie *trie,
 	return prefixlen;
 }
 
+static inline u32 lpm_stride_index(const u8 *data)
+{
+	return (data[0] << 8) | data[1];
+}
+
 /* Called from syscall or from eBPF program */
 static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 {
 	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
 	struct lpm_trie_node *node, *found = NULL;
 	struct bpf_lpm_trie_key *key = _key;
+	struct lpm_stride_table *stride;
 
 	if (key->prefixlen > trie->max_prefixlen)
 		return NULL;
 
-	/* Start walking the trie from the root node ... */
+	/* Start walking the trie from the stride table entry if there is one,
+	 * or from the root node ...
+	 */
+	stride = rcu_dereference_check(trie->stride, rcu_read_lock_bh_held());
+	if (stride && key->prefixlen >= LPM_STRIDE_BITS) {
+		const struct lpm_stride_entry *ent;
+
+		ent = &stride->ent[lpm_stride_index(key->data)];
+		found = ent->best;
+		node = ent->start;
+	} else {
+		node = rcu_dereference_check(trie->root,
+					     rcu_read_lock_bh_held());
+	}
 
-	for (node = rcu_dereference_check(trie->root, rcu_read_lock_bh_held());
-	     node;) {
+	while (node) {
 		unsigned int next_bit;
 		size_t matchlen;
 
@@ -280,7 +326,7 @@ static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 }
 
 static struct lpm_trie_node *lpm_trie_node_alloc(const struct lpm_trie *trie,
-						 const void *value)
+						 const void *value, gfp_t gfp)
 {
 	struct lpm_trie_node *node;
 	size_t size = sizeof(struct lpm_trie_node) + trie->data_size;
@@ -288,7 +334,7 @@ static struct lpm_trie_node *lpm_trie_node_alloc(const struct lpm_trie *trie,
 	if (value)
 		size += trie->map.value_size;
 
-	node = bpf_map_kmalloc_node(&trie->map, size, GFP_NOWAIT | __GFP_NOWARN,
+	node = bpf_map_kmalloc_node(&trie->map, size, gfp | __GFP_NOWARN,
 				    trie->map.numa_node);
 	if (!node)
 		return NULL;
@@ -302,56 +348,121 @@ static struct lpm_trie_node *lpm_trie_node_alloc(const struct lpm_trie *trie,
 	return node;
 }
 
-/* Called from syscall or from eBPF program */
-static int trie_update_elem(struct bpf_map *map,
-			    void *_key, void *value, u64 flags)
+static void lpm_stride_fill(struct lpm_stride_table *tbl,
+			    const struct lpm_trie_node *node)
 {
-	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
-	struct lpm_trie_node *node, *im_node = NULL, *new_node = NULL;
-	struct lpm_trie_node __rcu **slot;
-	struct bpf_lpm_trie_key *key = _key;
+	u32 idx, n, i;
+
+	if (!node)
+		return;
+
+	idx = lpm_stride_index(node->data);
+
+	/* A node of exactly LPM_STRIDE_BITS bits has children with the same
+	 * index, so the walk has to start at the node itself.
+	 */
+	if (node->prefixlen >= LPM_STRIDE_BITS) {
+		tbl->ent[idx].start = (struct lpm_trie_node *)node;
+		return;
+	}
+
+	/* Preorder, so more specific nodes overwrite their ancestors */
+	if (!(node->flags & LPM_TREE_NODE_FLAG_IM)) {
+		n = 1U << (LPM_STRIDE_BITS - node->prefixlen);
+		idx &= ~(n - 1);
+		for (i = 0; i < n; i++)
+			tbl->ent[idx + i].best = (struct lpm_trie_node *)node;
+	}
+
+	lpm_stride_fill(tbl, rcu_dereference(node->child[0]));
+	lpm_stride_fill(tbl, rcu_dereference(node->child[1]));
+}
+
+static void lpm_stride_build(struct work_struct *work)
+{
+	struct lpm_trie *trie = container_of(to_delayed_work(work),
+					     struct lpm_trie, stride_work);
+	struct lpm_stride_table *tbl;
 	unsigned long irq_flags;
-	unsigned int next_bit;
-	size_t matchlen = 0;
-	int ret = 0;
+	u32 gen;
 
-	if (unlikely(flags > BPF_EXIST))
-		return -EINVAL;
+	tbl = bpf_map_area_alloc(sizeof(*tbl), trie->map.numa_node);
+	if (!tbl)
+		return;
 
-	if (key->prefixlen > trie->max_prefixlen)
-		return -EINVAL;
+	/* Walk the trie locklessly; if it changed meanwhile, the table may be
+	 * inconsistent and is thrown away. The update that changed it has
+	 * queued another build.
+	 */
+	gen = READ_ONCE(trie->gen);
+	rcu_read_lock();
+	lpm_stride_fill(tbl, rcu_dereference(trie->root));
+	rcu_read_unlock();
 
 	spin_lock_irqsave(&trie->lock, irq_flags);
+	if (gen == trie->gen && !rcu_access_pointer(trie->stride)) {
+		rcu_assign_pointer(trie->stride, tbl);
+		tbl = NULL;
+	}
+	spin_unlock_irqrestore(&trie->lock, irq_flags);
 
-	/* Allocate and fill a new node */
+	if (tbl)
+		bpf_map_area_free(tbl);
+}
 
-	if (trie->n_entries == trie->map.max_entries) {
-		ret = -ENOSPC;
-		goto out;
-	}
+/* Updates may come from BPF programs in any context, NMI included */
+static void lpm_stride_kick(struct irq_work *work)
+{
+	struct lpm_trie *trie = container_of(work, struct lpm_trie,
+					     stride_irq_work);
 
-	new_node = lpm_trie_node_alloc(trie, value);
-	if (!new_node) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	schedule_delayed_work(&trie->stride_work, LPM_STRIDE_DELAY);
+}
 
-	trie->n_entries++;
+/* Must be called before nodes are unlinked from the trie, so that no reader
+ * can find them through the stride table after their grace period.
+ */
+static void lpm_stride_invalidate(struct lpm_trie *trie)
+{
+	struct lpm_stride_table *tbl;
 
-	new_node->prefixlen = key->prefixlen;
-	RCU_INIT_POINTER(new_node->child[0], NULL);
-	RCU_INIT_POINTER(new_node->child[1], NULL);
-	memcpy(new_node->data, key->data, trie->data_size);
+	if (!(trie->map.map_flags & BPF_F_LPM_STRIDE))
+		return;
+
+	trie->gen++;
+	tbl = rcu_dereference_protected(trie->stride,
+					lockdep_is_held(&trie->lock));
+	if (tbl) {
+		RCU_INIT_POINTER(trie->stride, NULL);
+		kvfree_rcu(tbl, rcu);
+	}
+	irq_work_queue(&trie->stride_irq_work);
+}
+
+/* Link @new_node, made from @key, into the trie under @root. @shared tells
+ * whether @root is the live trie, updated under trie->lock, or one still
+ * private to the caller. Returns 1 if @new_node replaced an existing element,
+ * 0 if it was added, or a negative error if it was not consumed.
+ */
+static int trie_insert(struct lpm_trie *trie, struct lpm_trie_node __rcu **root,
+		       struct lpm_trie_node *new_node,
+		       const struct bpf_lpm_trie_key *key,
+		       bool shared, gfp_t gfp)
+{
+	struct lpm_trie_node *node, *im_node;
+	struct lpm_trie_node __rcu **slot;
+	unsigned int next_bit;
+	size_t matchlen = 0;
 
 	/* Now find a slot to attach the new node. To do that, walk the tree
 	 * from the root and match as many bits as possible for each node until
 	 * we either find an empty slot or a slot that needs to be replaced by
 	 * an intermediate node.
 	 */
-	slot = &trie->root;
+	slot = root;
 
 	while ((node = rcu_dereference_protected(*slot,
-					lockdep_is_held(&trie->lock)))) {
+			!shared || lockdep_is_held(&trie->lock)))) {
 		matchlen = longest_prefix_match(trie, node, key);
 
 		if (node->prefixlen != matchlen ||
@@ -368,23 +479,22 @@ static int trie_update_elem(struct bpf_map *map,
 	 */
 	if (!node) {
 		rcu_assign_pointer(*slot, new_node);
-		goto out;
+		return 0;
 	}
 
 	/* If the slot we picked already exists, replace it with @new_node
 	 * which already has the correct data array set.
 	 */
 	if (node->prefixlen == matchlen) {
+		int replaced = !(node->flags & LPM_TREE_NODE_FLAG_IM);
+
 		new_node->child[0] = node->child[0];
 		new_node->child[1] = node->child[1];
 
-		if (!(node->flags & LPM_TREE_NODE_FLAG_IM))
-			trie->n_entries--;
-
 		rcu_assign_pointer(*slot, new_node);
 		kfree_rcu(node, rcu);
 
-		goto out;
+		return replaced;
 	}
 
 	/* If the new node matches the prefix completely, it must be inserted
@@ -394,14 +504,12 @@ static int trie_update_elem(struct bpf_map *map,
 		next_bit = extract_bit(node->data, matchlen);
 		rcu_assign_pointer(new_node->child[next_bit], node);
 		rcu_assign_pointer(*slot, new_node);
-		goto out;
+		return 0;
 	}
 
-	im_node = lpm_trie_node_alloc(trie, NULL);
-	if (!im_node) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	im_node = lpm_trie_node_alloc(trie, NULL, gfp);
+	if (!im_node)
+		return -ENOMEM;
 
 	im_node->prefixlen = matchlen;
 	im_node->flags |= LPM_TREE_NODE_FLAG_IM;
@@ -419,15 +527,71 @@ static int trie_update_elem(struct bpf_map *map,
 	/* Finally, assign the intermediate node to the determined slot */
 	rcu_assign_pointer(*slot, im_node);
 
-out:
-	if (ret) {
-		if (new_node)
-			trie->n_entries--;
+	return 0;
+}
+
+static struct lpm_trie_node *lpm_trie_new_leaf(struct lpm_trie *trie,
+					       const struct bpf_lpm_trie_key *key,
+					       const void *value, gfp_t gfp)
+{
+	struct lpm_trie_node *new_node;
+
+	new_node = lpm_trie_node_alloc(trie, value, gfp);
+	if (!new_node)
+		return NULL;
+
+	new_node->prefixlen = key->prefixlen;
+	RCU_INIT_POINTER(new_node->child[0], NULL);
+	RCU_INIT_POINTER(new_node->child[1], NULL);
+	memcpy(new_node->data, key->data, trie->data_size);
+
+	return new_node;
+}
+
+/* Called from syscall or from eBPF program */
+static int trie_update_elem(struct bpf_map *map,
+			    void *_key, void *value, u64 flags)
+{
+	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
+	struct bpf_lpm_trie_key *key = _key;
+	struct lpm_trie_node *new_node;
+	unsigned long irq_flags;
+	int ret = 0;
 
+	if (unlikely(flags > BPF_EXIST))
+		return -EINVAL;
+
+	if (key->prefixlen > trie->max_prefixlen)
+		return -EINVAL;
+
+	spin_lock_irqsave(&trie->lock, irq_flags);
+
+	/* Allocate and fill a new node */
+
+	if (trie->n_entries == trie->map.max_entries) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	new_node = lpm_trie_new_leaf(trie, key, value, GFP_NOWAIT);
+	if (!new_node) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	lpm_stride_invalidate(trie);
+
+	ret = trie_insert(trie, &trie->root, new_node, key, true, GFP_NOWAIT);
+	if (ret < 0) {
 		kfree(new_node);
-		kfree(im_node);
+		goto out;
 	}
 
+	if (!ret)
+		trie->n_entries++;
+	ret = 0;
+
+out:
 	spin_unlock_irqrestore(&trie->lock, irq_flags);
 
 	return ret;
@@ -480,6 +644,8 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 		goto out;
 	}
 
+	lpm_stride_invalidate(trie);
+
 	trie->n_entries--;
 
 	/* If the node we are removing has two children, simply mark it
@@ -541,7 +707,7 @@ out:
 #define LPM_KEY_SIZE_MIN	LPM_KEY_SIZE(LPM_DATA_SIZE_MIN)
 
 #define LPM_CREATE_FLAG_MASK	(BPF_F_NO_PREALLOC | BPF_F_NUMA_NODE |	\
-				 BPF_F_ACCESS_MASK)
+				 BPF_F_ACCESS_MASK | BPF_F_LPM_STRIDE)
 
 static struct bpf_map *trie_alloc(union bpf_attr *attr)
 {
@@ -571,14 +737,21 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 			  offsetof(struct bpf_lpm_trie_key, data);
 	trie->max_prefixlen = trie->data_size * 8;
 
+	if ((attr->map_flags & BPF_F_LPM_STRIDE) &&
+	    trie->max_prefixlen < LPM_STRIDE_BITS) {
+		bpf_map_area_free(trie);
+		return ERR_PTR(-EINVAL);
+	}
+
 	spin_lock_init(&trie->lock);
+	INIT_DELAYED_WORK(&trie->stride_work, lpm_stride_build);
+	init_irq_work(&trie->stride_irq_work, lpm_stride_kick);
 
 	return &trie->map;
 }
 
-static void trie_free(struct bpf_map *map)
+static void lpm_trie_free_nodes(struct lpm_trie_node __rcu **root)
 {
-	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
 	struct lpm_trie_node __rcu **slot;
 	struct lpm_trie_node *node;
 
@@ -588,12 +761,12 @@ static void trie_free(struct bpf_map *map)
 	 */
 
 	for (;;) {
-		slot = &trie->root;
+		slot = root;
 
 		for (;;) {
 			node = rcu_dereference_protected(*slot, 1);
 			if (!node)
-				goto out;
+				return;
 
 			if (rcu_access_pointer(node->child[0])) {
 				slot = &node->child[0];
@@ -610,11 +783,120 @@ static void trie_free(struct bpf_map *map)
 			break;
 		}
 	}
+}
 
-out:
+static void trie_free(struct bpf_map *map)
+{
+	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
+
+	irq_work_sync(&trie->stride_irq_work);
+	cancel_delayed_work_sync(&trie->stride_work);
+	bpf_map_area_free(rcu_dereference_protected(trie->stride, 1));
+
+	lpm_trie_free_nodes(&trie->root);
 	bpf_map_area_free(trie);
 }
 
+/* BPF_F_REPLACE_ALL: build a new trie from the batch outside of the lock and
+ * swap it in, so lookups see either the old or the new content and are never
+ * held up by a long series of updates.
+ */
+static int trie_replace_batch(struct lpm_trie *trie,
+			      const union bpf_attr *attr,
+			      union bpf_attr __user *uattr)
+{
+	void __user *values = u64_to_user_ptr(attr->batch.values);
+	void __user *keys = u64_to_user_ptr(attr->batch.keys);
+	struct lpm_trie_node __rcu *root = NULL, *old_root;
+	struct bpf_map *map = &trie->map;
+	struct lpm_trie_node *new_node;
+	struct bpf_lpm_trie_key *key;
+	unsigned long irq_flags;
+	size_t n_entries = 0;
+	u32 cp, max_count;
+	void *value;
+	int err = 0;
+
+	max_count = attr->batch.count;
+	if (max_count > map->max_entries)
+		return -ENOSPC;
+
+	if (put_user(0, &uattr->batch.count))
+		return -EFAULT;
+
+	key = kvmalloc(map->key_size, GFP_USER | __GFP_NOWARN);
+	value = kvmalloc(map->value_size, GFP_USER | __GFP_NOWARN);
+	if (!key || !value) {
+		err = -ENOMEM;
+		goto free_buf;
+	}
+
+	for (cp = 0; cp < max_count; cp++) {
+		err = -EFAULT;
+		if (copy_from_user(key, keys + cp * map->key_size,
+				   map->key_size) ||
+		    copy_from_user(value, values + cp * map->value_size,
+				   map->value_size))
+			break;
+
+		err = -EINVAL;
+		if (key->prefixlen > trie->max_prefixlen)
+			break;
+
+		err = -ENOMEM;
+		new_node = lpm_trie_new_leaf(trie, key, value, GFP_USER);
+		if (!new_node)
+			break;
+
+		err = trie_insert(trie, &root, new_node, key, false, GFP_USER);
+		if (err < 0) {
+			kfree(new_node);
+			break;
+		}
+		if (!err)
+			n_entries++;
+		err = 0;
+		cond_resched();
+	}
+
+	/* Nothing of a failed batch is committed */
+	if (err) {
+		lpm_trie_free_nodes(&root);
+		cp = 0;
+		goto out;
+	}
+
+	spin_lock_irqsave(&trie->lock, irq_flags);
+	lpm_stride_invalidate(trie);
+	old_root = rcu_dereference_protected(trie->root,
+					     lockdep_is_held(&trie->lock));
+	rcu_assign_pointer(trie->root, rcu_access_pointer(root));
+	trie->n_entries = n_entries;
+	spin_unlock_irqrestore(&trie->lock, irq_flags);
+
+	synchronize_rcu();
+	RCU_INIT_POINTER(root, old_root);
+	lpm_trie_free_nodes(&root);
+out:
+	if (copy_to_user(&uattr->batch.count, &cp, sizeof(cp)))
+		err = -EFAULT;
+free_buf:
+	kvfree(value);
+	kvfree(key);
+	return err;
+}
+
+static int trie_update_batch(struct bpf_map *map, const union bpf_attr *attr,
+			     union bpf_attr __user *uattr)
+{
+	struct lpm_trie *trie = container_of(map, struct lpm_trie, map);
+
+	if (attr->batch.elem_flags == BPF_F_REPLACE_ALL)
+		return trie_replace_batch(trie, attr, uattr);
+
+	return generic_map_update_batch(map, attr, uattr);
+}
+
 static int trie_get_next_key(struct bpf_map *map, void *_key, void *_next_key)
 {
 	struct lpm_trie_node *node, *next_node = NULL, *parent, *search_root;
@@ -733,7 +1015,7 @@ const struct bpf_map_ops trie_map_ops = {
 	.map_update_elem = trie_update_elem,
 	.map_delete_elem = trie_delete_elem,
 	.map_lookup_batch = generic_map_lookup_batch,
-	.map_update_batch = generic_map_update_batch,
+	.map_update_batch = trie_update_batch,
 	.map_delete_batch = generic_map_delete_batch,
 	.map_check_btf = trie_check_btf,
 	.map_btf_id = &trie_map_btf_ids[0],
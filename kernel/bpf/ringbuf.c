@@ -1,6 +1,7 @@
 #include <linux/bpf.h>
 #include <linux/btf.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
 #include <linux/irq_work.h>
 #include <linux/slab.h>
 #include <linux/filter.h>
@@ -34,6 +35,16 @@
 struct bpf_ringbuf {
 	wait_queue_head_t waitq;
 	struct irq_work work;
+	/* Adaptive wakeup policy, from map_extra of BPF_MAP_TYPE_RINGBUF:
+	 * wake after @wakeup_batch records or @wakeup_usecs after the first
+	 * record that did not wake the consumer. @pending counts records
+	 * committed since the last wakeup.
+	 */
+	u32 wakeup_batch;
+	u32 wakeup_usecs;
+	atomic_t pending;
+	struct irq_work timer_work;
+	struct hrtimer wakeup_timer;
 	u64 mask;
 	struct page **pages;
 	int nr_pages;
@@ -157,9 +168,36 @@ static void bpf_ringbuf_notify(struct irq_work *work)
 {
 	struct bpf_ringbuf *rb = container_of(work, struct bpf_ringbuf, work);
 
+	atomic_set(&rb->pending, 0);
 	wake_up_all(&rb->waitq);
 }
 
+static enum hrtimer_restart bpf_ringbuf_wakeup_timer(struct hrtimer *timer)
+{
+	struct bpf_ringbuf *rb = container_of(timer, struct bpf_ringbuf,
+					      wakeup_timer);
+
+	if (atomic_xchg(&rb->pending, 0))
+		wake_up_all(&rb->waitq);
+
+	return HRTIMER_NORESTART;
+}
+
+/* hrtimers cannot be armed from every context BPF programs run in (NMI),
+ * irq_work can, so arm the timer from there. A timer whose callback is
+ * still running has already cleared pending and must be armed again.
+ */
+static void bpf_ringbuf_arm_timer(struct irq_work *work)
+{
+	struct bpf_ringbuf *rb = container_of(work, struct bpf_ringbuf,
+					      timer_work);
+
+	if (!hrtimer_is_queued(&rb->wakeup_timer))
+		hrtimer_start(&rb->wakeup_timer,
+			      ns_to_ktime((u64)rb->wakeup_usecs * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+}
+
 static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 {
 	struct bpf_ringbuf *rb;
@@ -172,6 +210,9 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	atomic_set(&rb->busy, 0);
 	init_waitqueue_head(&rb->waitq);
 	init_irq_work(&rb->work, bpf_ringbuf_notify);
+	init_irq_work(&rb->timer_work, bpf_ringbuf_arm_timer);
+	hrtimer_init(&rb->wakeup_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	rb->wakeup_timer.function = bpf_ringbuf_wakeup_timer;
 
 	rb->mask = data_sz - 1;
 	rb->consumer_pos = 0;
@@ -210,6 +251,10 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 		return ERR_PTR(-ENOMEM);
 	}
 
+	/* map_extra is rejected by map_create() for user ring buffers */
+	rb_map->rb->wakeup_batch = lower_32_bits(attr->map_extra);
+	rb_map->rb->wakeup_usecs = upper_32_bits(attr->map_extra);
+
 	return &rb_map->map;
 }
 
@@ -232,6 +277,8 @@ static void ringbuf_map_free(struct bpf_map *map)
 	struct bpf_ringbuf_map *rb_map;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
+	irq_work_sync(&rb_map->rb->timer_work);
+	hrtimer_cancel(&rb_map->rb->wakeup_timer);
 	bpf_ringbuf_free(rb_map->rb);
 	bpf_map_area_free(rb_map);
 }
@@ -453,6 +500,16 @@ const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
 	.arg3_type	= ARG_ANYTHING,
 };
 
+static void bpf_ringbuf_wakeup_policy(struct bpf_ringbuf *rb)
+{
+	int pending = atomic_inc_return(&rb->pending);
+
+	if (rb->wakeup_batch && pending >= rb->wakeup_batch)
+		irq_work_queue(&rb->work);
+	else if (rb->wakeup_usecs && pending == 1)
+		irq_work_queue(&rb->timer_work);
+}
+
 static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 {
 	unsigned long rec_pos, cons_pos;
@@ -477,7 +534,11 @@ static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 
 	if (flags & BPF_RB_FORCE_WAKEUP)
 		irq_work_queue(&rb->work);
-	else if (cons_pos == rec_pos && !(flags & BPF_RB_NO_WAKEUP))
+	else if (flags & BPF_RB_NO_WAKEUP)
+		return;
+	else if (rb->wakeup_batch || rb->wakeup_usecs)
+		bpf_ringbuf_wakeup_policy(rb);
+	else if (cons_pos == rec_pos)
 		irq_work_queue(&rb->work);
 }
 
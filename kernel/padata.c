@@ -140,8 +140,13 @@ static void padata_parallel_worker(struct work_struct *parallel_work)
 					      pw_work);
 	struct padata_priv *padata = pw->pw_data;
 
-	local_bh_disable();
-	padata->parallel(padata);
+	if (padata->pd->ps->pinst->flags & PADATA_PARALLEL_BH) {
+		padata->parallel(padata);
+		local_bh_disable();
+	} else {
+		local_bh_disable();
+		padata->parallel(padata);
+	}
 	spin_lock(&padata_works_lock);
 	padata_work_free(pw);
 	spin_unlock(&padata_works_lock);
@@ -158,7 +163,8 @@ static void padata_parallel_worker(struct work_struct *parallel_work)
  *          (i.e. cpumask.cbcpu), this function selects a fallback CPU and if
  *          none found, returns -EINVAL.
  *
- * The parallelization callback function will run with BHs off.
+ * The parallelization callback function will run with BHs off, unless
+ * PADATA_PARALLEL_BH is set on the instance.
  * Note: Every object which is parallelized by padata_do_parallel
  * must be seen by padata_do_serial.
  *
@@ -246,9 +252,9 @@ static struct padata_priv *padata_find_next(struct parallel_data *pd,
 
 	reorder = per_cpu_ptr(pd->reorder_list, cpu);
 
-	spin_lock(&reorder->lock);
+	spin_lock_bh(&reorder->lock);
 	if (list_empty(&reorder->list)) {
-		spin_unlock(&reorder->lock);
+		spin_unlock_bh(&reorder->lock);
 		return NULL;
 	}
 
@@ -259,7 +265,7 @@ static struct padata_priv *padata_find_next(struct parallel_data *pd,
 	 * the same CPU and one of the later ones finishes first.
 	 */
 	if (padata->seq_nr != pd->processed) {
-		spin_unlock(&reorder->lock);
+		spin_unlock_bh(&reorder->lock);
 		return NULL;
 	}
 
@@ -269,7 +275,7 @@ static struct padata_priv *padata_find_next(struct parallel_data *pd,
 		pd->cpu = cpumask_next_wrap(cpu, pd->cpumask.pcpu, -1, false);
 	}
 
-	spin_unlock(&reorder->lock);
+	spin_unlock_bh(&reorder->lock);
 	return padata;
 }
 
@@ -381,7 +387,8 @@ static void padata_serial_worker(struct work_struct *serial_work)
  *
  * @padata: object to be serialized.
  *
- * padata_do_serial must be called for every parallelized object.
+ * padata_do_serial must be called for every parallelized object.  It may
+ * be called from process or softirq context.
  * The serialization callback function will run with BHs off.
  */
 void padata_do_serial(struct padata_priv *padata)
@@ -392,7 +399,7 @@ void padata_do_serial(struct padata_priv *padata)
 	struct padata_priv *cur;
 	struct list_head *pos;
 
-	spin_lock(&reorder->lock);
+	spin_lock_bh(&reorder->lock);
 	/* Sort in ascending order of sequence number. */
 	list_for_each_prev(pos, &reorder->list) {
 		cur = list_entry(pos, struct padata_priv, list);
@@ -400,7 +407,7 @@ void padata_do_serial(struct padata_priv *padata)
 			break;
 	}
 	list_add(&padata->list, pos);
-	spin_unlock(&reorder->lock);
+	spin_unlock_bh(&reorder->lock);
 
 	/*
 	 * Ensure the addition to the reorder list is ordered correctly
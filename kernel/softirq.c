@@ -27,6 +27,11 @@
 #include <linux/tick.h>
 #include <linux/irq.h>
 #include <linux/wait_bit.h>
+#include <linux/log2.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/sysctl.h>
 
 #include <asm/softirq_stack.h>
 
@@ -487,10 +492,76 @@ asmlinkage __visible void do_softirq(void)
  * These limits have been established via experimentation.
  * The two things to balance is latency against fairness -
  * we want to handle softirqs as soon as possible, but they
- * should not be able to lock up the box.
+ * should not be able to lock up the box. Both can be changed through
+ * kernel.softirq_max_time_us and kernel.softirq_max_restart.
  */
-#define MAX_SOFTIRQ_TIME  msecs_to_jiffies(2)
-#define MAX_SOFTIRQ_RESTART 10
+#define MAX_SOFTIRQ_TIME  usecs_to_jiffies(READ_ONCE(softirq_max_time_us))
+#define MAX_SOFTIRQ_RESTART READ_ONCE(softirq_max_restart)
+
+static unsigned int softirq_max_time_us = 2000;
+static unsigned int softirq_max_restart = 10;
+static unsigned int softirq_max_time_us_max = 100 * USEC_PER_MSEC;
+
+/*
+ * Optional accounting of how long each softirq handler runs and of why
+ * __do_softirq() left the remaining work to ksoftirqd, shown in
+ * /proc/softirq_stats. Enabled with kernel.softirq_stats.
+ */
+#define SOFTIRQ_HIST_BUCKETS	16	/* log2 of the run time in us */
+
+enum {
+	SOFTIRQ_DEFER_TIME,
+	SOFTIRQ_DEFER_RESCHED,
+	SOFTIRQ_DEFER_RESTART,
+	NR_SOFTIRQ_DEFER,
+};
+
+static const char * const softirq_defer_names[NR_SOFTIRQ_DEFER] = {
+	"time", "resched", "restart"
+};
+
+struct softirq_stats {
+	unsigned int	hist[NR_SOFTIRQS][SOFTIRQ_HIST_BUCKETS];
+	unsigned int	defer[NR_SOFTIRQ_DEFER];
+};
+
+static DEFINE_PER_CPU(struct softirq_stats, softirq_stats);
+static DEFINE_STATIC_KEY_FALSE(softirq_stats_key);
+
+static inline u64 softirq_stats_start(void)
+{
+	if (!static_branch_unlikely(&softirq_stats_key))
+		return 0;
+	return local_clock();
+}
+
+static inline void softirq_stats_end(unsigned int vec_nr, u64 start)
+{
+	unsigned int us, b;
+
+	if (!start)
+		return;
+
+	us = div_u64(local_clock() - start, NSEC_PER_USEC);
+	b = us ? min_t(unsigned int, ilog2(us) + 1, SOFTIRQ_HIST_BUCKETS - 1) : 0;
+	__this_cpu_inc(softirq_stats.hist[vec_nr][b]);
+}
+
+static inline void softirq_stats_defer(unsigned long end)
+{
+	unsigned int why;
+
+	if (!static_branch_unlikely(&softirq_stats_key))
+		return;
+
+	if (!time_before(jiffies, end))
+		why = SOFTIRQ_DEFER_TIME;
+	else if (need_resched())
+		why = SOFTIRQ_DEFER_RESCHED;
+	else
+		why = SOFTIRQ_DEFER_RESTART;
+	__this_cpu_inc(softirq_stats.defer[why]);
+}
 
 #ifdef CONFIG_TRACE_IRQFLAGS
 /*
@@ -559,6 +630,7 @@ restart:
 	while ((softirq_bit = ffs(pending))) {
 		unsigned int vec_nr;
 		int prev_count;
+		u64 start;
 
 		h += softirq_bit - 1;
 
@@ -568,7 +640,9 @@ restart:
 		kstat_incr_softirqs_this_cpu(vec_nr);
 
 		trace_softirq_entry(vec_nr);
+		start = softirq_stats_start();
 		h->action(h);
+		softirq_stats_end(vec_nr, start);
 		trace_softirq_exit(vec_nr);
 		if (unlikely(prev_count != preempt_count())) {
 			pr_err("huh, entered softirq %u %s %p with preempt_count %08x, exited with %08x?\n",
@@ -592,6 +666,7 @@ restart:
 		    --max_restart)
 			goto restart;
 
+		softirq_stats_defer(end);
 		wakeup_softirqd();
 	}
 
@@ -986,6 +1061,111 @@ static __init int spawn_ksoftirqd(void)
 }
 early_initcall(spawn_ksoftirqd);
 
+#ifdef CONFIG_PROC_FS
+static int softirq_stats_show(struct seq_file *m, void *v)
+{
+	int i, j, cpu;
+
+	seq_puts(m, "                    ");
+	for_each_possible_cpu(cpu)
+		seq_printf(m, "CPU%-8d", cpu);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < NR_SOFTIRQ_DEFER; i++) {
+		seq_printf(m, "defer_%-12s:", softirq_defer_names[i]);
+		for_each_possible_cpu(cpu)
+			seq_printf(m, " %10u",
+				   per_cpu(softirq_stats.defer[i], cpu));
+		seq_putc(m, '\n');
+	}
+
+	/* One line per softirq: total count of runs <1us, <2us, <4us, ... */
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(m, "%-12s us:", softirq_to_name[i]);
+		for (j = 0; j < SOFTIRQ_HIST_BUCKETS; j++) {
+			unsigned long sum = 0;
+
+			for_each_possible_cpu(cpu)
+				sum += per_cpu(softirq_stats.hist[i][j], cpu);
+			seq_printf(m, " %lu", sum);
+		}
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+
+static int __init proc_softirq_stats_init(void)
+{
+	proc_create_single("softirq_stats", 0444, NULL, softirq_stats_show);
+	return 0;
+}
+fs_initcall(proc_softirq_stats_init);
+#endif
+
+#ifdef CONFIG_SYSCTL
+static int softirq_stats_sysctl(struct ctl_table *table, int write,
+				void *buffer, size_t *lenp, loff_t *ppos)
+{
+	static DEFINE_MUTEX(lock);
+	int ret, val;
+	struct ctl_table tmp = {
+		.data	= &val,
+		.maxlen	= sizeof(val),
+		.extra1	= SYSCTL_ZERO,
+		.extra2	= SYSCTL_ONE,
+	};
+
+	mutex_lock(&lock);
+	val = static_key_enabled(&softirq_stats_key);
+	ret = proc_dointvec_minmax(&tmp, write, buffer, lenp, ppos);
+	if (write && !ret && val != static_key_enabled(&softirq_stats_key)) {
+		if (val)
+			static_branch_enable(&softirq_stats_key);
+		else
+			static_branch_disable(&softirq_stats_key);
+	}
+	mutex_unlock(&lock);
+
+	return ret;
+}
+
+static struct ctl_table softirq_sysctls[] = {
+	{
+		.procname	= "softirq_max_time_us",
+		.data		= &softirq_max_time_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ONE,
+		.extra2		= &softirq_max_time_us_max,
+	},
+	{
+		.procname	= "softirq_max_restart",
+		.data		= &softirq_max_restart,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ONE,
+		.extra2		= SYSCTL_ONE_HUNDRED,
+	},
+	{
+		.procname	= "softirq_stats",
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= softirq_stats_sysctl,
+	},
+	{}
+};
+
+static int __init softirq_sysctl_init(void)
+{
+	register_sysctl_init("kernel", softirq_sysctls);
+	return 0;
+}
+late_initcall(softirq_sysctl_init);
+#endif
+
 /*
  * [ These __weak aliases are kept in a separate compilation unit, so that
  *   GCC does not inline them incorrectly. ]
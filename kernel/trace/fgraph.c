@@ -458,7 +458,7 @@ ftrace_graph_probe_sched_switch(void *ignore, bool preempt,
 
 static int ftrace_graph_entry_test(struct ftrace_graph_ent *trace)
 {
-	if (!ftrace_ops_test(&global_ops, trace->func, NULL))
+	if (!ftrace_ops_test(&graph_ops, trace->func, NULL))
 		return 0;
 	return __ftrace_graph_entry(trace);
 }
@@ -477,10 +477,16 @@ void update_function_graph_func(void)
 
 	/*
 	 * The graph and global ops share the same set of functions
-	 * to test. If any other ops is on the list, then
-	 * the graph tracing needs to test if its the function
-	 * it should call.
+	 * to test, unless the graph user brought its own filter. If
+	 * any other ops is on the list, then the graph tracing needs
+	 * to test if its the function it should call.
 	 */
+#ifdef CONFIG_DYNAMIC_FTRACE
+	if (graph_ops.func_hash != &global_ops.local_hash) {
+		do_test = true;
+		goto out;
+	}
+#endif
 	do_for_each_ftrace_op(op, ftrace_ops_list) {
 		if (op != &global_ops && op != &graph_ops &&
 		    op != &ftrace_list_end) {
@@ -628,6 +634,11 @@ int register_ftrace_graph(struct fgraph_ops *gops)
 
 	ftrace_graph_return = gops->retfunc;
 
+#ifdef CONFIG_DYNAMIC_FTRACE
+	if (gops->filter_ops)
+		graph_ops.func_hash = gops->filter_ops->func_hash;
+#endif
+
 	/*
 	 * Update the indirect function to the entryfunc, and the
 	 * function that gets called to the entry_test first. Then
@@ -639,6 +650,10 @@ int register_ftrace_graph(struct fgraph_ops *gops)
 	update_function_graph_func();
 
 	ret = ftrace_startup(&graph_ops, FTRACE_START_FUNC_RET);
+#ifdef CONFIG_DYNAMIC_FTRACE
+	if (ret)
+		graph_ops.func_hash = &global_ops.local_hash;
+#endif
 out:
 	mutex_unlock(&ftrace_lock);
 	return ret;
@@ -656,6 +671,9 @@ void unregister_ftrace_graph(struct fgraph_ops *gops)
 	ftrace_graph_entry = ftrace_graph_entry_stub;
 	__ftrace_graph_entry = ftrace_graph_entry_stub;
 	ftrace_shutdown(&graph_ops, FTRACE_STOP_FUNC_RET);
+#ifdef CONFIG_DYNAMIC_FTRACE
+	graph_ops.func_hash = &global_ops.local_hash;
+#endif
 	unregister_pm_notifier(&ftrace_suspend_notifier);
 	unregister_trace_sched_switch(ftrace_graph_probe_sched_switch, NULL);
 
@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Function latency histograms
+ *
+ * Keeps a log2 histogram of the duration of a small, user selected set
+ * of kernel functions. Unlike the function_graph tracer nothing is
+ * written to the ring buffer: the return handler only bumps a per-cpu
+ * counter, so the histograms can be left running on a production box
+ * and scraped periodically.
+ *
+ *  funclat/functions	functions to measure, one or more names per write
+ *			(O_TRUNC replaces the set, O_APPEND adds to it)
+ *  funclat/enable	0/1, the set can only be changed while disabled
+ *  funclat/hist	per-function histograms, any write clears them
+ *
+ * This is a function graph user, so it cannot run at the same time as
+ * the function_graph tracer or the function profiler.
+ */
+#include <linux/ftrace.h>
+#include <linux/kallsyms.h>
+#include <linux/seq_file.h>
+#include <linux/security.h>
+#include <linux/tracefs.h>
+#include <linux/uaccess.h>
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
+
+#include "trace.h"
+
+#define FUNCLAT_MAX_FUNCS	32
+#define FUNCLAT_BUCKETS		32
+
+struct funclat_hist {
+	u64			bucket[FUNCLAT_BUCKETS];
+	u64			sum;
+};
+
+struct funclat_func {
+	unsigned long		ip;
+	const char		*name;
+	struct funclat_hist __percpu *hist;
+};
+
+static struct funclat_func funclat_funcs[FUNCLAT_MAX_FUNCS];
+static int funclat_nr;
+static bool funclat_enabled;
+static DEFINE_MUTEX(funclat_mutex);
+
+/* Never registered on its own, only carries the filter for graph_ops */
+static struct ftrace_ops funclat_filter_ops;
+
+static __always_inline struct funclat_func *funclat_find(unsigned long ip)
+{
+	int i, nr = READ_ONCE(funclat_nr);
+
+	for (i = 0; i < nr; i++) {
+		if (funclat_funcs[i].ip == ip)
+			return &funclat_funcs[i];
+	}
+	return NULL;
+}
+
+static int funclat_entry(struct ftrace_graph_ent *trace)
+{
+	/* Returning 1 hooks the return of this call */
+	return funclat_find(trace->func) != NULL;
+}
+
+static void funclat_return(struct ftrace_graph_ret *trace)
+{
+	struct funclat_func *f = funclat_find(trace->func);
+	u64 delta;
+	int b;
+
+	if (!f)
+		return;
+
+	delta = trace->rettime - trace->calltime;
+	b = delta ? min_t(int, ilog2(delta), FUNCLAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(f->hist->bucket[b]);
+	this_cpu_add(f->hist->sum, delta);
+}
+
+static struct fgraph_ops funclat_graph_ops = {
+	.entryfunc	= funclat_entry,
+	.retfunc	= funclat_return,
+	.filter_ops	= &funclat_filter_ops,
+};
+
+static void funclat_reset(void)
+{
+	int i, cpu;
+
+	/* Counts racing with the reset may survive it; that is fine */
+	for (i = 0; i < funclat_nr; i++) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(funclat_funcs[i].hist, cpu), 0,
+			       sizeof(struct funclat_hist));
+	}
+}
+
+static void funclat_clear_funcs(void)
+{
+	int i;
+
+	for (i = 0; i < funclat_nr; i++) {
+		free_percpu(funclat_funcs[i].hist);
+		kfree(funclat_funcs[i].name);
+	}
+	funclat_nr = 0;
+}
+
+static int funclat_add_func(const char *name)
+{
+	struct funclat_func *f;
+	unsigned long ip;
+	int ret;
+
+	ip = ftrace_location(kallsyms_lookup_name(name));
+	if (!ip)
+		return -EINVAL;
+
+	if (funclat_find(ip))
+		return 0;
+
+	if (funclat_nr >= FUNCLAT_MAX_FUNCS)
+		return -ENOSPC;
+
+	f = &funclat_funcs[funclat_nr];
+	f->hist = alloc_percpu(struct funclat_hist);
+	f->name = kstrdup(name, GFP_KERNEL);
+	if (!f->hist || !f->name) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	/* The first function in the set resets the filter */
+	ret = ftrace_set_filter_ip(&funclat_filter_ops, ip, 0, !funclat_nr);
+	if (ret)
+		goto out_free;
+
+	f->ip = ip;
+	funclat_nr++;
+	return 0;
+
+ out_free:
+	free_percpu(f->hist);
+	kfree(f->name);
+	return ret;
+}
+
+static ssize_t
+funclat_functions_write(struct file *filp, const char __user *ubuf,
+			size_t cnt, loff_t *ppos)
+{
+	char *buf, *p, *name;
+	int ret = 0;
+
+	if (cnt >= PAGE_SIZE)
+		return -EINVAL;
+
+	buf = memdup_user_nul(ubuf, cnt);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	mutex_lock(&funclat_mutex);
+	if (funclat_enabled) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (!(filp->f_flags & O_APPEND) && *ppos == 0)
+		funclat_clear_funcs();
+
+	p = buf;
+	while ((name = strsep(&p, " \t\n")) != NULL) {
+		if (!*name)
+			continue;
+		ret = funclat_add_func(name);
+		if (ret)
+			break;
+	}
+ out:
+	mutex_unlock(&funclat_mutex);
+	kfree(buf);
+
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static int funclat_functions_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	mutex_lock(&funclat_mutex);
+	for (i = 0; i < funclat_nr; i++)
+		seq_printf(m, "%s\n", funclat_funcs[i].name);
+	mutex_unlock(&funclat_mutex);
+
+	return 0;
+}
+
+static int funclat_functions_open(struct inode *inode, struct file *file)
+{
+	int ret;
+
+	ret = security_locked_down(LOCKDOWN_TRACEFS);
+	if (ret)
+		return ret;
+
+	if (!(file->f_mode & FMODE_READ))
+		return 0;
+
+	return single_open(file, funclat_functions_show, NULL);
+}
+
+static int funclat_functions_release(struct inode *inode, struct file *file)
+{
+	if (file->f_mode & FMODE_READ)
+		return single_release(inode, file);
+	return 0;
+}
+
+static const struct file_operations funclat_functions_fops = {
+	.open		= funclat_functions_open,
+	.read		= seq_read,
+	.write		= funclat_functions_write,
+	.llseek		= tracing_lseek,
+	.release	= funclat_functions_release,
+};
+
+static ssize_t
+funclat_enable_read(struct file *filp, char __user *ubuf,
+		    size_t cnt, loff_t *ppos)
+{
+	char buf[4];
+	int r;
+
+	r = scnprintf(buf, sizeof(buf), "%d\n", READ_ONCE(funclat_enabled));
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t
+funclat_enable_write(struct file *filp, const char __user *ubuf,
+		     size_t cnt, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, cnt, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&funclat_mutex);
+	if (enable == funclat_enabled)
+		goto out;
+
+	if (enable) {
+		if (!funclat_nr) {
+			ret = -EINVAL;
+			goto out;
+		}
+		ret = register_ftrace_graph(&funclat_graph_ops);
+		if (ret)
+			goto out;
+	} else {
+		unregister_ftrace_graph(&funclat_graph_ops);
+		/* Let return handlers that already looked us up finish */
+		synchronize_rcu();
+	}
+	funclat_enabled = enable;
+ out:
+	mutex_unlock(&funclat_mutex);
+
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations funclat_enable_fops = {
+	.open		= tracing_open_generic,
+	.read		= funclat_enable_read,
+	.write		= funclat_enable_write,
+	.llseek		= default_llseek,
+};
+
+static int funclat_hist_show(struct seq_file *m, void *v)
+{
+	struct funclat_hist sum;
+	int i, b, cpu;
+
+	mutex_lock(&funclat_mutex);
+	for (i = 0; i < funclat_nr; i++) {
+		u64 count = 0;
+
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct funclat_hist *h;
+
+			h = per_cpu_ptr(funclat_funcs[i].hist, cpu);
+			for (b = 0; b < FUNCLAT_BUCKETS; b++)
+				sum.bucket[b] += READ_ONCE(h->bucket[b]);
+			sum.sum += READ_ONCE(h->sum);
+		}
+		for (b = 0; b < FUNCLAT_BUCKETS; b++)
+			count += sum.bucket[b];
+
+		seq_printf(m, "%s count=%llu sum_ns=%llu\n",
+			   funclat_funcs[i].name, count, sum.sum);
+		for (b = 0; b < FUNCLAT_BUCKETS; b++) {
+			if (!sum.bucket[b])
+				continue;
+			seq_printf(m, "  %10llu - %10llu ns: %llu\n",
+				   b ? 1ULL << b : 0, (2ULL << b) - 1,
+				   sum.bucket[b]);
+		}
+	}
+	mutex_unlock(&funclat_mutex);
+
+	return 0;
+}
+
+static int funclat_hist_open(struct inode *inode, struct file *file)
+{
+	int ret;
+
+	ret = security_locked_down(LOCKDOWN_TRACEFS);
+	if (ret)
+		return ret;
+
+	return single_open(file, funclat_hist_show, NULL);
+}
+
+static ssize_t
+funclat_hist_write(struct file *filp, const char __user *ubuf,
+		   size_t cnt, loff_t *ppos)
+{
+	mutex_lock(&funclat_mutex);
+	funclat_reset();
+	mutex_unlock(&funclat_mutex);
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations funclat_hist_fops = {
+	.open		= funclat_hist_open,
+	.read		= seq_read,
+	.write		= funclat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static __init int funclat_init(void)
+{
+	struct dentry *dir;
+	int ret;
+
+	ret = tracing_init_dentry();
+	if (ret)
+		return 0;
+
+	dir = tracefs_create_dir("funclat", NULL);
+	if (!dir) {
+		pr_warn("Could not create tracefs 'funclat' directory\n");
+		return 0;
+	}
+
+	trace_create_file("functions", TRACE_MODE_WRITE, dir, NULL,
+			  &funclat_functions_fops);
+	trace_create_file("enable", TRACE_MODE_WRITE, dir, NULL,
+			  &funclat_enable_fops);
+	trace_create_file("hist", TRACE_MODE_WRITE, dir, NULL,
+			  &funclat_hist_fops);
+
+	return 0;
+}
+device_initcall(funclat_init);
@@ -344,6 +344,28 @@ static bool wq_debug_force_rr_cpu = false;
 #endif
 module_param_named(debug_force_rr_cpu, wq_debug_force_rr_cpu, bool, 0644);
 
+/*
+ * Data plane isolation profile: "workqueue.dataplane_cpus=<cpulist>" takes
+ * the listed CPUs (those running NAPI or threaded NAPI) out of
+ * wq_unbound_cpumask and redirects work queued without an explicit CPU on
+ * per-cpu workqueues to the remaining CPUs.  Work that is still queued on
+ * a data plane CPU explicitly is counted per function and reported in
+ * /sys/devices/virtual/workqueue/dataplane.
+ */
+static char *wq_dataplane_cpulist;
+module_param_named(dataplane_cpus, wq_dataplane_cpulist, charp, 0444);
+
+static bool wq_dataplane __read_mostly;
+static cpumask_var_t wq_dataplane_cpumask;
+
+#define WQ_DATAPLANE_NR_HITS	32
+
+static struct wq_dataplane_hit {
+	work_func_t		func;
+	atomic_t		count;
+} wq_dataplane_hits[WQ_DATAPLANE_NR_HITS];
+static atomic_t wq_dataplane_hits_other;
+
 /* the per-cpu worker pools */
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct worker_pool [NR_STD_WORKER_POOLS], cpu_worker_pools);
 
@@ -1418,6 +1440,25 @@ static int wq_select_unbound_cpu(int cpu)
 	return new_cpu;
 }
 
+static void wq_dataplane_record(work_func_t func)
+{
+	struct wq_dataplane_hit *hit;
+
+	for (hit = wq_dataplane_hits;
+	     hit < wq_dataplane_hits + WQ_DATAPLANE_NR_HITS; hit++) {
+		work_func_t cur = READ_ONCE(hit->func);
+
+		if (!cur)
+			cur = cmpxchg(&hit->func, NULL, func) ?: func;
+		if (cur == func) {
+			atomic_inc(&hit->count);
+			return;
+		}
+	}
+
+	atomic_inc(&wq_dataplane_hits_other);
+}
+
 static void __queue_work(int cpu, struct workqueue_struct *wq,
 			 struct work_struct *work)
 {
@@ -1450,6 +1491,13 @@ retry:
 	} else {
 		if (req_cpu == WORK_CPU_UNBOUND)
 			cpu = raw_smp_processor_id();
+		if (unlikely(wq_dataplane) &&
+		    cpumask_test_cpu(cpu, wq_dataplane_cpumask)) {
+			if (req_cpu == WORK_CPU_UNBOUND)
+				cpu = wq_select_unbound_cpu(cpu);
+			else
+				wq_dataplane_record(work->func);
+		}
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	}
 
@@ -5692,6 +5740,37 @@ static struct device_attribute wq_sysfs_cpumask_attr =
 	__ATTR(cpumask, 0644, wq_unbound_cpumask_show,
 	       wq_unbound_cpumask_store);
 
+static ssize_t wq_dataplane_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct wq_dataplane_hit *hit;
+	int written;
+
+	written = scnprintf(buf, PAGE_SIZE, "cpus %*pbl\n",
+			    cpumask_pr_args(wq_dataplane_cpumask));
+
+	for (hit = wq_dataplane_hits;
+	     hit < wq_dataplane_hits + WQ_DATAPLANE_NR_HITS; hit++) {
+		work_func_t func = READ_ONCE(hit->func);
+
+		if (!func)
+			break;
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%ps %d\n", func,
+				     atomic_read(&hit->count));
+	}
+
+	if (atomic_read(&wq_dataplane_hits_other))
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "other %d\n",
+				     atomic_read(&wq_dataplane_hits_other));
+
+	return written;
+}
+
+static struct device_attribute wq_sysfs_dataplane_attr =
+	__ATTR(dataplane, 0444, wq_dataplane_show, NULL);
+
 static int __init wq_sysfs_init(void)
 {
 	int err;
@@ -5700,6 +5779,13 @@ static int __init wq_sysfs_init(void)
 	if (err)
 		return err;
 
+	if (wq_dataplane) {
+		err = device_create_file(wq_subsys.dev_root,
+					 &wq_sysfs_dataplane_attr);
+		if (err)
+			return err;
+	}
+
 	return device_create_file(wq_subsys.dev_root, &wq_sysfs_cpumask_attr);
 }
 core_initcall(wq_sysfs_init);
@@ -5991,6 +6077,37 @@ static void __init wq_numa_init(void)
 	wq_numa_enabled = true;
 }
 
+static void __init wq_dataplane_init(void)
+{
+	BUG_ON(!zalloc_cpumask_var(&wq_dataplane_cpumask, GFP_KERNEL));
+
+	if (!wq_dataplane_cpulist)
+		return;
+
+	if (cpulist_parse(wq_dataplane_cpulist, wq_dataplane_cpumask) < 0) {
+		pr_warn("workqueue: invalid dataplane_cpus \"%s\", ignored\n",
+			wq_dataplane_cpulist);
+		cpumask_clear(wq_dataplane_cpumask);
+		return;
+	}
+
+	if (!cpumask_andnot(wq_unbound_cpumask, wq_unbound_cpumask,
+			    wq_dataplane_cpumask)) {
+		pr_warn("workqueue: dataplane_cpus leaves no CPU for housekeeping, ignored\n");
+		cpumask_copy(wq_unbound_cpumask,
+			     housekeeping_cpumask(HK_TYPE_WQ));
+		cpumask_and(wq_unbound_cpumask, wq_unbound_cpumask,
+			    housekeeping_cpumask(HK_TYPE_DOMAIN));
+		cpumask_clear(wq_dataplane_cpumask);
+		return;
+	}
+
+	wq_dataplane = true;
+	pr_info("workqueue: data plane CPUs %*pbl, housekeeping CPUs %*pbl\n",
+		cpumask_pr_args(wq_dataplane_cpumask),
+		cpumask_pr_args(wq_unbound_cpumask));
+}
+
 /**
  * workqueue_init_early - early init for workqueue subsystem
  *
@@ -6011,6 +6128,7 @@ void __init workqueue_init_early(void)
 	BUG_ON(!alloc_cpumask_var(&wq_unbound_cpumask, GFP_KERNEL));
 	cpumask_copy(wq_unbound_cpumask, housekeeping_cpumask(HK_TYPE_WQ));
 	cpumask_and(wq_unbound_cpumask, wq_unbound_cpumask, housekeeping_cpumask(HK_TYPE_DOMAIN));
+	wq_dataplane_init();
 
 	pwq_cache = KMEM_CACHE(pool_workqueue, SLAB_PANIC);
 
@@ -24,6 +24,7 @@
  * Version 2.  See the file COPYING for more details.
  */
 
+#include <crypto/hash.h>
 #include <linux/crc32.h>
 #include <linux/module.h>
 #include <linux/sched.h>
@@ -829,11 +830,68 @@ static int __init crc32_combine_test(void)
 	return 0;
 }
 
+#if IS_REACHABLE(CONFIG_CRYPTO_HASH)
+/*
+ * Run the same vectors through a crypto API driver, so that architecture
+ * specific implementations can be checked and timed against the tables
+ * above.
+ */
+static void __init crc32_shash_test(const char *name, bool crc32c)
+{
+	struct crypto_shash *tfm;
+	SHASH_DESC_ON_STACK(desc, tfm);
+	int i, pass, errors = 0;
+	int bytes = 0;
+	u64 nsec = 0;
+
+	tfm = crypto_alloc_shash(name, 0, 0);
+	if (IS_ERR(tfm))
+		return;
+	desc->tfm = tfm;
+
+	/* the first pass only warms the cache */
+	for (pass = 0; pass < 2; pass++) {
+		nsec = ktime_get_ns();
+		for (i = 0; i < 100; i++) {
+			__le32 key = cpu_to_le32(test[i].crc), out;
+			u32 expect = crc32c ? ~test[i].crc32c_le :
+					      test[i].crc_le;
+
+			if (crypto_shash_setkey(tfm, (u8 *)&key, sizeof(key)) ||
+			    crypto_shash_digest(desc, test_buf + test[i].start,
+						test[i].length, (u8 *)&out) ||
+			    le32_to_cpu(out) != expect)
+				errors += pass;
+			bytes += pass * test[i].length;
+		}
+		nsec = ktime_get_ns() - nsec;
+	}
+
+	if (errors)
+		pr_warn("%s: %s: %d self tests failed\n", name,
+			crypto_shash_driver_name(tfm), errors);
+	else
+		pr_debug("%s: %s: self tests passed, processed %d bytes in %lld nsec\n",
+			 name, crypto_shash_driver_name(tfm), bytes, nsec);
+
+	crypto_free_shash(tfm);
+}
+#else
+static inline void crc32_shash_test(const char *name, bool crc32c)
+{
+}
+#endif
+
 static int __init crc32test_init(void)
 {
 	crc32_test();
 	crc32c_test();
 
+	crc32_shash_test("crc32-generic", false);
+	crc32_shash_test("crc32", false);
+	crc32_shash_test("crc32c-generic", true);
+	crc32_shash_test("crc32c", true);
+
 	crc32_combine_test();
 	crc32c_combine_test();
 
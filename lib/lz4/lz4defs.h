@@ -183,6 +183,31 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+/*
+ * same as LZ4_wildCopy(), but moves 16 bytes per iteration while at least
+ * that much is left, so loads can be grouped ahead of the stores.
+ * Source and destination must be at least 16 bytes apart.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (e - d > 16) {
+		LZ4_memcpy(d, s, 16);
+		d += 16;
+		s += 16;
+	}
+
+	do {
+		LZ4_copy8(d, s);
+		d += 8;
+		s += 8;
+	} while (d < e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
@@ -25,9 +25,16 @@
 #include <linux/rhashtable.h>
 #include <linux/err.h>
 #include <linux/export.h>
+#include <linux/math64.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/rhashtable.h>
 
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4U
+#define REHASH_BUDGET_US	1000U
+/* Buckets moved between checks of the rehash time budget */
+#define REHASH_CHECK_BUCKETS	64U
 
 union nested_table {
 	union nested_table __rcu *table;
@@ -196,6 +203,10 @@ static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 	lockdep_init_map(&tbl->dep_map, "rhashtable_bucket", &__key, 0);
 
 	tbl->size = size;
+	if (ht->p.grow_percent)
+		tbl->grow_thresh = div_u64((u64)size * ht->p.grow_percent, 100);
+	else
+		tbl->grow_thresh = size / 4 * 3;
 
 	rcu_head_init(&tbl->rcu);
 	INIT_LIST_HEAD(&tbl->walkers);
@@ -306,6 +317,8 @@ static int rhashtable_rehash_attach(struct rhashtable *ht,
 		    new_tbl) != NULL)
 		return -EEXIST;
 
+	trace_rhashtable_resize(ht, old_tbl->size, new_tbl->size);
+
 	return 0;
 }
 
@@ -314,20 +327,40 @@ static int rhashtable_rehash_table(struct rhashtable *ht)
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl;
 	struct rhashtable_walker *walker;
-	unsigned int old_hash;
+	u64 start = local_clock();
+	u64 budget;
 	int err;
 
 	new_tbl = rht_dereference(old_tbl->future_tbl, ht);
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
-		err = rhashtable_rehash_chain(ht, old_hash);
+	/*
+	 * Move entries in slices of at most the time budget and let the
+	 * worker requeue itself in between, so that a large resize does not
+	 * monopolise a CPU.  Lookups search both tables until it is done.
+	 */
+	budget = (u64)(ht->p.rehash_budget_us ?: REHASH_BUDGET_US) *
+		 NSEC_PER_USEC;
+	if (!old_tbl->rehash_slices++)
+		old_tbl->rehash_start = start;
+
+	while (old_tbl->rehash < old_tbl->size) {
+		err = rhashtable_rehash_chain(ht, old_tbl->rehash);
 		if (err)
 			return err;
+		old_tbl->rehash++;
+		if (!(old_tbl->rehash % REHASH_CHECK_BUCKETS) &&
+		    old_tbl->rehash < old_tbl->size &&
+		    local_clock() - start > budget)
+			return -EAGAIN;
 		cond_resched();
 	}
 
+	trace_rhashtable_rehash_done(ht, old_tbl->size, new_tbl->size,
+				     local_clock() - old_tbl->rehash_start,
+				     old_tbl->rehash_slices);
+
 	/* Publish the new table pointer. */
 	rcu_assign_pointer(ht->tbl, new_tbl);
 
@@ -436,6 +469,46 @@ static void rht_deferred_worker(struct work_struct *work)
 		schedule_work(&ht->run_work);
 }
 
+/**
+ * rhashtable_presize - expand a table ahead of a known burst of insertions
+ * @ht:		the hash table
+ * @nelems:	number of elements the table is about to hold
+ *
+ * Attaches a table sized for @nelems (within @max_size) and lets the
+ * deferred worker move the entries over, so that the burst itself does
+ * not trigger a chain of resizes.  Does nothing if the table is already
+ * large enough.  With @automatic_shrinking, a table that does not fill up
+ * is shrunk again later.
+ *
+ * Must be called from process context.
+ */
+int rhashtable_presize(struct rhashtable *ht, unsigned int nelems)
+{
+	struct bucket_table *tbl;
+	unsigned int size;
+	int err = 0;
+
+	if (!nelems)
+		return 0;
+
+	size = roundup_pow_of_two(max(nelems / 3 * 4, nelems));
+	if (ht->p.max_size && size > ht->p.max_size)
+		size = ht->p.max_size;
+
+	mutex_lock(&ht->mutex);
+	tbl = rhashtable_last_table(ht, rht_dereference(ht->tbl, ht));
+	if (size > tbl->size)
+		err = rhashtable_rehash_alloc(ht, tbl, size);
+	mutex_unlock(&ht->mutex);
+
+	if (err)
+		return err == -EEXIST ? 0 : err;
+
+	schedule_work(&ht->run_work);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rhashtable_presize);
+
 static int rhashtable_insert_rehash(struct rhashtable *ht,
 				    struct bucket_table *tbl)
 {
@@ -1019,7 +1092,8 @@ int rhashtable_init(struct rhashtable *ht,
 	size_t size;
 
 	if ((!params->key_len && !params->obj_hashfn) ||
-	    (params->obj_hashfn && !params->obj_cmpfn))
+	    (params->obj_hashfn && !params->obj_cmpfn) ||
+	    params->grow_percent > 100)
 		return -EINVAL;
 
 	memset(ht, 0, sizeof(*ht));
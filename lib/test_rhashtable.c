@@ -54,6 +54,10 @@ static bool enomem_retry = false;
 module_param(enomem_retry, bool, 0);
 MODULE_PARM_DESC(enomem_retry, "Retry insert even if -ENOMEM was returned (default: off)");
 
+static int resize_lookups = 200000;
+module_param(resize_lookups, int, 0);
+MODULE_PARM_DESC(resize_lookups, "Lookups timed by the resize latency benchmark, 0 to skip (default: 200000)");
+
 struct test_obj_val {
 	int	id;
 	int	tid;
@@ -680,6 +684,120 @@ out:
 	return err;
 }
 
+#define LAT_BUCKETS	32
+
+/* Upper bound in ns of the histogram bucket holding the @pm per mille */
+static u64 __init lat_percentile(const unsigned int *hist, unsigned int n,
+				 unsigned int pm)
+{
+	u64 want = div_u64((u64)n * pm + 999, 1000);
+	u64 seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += hist[b];
+		if (seen >= want)
+			return 2ULL << b;
+	}
+	return 2ULL << (LAT_BUCKETS - 1);
+}
+
+static void __init lat_report(const char *what, const unsigned int *hist,
+			      unsigned int n, u64 max)
+{
+	if (!n) {
+		pr_info("  %s: no samples\n", what);
+		return;
+	}
+	pr_info("  %s: %u lookups, p50 <%llu ns, p99 <%llu ns, p99.9 <%llu ns, max %llu ns\n",
+		what, n, lat_percentile(hist, n, 500),
+		lat_percentile(hist, n, 990), lat_percentile(hist, n, 999),
+		max);
+}
+
+/*
+ * Time single lookups while a burst of insertions makes the table grow,
+ * and report their latency distribution separately for lookups done with
+ * and without a resize in progress.
+ */
+static int __init test_rht_resize_latency(struct test_obj *array,
+					  unsigned int entries)
+{
+	unsigned int hist[2][LAT_BUCKETS] = {}, n[2] = {};
+	u64 max[2] = {};
+	unsigned int i, half = entries / 2;
+	int err;
+
+	if (resize_lookups <= 0 || half < 2)
+		return 0;
+
+	pr_info("Timing lookups during table resize, %u+%u entries\n",
+		half, entries - half);
+
+	/* test_rhashtable_max() shrank it */
+	test_rht_params.max_size = max_size ? : roundup_pow_of_two(entries);
+
+	memset(array, 0, entries * sizeof(*array));
+	for (i = 0; i < entries; i++)
+		array[i].value.id = i * 2;
+
+	err = rhashtable_init(&ht, &test_rht_params);
+	if (err)
+		return err;
+
+	for (i = 0; i < half; i++) {
+		err = insert_retry(&ht, &array[i], test_rht_params);
+		if (err < 0)
+			goto out;
+	}
+	flush_work(&ht.run_work);
+
+	/* The burst: every growth step now has the first half to move. */
+	for (; i < entries; i++) {
+		err = insert_retry(&ht, &array[i], test_rht_params);
+		if (err < 0)
+			goto out;
+	}
+
+	for (i = 0; i < resize_lookups; i++) {
+		struct test_obj_val key = {
+			.id = (get_random_u32() % half) * 2,
+		};
+		struct test_obj *obj;
+		bool resizing;
+		u64 t0, dt;
+
+		rcu_read_lock();
+		resizing = rcu_access_pointer(rcu_dereference(ht.tbl)->future_tbl);
+		t0 = local_clock();
+		obj = rhashtable_lookup(&ht, &key, test_rht_params);
+		dt = local_clock() - t0;
+		rcu_read_unlock();
+
+		if (!obj) {
+			pr_warn("Test failed: key %d lost during resize\n",
+				key.id);
+			err = -ENOENT;
+			goto out;
+		}
+
+		hist[resizing][min_t(int, dt ? ilog2(dt) : 0,
+				     LAT_BUCKETS - 1)]++;
+		n[resizing]++;
+		max[resizing] = max(max[resizing], dt);
+
+		if (!(i % 1024))
+			cond_resched();
+	}
+
+	lat_report("resizing", hist[1], n[1], max[1]);
+	lat_report("idle", hist[0], n[0], max[0]);
+	err = 0;
+out:
+	rhashtable_destroy(&ht);
+	return err;
+}
+
 static int __init test_rht_init(void)
 {
 	unsigned int entries;
@@ -732,6 +850,11 @@ static int __init test_rht_init(void)
 	pr_info("test if its possible to exceed max_size %d: %s\n",
 			test_rht_params.max_size, test_rhashtable_max(objs, entries) == 0 ?
 			"no, ok" : "YES, failed");
+
+	err = test_rht_resize_latency(objs, entries);
+	if (err)
+		pr_warn("Test failed: resize latency benchmark returned %d\n",
+			err);
 	vfree(objs);
 
 	do_div(total_time, runs);
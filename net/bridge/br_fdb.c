@@ -52,12 +52,23 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
-	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	int err;
+
+	br->fdb_stats = alloc_percpu(struct br_fdb_stats);
+	if (!br->fdb_stats)
+		return -ENOMEM;
+
+	err = rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	if (err)
+		free_percpu(br->fdb_stats);
+
+	return err;
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_stats);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -266,6 +277,56 @@ struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 	return fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
 }
 
+/* Forwarding lookup, called with BHs off. Frames from many hosts behind
+ * a port tend to go to the same few destinations (the gateway, a
+ * server), so check the port's last destination before the hash table.
+ */
+struct net_bridge_fdb_entry *br_fdb_find_cached(struct net_bridge *br,
+						struct net_bridge_port *p,
+						const unsigned char *addr,
+						__u16 vid)
+{
+	struct br_fdb_stats *stats = this_cpu_ptr(br->fdb_stats);
+	struct net_bridge_fdb_cache *c = this_cpu_ptr(p->fdb_cache);
+	struct net_bridge_fdb_entry *f = c->fdb;
+	u32 gen = READ_ONCE(br->fdb_gen);
+
+	if (f && c->gen == gen && f->key.vlan_id == vid &&
+	    ether_addr_equal(f->key.addr.addr, addr)) {
+		stats->cache_hits++;
+		stats->hits++;
+		return f;
+	}
+
+	/* pairs with smp_wmb() in fdb_delete() */
+	smp_rmb();
+	f = fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+	if (!f) {
+		stats->misses++;
+		return NULL;
+	}
+
+	c->fdb = f;
+	c->gen = gen;
+	stats->hits++;
+
+	return f;
+}
+
+void br_fdb_get_stats(struct net_bridge *br, struct br_fdb_stats *stats)
+{
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		const struct br_fdb_stats *st = per_cpu_ptr(br->fdb_stats, cpu);
+
+		stats->hits += READ_ONCE(st->hits);
+		stats->misses += READ_ONCE(st->misses);
+		stats->cache_hits += READ_ONCE(st->cache_hits);
+	}
+}
+
 /* When a static FDB entry is added, the mac address from the entry is
  * added to the bridge private HW address list and all required ports
  * are then updated with the new information.
@@ -322,6 +383,11 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f,
 	hlist_del_init_rcu(&f->fdb_node);
 	rhashtable_remove_fast(&br->fdb_hash_tbl, &f->rhnode,
 			       br_fdb_rht_params);
+	/* Invalidate all per-port caches, which may point to @f, before
+	 * it can be freed.
+	 */
+	smp_wmb();
+	WRITE_ONCE(br->fdb_gen, br->fdb_gen + 1);
 	fdb_notify(br, f, RTM_DELNEIGH, swdev_notify);
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
@@ -863,7 +929,8 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			if (time_after(now, fdb->updated +
+					   BR_FDB_REFRESH_INTERVAL)) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
@@ -15,6 +15,7 @@
 #include <linux/skbuff.h>
 #include <linux/if_vlan.h>
 #include <linux/netfilter_bridge.h>
+#include <net/pkt_latency.h>
 #include "br_private.h"
 
 /* Don't forward packets to originating port or forwarding disabled */
@@ -62,6 +63,7 @@ EXPORT_SYMBOL_GPL(br_dev_queue_push_xmit);
 
 int br_forward_finish(struct net *net, struct sock *sk, struct sk_buff *skb)
 {
+	net_pkt_stage(skb, PKTLAT_FWD_DONE);
 	skb_clear_tstamp(skb);
 	return NF_HOOK(NFPROTO_BRIDGE, NF_BR_POST_ROUTING,
 		       net, sk, skb, NULL, skb->dev,
@@ -112,6 +114,7 @@ static void __br_forward(const struct net_bridge_port *to,
 		indev = NULL;
 	}
 
+	net_pkt_stage(skb, PKTLAT_FWD);
 	NF_HOOK(NFPROTO_BRIDGE, br_hook,
 		net, NULL, skb, indev, skb->dev,
 		br_forward_finish);
@@ -274,27 +277,161 @@ static void maybe_deliver_addr(struct net_bridge_port *p, struct sk_buff *skb,
 }
 
 /* called with rcu_read_lock */
+/* Walk the port group list of @mdst merged with the router ports, the same
+ * way br_multicast_flood() does, and record up to @max egress entries in
+ * @eg. Returns the number of entries the walk came across.
+ */
+static unsigned int
+br_multicast_egress_walk(struct net_bridge_mdb_entry *mdst,
+			 struct net_bridge_mcast *brmctx, struct sk_buff *skb,
+			 struct net_bridge_mdb_egress *eg, unsigned int max)
+{
+	struct net_bridge_port_group *p = rcu_dereference(mdst->ports);
+	struct hlist_node *rp = br_multicast_get_first_rport_node(brmctx, skb);
+	unsigned int n = 0;
+
+	while (p || rp) {
+		struct net_bridge_port *port, *lport, *rport;
+
+		lport = p ? p->key.port : NULL;
+		rport = br_multicast_rport_from_node_skb(rp, skb);
+		port = (unsigned long)lport > (unsigned long)rport ?
+		       lport : rport;
+
+		if (eg && n < max) {
+			eg->ent[n].port = port;
+			eg->ent[n].pg = port == lport && port != rport ?
+					p : NULL;
+		}
+		n++;
+
+		if ((unsigned long)lport >= (unsigned long)port)
+			p = rcu_dereference(p->next);
+		if ((unsigned long)rport >= (unsigned long)port)
+			rp = rcu_dereference(hlist_next_rcu(rp));
+	}
+
+	return n;
+}
+
+/* Return the cached egress list of @mdst, rebuilding it if the port group
+ * or router port lists changed since it was built. NULL means the caller
+ * has to walk the lists itself.
+ */
+static struct net_bridge_mdb_egress *
+br_multicast_egress_get(struct net_bridge_mdb_entry *mdst,
+			struct net_bridge_mcast *brmctx, struct sk_buff *skb)
+{
+	struct net_bridge_mdb_egress *eg, *old;
+	unsigned int n;
+	u32 gen;
+
+	old = rcu_dereference(mdst->egress);
+	if (old == BR_MDB_EGRESS_DEAD)
+		return NULL;
+
+	gen = READ_ONCE(mdst->br->multicast_gen);
+	if (old && old->gen == gen && old->brmctx == brmctx &&
+	    old->proto == skb->protocol)
+		return old;
+
+	/* pairs with smp_wmb() in br_multicast_egress_invalidate() */
+	smp_rmb();
+
+	n = br_multicast_egress_walk(mdst, brmctx, skb, NULL, 0);
+	if (n > U16_MAX)
+		return NULL;
+
+	eg = kmalloc(struct_size(eg, ent, n), GFP_ATOMIC);
+	if (!eg)
+		return NULL;
+
+	/* the lists changed under us, leave it to the next frame */
+	if (br_multicast_egress_walk(mdst, brmctx, skb, eg, n) != n)
+		goto err_free;
+
+	eg->brmctx = brmctx;
+	eg->gen = gen;
+	eg->proto = skb->protocol;
+	eg->num = n;
+
+	if (unrcu_pointer(cmpxchg(&mdst->egress, RCU_INITIALIZER(old),
+				  RCU_INITIALIZER(eg))) != old)
+		goto err_free;
+	if (old)
+		kfree_rcu(old, rcu);
+
+	return eg;
+
+err_free:
+	kfree(eg);
+	return NULL;
+}
+
+static struct net_bridge_port *
+br_multicast_flood_egress(const struct net_bridge_mdb_egress *eg,
+			  struct sk_buff *skb, bool allow_mode_include,
+			  bool local_orig)
+{
+	struct net_bridge_port *prev = NULL;
+	unsigned int i;
+
+	for (i = 0; i < eg->num; i++) {
+		struct net_bridge_port_group *pg = eg->ent[i].pg;
+		struct net_bridge_port *port = eg->ent[i].port;
+
+		if (pg) {
+			if (port->flags & BR_MULTICAST_TO_UNICAST) {
+				maybe_deliver_addr(port, skb, pg->eth_addr,
+						   local_orig);
+				continue;
+			}
+			if ((!allow_mode_include &&
+			     pg->filter_mode == MCAST_INCLUDE) ||
+			    (pg->flags & MDB_PG_FLAGS_BLOCKED))
+				continue;
+		}
+
+		prev = maybe_deliver(prev, port, skb, local_orig);
+		if (IS_ERR(prev))
+			break;
+	}
+
+	return prev;
+}
+
 void br_multicast_flood(struct net_bridge_mdb_entry *mdst,
 			struct sk_buff *skb,
 			struct net_bridge_mcast *brmctx,
 			bool local_rcv, bool local_orig)
 {
 	struct net_bridge_port *prev = NULL;
+	struct net_bridge_mdb_egress *eg;
 	struct net_bridge_port_group *p;
 	bool allow_mode_include = true;
 	struct hlist_node *rp;
 
-	rp = br_multicast_get_first_rport_node(brmctx, skb);
-
 	if (mdst) {
-		p = rcu_dereference(mdst->ports);
 		if (br_multicast_should_handle_mode(brmctx, mdst->addr.proto) &&
 		    br_multicast_is_star_g(&mdst->addr))
 			allow_mode_include = false;
+
+		eg = br_multicast_egress_get(mdst, brmctx, skb);
+		if (eg) {
+			prev = br_multicast_flood_egress(eg, skb,
+							 allow_mode_include,
+							 local_orig);
+			if (IS_ERR(prev))
+				goto out;
+			goto last;
+		}
+		p = rcu_dereference(mdst->ports);
 	} else {
 		p = NULL;
 	}
 
+	rp = br_multicast_get_first_rport_node(brmctx, skb);
+
 	while (p || rp) {
 		struct net_bridge_port *port, *lport, *rport;
 
@@ -327,6 +464,7 @@ delivered:
 			rp = rcu_dereference(hlist_next_rcu(rp));
 	}
 
+last:
 	if (!prev)
 		goto out;
 
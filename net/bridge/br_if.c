@@ -260,6 +260,7 @@ static void release_nbp(struct kobject *kobj)
 {
 	struct net_bridge_port *p
 		= container_of(kobj, struct net_bridge_port, kobj);
+	free_percpu(p->fdb_cache);
 	kfree(p);
 }
 
@@ -432,6 +433,12 @@ static struct net_bridge_port *new_nbp(struct net_bridge *br,
 	if (p == NULL)
 		return ERR_PTR(-ENOMEM);
 
+	p->fdb_cache = alloc_percpu(struct net_bridge_fdb_cache);
+	if (!p->fdb_cache) {
+		kfree(p);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	p->br = br;
 	netdev_hold(dev, &p->dev_tracker, GFP_KERNEL);
 	p->dev = dev;
@@ -445,6 +452,7 @@ static struct net_bridge_port *new_nbp(struct net_bridge *br,
 	err = br_multicast_add_port(p);
 	if (err) {
 		netdev_put(dev, &p->dev_tracker);
+		free_percpu(p->fdb_cache);
 		kfree(p);
 		p = ERR_PTR(err);
 	}
@@ -606,6 +614,7 @@ int br_add_if(struct net_bridge *br, struct net_device *dev,
 	if (err) {
 		br_multicast_del_port(p);
 		netdev_put(dev, &p->dev_tracker);
+		free_percpu(p->fdb_cache);
 		kfree(p);	/* kobject not yet init'd, manually free */
 		goto err1;
 	}
@@ -171,9 +171,10 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 			local_rcv = true;
 			DEV_STATS_INC(br->dev, multicast);
 		}
+		br_multicast_count_fwd(br, mcast_hit);
 		break;
 	case BR_PKT_UNICAST:
-		dst = br_fdb_find_rcu(br, eth_hdr(skb)->h_dest, vid);
+		dst = br_fdb_find_cached(br, p, eth_hdr(skb)->h_dest, vid);
 		break;
 	default:
 		break;
@@ -185,7 +186,7 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb);
 
-		if (now != dst->used)
+		if (time_after(now, dst->used + BR_FDB_REFRESH_INTERVAL))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
@@ -937,6 +937,7 @@ static int br_mdb_add_group(struct net_bridge *br, struct net_bridge_port *port,
 		return -ENOMEM;
 	}
 	rcu_assign_pointer(*pp, p);
+	br_multicast_egress_invalidate(br);
 	if (entry->state == MDB_TEMPORARY)
 		mod_timer(&p->timer,
 			  now + brmctx->multicast_membership_interval);
@@ -82,6 +82,7 @@ static void br_mst_vlan_set_state(struct net_bridge_port *p, struct net_bridge_v
 		return;
 
 	br_vlan_set_state(v, state);
+	br_vlan_fastpath_update(vg, v);
 
 	if (v->vid == vg->pvid)
 		br_vlan_set_pvid_state(vg, state);
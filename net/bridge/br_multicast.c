@@ -600,11 +600,18 @@ static void br_multicast_fwd_src_handle(struct net_bridge_group_src *src)
 static void br_multicast_destroy_mdb_entry(struct net_bridge_mcast_gc *gc)
 {
 	struct net_bridge_mdb_entry *mp;
+	struct net_bridge_mdb_egress *eg;
 
 	mp = container_of(gc, struct net_bridge_mdb_entry, mcast_gc);
 	WARN_ON(!hlist_unhashed(&mp->mdb_node));
 	WARN_ON(mp->ports);
 
+	/* the entry is unhashed, but readers may still be rebuilding */
+	eg = unrcu_pointer(xchg(&mp->egress,
+				RCU_INITIALIZER(BR_MDB_EGRESS_DEAD)));
+	if (eg)
+		kfree_rcu(eg, rcu);
+
 	del_timer_sync(&mp->timer);
 	kfree_rcu(mp, rcu);
 }
@@ -684,6 +691,7 @@ void br_multicast_del_pg(struct net_bridge_mdb_entry *mp,
 	struct hlist_node *tmp;
 
 	rcu_assign_pointer(*pp, pg->next);
+	br_multicast_egress_invalidate(br);
 	hlist_del_init(&pg->mglist);
 	br_multicast_eht_clean_sets(pg);
 	hlist_for_each_entry_safe(ent, tmp, &pg->src_list, node)
@@ -1389,6 +1397,7 @@ __br_multicast_add_group(struct net_bridge_mcast *brmctx,
 	rcu_assign_pointer(*pp, p);
 	if (blocked)
 		p->flags |= MDB_PG_FLAGS_BLOCKED;
+	br_multicast_egress_invalidate(brmctx->br);
 	br_mdb_notify(brmctx->br->dev, mp, p, RTM_NEWMDB);
 
 found:
@@ -1468,24 +1477,26 @@ static int br_ip6_multicast_add_group(struct net_bridge_mcast *brmctx,
 }
 #endif
 
-static bool br_multicast_rport_del(struct hlist_node *rlist)
+static bool br_multicast_rport_del(struct net_bridge *br,
+				   struct hlist_node *rlist)
 {
 	if (hlist_unhashed(rlist))
 		return false;
 
 	hlist_del_init_rcu(rlist);
+	br_multicast_egress_invalidate(br);
 	return true;
 }
 
 static bool br_ip4_multicast_rport_del(struct net_bridge_mcast_port *pmctx)
 {
-	return br_multicast_rport_del(&pmctx->ip4_rlist);
+	return br_multicast_rport_del(pmctx->port->br, &pmctx->ip4_rlist);
 }
 
 static bool br_ip6_multicast_rport_del(struct net_bridge_mcast_port *pmctx)
 {
 #if IS_ENABLED(CONFIG_IPV6)
-	return br_multicast_rport_del(&pmctx->ip6_rlist);
+	return br_multicast_rport_del(pmctx->port->br, &pmctx->ip6_rlist);
 #else
 	return false;
 #endif
@@ -1504,7 +1515,7 @@ static void br_multicast_router_expired(struct net_bridge_mcast_port *pmctx,
 	    timer_pending(t))
 		goto out;
 
-	del = br_multicast_rport_del(rlist);
+	del = br_multicast_rport_del(br, rlist);
 	br_multicast_rport_del_notify(pmctx, del);
 out:
 	spin_unlock(&br->multicast_lock);
@@ -3120,6 +3131,7 @@ static void br_multicast_add_router(struct net_bridge_mcast *brmctx,
 		hlist_add_behind_rcu(rlist, slot);
 	else
 		hlist_add_head_rcu(rlist, mc_router_list);
+	br_multicast_egress_invalidate(brmctx->br);
 
 	/* For backwards compatibility for now, only notify if we
 	 * switched from no IPv4/IPv6 multicast router to a new
@@ -4932,6 +4944,46 @@ void br_multicast_get_stats(const struct net_bridge *br,
 	memcpy(dest, &tdst, sizeof(*dest));
 }
 
+void br_multicast_count_fwd(struct net_bridge *br, bool snooped)
+{
+	struct bridge_mcast_stats *pstats;
+
+	if (!br_opt_get(br, BROPT_MULTICAST_STATS_ENABLED))
+		return;
+
+	pstats = this_cpu_ptr(br->mcast_stats);
+	u64_stats_update_begin(&pstats->syncp);
+	if (snooped)
+		pstats->fwd_snooped++;
+	else
+		pstats->fwd_flooded++;
+	u64_stats_update_end(&pstats->syncp);
+}
+
+void br_multicast_get_fwd_stats(const struct net_bridge *br,
+				u64 *snooped, u64 *flooded)
+{
+	int i;
+
+	*snooped = 0;
+	*flooded = 0;
+	for_each_possible_cpu(i) {
+		struct bridge_mcast_stats *cpu_stats;
+		unsigned int start;
+		u64 s, f;
+
+		cpu_stats = per_cpu_ptr(br->mcast_stats, i);
+		do {
+			start = u64_stats_fetch_begin_irq(&cpu_stats->syncp);
+			s = cpu_stats->fwd_snooped;
+			f = cpu_stats->fwd_flooded;
+		} while (u64_stats_fetch_retry_irq(&cpu_stats->syncp, start));
+
+		*snooped += s;
+		*flooded += f;
+	}
+}
+
 int br_mdb_hash_init(struct net_bridge *br)
 {
 	int err;
@@ -65,6 +65,17 @@ struct brnf_net {
 	int filter_vlan_tagged;
 	int filter_pppoe_tagged;
 	int pass_vlan_indev;
+
+#ifdef CONFIG_SYSCTL
+	/* bridge-nf-vlans, vids whose frames get filtered (0 is untagged),
+	 * all of them while the set is empty
+	 */
+	unsigned long *vlans;
+	bool vlans_set;
+
+	/* frames left alone because of nf_skip or bridge-nf-vlans */
+	unsigned long __percpu *skipped;
+#endif
 };
 
 #define IS_IP(skb) \
@@ -488,6 +499,43 @@ struct net_device *setup_pre_routing(struct sk_buff *skb, const struct net *net)
 	return skb->dev;
 }
 
+/* Whether frames that came in on @p should bypass the IP/ARP hooks, either
+ * because the port has nf_skip set or because their vlan is not selected in
+ * bridge-nf-vlans.
+ */
+static bool br_nf_skip(struct brnf_net *brnet,
+		       const struct net_bridge_port *p,
+		       const struct sk_buff *skb)
+{
+#ifdef CONFIG_SYSCTL
+	u16 vid = 0;
+#endif
+
+	if (p->flags & BR_NF_SKIP)
+		goto skip;
+
+#ifdef CONFIG_SYSCTL
+	if (!READ_ONCE(brnet->vlans_set))
+		return false;
+
+	if (skb_vlan_tag_present(skb))
+		vid = skb_vlan_tag_get_id(skb);
+	else if (skb->protocol == htons(ETH_P_8021Q))
+		vid = ntohs(vlan_eth_hdr(skb)->h_vlan_TCI) & VLAN_VID_MASK;
+
+	if (test_bit(vid, brnet->vlans))
+		return false;
+#else
+	return false;
+#endif
+
+skip:
+#ifdef CONFIG_SYSCTL
+	this_cpu_inc(*brnet->skipped);
+#endif
+	return true;
+}
+
 /* Direct IPv6 traffic to br_nf_pre_routing_ipv6.
  * Replicate the checks that IPv4 does on packet reception.
  * Set skb->dev to the bridge device (i.e. parent of the
@@ -522,6 +570,8 @@ static unsigned int br_nf_pre_routing(void *priv,
 			pr_warn_once("Module ipv6 is disabled, so call_ip6tables is not supported.");
 			return NF_DROP;
 		}
+		if (br_nf_skip(brnet, p, skb))
+			return NF_ACCEPT;
 
 		nf_bridge_pull_encap_header_rcsum(skb);
 		return br_nf_pre_routing_ipv6(priv, skb, state);
@@ -534,6 +584,9 @@ static unsigned int br_nf_pre_routing(void *priv,
 	    !is_pppoe_ip(skb, state->net))
 		return NF_ACCEPT;
 
+	if (br_nf_skip(brnet, p, skb))
+		return NF_ACCEPT;
+
 	nf_bridge_pull_encap_header_rcsum(skb);
 
 	if (br_validate_ipv4(state->net, skb))
@@ -766,11 +819,16 @@ static unsigned int br_nf_forward_arp(void *priv,
 	if (!brnet->call_arptables && !br_opt_get(br, BROPT_NF_CALL_ARPTABLES))
 		return NF_ACCEPT;
 
-	if (!IS_ARP(skb)) {
-		if (!is_vlan_arp(skb, state->net))
-			return NF_ACCEPT;
+	if (!IS_ARP(skb) && !is_vlan_arp(skb, state->net))
+		return NF_ACCEPT;
+
+	/* selectors apply to the port the frame came in on */
+	p = br_port_get_rcu(state->in);
+	if (p && br_nf_skip(brnet, p, skb))
+		return NF_ACCEPT;
+
+	if (!IS_ARP(skb))
 		nf_bridge_pull_encap_header(skb);
-	}
 
 	if (unlikely(!pskb_may_pull(skb, sizeof(struct arphdr))))
 		return NF_DROP;
@@ -1186,6 +1244,37 @@ int brnf_sysctl_call_tables(struct ctl_table *ctl, int write,
 	return ret;
 }
 
+static int brnf_sysctl_vlans(struct ctl_table *ctl, int write,
+			     void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned long *vlans = *(unsigned long **)ctl->data;
+	struct brnf_net *brnet = container_of(ctl->data, struct brnf_net,
+					      vlans);
+	int ret;
+
+	ret = proc_do_large_bitmap(ctl, write, buffer, lenp, ppos);
+	if (write && !ret)
+		WRITE_ONCE(brnet->vlans_set, !bitmap_empty(vlans, VLAN_N_VID));
+	return ret;
+}
+
+static int brnf_sysctl_skipped(struct ctl_table *ctl, int write,
+			       void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned long __percpu *skipped = ctl->data;
+	unsigned long sum = 0;
+	struct ctl_table tmp = {
+		.data		= &sum,
+		.maxlen		= sizeof(sum),
+	};
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += *per_cpu_ptr(skipped, cpu);
+
+	return proc_doulongvec_minmax(&tmp, write, buffer, lenp, ppos);
+}
+
 static struct ctl_table brnf_table[] = {
 	{
 		.procname	= "bridge-nf-call-arptables",
@@ -1223,6 +1312,17 @@ static struct ctl_table brnf_table[] = {
 		.mode		= 0644,
 		.proc_handler	= brnf_sysctl_call_tables,
 	},
+	{
+		.procname	= "bridge-nf-vlans",
+		.maxlen		= VLAN_N_VID,
+		.mode		= 0644,
+		.proc_handler	= brnf_sysctl_vlans,
+	},
+	{
+		.procname	= "bridge-nf-skipped",
+		.mode		= 0444,
+		.proc_handler	= brnf_sysctl_skipped,
+	},
 	{ }
 };
 
@@ -1248,24 +1348,35 @@ static int br_netfilter_sysctl_init_net(struct net *net)
 	}
 
 	brnet = net_generic(net, brnf_net_id);
+	brnet->vlans = bitmap_zalloc(VLAN_N_VID, GFP_KERNEL);
+	brnet->skipped = alloc_percpu(unsigned long);
+	if (!brnet->vlans || !brnet->skipped)
+		goto err_free;
+
 	table[0].data = &brnet->call_arptables;
 	table[1].data = &brnet->call_iptables;
 	table[2].data = &brnet->call_ip6tables;
 	table[3].data = &brnet->filter_vlan_tagged;
 	table[4].data = &brnet->filter_pppoe_tagged;
 	table[5].data = &brnet->pass_vlan_indev;
+	table[6].data = &brnet->vlans;
+	table[7].data = brnet->skipped;
 
 	br_netfilter_sysctl_default(brnet);
 
 	brnet->ctl_hdr = register_net_sysctl(net, "net/bridge", table);
-	if (!brnet->ctl_hdr) {
-		if (!net_eq(net, &init_net))
-			kfree(table);
-
-		return -ENOMEM;
-	}
+	if (!brnet->ctl_hdr)
+		goto err_free;
 
 	return 0;
+
+err_free:
+	free_percpu(brnet->skipped);
+	bitmap_free(brnet->vlans);
+	if (!net_eq(net, &init_net))
+		kfree(table);
+
+	return -ENOMEM;
 }
 
 static void br_netfilter_sysctl_exit_net(struct net *net,
@@ -1276,6 +1387,8 @@ static void br_netfilter_sysctl_exit_net(struct net *net,
 	unregister_net_sysctl_table(brnet->ctl_hdr);
 	if (!net_eq(net, &init_net))
 		kfree(table);
+	free_percpu(brnet->skipped);
+	bitmap_free(brnet->vlans);
 }
 
 static int __net_init brnf_init_net(struct net *net)
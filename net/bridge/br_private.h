@@ -24,6 +24,9 @@
 
 #define BR_HOLD_TIME (1*HZ)
 
+/* Don't refresh FDB timestamps from the fast path more often than this */
+#define BR_FDB_REFRESH_INTERVAL	(HZ / 10)
+
 #define BR_PORT_BITS	10
 #define BR_MAX_PORTS	(1<<BR_PORT_BITS)
 
@@ -90,6 +93,8 @@ struct bridge_mcast_querier {
 /* IGMP/MLD statistics */
 struct bridge_mcast_stats {
 	struct br_mcast_stats mstats;
+	u64 fwd_snooped;
+	u64 fwd_flooded;
 	struct u64_stats_sync syncp;
 };
 #endif
@@ -240,6 +245,12 @@ struct net_bridge_vlan_group {
 	u16				num_vlans;
 	u16				pvid;
 	u8				pvid_state;
+
+	/* vids that are usable and forwarding, and the untagged ones among
+	 * them; lets the data path skip the vlan_hash lookup
+	 */
+	DECLARE_BITMAP(vlan_fwd, VLAN_N_VID);
+	DECLARE_BITMAP(vlan_untagged, VLAN_N_VID);
 };
 
 /* bridge fdb flags */
@@ -339,10 +350,29 @@ struct net_bridge_port_group {
 	struct rcu_head			rcu;
 };
 
+/* Egress ports of an MDB entry in the order br_multicast_flood() visits
+ * them, merged with the router ports of @brmctx for @proto. It stays
+ * valid for as long as @gen matches br->multicast_gen.
+ */
+struct net_bridge_mdb_egress {
+	struct rcu_head			rcu;
+	struct net_bridge_mcast		*brmctx;
+	u32				gen;
+	__be16				proto;
+	u16				num;
+	struct {
+		struct net_bridge_port		*port;
+		struct net_bridge_port_group	*pg;
+	} ent[];
+};
+
+#define BR_MDB_EGRESS_DEAD	ERR_PTR(-ENOENT)
+
 struct net_bridge_mdb_entry {
 	struct rhash_head		rhnode;
 	struct net_bridge		*br;
 	struct net_bridge_port_group __rcu *ports;
+	struct net_bridge_mdb_egress __rcu *egress;
 	struct br_ip			addr;
 	bool				host_joined;
 
@@ -414,10 +444,27 @@ struct net_bridge_port {
 	u16				backup_redirected_cnt;
 
 	struct bridge_stp_xstats	stp_xstats;
+
+	struct net_bridge_fdb_cache	__percpu *fdb_cache;
 };
 
 #define kobj_to_brport(obj)	container_of(obj, struct net_bridge_port, kobj)
 
+/* Last unicast destination found for frames received on a port. Only
+ * valid while @gen matches the bridge fdb_gen, which changes whenever
+ * an entry is deleted.
+ */
+struct net_bridge_fdb_cache {
+	struct net_bridge_fdb_entry	*fdb;
+	u32				gen;
+};
+
+struct br_fdb_stats {
+	unsigned long			hits;
+	unsigned long			misses;
+	unsigned long			cache_hits;
+};
+
 #define br_auto_port(p) ((p)->flags & BR_AUTO_MASK)
 #define br_promisc_port(p) ((p)->flags & BR_PROMISC)
 
@@ -472,6 +519,8 @@ struct net_bridge {
 #endif
 
 	struct rhashtable		fdb_hash_tbl;
+	struct br_fdb_stats		__percpu *fdb_stats;
+	u32				fdb_gen;
 	struct list_head		port_list;
 #if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
 	union {
@@ -512,6 +561,8 @@ struct net_bridge {
 	struct bridge_mcast_stats	__percpu *mcast_stats;
 
 	u32				hash_max;
+	/* bumped when a port group or router port list changes */
+	u32				multicast_gen;
 
 	spinlock_t			multicast_lock;
 
@@ -784,6 +835,11 @@ void br_fdb_delete_by_port(struct net_bridge *br,
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 					     const unsigned char *addr,
 					     __u16 vid);
+struct net_bridge_fdb_entry *br_fdb_find_cached(struct net_bridge *br,
+						struct net_bridge_port *p,
+						const unsigned char *addr,
+						__u16 vid);
+void br_fdb_get_stats(struct net_bridge *br, struct br_fdb_stats *stats);
 int br_fdb_test_addr(struct net_device *dev, unsigned char *addr);
 int br_fdb_fillbuf(struct net_bridge *br, void *buf, unsigned long count,
 		   unsigned long off);
@@ -954,6 +1010,9 @@ void br_multicast_uninit_stats(struct net_bridge *br);
 void br_multicast_get_stats(const struct net_bridge *br,
 			    const struct net_bridge_port *p,
 			    struct br_mcast_stats *dest);
+void br_multicast_count_fwd(struct net_bridge *br, bool snooped);
+void br_multicast_get_fwd_stats(const struct net_bridge *br,
+				u64 *snooped, u64 *flooded);
 void br_mdb_init(void);
 void br_mdb_uninit(void);
 void br_multicast_host_join(const struct net_bridge_mcast *brmctx,
@@ -1105,6 +1164,17 @@ static inline bool br_multicast_querier_exists(struct net_bridge_mcast *brmctx,
 	}
 }
 
+/* Must be called with multicast_lock held after a port group was linked
+ * or unlinked or a router port list changed, so that the cached egress
+ * lists of the MDB entries get rebuilt.
+ */
+static inline void br_multicast_egress_invalidate(struct net_bridge *br)
+{
+	/* pairs with smp_rmb() in br_multicast_egress_get() */
+	smp_wmb();
+	WRITE_ONCE(br->multicast_gen, br->multicast_gen + 1);
+}
+
 static inline bool br_multicast_is_star_g(const struct br_ip *ip)
 {
 	switch (ip->proto) {
@@ -1367,6 +1437,11 @@ static inline void br_multicast_count(struct net_bridge *br,
 {
 }
 
+static inline void br_multicast_count_fwd(struct net_bridge *br,
+					  bool snooped)
+{
+}
+
 static inline int br_multicast_init_stats(struct net_bridge *br)
 {
 	return 0;
@@ -1445,6 +1520,8 @@ int br_vlan_add(struct net_bridge *br, u16 vid, u16 flags,
 int br_vlan_delete(struct net_bridge *br, u16 vid);
 void br_vlan_flush(struct net_bridge *br);
 struct net_bridge_vlan *br_vlan_find(struct net_bridge_vlan_group *vg, u16 vid);
+void br_vlan_fastpath_update(struct net_bridge_vlan_group *vg,
+			     const struct net_bridge_vlan *v);
 void br_recalculate_fwd_mask(struct net_bridge *br);
 int br_vlan_filter_toggle(struct net_bridge *br, unsigned long val,
 			  struct netlink_ext_ack *extack);
@@ -295,6 +295,36 @@ static ssize_t gc_timer_show(struct device *d, struct device_attribute *attr,
 }
 static DEVICE_ATTR_RO(gc_timer);
 
+static ssize_t fdb_hits_show(struct device *d, struct device_attribute *attr,
+			     char *buf)
+{
+	struct br_fdb_stats stats;
+
+	br_fdb_get_stats(to_bridge(d), &stats);
+	return sprintf(buf, "%lu\n", stats.hits);
+}
+static DEVICE_ATTR_RO(fdb_hits);
+
+static ssize_t fdb_misses_show(struct device *d,
+			       struct device_attribute *attr, char *buf)
+{
+	struct br_fdb_stats stats;
+
+	br_fdb_get_stats(to_bridge(d), &stats);
+	return sprintf(buf, "%lu\n", stats.misses);
+}
+static DEVICE_ATTR_RO(fdb_misses);
+
+static ssize_t fdb_cache_hits_show(struct device *d,
+				   struct device_attribute *attr, char *buf)
+{
+	struct br_fdb_stats stats;
+
+	br_fdb_get_stats(to_bridge(d), &stats);
+	return sprintf(buf, "%lu\n", stats.cache_hits);
+}
+static DEVICE_ATTR_RO(fdb_cache_hits);
+
 static ssize_t group_addr_show(struct device *d,
 			       struct device_attribute *attr, char *buf)
 {
@@ -747,6 +777,28 @@ static ssize_t multicast_stats_enabled_store(struct device *d,
 }
 static DEVICE_ATTR_RW(multicast_stats_enabled);
 
+static ssize_t multicast_fwd_snooped_show(struct device *d,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	u64 snooped, flooded;
+
+	br_multicast_get_fwd_stats(to_bridge(d), &snooped, &flooded);
+	return sprintf(buf, "%llu\n", snooped);
+}
+static DEVICE_ATTR_RO(multicast_fwd_snooped);
+
+static ssize_t multicast_fwd_flooded_show(struct device *d,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	u64 snooped, flooded;
+
+	br_multicast_get_fwd_stats(to_bridge(d), &snooped, &flooded);
+	return sprintf(buf, "%llu\n", flooded);
+}
+static DEVICE_ATTR_RO(multicast_fwd_flooded);
+
 #if IS_ENABLED(CONFIG_IPV6)
 static ssize_t multicast_mld_version_show(struct device *d,
 					  struct device_attribute *attr,
@@ -951,6 +1003,9 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_tcn_timer.attr,
 	&dev_attr_topology_change_timer.attr,
 	&dev_attr_gc_timer.attr,
+	&dev_attr_fdb_hits.attr,
+	&dev_attr_fdb_misses.attr,
+	&dev_attr_fdb_cache_hits.attr,
 	&dev_attr_group_addr.attr,
 	&dev_attr_flush.attr,
 	&dev_attr_no_linklocal_learn.attr,
@@ -970,6 +1025,8 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_multicast_query_response_interval.attr,
 	&dev_attr_multicast_startup_query_interval.attr,
 	&dev_attr_multicast_stats_enabled.attr,
+	&dev_attr_multicast_fwd_snooped.attr,
+	&dev_attr_multicast_fwd_flooded.attr,
 	&dev_attr_multicast_igmp_version.attr,
 #if IS_ENABLED(CONFIG_IPV6)
 	&dev_attr_multicast_mld_version.attr,
@@ -54,6 +54,27 @@ static void __vlan_delete_pvid(struct net_bridge_vlan_group *vg, u16 vid)
 	vg->pvid = 0;
 }
 
+/* Must be protected by RTNL. Called whenever the flags or state of @v change,
+ * readers only look at the bits under RCU so they may briefly see old values,
+ * the same as with a vlan_hash lookup racing with the change.
+ */
+void br_vlan_fastpath_update(struct net_bridge_vlan_group *vg,
+			     const struct net_bridge_vlan *v)
+{
+	bool fwd = br_vlan_should_use(v) &&
+		   br_vlan_get_state(v) == BR_STATE_FORWARDING;
+
+	assign_bit(v->vid, vg->vlan_fwd, fwd);
+	assign_bit(v->vid, vg->vlan_untagged,
+		   fwd && (v->flags & BRIDGE_VLAN_INFO_UNTAGGED));
+}
+
+static void br_vlan_fastpath_clear(struct net_bridge_vlan_group *vg, u16 vid)
+{
+	clear_bit(vid, vg->vlan_fwd);
+	clear_bit(vid, vg->vlan_untagged);
+}
+
 /* Update the BRIDGE_VLAN_INFO_PVID and BRIDGE_VLAN_INFO_UNTAGGED flags of @v.
  * If @commit is false, return just whether the BRIDGE_VLAN_INFO_PVID and
  * BRIDGE_VLAN_INFO_UNTAGGED bits of @flags would produce any change onto @v.
@@ -86,6 +107,7 @@ static bool __vlan_flags_update(struct net_bridge_vlan *v, u16 flags,
 	else
 		v->flags &= ~BRIDGE_VLAN_INFO_UNTAGGED;
 
+	br_vlan_fastpath_update(vg, v);
 out:
 	return change;
 }
@@ -396,6 +418,7 @@ static int __vlan_del(struct net_bridge_vlan *v)
 	}
 
 	__vlan_delete_pvid(vg, v->vid);
+	br_vlan_fastpath_clear(vg, v->vid);
 	if (p) {
 		err = __vlan_vid_del(p->dev, p->br, v);
 		if (err)
@@ -488,6 +511,17 @@ struct sk_buff *br_handle_vlan(struct net_bridge *br,
 	 * send untagged; otherwise, send tagged.
 	 */
 	br_vlan_get_tag(skb, &vid);
+
+	/* Without stats or a tunnel only the untagged flag is needed */
+	if (vg && test_bit(vid, vg->vlan_fwd) &&
+	    !br_opt_get(br, BROPT_VLAN_STATS_ENABLED) &&
+	    !(p && (p->flags & BR_VLAN_TUNNEL))) {
+		if (test_bit(vid, vg->vlan_untagged) &&
+		    !br_switchdev_frame_uses_tx_fwd_offload(skb))
+			__vlan_hwaccel_clear_tag(skb);
+		return skb;
+	}
+
 	v = br_vlan_find(vg, vid);
 	/* Vlan entry must be configured at this point.  The
 	 * only exception is the bridge is set in promisc mode and the
@@ -611,6 +645,13 @@ static bool __allowed_ingress(const struct net_bridge *br,
 			return true;
 		}
 	}
+
+	/* Same for tagged frames on a vlan that is known to be forwarding */
+	if (!br_opt_get(br, BROPT_MCAST_VLAN_SNOOPING_ENABLED) &&
+	    !br_opt_get(br, BROPT_VLAN_STATS_ENABLED) &&
+	    vg && test_bit(*vid, vg->vlan_fwd))
+		return true;
+
 	v = br_vlan_find(vg, *vid);
 	if (!v || !br_vlan_should_use(v))
 		goto drop;
@@ -667,6 +708,9 @@ bool br_allowed_egress(struct net_bridge_vlan_group *vg,
 		return true;
 
 	br_vlan_get_tag(skb, &vid);
+	if (vg && test_bit(vid, vg->vlan_fwd))
+		return true;
+
 	v = br_vlan_find(vg, vid);
 	if (v && br_vlan_should_use(v) &&
 	    br_vlan_state_allowed(br_vlan_get_state(v), false))
@@ -702,6 +746,9 @@ bool br_should_learn(struct net_bridge_port *p, struct sk_buff *skb, u16 *vid)
 		return true;
 	}
 
+	if (test_bit(*vid, vg->vlan_fwd))
+		return true;
+
 	v = br_vlan_find(vg, *vid);
 	if (v && br_vlan_state_allowed(br_vlan_get_state(v), true))
 		return true;
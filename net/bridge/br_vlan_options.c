@@ -111,6 +111,7 @@ static int br_vlan_modify_state(struct net_bridge_vlan_group *vg,
 		br_vlan_set_pvid_state(vg, state);
 
 	br_vlan_set_state(v, state);
+	br_vlan_fastpath_update(vg, v);
 	*changed = true;
 
 	return 0;
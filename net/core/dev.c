@@ -92,6 +92,7 @@
 #include <linux/ethtool.h>
 #include <linux/skbuff.h>
 #include <linux/kthread.h>
+#include <linux/llist.h>
 #include <linux/bpf.h>
 #include <linux/bpf_trace.h>
 #include <net/net_namespace.h>
@@ -105,6 +106,7 @@
 #include <net/gro.h>
 #include <net/pkt_sched.h>
 #include <net/pkt_cls.h>
+#include <net/pkt_latency.h>
 #include <net/checksum.h>
 #include <net/xfrm.h>
 #include <linux/highmem.h>
@@ -148,6 +150,7 @@
 #include <linux/indirect_call_wrapper.h>
 #include <net/devlink.h>
 #include <linux/pm_runtime.h>
+#include <linux/smpboot.h>
 #include <linux/prandom.h>
 #include <linux/once_lite.h>
 
@@ -3624,6 +3627,7 @@ static int xmit_one(struct sk_buff *skb, struct net_device *dev,
 
 	len = skb->len;
 	trace_net_dev_start_xmit(skb, dev);
+	net_pkt_stage(skb, PKTLAT_XMIT);
 	rc = netdev_start_xmit(skb, dev, txq, more);
 	trace_net_dev_xmit(skb, rc, dev, len);
 
@@ -3825,6 +3829,16 @@ static int dev_qdisc_enqueue(struct sk_buff *skb, struct Qdisc *q,
 	return rc;
 }
 
+static void dev_drop_stats_list(struct net_device *dev, struct sk_buff *list,
+				enum skb_drop_reason reason)
+{
+	if (!static_branch_unlikely(&netdev_drop_stats_key))
+		return;
+
+	for (; list; list = list->next)
+		dev_drop_stats_inc(dev, reason);
+}
+
 static inline int __dev_xmit_skb(struct sk_buff *skb, struct Qdisc *q,
 				 struct net_device *dev,
 				 struct netdev_queue *txq)
@@ -3863,9 +3877,12 @@ static inline int __dev_xmit_skb(struct sk_buff *skb, struct Qdisc *q,
 		qdisc_run(q);
 
 no_lock_out:
-		if (unlikely(to_free))
+		if (unlikely(to_free)) {
+			dev_drop_stats_list(dev, to_free,
+					    SKB_DROP_REASON_QDISC_DROP);
 			kfree_skb_list_reason(to_free,
 					      SKB_DROP_REASON_QDISC_DROP);
+		}
 		return rc;
 	}
 
@@ -3919,8 +3936,10 @@ no_lock_out:
 		}
 	}
 	spin_unlock(root_lock);
-	if (unlikely(to_free))
+	if (unlikely(to_free)) {
+		dev_drop_stats_list(dev, to_free, SKB_DROP_REASON_QDISC_DROP);
 		kfree_skb_list_reason(to_free, SKB_DROP_REASON_QDISC_DROP);
+	}
 	if (unlikely(contended))
 		spin_unlock(&q->busylock);
 	return rc;
@@ -3995,6 +4014,7 @@ sch_handle_egress(struct sk_buff *skb, int *ret, struct net_device *dev)
 	case TC_ACT_SHOT:
 		mini_qdisc_qstats_cpu_drop(miniq);
 		*ret = NET_XMIT_DROP;
+		dev_drop_stats_inc(dev, SKB_DROP_REASON_TC_EGRESS);
 		kfree_skb_reason(skb, SKB_DROP_REASON_TC_EGRESS);
 		return NULL;
 	case TC_ACT_STOLEN:
@@ -4692,6 +4712,47 @@ static bool skb_flow_limit(struct sk_buff *skb, unsigned int qlen)
 	return false;
 }
 
+static ATOMIC_NOTIFIER_HEAD(netdev_rx_pressure_chain);
+static DEFINE_PER_CPU(unsigned long, netdev_rx_pressure_stamp);
+
+/**
+ * register_netdev_rx_pressure_notifier - register a receive burst notifier
+ * @nb: notifier
+ *
+ * @nb is called in softirq context, with the CPU number as the event,
+ * when receive processing on that CPU runs out of its softirq budget
+ * or its backlog queue fills past half of netdev_max_backlog. Calls
+ * are limited to one per jiffy and CPU. This lets e.g. a cpufreq
+ * driver raise the clock before the load shows up as utilisation.
+ */
+int register_netdev_rx_pressure_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&netdev_rx_pressure_chain, nb);
+}
+EXPORT_SYMBOL_GPL(register_netdev_rx_pressure_notifier);
+
+/**
+ * unregister_netdev_rx_pressure_notifier - unregister a receive burst notifier
+ * @nb: notifier
+ */
+int unregister_netdev_rx_pressure_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&netdev_rx_pressure_chain,
+						nb);
+}
+EXPORT_SYMBOL_GPL(unregister_netdev_rx_pressure_notifier);
+
+static void netdev_rx_pressure(int cpu)
+{
+	unsigned long *stamp = per_cpu_ptr(&netdev_rx_pressure_stamp, cpu);
+
+	if (READ_ONCE(*stamp) == jiffies)
+		return;
+
+	WRITE_ONCE(*stamp, jiffies);
+	atomic_notifier_call_chain(&netdev_rx_pressure_chain, cpu, NULL);
+}
+
 /*
  * enqueue_to_backlog is called to queue an skb to a per CPU backlog
  * queue (may be a remote CPU queue).
@@ -4717,6 +4778,8 @@ enqueue:
 			__skb_queue_tail(&sd->input_pkt_queue, skb);
 			input_queue_tail_incr_save(sd, qtail);
 			rps_unlock_irq_restore(sd, &flags);
+			if (unlikely(qlen >= READ_ONCE(netdev_max_backlog) / 2))
+				netdev_rx_pressure(cpu);
 			return NET_RX_SUCCESS;
 		}
 
@@ -4734,6 +4797,7 @@ drop:
 	rps_unlock_irq_restore(sd, &flags);
 
 	dev_core_stats_rx_dropped_inc(skb->dev);
+	dev_drop_stats_inc(skb->dev, reason);
 	kfree_skb_reason(skb, reason);
 	return NET_RX_DROP;
 }
@@ -4958,6 +5022,7 @@ int do_xdp_generic(struct bpf_prog *xdp_prog, struct sk_buff *skb)
 	}
 	return XDP_PASS;
 out_redir:
+	dev_drop_stats_inc(skb->dev, SKB_DROP_REASON_XDP);
 	kfree_skb_reason(skb, SKB_DROP_REASON_XDP);
 	return XDP_DROP;
 }
@@ -5010,6 +5075,7 @@ int __netif_rx(struct sk_buff *skb)
 	lockdep_assert_once(hardirq_count() | softirq_count());
 
 	trace_netif_rx_entry(skb);
+	net_pkt_stage(skb, PKTLAT_STACK);
 	ret = netif_rx_internal(skb);
 	trace_netif_rx_exit(ret);
 	return ret;
@@ -5043,6 +5109,7 @@ int netif_rx(struct sk_buff *skb)
 	if (need_bh_off)
 		local_bh_disable();
 	trace_netif_rx_entry(skb);
+	net_pkt_stage(skb, PKTLAT_STACK);
 	ret = netif_rx_internal(skb);
 	trace_netif_rx_exit(ret);
 	if (need_bh_off)
@@ -5174,6 +5241,7 @@ sch_handle_ingress(struct sk_buff *skb, struct packet_type **pt_prev, int *ret,
 		break;
 	case TC_ACT_SHOT:
 		mini_qdisc_qstats_cpu_drop(miniq);
+		dev_drop_stats_inc(skb->dev, SKB_DROP_REASON_TC_INGRESS);
 		kfree_skb_reason(skb, SKB_DROP_REASON_TC_INGRESS);
 		*ret = NET_RX_DROP;
 		return NULL;
@@ -5499,6 +5567,7 @@ drop:
 			dev_core_stats_rx_dropped_inc(skb->dev);
 		else
 			dev_core_stats_rx_nohandler_inc(skb->dev);
+		dev_drop_stats_inc(skb->dev, SKB_DROP_REASON_UNHANDLED_PROTO);
 		kfree_skb_reason(skb, SKB_DROP_REASON_UNHANDLED_PROTO);
 		/* Jamal, now you will not able to escape explaining
 		 * me how you were going to use this. :-)
@@ -5703,6 +5772,236 @@ static int generic_xdp_install(struct net_device *dev, struct netdev_bpf *xdp)
 	return ret;
 }
 
+/*
+ * NAPI fan-out: spread the receive processing of single queue devices
+ * over per-CPU "napi_fanout/N" threads by flow hash, without RPS's IPI
+ * per batch and backlog locking. Each CPU has a lockless skb list, and
+ * a poller wakes each thread at most once per batch. Packets of a flow
+ * always go to the same CPU and keep their order.
+ */
+struct napi_fanout_queue {
+	struct llist_head	list;
+	atomic_t		qlen;
+};
+
+static DEFINE_PER_CPU(struct napi_fanout_queue, napi_fanout_queue);
+static DEFINE_PER_CPU(struct task_struct *, napi_fanout_thread);
+static DEFINE_PER_CPU(cpumask_var_t, napi_fanout_wake);
+static DEFINE_STATIC_KEY_FALSE(napi_fanout_needed);
+static bool napi_fanout_started;
+
+static int napi_fanout_cpu(struct sk_buff *skb)
+{
+	unsigned int idx = reciprocal_scale(skb_get_hash(skb),
+					    num_active_cpus());
+	int cpu;
+
+	for_each_cpu(cpu, cpu_active_mask)
+		if (!idx--)
+			return cpu;
+
+	return smp_processor_id();
+}
+
+static int napi_fanout_enqueue(struct sk_buff *skb, int cpu, bool *wake)
+{
+	struct napi_fanout_queue *q = per_cpu_ptr(&napi_fanout_queue, cpu);
+	enum skb_drop_reason reason = SKB_DROP_REASON_NOT_SPECIFIED;
+	unsigned int qlen;
+
+	if (!netif_running(skb->dev))
+		goto drop;
+
+	qlen = atomic_inc_return(&q->qlen);
+	if (unlikely(qlen > READ_ONCE(netdev_max_backlog))) {
+		atomic_dec(&q->qlen);
+		reason = SKB_DROP_REASON_CPU_BACKLOG;
+		goto drop;
+	}
+	if (unlikely(qlen >= READ_ONCE(netdev_max_backlog) / 2))
+		netdev_rx_pressure(cpu);
+
+	/* Released once the thread has handled it, see napi_fanout_run() */
+	dev_hold(skb->dev);
+	if (llist_add(&skb->ll_node, &q->list))
+		*wake = true;
+	return NET_RX_SUCCESS;
+
+drop:
+	__this_cpu_inc(softnet_data.dropped);
+	dev_core_stats_rx_dropped_inc(skb->dev);
+	dev_drop_stats_inc(skb->dev, reason);
+	kfree_skb_reason(skb, reason);
+	return NET_RX_DROP;
+}
+
+static void napi_fanout_list(struct list_head *head)
+{
+	struct cpumask *wake = *this_cpu_ptr(&napi_fanout_wake);
+	struct sk_buff *skb, *next;
+	bool first;
+	int cpu;
+
+	list_for_each_entry_safe(skb, next, head, list) {
+		if (!skb->dev->napi_fanout)
+			continue;
+
+		cpu = napi_fanout_cpu(skb);
+		first = false;
+		skb_list_del_init(skb);
+		napi_fanout_enqueue(skb, cpu, &first);
+		if (first)
+			cpumask_set_cpu(cpu, wake);
+	}
+
+	/* One wakeup per thread and batch */
+	for_each_cpu(cpu, wake)
+		wake_up_process(per_cpu(napi_fanout_thread, cpu));
+	cpumask_clear(wake);
+}
+
+static void napi_fanout_deliver(struct list_head *head,
+				struct net_device *dev, unsigned int n)
+{
+	__netif_receive_skb_list(head);
+	INIT_LIST_HEAD(head);
+
+	while (n--)
+		dev_put(dev);
+}
+
+static int napi_fanout_should_run(unsigned int cpu)
+{
+	return !llist_empty(&per_cpu(napi_fanout_queue, cpu).list);
+}
+
+static void napi_fanout_run(unsigned int cpu)
+{
+	struct napi_fanout_queue *q = per_cpu_ptr(&napi_fanout_queue, cpu);
+	unsigned int n = 0, total = 0;
+	struct net_device *dev = NULL;
+	struct sk_buff *skb, *next;
+	struct llist_node *first;
+	LIST_HEAD(head);
+
+	first = llist_reverse_order(llist_del_all(&q->list));
+
+	local_bh_disable();
+	rcu_read_lock();
+	llist_for_each_entry_safe(skb, next, first, ll_node) {
+		/* the stack may change skb->dev, drop our refs by batch */
+		if (skb->dev != dev && n) {
+			napi_fanout_deliver(&head, dev, n);
+			total += n;
+			n = 0;
+		}
+		dev = skb->dev;
+		list_add_tail(&skb->list, &head);
+		n++;
+	}
+	if (n) {
+		napi_fanout_deliver(&head, dev, n);
+		total += n;
+	}
+	rcu_read_unlock();
+	local_bh_enable();
+
+	atomic_sub(total, &q->qlen);
+}
+
+/*
+ * A poller that picked @oldcpu just before it went inactive can still
+ * queue to it after the parked thread drained it. Hand such skbs, with
+ * their device references, to the thread of this CPU.
+ */
+static void napi_fanout_cpu_dead(unsigned int oldcpu)
+{
+	struct napi_fanout_queue *oldq = per_cpu_ptr(&napi_fanout_queue, oldcpu);
+	struct llist_node *first, *last;
+	struct napi_fanout_queue *q;
+	unsigned int n = 1;
+	int cpu;
+
+	first = llist_del_all(&oldq->list);
+	if (!first)
+		return;
+
+	for (last = first; last->next; last = last->next)
+		n++;
+	atomic_sub(n, &oldq->qlen);
+
+	cpu = get_cpu();
+	q = per_cpu_ptr(&napi_fanout_queue, cpu);
+	atomic_add(n, &q->qlen);
+	if (llist_add_batch(first, last, &q->list))
+		wake_up_process(per_cpu(napi_fanout_thread, cpu));
+	put_cpu();
+}
+
+/* CPUs stop being picked once inactive, handle what is left */
+static struct smp_hotplug_thread napi_fanout_threads = {
+	.store			= &napi_fanout_thread,
+	.thread_should_run	= napi_fanout_should_run,
+	.thread_fn		= napi_fanout_run,
+	.park			= napi_fanout_run,
+	.thread_comm		= "napi_fanout/%u",
+};
+
+static int napi_fanout_start(void)
+{
+	int cpu, err;
+
+	if (napi_fanout_started)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		if (!cpumask_available(per_cpu(napi_fanout_wake, cpu)) &&
+		    !zalloc_cpumask_var_node(&per_cpu(napi_fanout_wake, cpu),
+					     GFP_KERNEL, cpu_to_node(cpu)))
+			return -ENOMEM;
+	}
+
+	err = smpboot_register_percpu_thread(&napi_fanout_threads);
+	if (err)
+		return err;
+
+	napi_fanout_started = true;
+	return 0;
+}
+
+/**
+ * dev_set_napi_fanout - spread receive processing over per-CPU threads
+ * @dev: network device
+ * @fanout: enable or disable
+ *
+ * Packets received on @dev are handed by flow hash to per-CPU threads
+ * instead of going up the stack from its NAPI poll. Meant for single
+ * queue devices; takes precedence over RPS. Caller must hold RTNL.
+ */
+int dev_set_napi_fanout(struct net_device *dev, bool fanout)
+{
+	int err;
+
+	ASSERT_RTNL();
+
+	if (dev->napi_fanout == fanout)
+		return 0;
+
+	if (fanout) {
+		err = napi_fanout_start();
+		if (err)
+			return err;
+		static_branch_inc(&napi_fanout_needed);
+		dev->napi_fanout = 1;
+	} else {
+		dev->napi_fanout = 0;
+		static_branch_dec(&napi_fanout_needed);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(dev_set_napi_fanout);
+
 static int netif_receive_skb_internal(struct sk_buff *skb)
 {
 	int ret;
@@ -5713,6 +6012,17 @@ static int netif_receive_skb_internal(struct sk_buff *skb)
 		return NET_RX_SUCCESS;
 
 	rcu_read_lock();
+	if (static_branch_unlikely(&napi_fanout_needed) &&
+	    skb->dev->napi_fanout) {
+		int cpu = napi_fanout_cpu(skb);
+		bool wake = false;
+
+		ret = napi_fanout_enqueue(skb, cpu, &wake);
+		if (wake)
+			wake_up_process(per_cpu(napi_fanout_thread, cpu));
+		rcu_read_unlock();
+		return ret;
+	}
 #ifdef CONFIG_RPS
 	if (static_branch_unlikely(&rps_needed)) {
 		struct rps_dev_flow voidflow, *rflow = &voidflow;
@@ -5745,6 +6055,8 @@ void netif_receive_skb_list_internal(struct list_head *head)
 	list_splice_init(&sublist, head);
 
 	rcu_read_lock();
+	if (static_branch_unlikely(&napi_fanout_needed))
+		napi_fanout_list(head);
 #ifdef CONFIG_RPS
 	if (static_branch_unlikely(&rps_needed)) {
 		list_for_each_entry_safe(skb, next, head, list) {
@@ -5783,6 +6095,7 @@ int netif_receive_skb(struct sk_buff *skb)
 	int ret;
 
 	trace_netif_receive_skb_entry(skb);
+	net_pkt_stage(skb, PKTLAT_STACK);
 
 	ret = netif_receive_skb_internal(skb);
 	trace_netif_receive_skb_exit(ret);
@@ -6724,6 +7037,7 @@ static __latent_entropy void net_rx_action(struct softirq_action *h)
 		if (unlikely(budget <= 0 ||
 			     time_after_eq(jiffies, time_limit))) {
 			sd->time_squeeze++;
+			netdev_rx_pressure(smp_processor_id());
 			break;
 		}
 	}
@@ -10049,6 +10363,13 @@ int register_netdevice(struct net_device *dev)
 	else if (__dev_get_by_index(net, dev->ifindex))
 		goto err_uninit;
 
+	ret = -ENOMEM;
+	if (!dev->drop_stats) {
+		dev->drop_stats = alloc_percpu(struct net_device_drop_stats);
+		if (!dev->drop_stats)
+			goto err_uninit;
+	}
+
 	/* Transfer changeable features to wanted_features and enable
 	 * software offloads (GSO and GRO).
 	 */
@@ -10449,6 +10770,33 @@ struct net_device_core_stats __percpu *netdev_core_stats_alloc(struct net_device
 }
 EXPORT_SYMBOL(netdev_core_stats_alloc);
 
+/* net.core.dev_drop_stats, see dev_drop_stats_inc() */
+DEFINE_STATIC_KEY_FALSE(netdev_drop_stats_key);
+EXPORT_SYMBOL(netdev_drop_stats_key);
+
+#ifdef CONFIG_PROC_FS
+/**
+ *	netdev_drop_reason_count - read a per-device drop reason counter
+ *	@dev: device
+ *	@reason: drop reason
+ *
+ *	Sums the per-cpu counters bumped by dev_drop_stats_inc() for
+ *	skbs the core dropped on @dev's RX or TX path.
+ */
+unsigned long netdev_drop_reason_count(const struct net_device *dev,
+				       enum skb_drop_reason reason)
+{
+	const struct net_device_drop_stats __percpu *p = dev->drop_stats;
+	unsigned long sum = 0;
+	int i;
+
+	if (p)
+		for_each_possible_cpu(i)
+			sum += READ_ONCE(per_cpu_ptr(p, i)->reasons[reason]);
+	return sum;
+}
+#endif
+
 /**
  *	dev_get_stats	- get network device statistics
  *	@dev: device to get statistics from
@@ -10753,6 +11101,8 @@ void free_netdev(struct net_device *dev)
 #endif
 	free_percpu(dev->core_stats);
 	dev->core_stats = NULL;
+	free_percpu(dev->drop_stats);
+	dev->drop_stats = NULL;
 	free_percpu(dev->xdp_bulkq);
 	dev->xdp_bulkq = NULL;
 
@@ -10872,6 +11222,7 @@ void unregister_netdevice_many(struct list_head *head)
 		dev_shutdown(dev);
 
 		dev_xdp_uninstall(dev);
+		dev_set_napi_fanout(dev, false);
 
 		netdev_offload_xstats_disable_all(dev);
 
@@ -11158,6 +11509,8 @@ static int dev_cpu_dead(unsigned int oldcpu)
 		input_queue_head_incr(oldsd);
 	}
 
+	napi_fanout_cpu_dead(oldcpu);
+
 	return 0;
 }
 
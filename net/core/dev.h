@@ -3,6 +3,7 @@
 #define _NET_CORE_DEV_H
 
 #include <linux/types.h>
+#include <net/dropreason.h>
 
 struct net;
 struct net_device;
@@ -22,8 +23,20 @@ struct sd_flow_limit {
 
 extern int netdev_flow_limit_table_len;
 
+/* Per-CPU usage of the NAPI skb head cache, see /proc/net/skb_cache_stat */
+struct napi_skb_cache_stats {
+	unsigned int		hit;		/* heads taken from the cache */
+	unsigned int		miss;		/* bulk refills from slab */
+	unsigned int		recycle;	/* heads returned to the cache */
+	unsigned int		flush;		/* bulk frees back to slab */
+};
+
 #ifdef CONFIG_PROC_FS
 int __init dev_proc_init(void);
+void napi_skb_cache_stats(int cpu, struct napi_skb_cache_stats *stats);
+unsigned long skb_drop_reason_count(enum skb_drop_reason reason);
+unsigned long netdev_drop_reason_count(const struct net_device *dev,
+				       enum skb_drop_reason reason);
 #else
 #define dev_proc_init() 0
 #endif
@@ -45,6 +58,7 @@ extern int		netdev_unregister_timeout_secs;
 extern int		weight_p;
 extern int		dev_weight_rx_bias;
 extern int		dev_weight_tx_bias;
+extern int		sysctl_link_watch_urgent_down;
 
 /* rtnl helpers */
 extern struct list_head net_todo_list;
@@ -433,11 +433,44 @@ void skb_flow_dissect_hash(const struct sk_buff *skb,
 }
 EXPORT_SYMBOL(skb_flow_dissect_hash);
 
+/* MPLS carries no payload type, but a hashing dissector that found no
+ * entropy label is better served by guessing IPv4/IPv6 from the version
+ * nibble than by giving every packet on the LSP the same hash.  @nhoff
+ * points at the last label parsed, which must be bottom of stack.
+ */
+static enum flow_dissect_ret
+__skb_flow_dissect_mpls_payload(const struct sk_buff *skb,
+				const void *data, int nhoff, int hlen,
+				__be16 *p_proto)
+{
+	struct {
+		struct mpls_label lse;
+		u8 ver;
+	} __packed *hdr, _hdr;
+
+	hdr = __skb_header_pointer(skb, nhoff, sizeof(_hdr), data, hlen,
+				   &_hdr);
+	if (!hdr || !(ntohl(hdr->lse.entry) & MPLS_LS_S_MASK))
+		return FLOW_DISSECT_RET_OUT_GOOD;
+
+	switch (hdr->ver >> 4) {
+	case 4:
+		*p_proto = htons(ETH_P_IP);
+		return FLOW_DISSECT_RET_PROTO_AGAIN;
+	case 6:
+		*p_proto = htons(ETH_P_IPV6);
+		return FLOW_DISSECT_RET_PROTO_AGAIN;
+	}
+
+	return FLOW_DISSECT_RET_OUT_GOOD;
+}
+
 static enum flow_dissect_ret
 __skb_flow_dissect_mpls(const struct sk_buff *skb,
 			struct flow_dissector *flow_dissector,
 			void *target_container, const void *data, int nhoff,
-			int hlen, int lse_index, bool *entropy_label)
+			int hlen, int lse_index, bool *entropy_label,
+			bool *have_entropy)
 {
 	struct mpls_label *hdr, _hdr;
 	u32 entry, label, bos;
@@ -484,6 +517,7 @@ __skb_flow_dissect_mpls(const struct sk_buff *skb,
 						      FLOW_DISSECTOR_KEY_MPLS_ENTROPY,
 						      target_container);
 		key_keyid->keyid = cpu_to_be32(label);
+		*have_entropy = true;
 	}
 
 	*entropy_label = label == MPLS_LABEL_ENTROPY;
@@ -956,6 +990,7 @@ bool __skb_flow_dissect(const struct net *net,
 	struct flow_dissector_key_vlan *key_vlan;
 	enum flow_dissect_ret fdret;
 	enum flow_dissector_key_id dissector_vlan = FLOW_DISSECTOR_KEY_MAX;
+	bool mpls_entropy = false;
 	bool mpls_el = false;
 	int mpls_lse = 0;
 	int num_hdrs = 0;
@@ -1330,7 +1365,21 @@ proto_again:
 		fdret = __skb_flow_dissect_mpls(skb, flow_dissector,
 						target_container, data,
 						nhoff, hlen, mpls_lse,
-						&mpls_el);
+						&mpls_el, &mpls_entropy);
+
+		if (fdret == FLOW_DISSECT_RET_OUT_GOOD && !mpls_entropy &&
+		    !(flags & FLOW_DISSECTOR_F_STOP_AT_ENCAP) &&
+		    dissector_uses_key(flow_dissector,
+				       FLOW_DISSECTOR_KEY_MPLS_ENTROPY) &&
+		    !dissector_uses_key(flow_dissector,
+					FLOW_DISSECTOR_KEY_MPLS)) {
+			fdret = __skb_flow_dissect_mpls_payload(skb, data,
+								nhoff, hlen,
+								&proto);
+			if (fdret == FLOW_DISSECT_RET_PROTO_AGAIN)
+				key_control->flags |= FLOW_DIS_ENCAPSULATION;
+		}
+
 		nhoff += sizeof(struct mpls_label);
 		mpls_lse++;
 		break;
@@ -1771,6 +1820,13 @@ __u32 skb_get_hash_perturb(const struct sk_buff *skb,
 {
 	struct flow_keys keys;
 
+	/* A software hash already summarises the dissected keys under our
+	 * own secret; rekeying it is as good as dissecting the headers again
+	 * for every packet that sfq/sfb/hhf enqueue.
+	 */
+	if (skb->sw_hash && skb->hash)
+		return siphash_1u32(skb->hash, perturb);
+
 	return ___skb_get_hash(skb, &keys, perturb);
 }
 EXPORT_SYMBOL(skb_get_hash_perturb);
@@ -1894,6 +1950,10 @@ static const struct flow_dissector_key flow_keys_dissector_keys[] = {
 		.key_id = FLOW_DISSECTOR_KEY_VLAN,
 		.offset = offsetof(struct flow_keys, vlan),
 	},
+	{
+		.key_id = FLOW_DISSECTOR_KEY_CVLAN,
+		.offset = offsetof(struct flow_keys, cvlan),
+	},
 	{
 		.key_id = FLOW_DISSECTOR_KEY_FLOW_LABEL,
 		.offset = offsetof(struct flow_keys, tags),
@@ -1902,6 +1962,10 @@ static const struct flow_dissector_key flow_keys_dissector_keys[] = {
 		.key_id = FLOW_DISSECTOR_KEY_GRE_KEYID,
 		.offset = offsetof(struct flow_keys, keyid),
 	},
+	{
+		.key_id = FLOW_DISSECTOR_KEY_MPLS_ENTROPY,
+		.offset = offsetof(struct flow_keys, keyid),
+	},
 };
 
 static const struct flow_dissector_key flow_keys_dissector_symmetric_keys[] = {
@@ -29,6 +29,9 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/seqlock.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <net/net_namespace.h>
 #include <net/sock.h>
 #include <net/gen_stats.h>
 
@@ -54,11 +57,43 @@ struct net_rate_estimator {
 	u64			avpps;
 	u64			avbps;
 
-	unsigned long           next_jiffies;
-	struct timer_list       timer;
+	struct list_head	list;
 	struct rcu_head		rcu;
 };
 
+/* All estimators sharing an interval are updated from one timer, in a
+ * single pass, instead of each arming its own.  ->lock serialises the
+ * pass against estimators joining or leaving the bucket.
+ */
+struct est_bucket {
+	spinlock_t		lock;
+	struct list_head	list;
+	struct timer_list	timer;
+	unsigned long		next_jiffies;
+	unsigned int		count;
+
+	/* per-interval cost accounting */
+	u64			passes;
+	u64			updates;
+	u64			cost_ns;
+	u64			max_ns;
+};
+
+#define EST_INTVL_LOG_MAX	5	/* intvl_log 0..5 : 250ms .. 8 sec */
+
+static void est_bucket_timer(struct timer_list *t);
+
+#define EST_BUCKET_INIT(n) {						\
+	.lock	= __SPIN_LOCK_UNLOCKED(est_buckets[n].lock),		\
+	.list	= LIST_HEAD_INIT(est_buckets[n].list),			\
+	.timer	= __TIMER_INITIALIZER(est_bucket_timer, 0),		\
+}
+
+static struct est_bucket est_buckets[EST_INTVL_LOG_MAX + 1] = {
+	EST_BUCKET_INIT(0), EST_BUCKET_INIT(1), EST_BUCKET_INIT(2),
+	EST_BUCKET_INIT(3), EST_BUCKET_INIT(4), EST_BUCKET_INIT(5),
+};
+
 static void est_fetch_counters(struct net_rate_estimator *e,
 			       struct gnet_stats_basic_sync *b)
 {
@@ -73,9 +108,8 @@ static void est_fetch_counters(struct net_rate_estimator *e,
 
 }
 
-static void est_timer(struct timer_list *t)
+static void est_update(struct net_rate_estimator *est)
 {
-	struct net_rate_estimator *est = from_timer(est, t, timer);
 	struct gnet_stats_basic_sync b;
 	u64 b_bytes, b_packets;
 	u64 rate, brate;
@@ -97,14 +131,63 @@ static void est_timer(struct timer_list *t)
 
 	est->last_bytes = b_bytes;
 	est->last_packets = b_packets;
+}
 
-	est->next_jiffies += ((HZ/4) << est->intvl_log);
+static void est_bucket_timer(struct timer_list *t)
+{
+	struct est_bucket *bkt = from_timer(bkt, t, timer);
+	unsigned int intvl_log = bkt - est_buckets;
+	struct net_rate_estimator *est;
+	u64 start, cost;
+
+	spin_lock(&bkt->lock);
+	start = ktime_get_ns();
+	list_for_each_entry(est, &bkt->list, list)
+		est_update(est);
+	cost = ktime_get_ns() - start;
+
+	bkt->passes++;
+	bkt->updates += bkt->count;
+	bkt->cost_ns += cost;
+	if (cost > bkt->max_ns)
+		bkt->max_ns = cost;
+
+	if (bkt->count) {
+		bkt->next_jiffies += ((HZ/4) << intvl_log);
+
+		if (unlikely(time_after_eq(jiffies, bkt->next_jiffies))) {
+			/* Ouch... timer was delayed. */
+			bkt->next_jiffies = jiffies + 1;
+		}
+		mod_timer(&bkt->timer, bkt->next_jiffies);
+	}
+	spin_unlock(&bkt->lock);
+}
 
-	if (unlikely(time_after_eq(jiffies, est->next_jiffies))) {
-		/* Ouch... timer was delayed. */
-		est->next_jiffies = jiffies + 1;
+static void est_link(struct net_rate_estimator *est)
+{
+	struct est_bucket *bkt = &est_buckets[est->intvl_log];
+
+	spin_lock_bh(&bkt->lock);
+	list_add_tail(&est->list, &bkt->list);
+	if (!bkt->count++ && !timer_pending(&bkt->timer)) {
+		bkt->next_jiffies = jiffies + ((HZ/4) << est->intvl_log);
+		mod_timer(&bkt->timer, bkt->next_jiffies);
 	}
-	mod_timer(&est->timer, est->next_jiffies);
+	spin_unlock_bh(&bkt->lock);
+}
+
+/* Once this returns the bucket timer no longer touches @est; an idle
+ * bucket timer simply does not rearm itself.
+ */
+static void est_unlink(struct net_rate_estimator *est)
+{
+	struct est_bucket *bkt = &est_buckets[est->intvl_log];
+
+	spin_lock_bh(&bkt->lock);
+	list_del(&est->list);
+	bkt->count--;
+	spin_unlock_bh(&bkt->lock);
 }
 
 /**
@@ -119,8 +202,8 @@ static void est_timer(struct timer_list *t)
  * @opt: rate estimator configuration TLV
  *
  * Creates a new rate estimator with &bstats as source and &rate_est
- * as destination. A new timer with the interval specified in the
- * configuration TLV is created. Upon each interval, the latest statistics
+ * as destination. The estimator joins the shared timer of the interval
+ * specified in the configuration TLV. Upon each interval, the latest statistics
  * will be read from &bstats and the estimated rate will be stored in
  * &rate_est with the statistics lock grabbed during this period.
  *
@@ -173,19 +256,17 @@ int gen_new_estimator(struct gnet_stats_basic_sync *bstats,
 	est->last_bytes = u64_stats_read(&b.bytes);
 	est->last_packets = u64_stats_read(&b.packets);
 
-	if (lock)
-		spin_lock_bh(lock);
+	/* the bucket lock nests outside @lock, see est_bucket_timer() */
 	old = rcu_dereference_protected(*rate_est, 1);
 	if (old) {
-		del_timer_sync(&old->timer);
+		est_unlink(old);
 		est->avbps = old->avbps;
 		est->avpps = old->avpps;
 	}
+	est_link(est);
 
-	est->next_jiffies = jiffies + ((HZ/4) << intvl_log);
-	timer_setup(&est->timer, est_timer, 0);
-	mod_timer(&est->timer, est->next_jiffies);
-
+	if (lock)
+		spin_lock_bh(lock);
 	rcu_assign_pointer(*rate_est, est);
 	if (lock)
 		spin_unlock_bh(lock);
@@ -208,7 +289,7 @@ void gen_kill_estimator(struct net_rate_estimator __rcu **rate_est)
 
 	est = xchg((__force struct net_rate_estimator **)rate_est, NULL);
 	if (est) {
-		del_timer_sync(&est->timer);
+		est_unlink(est);
 		kfree_rcu(est, rcu);
 	}
 }
@@ -276,3 +357,33 @@ bool gen_estimator_read(struct net_rate_estimator __rcu **rate_est,
 	return true;
 }
 EXPORT_SYMBOL(gen_estimator_read);
+
+#ifdef CONFIG_PROC_FS
+static int est_stat_seq_show(struct seq_file *seq, void *v)
+{
+	struct est_bucket *bkt;
+	int i;
+
+	seq_puts(seq, "interval_ms estimators passes updates total_us max_us\n");
+	for (i = 0; i <= EST_INTVL_LOG_MAX; i++) {
+		bkt = &est_buckets[i];
+
+		spin_lock_bh(&bkt->lock);
+		seq_printf(seq, "%u %u %llu %llu %llu %llu\n",
+			   250U << i, bkt->count, bkt->passes, bkt->updates,
+			   div_u64(bkt->cost_ns, NSEC_PER_USEC),
+			   div_u64(bkt->max_ns, NSEC_PER_USEC));
+		spin_unlock_bh(&bkt->lock);
+	}
+	return 0;
+}
+
+static int __init est_stat_init(void)
+{
+	if (!proc_create_single("gen_estimator", 0444, init_net.proc_net_stat,
+				est_stat_seq_show))
+		return -ENOMEM;
+	return 0;
+}
+subsys_initcall(est_stat_init);
+#endif
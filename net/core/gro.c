@@ -2,6 +2,7 @@
 #include <net/gro.h>
 #include <net/dst_metadata.h>
 #include <net/busy_poll.h>
+#include <net/pkt_latency.h>
 #include <trace/events/net.h>
 
 #define MAX_GRO_SKBS 8
@@ -651,6 +652,7 @@ gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 
 	skb_mark_napi_id(skb, napi);
 	trace_napi_gro_receive_entry(skb);
+	net_pkt_stage(skb, PKTLAT_STACK);
 
 	skb_gro_reset_offset(skb, 0);
 
@@ -673,6 +675,7 @@ static void napi_reuse_skb(struct napi_struct *napi, struct sk_buff *skb)
 	__vlan_hwaccel_clear_tag(skb);
 	skb->dev = napi->dev;
 	skb->skb_iif = 0;
+	skb_pktlat_reset(skb);
 
 	/* eth_type_trans() assumes pkt_type is PACKET_HOST */
 	skb->pkt_type = PACKET_HOST;
@@ -780,6 +783,7 @@ gro_result_t napi_gro_frags(struct napi_struct *napi)
 	struct sk_buff *skb = napi_frags_skb(napi);
 
 	trace_napi_gro_frags_entry(skb);
+	net_pkt_stage(skb, PKTLAT_STACK);
 
 	ret = napi_frags_finish(napi, skb, dev_gro_receive(napi, skb));
 	trace_napi_gro_frags_exit(ret);
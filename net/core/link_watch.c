@@ -27,6 +27,9 @@ enum lw_bits {
 static unsigned long linkwatch_flags;
 static unsigned long linkwatch_nextevent;
 
+/* Don't rate limit carrier loss, so routing reacts to it right away */
+int sysctl_link_watch_urgent_down __read_mostly;
+
 static void linkwatch_event(struct work_struct *dummy);
 static DECLARE_DELAYED_WORK(linkwatch_work, linkwatch_event);
 
@@ -99,6 +102,9 @@ static bool linkwatch_urgent_event(struct net_device *dev)
 	if (netif_is_lag_port(dev) || netif_is_lag_master(dev))
 		return true;
 
+	if (!netif_carrier_ok(dev) && READ_ONCE(sysctl_link_watch_urgent_down))
+		return true;
+
 	return netif_carrier_ok(dev) &&	qdisc_tx_changing(dev);
 }
 
@@ -14,6 +14,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/slab.h>
+#include <linux/mm.h>
 #include <linux/kmemleak.h>
 #include <linux/types.h>
 #include <linux/kernel.h>
@@ -1482,9 +1483,49 @@ out:
 	return err;
 }
 
+/* Lockless check for protocol updates that __neigh_update() would turn
+ * into a no-op: the same link layer address re-announced for a valid
+ * entry, at most refreshing ->confirmed within the current jiffy.  With
+ * thousands of hosts on a segment these would otherwise bounce
+ * neigh->lock between CPUs for every ARP/ND packet.  A racing state
+ * change is harmless, the update would have been ordered before it.
+ */
+static bool neigh_update_is_noop(struct neighbour *neigh, const u8 *lladdr,
+				 u8 new, u32 flags)
+{
+	u8 old = READ_ONCE(neigh->nud_state);
+	struct net_device *dev = neigh->dev;
+	unsigned int seq;
+	bool same;
+
+	if (flags & ~(NEIGH_UPDATE_F_OVERRIDE | NEIGH_UPDATE_F_WEAK_OVERRIDE))
+		return false;
+	if (!lladdr || !dev->addr_len || !(old & NUD_VALID) ||
+	    !(new & NUD_VALID) || READ_ONCE(neigh->dead))
+		return false;
+
+	do {
+		seq = read_seqbegin(&neigh->ha_lock);
+		same = !memcmp(lladdr, neigh->ha, dev->addr_len);
+	} while (read_seqretry(&neigh->ha_lock, seq));
+	if (!same)
+		return false;
+
+	if (new == NUD_STALE)
+		return true;
+	return new == old &&
+	       (!(new & NUD_CONNECTED) || READ_ONCE(neigh->confirmed) == jiffies);
+}
+
 int neigh_update(struct neighbour *neigh, const u8 *lladdr, u8 new,
 		 u32 flags, u32 nlmsg_pid)
 {
+	/* As in __neigh_update(), only admin may change these */
+	if (!(flags & NEIGH_UPDATE_F_ADMIN) &&
+	    (READ_ONCE(neigh->nud_state) & (NUD_NOARP | NUD_PERMANENT)))
+		return -EPERM;
+	if (neigh_update_is_noop(neigh, lladdr, new, flags))
+		return 0;
 	return __neigh_update(neigh, lladdr, new, flags, nlmsg_pid, NULL);
 }
 EXPORT_SYMBOL(neigh_update);
@@ -1761,11 +1802,32 @@ static struct lock_class_key neigh_table_proxy_queue_class;
 
 static struct neigh_table *neigh_tables[NEIGH_NR_TABLES] __read_mostly;
 
+/* Raise the compiled-in GC thresholds on machines with more memory, one
+ * entry per 128KiB of RAM for gc_thresh3, keeping the 1:4:8 ratio of the
+ * defaults.  Thresholds are never lowered and stay tunable via sysctl.
+ */
+static void neigh_table_scale_gc_thresh(struct neigh_table *tbl)
+{
+	unsigned long thresh3 = totalram_pages() >> (17 - PAGE_SHIFT);
+
+	if (thresh3 <= tbl->gc_thresh3)
+		return;
+	thresh3 = rounddown_pow_of_two(min_t(unsigned long, thresh3, 1 << 16));
+	if (thresh3 <= tbl->gc_thresh3)
+		return;
+
+	tbl->gc_thresh1 = max_t(int, tbl->gc_thresh1, thresh3 / 8);
+	tbl->gc_thresh2 = max_t(int, tbl->gc_thresh2, thresh3 / 2);
+	tbl->gc_thresh3 = thresh3;
+}
+
 void neigh_table_init(int index, struct neigh_table *tbl)
 {
 	unsigned long now = jiffies;
 	unsigned long phsize;
 
+	neigh_table_scale_gc_thresh(tbl);
+
 	INIT_LIST_HEAD(&tbl->parms_list);
 	INIT_LIST_HEAD(&tbl->gc_list);
 	INIT_LIST_HEAD(&tbl->managed_list);
@@ -178,6 +178,48 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 	return 0;
 }
 
+static int skb_cache_seq_show(struct seq_file *seq, void *v)
+{
+	struct napi_skb_cache_stats stats;
+	int cpu = seq->index;
+
+	napi_skb_cache_stats(cpu, &stats);
+	seq_printf(seq, "%08x %08x %08x %08x %08x\n",
+		   stats.hit, stats.miss, stats.recycle, stats.flush, cpu);
+	return 0;
+}
+
+/* "*" lines are totals over all devices and namespaces, followed by the
+ * per-device breakdown for this namespace of the drops the core saw on
+ * the device's own RX/TX path while net.core.dev_drop_stats was set;
+ * zero counters are skipped.
+ */
+static int drop_reasons_seq_show(struct seq_file *seq, void *v)
+{
+	struct net_device *dev = v;
+	enum skb_drop_reason reason;
+	unsigned long count;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_puts(seq, "Iface Reason Count\n");
+		for (reason = 0; reason < SKB_DROP_REASON_MAX; reason++) {
+			count = skb_drop_reason_count(reason);
+			if (count)
+				seq_printf(seq, "* %s %lu\n",
+					   drop_reasons[reason], count);
+		}
+		return 0;
+	}
+
+	for (reason = 0; reason < SKB_DROP_REASON_MAX; reason++) {
+		count = netdev_drop_reason_count(dev, reason);
+		if (count)
+			seq_printf(seq, "%s %s %lu\n", dev->name,
+				   drop_reasons[reason], count);
+	}
+	return 0;
+}
+
 static const struct seq_operations dev_seq_ops = {
 	.start = dev_seq_start,
 	.next  = dev_seq_next,
@@ -185,6 +227,13 @@ static const struct seq_operations dev_seq_ops = {
 	.show  = dev_seq_show,
 };
 
+static const struct seq_operations drop_reasons_seq_ops = {
+	.start = dev_seq_start,
+	.next  = dev_seq_next,
+	.stop  = dev_seq_stop,
+	.show  = drop_reasons_seq_show,
+};
+
 static const struct seq_operations softnet_seq_ops = {
 	.start = softnet_seq_start,
 	.next  = softnet_seq_next,
@@ -192,6 +241,13 @@ static const struct seq_operations softnet_seq_ops = {
 	.show  = softnet_seq_show,
 };
 
+static const struct seq_operations skb_cache_seq_ops = {
+	.start = softnet_seq_start,
+	.next  = softnet_seq_next,
+	.stop  = softnet_seq_stop,
+	.show  = skb_cache_seq_show,
+};
+
 static void *ptype_get_idx(struct seq_file *seq, loff_t pos)
 {
 	struct list_head *ptype_list = NULL;
@@ -322,9 +378,15 @@ static int __net_init dev_proc_net_init(struct net *net)
 	if (!proc_create_seq("softnet_stat", 0444, net->proc_net,
 			 &softnet_seq_ops))
 		goto out_dev;
+	if (!proc_create_seq("skb_cache_stat", 0444, net->proc_net,
+			 &skb_cache_seq_ops))
+		goto out_softnet;
+	if (!proc_create_net("drop_reasons", 0444, net->proc_net,
+			&drop_reasons_seq_ops, sizeof(struct seq_net_private)))
+		goto out_skb_cache;
 	if (!proc_create_net("ptype", 0444, net->proc_net, &ptype_seq_ops,
 			sizeof(struct seq_net_private)))
-		goto out_softnet;
+		goto out_drop_reasons;
 
 	if (wext_proc_init(net))
 		goto out_ptype;
@@ -333,6 +395,10 @@ out:
 	return rc;
 out_ptype:
 	remove_proc_entry("ptype", net->proc_net);
+out_drop_reasons:
+	remove_proc_entry("drop_reasons", net->proc_net);
+out_skb_cache:
+	remove_proc_entry("skb_cache_stat", net->proc_net);
 out_softnet:
 	remove_proc_entry("softnet_stat", net->proc_net);
 out_dev:
@@ -345,6 +411,8 @@ static void __net_exit dev_proc_net_exit(struct net *net)
 	wext_proc_exit(net);
 
 	remove_proc_entry("ptype", net->proc_net);
+	remove_proc_entry("drop_reasons", net->proc_net);
+	remove_proc_entry("skb_cache_stat", net->proc_net);
 	remove_proc_entry("softnet_stat", net->proc_net);
 	remove_proc_entry("dev", net->proc_net);
 }
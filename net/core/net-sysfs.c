@@ -620,6 +620,38 @@ static ssize_t threaded_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(threaded);
 
+static ssize_t napi_fanout_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct net_device *netdev = to_net_dev(dev);
+	ssize_t ret = -EINVAL;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	if (dev_isalive(netdev))
+		ret = sysfs_emit(buf, fmt_dec, netdev->napi_fanout);
+
+	rtnl_unlock();
+	return ret;
+}
+
+static int modify_napi_fanout(struct net_device *dev, unsigned long val)
+{
+	if (val != 0 && val != 1)
+		return -EOPNOTSUPP;
+
+	return dev_set_napi_fanout(dev, val);
+}
+
+static ssize_t napi_fanout_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t len)
+{
+	return netdev_store(dev, attr, buf, len, modify_napi_fanout);
+}
+static DEVICE_ATTR_RW(napi_fanout);
+
 static struct attribute *net_class_attrs[] __ro_after_init = {
 	&dev_attr_netdev_group.attr,
 	&dev_attr_type.attr,
@@ -653,6 +685,7 @@ static struct attribute *net_class_attrs[] __ro_after_init = {
 	&dev_attr_carrier_up_count.attr,
 	&dev_attr_carrier_down_count.attr,
 	&dev_attr_threaded.attr,
+	&dev_attr_napi_fanout.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(net_class);
@@ -19,6 +19,9 @@
 #include <linux/mm.h> /* for put_page() */
 #include <linux/poison.h>
 #include <linux/ethtool.h>
+#include <linux/cpuhotplug.h>
+#include <linux/local_lock.h>
+#include <linux/sizes.h>
 
 #include <trace/events/page_pool.h>
 
@@ -30,6 +33,7 @@
 #ifdef CONFIG_PAGE_POOL_STATS
 /* alloc_stat_inc is intended to be used in softirq context */
 #define alloc_stat_inc(pool, __stat)	(pool->alloc_stats.__stat++)
+#define alloc_stat_add(pool, __stat, val)	(pool->alloc_stats.__stat += (val))
 /* recycle_stat_inc is safe to use when preemption is possible. */
 #define recycle_stat_inc(pool, __stat)							\
 	do {										\
@@ -50,11 +54,14 @@ static const char pp_stats[][ETH_GSTRING_LEN] = {
 	"rx_pp_alloc_empty",
 	"rx_pp_alloc_refill",
 	"rx_pp_alloc_waive",
+	"rx_pp_alloc_shared",
 	"rx_pp_recycle_cached",
 	"rx_pp_recycle_cache_full",
 	"rx_pp_recycle_ring",
 	"rx_pp_recycle_ring_full",
 	"rx_pp_recycle_released_ref",
+	"rx_pp_recycle_shared",
+	"rx_pp_recycle_released",
 };
 
 bool page_pool_get_stats(struct page_pool *pool,
@@ -72,6 +79,7 @@ bool page_pool_get_stats(struct page_pool *pool,
 	stats->alloc_stats.empty += pool->alloc_stats.empty;
 	stats->alloc_stats.refill += pool->alloc_stats.refill;
 	stats->alloc_stats.waive += pool->alloc_stats.waive;
+	stats->alloc_stats.shared += pool->alloc_stats.shared;
 
 	for_each_possible_cpu(cpu) {
 		const struct page_pool_recycle_stats *pcpu =
@@ -82,6 +90,8 @@ bool page_pool_get_stats(struct page_pool *pool,
 		stats->recycle_stats.ring += pcpu->ring;
 		stats->recycle_stats.ring_full += pcpu->ring_full;
 		stats->recycle_stats.released_refcnt += pcpu->released_refcnt;
+		stats->recycle_stats.shared += pcpu->shared;
+		stats->recycle_stats.released += pcpu->released;
 	}
 
 	return true;
@@ -117,11 +127,14 @@ u64 *page_pool_ethtool_stats_get(u64 *data, void *stats)
 	*data++ = pool_stats->alloc_stats.empty;
 	*data++ = pool_stats->alloc_stats.refill;
 	*data++ = pool_stats->alloc_stats.waive;
+	*data++ = pool_stats->alloc_stats.shared;
 	*data++ = pool_stats->recycle_stats.cached;
 	*data++ = pool_stats->recycle_stats.cache_full;
 	*data++ = pool_stats->recycle_stats.ring;
 	*data++ = pool_stats->recycle_stats.ring_full;
 	*data++ = pool_stats->recycle_stats.released_refcnt;
+	*data++ = pool_stats->recycle_stats.shared;
+	*data++ = pool_stats->recycle_stats.released;
 
 	return data;
 }
@@ -129,6 +142,7 @@ EXPORT_SYMBOL(page_pool_ethtool_stats_get);
 
 #else
 #define alloc_stat_inc(pool, __stat)
+#define alloc_stat_add(pool, __stat, val)
 #define recycle_stat_inc(pool, __stat)
 #define recycle_stat_add(pool, __stat, val)
 #endif
@@ -354,6 +368,94 @@ static bool page_pool_dma_map(struct page_pool *pool, struct page *page)
 	return true;
 }
 
+/* Pages a pool cannot keep, because its ring is full or it is going
+ * away, go to a small per-CPU cache shared by all pools rather than back
+ * to the page allocator. Any pool of the same order takes them on its
+ * slow path, so e.g. forwarding from one NIC to another keeps recycling
+ * pages instead of churning the allocator. Pages in the cache are
+ * unmapped and carry no pool state.
+ *
+ * A pool only takes pages from its node and from zones its gfp mask
+ * allows: a device limited to 32-bit DMA allocates with GFP_DMA32 and
+ * must not get a page another pool took from ZONE_NORMAL.
+ */
+#define PP_SHARED_MAX_ORDER	3
+#define PP_SHARED_BYTES		SZ_64K
+#define PP_SHARED_SIZE		(PP_SHARED_BYTES / PAGE_SIZE ?: 1)
+
+struct page_pool_shared {
+	local_lock_t	lock;
+	unsigned int	count[PP_SHARED_MAX_ORDER + 1];
+	struct page	*cache[PP_SHARED_MAX_ORDER + 1][PP_SHARED_SIZE];
+};
+
+static DEFINE_PER_CPU(struct page_pool_shared, page_pool_shared) = {
+	.lock = INIT_LOCAL_LOCK(lock),
+};
+
+/* Same memory footprint for each order */
+static unsigned int page_pool_shared_size(unsigned int order)
+{
+	return max_t(unsigned int, PP_SHARED_SIZE >> order, 1);
+}
+
+static unsigned int page_pool_shared_get(struct page_pool *pool,
+					 struct page **pages,
+					 unsigned int nr, gfp_t gfp)
+{
+	enum zone_type max_zone = gfp_zone(gfp);
+	unsigned int order = pool->p.order;
+	int pref_nid = pool->p.nid;
+	struct page_pool_shared *pps;
+	unsigned int got = 0;
+	unsigned long flags;
+	struct page *page;
+
+	if (order > PP_SHARED_MAX_ORDER)
+		return 0;
+
+	if (pref_nid == NUMA_NO_NODE)
+		pref_nid = numa_mem_id();
+
+	local_lock_irqsave(&page_pool_shared.lock, flags);
+	pps = this_cpu_ptr(&page_pool_shared);
+	while (got < nr && pps->count[order]) {
+		page = pps->cache[order][pps->count[order] - 1];
+		if (page_to_nid(page) != pref_nid ||
+		    page_zonenum(page) > max_zone)
+			break;
+		pps->count[order]--;
+		pages[got++] = page;
+	}
+	local_unlock_irqrestore(&page_pool_shared.lock, flags);
+
+	return got;
+}
+
+static int page_pool_shared_dead(unsigned int cpu)
+{
+	struct page_pool_shared *pps = per_cpu_ptr(&page_pool_shared, cpu);
+	unsigned int order;
+
+	for (order = 0; order <= PP_SHARED_MAX_ORDER; order++) {
+		while (pps->count[order])
+			put_page(pps->cache[order][--pps->count[order]]);
+	}
+
+	return 0;
+}
+
+static int __init page_pool_shared_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_nocalls(CPUHP_BP_PREPARE_DYN,
+					"net/page_pool:dead", NULL,
+					page_pool_shared_dead);
+	return ret < 0 ? ret : 0;
+}
+subsys_initcall(page_pool_shared_init);
+
 static void page_pool_set_pp_info(struct page_pool *pool,
 				  struct page *page)
 {
@@ -374,10 +476,14 @@ static struct page *__page_pool_alloc_page_order(struct page_pool *pool,
 {
 	struct page *page;
 
-	gfp |= __GFP_COMP;
-	page = alloc_pages_node(pool->p.nid, gfp, pool->p.order);
-	if (unlikely(!page))
-		return NULL;
+	if (page_pool_shared_get(pool, &page, 1, gfp)) {
+		alloc_stat_inc(pool, shared);
+	} else {
+		gfp |= __GFP_COMP;
+		page = alloc_pages_node(pool->p.nid, gfp, pool->p.order);
+		if (unlikely(!page))
+			return NULL;
+	}
 
 	if ((pool->p.flags & PP_FLAG_DMA_MAP) &&
 	    unlikely(!page_pool_dma_map(pool, page))) {
@@ -416,8 +522,12 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 	/* Mark empty alloc.cache slots "empty" for alloc_pages_bulk_array */
 	memset(&pool->alloc.cache, 0, sizeof(void *) * bulk);
 
-	nr_pages = alloc_pages_bulk_array_node(gfp, pool->p.nid, bulk,
-					       pool->alloc.cache);
+	nr_pages = page_pool_shared_get(pool, pool->alloc.cache, bulk, gfp);
+	if (nr_pages)
+		alloc_stat_add(pool, shared, nr_pages);
+	else
+		nr_pages = alloc_pages_bulk_array_node(gfp, pool->p.nid, bulk,
+						       pool->alloc.cache);
 	if (unlikely(!nr_pages))
 		return NULL;
 
@@ -526,6 +636,26 @@ EXPORT_SYMBOL(page_pool_release_page);
 /* Return a page to the page allocator, cleaning up our state */
 static void page_pool_return_page(struct page_pool *pool, struct page *page)
 {
+	unsigned int order = pool->p.order;
+	struct page_pool_shared *pps;
+	unsigned long flags;
+
+	if (order <= PP_SHARED_MAX_ORDER && page_ref_count(page) == 1 &&
+	    !page_is_pfmemalloc(page)) {
+		local_lock_irqsave(&page_pool_shared.lock, flags);
+		pps = this_cpu_ptr(&page_pool_shared);
+		if (pps->count[order] < page_pool_shared_size(order)) {
+			/* pool may be gone after the release */
+			recycle_stat_inc(pool, shared);
+			page_pool_release_page(pool, page);
+			pps->cache[order][pps->count[order]++] = page;
+			local_unlock_irqrestore(&page_pool_shared.lock, flags);
+			return;
+		}
+		local_unlock_irqrestore(&page_pool_shared.lock, flags);
+	}
+
+	recycle_stat_inc(pool, released);
 	page_pool_release_page(pool, page);
 
 	put_page(page);
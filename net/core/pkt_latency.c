@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-stage packet latency histograms
+ *
+ * A packet is stamped at the RX interrupt that reported it if the driver
+ * records that time (stmmac), else when the driver reaps it from the NIC
+ * in NAPI, or at the first receive boundary it passes if the driver does
+ * not mark PKTLAT_RX at all. The stamp lives in the sk_buff headers and so survives
+ * clones and forwarding. At each later boundary of enum pktlat_point the
+ * time since the previous boundary is added to a per-cpu log2 histogram
+ * of the stage that just ended:
+ *
+ *  driver	RX IRQ to GRO/netif_receive_skb(), incl. NAPI deferral;
+ *		only the driver's own processing if stamped in NAPI
+ *  gro		GRO, RPS and the backlog queue
+ *  l3		protocol demux, PREROUTING, route or fdb lookup
+ *  netfilter	FORWARD hook
+ *  output	POSTROUTING and neighbour output up to dev_queue_xmit()
+ *  qdisc	time queued in the egress qdisc
+ *  tx		ndo_start_xmit() to TX completion
+ *  total	NIC RX to ndo_start_xmit()
+ *
+ * Boundaries count only once and in path order; when one is skipped its
+ * stage is accounted to the next one reached. Locally delivered packets
+ * therefore only show up in the receive stages. The qdisc and tx
+ * boundaries are not taken on devices without a queue of their own, such
+ * as vlan, bridge or macvlan, but on the real egress device below them.
+ *
+ *  pkt_latency/enable	0/1, hooks the probes to the boundary tracepoints
+ *  pkt_latency/summary	count, mean, percentiles and maximum per stage
+ *  pkt_latency/hist	per-stage histograms, any write clears them
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/skbuff.h>
+#include <linux/timekeeping.h>
+#include <linux/uaccess.h>
+#include <net/pkt_latency.h>
+#include <trace/events/net.h>
+#include <trace/events/skb.h>
+
+#define PKTLAT_BUCKETS		32
+#define PKTLAT_TOTAL		(PKTLAT_POINTS - 1)
+#define PKTLAT_STAGES		(PKTLAT_TOTAL + 1)
+
+/* Indexed by the boundary that ends the stage, minus one */
+static const char * const pktlat_stage_names[PKTLAT_STAGES] = {
+	"driver", "gro", "l3", "netfilter", "output", "qdisc", "tx", "total",
+};
+
+struct pktlat_hist {
+	u64			bucket[PKTLAT_BUCKETS];
+	u64			sum;
+	u64			max;
+};
+
+static struct pktlat_hist __percpu *pktlat_hist;
+static bool pktlat_enabled;
+static DEFINE_MUTEX(pktlat_mutex);
+
+void __net_pkt_stage(struct sk_buff *skb, enum pktlat_point point)
+{
+	trace_net_pkt_stage(skb, point);
+}
+EXPORT_SYMBOL_GPL(__net_pkt_stage);
+
+void __net_pkt_stage_rx(struct sk_buff *skb, ktime_t stamp)
+{
+	if (READ_ONCE(pktlat_enabled) && !skb->pktlat_stamp) {
+		skb->pktlat_stamp = ktime_to_ns(stamp);
+		skb->pktlat_last = 0;
+		skb->pktlat_point = PKTLAT_RX;
+	}
+	trace_net_pkt_stage(skb, PKTLAT_RX);
+}
+EXPORT_SYMBOL_GPL(__net_pkt_stage_rx);
+
+static void pktlat_add(int stage, u64 delta)
+{
+	struct pktlat_hist __percpu *h = &pktlat_hist[stage];
+	int b = delta ? min_t(int, ilog2(delta), PKTLAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(h->bucket[b]);
+	this_cpu_add(h->sum, delta);
+	/* Racy against interrupts on this CPU, may miss a larger sample */
+	if (delta > this_cpu_read(h->max))
+		this_cpu_write(h->max, delta);
+}
+
+static void pktlat_account(struct sk_buff *skb, enum pktlat_point point)
+{
+	u64 since;
+
+	/* Stacked devices hand the skb to the real one below them */
+	if ((point == PKTLAT_QUEUE || point == PKTLAT_XMIT) && skb->dev &&
+	    (skb->dev->priv_flags & IFF_NO_QUEUE))
+		return;
+
+	if (!skb->pktlat_stamp) {
+		if (point <= PKTLAT_CORE) {
+			skb->pktlat_stamp = ktime_get_ns();
+			skb->pktlat_last = 0;
+			skb->pktlat_point = point;
+		}
+		return;
+	}
+
+	if (point <= skb->pktlat_point)
+		return;
+	/* Other frees are drops, or GRO releasing merged segments */
+	if (point == PKTLAT_DONE && skb->pktlat_point != PKTLAT_XMIT)
+		return;
+
+	since = ktime_get_ns() - skb->pktlat_stamp;
+	pktlat_add(point - 1, since - skb->pktlat_last);
+	if (point == PKTLAT_XMIT)
+		pktlat_add(PKTLAT_TOTAL, since);
+
+	skb->pktlat_last = min_t(u64, since, U32_MAX);
+	skb->pktlat_point = point;
+}
+
+static void pktlat_probe_stage(void *ignore, struct sk_buff *skb, int point)
+{
+	pktlat_account(skb, point);
+}
+
+static void pktlat_probe_core(void *ignore, struct sk_buff *skb)
+{
+	pktlat_account(skb, PKTLAT_CORE);
+}
+
+static void pktlat_probe_queue(void *ignore, struct sk_buff *skb)
+{
+	pktlat_account(skb, PKTLAT_QUEUE);
+}
+
+static void pktlat_probe_done(void *ignore, struct sk_buff *skb)
+{
+	pktlat_account(skb, PKTLAT_DONE);
+}
+
+static int pktlat_register(void)
+{
+	int ret;
+
+	ret = register_trace_net_pkt_stage(pktlat_probe_stage, NULL);
+	if (ret)
+		return ret;
+	ret = register_trace_netif_receive_skb(pktlat_probe_core, NULL);
+	if (ret)
+		goto err_stage;
+	ret = register_trace_net_dev_queue(pktlat_probe_queue, NULL);
+	if (ret)
+		goto err_core;
+	ret = register_trace_consume_skb(pktlat_probe_done, NULL);
+	if (ret)
+		goto err_queue;
+
+	return 0;
+
+err_queue:
+	unregister_trace_net_dev_queue(pktlat_probe_queue, NULL);
+err_core:
+	unregister_trace_netif_receive_skb(pktlat_probe_core, NULL);
+err_stage:
+	unregister_trace_net_pkt_stage(pktlat_probe_stage, NULL);
+	tracepoint_synchronize_unregister();
+	return ret;
+}
+
+static void pktlat_unregister(void)
+{
+	unregister_trace_consume_skb(pktlat_probe_done, NULL);
+	unregister_trace_net_dev_queue(pktlat_probe_queue, NULL);
+	unregister_trace_netif_receive_skb(pktlat_probe_core, NULL);
+	unregister_trace_net_pkt_stage(pktlat_probe_stage, NULL);
+	tracepoint_synchronize_unregister();
+}
+
+/* Sum of all CPUs, returns the number of samples */
+static u64 pktlat_fold(int stage, struct pktlat_hist *sum)
+{
+	u64 count = 0;
+	int b, cpu;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct pktlat_hist *h = per_cpu_ptr(&pktlat_hist[stage], cpu);
+
+		for (b = 0; b < PKTLAT_BUCKETS; b++)
+			sum->bucket[b] += READ_ONCE(h->bucket[b]);
+		sum->sum += READ_ONCE(h->sum);
+		sum->max = max(sum->max, READ_ONCE(h->max));
+	}
+	for (b = 0; b < PKTLAT_BUCKETS; b++)
+		count += sum->bucket[b];
+
+	return count;
+}
+
+/* Upper bound of the bucket holding the pct percentile */
+static u64 pktlat_percentile(struct pktlat_hist *sum, u64 count, int pct)
+{
+	u64 want = div_u64(count * pct + 99, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < PKTLAT_BUCKETS - 1; b++) {
+		seen += sum->bucket[b];
+		if (seen >= want)
+			break;
+	}
+
+	return (2ULL << b) - 1;
+}
+
+static int pktlat_summary_show(struct seq_file *m, void *v)
+{
+	struct pktlat_hist sum;
+	u64 count;
+	int i;
+
+	seq_printf(m, "%-10s %12s %10s %10s %10s %10s %10s\n", "stage",
+		   "count", "avg_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+
+	mutex_lock(&pktlat_mutex);
+	for (i = 0; i < PKTLAT_STAGES; i++) {
+		count = pktlat_fold(i, &sum);
+		if (!count) {
+			seq_printf(m, "%-10s %12u %10s %10s %10s %10s %10s\n",
+				   pktlat_stage_names[i], 0,
+				   "-", "-", "-", "-", "-");
+			continue;
+		}
+
+		seq_printf(m, "%-10s %12llu %10llu %10llu %10llu %10llu %10llu\n",
+			   pktlat_stage_names[i], count,
+			   div64_u64(sum.sum, count),
+			   pktlat_percentile(&sum, count, 50),
+			   pktlat_percentile(&sum, count, 90),
+			   pktlat_percentile(&sum, count, 99),
+			   sum.max);
+	}
+	mutex_unlock(&pktlat_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pktlat_summary);
+
+static int pktlat_hist_show(struct seq_file *m, void *v)
+{
+	struct pktlat_hist sum;
+	u64 count;
+	int i, b;
+
+	mutex_lock(&pktlat_mutex);
+	for (i = 0; i < PKTLAT_STAGES; i++) {
+		count = pktlat_fold(i, &sum);
+		seq_printf(m, "%s count=%llu sum_ns=%llu\n",
+			   pktlat_stage_names[i], count, sum.sum);
+		for (b = 0; b < PKTLAT_BUCKETS; b++) {
+			if (!sum.bucket[b])
+				continue;
+			seq_printf(m, "  %10llu - %10llu ns: %llu\n",
+				   b ? 1ULL << b : 0, (2ULL << b) - 1,
+				   sum.bucket[b]);
+		}
+	}
+	mutex_unlock(&pktlat_mutex);
+
+	return 0;
+}
+
+static int pktlat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pktlat_hist_show, NULL);
+}
+
+static ssize_t pktlat_hist_write(struct file *file, const char __user *ubuf,
+				 size_t cnt, loff_t *ppos)
+{
+	int i, cpu;
+
+	/* Samples racing with the reset may survive it; that is fine */
+	mutex_lock(&pktlat_mutex);
+	for (i = 0; i < PKTLAT_STAGES; i++) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(&pktlat_hist[i], cpu), 0,
+			       sizeof(struct pktlat_hist));
+	}
+	mutex_unlock(&pktlat_mutex);
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations pktlat_hist_fops = {
+	.owner		= THIS_MODULE,
+	.open		= pktlat_hist_open,
+	.read		= seq_read,
+	.write		= pktlat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t pktlat_enable_read(struct file *file, char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	char buf[4];
+	int r;
+
+	r = scnprintf(buf, sizeof(buf), "%d\n", READ_ONCE(pktlat_enabled));
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t pktlat_enable_write(struct file *file, const char __user *ubuf,
+				   size_t cnt, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, cnt, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&pktlat_mutex);
+	if (enable != pktlat_enabled) {
+		if (enable)
+			ret = pktlat_register();
+		else
+			pktlat_unregister();
+		if (!ret)
+			WRITE_ONCE(pktlat_enabled, enable);
+	}
+	mutex_unlock(&pktlat_mutex);
+
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations pktlat_enable_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simple_open,
+	.read		= pktlat_enable_read,
+	.write		= pktlat_enable_write,
+	.llseek		= default_llseek,
+};
+
+static int __init pktlat_init(void)
+{
+	struct dentry *dir;
+
+	pktlat_hist = __alloc_percpu(sizeof(struct pktlat_hist) * PKTLAT_STAGES,
+				     __alignof__(struct pktlat_hist));
+	if (!pktlat_hist)
+		return -ENOMEM;
+
+	dir = debugfs_create_dir("pkt_latency", NULL);
+	debugfs_create_file("enable", 0600, dir, NULL, &pktlat_enable_fops);
+	debugfs_create_file("summary", 0400, dir, NULL, &pktlat_summary_fops);
+	debugfs_create_file("hist", 0600, dir, NULL, &pktlat_hist_fops);
+
+	return 0;
+}
+late_initcall(pktlat_init);
@@ -158,6 +158,7 @@
 #include <net/udp.h>
 #include <net/ip6_checksum.h>
 #include <net/addrconf.h>
+#include <net/gro_cells.h>
 #ifdef CONFIG_XFRM
 #include <net/xfrm.h>
 #endif
@@ -230,6 +231,7 @@ static char *pkt_flag_names[] = {
 #define M_START_XMIT		0	/* Default normal TX */
 #define M_NETIF_RECEIVE 	1	/* Inject packets into stack */
 #define M_QUEUE_XMIT		2	/* Inject packet into qdisc */
+#define M_GRO_RECEIVE		3	/* Inject packets into stack via GRO */
 
 /* If lock -- protects updating of if_list */
 #define   if_lock(t)           mutex_lock(&(t->if_lock));
@@ -411,6 +413,7 @@ struct pktgen_dev {
 				  * started as it used to do.)
 				  */
 	netdevice_tracker dev_tracker;
+	struct gro_cells gro_cells;	/* napi for xmit_mode gro_receive */
 	char odevname[32];
 	struct flow_state *flows;
 	unsigned int cflows;	/* Concurrent flows (config) */
@@ -665,6 +668,8 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 		seq_puts(seq, "     xmit_mode: netif_receive\n");
 	else if (pkt_dev->xmit_mode == M_QUEUE_XMIT)
 		seq_puts(seq, "     xmit_mode: xmit_queue\n");
+	else if (pkt_dev->xmit_mode == M_GRO_RECEIVE)
+		seq_puts(seq, "     xmit_mode: gro_receive\n");
 
 	seq_puts(seq, "     Flags: ");
 
@@ -1191,11 +1196,12 @@ static ssize_t pktgen_if_write(struct file *file,
 		len = num_arg(&user_buffer[i], 10, &value);
 		if (len < 0)
 			return len;
-		/* clone_skb is not supported for netif_receive xmit_mode and
-		 * IMIX mode.
+		/* clone_skb is not supported for netif_receive and
+		 * gro_receive xmit_mode and IMIX mode.
 		 */
 		if ((value > 0) &&
 		    ((pkt_dev->xmit_mode == M_NETIF_RECEIVE) ||
+		     (pkt_dev->xmit_mode == M_GRO_RECEIVE) ||
 		     !(pkt_dev->odev->priv_flags & IFF_TX_SKB_SHARING)))
 			return -ENOTSUPP;
 		if (value > 0 && pkt_dev->n_imix_entries > 0)
@@ -1308,10 +1314,24 @@ static ssize_t pktgen_if_write(struct file *file,
 		} else if (strcmp(f, "queue_xmit") == 0) {
 			pkt_dev->xmit_mode = M_QUEUE_XMIT;
 			pkt_dev->last_ok = 1;
+		} else if (strcmp(f, "gro_receive") == 0) {
+			if (pkt_dev->clone_skb > 0)
+				return -ENOTSUPP;
+
+			/* the cells stay around until the device is removed */
+			if (!pkt_dev->gro_cells.cells) {
+				int err = gro_cells_init(&pkt_dev->gro_cells,
+							 pkt_dev->odev);
+
+				if (err)
+					return err;
+			}
+			pkt_dev->xmit_mode = M_GRO_RECEIVE;
+			pkt_dev->last_ok = 1;
 		} else {
 			sprintf(pg_result,
 				"xmit_mode -:%s:- unknown\nAvailable modes: %s",
-				f, "start_xmit, netif_receive\n");
+				f, "start_xmit, netif_receive, queue_xmit, gro_receive\n");
 			return count;
 		}
 		sprintf(pg_result, "OK: xmit_mode=%s", f);
@@ -3509,6 +3529,27 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 			skb_reset_redirect(skb);
 		} while (--burst > 0);
 		goto out; /* Skips xmit_mode M_START_XMIT */
+	} else if (pkt_dev->xmit_mode == M_GRO_RECEIVE) {
+		/* GRO links the frames it merges together, so every frame
+		 * of the burst has to be a private copy of the template.
+		 * They are aggregated when the cell napi runs, which is on
+		 * local_bh_enable() below, like a driver rx poll would.
+		 */
+		local_bh_disable();
+		do {
+			skb = skb_copy(pkt_dev->skb, GFP_ATOMIC);
+			if (!skb) {
+				pkt_dev->errors++;
+				break;
+			}
+			skb->protocol = eth_type_trans(skb, skb->dev);
+			ret = gro_cells_receive(&pkt_dev->gro_cells, skb);
+			if (ret == NET_RX_DROP)
+				pkt_dev->errors++;
+			pkt_dev->sofar++;
+			pkt_dev->seq_num++;
+		} while (--burst > 0);
+		goto out;
 	} else if (pkt_dev->xmit_mode == M_QUEUE_XMIT) {
 		local_bh_disable();
 		refcount_inc(&pkt_dev->skb->users);
@@ -3899,6 +3940,7 @@ static int pktgen_remove_device(struct pktgen_thread *t,
 
 	/* Dis-associate from the interface */
 
+	gro_cells_destroy(&pkt_dev->gro_cells);
 	if (pkt_dev->odev) {
 		netdev_put(pkt_dev->odev, &pkt_dev->dev_tracker);
 		pkt_dev->odev = NULL;
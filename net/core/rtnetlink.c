@@ -5449,6 +5449,27 @@ struct rtnl_stats_dump_filters {
 	u32 mask[IFLA_STATS_MAX + 1];
 };
 
+/* Only grows, and changes whenever one of the packet counters does */
+static u64 rtnl_stats_cursor(const struct rtnl_link_stats64 *st)
+{
+	return st->rx_packets + st->tx_packets + st->rx_errors +
+	       st->tx_errors + st->rx_dropped + st->tx_dropped;
+}
+
+static void rtnl_fill_stats_compact(struct rtnl_link_stats_compact *c,
+				    const struct rtnl_link_stats64 *st)
+{
+	c->rx_packets = st->rx_packets;
+	c->tx_packets = st->tx_packets;
+	c->rx_bytes = st->rx_bytes;
+	c->tx_bytes = st->tx_bytes;
+	c->rx_errors = st->rx_errors;
+	c->tx_errors = st->tx_errors;
+	c->rx_dropped = st->rx_dropped;
+	c->tx_dropped = st->tx_dropped;
+	c->cursor = rtnl_stats_cursor(st);
+}
+
 static int rtnl_fill_statsinfo(struct sk_buff *skb, struct net_device *dev,
 			       int type, u32 pid, u32 seq, u32 change,
 			       unsigned int flags,
@@ -5602,6 +5623,21 @@ static int rtnl_fill_statsinfo(struct sk_buff *skb, struct net_device *dev,
 		*idxattr = 0;
 	}
 
+	if (stats_attr_valid(filter_mask, IFLA_STATS_LINK_COMPACT, *idxattr)) {
+		struct rtnl_link_stats64 st;
+
+		attr = nla_reserve_64bit(skb, IFLA_STATS_LINK_COMPACT,
+					 sizeof(struct rtnl_link_stats_compact),
+					 IFLA_STATS_UNSPEC);
+		if (!attr) {
+			err = -EMSGSIZE;
+			goto nla_put_failure;
+		}
+
+		dev_get_stats(dev, &st);
+		rtnl_fill_stats_compact(nla_data(attr), &st);
+	}
+
 	nlmsg_end(skb, nlh);
 
 	return 0;
@@ -5625,6 +5661,9 @@ static size_t if_nlmsg_stats_size(const struct net_device *dev,
 	if (stats_attr_valid(filter_mask, IFLA_STATS_LINK_64, 0))
 		size += nla_total_size_64bit(sizeof(struct rtnl_link_stats64));
 
+	if (stats_attr_valid(filter_mask, IFLA_STATS_LINK_COMPACT, 0))
+		size += nla_total_size_64bit(sizeof(struct rtnl_link_stats_compact));
+
 	if (stats_attr_valid(filter_mask, IFLA_STATS_LINK_XSTATS, 0)) {
 		const struct rtnl_link_ops *ops = dev->rtnl_link_ops;
 		int attr = IFLA_STATS_LINK_XSTATS;
@@ -5697,6 +5736,16 @@ static const struct nla_policy
 rtnl_stats_get_policy[IFLA_STATS_GETSET_MAX + 1] = {
 	[IFLA_STATS_GET_FILTERS] =
 		    NLA_POLICY_NESTED(rtnl_stats_get_policy_filters),
+	[IFLA_STATS_GET_IFINDEX_LIST] = { .type = NLA_BINARY },
+	[IFLA_STATS_GET_CURSORS] = { .type = NLA_BINARY },
+};
+
+/* Device selection of an incremental dump, points into the request */
+struct rtnl_stats_dump_sel {
+	const u32			*ifindex;
+	int				n_ifindex;
+	const struct if_stats_cursor	*cursors;
+	int				n_cursors;
 };
 
 static const struct nla_policy
@@ -5730,9 +5779,41 @@ static int rtnl_stats_get_parse_filters(struct nlattr *ifla_filters,
 	return 0;
 }
 
+static int rtnl_stats_get_parse_sel(struct nlattr **tb,
+				    struct rtnl_stats_dump_sel *sel,
+				    struct netlink_ext_ack *extack)
+{
+	struct nlattr *attr;
+
+	memset(sel, 0, sizeof(*sel));
+
+	attr = tb[IFLA_STATS_GET_IFINDEX_LIST];
+	if (attr) {
+		if (!nla_len(attr) || nla_len(attr) % sizeof(u32)) {
+			NL_SET_ERR_MSG_ATTR(extack, attr, "Invalid ifindex list");
+			return -EINVAL;
+		}
+		sel->ifindex = nla_data(attr);
+		sel->n_ifindex = nla_len(attr) / sizeof(u32);
+	}
+
+	attr = tb[IFLA_STATS_GET_CURSORS];
+	if (attr) {
+		if (nla_len(attr) % sizeof(struct if_stats_cursor)) {
+			NL_SET_ERR_MSG_ATTR(extack, attr, "Invalid cursor list");
+			return -EINVAL;
+		}
+		sel->cursors = nla_data(attr);
+		sel->n_cursors = nla_len(attr) / sizeof(struct if_stats_cursor);
+	}
+
+	return 0;
+}
+
 static int rtnl_stats_get_parse(const struct nlmsghdr *nlh,
 				u32 filter_mask,
 				struct rtnl_stats_dump_filters *filters,
+				struct rtnl_stats_dump_sel *sel,
 				struct netlink_ext_ack *extack)
 {
 	struct nlattr *tb[IFLA_STATS_GETSET_MAX + 1];
@@ -5755,9 +5836,30 @@ static int rtnl_stats_get_parse(const struct nlmsghdr *nlh,
 			return err;
 	}
 
+	if (sel)
+		return rtnl_stats_get_parse_sel(tb, sel, extack);
+
 	return 0;
 }
 
+/* A device is left out if the requester's cursor for it is current */
+static bool rtnl_stats_unchanged(struct net_device *dev,
+				 const struct rtnl_stats_dump_sel *sel)
+{
+	struct rtnl_link_stats64 st;
+	int i;
+
+	for (i = 0; i < sel->n_cursors; i++) {
+		if (sel->cursors[i].ifindex != dev->ifindex)
+			continue;
+
+		dev_get_stats(dev, &st);
+		return rtnl_stats_cursor(&st) == sel->cursors[i].cursor;
+	}
+
+	return false;
+}
+
 static int rtnl_valid_stats_req(const struct nlmsghdr *nlh, bool strict_check,
 				bool is_dump, struct netlink_ext_ack *extack)
 {
@@ -5818,7 +5920,8 @@ static int rtnl_stats_get(struct sk_buff *skb, struct nlmsghdr *nlh,
 		return -EINVAL;
 	}
 
-	err = rtnl_stats_get_parse(nlh, ifsm->filter_mask, &filters, extack);
+	err = rtnl_stats_get_parse(nlh, ifsm->filter_mask, &filters, NULL,
+				   extack);
 	if (err)
 		return err;
 
@@ -5845,6 +5948,7 @@ static int rtnl_stats_dump(struct sk_buff *skb, struct netlink_callback *cb)
 	struct netlink_ext_ack *extack = cb->extack;
 	int h, s_h, err, s_idx, s_idxattr, s_prividx;
 	struct rtnl_stats_dump_filters filters;
+	struct rtnl_stats_dump_sel sel;
 	struct net *net = sock_net(skb->sk);
 	unsigned int flags = NLM_F_MULTI;
 	struct if_stats_msg *ifsm;
@@ -5870,16 +5974,41 @@ static int rtnl_stats_dump(struct sk_buff *skb, struct netlink_callback *cb)
 	}
 
 	err = rtnl_stats_get_parse(cb->nlh, ifsm->filter_mask, &filters,
-				   extack);
+				   &sel, extack);
 	if (err)
 		return err;
 
+	/* With an ifindex list, args[0] is the position in the list */
+	if (sel.ifindex) {
+		for (h = s_h; h < sel.n_ifindex; h++) {
+			dev = __dev_get_by_index(net, sel.ifindex[h]);
+			if (!dev || rtnl_stats_unchanged(dev, &sel))
+				continue;
+			err = rtnl_fill_statsinfo(skb, dev, RTM_NEWSTATS,
+						  NETLINK_CB(cb->skb).portid,
+						  cb->nlh->nlmsg_seq, 0,
+						  flags, &filters,
+						  &s_idxattr, &s_prividx,
+						  extack);
+			WARN_ON((err == -EMSGSIZE) && (skb->len == 0));
+
+			if (err < 0)
+				goto out;
+			s_prividx = 0;
+			s_idxattr = 0;
+			nl_dump_check_consistent(cb, nlmsg_hdr(skb));
+		}
+		goto out;
+	}
+
 	for (h = s_h; h < NETDEV_HASHENTRIES; h++, s_idx = 0) {
 		idx = 0;
 		head = &net->dev_index_head[h];
 		hlist_for_each_entry(dev, head, index_hlist) {
 			if (idx < s_idx)
 				goto cont;
+			if (sel.cursors && rtnl_stats_unchanged(dev, &sel))
+				goto cont;
 			err = rtnl_fill_statsinfo(skb, dev, RTM_NEWSTATS,
 						  NETLINK_CB(cb->skb).portid,
 						  cb->nlh->nlmsg_seq, 0,
@@ -98,6 +98,37 @@ const char * const drop_reasons[] = {
 };
 EXPORT_SYMBOL(drop_reasons);
 
+struct skb_drop_stats {
+	unsigned long	reasons[SKB_DROP_REASON_MAX];
+};
+
+static DEFINE_PER_CPU(struct skb_drop_stats, skb_drop_stats);
+
+/* Always-on drop accounting, cheap enough to leave enabled without the
+ * kfree_skb tracepoint.  skb->dev is not looked at here: it may be stale
+ * or reused once the skb left the device, so per-device counts are kept
+ * by the callers that hold the device, see dev_drop_stats_inc().
+ */
+static void skb_drop_stats_inc(enum skb_drop_reason reason)
+{
+	if (unlikely((unsigned int)reason >= SKB_DROP_REASON_MAX))
+		reason = SKB_DROP_REASON_NOT_SPECIFIED;
+
+	this_cpu_inc(skb_drop_stats.reasons[reason]);
+}
+
+#ifdef CONFIG_PROC_FS
+unsigned long skb_drop_reason_count(enum skb_drop_reason reason)
+{
+	unsigned long sum = 0;
+	int i;
+
+	for_each_possible_cpu(i)
+		sum += READ_ONCE(per_cpu(skb_drop_stats, i).reasons[reason]);
+	return sum;
+}
+#endif
+
 /**
  *	skb_panic - private function for out-of-line support
  *	@skb:	buffer
@@ -195,6 +226,7 @@ struct napi_alloc_cache {
 	struct page_frag_cache page;
 	struct page_frag_1k page_small;
 	unsigned int skb_count;
+	struct napi_skb_cache_stats stats;
 	void *skb_cache[NAPI_SKB_CACHE_SIZE];
 };
 
@@ -255,12 +287,15 @@ static struct sk_buff *napi_skb_cache_get(void)
 	struct sk_buff *skb;
 
 	if (unlikely(!nc->skb_count)) {
+		nc->stats.miss++;
 		nc->skb_count = kmem_cache_alloc_bulk(skbuff_head_cache,
 						      GFP_ATOMIC,
 						      NAPI_SKB_CACHE_BULK,
 						      nc->skb_cache);
 		if (unlikely(!nc->skb_count))
 			return NULL;
+	} else {
+		nc->stats.hit++;
 	}
 
 	skb = nc->skb_cache[--nc->skb_count];
@@ -709,6 +744,108 @@ skb_fail:
 }
 EXPORT_SYMBOL(__napi_alloc_skb);
 
+/* Make sure the per-CPU head cache holds at least @n skbs (capped at the
+ * cache size), so that a burst of allocations costs a single trip to slab.
+ */
+static void napi_skb_cache_prefill(struct napi_alloc_cache *nc, unsigned int n)
+{
+	unsigned int want;
+
+	n = min_t(unsigned int, n, NAPI_SKB_CACHE_SIZE);
+	if (nc->skb_count >= n)
+		return;
+
+	want = max_t(unsigned int, n - nc->skb_count, NAPI_SKB_CACHE_BULK);
+	want = min_t(unsigned int, want, NAPI_SKB_CACHE_SIZE - nc->skb_count);
+
+	nc->stats.miss++;
+	nc->skb_count += kmem_cache_alloc_bulk(skbuff_head_cache, GFP_ATOMIC,
+					       want,
+					       nc->skb_cache + nc->skb_count);
+}
+
+/**
+ *	netdev_alloc_skb_bulk - allocate a batch of rx skbuffs
+ *	@dev: network device to receive on, may be %NULL
+ *	@len: length to allocate for each buffer
+ *	@gfp_mask: get_free_pages mask
+ *	@skbs: array receiving the new buffers
+ *	@n: number of buffers wanted
+ *
+ *	Allocate up to @n buffers the way __netdev_alloc_skb() would, with
+ *	NET_SKB_PAD of headroom, for drivers that refill a whole ring of
+ *	URBs or SDIO receive buffers at once.  The sk_buff heads come from
+ *	the per-CPU NAPI cache, topped up with one bulk slab allocation, and
+ *	the data areas are carved from the NAPI page fragment cache.  BH is
+ *	disabled only once for the whole batch, so this may be called from
+ *	process context too.
+ *
+ *	Returns the number of buffers stored in @skbs, which is less than
+ *	@n only when memory ran out.
+ */
+int netdev_alloc_skb_bulk(struct net_device *dev, unsigned int len,
+			  gfp_t gfp_mask, struct sk_buff **skbs, int n)
+{
+	struct napi_alloc_cache *nc;
+	unsigned int fragsz;
+	struct sk_buff *skb;
+	int i = 0;
+	void *data;
+
+	len += NET_SKB_PAD;
+	fragsz = SKB_HEAD_ALIGN(len);
+
+	/* Same limits as __napi_alloc_skb(): sizes the page fragment cache
+	 * does not serve well and DMA zone requests go through kmalloc.
+	 */
+	if (len <= SKB_WITH_OVERHEAD(1024) ||
+	    len > SKB_WITH_OVERHEAD(PAGE_SIZE) || (gfp_mask & GFP_DMA))
+		goto slow;
+
+	local_bh_disable();
+	nc = this_cpu_ptr(&napi_alloc_cache);
+	napi_skb_cache_prefill(nc, n);
+
+	if (sk_memalloc_socks())
+		gfp_mask |= __GFP_MEMALLOC;
+
+	for (; i < n; i++) {
+		/* the fragment cache is refilled atomically, callers that
+		 * may sleep get another chance below
+		 */
+		data = page_frag_alloc(&nc->page, fragsz,
+				       gfp_mask & ~__GFP_DIRECT_RECLAIM);
+		if (unlikely(!data))
+			break;
+
+		skb = __napi_build_skb(data, fragsz);
+		if (unlikely(!skb)) {
+			skb_free_frag(data);
+			break;
+		}
+
+		if (nc->page.pfmemalloc)
+			skb->pfmemalloc = 1;
+		skb->head_frag = 1;
+
+		skb_reserve(skb, NET_SKB_PAD);
+		skb->dev = dev;
+		skbs[i] = skb;
+	}
+	local_bh_enable();
+
+	len -= NET_SKB_PAD;
+slow:
+	for (; i < n; i++) {
+		skbs[i] = __netdev_alloc_skb(dev, len, gfp_mask);
+		if (unlikely(!skbs[i]))
+			break;
+	}
+
+	return i;
+}
+EXPORT_SYMBOL(netdev_alloc_skb_bulk);
+
 void skb_add_rx_frag(struct sk_buff *skb, int i, struct page *page, int off,
 		     int size, unsigned int truesize)
 {
@@ -878,8 +1015,8 @@ EXPORT_SYMBOL(__kfree_skb);
  *	@reason: reason why this skb is dropped
  *
  *	Drop a reference to the buffer and free it if the usage count has
- *	hit zero. Meanwhile, pass the drop reason to 'kfree_skb'
- *	tracepoint.
+ *	hit zero. Meanwhile, count the drop reason (see /proc/net/drop_reasons)
+ *	and pass it to 'kfree_skb' tracepoint.
  */
 void __fix_address
 kfree_skb_reason(struct sk_buff *skb, enum skb_drop_reason reason)
@@ -889,6 +1026,7 @@ kfree_skb_reason(struct sk_buff *skb, enum skb_drop_reason reason)
 
 	DEBUG_NET_WARN_ON_ONCE(reason <= 0 || reason >= SKB_DROP_REASON_MAX);
 
+	skb_drop_stats_inc(reason);
 	trace_kfree_skb(skb, __builtin_return_address(0), reason);
 	__kfree_skb(skb);
 }
@@ -1058,8 +1196,10 @@ static void napi_skb_cache_put(struct sk_buff *skb)
 
 	kasan_poison_object_data(skbuff_head_cache, skb);
 	nc->skb_cache[nc->skb_count++] = skb;
+	nc->stats.recycle++;
 
 	if (unlikely(nc->skb_count == NAPI_SKB_CACHE_SIZE)) {
+		nc->stats.flush++;
 		for (i = NAPI_SKB_CACHE_HALF; i < NAPI_SKB_CACHE_SIZE; i++)
 			kasan_unpoison_object_data(skbuff_head_cache,
 						   nc->skb_cache[i]);
@@ -1115,6 +1255,43 @@ void napi_consume_skb(struct sk_buff *skb, int budget)
 }
 EXPORT_SYMBOL(napi_consume_skb);
 
+/**
+ *	napi_consume_skb_bulk - consume a batch of completed tx skbuffs
+ *	@skbs: buffers to release
+ *	@n: number of buffers in @skbs
+ *	@budget: NAPI budget, zero when not called from a NAPI poll
+ *
+ *	Bulk variant of napi_consume_skb() for TX completion paths that
+ *	gather finished frames first, e.g. from URB or SDIO confirmations
+ *	handled in a tasklet or kthread.  The heads are recycled into the
+ *	per-CPU NAPI cache with BH disabled once for the whole batch.  From
+ *	hard interrupt context, or with interrupts off, the buffers are
+ *	released through dev_consume_skb_any() instead.
+ */
+void napi_consume_skb_bulk(struct sk_buff **skbs, unsigned int n, int budget)
+{
+	unsigned int i;
+
+	if (unlikely(!budget && (in_hardirq() || irqs_disabled()))) {
+		for (i = 0; i < n; i++)
+			dev_consume_skb_any(skbs[i]);
+		return;
+	}
+
+	local_bh_disable();
+	for (i = 0; i < n; i++)
+		napi_consume_skb(skbs[i], 1);
+	local_bh_enable();
+}
+EXPORT_SYMBOL(napi_consume_skb_bulk);
+
+#ifdef CONFIG_PROC_FS
+void napi_skb_cache_stats(int cpu, struct napi_skb_cache_stats *stats)
+{
+	*stats = per_cpu_ptr(&napi_alloc_cache, cpu)->stats;
+}
+#endif
+
 /* Make sure a field is contained by headers group */
 #define CHECK_SKB_FIELD(field) \
 	BUILD_BUG_ON(offsetof(struct sk_buff, field) !=		\
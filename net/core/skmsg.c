@@ -637,6 +637,80 @@ static void sk_psock_skb_state(struct sk_psock *psock,
 	spin_unlock_bh(&psock->ingress_lock);
 }
 
+/* Back-pressure for skb redirects.
+ *
+ * A psock that redirects into another psock whose backlog already holds
+ * more than a send buffer worth of data is throttled: it stops reading
+ * its own receive queue, so the peer's TCP window closes instead of the
+ * target's ingress_skb growing without bound when, e.g., the uplink of a
+ * socket-to-socket proxy is slower than the LAN side.  The target resumes
+ * its throttled sources from its backlog worker once half of that limit
+ * has drained, or when it goes away.
+ *
+ * The egress socket may carry kTLS: sockets are added to the map first
+ * and the "tls" ULP configured afterwards, redirected data then goes out
+ * through the TLS sendmsg/sendpage path.
+ */
+static DEFINE_SPINLOCK(sk_psock_throttle_lock);
+
+static u32 sk_psock_backlog_limit(const struct sk_psock *psock)
+{
+	return max_t(u32, READ_ONCE(psock->sk->sk_sndbuf), SOCK_MIN_SNDBUF);
+}
+
+static void sk_psock_throttle(struct sk_psock *from, struct sk_psock *to)
+{
+	spin_lock_bh(&sk_psock_throttle_lock);
+	/* Recheck under the lock, the target may have drained since */
+	if (list_empty(&from->throttle_node) &&
+	    sk_psock_test_state(to, SK_PSOCK_TX_ENABLED) &&
+	    atomic_read(&to->backlog_bytes) > sk_psock_backlog_limit(to) / 2) {
+		sk_psock_set_state(from, SK_PSOCK_RX_THROTTLED);
+		list_add_tail(&from->throttle_node, &to->throttled);
+	}
+	spin_unlock_bh(&sk_psock_throttle_lock);
+}
+
+static bool sk_psock_rx_throttled(struct sock *sk)
+{
+	struct sk_psock *psock;
+	bool ret;
+
+	rcu_read_lock();
+	psock = sk_psock(sk);
+	ret = psock && sk_psock_test_state(psock, SK_PSOCK_RX_THROTTLED);
+	rcu_read_unlock();
+	return ret;
+}
+
+/* Resume all sources throttled on @psock, process context only */
+static void sk_psock_unthrottle(struct sk_psock *psock)
+{
+	struct sk_psock *src;
+	struct sock *sk;
+
+	for (;;) {
+		spin_lock_bh(&sk_psock_throttle_lock);
+		src = list_first_entry_or_null(&psock->throttled,
+					       struct sk_psock, throttle_node);
+		if (!src) {
+			spin_unlock_bh(&sk_psock_throttle_lock);
+			break;
+		}
+		list_del_init(&src->throttle_node);
+		sk_psock_clear_state(src, SK_PSOCK_RX_THROTTLED);
+		sk = src->sk;
+		sock_hold(sk);
+		spin_unlock_bh(&sk_psock_throttle_lock);
+
+		/* pick up what was left in the receive queue */
+		lock_sock(sk);
+		sk->sk_data_ready(sk);
+		release_sock(sk);
+		sock_put(sk);
+	}
+}
+
 static void sk_psock_backlog(struct work_struct *work)
 {
 	struct delayed_work *dwork = to_delayed_work(work);
@@ -690,10 +764,15 @@ static void sk_psock_backlog(struct work_struct *work)
 		} while (len);
 
 		skb = skb_dequeue(&psock->ingress_skb);
+		atomic_sub(skb->len, &psock->backlog_bytes);
 		kfree_skb(skb);
 	}
 end:
 	mutex_unlock(&psock->work_mutex);
+
+	if (!list_empty_careful(&psock->throttled) &&
+	    atomic_read(&psock->backlog_bytes) <= sk_psock_backlog_limit(psock) / 2)
+		sk_psock_unthrottle(psock);
 }
 
 struct sk_psock *sk_psock_init(struct sock *sk, int node)
@@ -736,6 +815,8 @@ struct sk_psock *sk_psock_init(struct sock *sk, int node)
 	INIT_LIST_HEAD(&psock->ingress_msg);
 	spin_lock_init(&psock->ingress_lock);
 	skb_queue_head_init(&psock->ingress_skb);
+	INIT_LIST_HEAD(&psock->throttled);
+	INIT_LIST_HEAD(&psock->throttle_node);
 
 	sk_psock_set_state(psock, SK_PSOCK_TX_ENABLED);
 	refcount_set(&psock->refcnt, 1);
@@ -780,6 +861,7 @@ static void __sk_psock_zap_ingress(struct sk_psock *psock)
 	struct sk_buff *skb;
 
 	while ((skb = skb_dequeue(&psock->ingress_skb)) != NULL) {
+		atomic_sub(skb->len, &psock->backlog_bytes);
 		skb_bpf_redirect_clear(skb);
 		sock_drop(psock->sk, skb);
 	}
@@ -818,6 +900,12 @@ static void sk_psock_destroy(struct work_struct *work)
 	__sk_psock_zap_ingress(psock);
 	mutex_destroy(&psock->work_mutex);
 
+	/* neither wait on a target any longer, nor keep sources waiting */
+	spin_lock_bh(&sk_psock_throttle_lock);
+	list_del_init(&psock->throttle_node);
+	spin_unlock_bh(&sk_psock_throttle_lock);
+	sk_psock_unthrottle(psock);
+
 	psock_progs_drop(&psock->progs);
 
 	sk_psock_link_destroy(psock);
@@ -903,6 +991,7 @@ static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 {
 	struct sk_psock *psock_other;
 	struct sock *sk_other;
+	bool congested;
 
 	sk_other = skb_bpf_redirect_fetch(skb);
 	/* This error is a buggy BPF program, it returned a redirect
@@ -932,8 +1021,13 @@ static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 	}
 
 	skb_queue_tail(&psock_other->ingress_skb, skb);
+	congested = atomic_add_return(skb->len, &psock_other->backlog_bytes) >
+		    sk_psock_backlog_limit(psock_other);
 	schedule_delayed_work(&psock_other->work, 0);
 	spin_unlock_bh(&psock_other->ingress_lock);
+
+	if (congested && psock_other != from)
+		sk_psock_throttle(from, psock_other);
 	return 0;
 }
 
@@ -1010,6 +1104,7 @@ static int sk_psock_verdict_apply(struct sk_psock *psock, struct sk_buff *skb,
 			spin_lock_bh(&psock->ingress_lock);
 			if (sk_psock_test_state(psock, SK_PSOCK_TX_ENABLED)) {
 				skb_queue_tail(&psock->ingress_skb, skb);
+				atomic_add(skb->len, &psock->backlog_bytes);
 				schedule_delayed_work(&psock->work, 0);
 				err = 0;
 			}
@@ -1110,7 +1205,9 @@ static void sk_psock_strp_data_ready(struct sock *sk)
 	rcu_read_lock();
 	psock = sk_psock(sk);
 	if (likely(psock)) {
-		if (tls_sw_has_ctx_rx(sk)) {
+		if (sk_psock_test_state(psock, SK_PSOCK_RX_THROTTLED)) {
+			/* resumed by sk_psock_unthrottle() */
+		} else if (tls_sw_has_ctx_rx(sk)) {
 			psock->saved_data_ready(sk);
 		} else {
 			write_lock_bh(&sk->sk_callback_lock);
@@ -1211,6 +1308,9 @@ static void sk_psock_verdict_data_ready(struct sock *sk)
 
 	if (unlikely(!sock || !sock->ops || !sock->ops->read_skb))
 		return;
+	/* leave the data queued, the peer's window does the pushing back */
+	if (sk_psock_rx_throttled(sk))
+		return;
 	copied = sock->ops->read_skb(sk, sk_psock_verdict_recv);
 	if (copied >= 0) {
 		struct sk_psock *psock;
@@ -544,6 +544,15 @@ static struct ctl_table net_core_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= SYSCTL_ZERO,
 	},
+	{
+		.procname	= "link_watch_urgent_down",
+		.data		= &sysctl_link_watch_urgent_down,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{
 		.procname	= "fb_tunnels_only_for_init_net",
 		.data		= &sysctl_fb_tunnels_only_for_init_net,
@@ -569,6 +578,13 @@ static struct ctl_table net_core_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_do_static_key,
 	},
+	{
+		.procname	= "dev_drop_stats",
+		.data		= &netdev_drop_stats_key.key,
+		.maxlen		= sizeof(netdev_drop_stats_key),
+		.mode		= 0644,
+		.proc_handler	= proc_do_static_key,
+	},
 	{
 		.procname	= "gro_normal_batch",
 		.data		= &gro_normal_batch,
@@ -206,6 +206,16 @@ int inet_listen(struct socket *sock, int backlog)
 	if (!((1 << old_state) & (TCPF_CLOSE | TCPF_LISTEN)))
 		goto out;
 
+	/*
+	 * Applications written for small servers often pass a backlog of
+	 * a few dozen. When many clients reconnect at once the accept
+	 * queue fills, further SYNs are dropped and the clients back off
+	 * for seconds. Let the admin raise such backlogs system wide.
+	 */
+	backlog = max(backlog, READ_ONCE(sysctl_tcp_listen_backlog_min));
+	backlog = min_t(int, backlog,
+			READ_ONCE(sock_net(sk)->core.sysctl_somaxconn));
+
 	WRITE_ONCE(sk->sk_max_ack_backlog, backlog);
 	/* Really, if the socket is already in listen state
 	 * we can only allow the backlog to be adjusted.
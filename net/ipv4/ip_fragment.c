@@ -57,6 +57,11 @@
  */
 static const char ip_frag_cache_name[] = "ip4-frags";
 
+/* A single source may hold at most this fraction of ipfrag_high_thresh, so
+ * one noisy sender cannot starve queues from everybody else.
+ */
+#define IPFRAG_SRC_QUOTA_SHIFT	2
+
 /* Describe an entry in the "incomplete datagrams" queue. */
 struct ipq {
 	struct inet_frag_queue q;
@@ -65,6 +70,7 @@ struct ipq {
 	u16		max_df_size; /* largest frag with DF set seen */
 	int             iif;
 	unsigned int    rid;
+	unsigned int	peer_mem; /* truesize charged to peer->frag_mem */
 	struct inet_peer *peer;
 };
 
@@ -88,6 +94,7 @@ static void ip4_frag_init(struct inet_frag_queue *q, const void *a)
 
 	q->key.v4 = *key;
 	qp->ecn = 0;
+	qp->peer_mem = 0;
 	qp->peer = q->fqdir->max_dist ?
 		inet_getpeer_v4(net->ipv4.peers, key->saddr, key->vif, 1) :
 		NULL;
@@ -98,8 +105,39 @@ static void ip4_frag_free(struct inet_frag_queue *q)
 	struct ipq *qp;
 
 	qp = container_of(q, struct ipq, q);
-	if (qp->peer)
+	if (qp->peer) {
+		atomic_sub(qp->peer_mem, &qp->peer->frag_mem);
 		inet_putpeer(qp->peer);
+	}
+}
+
+/* Charge @truesize to the source of @qp, false if that exceeds its quota */
+static bool ip_frag_peer_charge(struct ipq *qp, unsigned int truesize)
+{
+	struct inet_peer *peer = qp->peer;
+	long quota = READ_ONCE(qp->q.fqdir->high_thresh) >>
+		     IPFRAG_SRC_QUOTA_SHIFT;
+
+	if (!peer)
+		return true;
+
+	if (atomic_add_return(truesize, &peer->frag_mem) > quota) {
+		atomic_sub(truesize, &peer->frag_mem);
+		return false;
+	}
+
+	qp->peer_mem += truesize;
+	return true;
+}
+
+static void ip_frag_peer_uncharge(struct ipq *qp, unsigned int truesize)
+{
+	if (!qp->peer)
+		return;
+
+	truesize = min(truesize, qp->peer_mem);
+	atomic_sub(truesize, &qp->peer->frag_mem);
+	qp->peer_mem -= truesize;
 }
 
 
@@ -256,6 +294,7 @@ static int ip_frag_reinit(struct ipq *qp)
 
 	sum_truesize = inet_frag_rbtree_purge(&qp->q.rb_fragments);
 	sub_frag_mem_limit(qp->q.fqdir, sum_truesize);
+	ip_frag_peer_uncharge(qp, sum_truesize);
 
 	qp->q.flags = 0;
 	qp->q.len = 0;
@@ -335,6 +374,9 @@ static int ip_frag_queue(struct ipq *qp, struct sk_buff *skb)
 	if (err)
 		goto discard_qp;
 
+	if (!ip_frag_peer_charge(qp, skb->truesize))
+		goto quota_drop;
+
 	/* Note : skb->rbnode and skb->dev share the same location. */
 	dev = skb->dev;
 	/* Makes sure compiler wont do silly aliasing games */
@@ -380,8 +422,16 @@ static int ip_frag_queue(struct ipq *qp, struct sk_buff *skb)
 	skb_dst_drop(skb);
 	return -EINPROGRESS;
 
+quota_drop:
+	/* The source is over its share, the queue itself is fine */
+	__NET_INC_STATS(net, LINUX_MIB_IPREASMQUOTADROPS);
+	kfree_skb(skb);
+	return -ENOMEM;
+
 insert_error:
+	ip_frag_peer_uncharge(qp, skb->truesize);
 	if (err == IPFRAG_DUP) {
+		__NET_INC_STATS(net, LINUX_MIB_IPREASMDUPS);
 		kfree_skb(skb);
 		return -EINVAL;
 	}
@@ -496,6 +546,7 @@ int ip_defrag(struct net *net, struct sk_buff *skb, u32 user)
 		return ret;
 	}
 
+	__NET_INC_STATS(net, LINUX_MIB_IPREASMNOQUEUE);
 	__IP_INC_STATS(net, IPSTATS_MIB_REASMFAILS);
 	kfree_skb(skb);
 	return -ENOMEM;
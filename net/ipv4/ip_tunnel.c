@@ -744,14 +744,19 @@ void ip_tunnel_xmit(struct sk_buff *skb, struct net_device *dev,
 
 	tos = tnl_params->tos;
 	if (tos & 0x1) {
-		tos &= ~0x1;
-		if (payload_protocol == htons(ETH_P_IP)) {
+		u8 base_tos = tos & ~0x1;
+
+		tos = base_tos;
+		if (payload_protocol == htons(ETH_P_IP))
 			tos = inner_iph->tos;
-			connected = false;
-		} else if (payload_protocol == htons(ETH_P_IPV6)) {
+		else if (payload_protocol == htons(ETH_P_IPV6))
 			tos = ipv6_get_dsfield((const struct ipv6hdr *)inner_iph);
+
+		/* The route only depends on RT_TOS(), so packets that map to
+		 * the configured tos can still use the cached route.
+		 */
+		if (RT_TOS(tos) != RT_TOS(base_tos))
 			connected = false;
-		}
 	}
 
 	ip_tunnel_init_flow(&fl4, protocol, dst, tnl_params->saddr,
@@ -297,6 +297,9 @@ static const struct snmp_mib snmp4_net_list[] = {
 	SNMP_MIB_ITEM("TCPDSACKIgnoredDubious", LINUX_MIB_TCPDSACKIGNOREDDUBIOUS),
 	SNMP_MIB_ITEM("TCPMigrateReqSuccess", LINUX_MIB_TCPMIGRATEREQSUCCESS),
 	SNMP_MIB_ITEM("TCPMigrateReqFailure", LINUX_MIB_TCPMIGRATEREQFAILURE),
+	SNMP_MIB_ITEM("IPReasmNoQueue", LINUX_MIB_IPREASMNOQUEUE),
+	SNMP_MIB_ITEM("IPReasmDups", LINUX_MIB_IPREASMDUPS),
+	SNMP_MIB_ITEM("IPReasmQuotaDrops", LINUX_MIB_IPREASMQUOTADROPS),
 	SNMP_MIB_SENTINEL
 };
 
@@ -122,6 +122,7 @@ static int ip_rt_error_cost __read_mostly	= HZ;
 static int ip_rt_error_burst __read_mostly	= 5 * HZ;
 
 static int ip_rt_gc_timeout __read_mostly	= RT_GC_TIMEOUT;
+static int ip_rt_input_cache __read_mostly;
 
 /*
  *	Interface to generic destination cache.
@@ -269,15 +270,15 @@ static int rt_cpu_seq_show(struct seq_file *seq, void *v)
 	struct rt_cache_stat *st = v;
 
 	if (v == SEQ_START_TOKEN) {
-		seq_puts(seq, "entries  in_hit   in_slow_tot in_slow_mc in_no_route in_brd   in_martian_dst in_martian_src out_hit  out_slow_tot out_slow_mc gc_total gc_ignored gc_goal_miss gc_dst_overflow in_hlist_search out_hlist_search\n");
+		seq_puts(seq, "entries  in_hit   in_slow_tot in_slow_mc in_no_route in_brd   in_martian_dst in_martian_src out_hit  out_slow_tot out_slow_mc gc_total gc_ignored gc_goal_miss gc_dst_overflow in_hlist_search out_hlist_search in_cache_miss\n");
 		return 0;
 	}
 
 	seq_printf(seq, "%08x %08x %08x    %08x   %08x    %08x %08x       "
 			"%08x       %08x %08x     %08x    %08x %08x   "
-			"%08x     %08x        %08x        %08x\n",
+			"%08x     %08x        %08x        %08x         %08x\n",
 		   dst_entries_get_slow(&ipv4_dst_ops),
-		   0, /* st->in_hit */
+		   st->in_hit,
 		   st->in_slow_tot,
 		   st->in_slow_mc,
 		   st->in_no_route,
@@ -294,7 +295,8 @@ static int rt_cpu_seq_show(struct seq_file *seq, void *v)
 		   0, /* st->gc_goal_miss */
 		   0, /* st->gc_dst_overflow */
 		   0, /* st->in_hlist_search */
-		   0  /* st->out_hlist_search */
+		   0, /* st->out_hlist_search */
+		   st->in_cache_miss
 		);
 	return 0;
 }
@@ -1789,6 +1791,103 @@ static void ip_handle_martian_source(struct net_device *dev,
 }
 
 /* called in rcu_read_lock() section */
+/* Optional per-cpu cache of the last forwarding route, keyed on ingress
+ * device, destination and TOS, to skip fib_lookup() on a gateway that
+ * keeps forwarding the same flows. Only used without policy routing
+ * rules, so that the result can't depend on anything but the key, and
+ * never for multipath routes. The source address is still validated on
+ * every hit. The cached route holds a reference, it is dropped as soon
+ * as a lookup finds it stale: rt_cache_flush() takes care of invalidation
+ * through the genid, like for the nexthop caches.
+ */
+struct rt_input_cache {
+	struct rtable	*rt;
+	__be32		daddr;
+	int		iif;
+	int		oif;
+	u8		tos;
+};
+
+static DEFINE_PER_CPU(struct rt_input_cache, rt_input_cache);
+
+static bool rt_input_cache_usable(const struct sk_buff *skb,
+				  const struct net_device *dev)
+{
+	/* per-cpu data, BHs need to be off */
+	return READ_ONCE(ip_rt_input_cache) && in_softirq() &&
+	       skb->protocol == htons(ETH_P_IP) &&
+	       !fib4_has_custom_rules(dev_net(dev));
+}
+
+static void rt_input_cache_store(struct sk_buff *skb, struct rtable *rt,
+				 struct in_device *in_dev,
+				 struct in_device *out_dev,
+				 __be32 daddr, u8 tos, int oif)
+{
+	struct rt_input_cache *c;
+
+	if (!rt_input_cache_usable(skb, in_dev->dev) || out_dev == in_dev ||
+	    IPCB(skb)->flags & (IPSKB_MULTIPATH | IPSKB_DOREDIRECT))
+		return;
+
+	c = this_cpu_ptr(&rt_input_cache);
+	if (c->rt == rt)
+		return;
+
+	if (!dst_hold_safe(&rt->dst))
+		return;
+
+	if (c->rt)
+		dst_release(&c->rt->dst);
+
+	c->rt = rt;
+	c->daddr = daddr;
+	c->iif = in_dev->dev->ifindex;
+	c->oif = oif;
+	c->tos = tos;
+}
+
+static bool rt_input_cache_lookup(struct sk_buff *skb, __be32 daddr,
+				  __be32 saddr, u8 tos, struct net_device *dev,
+				  struct in_device *in_dev)
+{
+	struct rt_input_cache *c;
+	struct rtable *rt;
+	u32 itag = 0;
+
+	if (!rt_input_cache_usable(skb, dev))
+		return false;
+
+	c = this_cpu_ptr(&rt_input_cache);
+	rt = c->rt;
+	if (!rt || c->daddr != daddr || c->iif != dev->ifindex ||
+	    c->tos != tos)
+		goto miss;
+
+	if (!rt_cache_valid(rt) ||
+	    !net_eq(dev_net(rt->dst.dev), dev_net(dev))) {
+		c->rt = NULL;
+		dst_release(&rt->dst);
+		goto miss;
+	}
+
+	/* Let the slow path deal with martians and classid tags */
+	if (fib_validate_source(skb, saddr, daddr, tos, c->oif, dev, in_dev,
+				&itag) < 0 || itag)
+		goto miss;
+
+	if (IN_DEV_ORCONF(in_dev, NOPOLICY))
+		IPCB(skb)->flags |= IPSKB_NOPOLICY;
+
+	skb_dst_set_noref(skb, &rt->dst);
+	RT_CACHE_STAT_INC(in_hit);
+	return true;
+
+miss:
+	RT_CACHE_STAT_INC(in_cache_miss);
+	return false;
+}
+
 static int __mkroute_input(struct sk_buff *skb,
 			   const struct fib_result *res,
 			   struct in_device *in_dev,
@@ -1856,6 +1955,8 @@ static int __mkroute_input(struct sk_buff *skb,
 			rth = rcu_dereference(nhc->nhc_rth_input);
 		if (rt_cache_valid(rth)) {
 			skb_dst_set_noref(skb, &rth->dst);
+			rt_input_cache_store(skb, rth, in_dev, out_dev, daddr,
+					     tos, FIB_RES_OIF(*res));
 			goto out;
 		}
 	}
@@ -2145,7 +2246,20 @@ static int ip_mkroute_input(struct sk_buff *skb,
 {
 #ifdef CONFIG_IP_ROUTE_MULTIPATH
 	if (res->fi && fib_info_num_path(res->fi) > 1) {
-		int h = fib_multipath_hash(res->fi->fib_net, NULL, skb, hkeys);
+		struct net *net = res->fi->fib_net;
+		int h;
+
+		/*
+		 * With the L4 policy, dissect through skb_get_hash() so the
+		 * result is cached in the skb: fib_multipath_hash() then
+		 * uses it directly, and so do RPS/XPS and the qdiscs on the
+		 * way out, instead of each dissecting the packet again.
+		 */
+		if (!hkeys &&
+		    READ_ONCE(net->ipv4.sysctl_fib_multipath_hash_policy) == 1)
+			skb_get_hash(skb);
+
+		h = fib_multipath_hash(net, NULL, skb, hkeys);
 
 		fib_select_multipath(res, h);
 		IPCB(skb)->flags |= IPSKB_MULTIPATH;
@@ -2281,6 +2395,12 @@ static int ip_route_input_slow(struct sk_buff *skb, __be32 daddr, __be32 saddr,
 			goto martian_source;
 	}
 
+	if (IN_DEV_FORWARD(in_dev) &&
+	    rt_input_cache_lookup(skb, daddr, saddr, tos, dev, in_dev)) {
+		err = 0;
+		goto out;
+	}
+
 	/*
 	 *	Now we are ready to route packet.
 	 */
@@ -3561,6 +3681,15 @@ static struct ctl_table ipv4_route_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "input_cache",
+		.data		= &ip_rt_input_cache,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{ }
 };
 
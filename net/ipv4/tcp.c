@@ -292,6 +292,9 @@ EXPORT_PER_CPU_SYMBOL_GPL(tcp_orphan_count);
 long sysctl_tcp_mem[3] __read_mostly;
 EXPORT_SYMBOL(sysctl_tcp_mem);
 
+/* Floor for listen() backlogs, still capped by net.core.somaxconn */
+int sysctl_tcp_listen_backlog_min __read_mostly;
+
 atomic_long_t tcp_memory_allocated ____cacheline_aligned_in_smp;	/* Current allocated memory. */
 EXPORT_SYMBOL(tcp_memory_allocated);
 DEFINE_PER_CPU(int, tcp_memory_per_cpu_fw_alloc);
@@ -3180,6 +3183,7 @@ int tcp_disconnect(struct sock *sk, int flags)
 	dst_release(xchg((__force struct dst_entry **)&sk->sk_rx_dst, NULL));
 	tcp_saved_syn_free(tp);
 	tp->compressed_ack = 0;
+	tp->acks_compressed = 0;
 	tp->segs_in = 0;
 	tp->segs_out = 0;
 	tp->bytes_sent = 0;
@@ -3978,6 +3982,7 @@ void tcp_get_info(struct sock *sk, struct tcp_info *info)
 	info->tcpi_reord_seen = tp->reord_seen;
 	info->tcpi_rcv_ooopack = tp->rcv_ooopack;
 	info->tcpi_snd_wnd = tp->snd_wnd;
+	info->tcpi_acks_compressed = tp->acks_compressed;
 	info->tcpi_fastopen_client_fail = tp->fastopen_client_fail;
 	unlock_sock_fast(sk, slow);
 }
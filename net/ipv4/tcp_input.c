@@ -4568,6 +4568,7 @@ void tcp_sack_compress_send_ack(struct sock *sk)
 	 */
 	NET_ADD_STATS(sock_net(sk), LINUX_MIB_TCPACKCOMPRESSED,
 		      tp->compressed_ack - 1);
+	tp->acks_compressed += tp->compressed_ack - 1;
 
 	tp->compressed_ack = 0;
 	tcp_send_ack(sk);
@@ -5522,6 +5523,37 @@ static inline void tcp_data_snd_check(struct sock *sk)
 	tcp_check_space(sk);
 }
 
+/* LAN ACK compression, off while tcp_lan_ack_delay_ns is 0. On connections
+ * with an srtt under tcp_lan_ack_rtt_us, hold back an ACK that would be sent
+ * right away, for up to tcp_lan_ack_delay_ns or tcp_lan_ack_nr segments.
+ * The ACK goes out from the compressed ACK timer, or piggybacked on whatever
+ * we send before it fires.
+ */
+static bool tcp_lan_ack_compress(struct sock *sk)
+{
+	struct net *net = sock_net(sk);
+	unsigned long delay = READ_ONCE(net->ipv4.sysctl_tcp_lan_ack_delay_ns);
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (!delay ||
+	    inet_csk(sk)->icsk_ack.pending & ICSK_ACK_NOW ||
+	    !RB_EMPTY_ROOT(&tp->out_of_order_queue) ||
+	    !tp->srtt_us ||
+	    (tp->srtt_us >> 3) > READ_ONCE(net->ipv4.sysctl_tcp_lan_ack_rtt_us) ||
+	    tp->compressed_ack >= READ_ONCE(net->ipv4.sysctl_tcp_lan_ack_nr))
+		return false;
+
+	tp->compressed_ack++;
+	if (hrtimer_is_queued(&tp->compressed_ack_timer))
+		return true;
+
+	sock_hold(sk);
+	hrtimer_start_range_ns(&tp->compressed_ack_timer, ns_to_ktime(delay),
+			       READ_ONCE(net->ipv4.sysctl_tcp_comp_sack_slack_ns),
+			       HRTIMER_MODE_REL_PINNED_SOFT);
+	return true;
+}
+
 /*
  * Check if sending an ack is needed.
  */
@@ -5543,6 +5575,8 @@ static void __tcp_ack_snd_check(struct sock *sk, int ofo_possible)
 	    tcp_in_quickack_mode(sk) ||
 	    /* Protocol state mandates a one-time immediate ACK */
 	    inet_csk(sk)->icsk_ack.pending & ICSK_ACK_NOW) {
+		if (tcp_lan_ack_compress(sk))
+			return;
 send_now:
 		tcp_send_ack(sk);
 		return;
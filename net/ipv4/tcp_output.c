@@ -184,6 +184,7 @@ static inline void tcp_event_ack_sent(struct sock *sk, u32 rcv_nxt)
 	if (unlikely(tp->compressed_ack)) {
 		NET_ADD_STATS(sock_net(sk), LINUX_MIB_TCPACKCOMPRESSED,
 			      tp->compressed_ack);
+		tp->acks_compressed += tp->compressed_ack;
 		tp->compressed_ack = 0;
 		if (hrtimer_try_to_cancel(&tp->compressed_ack_timer) == 1)
 			__sock_put(sk);
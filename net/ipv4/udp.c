@@ -1584,6 +1584,79 @@ drop:
 }
 EXPORT_SYMBOL_GPL(__udp_enqueue_schedule_skb);
 
+/* Batched variant of __udp_enqueue_schedule_skb() for the segments of a
+ * GRO'd datagram list: a single rmem charge, forward allocation, queue
+ * lock round and reader wakeup for the whole batch.  Segments that do
+ * not fit are left on @batch for the caller to drop, with the error to
+ * account them with returned.
+ */
+int __udp_enqueue_schedule_list(struct sock *sk, struct sk_buff_head *batch)
+{
+	struct sk_buff_head *list = &sk->sk_receive_queue;
+	int rmem, delta, amt, err = -ENOMEM;
+	struct sk_buff_head queue;
+	spinlock_t *busy = NULL;
+	struct sk_buff *skb;
+	int size = 0;
+
+	rmem = atomic_read(&sk->sk_rmem_alloc);
+	if (rmem > (sk->sk_rcvbuf >> 1))
+		busy = busylock_acquire(sk);
+
+	/* same limit as the single skb path: always allow at least a
+	 * packet past a receive queue that was not full yet
+	 */
+	__skb_queue_head_init(&queue);
+	while ((skb = skb_peek(batch)) != NULL && rmem + size <= sk->sk_rcvbuf) {
+		__skb_unlink(skb, batch);
+		if (busy)
+			skb_condense(skb);
+		udp_set_dev_scratch(skb);
+		size += skb->truesize;
+		__skb_queue_tail(&queue, skb);
+	}
+	if (!size)
+		goto out;
+
+	rmem = atomic_add_return(size, &sk->sk_rmem_alloc);
+	if (rmem > (size + (unsigned int)sk->sk_rcvbuf))
+		goto uncharge;
+
+	spin_lock(&list->lock);
+	if (size >= sk->sk_forward_alloc) {
+		amt = sk_mem_pages(size);
+		delta = amt << PAGE_SHIFT;
+		if (!__sk_mem_raise_allocated(sk, delta, amt, SK_MEM_RECV)) {
+			err = -ENOBUFS;
+			spin_unlock(&list->lock);
+			goto uncharge;
+		}
+
+		sk->sk_forward_alloc += delta;
+	}
+
+	sk_forward_alloc_add(sk, -size);
+
+	skb_queue_walk(&queue, skb)
+		sock_skb_set_dropcount(sk, skb);
+	skb_queue_splice_tail(&queue, list);
+	spin_unlock(&list->lock);
+
+	if (!sock_flag(sk, SOCK_DEAD))
+		sk->sk_data_ready(sk);
+
+	err = skb_queue_empty(batch) ? 0 : -ENOMEM;
+	goto out;
+
+uncharge:
+	atomic_sub(size, &sk->sk_rmem_alloc);
+	skb_queue_splice(&queue, batch);
+out:
+	busylock_release(busy);
+	return err;
+}
+EXPORT_SYMBOL_GPL(__udp_enqueue_schedule_list);
+
 void udp_destruct_common(struct sock *sk)
 {
 	/* reclaim completely the forward allocated memory */
@@ -2055,7 +2128,31 @@ void udp_v4_rehash(struct sock *sk)
 	udp_lib_rehash(sk, new_hash);
 }
 
-static int __udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+static void udp_queue_rcv_drop(struct sock *sk, struct sk_buff *skb, int rc)
+{
+	int is_udplite = IS_UDPLITE(sk);
+	int drop_reason;
+
+	/* Note that an ENOMEM error is charged twice */
+	if (rc == -ENOMEM) {
+		UDP_INC_STATS(sock_net(sk), UDP_MIB_RCVBUFERRORS,
+				is_udplite);
+		drop_reason = SKB_DROP_REASON_SOCKET_RCVBUFF;
+	} else {
+		UDP_INC_STATS(sock_net(sk), UDP_MIB_MEMERRORS,
+			      is_udplite);
+		drop_reason = SKB_DROP_REASON_PROTO_MEM;
+	}
+	UDP_INC_STATS(sock_net(sk), UDP_MIB_INERRORS, is_udplite);
+	kfree_skb_reason(skb, drop_reason);
+	trace_udp_fail_queue_rcv_skb(rc, sk);
+}
+
+/* With @batch set the skb is only collected there, the caller enqueues
+ * the whole batch with __udp_enqueue_schedule_list().
+ */
+static int __udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb,
+			       struct sk_buff_head *batch)
 {
 	int rc;
 
@@ -2067,24 +2164,14 @@ static int __udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 		sk_mark_napi_id_once(sk, skb);
 	}
 
+	if (batch) {
+		__skb_queue_tail(batch, skb);
+		return 0;
+	}
+
 	rc = __udp_enqueue_schedule_skb(sk, skb);
 	if (rc < 0) {
-		int is_udplite = IS_UDPLITE(sk);
-		int drop_reason;
-
-		/* Note that an ENOMEM error is charged twice */
-		if (rc == -ENOMEM) {
-			UDP_INC_STATS(sock_net(sk), UDP_MIB_RCVBUFERRORS,
-					is_udplite);
-			drop_reason = SKB_DROP_REASON_SOCKET_RCVBUFF;
-		} else {
-			UDP_INC_STATS(sock_net(sk), UDP_MIB_MEMERRORS,
-				      is_udplite);
-			drop_reason = SKB_DROP_REASON_PROTO_MEM;
-		}
-		UDP_INC_STATS(sock_net(sk), UDP_MIB_INERRORS, is_udplite);
-		kfree_skb_reason(skb, drop_reason);
-		trace_udp_fail_queue_rcv_skb(rc, sk);
+		udp_queue_rcv_drop(sk, skb, rc);
 		return -1;
 	}
 
@@ -2099,7 +2186,8 @@ static int __udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
  * Note that in the success and error cases, the skb is assumed to
  * have either been requeued or freed.
  */
-static int udp_queue_rcv_one_skb(struct sock *sk, struct sk_buff *skb)
+static int udp_queue_rcv_one_skb(struct sock *sk, struct sk_buff *skb,
+				 struct sk_buff_head *batch)
 {
 	int drop_reason = SKB_DROP_REASON_NOT_SPECIFIED;
 	struct udp_sock *up = udp_sk(sk);
@@ -2197,7 +2285,7 @@ static int udp_queue_rcv_one_skb(struct sock *sk, struct sk_buff *skb)
 	udp_csum_pull_header(skb);
 
 	ipv4_pktinfo_prepare(sk, skb, true);
-	return __udp_queue_rcv_skb(sk, skb);
+	return __udp_queue_rcv_skb(sk, skb, batch);
 
 csum_error:
 	drop_reason = SKB_DROP_REASON_UDP_CSUM;
@@ -2212,22 +2300,36 @@ drop:
 static int udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 {
 	struct sk_buff *next, *segs;
+	struct sk_buff_head batch;
 	int ret;
 
 	if (likely(!udp_unexpected_gso(sk, skb)))
-		return udp_queue_rcv_one_skb(sk, skb);
+		return udp_queue_rcv_one_skb(sk, skb, NULL);
 
 	BUILD_BUG_ON(sizeof(struct udp_skb_cb) > SKB_GSO_CB_OFFSET);
 	__skb_push(skb, -skb_mac_offset(skb));
 	segs = udp_rcv_segment(sk, skb, true);
+
+	/* Segments of a GRO'd list that pass the per-datagram checks are
+	 * queued to the socket together, waking the reader once.
+	 */
+	__skb_queue_head_init(&batch);
 	skb_list_walk_safe(segs, skb, next) {
 		__skb_pull(skb, skb_transport_offset(skb));
 
 		udp_post_segment_fix_csum(skb);
-		ret = udp_queue_rcv_one_skb(sk, skb);
+		ret = udp_queue_rcv_one_skb(sk, skb, &batch);
 		if (ret > 0)
 			ip_protocol_deliver_rcu(dev_net(skb->dev), skb, ret);
 	}
+
+	if (!skb_queue_empty(&batch)) {
+		ret = __udp_enqueue_schedule_list(sk, &batch);
+		while ((skb = __skb_dequeue(&batch)) != NULL) {
+			atomic_inc(&sk->sk_drops);
+			udp_queue_rcv_drop(sk, skb, ret);
+		}
+	}
 	return 0;
 }
 
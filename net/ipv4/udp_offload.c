@@ -451,8 +451,12 @@ static int skb_gro_receive_list(struct sk_buff *p, struct sk_buff *skb)
 	return 0;
 }
 
+/* Upper bound on the datagrams merged into one GRO packet. Forwarding
+ * small datagrams of a single flow benefits from going past one NAPI
+ * budget worth, the default keeps the truesize of local sockets sane.
+ */
+int sysctl_udp_gro_max_segs __read_mostly = 64;
 
-#define UDP_GRO_CNT_MAX 64
 static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
 					       struct sk_buff *skb)
 {
@@ -524,7 +528,7 @@ static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
 		}
 
 		if (ret || ulen != ntohs(uh2->len) ||
-		    NAPI_GRO_CB(p)->count >= UDP_GRO_CNT_MAX)
+		    NAPI_GRO_CB(p)->count >= READ_ONCE(sysctl_udp_gro_max_segs))
 			pp = p;
 
 		return pp;
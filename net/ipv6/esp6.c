@@ -1065,7 +1065,7 @@ static int esp_init_aead(struct xfrm_state *x, struct netlink_ext_ack *extack)
 		return -ENAMETOOLONG;
 	}
 
-	aead = crypto_alloc_aead(aead_name, 0, 0);
+	aead = xfrm_alloc_aead(x, aead_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -1124,7 +1124,7 @@ static int esp_init_authenc(struct xfrm_state *x,
 		}
 	}
 
-	aead = crypto_alloc_aead(authenc_name, 0, 0);
+	aead = xfrm_alloc_aead(x, authenc_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead)) {
 		NL_SET_ERR_MSG(extack, "Kernel was unable to initialize cryptographic operations");
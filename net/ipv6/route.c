@@ -43,6 +43,7 @@
 #include <linux/jhash.h>
 #include <linux/siphash.h>
 #include <net/net_namespace.h>
+#include <net/netns/generic.h>
 #include <net/snmp.h>
 #include <net/ipv6.h>
 #include <net/ip6_fib.h>
@@ -2556,6 +2557,145 @@ u32 rt6_multipath_hash(const struct net *net, const struct flowi6 *fl6,
 	return mhash >> 1;
 }
 
+/*
+ * Optional per-cpu cache of the last forwarding route, the IPv6 side of
+ * net.ipv4.route.input_cache, enabled per netns with
+ * net.ipv6.route.input_cache: a border router forwarding between a
+ * 6LoWPAN/Thread interface and the LAN mostly sees the same few
+ * destinations back to back. Keyed on ingress device and destination
+ * (plus source with source-specific routes), only used without policy
+ * routing rules and never for multipath routes. Validity is checked
+ * with the route cookie, so any FIB change invalidates the entry. The
+ * held route pins its device, so entries are dropped on unregister and
+ * netns exit, from other CPUs: ->rt only changes with xchg/cmpxchg.
+ * Hits and misses are in /proc/net/stat/rt6_input_cache.
+ */
+struct rt6_input_cache_stat {
+	unsigned int		hit;
+	unsigned int		miss;
+};
+
+struct rt6_input_cache_net {
+	u8 enabled;		/* net.ipv6.route.input_cache */
+	struct rt6_input_cache_stat __percpu *stat;
+#ifdef CONFIG_SYSCTL
+	struct ctl_table_header *sysctl_header;
+#endif
+};
+
+static unsigned int rt6_input_cache_net_id __read_mostly;
+
+struct rt6_input_cache {
+	struct rt6_info	*rt;
+	struct in6_addr	daddr;
+	struct in6_addr	saddr;
+	u32		cookie;
+	int		iif;
+};
+
+static DEFINE_PER_CPU(struct rt6_input_cache, rt6_input_cache);
+
+static struct rt6_input_cache_net *rt6_input_cache_net(const struct net *net)
+{
+	return net_generic(net, rt6_input_cache_net_id);
+}
+
+static bool rt6_input_cache_usable(const struct net *net)
+{
+	/* per-cpu data, BHs need to be off */
+	return READ_ONCE(rt6_input_cache_net(net)->enabled) && in_softirq() &&
+	       !fib6_has_custom_rules(net);
+}
+
+static struct dst_entry *rt6_input_cache_lookup(const struct net *net,
+						const struct flowi6 *fl6)
+{
+	struct rt6_input_cache_stat __percpu *stat =
+		rt6_input_cache_net(net)->stat;
+	struct rt6_input_cache *c = this_cpu_ptr(&rt6_input_cache);
+	struct rt6_info *rt = c->rt;
+
+	if (!rt || c->iif != fl6->flowi6_iif ||
+	    !ipv6_addr_equal(&c->daddr, &fl6->daddr) ||
+	    (fib6_routes_require_src(net) &&
+	     !ipv6_addr_equal(&c->saddr, &fl6->saddr)))
+		goto miss;
+
+	if (!net_eq(dev_net(rt->dst.dev), net) ||
+	    !ip6_dst_check(&rt->dst, c->cookie)) {
+		if (cmpxchg(&c->rt, rt, NULL) == rt)
+			dst_release(&rt->dst);
+		goto miss;
+	}
+
+	__this_cpu_inc(stat->hit);
+	return &rt->dst;
+
+miss:
+	__this_cpu_inc(stat->miss);
+	return NULL;
+}
+
+static void rt6_input_cache_store(const struct flowi6 *fl6,
+				  struct dst_entry *dst)
+{
+	struct rt6_input_cache *c = this_cpu_ptr(&rt6_input_cache);
+	struct rt6_info *rt = (struct rt6_info *)dst;
+	struct fib6_info *from;
+
+	if (dst->error || dst->input != ip6_forward)
+		return;
+
+	from = rcu_dereference(rt->from);
+	if (!from || from->fib6_nsiblings)
+		return;
+
+	if (READ_ONCE(c->rt) != rt) {
+		struct rt6_info *old;
+
+		if (!dst_hold_safe(dst))
+			return;
+		old = xchg(&c->rt, rt);
+		if (old)
+			dst_release(&old->dst);
+	}
+
+	c->daddr = fl6->daddr;
+	c->saddr = fl6->saddr;
+	c->iif = fl6->flowi6_iif;
+	c->cookie = rt6_get_cookie(rt);
+}
+
+static bool rt6_input_cache_uses(const struct rt6_info *rt,
+				 const struct net *net,
+				 const struct net_device *dev)
+{
+	if (!dev)
+		return net_eq(dev_net(rt->dst.dev), net);
+
+	return rt->dst.dev == dev ||
+	       (rt->rt6i_idev && rt->rt6i_idev->dev == dev);
+}
+
+/* Drop the entries of all CPUs that use @dev, or any device of @net */
+static void rt6_input_cache_flush(const struct net *net,
+				  const struct net_device *dev)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct rt6_input_cache *c = per_cpu_ptr(&rt6_input_cache, cpu);
+		struct rt6_info *rt;
+
+		rcu_read_lock();
+		rt = READ_ONCE(c->rt);
+		if (rt && rt6_input_cache_uses(rt, net, dev) &&
+		    cmpxchg(&c->rt, rt, NULL) == rt)
+			dst_release(&rt->dst);
+		rcu_read_unlock();
+	}
+}
+
 /* Called with rcu held */
 void ip6_route_input(struct sk_buff *skb)
 {
@@ -2572,19 +2712,33 @@ void ip6_route_input(struct sk_buff *skb)
 		.flowi6_proto = iph->nexthdr,
 	};
 	struct flow_keys *flkeys = NULL, _flkeys;
+	struct dst_entry *dst;
+	bool cache;
 
 	tun_info = skb_tunnel_info(skb);
 	if (tun_info && !(tun_info->mode & IP_TUNNEL_INFO_TX))
 		fl6.flowi6_tun_key.tun_id = tun_info->key.tun_id;
 
+	cache = rt6_input_cache_usable(net);
+	if (cache) {
+		dst = rt6_input_cache_lookup(net, &fl6);
+		if (dst) {
+			skb_dst_drop(skb);
+			skb_dst_set_noref(skb, dst);
+			return;
+		}
+	}
+
 	if (fib6_rules_early_flow_dissect(net, skb, &fl6, &_flkeys))
 		flkeys = &_flkeys;
 
 	if (unlikely(fl6.flowi6_proto == IPPROTO_ICMPV6))
 		fl6.mp_hash = rt6_multipath_hash(net, &fl6, skb, flkeys);
 	skb_dst_drop(skb);
-	skb_dst_set_noref(skb, ip6_route_input_lookup(net, skb->dev,
-						      &fl6, skb, flags));
+	dst = ip6_route_input_lookup(net, skb->dev, &fl6, skb, flags);
+	if (cache)
+		rt6_input_cache_store(&fl6, dst);
+	skb_dst_set_noref(skb, dst);
 }
 
 INDIRECT_CALLABLE_SCOPE struct rt6_info *ip6_pol_route_output(struct net *net,
@@ -6270,6 +6424,10 @@ static int ip6_route_dev_notify(struct notifier_block *this,
 	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
 	struct net *net = dev_net(dev);
 
+	/* Every time, netdev_wait_allrefs() may be waiting for it */
+	if (event == NETDEV_UNREGISTER)
+		rt6_input_cache_flush(net, dev);
+
 	if (!(dev->flags & IFF_LOOPBACK))
 		return NOTIFY_OK;
 
@@ -6547,29 +6705,139 @@ static void __net_exit ip6_route_net_exit(struct net *net)
 	dst_entries_destroy(&net->ipv6.ip6_dst_ops);
 }
 
+#ifdef CONFIG_PROC_FS
+static int rt6_input_cache_stat_seq_show(struct seq_file *seq, void *v)
+{
+	struct rt6_input_cache_net *icn =
+		rt6_input_cache_net(seq_file_single_net(seq));
+	struct rt6_input_cache_stat sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct rt6_input_cache_stat *st =
+			per_cpu_ptr(icn->stat, cpu);
+
+		sum.hit += READ_ONCE(st->hit);
+		sum.miss += READ_ONCE(st->miss);
+	}
+
+	seq_puts(seq, "hit miss\n");
+	seq_printf(seq, "%u %u\n", sum.hit, sum.miss);
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SYSCTL
+static struct ctl_table rt6_input_cache_sysctl_table[] = {
+	{
+		.procname	=	"input_cache",
+		.maxlen		=	sizeof(u8),
+		.mode		=	0644,
+		.proc_handler	=	proc_dou8vec_minmax,
+		.extra1		=	SYSCTL_ZERO,
+		.extra2		=	SYSCTL_ONE,
+	},
+	{ }
+};
+
+static int rt6_input_cache_sysctl_init(struct net *net,
+				       struct rt6_input_cache_net *icn)
+{
+	struct ctl_table *table;
+
+	table = kmemdup(rt6_input_cache_sysctl_table,
+			sizeof(rt6_input_cache_sysctl_table), GFP_KERNEL);
+	if (!table)
+		return -ENOMEM;
+
+	table[0].data = &icn->enabled;
+
+	icn->sysctl_header = register_net_sysctl(net, "net/ipv6/route", table);
+	if (!icn->sysctl_header) {
+		kfree(table);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void rt6_input_cache_sysctl_fini(struct rt6_input_cache_net *icn)
+{
+	struct ctl_table *table = icn->sysctl_header->ctl_table_arg;
+
+	unregister_net_sysctl_table(icn->sysctl_header);
+	kfree(table);
+}
+#else
+static int rt6_input_cache_sysctl_init(struct net *net,
+				       struct rt6_input_cache_net *icn)
+{
+	return 0;
+}
+
+static void rt6_input_cache_sysctl_fini(struct rt6_input_cache_net *icn)
+{
+}
+#endif
+
 static int __net_init ip6_route_net_init_late(struct net *net)
 {
+	struct rt6_input_cache_net *icn = rt6_input_cache_net(net);
+	int ret;
+
+	icn->stat = alloc_percpu(struct rt6_input_cache_stat);
+	if (!icn->stat)
+		return -ENOMEM;
+
+	ret = rt6_input_cache_sysctl_init(net, icn);
+	if (ret)
+		goto out_stat;
+
 #ifdef CONFIG_PROC_FS
+	ret = -ENOMEM;
 	if (!proc_create_net("ipv6_route", 0, net->proc_net,
 			     &ipv6_route_seq_ops,
 			     sizeof(struct ipv6_route_iter)))
-		return -ENOMEM;
+		goto out_sysctl;
 
 	if (!proc_create_net_single("rt6_stats", 0444, net->proc_net,
-				    rt6_stats_seq_show, NULL)) {
-		remove_proc_entry("ipv6_route", net->proc_net);
-		return -ENOMEM;
-	}
+				    rt6_stats_seq_show, NULL))
+		goto out_ipv6_route;
+
+	if (!proc_create_net_single("rt6_input_cache", 0444,
+				    net->proc_net_stat,
+				    rt6_input_cache_stat_seq_show, NULL))
+		goto out_rt6_stats;
 #endif
 	return 0;
+
+#ifdef CONFIG_PROC_FS
+out_rt6_stats:
+	remove_proc_entry("rt6_stats", net->proc_net);
+out_ipv6_route:
+	remove_proc_entry("ipv6_route", net->proc_net);
+out_sysctl:
+	rt6_input_cache_sysctl_fini(icn);
+#endif
+out_stat:
+	free_percpu(icn->stat);
+	return ret;
 }
 
 static void __net_exit ip6_route_net_exit_late(struct net *net)
 {
+	struct rt6_input_cache_net *icn = rt6_input_cache_net(net);
+
+	/* Before fib6 and ip6_dst_ops of @net go away */
+	rt6_input_cache_flush(net, NULL);
+
 #ifdef CONFIG_PROC_FS
 	remove_proc_entry("ipv6_route", net->proc_net);
 	remove_proc_entry("rt6_stats", net->proc_net);
+	remove_proc_entry("rt6_input_cache", net->proc_net_stat);
 #endif
+	rt6_input_cache_sysctl_fini(icn);
+	free_percpu(icn->stat);
 }
 
 static struct pernet_operations ip6_route_net_ops = {
@@ -6605,6 +6873,8 @@ static struct pernet_operations ipv6_inetpeer_ops = {
 static struct pernet_operations ip6_route_net_late_ops = {
 	.init = ip6_route_net_init_late,
 	.exit = ip6_route_net_exit_late,
+	.id = &rt6_input_cache_net_id,
+	.size = sizeof(struct rt6_input_cache_net),
 };
 
 static struct notifier_block ip6_route_dev_notifier = {
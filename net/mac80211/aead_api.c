@@ -10,11 +10,85 @@
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
 #include <linux/scatterlist.h>
+#include <linux/slab.h>
 #include <crypto/aead.h>
 
 #include "aead_api.h"
 
+/* In softirq context, which is where frames are normally protected, requests
+ * are built in a per-CPU scratch buffer rather than allocated and freed for
+ * every frame. The buffer covers the largest request of the keys set up so
+ * far plus AEAD_SCRATCH_AAD_LEN; it only grows, in process context, and the
+ * old one is freed after an RCU grace period, which BH-disabled users hold
+ * off. Anything else falls back to an allocation.
+ */
+#define AEAD_SCRATCH_AAD_LEN	32
+
+struct aead_scratch {
+	struct rcu_head rcu;
+	size_t size;
+	u8 buf[] __aligned(CRYPTO_MINALIGN);
+};
+
+static DEFINE_PER_CPU(struct aead_scratch __rcu *, aead_scratch);
+static DEFINE_MUTEX(aead_scratch_mutex);
+
+static int aead_scratch_grow(size_t size)
+{
+	struct aead_scratch *old, *new;
+	int cpu, err = 0;
+
+	mutex_lock(&aead_scratch_mutex);
+	for_each_possible_cpu(cpu) {
+		old = rcu_dereference_protected(per_cpu(aead_scratch, cpu),
+				lockdep_is_held(&aead_scratch_mutex));
+		if (old && old->size >= size)
+			continue;
+
+		new = kzalloc_node(sizeof(*new) + size, GFP_KERNEL,
+				   cpu_to_node(cpu));
+		if (!new) {
+			err = -ENOMEM;
+			break;
+		}
+		new->size = size;
+
+		rcu_assign_pointer(per_cpu(aead_scratch, cpu), new);
+		if (old)
+			kfree_rcu(old, rcu);
+	}
+	mutex_unlock(&aead_scratch_mutex);
+
+	return err;
+}
+
+static struct aead_request *aead_req_get(size_t size, bool *scratch)
+{
+	struct aead_scratch *sc = NULL;
+
+	if (in_softirq() && !in_hardirq())
+		sc = rcu_dereference_bh(*this_cpu_ptr(&aead_scratch));
+
+	*scratch = sc && sc->size >= size;
+	if (*scratch)
+		return (struct aead_request *)sc->buf;
+
+	return kzalloc(size, GFP_ATOMIC);
+}
+
+static void aead_req_put(struct aead_request *aead_req, size_t size,
+			 bool scratch)
+{
+	if (scratch)
+		memzero_explicit(aead_req, size);
+	else
+		kfree_sensitive(aead_req);
+}
+
 int aead_encrypt(struct crypto_aead *tfm, u8 *b_0, u8 *aad, size_t aad_len,
 		 u8 *data, size_t data_len, u8 *mic)
 {
@@ -22,10 +96,11 @@ int aead_encrypt(struct crypto_aead *tfm, u8 *b_0, u8 *aad, size_t aad_len,
 	struct scatterlist sg[3];
 	struct aead_request *aead_req;
 	int reqsize = sizeof(*aead_req) + crypto_aead_reqsize(tfm);
+	bool scratch;
 	u8 *__aad;
 	int ret;
 
-	aead_req = kzalloc(reqsize + aad_len, GFP_ATOMIC);
+	aead_req = aead_req_get(reqsize + aad_len, &scratch);
 	if (!aead_req)
 		return -ENOMEM;
 
@@ -38,11 +113,12 @@ int aead_encrypt(struct crypto_aead *tfm, u8 *b_0, u8 *aad, size_t aad_len,
 	sg_set_buf(&sg[2], mic, mic_len);
 
 	aead_request_set_tfm(aead_req, tfm);
+	aead_request_set_callback(aead_req, 0, NULL, NULL);
 	aead_request_set_crypt(aead_req, sg, sg, data_len, b_0);
 	aead_request_set_ad(aead_req, sg[0].length);
 
 	ret = crypto_aead_encrypt(aead_req);
-	kfree_sensitive(aead_req);
+	aead_req_put(aead_req, reqsize + aad_len, scratch);
 
 	return ret;
 }
@@ -54,13 +130,14 @@ int aead_decrypt(struct crypto_aead *tfm, u8 *b_0, u8 *aad, size_t aad_len,
 	struct scatterlist sg[3];
 	struct aead_request *aead_req;
 	int reqsize = sizeof(*aead_req) + crypto_aead_reqsize(tfm);
+	bool scratch;
 	u8 *__aad;
 	int err;
 
 	if (data_len == 0)
 		return -EINVAL;
 
-	aead_req = kzalloc(reqsize + aad_len, GFP_ATOMIC);
+	aead_req = aead_req_get(reqsize + aad_len, &scratch);
 	if (!aead_req)
 		return -ENOMEM;
 
@@ -73,11 +150,12 @@ int aead_decrypt(struct crypto_aead *tfm, u8 *b_0, u8 *aad, size_t aad_len,
 	sg_set_buf(&sg[2], mic, mic_len);
 
 	aead_request_set_tfm(aead_req, tfm);
+	aead_request_set_callback(aead_req, 0, NULL, NULL);
 	aead_request_set_crypt(aead_req, sg, sg, data_len + mic_len, b_0);
 	aead_request_set_ad(aead_req, sg[0].length);
 
 	err = crypto_aead_decrypt(aead_req);
-	kfree_sensitive(aead_req);
+	aead_req_put(aead_req, reqsize + aad_len, scratch);
 
 	return err;
 }
@@ -100,6 +178,10 @@ aead_key_setup_encrypt(const char *alg, const u8 key[],
 	if (err)
 		goto free_aead;
 
+	/* not fatal, aead_req_get() falls back to allocating */
+	aead_scratch_grow(sizeof(struct aead_request) +
+			  crypto_aead_reqsize(tfm) + AEAD_SCRATCH_AAD_LEN);
+
 	return tfm;
 
 free_aead:
@@ -512,6 +512,29 @@ IEEE80211_IF_FILE_R(aqm);
 
 IEEE80211_IF_FILE(multicast_to_unicast, u.ap.multicast_to_unicast, HEX);
 
+static ssize_t ieee80211_if_fmt_multicast_to_unicast_airtime(
+	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
+{
+	return snprintf(buf, buflen, "%u\n",
+			sdata->u.ap.multicast_to_unicast_airtime);
+}
+
+static ssize_t ieee80211_if_parse_multicast_to_unicast_airtime(
+	struct ieee80211_sub_if_data *sdata, const char *buf, int buflen)
+{
+	u16 val;
+	int ret;
+
+	ret = kstrtou16(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	sdata->u.ap.multicast_to_unicast_airtime = val;
+
+	return buflen;
+}
+IEEE80211_IF_FILE_RW(multicast_to_unicast_airtime);
+
 /* IBSS attributes */
 static ssize_t ieee80211_if_fmt_tsf(
 	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
@@ -607,6 +630,12 @@ IEEE80211_IF_FILE(dropped_frames_congestion,
 		  u.mesh.mshstats.dropped_frames_congestion, DEC);
 IEEE80211_IF_FILE(dropped_frames_no_route,
 		  u.mesh.mshstats.dropped_frames_no_route, DEC);
+IEEE80211_IF_FILE(path_cache_hit, u.mesh.mshstats.path_cache_hit, DEC);
+IEEE80211_IF_FILE(path_cache_miss, u.mesh.mshstats.path_cache_miss, DEC);
+IEEE80211_IF_FILE(path_refresh_ratelimited,
+		  u.mesh.mshstats.path_refresh_ratelimited, DEC);
+IEEE80211_IF_FILE(preq_coalesced, u.mesh.mshstats.preq_coalesced, DEC);
+IEEE80211_IF_FILE(preq_stale, u.mesh.mshstats.preq_stale, DEC);
 
 /* Mesh parameters */
 IEEE80211_IF_FILE(dot11MeshMaxRetries,
@@ -707,6 +736,7 @@ static void add_ap_files(struct ieee80211_sub_if_data *sdata)
 	DEBUGFS_ADD(num_buffered_multicast);
 	DEBUGFS_ADD_MODE(tkip_mic_test, 0200);
 	DEBUGFS_ADD_MODE(multicast_to_unicast, 0600);
+	DEBUGFS_ADD_MODE(multicast_to_unicast_airtime, 0600);
 }
 
 static void add_vlan_files(struct ieee80211_sub_if_data *sdata)
@@ -742,6 +772,11 @@ static void add_mesh_stats(struct ieee80211_sub_if_data *sdata)
 	MESHSTATS_ADD(dropped_frames_ttl);
 	MESHSTATS_ADD(dropped_frames_no_route);
 	MESHSTATS_ADD(dropped_frames_congestion);
+	MESHSTATS_ADD(path_cache_hit);
+	MESHSTATS_ADD(path_cache_miss);
+	MESHSTATS_ADD(path_refresh_ratelimited);
+	MESHSTATS_ADD(preq_coalesced);
+	MESHSTATS_ADD(preq_stale);
 #undef MESHSTATS_ADD
 }
 
@@ -310,6 +310,8 @@ struct ieee80211_if_ap {
 	atomic_t num_mcast_sta; /* number of stations receiving multicast */
 
 	bool multicast_to_unicast;
+	/* max unicast/multicast airtime ratio in %, 0 = always convert */
+	u16 multicast_to_unicast_airtime;
 	bool active;
 };
 
@@ -328,6 +330,11 @@ struct mesh_stats {
 	__u32 dropped_frames_ttl;	/* Not transmitted since mesh_ttl == 0*/
 	__u32 dropped_frames_no_route;	/* Not transmitted, no route found */
 	__u32 dropped_frames_congestion;/* Not forwarded due to congestion */
+	__u32 path_cache_hit;		/* Path lookups served by the cache */
+	__u32 path_cache_miss;		/* Path lookups that hit the rhashtable */
+	__u32 path_refresh_ratelimited;	/* Path refreshes held back */
+	__u32 preq_coalesced;		/* PREQs already queued for the path */
+	__u32 preq_stale;		/* Queued PREQs dropped without sending */
 };
 
 #define PREQ_Q_F_START		0x1
@@ -645,7 +652,11 @@ struct mesh_csa_settings {
  * @walk_head: linked list containing all mesh_path objects
  * @walk_lock: lock protecting walk_head
  * @entries: number of entries in the table
+ * @cache: direct mapped cache of recently looked up paths, indexed by the
+ *	low bits of the destination address
  */
+#define MESH_PATH_CACHE_SIZE	64
+
 struct mesh_table {
 	struct hlist_head known_gates;
 	spinlock_t gates_lock;
@@ -653,6 +664,7 @@ struct mesh_table {
 	struct hlist_head walk_head;
 	spinlock_t walk_lock;
 	atomic_t entries;		/* Up to MAX_MESH_NEIGHBOURS */
+	struct mesh_path __rcu *cache[MESH_PATH_CACHE_SIZE];
 };
 
 struct ieee80211_if_mesh {
@@ -93,6 +93,8 @@ enum mesh_deferred_task_flags {
  * @is_root: the destination station of this path is a root node
  * @is_gate: the destination station of this path is a mesh gate
  * @path_change_count: the number of path changes to destination
+ * @last_refresh: in jiffies, when a refresh PREQ was last queued from the
+ *	forwarding path
  *
  *
  * The dst address is unique in the mesh path table. Since the mesh_path is
@@ -125,6 +127,7 @@ struct mesh_path {
 	bool is_root;
 	bool is_gate;
 	u32 path_change_count;
+	unsigned long last_refresh;
 };
 
 /* Recent multicast cache */
@@ -983,6 +983,15 @@ static void mesh_queue_preq(struct mesh_path *mpath, u8 flags)
 	struct ieee80211_if_mesh *ifmsh = &sdata->u.mesh;
 	struct mesh_preq_queue *preq_node;
 
+	/* Racy, but saves the allocation and locking for the common case of
+	 * every frame to a destination asking for the same PREQ; the flag is
+	 * checked again under the lock below.
+	 */
+	if (READ_ONCE(mpath->flags) & MESH_PATH_REQ_QUEUED) {
+		IEEE80211_IFSTA_MESH_CTR_INC(ifmsh, preq_coalesced);
+		return;
+	}
+
 	preq_node = kmalloc(sizeof(struct mesh_preq_queue), GFP_ATOMIC);
 	if (!preq_node) {
 		mhwmp_dbg(sdata, "could not allocate PREQ node\n");
@@ -1003,6 +1012,7 @@ static void mesh_queue_preq(struct mesh_path *mpath, u8 flags)
 		spin_unlock(&mpath->state_lock);
 		spin_unlock_bh(&ifmsh->mesh_preq_queue_lock);
 		kfree(preq_node);
+		IEEE80211_IFSTA_MESH_CTR_INC(ifmsh, preq_coalesced);
 		return;
 	}
 
@@ -1031,48 +1041,39 @@ static void mesh_queue_preq(struct mesh_path *mpath, u8 flags)
 }
 
 /**
- * mesh_path_start_discovery - launch a path discovery from the PREQ queue
+ * mesh_path_preq_tx - send the PREQ for a dequeued PREQ queue entry
  *
  * @sdata: local mesh subif
+ * @preq_node: PREQ queue entry
+ *
+ * Returns: true if the entry used up the PREQ interval, false if it was stale
+ * (the path is gone, fixed or no longer needs discovery) and nothing was sent.
+ *
+ * Locking: must be called within a read rcu section.
  */
-void mesh_path_start_discovery(struct ieee80211_sub_if_data *sdata)
+static bool mesh_path_preq_tx(struct ieee80211_sub_if_data *sdata,
+			      struct mesh_preq_queue *preq_node)
 {
 	struct ieee80211_if_mesh *ifmsh = &sdata->u.mesh;
-	struct mesh_preq_queue *preq_node;
 	struct mesh_path *mpath;
 	u8 ttl, target_flags = 0;
 	const u8 *da;
 	u32 lifetime;
 
-	spin_lock_bh(&ifmsh->mesh_preq_queue_lock);
-	if (!ifmsh->preq_queue_len ||
-		time_before(jiffies, ifmsh->last_preq +
-				min_preq_int_jiff(sdata))) {
-		spin_unlock_bh(&ifmsh->mesh_preq_queue_lock);
-		return;
-	}
-
-	preq_node = list_first_entry(&ifmsh->preq_queue.list,
-			struct mesh_preq_queue, list);
-	list_del(&preq_node->list);
-	--ifmsh->preq_queue_len;
-	spin_unlock_bh(&ifmsh->mesh_preq_queue_lock);
-
-	rcu_read_lock();
 	mpath = mesh_path_lookup(sdata, preq_node->dst);
 	if (!mpath)
-		goto enddiscovery;
+		return false;
 
 	spin_lock_bh(&mpath->state_lock);
 	if (mpath->flags & (MESH_PATH_DELETED | MESH_PATH_FIXED)) {
 		spin_unlock_bh(&mpath->state_lock);
-		goto enddiscovery;
+		return false;
 	}
 	mpath->flags &= ~MESH_PATH_REQ_QUEUED;
 	if (preq_node->flags & PREQ_Q_F_START) {
 		if (mpath->flags & MESH_PATH_RESOLVING) {
 			spin_unlock_bh(&mpath->state_lock);
-			goto enddiscovery;
+			return false;
 		} else {
 			mpath->flags &= ~MESH_PATH_RESOLVED;
 			mpath->flags |= MESH_PATH_RESOLVING;
@@ -1083,7 +1084,7 @@ void mesh_path_start_discovery(struct ieee80211_sub_if_data *sdata)
 			mpath->flags & MESH_PATH_RESOLVED) {
 		mpath->flags &= ~MESH_PATH_RESOLVING;
 		spin_unlock_bh(&mpath->state_lock);
-		goto enddiscovery;
+		return false;
 	}
 
 	ifmsh->last_preq = jiffies;
@@ -1099,7 +1100,7 @@ void mesh_path_start_discovery(struct ieee80211_sub_if_data *sdata)
 	if (ttl == 0) {
 		sdata->u.mesh.mshstats.dropped_frames_ttl++;
 		spin_unlock_bh(&mpath->state_lock);
-		goto enddiscovery;
+		return true;
 	}
 
 	if (preq_node->flags & PREQ_Q_F_REFRESH)
@@ -1118,9 +1119,46 @@ void mesh_path_start_discovery(struct ieee80211_sub_if_data *sdata)
 		mod_timer(&mpath->timer, jiffies + mpath->discovery_timeout);
 	spin_unlock_bh(&mpath->state_lock);
 
-enddiscovery:
-	rcu_read_unlock();
-	kfree(preq_node);
+	return true;
+}
+
+/**
+ * mesh_path_start_discovery - launch a path discovery from the PREQ queue
+ *
+ * @sdata: local mesh subif
+ *
+ * Stale entries at the head of the queue are dropped in the same pass, so
+ * they do not each hold up the next real PREQ by a full PREQ interval.
+ */
+void mesh_path_start_discovery(struct ieee80211_sub_if_data *sdata)
+{
+	struct ieee80211_if_mesh *ifmsh = &sdata->u.mesh;
+	struct mesh_preq_queue *preq_node;
+	bool sent;
+
+	do {
+		spin_lock_bh(&ifmsh->mesh_preq_queue_lock);
+		if (!ifmsh->preq_queue_len ||
+			time_before(jiffies, ifmsh->last_preq +
+					min_preq_int_jiff(sdata))) {
+			spin_unlock_bh(&ifmsh->mesh_preq_queue_lock);
+			return;
+		}
+
+		preq_node = list_first_entry(&ifmsh->preq_queue.list,
+				struct mesh_preq_queue, list);
+		list_del(&preq_node->list);
+		--ifmsh->preq_queue_len;
+		spin_unlock_bh(&ifmsh->mesh_preq_queue_lock);
+
+		rcu_read_lock();
+		sent = mesh_path_preq_tx(sdata, preq_node);
+		rcu_read_unlock();
+		kfree(preq_node);
+
+		if (!sent)
+			IEEE80211_IFSTA_MESH_CTR_INC(ifmsh, preq_stale);
+	} while (!sent);
 }
 
 /**
@@ -1246,9 +1284,21 @@ int mesh_nexthop_lookup(struct ieee80211_sub_if_data *sdata,
 		       mpath->exp_time -
 		       msecs_to_jiffies(sdata->u.mesh.mshcfg.path_refresh_time)) &&
 	    ether_addr_equal(sdata->vif.addr, hdr->addr4) &&
-	    !(mpath->flags & MESH_PATH_RESOLVING) &&
-	    !(mpath->flags & MESH_PATH_FIXED))
-		mesh_queue_preq(mpath, PREQ_Q_F_START | PREQ_Q_F_REFRESH);
+	    !(mpath->flags & (MESH_PATH_RESOLVING | MESH_PATH_FIXED |
+			      MESH_PATH_REQ_QUEUED))) {
+		unsigned long last = READ_ONCE(mpath->last_refresh);
+
+		/* at most one refresh per PREQ interval from the data path */
+		if (time_in_range(jiffies, last,
+				  last + min_preq_int_jiff(sdata))) {
+			IEEE80211_IFSTA_MESH_CTR_INC(ifmsh,
+						     path_refresh_ratelimited);
+		} else {
+			WRITE_ONCE(mpath->last_refresh, jiffies);
+			mesh_queue_preq(mpath,
+					PREQ_Q_F_START | PREQ_Q_F_REFRESH);
+		}
+	}
 
 	next_hop = rcu_dereference(mpath->next_hop);
 	if (next_hop) {
@@ -32,6 +32,35 @@ static const struct rhashtable_params mesh_rht_params = {
 	.hashfn = mesh_table_hash,
 };
 
+static inline u32 mesh_path_cache_idx(const u8 *dst)
+{
+	return (dst[4] ^ dst[5]) & (MESH_PATH_CACHE_SIZE - 1);
+}
+
+/* A path may only be cached while it is not deleted. The lookup side
+ * publishes the path and then checks MESH_PATH_DELETED, the delete side
+ * sets the flag and then clears the slot, so with a full barrier on each
+ * side one of them always sees the other and a freed path never stays
+ * cached past the RCU grace period of its kfree_rcu().
+ */
+static void mesh_path_cache_set(struct mesh_table *tbl, u32 idx,
+				struct mesh_path *mpath)
+{
+	rcu_assign_pointer(tbl->cache[idx], mpath);
+	smp_mb();
+	if (READ_ONCE(mpath->flags) & MESH_PATH_DELETED)
+		cmpxchg(&tbl->cache[idx], RCU_INITIALIZER(mpath), NULL);
+}
+
+static void mesh_path_cache_del(struct mesh_table *tbl,
+				struct mesh_path *mpath)
+{
+	u32 idx = mesh_path_cache_idx(mpath->dst);
+
+	smp_mb();
+	cmpxchg(&tbl->cache[idx], RCU_INITIALIZER(mpath), NULL);
+}
+
 static inline bool mpath_expired(struct mesh_path *mpath)
 {
 	return (mpath->flags & MESH_PATH_ACTIVE) &&
@@ -207,8 +236,17 @@ static struct mesh_path *mpath_lookup(struct mesh_table *tbl, const u8 *dst,
 				      struct ieee80211_sub_if_data *sdata)
 {
 	struct mesh_path *mpath;
-
-	mpath = rhashtable_lookup(&tbl->rhead, dst, mesh_rht_params);
+	u32 idx = mesh_path_cache_idx(dst);
+
+	mpath = rcu_dereference(tbl->cache[idx]);
+	if (mpath && ether_addr_equal(mpath->dst, dst)) {
+		IEEE80211_IFSTA_MESH_CTR_INC(&sdata->u.mesh, path_cache_hit);
+	} else {
+		IEEE80211_IFSTA_MESH_CTR_INC(&sdata->u.mesh, path_cache_miss);
+		mpath = rhashtable_lookup(&tbl->rhead, dst, mesh_rht_params);
+		if (mpath)
+			mesh_path_cache_set(tbl, idx, mpath);
+	}
 
 	if (mpath && mpath_expired(mpath)) {
 		spin_lock_bh(&mpath->state_lock);
@@ -512,6 +550,7 @@ static void mesh_path_free_rcu(struct mesh_table *tbl,
 	mpath->flags |= MESH_PATH_RESOLVING | MESH_PATH_DELETED;
 	mesh_gate_del(tbl, mpath);
 	spin_unlock_bh(&mpath->state_lock);
+	mesh_path_cache_del(tbl, mpath);
 	del_timer_sync(&mpath->timer);
 	atomic_dec(&sdata->u.mesh.mpaths);
 	atomic_dec(&tbl->entries);
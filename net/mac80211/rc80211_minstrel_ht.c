@@ -406,6 +406,7 @@ minstrel_ht_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 
 	idx = 0;
 out:
+	__set_bit(group, mi->active_groups);
 	return &mi->groups[group].rates[idx];
 }
 
@@ -450,6 +451,7 @@ minstrel_ht_ri_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 
 	idx = 0;
 out:
+	__set_bit(group, mi->active_groups);
 	return &mi->groups[group].rates[idx];
 }
 
@@ -772,12 +774,17 @@ minstrel_ht_calc_rate_stats(struct minstrel_priv *mp,
 		cur_prob = MINSTREL_FRAC(mrs->success, mrs->attempts);
 		minstrel_filter_avg_add(&mrs->prob_avg,
 					&mrs->prob_avg_1, cur_prob);
+		mrs->sampled = true;
+#ifdef CONFIG_MAC80211_DEBUGFS
 		mrs->att_hist += mrs->attempts;
 		mrs->succ_hist += mrs->success;
+#endif
 	}
 
+#ifdef CONFIG_MAC80211_DEBUGFS
 	mrs->last_success = mrs->success;
 	mrs->last_attempts = mrs->attempts;
+#endif
 	mrs->success = 0;
 	mrs->attempts = 0;
 }
@@ -1065,6 +1072,7 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 	u16 tmp_legacy_tp_rate[MAX_THR_RATES], tmp_max_prob_rate;
 	u16 index;
 	bool ht_supported = mi->sta->deflink.ht_cap.ht_supported;
+	bool active;
 
 	if (mi->ampdu_packets > 0) {
 		if (!ieee80211_hw_check(mp->hw, TX_STATUS_NO_AMPDU_LEN))
@@ -1118,6 +1126,11 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 		if (group == MINSTREL_CCK_GROUP && ht_supported)
 			tp_rate = tmp_legacy_tp_rate;
 
+		/* Only groups that saw tx status have new samples to fold
+		 * in, the others keep their averages as they are.
+		 */
+		active = test_bit(group, mi->active_groups);
+
 		for (i = MCS_GROUP_RATES - 1; i >= 0; i--) {
 			if (!(mi->supported[group] & BIT(i)))
 				continue;
@@ -1126,9 +1139,10 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 
 			mrs = &mg->rates[i];
 			mrs->retry_updated = false;
-			minstrel_ht_calc_rate_stats(mp, mrs);
+			if (active)
+				minstrel_ht_calc_rate_stats(mp, mrs);
 
-			if (mrs->att_hist)
+			if (mrs->sampled)
 				last_prob = max(last_prob, mrs->prob_avg);
 			else
 				mrs->prob_avg = max(last_prob, mrs->prob_avg);
@@ -1188,6 +1202,8 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 	}
 #endif
 
+	bitmap_zero(mi->active_groups, MINSTREL_GROUPS_NB);
+
 	/* Reset update timer */
 	mi->last_stats_update = jiffies;
 	mi->sample_time = jiffies;
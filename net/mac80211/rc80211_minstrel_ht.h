@@ -109,12 +109,9 @@ extern const s16 minstrel_ofdm_bitrates[8];
 extern const struct mcs_group minstrel_mcs_groups[];
 
 struct minstrel_rate_stats {
-	/* current / last sampling period attempts/success counters */
-	u16 attempts, last_attempts;
-	u16 success, last_success;
-
-	/* total attempts/success counters */
-	u32 att_hist, succ_hist;
+	/* current sampling period attempts/success counters */
+	u16 attempts;
+	u16 success;
 
 	/* prob_avg - moving average of prob */
 	u16 prob_avg;
@@ -125,6 +122,20 @@ struct minstrel_rate_stats {
 	u8 retry_count_rtscts;
 
 	bool retry_updated;
+
+	/* rate has been attempted at least once */
+	bool sampled;
+
+#ifdef CONFIG_MAC80211_DEBUGFS
+	/* last sampling period attempts/success counters, only refreshed
+	 * for groups that were used in that period
+	 */
+	u16 last_attempts;
+	u16 last_success;
+
+	/* total attempts/success counters */
+	u32 att_hist, succ_hist;
+#endif
 };
 
 enum minstrel_sample_type {
@@ -192,6 +203,9 @@ struct minstrel_ht_sta {
 	/* Bitfield of supported MCS rates of all groups */
 	u16 supported[MINSTREL_GROUPS_NB];
 
+	/* groups with tx status since the last stats update */
+	DECLARE_BITMAP(active_groups, MINSTREL_GROUPS_NB);
+
 	/* MCS rate group info and statistics */
 	struct minstrel_mcs_group_data groups[MINSTREL_GROUPS_NB];
 };
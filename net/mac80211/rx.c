@@ -4127,10 +4127,12 @@ static bool ieee80211_rx_data_set_sta(struct ieee80211_rx_data *rx,
 void ieee80211_release_reorder_timeout(struct sta_info *sta, int tid)
 {
 	struct sk_buff_head frames;
+	LIST_HEAD(list);
 	struct ieee80211_rx_data rx = {
 		/* This is OK -- must be QoS data frame */
 		.security_idx = tid,
 		.seqno_idx = tid,
+		.list = &list,
 	};
 	struct tid_ampdu_rx *tid_agg_rx;
 	int link_id = -1;
@@ -4162,6 +4164,7 @@ void ieee80211_release_reorder_timeout(struct sta_info *sta, int tid)
 	}
 
 	ieee80211_rx_handlers(&rx, &frames);
+	netif_receive_skb_list(&list);
 }
 
 void ieee80211_mark_rx_ba_filtered_frames(struct ieee80211_sta *pubsta, u8 tid,
@@ -4172,10 +4175,12 @@ void ieee80211_mark_rx_ba_filtered_frames(struct ieee80211_sta *pubsta, u8 tid,
 	struct sta_info *sta;
 	struct tid_ampdu_rx *tid_agg_rx;
 	struct sk_buff_head frames;
+	LIST_HEAD(list);
 	struct ieee80211_rx_data rx = {
 		/* This is OK -- must be QoS data frame */
 		.security_idx = tid,
 		.seqno_idx = tid,
+		.list = &list,
 	};
 	int i, diff;
 
@@ -4245,6 +4250,7 @@ release:
 
  out:
 	rcu_read_unlock();
+	netif_receive_skb_list(&list);
 }
 EXPORT_SYMBOL(ieee80211_mark_rx_ba_filtered_frames);
 
@@ -984,6 +984,23 @@ static unsigned long ieee80211_tids_for_ac(int ac)
 	}
 }
 
+struct ps_data *sta_info_ps_data(struct sta_info *sta)
+{
+	if (sta->sdata->vif.type == NL80211_IFTYPE_AP ||
+	    sta->sdata->vif.type == NL80211_IFTYPE_AP_VLAN) {
+		if (WARN_ON_ONCE(!sta->sdata->bss))
+			return NULL;
+
+		return &sta->sdata->bss->ps;
+#ifdef CONFIG_MAC80211_MESH
+	} else if (ieee80211_vif_is_mesh(&sta->sdata->vif)) {
+		return &sta->sdata->u.mesh.ps;
+#endif
+	}
+
+	return NULL;
+}
+
 static void __sta_info_recalc_tim(struct sta_info *sta, bool ignore_pending)
 {
 	struct ieee80211_local *local = sta->local;
@@ -993,19 +1010,9 @@ static void __sta_info_recalc_tim(struct sta_info *sta, bool ignore_pending)
 	int ac;
 	u16 id = sta->sta.aid;
 
-	if (sta->sdata->vif.type == NL80211_IFTYPE_AP ||
-	    sta->sdata->vif.type == NL80211_IFTYPE_AP_VLAN) {
-		if (WARN_ON_ONCE(!sta->sdata->bss))
-			return;
-
-		ps = &sta->sdata->bss->ps;
-#ifdef CONFIG_MAC80211_MESH
-	} else if (ieee80211_vif_is_mesh(&sta->sdata->vif)) {
-		ps = &sta->sdata->u.mesh.ps;
-#endif
-	} else {
+	ps = sta_info_ps_data(sta);
+	if (!ps)
 		return;
-	}
 
 	/* No need to do anything if the driver does all */
 	if (ieee80211_hw_check(&local->hw, AP_LINK_PS) && !local->ops->set_tim)
@@ -1071,6 +1078,20 @@ void sta_info_recalc_tim(struct sta_info *sta)
 	__sta_info_recalc_tim(sta, false);
 }
 
+/*
+ * Called after a frame was buffered for @sta. That can only set the
+ * TIM bit, so skip the recalculation (and tim_lock) if it's set already.
+ */
+void sta_info_recalc_tim_buffered(struct sta_info *sta)
+{
+	struct ps_data *ps = sta_info_ps_data(sta);
+
+	if (ps && !sta->dead && __bss_tim_get(ps->tim, sta->sta.aid))
+		return;
+
+	__sta_info_recalc_tim(sta, false);
+}
+
 static bool sta_info_buffer_expired(struct sta_info *sta, struct sk_buff *skb)
 {
 	struct ieee80211_tx_info *info;
@@ -1094,9 +1115,15 @@ static bool sta_info_buffer_expired(struct sta_info *sta, struct sk_buff *skb)
 static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 						struct sta_info *sta, int ac)
 {
+	bool expired = false;
 	unsigned long flags;
 	struct sk_buff *skb;
 
+	/* Most dozing stations have nothing buffered on most ACs */
+	if (skb_queue_empty_lockless(&sta->tx_filtered[ac]) &&
+	    skb_queue_empty_lockless(&sta->ps_tx_buf[ac]))
+		return false;
+
 	/*
 	 * First check for frames that should expire on the filtered
 	 * queue. Frames here were rejected by the driver and are on
@@ -1122,6 +1149,7 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 		if (!skb)
 			break;
 		ieee80211_free_txskb(&local->hw, skb);
+		expired = true;
 	}
 
 	/*
@@ -1151,6 +1179,7 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 		ps_dbg(sta->sdata, "Buffered frame expired (STA %pM)\n",
 		       sta->sta.addr);
 		ieee80211_free_txskb(&local->hw, skb);
+		expired = true;
 	}
 
 	/*
@@ -1158,7 +1187,8 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 	 * now be clear because the station was too slow to retrieve its
 	 * frames.
 	 */
-	sta_info_recalc_tim(sta);
+	if (expired)
+		sta_info_recalc_tim(sta);
 
 	/*
 	 * Return whether there are any frames still buffered, this is
@@ -794,6 +794,9 @@ rcu_dereference_protected_tid_tx(struct sta_info *sta, int tid)
 /* Maximum number of frames to buffer per power saving station per AC */
 #define STA_MAX_TX_BUFFER	64
 
+/* Lower bound of the above when it is shared between many dozing stations */
+#define STA_MIN_TX_BUFFER	8
+
 /* Minimum buffered frame expiry time. If STA uses listen interval that is
  * smaller than this value, the minimum value here is used instead. */
 #define STA_TX_BUFFER_EXPIRE (10 * HZ)
@@ -869,7 +872,9 @@ int sta_info_destroy_addr(struct ieee80211_sub_if_data *sdata,
 int sta_info_destroy_addr_bss(struct ieee80211_sub_if_data *sdata,
 			      const u8 *addr);
 
+struct ps_data *sta_info_ps_data(struct sta_info *sta);
 void sta_info_recalc_tim(struct sta_info *sta);
+void sta_info_recalc_tim_buffered(struct sta_info *sta);
 
 int sta_info_init(struct ieee80211_local *local);
 void sta_info_stop(struct ieee80211_local *local);
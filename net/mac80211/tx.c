@@ -470,6 +470,23 @@ static int ieee80211_use_mfp(__le16 fc, struct sta_info *sta,
 	return 1;
 }
 
+/*
+ * With many dozing stations the per-station limit alone lets the total
+ * reach TOTAL_MAX_TX_BUFFER, and from then on every buffered frame walks
+ * all stations in purge_old_ps_buffers(). Share the total between the
+ * stations that are asleep so each drops its own oldest frame first.
+ */
+static int ieee80211_sta_ps_buf_limit(struct sta_info *sta)
+{
+	struct ps_data *ps = sta_info_ps_data(sta);
+	int n = ps ? atomic_read(&ps->num_sta_ps) : 0;
+
+	if (n <= TOTAL_MAX_TX_BUFFER / STA_MAX_TX_BUFFER)
+		return STA_MAX_TX_BUFFER;
+
+	return max_t(int, TOTAL_MAX_TX_BUFFER / n, STA_MIN_TX_BUFFER);
+}
+
 static ieee80211_tx_result
 ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 {
@@ -512,7 +529,8 @@ ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 			return TX_CONTINUE;
 		}
 
-		if (skb_queue_len(&sta->ps_tx_buf[ac]) >= STA_MAX_TX_BUFFER) {
+		if (skb_queue_len(&sta->ps_tx_buf[ac]) >=
+		    ieee80211_sta_ps_buf_limit(sta)) {
 			struct sk_buff *old = skb_dequeue(&sta->ps_tx_buf[ac]);
 			ps_dbg(tx->sdata,
 			       "STA %pM TX buffer for AC %d full - dropping oldest frame\n",
@@ -537,7 +555,7 @@ ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 		 * We queued up some frames, so the TIM bit might
 		 * need to be set, recalculate it.
 		 */
-		sta_info_recalc_tim(sta);
+		sta_info_recalc_tim_buffered(sta);
 
 		return TX_QUEUED;
 	} else if (unlikely(test_sta_flag(sta, WLAN_STA_PS_STA))) {
@@ -4324,6 +4342,55 @@ static bool ieee80211_multicast_to_unicast(struct sk_buff *skb,
 	return true;
 }
 
+static bool ieee80211_unicast_sta(struct ieee80211_sub_if_data *sdata,
+				  struct sta_info *sta,
+				  const struct ethhdr *eth)
+{
+	if (sdata != sta->sdata)
+		/* AP-VLAN mismatch */
+		return false;
+	if (unlikely(ether_addr_equal(eth->h_source, sta->sta.addr)))
+		/* do not send back to source */
+		return false;
+	/* data to unauthorized stations would be dropped anyway */
+	return test_sta_flag(sta, WLAN_STA_AUTHORIZED);
+}
+
+/*
+ * Compare the expected airtime of one copy per station, at each station's
+ * current TX rate, against a single multicast frame at the basic rate.
+ * Stations without a rate estimate yet are charged the multicast cost.
+ * Must be called under RCU.
+ */
+static bool ieee80211_unicast_affordable(struct ieee80211_sub_if_data *sdata,
+					 struct sk_buff *skb, u16 max_pct)
+{
+	struct ieee80211_local *local = sdata->local;
+	const struct ethhdr *eth = (struct ethhdr *)skb->data;
+	struct sta_info *sta;
+	u64 mc, uc = 0;
+	u32 airtime;
+
+	mc = ieee80211_calc_expected_tx_airtime(&local->hw, &sdata->vif, NULL,
+						skb->len, false);
+	if (!mc)
+		return true;
+
+	list_for_each_entry_rcu(sta, &local->sta_list, list) {
+		if (!ieee80211_unicast_sta(sdata, sta, eth))
+			continue;
+		airtime = ieee80211_calc_expected_tx_airtime(&local->hw,
+							     &sdata->vif,
+							     &sta->sta,
+							     skb->len, false);
+		uc += airtime ?: mc;
+		if (uc * 100 > mc * max_pct)
+			return false;
+	}
+
+	return true;
+}
+
 static void
 ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 			     struct sk_buff_head *queue)
@@ -4331,17 +4398,17 @@ ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 	struct ieee80211_sub_if_data *sdata = IEEE80211_DEV_TO_SUB_IF(dev);
 	struct ieee80211_local *local = sdata->local;
 	const struct ethhdr *eth = (struct ethhdr *)skb->data;
+	u16 max_pct = sdata->bss->multicast_to_unicast_airtime;
 	struct sta_info *sta, *first = NULL;
 	struct sk_buff *cloned_skb;
 
 	rcu_read_lock();
 
+	if (max_pct && !ieee80211_unicast_affordable(sdata, skb, max_pct))
+		goto multicast;
+
 	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		if (sdata != sta->sdata)
-			/* AP-VLAN mismatch */
-			continue;
-		if (unlikely(ether_addr_equal(eth->h_source, sta->sta.addr)))
-			/* do not send back to source */
+		if (!ieee80211_unicast_sta(sdata, sta, eth))
 			continue;
 		if (!first) {
 			first = sta;
@@ -15,6 +15,7 @@
 #include <linux/netfilter.h>
 #include <linux/module.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/skbuff.h>
 #include <linux/proc_fs.h>
 #include <linux/vmalloc.h>
@@ -93,7 +94,7 @@ static DEFINE_MUTEX(nf_conntrack_mutex);
 #define GC_SCAN_INITIAL_COUNT	100
 #define GC_SCAN_INTERVAL_INIT	GC_SCAN_INTERVAL_MAX
 
-#define GC_SCAN_MAX_DURATION	msecs_to_jiffies(10)
+#define GC_SCAN_MAX_DURATION_US	2000u
 #define GC_SCAN_EXPIRED_MAX	(64000u / HZ)
 
 #define MIN_CHAINLEN	50u
@@ -204,6 +205,10 @@ EXPORT_SYMBOL_GPL(nf_conntrack_htable_size);
 
 unsigned int nf_conntrack_max __read_mostly;
 EXPORT_SYMBOL_GPL(nf_conntrack_max);
+
+unsigned int nf_conntrack_gc_budget_us __read_mostly = GC_SCAN_MAX_DURATION_US;
+u8 nf_conntrack_gc_lazy __read_mostly;
+unsigned long nf_conntrack_gc_hist[NF_CT_GC_HIST_NUM];
 seqcount_spinlock_t nf_conntrack_generation __read_mostly;
 static siphash_aligned_key_t nf_conntrack_hash_rnd;
 
@@ -1372,7 +1377,8 @@ EXPORT_SYMBOL_GPL(nf_conntrack_tuple_taken);
 /* There's a small race here where we may free a just-assured
    connection.  Too bad: we're in trouble anyway. */
 static unsigned int early_drop_list(struct net *net,
-				    struct hlist_nulls_head *head)
+				    struct hlist_nulls_head *head,
+				    const struct nf_conntrack_zone *zone)
 {
 	struct nf_conntrack_tuple_hash *h;
 	struct hlist_nulls_node *n;
@@ -1395,6 +1401,9 @@ static unsigned int early_drop_list(struct net *net,
 		    nf_ct_is_dying(tmp))
 			continue;
 
+		if (zone && !nf_ct_zone_equal_any(tmp, zone))
+			continue;
+
 		if (!refcount_inc_not_zero(&tmp->ct_general.use))
 			continue;
 
@@ -1419,7 +1428,9 @@ static unsigned int early_drop_list(struct net *net,
 	return drops;
 }
 
-static noinline int early_drop(struct net *net, unsigned int hash)
+/* @zone restricts eviction to entries of that zone, NULL means any. */
+static noinline int early_drop(struct net *net, unsigned int hash,
+			       const struct nf_conntrack_zone *zone)
 {
 	unsigned int i, bucket;
 
@@ -1434,7 +1445,7 @@ static noinline int early_drop(struct net *net, unsigned int hash)
 		else
 			bucket = (bucket + 1) % hsize;
 
-		drops = early_drop_list(net, &ct_hash[bucket]);
+		drops = early_drop_list(net, &ct_hash[bucket], zone);
 		rcu_read_unlock();
 
 		if (drops) {
@@ -1465,12 +1476,26 @@ static bool gc_worker_can_early_drop(const struct nf_conn *ct)
 	return false;
 }
 
+static void gc_worker_account(u64 start_ns)
+{
+	unsigned int us, bucket = 0;
+
+	us = div_u64(local_clock() - start_ns, NSEC_PER_USEC);
+	if (us >= 32)
+		bucket = min_t(unsigned int, ilog2(us) - 4,
+			       NF_CT_GC_HIST_NUM - 1);
+
+	WRITE_ONCE(nf_conntrack_gc_hist[bucket],
+		   nf_conntrack_gc_hist[bucket] + 1);
+}
+
 static void gc_worker(struct work_struct *work)
 {
 	unsigned int i, hashsz, nf_conntrack_max95 = 0;
-	u32 end_time, start_time = nfct_time_stamp;
+	u32 start_time = nfct_time_stamp;
 	struct conntrack_gc_work *gc_work;
 	unsigned int expired_count = 0;
+	u64 start_ns, budget_ns;
 	unsigned long next_run;
 	s32 delta_time;
 	long count;
@@ -1490,7 +1515,11 @@ static void gc_worker(struct work_struct *work)
 	next_run = gc_work->avg_timeout;
 	count = gc_work->count;
 
-	end_time = start_time + GC_SCAN_MAX_DURATION;
+	/* Checked once per bucket: jiffies are too coarse for this on
+	 * low HZ kernels, a single run could last two ticks.
+	 */
+	budget_ns = (u64)READ_ONCE(nf_conntrack_gc_budget_us) * NSEC_PER_USEC;
+	start_ns = local_clock();
 
 	do {
 		struct nf_conntrack_tuple_hash *h;
@@ -1578,8 +1607,7 @@ static void gc_worker(struct work_struct *work)
 		cond_resched();
 		i++;
 
-		delta_time = nfct_time_stamp - end_time;
-		if (delta_time > 0 && i < hashsz) {
+		if (local_clock() - start_ns > budget_ns && i < hashsz) {
 			gc_work->avg_timeout = next_run;
 			gc_work->count = count;
 			gc_work->next_bucket = i;
@@ -1590,6 +1618,13 @@ static void gc_worker(struct work_struct *work)
 
 	gc_work->next_bucket = 0;
 
+	/* In lazy mode expired entries are mostly reaped by lookups
+	 * walking their chain, the worker is only a backstop for idle
+	 * flows so it doesn't speed up for short timeouts.
+	 */
+	if (READ_ONCE(nf_conntrack_gc_lazy) && !gc_work->early_drop)
+		next_run = GC_SCAN_INTERVAL_MAX;
+
 	next_run = clamp(next_run, GC_SCAN_INTERVAL_MIN, GC_SCAN_INTERVAL_MAX);
 
 	delta_time = max_t(s32, nfct_time_stamp - gc_work->start_time, 1);
@@ -1599,6 +1634,8 @@ static void gc_worker(struct work_struct *work)
 		next_run = 1;
 
 early_exit:
+	gc_worker_account(start_ns);
+
 	if (gc_work->exiting)
 		return;
 
@@ -1614,6 +1651,100 @@ static void conntrack_gc_work_init(struct conntrack_gc_work *gc_work)
 	gc_work->exiting = false;
 }
 
+#ifdef CONFIG_NF_CONNTRACK_ZONES
+/* Entry counters for non-default zones, created on first use. */
+static atomic_t *nf_ct_zone_counter(struct nf_conntrack_net *cnet, u16 id,
+				    gfp_t gfp)
+{
+	atomic_t *count, *old;
+
+	count = xa_load(&cnet->zone_count, id);
+	if (likely(count))
+		return count;
+
+	count = kzalloc(sizeof(*count), gfp);
+	if (!count)
+		return NULL;
+
+	old = xa_cmpxchg(&cnet->zone_count, id, NULL, count, gfp);
+	if (old) {
+		kfree(count);
+		return xa_is_err(old) ? NULL : old;
+	}
+
+	return count;
+}
+
+static bool nf_ct_zone_charge(struct net *net,
+			      const struct nf_conntrack_zone *zone,
+			      u32 hash, gfp_t gfp)
+{
+	struct nf_conntrack_net *cnet = nf_ct_pernet(net);
+	unsigned int zone_max, zone_count;
+	atomic_t *count;
+
+	if (zone->id == NF_CT_DEFAULT_ZONE_ID)
+		return true;
+
+	count = nf_ct_zone_counter(cnet, zone->id, gfp);
+	if (!count)
+		return false;
+
+	zone_count = atomic_inc_return(count);
+	zone_max = READ_ONCE(cnet->zone_max);
+	if (zone_max && unlikely(zone_count > zone_max)) {
+		if (!early_drop(net, hash, zone)) {
+			atomic_dec(count);
+			net_warn_ratelimited("nf_conntrack: zone %u full, dropping packet\n",
+					     zone->id);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void nf_ct_zone_uncharge(struct net *net,
+				const struct nf_conntrack_zone *zone)
+{
+	struct nf_conntrack_net *cnet = nf_ct_pernet(net);
+	atomic_t *count;
+
+	if (zone->id == NF_CT_DEFAULT_ZONE_ID)
+		return;
+
+	count = xa_load(&cnet->zone_count, zone->id);
+	if (count)
+		atomic_dec(count);
+}
+
+static void nf_ct_zone_count_destroy(struct nf_conntrack_net *cnet)
+{
+	unsigned long id;
+	atomic_t *count;
+
+	xa_for_each(&cnet->zone_count, id, count)
+		kfree(count);
+	xa_destroy(&cnet->zone_count);
+}
+#else
+static bool nf_ct_zone_charge(struct net *net,
+			      const struct nf_conntrack_zone *zone,
+			      u32 hash, gfp_t gfp)
+{
+	return true;
+}
+
+static void nf_ct_zone_uncharge(struct net *net,
+				const struct nf_conntrack_zone *zone)
+{
+}
+
+static void nf_ct_zone_count_destroy(struct nf_conntrack_net *cnet)
+{
+}
+#endif
+
 static struct nf_conn *
 __nf_conntrack_alloc(struct net *net,
 		     const struct nf_conntrack_zone *zone,
@@ -1629,7 +1760,7 @@ __nf_conntrack_alloc(struct net *net,
 	ct_count = atomic_inc_return(&cnet->count);
 
 	if (nf_conntrack_max && unlikely(ct_count > nf_conntrack_max)) {
-		if (!early_drop(net, hash)) {
+		if (!early_drop(net, hash, NULL)) {
 			if (!conntrack_gc_work.early_drop)
 				conntrack_gc_work.early_drop = true;
 			atomic_dec(&cnet->count);
@@ -1638,13 +1769,16 @@ __nf_conntrack_alloc(struct net *net,
 		}
 	}
 
+	if (!nf_ct_zone_charge(net, zone, hash, gfp))
+		goto out;
+
 	/*
 	 * Do not use kmem_cache_zalloc(), as this cache uses
 	 * SLAB_TYPESAFE_BY_RCU.
 	 */
 	ct = kmem_cache_alloc(nf_conntrack_cachep, gfp);
 	if (ct == NULL)
-		goto out;
+		goto out_zone;
 
 	spin_lock_init(&ct->lock);
 	ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple = *orig;
@@ -1664,6 +1798,8 @@ __nf_conntrack_alloc(struct net *net,
 	 */
 	refcount_set(&ct->ct_general.use, 0);
 	return ct;
+out_zone:
+	nf_ct_zone_uncharge(net, zone);
 out:
 	atomic_dec(&cnet->count);
 	return ERR_PTR(-ENOMEM);
@@ -1699,6 +1835,7 @@ void nf_conntrack_free(struct nf_conn *ct)
 		rcu_read_unlock();
 	}
 
+	nf_ct_zone_uncharge(net, nf_ct_zone(ct));
 	kfree(ct->ext);
 	kmem_cache_free(nf_conntrack_cachep, ct);
 	cnet = nf_ct_pernet(net);
@@ -2582,6 +2719,7 @@ i_see_dead_people:
 	list_for_each_entry(net, net_exit_list, exit_list) {
 		nf_conntrack_ecache_pernet_fini(net);
 		nf_conntrack_expect_pernet_fini(net);
+		nf_ct_zone_count_destroy(nf_ct_pernet(net));
 		free_percpu(net->ct.stat);
 	}
 }
@@ -2810,6 +2948,9 @@ int nf_conntrack_init_net(struct net *net)
 	BUILD_BUG_ON(IP_CT_UNTRACKED == IP_CT_NUMBER);
 	BUILD_BUG_ON_NOT_POWER_OF_2(CONNTRACK_LOCKS);
 	atomic_set(&cnet->count, 0);
+#ifdef CONFIG_NF_CONNTRACK_ZONES
+	xa_init(&cnet->zone_count);
+#endif
 
 	net->ct.stat = alloc_percpu(struct ip_conntrack_stat);
 	if (!net->ct.stat)
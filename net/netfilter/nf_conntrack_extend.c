@@ -26,6 +26,7 @@
 #include <net/netfilter/nf_nat.h>
 
 #define NF_CT_EXT_PREALLOC	128u /* conntrack events are on by default */
+#define NF_CT_EXT_PREALLOC_COMPACT	64u /* events + nat, no helper */
 
 atomic_t nf_conntrack_ext_genid __read_mostly = ATOMIC_INIT(1);
 
@@ -89,6 +90,23 @@ static __always_inline unsigned int total_extension_size(void)
 	;
 }
 
+/* UDP and ICMP entries almost never pick up a helper, seqadj or synproxy
+ * area: use a smaller initial allocation for them, they are the bulk of
+ * the table on a busy gateway.
+ */
+static unsigned int nf_ct_ext_prealloc(const struct nf_conn *ct)
+{
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_UDP:
+	case IPPROTO_UDPLITE:
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		return NF_CT_EXT_PREALLOC_COMPACT;
+	}
+
+	return NF_CT_EXT_PREALLOC;
+}
+
 void *nf_ct_ext_add(struct nf_conn *ct, enum nf_ct_ext_id id, gfp_t gfp)
 {
 	unsigned int newlen, newoff, oldlen, alloc;
@@ -113,7 +131,7 @@ void *nf_ct_ext_add(struct nf_conn *ct, enum nf_ct_ext_id id, gfp_t gfp)
 	newoff = ALIGN(oldlen, __alignof__(struct nf_ct_ext));
 	newlen = newoff + nf_ct_ext_type_len[id];
 
-	alloc = max(newlen, NF_CT_EXT_PREALLOC);
+	alloc = max(newlen, nf_ct_ext_prealloc(ct));
 	new = krealloc(ct->ext, alloc, gfp);
 	if (!new)
 		return NULL;
@@ -723,44 +723,20 @@ static size_t ctnetlink_nlmsg_size(const struct nf_conn *ct)
 }
 
 static int
-ctnetlink_conntrack_event(unsigned int events, const struct nf_ct_event *item)
+ctnetlink_conntrack_fill_event(struct sk_buff *skb, unsigned int events,
+			       const struct nf_ct_event *item,
+			       unsigned int type, unsigned int flags)
 {
 	const struct nf_conntrack_zone *zone;
-	struct net *net;
 	struct nlmsghdr *nlh;
 	struct nlattr *nest_parms;
 	struct nf_conn *ct = item->ct;
-	struct sk_buff *skb;
-	unsigned int type;
-	unsigned int flags = 0, group;
-	int err;
-
-	if (events & (1 << IPCT_DESTROY)) {
-		type = IPCTNL_MSG_CT_DELETE;
-		group = NFNLGRP_CONNTRACK_DESTROY;
-	} else if (events & ((1 << IPCT_NEW) | (1 << IPCT_RELATED))) {
-		type = IPCTNL_MSG_CT_NEW;
-		flags = NLM_F_CREATE|NLM_F_EXCL;
-		group = NFNLGRP_CONNTRACK_NEW;
-	} else if (events) {
-		type = IPCTNL_MSG_CT_NEW;
-		group = NFNLGRP_CONNTRACK_UPDATE;
-	} else
-		return 0;
-
-	net = nf_ct_net(ct);
-	if (!item->report && !nfnetlink_has_listeners(net, group))
-		return 0;
-
-	skb = nlmsg_new(ctnetlink_nlmsg_size(ct), GFP_ATOMIC);
-	if (skb == NULL)
-		goto errout;
 
 	type = nfnl_msg_type(NFNL_SUBSYS_CTNETLINK, type);
 	nlh = nfnl_msg_put(skb, item->portid, 0, type, flags, nf_ct_l3num(ct),
 			   NFNETLINK_V0, 0);
 	if (!nlh)
-		goto nlmsg_failure;
+		return -EMSGSIZE;
 
 	zone = nf_ct_zone(ct);
 
@@ -841,6 +817,191 @@ ctnetlink_conntrack_event(unsigned int events, const struct nf_ct_event *item)
 		goto nla_put_failure;
 #endif
 	nlmsg_end(skb, nlh);
+	return 0;
+
+nla_put_failure:
+	nlmsg_cancel(skb, nlh);
+	return -EMSGSIZE;
+}
+
+/*
+ * Destroy events nobody asked for explicitly (no report portid) can be
+ * packed several to a datagram: a flow logger then gets one wakeup per
+ * batch instead of one per flow, and a reconnect storm is much less
+ * likely to overrun its socket. Off by default; a batch is sent when
+ * it holds event_batch messages, when the skb is full or after
+ * event_batch_ms.
+ */
+static unsigned int event_batch __read_mostly;
+module_param(event_batch, uint, 0644);
+MODULE_PARM_DESC(event_batch,
+		 "Destroy events per netlink datagram (0 or 1 disables batching)");
+
+static unsigned int event_batch_ms __read_mostly = 10;
+module_param(event_batch_ms, uint, 0644);
+MODULE_PARM_DESC(event_batch_ms, "Maximum delay of a batched destroy event");
+
+struct ctnetlink_evbatch {
+	spinlock_t		lock;
+	struct sk_buff		*skb;
+	struct net		*net;
+	unsigned int		count;
+	struct timer_list	timer;
+};
+
+static DEFINE_PER_CPU(struct ctnetlink_evbatch, ctnetlink_evbatch);
+
+/* Called with b->lock held */
+static void ctnetlink_evbatch_flush(struct ctnetlink_evbatch *b)
+{
+	struct sk_buff *skb = b->skb;
+
+	if (!skb)
+		return;
+
+	b->skb = NULL;
+	b->count = 0;
+	del_timer(&b->timer);
+
+	/* The listeners see an overrun on their socket if this fails */
+	nfnetlink_send(skb, b->net, 0, NFNLGRP_CONNTRACK_DESTROY, 0,
+		       GFP_ATOMIC);
+	b->net = NULL;
+}
+
+static void ctnetlink_evbatch_timer(struct timer_list *t)
+{
+	struct ctnetlink_evbatch *b = from_timer(b, t, timer);
+
+	spin_lock(&b->lock);
+	ctnetlink_evbatch_flush(b);
+	spin_unlock(&b->lock);
+}
+
+static int ctnetlink_evbatch_add(struct net *net, unsigned int events,
+				 const struct nf_ct_event *item)
+{
+	struct ctnetlink_evbatch *b = raw_cpu_ptr(&ctnetlink_evbatch);
+	int err = 0;
+
+	spin_lock_bh(&b->lock);
+
+	if (b->skb && !net_eq(b->net, net))
+		ctnetlink_evbatch_flush(b);
+
+	if (b->skb &&
+	    ctnetlink_conntrack_fill_event(b->skb, events, item,
+					   IPCTNL_MSG_CT_DELETE, 0) < 0)
+		ctnetlink_evbatch_flush(b);
+
+	if (!b->skb) {
+		b->skb = nlmsg_new(max_t(size_t, NLMSG_DEFAULT_SIZE,
+					 ctnetlink_nlmsg_size(item->ct)),
+				   GFP_ATOMIC);
+		if (!b->skb) {
+			err = -ENOMEM;
+			goto out;
+		}
+		b->net = net;
+
+		err = ctnetlink_conntrack_fill_event(b->skb, events, item,
+						     IPCTNL_MSG_CT_DELETE, 0);
+		if (err < 0) {
+			kfree_skb(b->skb);
+			b->skb = NULL;
+			b->net = NULL;
+			goto out;
+		}
+	}
+
+	if (++b->count >= READ_ONCE(event_batch))
+		ctnetlink_evbatch_flush(b);
+	else if (b->count == 1)
+		mod_timer(&b->timer, jiffies +
+			  msecs_to_jiffies(READ_ONCE(event_batch_ms)));
+out:
+	spin_unlock_bh(&b->lock);
+	return err;
+}
+
+static void ctnetlink_evbatch_flush_net(struct net *net)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ctnetlink_evbatch *b = per_cpu_ptr(&ctnetlink_evbatch,
+							  cpu);
+
+		spin_lock_bh(&b->lock);
+		if (b->skb && (!net || net_eq(b->net, net)))
+			ctnetlink_evbatch_flush(b);
+		spin_unlock_bh(&b->lock);
+	}
+}
+
+static void ctnetlink_evbatch_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ctnetlink_evbatch *b = per_cpu_ptr(&ctnetlink_evbatch,
+							  cpu);
+
+		spin_lock_init(&b->lock);
+		timer_setup(&b->timer, ctnetlink_evbatch_timer, 0);
+	}
+}
+
+static void ctnetlink_evbatch_exit(void)
+{
+	int cpu;
+
+	ctnetlink_evbatch_flush_net(NULL);
+	for_each_possible_cpu(cpu)
+		del_timer_sync(&per_cpu_ptr(&ctnetlink_evbatch, cpu)->timer);
+}
+
+static int
+ctnetlink_conntrack_event(unsigned int events, const struct nf_ct_event *item)
+{
+	struct net *net;
+	struct nf_conn *ct = item->ct;
+	struct sk_buff *skb;
+	unsigned int type;
+	unsigned int flags = 0, group;
+	int err;
+
+	if (events & (1 << IPCT_DESTROY)) {
+		type = IPCTNL_MSG_CT_DELETE;
+		group = NFNLGRP_CONNTRACK_DESTROY;
+	} else if (events & ((1 << IPCT_NEW) | (1 << IPCT_RELATED))) {
+		type = IPCTNL_MSG_CT_NEW;
+		flags = NLM_F_CREATE|NLM_F_EXCL;
+		group = NFNLGRP_CONNTRACK_NEW;
+	} else if (events) {
+		type = IPCTNL_MSG_CT_NEW;
+		group = NFNLGRP_CONNTRACK_UPDATE;
+	} else
+		return 0;
+
+	net = nf_ct_net(ct);
+	if (!item->report && !nfnetlink_has_listeners(net, group))
+		return 0;
+
+	if (group == NFNLGRP_CONNTRACK_DESTROY && !item->report &&
+	    READ_ONCE(event_batch) > 1) {
+		if (!ctnetlink_evbatch_add(net, events, item))
+			return 0;
+		goto errout;
+	}
+
+	skb = nlmsg_new(ctnetlink_nlmsg_size(ct), GFP_ATOMIC);
+	if (skb == NULL)
+		goto errout;
+
+	if (ctnetlink_conntrack_fill_event(skb, events, item, type, flags) < 0)
+		goto nla_put_failure;
+
 	err = nfnetlink_send(skb, net, item->portid, group, item->report,
 			     GFP_ATOMIC);
 	if (err == -ENOBUFS || err == -EAGAIN)
@@ -849,8 +1010,6 @@ ctnetlink_conntrack_event(unsigned int events, const struct nf_ct_event *item)
 	return 0;
 
 nla_put_failure:
-	nlmsg_cancel(skb, nlh);
-nlmsg_failure:
 	kfree_skb(skb);
 errout:
 	if (nfnetlink_set_err(net, 0, group, -ENOBUFS) > 0)
@@ -3861,9 +4020,18 @@ static void ctnetlink_net_pre_exit(struct net *net)
 #endif
 }
 
+/* Runs after an RCU grace period, no new events can be batched */
+static void ctnetlink_net_exit(struct net *net)
+{
+#ifdef CONFIG_NF_CONNTRACK_EVENTS
+	ctnetlink_evbatch_flush_net(net);
+#endif
+}
+
 static struct pernet_operations ctnetlink_net_ops = {
 	.init		= ctnetlink_net_init,
 	.pre_exit	= ctnetlink_net_pre_exit,
+	.exit		= ctnetlink_net_exit,
 };
 
 static int __init ctnetlink_init(void)
@@ -3884,6 +4052,9 @@ static int __init ctnetlink_init(void)
 		goto err_unreg_subsys;
 	}
 
+#ifdef CONFIG_NF_CONNTRACK_EVENTS
+	ctnetlink_evbatch_init();
+#endif
 	ret = register_pernet_subsys(&ctnetlink_net_ops);
 	if (ret < 0) {
 		pr_err("ctnetlink_init: cannot register pernet operations\n");
@@ -3906,6 +4077,9 @@ err_out:
 static void __exit ctnetlink_exit(void)
 {
 	unregister_pernet_subsys(&ctnetlink_net_ops);
+#ifdef CONFIG_NF_CONNTRACK_EVENTS
+	ctnetlink_evbatch_exit();
+#endif
 	nfnetlink_subsys_unregister(&ctnl_exp_subsys);
 	nfnetlink_subsys_unregister(&ctnl_subsys);
 #ifdef CONFIG_NETFILTER_NETLINK_GLUE_CT
@@ -472,6 +472,19 @@ static const struct seq_operations ct_cpu_seq_ops = {
 	.show	= ct_cpu_seq_show,
 };
 
+static int ct_gc_seq_show(struct seq_file *seq, void *v)
+{
+	int i;
+
+	seq_puts(seq, "<32us 32us 64us 128us 256us 512us 1ms 2ms+\n");
+	for (i = 0; i < NF_CT_GC_HIST_NUM; i++)
+		seq_printf(seq, "%s%lu", i ? " " : "",
+			   READ_ONCE(nf_conntrack_gc_hist[i]));
+	seq_putc(seq, '\n');
+
+	return 0;
+}
+
 static int nf_conntrack_standalone_init_proc(struct net *net)
 {
 	struct proc_dir_entry *pde;
@@ -492,8 +505,19 @@ static int nf_conntrack_standalone_init_proc(struct net *net)
 			&ct_cpu_seq_ops, sizeof(struct seq_net_private));
 	if (!pde)
 		goto out_stat_nf_conntrack;
+
+	/* the gc worker is shared by all namespaces */
+	if (net_eq(net, &init_net)) {
+		pde = proc_create_net_single("nf_conntrack_gc", 0444,
+					     net->proc_net_stat,
+					     ct_gc_seq_show, NULL);
+		if (!pde)
+			goto out_stat_nf_conntrack_gc;
+	}
 	return 0;
 
+out_stat_nf_conntrack_gc:
+	remove_proc_entry("nf_conntrack", net->proc_net_stat);
 out_stat_nf_conntrack:
 	remove_proc_entry("nf_conntrack", net->proc_net);
 out_nf_conntrack:
@@ -502,6 +526,8 @@ out_nf_conntrack:
 
 static void nf_conntrack_standalone_fini_proc(struct net *net)
 {
+	if (net_eq(net, &init_net))
+		remove_proc_entry("nf_conntrack_gc", net->proc_net_stat);
 	remove_proc_entry("nf_conntrack", net->proc_net_stat);
 	remove_proc_entry("nf_conntrack", net->proc_net);
 }
@@ -561,11 +587,16 @@ enum nf_ct_sysctl_index {
 	NF_SYSCTL_CT_LOG_INVALID,
 	NF_SYSCTL_CT_EXPECT_MAX,
 	NF_SYSCTL_CT_ACCT,
+	NF_SYSCTL_CT_GC_BUDGET,
+	NF_SYSCTL_CT_GC_LAZY,
 #ifdef CONFIG_NF_CONNTRACK_EVENTS
 	NF_SYSCTL_CT_EVENTS,
 #endif
 #ifdef CONFIG_NF_CONNTRACK_TIMESTAMP
 	NF_SYSCTL_CT_TIMESTAMP,
+#endif
+#ifdef CONFIG_NF_CONNTRACK_ZONES
+	NF_SYSCTL_CT_ZONE_MAX,
 #endif
 	NF_SYSCTL_CT_PROTO_TIMEOUT_GENERIC,
 	NF_SYSCTL_CT_PROTO_TIMEOUT_TCP_SYN_SENT,
@@ -678,6 +709,23 @@ static struct ctl_table nf_ct_sysctl_table[] = {
 		.extra1 	= SYSCTL_ZERO,
 		.extra2 	= SYSCTL_ONE,
 	},
+	[NF_SYSCTL_CT_GC_BUDGET] = {
+		.procname	= "nf_conntrack_gc_budget_us",
+		.data		= &nf_conntrack_gc_budget_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ONE,
+	},
+	[NF_SYSCTL_CT_GC_LAZY] = {
+		.procname	= "nf_conntrack_gc_lazy",
+		.data		= &nf_conntrack_gc_lazy,
+		.maxlen		= sizeof(u8),
+		.mode		= 0644,
+		.proc_handler	= proc_dou8vec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 #ifdef CONFIG_NF_CONNTRACK_EVENTS
 	[NF_SYSCTL_CT_EVENTS] = {
 		.procname	= "nf_conntrack_events",
@@ -699,6 +747,14 @@ static struct ctl_table nf_ct_sysctl_table[] = {
 		.extra1 	= SYSCTL_ZERO,
 		.extra2 	= SYSCTL_ONE,
 	},
+#endif
+#ifdef CONFIG_NF_CONNTRACK_ZONES
+	[NF_SYSCTL_CT_ZONE_MAX] = {
+		.procname	= "nf_conntrack_zone_max",
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
 #endif
 	[NF_SYSCTL_CT_PROTO_TIMEOUT_GENERIC] = {
 		.procname	= "nf_conntrack_generic_timeout",
@@ -1088,6 +1144,9 @@ static int nf_conntrack_standalone_init_sysctl(struct net *net)
 #endif
 #ifdef CONFIG_NF_CONNTRACK_TIMESTAMP
 	table[NF_SYSCTL_CT_TIMESTAMP].data = &net->ct.sysctl_tstamp;
+#endif
+#ifdef CONFIG_NF_CONNTRACK_ZONES
+	table[NF_SYSCTL_CT_ZONE_MAX].data = &cnet->zone_max;
 #endif
 	table[NF_SYSCTL_CT_PROTO_TIMEOUT_GENERIC].data = &nf_generic_pernet(net)->timeout;
 	table[NF_SYSCTL_CT_PROTO_TIMEOUT_ICMP].data = &nf_icmp_pernet(net)->timeout;
@@ -1107,6 +1166,8 @@ static int nf_conntrack_standalone_init_sysctl(struct net *net)
 	if (!net_eq(&init_net, net)) {
 		table[NF_SYSCTL_CT_MAX].mode = 0444;
 		table[NF_SYSCTL_CT_EXPECT_MAX].mode = 0444;
+		table[NF_SYSCTL_CT_GC_BUDGET].mode = 0444;
+		table[NF_SYSCTL_CT_GC_LAZY].mode = 0444;
 		table[NF_SYSCTL_CT_BUCKETS].mode = 0444;
 	}
 
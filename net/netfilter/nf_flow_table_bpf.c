@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Unstable Flow Table Helpers for XDP hook
+ *
+ * These are called from the XDP programs. Note that it is allowed to break
+ * compatibility for these functions since the interface they are exposed
+ * through to BPF programs is explicitly unstable.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/filter.h>
+#include <linux/netdevice.h>
+#include <net/xdp.h>
+#include <net/netfilter/nf_flow_table.h>
+#include <net/netfilter/nf_conntrack_acct.h>
+
+/* bpf_flowtable_opts - options for bpf flowtable helpers
+ * @error: out parameter, set for any encountered error
+ *	   Values:
+ *	     -EINVAL - opts__sz isn't NF_BPF_FLOWTABLE_OPTS_SZ (4)
+ *	     -EAFNOSUPPORT - family isn't one of AF_INET or AF_INET6
+ *	     -ENOENT - no flowtable on the device or no flow for the tuple
+ *	     -EOPNOTSUPP - the flow can only be transmitted through xfrm
+ */
+struct bpf_flowtable_opts {
+	s32 error;
+};
+
+enum {
+	NF_BPF_FLOWTABLE_OPTS_SZ = 4,
+};
+
+static struct flow_offload_tuple_rhash *
+bpf_xdp_flow_tuple_lookup(struct xdp_buff *xdp,
+			  struct flow_offload_tuple *tuple)
+{
+	struct flow_offload_tuple_rhash *tuplehash;
+	struct nf_flowtable *nf_flow_table;
+	struct flow_offload *nf_flow;
+	u32 len;
+
+	nf_flow_table = nf_flowtable_by_dev(xdp->rxq->dev);
+	if (!nf_flow_table)
+		return ERR_PTR(-ENOENT);
+
+	tuplehash = flow_offload_lookup(nf_flow_table, tuple);
+	if (!tuplehash)
+		return ERR_PTR(-ENOENT);
+
+	nf_flow = container_of(tuplehash, struct flow_offload,
+			       tuplehash[tuplehash->tuple.dir]);
+
+	switch (tuplehash->tuple.xmit_type) {
+	case FLOW_OFFLOAD_XMIT_XFRM:
+		return ERR_PTR(-EOPNOTSUPP);
+	case FLOW_OFFLOAD_XMIT_NEIGH:
+		if (!dst_check(tuplehash->tuple.dst_cache,
+			       tuplehash->tuple.dst_cookie)) {
+			flow_offload_teardown(nf_flow);
+			return ERR_PTR(-ENOENT);
+		}
+		break;
+	default:
+		break;
+	}
+
+	/* Same bookkeeping as the netfilter ingress hook does. */
+	flow_offload_refresh(nf_flow_table, nf_flow, false);
+
+	if (nf_flow_table->flags & NF_FLOWTABLE_COUNTER) {
+		len = xdp_get_buff_len(xdp);
+		if (len > ETH_HLEN)
+			nf_ct_acct_update(nf_flow->ct, tuplehash->tuple.dir,
+					  len - ETH_HLEN);
+	}
+
+	return tuplehash;
+}
+
+__diag_push();
+__diag_ignore_all("-Wmissing-prototypes",
+		  "Global functions as their definitions will be in nf_flow_table BTF");
+
+/* bpf_xdp_flow_lookup - Look up the flowtable entry for the given tuple
+ *
+ * The flowtable is the one the receiving device is attached to. A hit
+ * refreshes the flow timeout and, if the flowtable has counters enabled,
+ * accounts the frame to the conntrack entry, so the program is expected
+ * to forward the frame itself. TCP FIN/RST must be left to the stack.
+ *
+ * Parameters:
+ * @ctx		- Pointer to ctx (xdp_md) in XDP program
+ *		    Cannot be NULL
+ * @fib_tuple	- Pointer to the tuple: family, l4_protocol, sport, dport,
+ *		  ifindex (ingress device) and the addresses are used
+ *		    Cannot be NULL
+ * @opts	- Options for the lookup (documented above)
+ *		    Cannot be NULL
+ * @opts_len	- Length of the bpf_flowtable_opts structure
+ *		    Must be NF_BPF_FLOWTABLE_OPTS_SZ (4)
+ */
+struct flow_offload_tuple_rhash *
+bpf_xdp_flow_lookup(struct xdp_md *ctx, struct bpf_fib_lookup *fib_tuple,
+		    struct bpf_flowtable_opts *opts, u32 opts_len)
+{
+	struct xdp_buff *xdp = (struct xdp_buff *)ctx;
+	struct flow_offload_tuple tuple = {
+		.iifidx = fib_tuple->ifindex,
+		.l3proto = fib_tuple->family,
+		.l4proto = fib_tuple->l4_protocol,
+		.src_port = fib_tuple->sport,
+		.dst_port = fib_tuple->dport,
+	};
+	struct flow_offload_tuple_rhash *tuplehash;
+
+	if (opts_len != NF_BPF_FLOWTABLE_OPTS_SZ) {
+		opts->error = -EINVAL;
+		return NULL;
+	}
+
+	switch (fib_tuple->family) {
+	case AF_INET:
+		tuple.src_v4.s_addr = fib_tuple->ipv4_src;
+		tuple.dst_v4.s_addr = fib_tuple->ipv4_dst;
+		break;
+	case AF_INET6:
+		tuple.src_v6 = *(struct in6_addr *)&fib_tuple->ipv6_src;
+		tuple.dst_v6 = *(struct in6_addr *)&fib_tuple->ipv6_dst;
+		break;
+	default:
+		opts->error = -EAFNOSUPPORT;
+		return NULL;
+	}
+
+	tuplehash = bpf_xdp_flow_tuple_lookup(xdp, &tuple);
+	if (IS_ERR(tuplehash)) {
+		opts->error = PTR_ERR(tuplehash);
+		return NULL;
+	}
+
+	return tuplehash;
+}
+
+__diag_pop()
+
+BTF_SET8_START(nf_ft_kfunc_set)
+BTF_ID_FLAGS(func, bpf_xdp_flow_lookup, KF_TRUSTED_ARGS | KF_RET_NULL)
+BTF_SET8_END(nf_ft_kfunc_set)
+
+static const struct btf_kfunc_id_set nf_flow_kfunc_set = {
+	.owner = THIS_MODULE,
+	.set   = &nf_ft_kfunc_set,
+};
+
+int nf_flow_register_bpf(void)
+{
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_XDP,
+					 &nf_flow_kfunc_set);
+}
@@ -97,13 +97,29 @@ static struct dst_entry *nft_route_dst_fetch(struct nf_flow_route *route,
 	return dst;
 }
 
+static void flow_offload_fill_in(struct flow_offload_tuple *flow_tuple,
+				 const struct nf_flow_route *route,
+				 enum flow_offload_tuple_dir dir)
+{
+	int i, j = 0;
+
+	flow_tuple->iifidx = route->tuple[dir].in.ifindex;
+	for (i = route->tuple[dir].in.num_encaps - 1; i >= 0; i--) {
+		flow_tuple->encap[j].id = route->tuple[dir].in.encap[i].id;
+		flow_tuple->encap[j].proto = route->tuple[dir].in.encap[i].proto;
+		if (route->tuple[dir].in.ingress_vlans & BIT(i))
+			flow_tuple->in_vlan_ingress |= BIT(j);
+		j++;
+	}
+	flow_tuple->encap_num = route->tuple[dir].in.num_encaps;
+}
+
 static int flow_offload_fill_route(struct flow_offload *flow,
 				   struct nf_flow_route *route,
 				   enum flow_offload_tuple_dir dir)
 {
 	struct flow_offload_tuple *flow_tuple = &flow->tuplehash[dir].tuple;
 	struct dst_entry *dst = nft_route_dst_fetch(route, dir);
-	int i, j = 0;
 
 	switch (flow_tuple->l3proto) {
 	case NFPROTO_IPV4:
@@ -114,15 +130,7 @@ static int flow_offload_fill_route(struct flow_offload *flow,
 		break;
 	}
 
-	flow_tuple->iifidx = route->tuple[dir].in.ifindex;
-	for (i = route->tuple[dir].in.num_encaps - 1; i >= 0; i--) {
-		flow_tuple->encap[j].id = route->tuple[dir].in.encap[i].id;
-		flow_tuple->encap[j].proto = route->tuple[dir].in.encap[i].proto;
-		if (route->tuple[dir].in.ingress_vlans & BIT(i))
-			flow_tuple->in_vlan_ingress |= BIT(j);
-		j++;
-	}
-	flow_tuple->encap_num = route->tuple[dir].in.num_encaps;
+	flow_offload_fill_in(flow_tuple, route, dir);
 
 	switch (route->tuple[dir].xmit_type) {
 	case FLOW_OFFLOAD_XMIT_DIRECT:
@@ -132,6 +140,9 @@ static int flow_offload_fill_route(struct flow_offload *flow,
 		       ETH_ALEN);
 		flow_tuple->out.ifidx = route->tuple[dir].out.ifindex;
 		flow_tuple->out.hw_ifidx = route->tuple[dir].out.hw_ifindex;
+		flow_tuple->out.pppoe_sid = route->tuple[dir].out.pppoe_sid;
+		flow_tuple->out.pppoe_ifidx =
+			route->tuple[dir].out.pppoe_ifindex;
 		dst_release(dst);
 		break;
 	case FLOW_OFFLOAD_XMIT_XFRM:
@@ -165,6 +176,73 @@ void flow_offload_route_init(struct flow_offload *flow,
 }
 EXPORT_SYMBOL_GPL(flow_offload_route_init);
 
+static void flow_offload_fill_bridge(struct flow_offload *flow,
+				     const struct nf_flow_route *route,
+				     enum flow_offload_tuple_dir dir)
+{
+	struct flow_offload_tuple *flow_tuple = &flow->tuplehash[dir].tuple;
+	const struct net_device *outdev;
+
+	flow_offload_fill_in(flow_tuple, route, dir);
+
+	outdev = dev_get_by_index_rcu(nf_ct_net(flow->ct),
+				      route->tuple[dir].out.ifindex);
+	flow_tuple->mtu = outdev ? outdev->mtu : ETH_DATA_LEN;
+
+	memcpy(flow_tuple->out.h_dest, route->tuple[dir].out.h_dest, ETH_ALEN);
+	memcpy(flow_tuple->out.h_source, route->tuple[dir].out.h_source,
+	       ETH_ALEN);
+	flow_tuple->out.ifidx = route->tuple[dir].out.ifindex;
+	flow_tuple->out.hw_ifidx = route->tuple[dir].out.hw_ifindex;
+	flow_tuple->xmit_type = FLOW_OFFLOAD_XMIT_DIRECT;
+}
+
+/*
+ * Bridged flows are forwarded port to port with the ethernet header left
+ * untouched, there is no route and hence no dst to hold on to. Must be
+ * called under RCU read lock.
+ */
+void flow_offload_bridge_init(struct flow_offload *flow,
+			      struct nf_flow_route *route)
+{
+	flow_offload_fill_bridge(flow, route, FLOW_OFFLOAD_DIR_ORIGINAL);
+	flow_offload_fill_bridge(flow, route, FLOW_OFFLOAD_DIR_REPLY);
+	flow->type = NF_FLOW_OFFLOAD_BRIDGE;
+}
+EXPORT_SYMBOL_GPL(flow_offload_bridge_init);
+
+/*
+ * Look up @daddr in the forwarding database of the bridge @port belongs
+ * to and return the port the bridge would send it out of. NULL is
+ * returned if the address is unknown or if the bridge would modify the
+ * frame on its way, i.e. when VLAN filtering is enabled. Must be called
+ * under RCU read lock.
+ */
+const struct net_device *nf_flow_bridge_port(const struct net_device *port,
+					     const u8 *daddr)
+{
+	struct net_device_path_stack stack;
+	const struct net_device_path *path;
+	struct net_device *br_dev;
+
+	if (!netif_is_bridge_port(port))
+		return NULL;
+
+	br_dev = netdev_master_upper_dev_get_rcu((struct net_device *)port);
+	if (!br_dev || dev_fill_forward_path(br_dev, daddr, &stack) < 0 ||
+	    stack.num_paths < 2)
+		return NULL;
+
+	path = &stack.path[0];
+	if (path->type != DEV_PATH_BRIDGE ||
+	    path->bridge.vlan_mode != DEV_PATH_BR_VLAN_KEEP ||
+	    path->bridge.vlan_id)
+		return NULL;
+
+	return stack.path[1].dev;
+}
+EXPORT_SYMBOL_GPL(nf_flow_bridge_port);
+
 static void flow_offload_fixup_tcp(struct ip_ct_tcp *tcp)
 {
 	tcp->seen[0].td_maxwin = 0;
@@ -563,6 +641,15 @@ int nf_flow_table_init(struct nf_flowtable *flowtable)
 }
 EXPORT_SYMBOL_GPL(nf_flow_table_init);
 
+/* The ppp unit a software PPPoE flow bypasses, if any. */
+static bool nf_flow_pppoe_dev(const struct flow_offload_tuple *tuple,
+			      const struct net_device *dev)
+{
+	return tuple->xmit_type == FLOW_OFFLOAD_XMIT_DIRECT &&
+	       tuple->out.pppoe_sid &&
+	       tuple->out.pppoe_ifidx == dev->ifindex;
+}
+
 static void nf_flow_table_do_cleanup(struct nf_flowtable *flow_table,
 				     struct flow_offload *flow, void *data)
 {
@@ -575,7 +662,9 @@ static void nf_flow_table_do_cleanup(struct nf_flowtable *flow_table,
 
 	if (net_eq(nf_ct_net(flow->ct), dev_net(dev)) &&
 	    (flow->tuplehash[0].tuple.iifidx == dev->ifindex ||
-	     flow->tuplehash[1].tuple.iifidx == dev->ifindex))
+	     flow->tuplehash[1].tuple.iifidx == dev->ifindex ||
+	     nf_flow_pppoe_dev(&flow->tuplehash[0].tuple, dev) ||
+	     nf_flow_pppoe_dev(&flow->tuplehash[1].tuple, dev)))
 		flow_offload_teardown(flow);
 }
 
@@ -671,8 +760,14 @@ static int __init nf_flow_table_module_init(void)
 	if (ret)
 		goto out_offload;
 
+	ret = nf_flow_register_bpf();
+	if (ret)
+		goto out_bpf;
+
 	return 0;
 
+out_bpf:
+	nf_flow_table_offload_exit();
 out_offload:
 	unregister_pernet_subsys(&nf_flow_table_net_ops);
 	return ret;
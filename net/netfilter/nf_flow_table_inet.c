@@ -6,6 +6,7 @@
 #include <linux/rhashtable.h>
 #include <net/netfilter/nf_flow_table.h>
 #include <net/netfilter/nf_tables.h>
+#include <net/netfilter/nf_conntrack.h>
 #include <linux/if_vlan.h>
 
 static unsigned int
@@ -91,17 +92,61 @@ static struct nf_flowtable_type flowtable_ipv6 = {
 	.owner		= THIS_MODULE,
 };
 
+/*
+ * Tear bridged flows down once the bridge would no longer forward them
+ * the same way, e.g. a station roamed to another port.
+ */
+static bool nf_flow_bridge_gc(const struct flow_offload *flow)
+{
+	struct net *net = nf_ct_net(flow->ct);
+	const struct flow_offload_tuple *tuple;
+	struct net_device *dev;
+	int dir;
+
+	for (dir = 0; dir < FLOW_OFFLOAD_DIR_MAX; dir++) {
+		tuple = &flow->tuplehash[dir].tuple;
+		dev = dev_get_by_index_rcu(net, tuple->out.ifidx);
+		if (!dev || nf_flow_bridge_port(dev, tuple->out.h_dest) != dev)
+			return true;
+	}
+
+	return false;
+}
+
+/* The hardware offload rules assume routed flows. */
+static int nf_flow_bridge_setup(struct nf_flowtable *flowtable,
+				struct net_device *dev,
+				enum flow_block_command cmd)
+{
+	if (nf_flowtable_hw_offload(flowtable))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+static struct nf_flowtable_type flowtable_bridge = {
+	.family		= NFPROTO_BRIDGE,
+	.init		= nf_flow_table_init,
+	.setup		= nf_flow_bridge_setup,
+	.gc		= nf_flow_bridge_gc,
+	.free		= nf_flow_table_free,
+	.hook		= nf_flow_offload_bridge_hook,
+	.owner		= THIS_MODULE,
+};
+
 static int __init nf_flow_inet_module_init(void)
 {
 	nft_register_flowtable_type(&flowtable_ipv4);
 	nft_register_flowtable_type(&flowtable_ipv6);
 	nft_register_flowtable_type(&flowtable_inet);
+	nft_register_flowtable_type(&flowtable_bridge);
 
 	return 0;
 }
 
 static void __exit nf_flow_inet_module_exit(void)
 {
+	nft_unregister_flowtable_type(&flowtable_bridge);
 	nft_unregister_flowtable_type(&flowtable_inet);
 	nft_unregister_flowtable_type(&flowtable_ipv6);
 	nft_unregister_flowtable_type(&flowtable_ipv4);
@@ -115,4 +160,5 @@ MODULE_AUTHOR("Pablo Neira Ayuso <pablo@netfilter.org>");
 MODULE_ALIAS_NF_FLOWTABLE(AF_INET);
 MODULE_ALIAS_NF_FLOWTABLE(AF_INET6);
 MODULE_ALIAS_NF_FLOWTABLE(1); /* NFPROTO_INET */
+MODULE_ALIAS_NF_FLOWTABLE(7); /* NFPROTO_BRIDGE */
 MODULE_DESCRIPTION("Netfilter flow table mixed IPv4/IPv6 module");
@@ -8,6 +8,7 @@
 #include <linux/ipv6.h>
 #include <linux/netdevice.h>
 #include <linux/if_ether.h>
+#include <linux/etherdevice.h>
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/ip6_route.h>
@@ -318,6 +319,83 @@ static void nf_flow_encap_pop(struct sk_buff *skb,
 	}
 }
 
+static int nf_flow_pppoe_push(struct sk_buff *skb,
+			      const struct net_device *outdev, u16 sid)
+{
+	struct pppoe_hdr *phdr;
+	__be16 proto;
+
+	switch (skb->protocol) {
+	case htons(ETH_P_IP):
+		proto = htons(PPP_IP);
+		break;
+	case htons(ETH_P_IPV6):
+		proto = htons(PPP_IPV6);
+		break;
+	default:
+		return -1;
+	}
+
+	if (skb_cow_head(skb, PPPOE_SES_HLEN + LL_RESERVED_SPACE(outdev)))
+		return -1;
+
+	__skb_push(skb, PPPOE_SES_HLEN);
+	phdr = (struct pppoe_hdr *)skb->data;
+	phdr->ver = 1;
+	phdr->type = 1;
+	phdr->code = 0;
+	phdr->sid = htons(sid);
+	phdr->length = htons(skb->len - sizeof(*phdr));
+	*(__be16 *)(phdr + 1) = proto;
+	skb->protocol = htons(ETH_P_PPP_SES);
+
+	return 0;
+}
+
+static void nf_flow_pppoe_xmit_one(struct sk_buff *skb,
+				   struct net_device *outdev,
+				   const struct flow_offload_tuple *tuple)
+{
+	if (nf_flow_pppoe_push(skb, outdev, tuple->out.pppoe_sid)) {
+		kfree_skb(skb);
+		return;
+	}
+
+	skb->dev = outdev;
+	dev_hard_header(skb, outdev, ETH_P_PPP_SES, tuple->out.h_dest,
+			tuple->out.h_source, skb->len);
+	dev_queue_xmit(skb);
+}
+
+/*
+ * Routed traffic into a PPPoE session, sent without the ppp unit. The
+ * stack can not segment PPPoE frames, so GSO packets are split here
+ * before the session header goes on, like ppp_generic gets them.
+ */
+static unsigned int nf_flow_pppoe_xmit(struct sk_buff *skb,
+				       struct net_device *outdev,
+				       const struct flow_offload_tuple *tuple)
+{
+	struct sk_buff *segs, *next;
+
+	if (!skb_is_gso(skb)) {
+		nf_flow_pppoe_xmit_one(skb, outdev, tuple);
+		return NF_STOLEN;
+	}
+
+	segs = skb_gso_segment(skb, 0);
+	if (IS_ERR_OR_NULL(segs))
+		return NF_DROP;
+
+	consume_skb(skb);
+	skb_list_walk_safe(segs, skb, next) {
+		skb_mark_not_on_list(skb);
+		nf_flow_pppoe_xmit_one(skb, outdev, tuple);
+	}
+
+	return NF_STOLEN;
+}
+
 static unsigned int nf_flow_queue_xmit(struct net *net, struct sk_buff *skb,
 				       const struct flow_offload_tuple_rhash *tuplehash,
 				       unsigned short type)
@@ -328,6 +406,9 @@ static unsigned int nf_flow_queue_xmit(struct net *net, struct sk_buff *skb,
 	if (!outdev)
 		return NF_DROP;
 
+	if (tuplehash->tuple.out.pppoe_sid)
+		return nf_flow_pppoe_xmit(skb, outdev, &tuplehash->tuple);
+
 	skb->dev = outdev;
 	dev_hard_header(skb, skb->dev, type, tuplehash->tuple.out.h_dest,
 			tuplehash->tuple.out.h_source, skb->len);
@@ -687,3 +768,103 @@ nf_flow_offload_ipv6_hook(void *priv, struct sk_buff *skb,
 	return ret;
 }
 EXPORT_SYMBOL_GPL(nf_flow_offload_ipv6_hook);
+
+static int nf_flow_tuple_bridge(struct sk_buff *skb,
+				const struct net_device *dev,
+				struct flow_offload_tuple *tuple,
+				unsigned int *thoff)
+{
+	u32 hdrsize, offset = 0;
+
+	if (skb->protocol == htons(ETH_P_IP) ||
+	    nf_flow_skb_encap_protocol(skb, htons(ETH_P_IP), &offset)) {
+		struct iphdr *iph;
+
+		if (nf_flow_tuple_ip(skb, dev, tuple, &hdrsize, offset) < 0)
+			return -1;
+
+		iph = (struct iphdr *)(skb_network_header(skb) + offset);
+		*thoff = (iph->ihl * 4) + offset;
+	} else if (skb->protocol == htons(ETH_P_IPV6) ||
+		   nf_flow_skb_encap_protocol(skb, htons(ETH_P_IPV6),
+					      &offset)) {
+		if (nf_flow_tuple_ipv6(skb, dev, tuple, &hdrsize, offset) < 0)
+			return -1;
+
+		*thoff = sizeof(struct ipv6hdr) + offset;
+	} else {
+		return -1;
+	}
+
+	return offset;
+}
+
+/*
+ * Fast path for flows that the bridge forwards between two of its ports.
+ * The frame leaves exactly as it arrived: no TTL decrement, no NAT and
+ * the VLAN/PPPoE encapsulation is left in place.
+ */
+unsigned int
+nf_flow_offload_bridge_hook(void *priv, struct sk_buff *skb,
+			    const struct nf_hook_state *state)
+{
+	struct flow_offload_tuple_rhash *tuplehash;
+	struct nf_flowtable *flow_table = priv;
+	struct flow_offload_tuple tuple = {};
+	enum flow_offload_tuple_dir dir;
+	struct flow_offload *flow;
+	struct net_device *outdev;
+	const struct ethhdr *eth;
+	unsigned int thoff, mtu;
+	int offset;
+
+	offset = nf_flow_tuple_bridge(skb, state->in, &tuple, &thoff);
+	if (offset < 0)
+		return NF_ACCEPT;
+
+	tuplehash = flow_offload_lookup(flow_table, &tuple);
+	if (tuplehash == NULL)
+		return NF_ACCEPT;
+
+	dir = tuplehash->tuple.dir;
+	flow = container_of(tuplehash, struct flow_offload, tuplehash[dir]);
+	if (flow->type != NF_FLOW_OFFLOAD_BRIDGE)
+		return NF_ACCEPT;
+
+	/* The IP tuple alone does not identify the L2 path. */
+	eth = eth_hdr(skb);
+	if (!ether_addr_equal(eth->h_source, tuplehash->tuple.out.h_source) ||
+	    !ether_addr_equal(eth->h_dest, tuplehash->tuple.out.h_dest))
+		return NF_ACCEPT;
+
+	mtu = tuplehash->tuple.mtu + offset;
+	if (unlikely(nf_flow_exceeds_mtu(skb, mtu)))
+		return NF_ACCEPT;
+
+	if (nf_flow_state_check(flow, tuplehash->tuple.l4proto, skb, thoff))
+		return NF_ACCEPT;
+
+	outdev = dev_get_by_index_rcu(state->net, tuplehash->tuple.out.ifidx);
+	if (!outdev) {
+		flow_offload_teardown(flow);
+		return NF_ACCEPT;
+	}
+
+	flow_offload_refresh(flow_table, flow, false);
+
+	if (flow_table->flags & NF_FLOWTABLE_COUNTER)
+		nf_ct_acct_update(flow->ct, dir, skb->len);
+
+	/* packet taps may still hold a reference, as in br_handle_frame() */
+	skb = skb_share_check(skb, GFP_ATOMIC);
+	if (!skb)
+		return NF_STOLEN;
+
+	skb_push_rcsum(skb, skb->mac_len);
+	skb_clear_tstamp(skb);
+	skb->dev = outdev;
+	dev_queue_xmit(skb);
+
+	return NF_STOLEN;
+}
+EXPORT_SYMBOL_GPL(nf_flow_offload_bridge_hook);
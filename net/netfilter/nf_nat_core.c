@@ -15,6 +15,9 @@
 #include <net/xfrm.h>
 #include <linux/siphash.h>
 #include <linux/rtnetlink.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/sysctl.h>
 
 #include <net/netfilter/nf_conntrack_bpf.h>
 #include <net/netfilter/nf_conntrack_core.h>
@@ -47,8 +50,24 @@ struct nf_nat_hooks_net {
 	unsigned int users;
 };
 
+/* Per-destination start offsets for the l4 id search, must be 2^n */
+#define NF_NAT_PORT_HINTS	256
+
+struct nf_nat_stat {
+	unsigned int		search;
+	unsigned int		found;
+	unsigned int		restart;
+	unsigned int		failed;
+};
+
 struct nat_net {
 	struct nf_nat_hooks_net nat_proto_net[NFPROTO_NUMPROTO];
+	u8 port_hints;		/* net.netfilter.nf_nat_port_hints */
+	u16 port_hint[NF_NAT_PORT_HINTS];
+	struct nf_nat_stat __percpu *stat;
+#ifdef CONFIG_SYSCTL
+	struct ctl_table_header *sysctl_header;
+#endif
 };
 
 #ifdef CONFIG_XFRM
@@ -372,6 +391,53 @@ find_best_ips_proto(const struct nf_conntrack_zone *zone,
 	}
 }
 
+/* Slot in nat_net->port_hint for the fixed side of @tuple */
+/* One update per l4 id search, not one per probed id */
+static void nf_nat_stat_update(struct nat_net *nat_net, unsigned int probes,
+			       unsigned int restarts, bool found)
+{
+	this_cpu_add(nat_net->stat->search, probes);
+	if (restarts)
+		this_cpu_add(nat_net->stat->restart, restarts);
+	if (found)
+		this_cpu_inc(nat_net->stat->found);
+	else
+		this_cpu_inc(nat_net->stat->failed);
+}
+
+static unsigned int nf_nat_port_hint_slot(const struct nf_conn *ct,
+					  const struct nf_conntrack_tuple *tuple,
+					  enum nf_nat_manip_type maniptype)
+{
+	struct {
+		union nf_inet_addr	mapped;
+		union nf_inet_addr	peer;
+		u32			net_mix;
+		__be16			peer_id;
+		u8			protonum;
+		u8			maniptype;
+	} __aligned(SIPHASH_ALIGNMENT) combined;
+
+	get_random_once(&nf_nat_hash_rnd, sizeof(nf_nat_hash_rnd));
+
+	memset(&combined, 0, sizeof(combined));
+	if (maniptype == NF_NAT_MANIP_SRC) {
+		combined.mapped = tuple->src.u3;
+		combined.peer = tuple->dst.u3;
+		combined.peer_id = tuple->dst.u.all;
+	} else {
+		combined.mapped = tuple->dst.u3;
+		combined.peer = tuple->src.u3;
+		combined.peer_id = tuple->src.u.all;
+	}
+	combined.net_mix = net_hash_mix(nf_ct_net(ct));
+	combined.protonum = tuple->dst.protonum;
+	combined.maniptype = maniptype;
+
+	return siphash(&combined, sizeof(combined), &nf_nat_hash_rnd) &
+	       (NF_NAT_PORT_HINTS - 1);
+}
+
 /* Alter the per-proto part of the tuple (depending on maniptype), to
  * give a unique tuple in the given range if possible.
  *
@@ -382,9 +448,12 @@ static void nf_nat_l4proto_unique_tuple(struct nf_conntrack_tuple *tuple,
 					enum nf_nat_manip_type maniptype,
 					const struct nf_conn *ct)
 {
-	unsigned int range_size, min, max, i, attempts;
+	struct nat_net *nat_net = net_generic(nf_ct_net(ct), nat_net_id);
+	unsigned int range_size, min, max, i, attempts, slot = 0;
 	__be16 *keyptr;
 	u16 off;
+	bool hint = false;
+	unsigned int probes = 0, restarts = 0;
 	static const unsigned int max_attempts = 128;
 
 	switch (tuple->dst.protonum) {
@@ -465,10 +534,28 @@ static void nf_nat_l4proto_unique_tuple(struct nf_conntrack_tuple *tuple,
 	}
 
 find_free_id:
-	if (range->flags & NF_NAT_RANGE_PROTO_OFFSET)
+	/*
+	 * Many flows from one mapped address to the same peer (sensors
+	 * behind a single uplink address talking to one server) fill the
+	 * range in order and mostly release it in order too. Starting
+	 * right after the last id handed out for that peer usually hits a
+	 * free id at once, where a random start keeps probing used ones
+	 * as the range fills up. That makes the ids mostly predictable,
+	 * which the random start is there to prevent, so it has to be
+	 * enabled with net.netfilter.nf_nat_port_hints; --random and
+	 * --random-fully always get the random start.
+	 */
+	if (range->flags & NF_NAT_RANGE_PROTO_OFFSET) {
 		off = (ntohs(*keyptr) - ntohs(range->base_proto.all));
-	else
+	} else if (READ_ONCE(nat_net->port_hints) &&
+		   !(range->flags & NF_NAT_RANGE_PROTO_RANDOM_ALL)) {
+		hint = true;
+		slot = nf_nat_port_hint_slot(ct, tuple, maniptype);
+		off = READ_ONCE(nat_net->port_hint[slot]) + 1 +
+		      get_random_u32_below(16);
+	} else {
 		off = get_random_u16();
+	}
 
 	attempts = range_size;
 	if (attempts > max_attempts)
@@ -483,12 +570,22 @@ find_free_id:
 another_round:
 	for (i = 0; i < attempts; i++, off++) {
 		*keyptr = htons(min + off % range_size);
-		if (!nf_nat_used_tuple(tuple, ct))
+		if (!nf_nat_used_tuple(tuple, ct)) {
+			if (hint)
+				WRITE_ONCE(nat_net->port_hint[slot],
+					   off % range_size);
+			nf_nat_stat_update(nat_net, probes + i + 1, restarts,
+					   true);
 			return;
+		}
 	}
+	probes += attempts;
 
-	if (attempts >= range_size || attempts < 16)
+	if (attempts >= range_size || attempts < 16) {
+		nf_nat_stat_update(nat_net, probes, restarts, false);
 		return;
+	}
+	restarts++;
 	attempts /= 2;
 	off = get_random_u16();
 	goto another_round;
@@ -1111,7 +1208,123 @@ unlock:
 	mutex_unlock(&nf_nat_proto_mutex);
 }
 
+#ifdef CONFIG_PROC_FS
+static int nf_nat_stat_seq_show(struct seq_file *seq, void *v)
+{
+	struct nat_net *nat_net = net_generic(seq_file_single_net(seq), nat_net_id);
+	struct nf_nat_stat sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct nf_nat_stat *st = per_cpu_ptr(nat_net->stat, cpu);
+
+		sum.search += READ_ONCE(st->search);
+		sum.found += READ_ONCE(st->found);
+		sum.restart += READ_ONCE(st->restart);
+		sum.failed += READ_ONCE(st->failed);
+	}
+
+	seq_puts(seq, "search found restart failed\n");
+	seq_printf(seq, "%u %u %u %u\n",
+		   sum.search, sum.found, sum.restart, sum.failed);
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SYSCTL
+static struct ctl_table nf_nat_sysctl_table[] = {
+	{
+		.procname	= "nf_nat_port_hints",
+		.maxlen		= sizeof(u8),
+		.mode		= 0644,
+		.proc_handler	= proc_dou8vec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{}
+};
+
+static int nf_nat_sysctl_init(struct net *net, struct nat_net *nat_net)
+{
+	struct ctl_table *table;
+
+	table = kmemdup(nf_nat_sysctl_table, sizeof(nf_nat_sysctl_table),
+			GFP_KERNEL);
+	if (!table)
+		return -ENOMEM;
+
+	table[0].data = &nat_net->port_hints;
+
+	nat_net->sysctl_header = register_net_sysctl(net, "net/netfilter",
+						     table);
+	if (!nat_net->sysctl_header) {
+		kfree(table);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void nf_nat_sysctl_fini(struct nat_net *nat_net)
+{
+	struct ctl_table *table = nat_net->sysctl_header->ctl_table_arg;
+
+	unregister_net_sysctl_table(nat_net->sysctl_header);
+	kfree(table);
+}
+#else
+static int nf_nat_sysctl_init(struct net *net, struct nat_net *nat_net)
+{
+	return 0;
+}
+
+static void nf_nat_sysctl_fini(struct nat_net *nat_net)
+{
+}
+#endif
+
+static int __net_init nat_net_init(struct net *net)
+{
+	struct nat_net *nat_net = net_generic(net, nat_net_id);
+	int ret;
+
+	nat_net->stat = alloc_percpu(struct nf_nat_stat);
+	if (!nat_net->stat)
+		return -ENOMEM;
+
+	ret = nf_nat_sysctl_init(net, nat_net);
+	if (ret)
+		goto err_stat;
+
+#ifdef CONFIG_PROC_FS
+	if (!proc_create_net_single("nf_nat", 0444, net->proc_net_stat,
+				    nf_nat_stat_seq_show, NULL)) {
+		nf_nat_sysctl_fini(nat_net);
+		ret = -ENOMEM;
+		goto err_stat;
+	}
+#endif
+	return 0;
+
+err_stat:
+	free_percpu(nat_net->stat);
+	return ret;
+}
+
+static void __net_exit nat_net_exit(struct net *net)
+{
+	struct nat_net *nat_net = net_generic(net, nat_net_id);
+
+#ifdef CONFIG_PROC_FS
+	remove_proc_entry("nf_nat", net->proc_net_stat);
+#endif
+	nf_nat_sysctl_fini(nat_net);
+	free_percpu(nat_net->stat);
+}
+
 static struct pernet_operations nat_net_ops = {
+	.init = nat_net_init,
+	.exit = nat_net_exit,
 	.id = &nat_net_id,
 	.size = sizeof(struct nat_net),
 };
@@ -20,6 +20,8 @@
 #include <net/netfilter/nf_tables_core.h>
 #include <net/netfilter/nf_tables.h>
 #include <net/netfilter/nf_tables_offload.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <net/net_namespace.h>
 #include <net/sock.h>
 
@@ -2041,6 +2043,7 @@ void nf_tables_chain_destroy(struct nft_ctx *ctx)
 			static_branch_dec(&nft_counters_enabled);
 			free_percpu(rcu_dereference_raw(basechain->stats));
 		}
+		free_percpu(basechain->cost);
 		kfree(chain->name);
 		kfree(chain->udata);
 		kfree(basechain);
@@ -2387,10 +2390,19 @@ static int nf_tables_addchain(struct nft_ctx *ctx, u8 family, u8 genmask,
 		}
 		chain = &basechain->chain;
 
+		basechain->cost =
+			netdev_alloc_pcpu_stats(struct nft_chain_cost);
+		if (!basechain->cost) {
+			nft_chain_release_hook(&hook);
+			kfree(basechain);
+			return -ENOMEM;
+		}
+
 		if (nla[NFTA_CHAIN_COUNTERS]) {
 			stats = nft_stats_alloc(nla[NFTA_CHAIN_COUNTERS]);
 			if (IS_ERR(stats)) {
 				nft_chain_release_hook(&hook);
+				free_percpu(basechain->cost);
 				kfree(basechain);
 				return PTR_ERR(stats);
 			}
@@ -2400,6 +2412,7 @@ static int nf_tables_addchain(struct nft_ctx *ctx, u8 family, u8 genmask,
 		err = nft_basechain_init(basechain, family, &hook, flags);
 		if (err < 0) {
 			nft_chain_release_hook(&hook);
+			free_percpu(basechain->cost);
 			kfree(basechain);
 			free_percpu(stats);
 			return err;
@@ -3937,6 +3950,9 @@ static const struct nft_set_type *nft_set_types[] = {
 	&nft_set_rbtree_type,
 #if defined(CONFIG_X86_64) && !defined(CONFIG_UML)
 	&nft_set_pipapo_avx2_type,
+#endif
+#ifdef CONFIG_KERNEL_MODE_NEON
+	&nft_set_pipapo_neon_type,
 #endif
 	&nft_set_pipapo_type,
 };
@@ -10849,6 +10865,58 @@ static struct notifier_block nft_nl_notifier = {
 	.notifier_call  = nft_rcv_nl_event,
 };
 
+#ifdef CONFIG_PROC_FS
+static void nft_chain_cost_sum(const struct nft_base_chain *basechain,
+			       struct nft_chain_cost *total)
+{
+	int cpu;
+
+	memset(total, 0, sizeof(*total));
+	for_each_possible_cpu(cpu) {
+		const struct nft_chain_cost *cost;
+		u64 pkts, rules, exprs;
+		unsigned int seq;
+
+		cost = per_cpu_ptr(basechain->cost, cpu);
+		do {
+			seq = u64_stats_fetch_begin_irq(&cost->syncp);
+			pkts = cost->pkts;
+			rules = cost->rules;
+			exprs = cost->exprs;
+		} while (u64_stats_fetch_retry_irq(&cost->syncp, seq));
+		total->pkts += pkts;
+		total->rules += rules;
+		total->exprs += exprs;
+	}
+}
+
+static int nft_chain_cost_seq_show(struct seq_file *seq, void *v)
+{
+	struct nftables_pernet *nft_net = nft_pernet(seq_file_single_net(seq));
+	const struct nft_table *table;
+	const struct nft_chain *chain;
+	struct nft_chain_cost total;
+
+	seq_puts(seq, "family table chain packets rules exprs\n");
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(table, &nft_net->tables, list) {
+		list_for_each_entry_rcu(chain, &table->chains, list) {
+			if (!nft_is_base_chain(chain))
+				continue;
+
+			nft_chain_cost_sum(nft_base_chain(chain), &total);
+			seq_printf(seq, "%u %s %s %llu %llu %llu\n",
+				   table->family, table->name, chain->name,
+				   total.pkts, total.rules, total.exprs);
+		}
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+#endif
+
 static int __net_init nf_tables_init_net(struct net *net)
 {
 	struct nftables_pernet *nft_net = nft_pernet(net);
@@ -10863,6 +10931,12 @@ static int __net_init nf_tables_init_net(struct net *net)
 	nft_net->validate_state = NFT_VALIDATE_SKIP;
 	nft_net->gc_seq = 0;
 
+#ifdef CONFIG_PROC_FS
+	if (!proc_create_net_single("nf_tables_chain_cost", 0444,
+				    net->proc_net, nft_chain_cost_seq_show,
+				    NULL))
+		return -ENOMEM;
+#endif
 	return 0;
 }
 
@@ -10896,6 +10970,8 @@ static void __net_exit nf_tables_exit_net(struct net *net)
 	WARN_ON_ONCE(!list_empty(&nft_net->tables));
 	WARN_ON_ONCE(!list_empty(&nft_net->module_list));
 	WARN_ON_ONCE(!list_empty(&nft_net->notify_list));
+
+	remove_proc_entry("nf_tables_chain_cost", net->proc_net);
 }
 
 static void nf_tables_exit_batch(struct list_head *net_exit_list)
@@ -182,6 +182,54 @@ static noinline void nft_update_chain_stats(const struct nft_chain *chain,
 	}
 }
 
+DEFINE_STATIC_KEY_FALSE(nft_chain_cost_enabled);
+
+static int nft_chain_cost_set(const char *val, const struct kernel_param *kp)
+{
+	bool enable;
+	int err;
+
+	err = kstrtobool(val, &enable);
+	if (err)
+		return err;
+
+	if (enable)
+		static_branch_enable(&nft_chain_cost_enabled);
+	else
+		static_branch_disable(&nft_chain_cost_enabled);
+	return 0;
+}
+
+static int nft_chain_cost_get(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%d\n",
+		       static_key_enabled(&nft_chain_cost_enabled));
+}
+
+static const struct kernel_param_ops nft_chain_cost_ops = {
+	.set	= nft_chain_cost_set,
+	.get	= nft_chain_cost_get,
+};
+module_param_cb(chain_cost, &nft_chain_cost_ops, NULL, 0644);
+MODULE_PARM_DESC(chain_cost,
+		 "Account rules and expressions evaluated per base chain");
+
+static noinline void nft_update_chain_cost(const struct nft_chain *chain,
+					   unsigned int rules,
+					   unsigned int exprs)
+{
+	struct nft_chain_cost *cost;
+
+	local_bh_disable();
+	cost = this_cpu_ptr(nft_base_chain(chain)->cost);
+	u64_stats_update_begin(&cost->syncp);
+	cost->pkts++;
+	cost->rules += rules;
+	cost->exprs += exprs;
+	u64_stats_update_end(&cost->syncp);
+	local_bh_enable();
+}
+
 struct nft_jumpstack {
 	const struct nft_chain *chain;
 	const struct nft_rule_dp *rule;
@@ -231,6 +279,7 @@ nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 	const struct nft_rule_dp *rule, *last_rule;
 	const struct net *net = nft_net(pkt);
 	const struct nft_expr *expr, *last;
+	unsigned int nrules = 0, nexprs = 0;
 	struct nft_regs regs = {};
 	unsigned int stackptr = 0;
 	struct nft_jumpstack jumpstack[NFT_JUMP_STACK_SIZE];
@@ -252,7 +301,9 @@ do_chain:
 next_rule:
 	regs.verdict.code = NFT_CONTINUE;
 	for (; rule < last_rule; rule = nft_rule_next(rule)) {
+		nrules++;
 		nft_rule_dp_for_each_expr(expr, last, rule) {
+			nexprs++;
 			if (expr->ops == &nft_cmp_fast_ops)
 				nft_cmp_fast_eval(expr, &regs);
 			else if (expr->ops == &nft_cmp16_fast_ops)
@@ -287,6 +338,8 @@ next_rule:
 	case NF_DROP:
 	case NF_QUEUE:
 	case NF_STOLEN:
+		if (static_branch_unlikely(&nft_chain_cost_enabled))
+			nft_update_chain_cost(basechain, nrules, nexprs);
 		return regs.verdict.code;
 	}
 
@@ -321,6 +374,8 @@ next_rule:
 
 	if (static_branch_unlikely(&nft_counters_enabled))
 		nft_update_chain_stats(basechain, pkt);
+	if (static_branch_unlikely(&nft_chain_cost_enabled))
+		nft_update_chain_cost(basechain, nrules, nexprs);
 
 	return nft_base_chain(basechain)->policy;
 }
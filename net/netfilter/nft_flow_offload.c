@@ -8,6 +8,7 @@
 #include <linux/spinlock.h>
 #include <linux/netfilter/nf_conntrack_common.h>
 #include <linux/netfilter/nf_tables.h>
+#include <linux/netfilter_bridge.h>
 #include <net/ip.h> /* for ipv4 options. */
 #include <net/netfilter/nf_tables.h>
 #include <net/netfilter/nf_tables_core.h>
@@ -88,6 +89,9 @@ struct nft_forward_info {
 	u8 ingress_vlans;
 	u8 h_source[ETH_ALEN];
 	u8 h_dest[ETH_ALEN];
+	const struct net_device *pppoe_dev;
+	const struct net_device *pppoe_lowerdev;
+	u16 pppoe_sid;
 	enum flow_offload_xmit_type xmit_type;
 };
 
@@ -123,8 +127,16 @@ static void nft_dev_path_info(const struct net_device_path_stack *stack,
 				info->indev = NULL;
 				break;
 			}
-			if (!info->outdev)
+			if (!info->outdev) {
 				info->outdev = path->dev;
+				if (path->type == DEV_PATH_PPPOE &&
+				    i + 1 < stack->num_paths) {
+					info->pppoe_dev = path->dev;
+					info->pppoe_lowerdev =
+						stack->path[i + 1].dev;
+					info->pppoe_sid = path->encap.id;
+				}
+			}
 			info->encap[info->num_encaps].id = path->encap.id;
 			info->encap[info->num_encaps].proto = path->encap.proto;
 			info->num_encaps++;
@@ -165,6 +177,18 @@ static void nft_dev_path_info(const struct net_device_path_stack *stack,
 	if (nf_flowtable_hw_offload(flowtable) &&
 	    nft_is_valid_ether_device(info->indev))
 		info->xmit_type = FLOW_OFFLOAD_XMIT_DIRECT;
+
+	/* Routed towards a PPPoE session: the fast path pushes the session
+	 * header itself and hands the frame to the device below the ppp
+	 * unit, so ppp_generic and the pppoe channel are bypassed.
+	 */
+	if (info->indev && info->pppoe_dev &&
+	    nft_is_valid_ether_device(info->pppoe_lowerdev)) {
+		info->outdev = info->pppoe_lowerdev;
+		info->xmit_type = FLOW_OFFLOAD_XMIT_DIRECT;
+	} else {
+		info->pppoe_dev = NULL;
+	}
 }
 
 static bool nft_flowtable_find_dev(const struct net_device *dev,
@@ -214,6 +238,11 @@ static void nft_dev_forward_path(struct nf_flow_route *route,
 		memcpy(route->tuple[dir].out.h_dest, info.h_dest, ETH_ALEN);
 		route->tuple[dir].out.ifindex = info.outdev->ifindex;
 		route->tuple[dir].out.hw_ifindex = info.hw_outdev->ifindex;
+		if (info.pppoe_dev) {
+			route->tuple[dir].out.pppoe_sid = info.pppoe_sid;
+			route->tuple[dir].out.pppoe_ifindex =
+				info.pppoe_dev->ifindex;
+		}
 		route->tuple[dir].xmit_type = info.xmit_type;
 	}
 }
@@ -271,6 +300,80 @@ static int nft_flow_route(const struct nft_pktinfo *pkt,
 	return 0;
 }
 
+/* Record the encapsulation the same way nf_flow_tuple_encap() sees it. */
+static void nft_flow_bridge_encap(const struct sk_buff *skb,
+				  struct nf_flow_route *route,
+				  enum ip_conntrack_dir dir)
+{
+	struct id encap[NF_FLOW_TABLE_ENCAP_MAX];
+	struct vlan_ethhdr *veth;
+	int i, n = 0;
+
+	if (skb_vlan_tag_present(skb)) {
+		encap[n].id = skb_vlan_tag_get(skb);
+		encap[n].proto = skb->vlan_proto;
+		n++;
+	}
+	if (skb->protocol == htons(ETH_P_8021Q)) {
+		veth = (struct vlan_ethhdr *)skb_mac_header(skb);
+		encap[n].id = ntohs(veth->h_vlan_TCI);
+		encap[n].proto = skb->protocol;
+		n++;
+	}
+
+	/* Both directions carry the same tags, the bridge keeps them. */
+	for (i = 0; i < n; i++) {
+		route->tuple[dir].in.encap[n - 1 - i].id = encap[i].id;
+		route->tuple[dir].in.encap[n - 1 - i].proto = encap[i].proto;
+		route->tuple[!dir].in.encap[n - 1 - i].id = encap[i].id;
+		route->tuple[!dir].in.encap[n - 1 - i].proto = encap[i].proto;
+	}
+	route->tuple[dir].in.num_encaps = n;
+	route->tuple[!dir].in.num_encaps = n;
+}
+
+static int nft_flow_bridge_route(const struct nft_pktinfo *pkt,
+				 const struct nf_conn *ct,
+				 struct nf_flow_route *route,
+				 enum ip_conntrack_dir dir,
+				 struct nft_flowtable *ft)
+{
+	const struct net_device *indev = nft_in(pkt);
+	const struct net_device *outdev = nft_out(pkt);
+	const struct ethhdr *eth = eth_hdr(pkt->skb);
+
+	if (nf_flowtable_hw_offload(&ft->data) || ct->status & IPS_NAT_MASK ||
+	    pkt->skb->protocol == htons(ETH_P_PPP_SES))
+		return -EOPNOTSUPP;
+
+	if (!nft_flowtable_find_dev(indev, ft) ||
+	    !nft_flowtable_find_dev(outdev, ft))
+		return -ENOENT;
+
+	/* Both ends must be known to the FDB, or the reply could flood. */
+	if (nf_flow_bridge_port(indev, eth->h_dest) != outdev ||
+	    nf_flow_bridge_port(outdev, eth->h_source) != indev)
+		return -ENOENT;
+
+	nft_flow_bridge_encap(pkt->skb, route, dir);
+
+	route->tuple[dir].in.ifindex = indev->ifindex;
+	route->tuple[dir].out.ifindex = outdev->ifindex;
+	route->tuple[dir].out.hw_ifindex = outdev->ifindex;
+	memcpy(route->tuple[dir].out.h_source, eth->h_source, ETH_ALEN);
+	memcpy(route->tuple[dir].out.h_dest, eth->h_dest, ETH_ALEN);
+	route->tuple[dir].xmit_type = FLOW_OFFLOAD_XMIT_DIRECT;
+
+	route->tuple[!dir].in.ifindex = outdev->ifindex;
+	route->tuple[!dir].out.ifindex = indev->ifindex;
+	route->tuple[!dir].out.hw_ifindex = indev->ifindex;
+	memcpy(route->tuple[!dir].out.h_source, eth->h_dest, ETH_ALEN);
+	memcpy(route->tuple[!dir].out.h_dest, eth->h_source, ETH_ALEN);
+	route->tuple[!dir].xmit_type = FLOW_OFFLOAD_XMIT_DIRECT;
+
+	return 0;
+}
+
 static bool nft_flow_offload_skip(struct sk_buff *skb, int family)
 {
 	if (skb_sec_path(skb))
@@ -347,14 +450,22 @@ static void nft_flow_offload_eval(const struct nft_expr *expr,
 		goto out;
 
 	dir = CTINFO2DIR(ctinfo);
-	if (nft_flow_route(pkt, ct, &route, dir, priv->flowtable) < 0)
+	if (nft_pf(pkt) == NFPROTO_BRIDGE)
+		ret = nft_flow_bridge_route(pkt, ct, &route, dir,
+					    priv->flowtable);
+	else
+		ret = nft_flow_route(pkt, ct, &route, dir, priv->flowtable);
+	if (ret < 0)
 		goto err_flow_route;
 
 	flow = flow_offload_alloc(ct);
 	if (!flow)
 		goto err_flow_alloc;
 
-	flow_offload_route_init(flow, &route);
+	if (nft_pf(pkt) == NFPROTO_BRIDGE)
+		flow_offload_bridge_init(flow, &route);
+	else
+		flow_offload_route_init(flow, &route);
 
 	if (tcph) {
 		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
@@ -384,9 +495,11 @@ static int nft_flow_offload_validate(const struct nft_ctx *ctx,
 {
 	unsigned int hook_mask = (1 << NF_INET_FORWARD);
 
-	if (ctx->family != NFPROTO_IPV4 &&
-	    ctx->family != NFPROTO_IPV6 &&
-	    ctx->family != NFPROTO_INET)
+	if (ctx->family == NFPROTO_BRIDGE)
+		hook_mask = (1 << NF_BR_FORWARD);
+	else if (ctx->family != NFPROTO_IPV4 &&
+		 ctx->family != NFPROTO_IPV6 &&
+		 ctx->family != NFPROTO_INET)
 		return -EOPNOTSUPP;
 
 	return nft_chain_validate_hooks(ctx->chain, hook_mask);
@@ -8,16 +8,20 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/module.h>
-#include <linux/spinlock.h>
+#include <linux/atomic.h>
 #include <linux/netlink.h>
 #include <linux/netfilter.h>
 #include <linux/netfilter/nf_tables.h>
 #include <net/netfilter/nf_tables.h>
 
+/*
+ * The bucket is kept as the time at which it was (or will be) empty:
+ * it holds now - empty tokens, capped at tokens_max. A single word of
+ * state can be updated with cmpxchg, so packets do not serialise on a
+ * lock, and packets over the limit do not write it at all.
+ */
 struct nft_limit {
-	spinlock_t	lock;
-	u64		last;
-	u64		tokens;
+	atomic64_t	empty;
 };
 
 struct nft_limit_priv {
@@ -31,25 +35,17 @@ struct nft_limit_priv {
 
 static inline bool nft_limit_eval(struct nft_limit_priv *priv, u64 cost)
 {
-	u64 now, tokens;
-	s64 delta;
-
-	spin_lock_bh(&priv->limit->lock);
-	now = ktime_get_ns();
-	tokens = priv->limit->tokens + now - priv->limit->last;
-	if (tokens > priv->tokens_max)
-		tokens = priv->tokens_max;
-
-	priv->limit->last = now;
-	delta = tokens - cost;
-	if (delta >= 0) {
-		priv->limit->tokens = delta;
-		spin_unlock_bh(&priv->limit->lock);
-		return priv->invert;
-	}
-	priv->limit->tokens = tokens;
-	spin_unlock_bh(&priv->limit->lock);
-	return !priv->invert;
+	s64 now = ktime_get_ns();
+	s64 old, new;
+
+	old = atomic64_read(&priv->limit->empty);
+	do {
+		new = max_t(s64, old, now - (s64)priv->tokens_max) + cost;
+		if (new > now)
+			return !priv->invert;
+	} while (!atomic64_try_cmpxchg(&priv->limit->empty, &old, new));
+
+	return priv->invert;
 }
 
 /* Use same default as in iptables. */
@@ -114,11 +110,9 @@ static int nft_limit_init(struct nft_limit_priv *priv,
 	if (!priv->limit)
 		return -ENOMEM;
 
-	priv->limit->tokens = tokens;
-	priv->tokens_max = priv->limit->tokens;
+	priv->tokens_max = tokens;
 	priv->invert = invert;
-	priv->limit->last = ktime_get_ns();
-	spin_lock_init(&priv->limit->lock);
+	atomic64_set(&priv->limit->empty, ktime_get_ns() - tokens);
 
 	return 0;
 }
@@ -162,9 +156,8 @@ static int nft_limit_clone(struct nft_limit_priv *priv_dst,
 	if (!priv_dst->limit)
 		return -ENOMEM;
 
-	spin_lock_init(&priv_dst->limit->lock);
-	priv_dst->limit->tokens = priv_src->tokens_max;
-	priv_dst->limit->last = ktime_get_ns();
+	atomic64_set(&priv_dst->limit->empty,
+		     ktime_get_ns() - priv_src->tokens_max);
 
 	return 0;
 }
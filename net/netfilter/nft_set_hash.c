@@ -21,9 +21,14 @@
 /* We target a hash table size of 4, element hint is 75% of final size */
 #define NFT_RHASH_ELEMENT_HINT 3
 
+/* Elements visited per gc run, a full pass is spread over several runs */
+#define NFT_RHASH_GC_BATCH	1024
+
 struct nft_rhash {
 	struct rhashtable		ht;
 	struct delayed_work		gc_work;
+	struct rhashtable_iter		gc_hti;
+	bool				gc_walking;
 };
 
 struct nft_rhash_elem {
@@ -311,12 +316,13 @@ static bool nft_rhash_expr_needs_gc_run(const struct nft_set *set,
 
 static void nft_rhash_gc(struct work_struct *work)
 {
+	unsigned int budget = NFT_RHASH_GC_BATCH;
 	struct nftables_pernet *nft_net;
 	struct nft_set *set;
 	struct nft_rhash_elem *he;
 	struct nft_rhash *priv;
-	struct rhashtable_iter hti;
 	struct nft_trans_gc *gc;
+	unsigned long delay;
 	struct net *net;
 	u32 gc_seq;
 
@@ -325,6 +331,7 @@ static void nft_rhash_gc(struct work_struct *work)
 	net  = read_pnet(&set->net);
 	nft_net = nft_pernet(net);
 	gc_seq = READ_ONCE(nft_net->gc_seq);
+	delay = nft_set_gc_interval(set);
 
 	if (nft_set_gc_is_pending(set))
 		goto done;
@@ -333,10 +340,17 @@ static void nft_rhash_gc(struct work_struct *work)
 	if (!gc)
 		goto done;
 
-	rhashtable_walk_enter(&priv->ht, &hti);
-	rhashtable_walk_start(&hti);
+	/*
+	 * The walk is kept across runs, so a large set is scanned a batch
+	 * at a time instead of in one long pass every gc interval.
+	 */
+	if (!priv->gc_walking) {
+		rhashtable_walk_enter(&priv->ht, &priv->gc_hti);
+		priv->gc_walking = true;
+	}
+	rhashtable_walk_start(&priv->gc_hti);
 
-	while ((he = rhashtable_walk_next(&hti))) {
+	while ((he = rhashtable_walk_next(&priv->gc_hti))) {
 		if (IS_ERR(he)) {
 			nft_trans_gc_destroy(gc);
 			gc = NULL;
@@ -358,7 +372,7 @@ static void nft_rhash_gc(struct work_struct *work)
 			goto needs_gc_run;
 
 		if (!nft_set_elem_expired(&he->ext))
-			continue;
+			goto next;
 needs_gc_run:
 		nft_set_elem_dead(&he->ext);
 dead_elem:
@@ -367,21 +381,32 @@ dead_elem:
 			goto try_later;
 
 		nft_trans_gc_elem_add(gc, he);
+next:
+		if (!--budget) {
+			/* Carry on with the rest of the table shortly */
+			delay = 1;
+			goto try_later;
+		}
 	}
 
 	gc = nft_trans_gc_catchall_async(gc, gc_seq);
 
-try_later:
 	/* catchall list iteration requires rcu read side lock. */
-	rhashtable_walk_stop(&hti);
-	rhashtable_walk_exit(&hti);
+	rhashtable_walk_stop(&priv->gc_hti);
+	rhashtable_walk_exit(&priv->gc_hti);
+	priv->gc_walking = false;
 
 	if (gc)
 		nft_trans_gc_queue_async_done(gc);
+	goto done;
+
+try_later:
+	rhashtable_walk_stop(&priv->gc_hti);
 
+	if (gc)
+		nft_trans_gc_queue_async_done(gc);
 done:
-	queue_delayed_work(system_power_efficient_wq, &priv->gc_work,
-			   nft_set_gc_interval(set));
+	queue_delayed_work(system_power_efficient_wq, &priv->gc_work, delay);
 }
 
 static u64 nft_rhash_privsize(const struct nlattr * const nla[],
@@ -442,6 +467,8 @@ static void nft_rhash_destroy(const struct nft_ctx *ctx,
 	};
 
 	cancel_delayed_work_sync(&priv->gc_work);
+	if (priv->gc_walking)
+		rhashtable_walk_exit(&priv->gc_hti);
 	rhashtable_free_and_destroy(&priv->ht, nft_rhash_elem_destroy,
 				    (void *)&rhash_ctx);
 }
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef _NFT_SET_PIPAPO_NEON_H
+#define _NFT_SET_PIPAPO_NEON_H
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+bool nft_pipapo_neon_estimate(const struct nft_set_desc *desc, u32 features,
+			      struct nft_set_estimate *est);
+
+/* From nft_set_pipapo_neon_inner.c, the only unit built with NEON enabled */
+void nft_pipapo_neon_and_field(unsigned long *dst, const unsigned long *lt,
+			       const u8 *data, unsigned int groups,
+			       unsigned int bsize, unsigned int bb);
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
+#endif /* _NFT_SET_PIPAPO_NEON_H */
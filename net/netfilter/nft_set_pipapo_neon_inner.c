@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* PIPAPO: PIle PAcket POlicies: NEON bucket intersection
+ *
+ * Kernel mode NEON code has to live in its own compilation unit, see
+ * arch/arm/include/asm/neon.h. This only implements the AND step of
+ * the lookup, everything else is shared with the generic version.
+ */
+
+#ifdef CONFIG_ARM64
+#include <asm/neon-intrinsics.h>
+#else
+#include <arm_neon.h>
+#endif
+
+/* 128-bit fields, 4-bit groups */
+#define NFT_PIPAPO_NEON_GROUPS_MAX	32
+
+void nft_pipapo_neon_and_field(unsigned long *dst, const unsigned long *lt,
+			       const uint8_t *data, unsigned int groups,
+			       unsigned int bsize, unsigned int bb);
+
+/**
+ * nft_pipapo_neon_and_field() - Intersect all buckets of a field
+ * @dst:	Result bitmap, bsize longs
+ * @lt:		Lookup table for the field
+ * @data:	Packet data for the field
+ * @groups:	Number of bit groups in the field
+ * @bsize:	Bucket size, in longs
+ * @bb:		Bits per group, 4 or 8
+ *
+ * Unlike the generic version, which goes over @dst once per group, this
+ * keeps sixteen bytes of @dst in a register while all the selected
+ * buckets are ANDed into it, so @dst is loaded and stored only once.
+ */
+void nft_pipapo_neon_and_field(unsigned long *dst, const unsigned long *lt,
+			       const uint8_t *data, unsigned int groups,
+			       unsigned int bsize, unsigned int bb)
+{
+	const uint8_t *bucket[NFT_PIPAPO_NEON_GROUPS_MAX];
+	unsigned int g, i, len = bsize * sizeof(*dst);
+	uint8_t *d = (uint8_t *)dst;
+
+	for (g = 0; g < groups; g++) {
+		unsigned int v;
+
+		if (bb == 8)
+			v = data[g];
+		else if (g % 2)
+			v = data[g / 2] & 0x0f;
+		else
+			v = data[g / 2] >> 4;
+
+		bucket[g] = (const uint8_t *)(lt + v * bsize);
+		lt += bsize << bb;
+	}
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		uint8x16_t r0 = vld1q_u8(d + i), r1 = vld1q_u8(d + i + 16);
+
+		for (g = 0; g < groups; g++) {
+			r0 = vandq_u8(r0, vld1q_u8(bucket[g] + i));
+			r1 = vandq_u8(r1, vld1q_u8(bucket[g] + i + 16));
+		}
+
+		vst1q_u8(d + i, r0);
+		vst1q_u8(d + i + 16, r1);
+	}
+
+	for (; i + 16 <= len; i += 16) {
+		uint8x16_t r = vld1q_u8(d + i);
+
+		for (g = 0; g < groups; g++)
+			r = vandq_u8(r, vld1q_u8(bucket[g] + i));
+
+		vst1q_u8(d + i, r);
+	}
+
+	for (; i < len; i += sizeof(*dst)) {
+		unsigned long r = *(unsigned long *)(d + i);
+
+		for (g = 0; g < groups; g++)
+			r &= *(const unsigned long *)(bucket[g] + i);
+
+		*(unsigned long *)(d + i) = r;
+	}
+}
@@ -17,6 +17,7 @@
 #include <linux/init.h>
 #include <linux/gfp.h>
 #include <linux/if_arp.h>
+#include <linux/interrupt.h>
 #include <net/net_namespace.h>
 #include <net/netlink.h>
 #include <net/dst.h>
@@ -31,6 +32,22 @@ static DEFINE_SPINLOCK(mirred_list_lock);
 #define MIRRED_NEST_LIMIT    4
 static DEFINE_PER_CPU(unsigned int, mirred_nest_level);
 
+/* Optionally, forwarded skbs are queued per CPU and sent from a tasklet,
+ * which runs once the current NET_RX round is over. That takes the
+ * transmit (or the receive on the target) out of the stack of the packet
+ * being classified and keeps the target's TX path hot for a whole batch.
+ */
+struct mirred_batch {
+	struct sk_buff_head egress;
+	struct sk_buff_head ingress;
+	struct tasklet_struct tasklet;
+};
+static DEFINE_PER_CPU(struct mirred_batch, mirred_batch);
+
+static unsigned int batch_size;
+module_param(batch_size, uint, 0644);
+MODULE_PARM_DESC(batch_size, "Max skbs queued per CPU before mirred flushes them (0: forward each skb right away)");
+
 static bool tcf_mirred_is_act_redirect(int action)
 {
 	return action == TCA_EGRESS_REDIR || action == TCA_INGRESS_REDIR;
@@ -210,10 +227,82 @@ static bool is_mirred_nested(void)
 	return unlikely(__this_cpu_read(mirred_nest_level) > 1);
 }
 
+static void tcf_mirred_flush(struct mirred_batch *b)
+{
+	struct sk_buff_head egress, ingress;
+	struct sk_buff *skb, *next;
+
+	/* Anything queued while flushing waits for the next run. */
+	__skb_queue_head_init(&egress);
+	__skb_queue_head_init(&ingress);
+	skb_queue_splice_init(&b->egress, &egress);
+	skb_queue_splice_init(&b->ingress, &ingress);
+
+	while ((skb = __skb_dequeue(&egress))) {
+		struct net_device *dev = skb->dev;
+
+		tcf_dev_queue_xmit(skb, dev_queue_xmit);
+		dev_put(dev);
+	}
+
+	while (!skb_queue_empty(&ingress)) {
+		struct net_device *dev = skb_peek(&ingress)->dev;
+		unsigned int n = 0;
+		LIST_HEAD(list);
+
+		/* hand each run of skbs for the same device up as a list */
+		while ((skb = skb_peek(&ingress)) && skb->dev == dev) {
+			__skb_unlink(skb, &ingress);
+			list_add_tail(&skb->list, &list);
+			n++;
+		}
+
+		if (is_mirred_nested()) {
+			list_for_each_entry_safe(skb, next, &list, list) {
+				skb_list_del_init(skb);
+				netif_rx(skb);
+			}
+		} else {
+			netif_receive_skb_list(&list);
+		}
+
+		while (n--)
+			dev_put(dev);
+	}
+}
+
+static void tcf_mirred_tasklet(struct tasklet_struct *t)
+{
+	struct mirred_batch *b = from_tasklet(b, t, tasklet);
+
+	tcf_mirred_flush(b);
+}
+
+static int tcf_mirred_defer(bool want_ingress, struct sk_buff *skb,
+			    unsigned int limit)
+{
+	struct mirred_batch *b = this_cpu_ptr(&mirred_batch);
+
+	/* the target must not go away while the skb sits in the queue */
+	dev_hold(skb->dev);
+	__skb_queue_tail(want_ingress ? &b->ingress : &b->egress, skb);
+
+	if (skb_queue_len(&b->egress) + skb_queue_len(&b->ingress) >= limit)
+		tcf_mirred_flush(b);
+	else
+		tasklet_schedule(&b->tasklet);
+
+	return 0;
+}
+
 static int tcf_mirred_forward(bool want_ingress, struct sk_buff *skb)
 {
+	unsigned int limit = READ_ONCE(batch_size);
 	int err;
 
+	if (limit)
+		return tcf_mirred_defer(want_ingress, skb, limit);
+
 	if (!want_ingress)
 		err = tcf_dev_queue_xmit(skb, dev_queue_xmit);
 	else if (is_mirred_nested())
@@ -529,7 +618,17 @@ MODULE_LICENSE("GPL");
 
 static int __init mirred_init_module(void)
 {
-	int err = register_netdevice_notifier(&mirred_device_notifier);
+	int cpu, err;
+
+	for_each_possible_cpu(cpu) {
+		struct mirred_batch *b = per_cpu_ptr(&mirred_batch, cpu);
+
+		__skb_queue_head_init(&b->egress);
+		__skb_queue_head_init(&b->ingress);
+		tasklet_setup(&b->tasklet, tcf_mirred_tasklet);
+	}
+
+	err = register_netdevice_notifier(&mirred_device_notifier);
 	if (err)
 		return err;
 
@@ -543,7 +642,12 @@ static int __init mirred_init_module(void)
 
 static void __exit mirred_cleanup_module(void)
 {
+	int cpu;
+
 	tcf_unregister_action(&act_mirred_ops, &mirred_net_ops);
+	/* lets any pending flush run */
+	for_each_possible_cpu(cpu)
+		tasklet_kill(&per_cpu_ptr(&mirred_batch, cpu)->tasklet);
 	unregister_netdevice_notifier(&mirred_device_notifier);
 }
 
@@ -1846,6 +1846,9 @@ static int tcf_fill_node(struct net *net, struct sk_buff *skb,
 		goto nla_put_failure;
 	if (!fh) {
 		tcm->tcm_handle = 0;
+		if (!terse_dump && tp->ops->head_dump &&
+		    tp->ops->head_dump(net, tp, skb) < 0)
+			goto nla_put_failure;
 	} else if (terse_dump) {
 		if (tp->ops->terse_dump) {
 			if (tp->ops->terse_dump(net, tp, fh, skb, tcm,
@@ -11,6 +11,8 @@
 #include <linux/rhashtable.h>
 #include <linux/workqueue.h>
 #include <linux/refcount.h>
+#include <linux/jhash.h>
+#include <linux/u64_stats_sync.h>
 
 #include <linux/if_ether.h>
 #include <linux/in6.h>
@@ -98,6 +100,42 @@ struct fl_flow_tmplt {
 	struct tcf_chain *chain;
 };
 
+/* Exact-match cache in front of the per-mask lookups. It is keyed on the
+ * dissected key ANDed with the union of all masks, so fields no mask looks
+ * at don't split one flow into many entries, and it remembers which filter
+ * (or none) the masks picked for it. Any filter or mask change bumps the
+ * generation, which invalidates all entries.
+ */
+#define FL_CACHE_ENTRIES_MAX	32
+
+struct fl_cache_mask {
+	struct fl_flow_mask_range range;
+	struct rcu_head rcu;
+	struct fl_flow_key key;
+};
+
+struct fl_cache_entry {
+	struct fl_flow_key key;
+	struct fl_flow_mask_range range;
+	struct cls_fl_filter *filter;
+	u32 hash;
+	u32 gen;
+};
+
+struct fl_cache {
+	struct fl_flow_key key;	/* scratch, keeps it off the stack */
+	u64_stats_t hits;
+	u64_stats_t misses;
+	struct u64_stats_sync syncp;
+	struct fl_cache_entry ent[];
+};
+
+static unsigned int cache_entries;
+module_param(cache_entries, uint, 0444);
+MODULE_PARM_DESC(cache_entries, "Per-CPU flow cache entries of each flower instance (0: disabled, max 32)");
+
+static struct flow_dissector fl_cache_dissector __read_mostly;
+
 struct cls_fl_head {
 	struct rhashtable ht;
 	spinlock_t masks_lock; /* Protect masks list */
@@ -105,6 +143,10 @@ struct cls_fl_head {
 	struct list_head hw_filters;
 	struct rcu_work rwork;
 	struct idr handle_idr;
+	struct fl_cache __percpu *cache;
+	struct fl_cache_mask __rcu *cache_key_mask; /* union of all masks */
+	u32 cache_mask;
+	atomic_t cache_gen;
 };
 
 struct cls_fl_filter {
@@ -141,10 +183,11 @@ static unsigned short int fl_mask_range(const struct fl_flow_mask *mask)
 	return mask->range.end - mask->range.start;
 }
 
-static void fl_mask_update_range(struct fl_flow_mask *mask)
+static void fl_key_update_range(const struct fl_flow_key *key,
+				struct fl_flow_mask_range *range)
 {
-	const u8 *bytes = (const u8 *) &mask->key;
-	size_t size = sizeof(mask->key);
+	const u8 *bytes = (const u8 *) key;
+	size_t size = sizeof(*key);
 	size_t i, first = 0, last;
 
 	for (i = 0; i < size; i++) {
@@ -160,8 +203,13 @@ static void fl_mask_update_range(struct fl_flow_mask *mask)
 			break;
 		}
 	}
-	mask->range.start = rounddown(first, sizeof(long));
-	mask->range.end = roundup(last + 1, sizeof(long));
+	range->start = rounddown(first, sizeof(long));
+	range->end = roundup(last + 1, sizeof(long));
+}
+
+static void fl_mask_update_range(struct fl_flow_mask *mask)
+{
+	fl_key_update_range(&mask->key, &mask->range);
 }
 
 static void *fl_key_get_start(struct fl_flow_key *key,
@@ -305,12 +353,29 @@ static u16 fl_ct_info_to_flower_map[] = {
 					TCA_FLOWER_KEY_CT_FLAGS_NEW,
 };
 
-static int fl_classify(struct sk_buff *skb, const struct tcf_proto *tp,
-		       struct tcf_result *res)
+static void fl_skb_dissect(struct sk_buff *skb,
+			   struct flow_dissector *dissector,
+			   struct fl_flow_key *skb_key, bool post_ct, u16 zone)
+{
+	skb_flow_dissect_meta(skb, dissector, skb_key);
+	/* skb_flow_dissect() does not set n_proto in case an unknown
+	 * protocol, so do it rather here.
+	 */
+	skb_key->basic.n_proto = skb_protocol(skb, false);
+	skb_flow_dissect_tunnel_info(skb, dissector, skb_key);
+	skb_flow_dissect_ct(skb, dissector, skb_key,
+			    fl_ct_info_to_flower_map,
+			    ARRAY_SIZE(fl_ct_info_to_flower_map),
+			    post_ct, zone);
+	skb_flow_dissect_hash(skb, dissector, skb_key);
+	skb_flow_dissect(skb, dissector, skb_key,
+			 FLOW_DISSECTOR_F_STOP_BEFORE_ENCAP);
+}
+
+static struct cls_fl_filter *fl_masks_lookup(struct sk_buff *skb,
+					     struct cls_fl_head *head,
+					     bool post_ct, u16 zone)
 {
-	struct cls_fl_head *head = rcu_dereference_bh(tp->root);
-	bool post_ct = tc_skb_cb(skb)->post_ct;
-	u16 zone = tc_skb_cb(skb)->zone;
 	struct fl_flow_key skb_key;
 	struct fl_flow_mask *mask;
 	struct cls_fl_filter *f;
@@ -319,29 +384,186 @@ static int fl_classify(struct sk_buff *skb, const struct tcf_proto *tp,
 		flow_dissector_init_keys(&skb_key.control, &skb_key.basic);
 		fl_clear_masked_range(&skb_key, mask);
 
-		skb_flow_dissect_meta(skb, &mask->dissector, &skb_key);
-		/* skb_flow_dissect() does not set n_proto in case an unknown
-		 * protocol, so do it rather here.
-		 */
-		skb_key.basic.n_proto = skb_protocol(skb, false);
-		skb_flow_dissect_tunnel_info(skb, &mask->dissector, &skb_key);
-		skb_flow_dissect_ct(skb, &mask->dissector, &skb_key,
-				    fl_ct_info_to_flower_map,
-				    ARRAY_SIZE(fl_ct_info_to_flower_map),
-				    post_ct, zone);
-		skb_flow_dissect_hash(skb, &mask->dissector, &skb_key);
-		skb_flow_dissect(skb, &mask->dissector, &skb_key,
-				 FLOW_DISSECTOR_F_STOP_BEFORE_ENCAP);
+		fl_skb_dissect(skb, &mask->dissector, &skb_key, post_ct, zone);
 
 		f = fl_mask_lookup(mask, &skb_key);
-		if (f && !tc_skip_sw(f->flags)) {
-			*res = f->res;
-			return tcf_exts_exec(skb, &f->exts, res);
+		if (f && !tc_skip_sw(f->flags))
+			return f;
+	}
+	return NULL;
+}
+
+static void fl_cache_invalidate(struct cls_fl_head *head)
+{
+	/* Pairs with atomic_read_acquire() in fl_cache_lookup(): whoever
+	 * sees the new generation also sees the filter update.
+	 */
+	smp_mb__before_atomic();
+	atomic_inc(&head->cache_gen);
+}
+
+/* Called with masks_lock held after the masks list changed */
+static void fl_cache_update_mask(struct cls_fl_head *head)
+{
+	struct fl_cache_mask *cm, *old;
+	struct fl_flow_mask *mask;
+	long *lkey;
+	int i;
+
+	if (!head->cache)
+		return;
+
+	old = rcu_dereference_protected(head->cache_key_mask,
+					lockdep_is_held(&head->masks_lock));
+
+	/* Without a mask nothing can match; on failure classify walks the
+	 * masks without the cache until the next mask change.
+	 */
+	cm = NULL;
+	if (!list_empty(&head->masks))
+		cm = kzalloc(sizeof(*cm), GFP_ATOMIC);
+	if (cm) {
+		lkey = (long *)&cm->key;
+		list_for_each_entry(mask, &head->masks, list) {
+			const long *lmask = (const long *)&mask->key;
+
+			for (i = 0; i < sizeof(cm->key) / sizeof(long); i++)
+				lkey[i] |= lmask[i];
 		}
+		fl_key_update_range(&cm->key, &cm->range);
+	}
+
+	rcu_assign_pointer(head->cache_key_mask, cm);
+	fl_cache_invalidate(head);
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+static struct cls_fl_filter *fl_cache_lookup(struct sk_buff *skb,
+					     struct cls_fl_head *head,
+					     bool post_ct, u16 zone)
+{
+	struct fl_cache *cache = this_cpu_ptr(head->cache);
+	struct fl_flow_key *key = &cache->key;
+	const struct fl_cache_mask *cm;
+	struct fl_cache_entry *e;
+	struct cls_fl_filter *f;
+	const long *lmask;
+	unsigned int len;
+	u32 gen, hash;
+	long *lkey;
+	int i;
+
+	gen = atomic_read_acquire(&head->cache_gen);
+	cm = rcu_dereference_bh(head->cache_key_mask);
+	if (!cm)
+		return fl_masks_lookup(skb, head, post_ct, zone);
+
+	len = cm->range.end - cm->range.start;
+	lkey = (long *)((u8 *)key + cm->range.start);
+	lmask = (const long *)((const u8 *)&cm->key + cm->range.start);
+
+	memset(lkey, 0, len);
+	fl_skb_dissect(skb, &fl_cache_dissector, key, post_ct, zone);
+	for (i = 0; i < len / sizeof(long); i++)
+		lkey[i] &= lmask[i];
+
+	hash = jhash2((const u32 *)lkey, len / sizeof(u32), 0);
+	e = &cache->ent[hash & head->cache_mask];
+	if (e->gen == gen && e->hash == hash &&
+	    e->range.start == cm->range.start &&
+	    e->range.end == cm->range.end &&
+	    !memcmp((u8 *)&e->key + cm->range.start, lkey, len)) {
+		u64_stats_update_begin(&cache->syncp);
+		u64_stats_inc(&cache->hits);
+		u64_stats_update_end(&cache->syncp);
+		return e->filter;
+	}
+
+	f = fl_masks_lookup(skb, head, post_ct, zone);
+
+	/* A filter deleted meanwhile has bumped the generation past gen, so
+	 * this entry won't be used once it can be freed.
+	 */
+	memcpy((u8 *)&e->key + cm->range.start, lkey, len);
+	e->range = cm->range;
+	e->filter = f;
+	e->hash = hash;
+	e->gen = gen;
+
+	u64_stats_update_begin(&cache->syncp);
+	u64_stats_inc(&cache->misses);
+	u64_stats_update_end(&cache->syncp);
+
+	return f;
+}
+
+static int fl_classify(struct sk_buff *skb, const struct tcf_proto *tp,
+		       struct tcf_result *res)
+{
+	struct cls_fl_head *head = rcu_dereference_bh(tp->root);
+	bool post_ct = tc_skb_cb(skb)->post_ct;
+	u16 zone = tc_skb_cb(skb)->zone;
+	struct cls_fl_filter *f;
+
+	if (head->cache)
+		f = fl_cache_lookup(skb, head, post_ct, zone);
+	else
+		f = fl_masks_lookup(skb, head, post_ct, zone);
+
+	if (f) {
+		*res = f->res;
+		return tcf_exts_exec(skb, &f->exts, res);
 	}
 	return -1;
 }
 
+static int fl_cache_init(struct cls_fl_head *head)
+{
+	unsigned int n = min_t(unsigned int, cache_entries,
+			       FL_CACHE_ENTRIES_MAX);
+	int cpu;
+
+	if (!n)
+		return 0;
+
+	n = rounddown_pow_of_two(n);
+	head->cache = __alloc_percpu(struct_size(head->cache, ent, n),
+				     __alignof__(struct fl_cache));
+	if (!head->cache)
+		return -ENOBUFS;
+
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(head->cache, cpu)->syncp);
+	head->cache_mask = n - 1;
+	/* entries start out zeroed, keep them from matching gen 0 */
+	atomic_set(&head->cache_gen, 1);
+
+	return 0;
+}
+
+static void fl_cache_stats(struct cls_fl_head *head, u64 *hits, u64 *misses)
+{
+	int cpu;
+
+	*hits = 0;
+	*misses = 0;
+	for_each_possible_cpu(cpu) {
+		struct fl_cache *cache = per_cpu_ptr(head->cache, cpu);
+		unsigned int start;
+		u64 h, m;
+
+		do {
+			start = u64_stats_fetch_begin(&cache->syncp);
+			h = u64_stats_read(&cache->hits);
+			m = u64_stats_read(&cache->misses);
+		} while (u64_stats_fetch_retry(&cache->syncp, start));
+
+		*hits += h;
+		*misses += m;
+	}
+}
+
 static int fl_init(struct tcf_proto *tp)
 {
 	struct cls_fl_head *head;
@@ -350,6 +572,11 @@ static int fl_init(struct tcf_proto *tp)
 	if (!head)
 		return -ENOBUFS;
 
+	if (fl_cache_init(head)) {
+		kfree(head);
+		return -ENOBUFS;
+	}
+
 	spin_lock_init(&head->masks_lock);
 	INIT_LIST_HEAD_RCU(&head->masks);
 	INIT_LIST_HEAD(&head->hw_filters);
@@ -394,6 +621,7 @@ static bool fl_mask_put(struct cls_fl_head *head, struct fl_flow_mask *mask)
 
 	spin_lock(&head->masks_lock);
 	list_del_rcu(&mask->list);
+	fl_cache_update_mask(head);
 	spin_unlock(&head->masks_lock);
 
 	tcf_queue_work(&mask->rwork, fl_mask_free_work);
@@ -551,6 +779,7 @@ static int __fl_delete(struct tcf_proto *tp, struct cls_fl_filter *f,
 			       f->mask->filter_ht_params);
 	idr_remove(&head->handle_idr, f->handle);
 	list_del_rcu(&f->list);
+	fl_cache_invalidate(head);
 	spin_unlock(&tp->lock);
 
 	*last = fl_mask_put(head, f->mask);
@@ -569,6 +798,8 @@ static void fl_destroy_sleepable(struct work_struct *work)
 						rwork);
 
 	rhashtable_destroy(&head->ht);
+	free_percpu(head->cache);
+	kfree(rcu_dereference_raw(head->cache_key_mask));
 	kfree(head);
 	module_put(THIS_MODULE);
 }
@@ -2030,6 +2261,7 @@ static struct fl_flow_mask *fl_create_new_mask(struct cls_fl_head *head,
 
 	spin_lock(&head->masks_lock);
 	list_add_tail_rcu(&newmask->list, &head->masks);
+	fl_cache_update_mask(head);
 	spin_unlock(&head->masks_lock);
 
 	return newmask;
@@ -2317,6 +2549,7 @@ static int fl_change(struct net *net, struct sk_buff *in_skb,
 		spin_unlock(&tp->lock);
 	}
 
+	fl_cache_invalidate(head);
 	*arg = fnew;
 
 	kfree(tb);
@@ -2330,9 +2563,12 @@ errout_hw:
 	spin_unlock(&tp->lock);
 	if (!tc_skip_hw(fnew->flags))
 		fl_hw_destroy_filter(tp, fnew, rtnl_held, NULL);
-	if (in_ht)
+	if (in_ht) {
 		rhashtable_remove_fast(&fnew->mask->ht, &fnew->ht_node,
 				       fnew->mask->filter_ht_params);
+		/* it was visible to classify for a while */
+		fl_cache_invalidate(head);
+	}
 errout_mask:
 	fl_mask_put(head, fnew->mask);
 errout:
@@ -3413,6 +3649,37 @@ nla_put_failure:
 	return -EMSGSIZE;
 }
 
+/* Flow cache totals, once per instance rather than with every filter */
+static int fl_head_dump(struct net *net, struct tcf_proto *tp,
+			struct sk_buff *skb)
+{
+	struct cls_fl_head *head = fl_head_dereference(tp);
+	struct nlattr *nest;
+	u64 hits, misses;
+
+	if (!head || !head->cache)
+		return skb->len;
+
+	nest = nla_nest_start_noflag(skb, TCA_OPTIONS);
+	if (!nest)
+		goto nla_put_failure;
+
+	fl_cache_stats(head, &hits, &misses);
+	if (nla_put_u64_64bit(skb, TCA_FLOWER_CACHE_HITS, hits,
+			      TCA_FLOWER_PAD) ||
+	    nla_put_u64_64bit(skb, TCA_FLOWER_CACHE_MISSES, misses,
+			      TCA_FLOWER_PAD))
+		goto nla_put_failure;
+
+	nla_nest_end(skb, nest);
+
+	return skb->len;
+
+nla_put_failure:
+	nla_nest_cancel(skb, nest);
+	return -EMSGSIZE;
+}
+
 static void fl_bind_class(void *fh, u32 classid, unsigned long cl, void *q,
 			  unsigned long base)
 {
@@ -3452,12 +3719,23 @@ static struct tcf_proto_ops cls_fl_ops __read_mostly = {
 	.tmplt_create	= fl_tmplt_create,
 	.tmplt_destroy	= fl_tmplt_destroy,
 	.tmplt_dump	= fl_tmplt_dump,
+	.head_dump	= fl_head_dump,
 	.owner		= THIS_MODULE,
 	.flags		= TCF_PROTO_OPS_DOIT_UNLOCKED,
 };
 
 static int __init cls_fl_init(void)
 {
+	struct fl_flow_key *mask;
+
+	/* all keys flower knows about, for the flow cache */
+	mask = kmalloc(sizeof(*mask), GFP_KERNEL);
+	if (!mask)
+		return -ENOMEM;
+	memset(mask, 0xff, sizeof(*mask));
+	fl_init_dissector(&fl_cache_dissector, mask);
+	kfree(mask);
+
 	return register_tcf_proto_ops(&cls_fl_ops);
 }
 
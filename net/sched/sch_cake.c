@@ -63,6 +63,7 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/reciprocal_div.h>
+#include <linux/sched/clock.h>
 #include <net/netlink.h>
 #include <linux/if_vlan.h>
 #include <net/pkt_sched.h>
@@ -253,6 +254,14 @@ struct cake_sched_data {
 	u16		max_adjlen;
 	u16		min_netlen;
 	u16		min_adjlen;
+
+	/* per phase cost, only kept with CAKE_FLAG_PROFILE */
+	u64		prof_enqueues;
+	u64		prof_dequeues;
+	u64		prof_hash_ns;
+	u64		prof_enqueue_ns;
+	u64		prof_cobalt_ns;
+	u64		prof_dequeue_ns;
 };
 
 enum {
@@ -260,7 +269,9 @@ enum {
 	CAKE_FLAG_AUTORATE_INGRESS = BIT(1),
 	CAKE_FLAG_INGRESS	   = BIT(2),
 	CAKE_FLAG_WASH		   = BIT(3),
-	CAKE_FLAG_SPLIT_GSO	   = BIT(4)
+	CAKE_FLAG_SPLIT_GSO	   = BIT(4),
+	CAKE_FLAG_FAST_HASH	   = BIT(5),
+	CAKE_FLAG_PROFILE	   = BIT(6)
 };
 
 /* COBALT operates the Codel and BLUE algorithms in parallel, in order to
@@ -643,8 +654,70 @@ static bool cake_ddst(int flow_mode)
 	return (flow_mode & CAKE_FLOW_DUAL_DST) == CAKE_FLOW_DUAL_DST;
 }
 
+static u32 cake_fast_hashrnd __read_mostly;
+
+/* Host hashes for the fast_hash mode, taken straight from the network
+ * header (or, in nat mode, the conntrack tuple) instead of running the
+ * flow dissector. Anything but plain IPv4/IPv6 takes the full path.
+ */
+static bool cake_fast_host_hash(const struct sk_buff *skb, bool nat_enabled,
+				u32 *srchost_hash, u32 *dsthost_hash)
+{
+	net_get_random_once(&cake_fast_hashrnd, sizeof(cake_fast_hashrnd));
+
+	switch (skb_protocol(skb, true)) {
+	case htons(ETH_P_IP): {
+		const struct iphdr *iph;
+		struct iphdr _iph;
+		__be32 saddr, daddr;
+
+		iph = skb_header_pointer(skb, skb_network_offset(skb),
+					 sizeof(_iph), &_iph);
+		if (!iph)
+			return false;
+
+		saddr = iph->saddr;
+		daddr = iph->daddr;
+#if IS_ENABLED(CONFIG_NF_CONNTRACK)
+		if (nat_enabled) {
+			struct nf_conntrack_tuple tuple = {};
+			bool rev = !skb->_nfct;
+
+			if (nf_ct_get_tuple_skb(&tuple, skb)) {
+				saddr = rev ? tuple.dst.u3.ip : tuple.src.u3.ip;
+				daddr = rev ? tuple.src.u3.ip : tuple.dst.u3.ip;
+			}
+		}
+#endif
+		*srchost_hash = jhash_1word((__force u32)saddr,
+					    cake_fast_hashrnd);
+		*dsthost_hash = jhash_1word((__force u32)daddr,
+					    cake_fast_hashrnd);
+		return true;
+	}
+	case htons(ETH_P_IPV6): {
+		const struct ipv6hdr *ip6h;
+		struct ipv6hdr _ip6h;
+
+		ip6h = skb_header_pointer(skb, skb_network_offset(skb),
+					  sizeof(_ip6h), &_ip6h);
+		if (!ip6h)
+			return false;
+
+		*srchost_hash = jhash2((const u32 *)&ip6h->saddr, 4,
+				       cake_fast_hashrnd);
+		*dsthost_hash = jhash2((const u32 *)&ip6h->daddr, 4,
+				       cake_fast_hashrnd);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
 static u32 cake_hash(struct cake_tin_data *q, const struct sk_buff *skb,
-		     int flow_mode, u16 flow_override, u16 host_override)
+		     int flow_mode, u16 flow_override, u16 host_override,
+		     bool fast_hash)
 {
 	bool hash_flows = (!flow_override && !!(flow_mode & CAKE_FLOW_FLOWS));
 	bool hash_hosts = (!host_override && !!(flow_mode & CAKE_FLOW_HOSTS));
@@ -657,6 +730,19 @@ static u32 cake_hash(struct cake_tin_data *q, const struct sk_buff *skb,
 	if (unlikely(flow_mode == CAKE_FLOW_NONE))
 		return 0;
 
+	/* In fast_hash mode a hash the NIC or GRO left in the skb is used
+	 * as the flow hash even with nat enabled: for forwarded traffic it
+	 * was computed on the tuple as received, before any NAT. The host
+	 * hashes come from the addresses alone.
+	 */
+	if (fast_hash && (!hash_flows || use_skbhash)) {
+		if (!hash_hosts)
+			goto skip_hash;
+		if (cake_fast_host_hash(skb, nat_enabled, &srchost_hash,
+					&dsthost_hash))
+			goto skip_hash;
+	}
+
 	/* If both overrides are set, or we can use the SKB hash and nat mode is
 	 * disabled, we can skip packet dissection entirely. If nat mode is
 	 * enabled there's another check below after doing the conntrack lookup.
@@ -1686,13 +1772,23 @@ static u32 cake_classify(struct Qdisc *sch, struct cake_tin_data **t,
 	}
 hash:
 	*t = cake_select_tin(sch, skb);
-	return cake_hash(*t, skb, flow_mode, flow, host) + 1;
+	if (q->rate_flags & CAKE_FLAG_PROFILE) {
+		u64 start = local_clock();
+		u32 hash;
+
+		hash = cake_hash(*t, skb, flow_mode, flow, host,
+				 q->rate_flags & CAKE_FLAG_FAST_HASH);
+		q->prof_hash_ns += local_clock() - start;
+		return hash + 1;
+	}
+	return cake_hash(*t, skb, flow_mode, flow, host,
+			 q->rate_flags & CAKE_FLAG_FAST_HASH) + 1;
 }
 
 static void cake_reconfigure(struct Qdisc *sch);
 
-static s32 cake_enqueue(struct sk_buff *skb, struct Qdisc *sch,
-			struct sk_buff **to_free)
+static s32 __cake_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			  struct sk_buff **to_free)
 {
 	struct cake_sched_data *q = qdisc_priv(sch);
 	int len = qdisc_pkt_len(skb);
@@ -1907,6 +2003,44 @@ static s32 cake_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	return NET_XMIT_SUCCESS;
 }
 
+static s32 cake_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			struct sk_buff **to_free)
+{
+	struct cake_sched_data *q = qdisc_priv(sch);
+	u64 start;
+	s32 ret;
+
+	if (!(q->rate_flags & CAKE_FLAG_PROFILE))
+		return __cake_enqueue(skb, sch, to_free);
+
+	start = local_clock();
+	ret = __cake_enqueue(skb, sch, to_free);
+	q->prof_enqueue_ns += local_clock() - start;
+	q->prof_enqueues++;
+	return ret;
+}
+
+static bool cake_cobalt_should_drop(struct cake_sched_data *q,
+				    struct cake_tin_data *b,
+				    struct cake_flow *flow, ktime_t now,
+				    struct sk_buff *skb)
+{
+	u32 bulk_flows = b->bulk_flow_count *
+			 !!(q->rate_flags & CAKE_FLAG_INGRESS);
+	u64 start;
+	bool drop;
+
+	if (!(q->rate_flags & CAKE_FLAG_PROFILE))
+		return cobalt_should_drop(&flow->cvars, &b->cparams, now, skb,
+					  bulk_flows);
+
+	start = local_clock();
+	drop = cobalt_should_drop(&flow->cvars, &b->cparams, now, skb,
+				  bulk_flows);
+	q->prof_cobalt_ns += local_clock() - start;
+	return drop;
+}
+
 static struct sk_buff *cake_dequeue_one(struct Qdisc *sch)
 {
 	struct cake_sched_data *q = qdisc_priv(sch);
@@ -1942,7 +2076,7 @@ static void cake_clear_tin(struct Qdisc *sch, u16 tin)
 			kfree_skb(skb);
 }
 
-static struct sk_buff *cake_dequeue(struct Qdisc *sch)
+static struct sk_buff *__cake_dequeue(struct Qdisc *sch)
 {
 	struct cake_sched_data *q = qdisc_priv(sch);
 	struct cake_tin_data *b = &q->tins[q->cur_tin];
@@ -2157,10 +2291,7 @@ retry:
 		}
 
 		/* Last packet in queue may be marked, shouldn't be dropped */
-		if (!cobalt_should_drop(&flow->cvars, &b->cparams, now, skb,
-					(b->bulk_flow_count *
-					 !!(q->rate_flags &
-					    CAKE_FLAG_INGRESS))) ||
+		if (!cake_cobalt_should_drop(q, b, flow, now, skb) ||
 		    !flow->head)
 			break;
 
@@ -2222,6 +2353,22 @@ retry:
 	return skb;
 }
 
+static struct sk_buff *cake_dequeue(struct Qdisc *sch)
+{
+	struct cake_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb;
+	u64 start;
+
+	if (!(q->rate_flags & CAKE_FLAG_PROFILE))
+		return __cake_dequeue(sch);
+
+	start = local_clock();
+	skb = __cake_dequeue(sch);
+	q->prof_dequeue_ns += local_clock() - start;
+	q->prof_dequeues++;
+	return skb;
+}
+
 static void cake_reset(struct Qdisc *sch)
 {
 	struct cake_sched_data *q = qdisc_priv(sch);
@@ -2251,6 +2398,8 @@ static const struct nla_policy cake_policy[TCA_CAKE_MAX + 1] = {
 	[TCA_CAKE_INGRESS]	 = { .type = NLA_U32 },
 	[TCA_CAKE_ACK_FILTER]	 = { .type = NLA_U32 },
 	[TCA_CAKE_SPLIT_GSO]	 = { .type = NLA_U32 },
+	[TCA_CAKE_FAST_HASH]	 = { .type = NLA_U32 },
+	[TCA_CAKE_PROFILE]	 = { .type = NLA_U32 },
 	[TCA_CAKE_FWMARK]	 = { .type = NLA_U32 },
 };
 
@@ -2674,6 +2823,20 @@ static int cake_change(struct Qdisc *sch, struct nlattr *opt,
 			q->rate_flags &= ~CAKE_FLAG_SPLIT_GSO;
 	}
 
+	if (tb[TCA_CAKE_FAST_HASH]) {
+		if (!!nla_get_u32(tb[TCA_CAKE_FAST_HASH]))
+			q->rate_flags |= CAKE_FLAG_FAST_HASH;
+		else
+			q->rate_flags &= ~CAKE_FLAG_FAST_HASH;
+	}
+
+	if (tb[TCA_CAKE_PROFILE]) {
+		if (!!nla_get_u32(tb[TCA_CAKE_PROFILE]))
+			q->rate_flags |= CAKE_FLAG_PROFILE;
+		else
+			q->rate_flags &= ~CAKE_FLAG_PROFILE;
+	}
+
 	if (tb[TCA_CAKE_FWMARK]) {
 		q->fwmark_mask = nla_get_u32(tb[TCA_CAKE_FWMARK]);
 		q->fwmark_shft = q->fwmark_mask ? __ffs(q->fwmark_mask) : 0;
@@ -2834,6 +2997,14 @@ static int cake_dump(struct Qdisc *sch, struct sk_buff *skb)
 			!!(q->rate_flags & CAKE_FLAG_SPLIT_GSO)))
 		goto nla_put_failure;
 
+	if (nla_put_u32(skb, TCA_CAKE_FAST_HASH,
+			!!(q->rate_flags & CAKE_FLAG_FAST_HASH)))
+		goto nla_put_failure;
+
+	if (nla_put_u32(skb, TCA_CAKE_PROFILE,
+			!!(q->rate_flags & CAKE_FLAG_PROFILE)))
+		goto nla_put_failure;
+
 	if (nla_put_u32(skb, TCA_CAKE_FWMARK, q->fwmark_mask))
 		goto nla_put_failure;
 
@@ -2872,6 +3043,15 @@ static int cake_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 	PUT_STAT_U32(MIN_NETLEN, q->min_netlen);
 	PUT_STAT_U32(MIN_ADJLEN, q->min_adjlen);
 
+	if (q->rate_flags & CAKE_FLAG_PROFILE) {
+		PUT_STAT_U64(PROFILE_ENQUEUES, q->prof_enqueues);
+		PUT_STAT_U64(PROFILE_DEQUEUES, q->prof_dequeues);
+		PUT_STAT_U64(HASH_NS, q->prof_hash_ns);
+		PUT_STAT_U64(ENQUEUE_NS, q->prof_enqueue_ns);
+		PUT_STAT_U64(COBALT_NS, q->prof_cobalt_ns);
+		PUT_STAT_U64(DEQUEUE_NS, q->prof_dequeue_ns);
+	}
+
 #undef PUT_STAT_U32
 #undef PUT_STAT_U64
 
@@ -35,6 +35,7 @@ struct etf_sched_data {
 	struct rb_root_cached head;
 	struct qdisc_watchdog watchdog;
 	ktime_t (*get_time)(void);
+	struct tc_etf_xstats xstats;
 };
 
 static const struct nla_policy etf_policy[TCA_ETF_MAX + 1] = {
@@ -250,6 +251,22 @@ static void timesortedlist_remove(struct Qdisc *sch, struct sk_buff *skb)
 	sch->q.qlen--;
 }
 
+/* The launch error is how long after the watchdog should have fired (at
+ * txtime - delta) the packet actually left the qdisc, i.e. timer, softirq
+ * and locking latency. It is bounded by delta, beyond that the packet
+ * expires instead.
+ */
+static void etf_update_launch_err(struct etf_sched_data *q, ktime_t err)
+{
+	u32 ns = ktime_to_ns(err);
+
+	q->xstats.launched++;
+	q->xstats.launch_err_sum += ns;
+	q->xstats.launch_err_last = ns;
+	if (ns > q->xstats.launch_err_max)
+		q->xstats.launch_err_max = ns;
+}
+
 static struct sk_buff *etf_dequeue_timesortedlist(struct Qdisc *sch)
 {
 	struct etf_sched_data *q = qdisc_priv(sch);
@@ -264,6 +281,7 @@ static struct sk_buff *etf_dequeue_timesortedlist(struct Qdisc *sch)
 
 	/* Drop if packet has expired while in queue. */
 	if (ktime_before(skb->tstamp, now)) {
+		q->xstats.expired++;
 		timesortedlist_drop(sch, skb, now);
 		skb = NULL;
 		goto out;
@@ -281,10 +299,12 @@ static struct sk_buff *etf_dequeue_timesortedlist(struct Qdisc *sch)
 	next = ktime_sub_ns(skb->tstamp, q->delta);
 
 	/* Dequeue only if now is within the [txtime - delta, txtime] range. */
-	if (ktime_after(now, next))
+	if (ktime_after(now, next)) {
 		timesortedlist_remove(sch, skb);
-	else
+		etf_update_launch_err(q, ktime_sub(now, next));
+	} else {
 		skb = NULL;
+	}
 
 out:
 	/* Now we may need to re-arm the qdisc watchdog for the next packet. */
@@ -488,6 +508,17 @@ nla_put_failure:
 	return -1;
 }
 
+static int etf_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+
+	/* With offload the device launches the packets, nothing to report */
+	if (q->offload)
+		return 0;
+
+	return gnet_stats_copy_app(d, &q->xstats, sizeof(q->xstats));
+}
+
 static struct Qdisc_ops etf_qdisc_ops __read_mostly = {
 	.id		=	"etf",
 	.priv_size	=	sizeof(struct etf_sched_data),
@@ -498,6 +529,7 @@ static struct Qdisc_ops etf_qdisc_ops __read_mostly = {
 	.reset		=	etf_reset,
 	.destroy	=	etf_destroy,
 	.dump		=	etf_dump,
+	.dump_stats	=	etf_dump_stats,
 	.owner		=	THIS_MODULE,
 };
 
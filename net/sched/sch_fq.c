@@ -132,6 +132,7 @@ struct fq_sched_data {
 	u64		stat_allocation_errors;
 
 	u32		timer_slack; /* hrtimer slack in ns */
+	u32		pacing_slack; /* early release window in ns */
 	struct qdisc_watchdog watchdog;
 };
 
@@ -498,24 +499,27 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 
 static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 {
+	u64 release = now + q->pacing_slack;
 	unsigned long sample;
 	struct rb_node *p;
 
-	if (q->time_next_delayed_flow > now)
+	if (q->time_next_delayed_flow > release)
 		return;
 
 	/* Update unthrottle latency EWMA.
 	 * This is cheap and can help diagnosing timer/latency problems.
 	 */
-	sample = (unsigned long)(now - q->time_next_delayed_flow);
-	q->unthrottle_latency_ns -= q->unthrottle_latency_ns >> 3;
-	q->unthrottle_latency_ns += sample >> 3;
+	if (q->time_next_delayed_flow <= now) {
+		sample = (unsigned long)(now - q->time_next_delayed_flow);
+		q->unthrottle_latency_ns -= q->unthrottle_latency_ns >> 3;
+		q->unthrottle_latency_ns += sample >> 3;
+	}
 
 	q->time_next_delayed_flow = ~0ULL;
 	while ((p = rb_first(&q->delayed)) != NULL) {
 		struct fq_flow *f = rb_entry(p, struct fq_flow, rate_node);
 
-		if (f->time_next_packet > now) {
+		if (f->time_next_packet > release) {
 			q->time_next_delayed_flow = f->time_next_packet;
 			break;
 		}
@@ -551,8 +555,10 @@ begin:
 		if (!head->first) {
 			if (q->time_next_delayed_flow != ~0ULL)
 				qdisc_watchdog_schedule_range_ns(&q->watchdog,
-							q->time_next_delayed_flow,
-							q->timer_slack);
+							q->time_next_delayed_flow -
+							q->pacing_slack,
+							q->timer_slack +
+							q->pacing_slack);
 			return NULL;
 		}
 	}
@@ -570,7 +576,11 @@ begin:
 		u64 time_next_packet = max_t(u64, fq_skb_cb(skb)->time_to_send,
 					     f->time_next_packet);
 
-		if (now < time_next_packet) {
+		/* With pacing_slack, everything due before the end of the
+		 * release window goes out now, so that one watchdog expiry
+		 * serves all the flows whose packets fall in that window.
+		 */
+		if (now + q->pacing_slack < time_next_packet) {
 			head->first = f->next;
 			f->time_next_packet = time_next_packet;
 			fq_flow_set_throttled(q, f);
@@ -634,9 +644,10 @@ begin:
 		 * f->time_next_packet was set when prior packet was sent,
 		 * and current time (@now) can be too late by tens of us.
 		 */
-		if (f->time_next_packet)
+		if (f->time_next_packet && now > f->time_next_packet)
 			len -= min(len/2, now - f->time_next_packet);
-		f->time_next_packet = now + len;
+		/* A packet released early keeps the flow on its schedule */
+		f->time_next_packet = max(now, f->time_next_packet) + len;
 	}
 out:
 	qdisc_bstats_update(sch, skb);
@@ -783,6 +794,10 @@ static struct netlink_range_validation iq_range = {
 	.max = INT_MAX,
 };
 
+static struct netlink_range_validation pacing_slack_range = {
+	.max = NSEC_PER_MSEC,
+};
+
 static const struct nla_policy fq_policy[TCA_FQ_MAX + 1] = {
 	[TCA_FQ_UNSPEC]			= { .strict_start_type = TCA_FQ_TIMER_SLACK },
 
@@ -801,6 +816,8 @@ static const struct nla_policy fq_policy[TCA_FQ_MAX + 1] = {
 	[TCA_FQ_TIMER_SLACK]		= { .type = NLA_U32 },
 	[TCA_FQ_HORIZON]		= { .type = NLA_U32 },
 	[TCA_FQ_HORIZON_DROP]		= { .type = NLA_U8 },
+	[TCA_FQ_PACING_SLACK]		= NLA_POLICY_FULL_RANGE(NLA_U32,
+							      &pacing_slack_range),
 };
 
 static int fq_change(struct Qdisc *sch, struct nlattr *opt,
@@ -894,6 +911,9 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 	if (tb[TCA_FQ_HORIZON_DROP])
 		q->horizon_drop = nla_get_u8(tb[TCA_FQ_HORIZON_DROP]);
 
+	if (tb[TCA_FQ_PACING_SLACK])
+		q->pacing_slack = nla_get_u32(tb[TCA_FQ_PACING_SLACK]);
+
 	if (!err) {
 
 		sch_tree_unlock(sch);
@@ -996,7 +1016,8 @@ static int fq_dump(struct Qdisc *sch, struct sk_buff *skb)
 	    nla_put_u32(skb, TCA_FQ_BUCKETS_LOG, q->fq_trees_log) ||
 	    nla_put_u32(skb, TCA_FQ_TIMER_SLACK, q->timer_slack) ||
 	    nla_put_u32(skb, TCA_FQ_HORIZON, (u32)horizon) ||
-	    nla_put_u8(skb, TCA_FQ_HORIZON_DROP, q->horizon_drop))
+	    nla_put_u8(skb, TCA_FQ_HORIZON_DROP, q->horizon_drop) ||
+	    nla_put_u32(skb, TCA_FQ_PACING_SLACK, q->pacing_slack))
 		goto nla_put_failure;
 
 	return nla_nest_end(skb, opts);
@@ -52,15 +52,19 @@ struct fq_codel_sched_data {
 	struct tcf_block *block;
 	struct fq_codel_flow *flows;	/* Flows table [flows_cnt] */
 	u32		*backlogs;	/* backlog table [flows_cnt] */
+	u32		*heap;		/* flows in max-heap order of backlog */
+	u32		*heap_pos;	/* position of each flow in heap[] */
 	u32		flows_cnt;	/* number of flows */
 	u32		quantum;	/* psched_mtu(qdisc_dev(sch)); */
 	u32		drop_batch_size;
 	u32		memory_limit;
+	u32		flow_quota;	/* max backlog of one flow, 0: none */
 	struct codel_params cparams;
 	struct codel_stats cstats;
 	u32		memory_usage;
 	u32		drop_overmemory;
 	u32		drop_overlimit;
+	u32		drop_flow_quota;
 	u32		new_flow_count;
 
 	struct list_head new_flows;	/* list of new flows */
@@ -134,29 +138,77 @@ static inline void flow_queue_add(struct fq_codel_flow *flow,
 	skb->next = NULL;
 }
 
+static u32 fq_codel_heap_backlog(const struct fq_codel_sched_data *q, u32 i)
+{
+	return q->backlogs[q->heap[i]];
+}
+
+static void fq_codel_heap_swap(struct fq_codel_sched_data *q, u32 i, u32 j)
+{
+	u32 a = q->heap[i], b = q->heap[j];
+
+	q->heap[i] = b;
+	q->heap[j] = a;
+	q->heap_pos[a] = j;
+	q->heap_pos[b] = i;
+}
+
+/* A flow backlog grew: move it up towards the root. */
+static void fq_codel_heap_up(struct fq_codel_sched_data *q, u32 idx)
+{
+	u32 i = q->heap_pos[idx];
+
+	while (i) {
+		u32 parent = (i - 1) / 2;
+
+		if (fq_codel_heap_backlog(q, parent) >=
+		    fq_codel_heap_backlog(q, i))
+			break;
+		fq_codel_heap_swap(q, i, parent);
+		i = parent;
+	}
+}
+
+/* A flow backlog shrank: move it down below any fatter child. */
+static void fq_codel_heap_down(struct fq_codel_sched_data *q, u32 idx)
+{
+	u32 i = q->heap_pos[idx];
+
+	for (;;) {
+		u32 l = 2 * i + 1, r = l + 1, m = i;
+
+		if (l < q->flows_cnt &&
+		    fq_codel_heap_backlog(q, l) > fq_codel_heap_backlog(q, m))
+			m = l;
+		if (r < q->flows_cnt &&
+		    fq_codel_heap_backlog(q, r) > fq_codel_heap_backlog(q, m))
+			m = r;
+		if (m == i)
+			break;
+		fq_codel_heap_swap(q, i, m);
+		i = m;
+	}
+}
+
 static unsigned int fq_codel_drop(struct Qdisc *sch, unsigned int max_packets,
 				  struct sk_buff **to_free)
 {
 	struct fq_codel_sched_data *q = qdisc_priv(sch);
 	struct sk_buff *skb;
-	unsigned int maxbacklog = 0, idx = 0, i, len;
+	unsigned int maxbacklog, idx, i, len;
 	struct fq_codel_flow *flow;
 	unsigned int threshold;
 	unsigned int mem = 0;
 
-	/* Queue is full! Find the fat flow and drop packet(s) from it.
-	 * This might sound expensive, but with 1024 flows, we scan
-	 * 4KB of memory, and we dont need to handle a complex tree
-	 * in fast path (packet queue/enqueue) with many cache misses.
+	/* Queue is full! Drop packet(s) from the fat flow, which is kept
+	 * at the root of a max-heap of the flow backlogs. Keeping the heap
+	 * costs a couple of compares per packet in the common case, and
+	 * saves scanning every flow when a flood hits the limits.
 	 * In stress mode, we'll try to drop 64 packets from the flow,
-	 * amortizing this linear lookup to one cache line per drop.
+	 * to not add a too big cpu spike here.
 	 */
-	for (i = 0; i < q->flows_cnt; i++) {
-		if (q->backlogs[i] > maxbacklog) {
-			maxbacklog = q->backlogs[i];
-			idx = i;
-		}
-	}
+	idx = q->heap[0];
+	maxbacklog = q->backlogs[idx];
 
 	/* Our goal is to drop half of this fat flow backlog */
 	threshold = maxbacklog >> 1;
@@ -174,6 +226,7 @@ static unsigned int fq_codel_drop(struct Qdisc *sch, unsigned int max_packets,
 	/* Tell codel to increase its signal strength also */
 	flow->cvars.count += i;
 	q->backlogs[idx] -= len;
+	fq_codel_heap_down(q, idx);
 	q->memory_usage -= mem;
 	sch->qstats.drops += i;
 	sch->qstats.backlog -= len;
@@ -200,10 +253,18 @@ static int fq_codel_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	}
 	idx--;
 
+	/* keep one flood from pushing everyone else into fq_codel_drop() */
+	if (q->flow_quota &&
+	    q->backlogs[idx] + qdisc_pkt_len(skb) > q->flow_quota) {
+		q->drop_flow_quota++;
+		return qdisc_drop(skb, sch, to_free);
+	}
+
 	codel_set_enqueue_time(skb);
 	flow = &q->flows[idx];
 	flow_queue_add(flow, skb);
 	q->backlogs[idx] += qdisc_pkt_len(skb);
+	fq_codel_heap_up(q, idx);
 	qdisc_qstats_backlog_inc(sch, skb);
 
 	if (list_empty(&flow->flowchain)) {
@@ -222,10 +283,9 @@ static int fq_codel_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 
 	/* save this packet length as it might be dropped by fq_codel_drop() */
 	pkt_len = qdisc_pkt_len(skb);
-	/* fq_codel_drop() is quite expensive, as it performs a linear search
-	 * in q->backlogs[] to find a fat flow.
-	 * So instead of dropping a single packet, drop half of its backlog
-	 * with a 64 packets limit to not add a too big cpu spike here.
+	/* Instead of dropping a single packet, drop half of the fat flow
+	 * backlog with a 64 packets limit, so a flood doesn't have us in
+	 * here for every packet.
 	 */
 	ret = fq_codel_drop(sch, q->drop_batch_size, to_free);
 
@@ -263,6 +323,7 @@ static struct sk_buff *dequeue_func(struct codel_vars *vars, void *ctx)
 	if (flow->head) {
 		skb = dequeue_head(flow);
 		q->backlogs[flow - q->flows] -= qdisc_pkt_len(skb);
+		fq_codel_heap_down(q, flow - q->flows);
 		q->memory_usage -= get_codel_cb(skb)->mem_usage;
 		sch->q.qlen--;
 		sch->qstats.backlog -= qdisc_pkt_len(skb);
@@ -362,6 +423,7 @@ static const struct nla_policy fq_codel_policy[TCA_FQ_CODEL_MAX + 1] = {
 	[TCA_FQ_CODEL_MEMORY_LIMIT] = { .type = NLA_U32 },
 	[TCA_FQ_CODEL_CE_THRESHOLD_SELECTOR] = { .type = NLA_U8 },
 	[TCA_FQ_CODEL_CE_THRESHOLD_MASK] = { .type = NLA_U8 },
+	[TCA_FQ_CODEL_FLOW_QUOTA] = { .type = NLA_U32 },
 };
 
 static int fq_codel_change(struct Qdisc *sch, struct nlattr *opt,
@@ -431,6 +493,9 @@ static int fq_codel_change(struct Qdisc *sch, struct nlattr *opt,
 	if (tb[TCA_FQ_CODEL_MEMORY_LIMIT])
 		q->memory_limit = min(1U << 31, nla_get_u32(tb[TCA_FQ_CODEL_MEMORY_LIMIT]));
 
+	if (tb[TCA_FQ_CODEL_FLOW_QUOTA])
+		q->flow_quota = nla_get_u32(tb[TCA_FQ_CODEL_FLOW_QUOTA]);
+
 	while (sch->q.qlen > sch->limit ||
 	       q->memory_usage > q->memory_limit) {
 		struct sk_buff *skb = fq_codel_dequeue(sch);
@@ -452,6 +517,8 @@ static void fq_codel_destroy(struct Qdisc *sch)
 	struct fq_codel_sched_data *q = qdisc_priv(sch);
 
 	tcf_block_put(q->block);
+	kvfree(q->heap_pos);
+	kvfree(q->heap);
 	kvfree(q->backlogs);
 	kvfree(q->flows);
 }
@@ -498,11 +565,19 @@ static int fq_codel_init(struct Qdisc *sch, struct nlattr *opt,
 			err = -ENOMEM;
 			goto alloc_failure;
 		}
+		q->heap = kvcalloc(q->flows_cnt, sizeof(u32), GFP_KERNEL);
+		q->heap_pos = kvcalloc(q->flows_cnt, sizeof(u32), GFP_KERNEL);
+		if (!q->heap || !q->heap_pos) {
+			err = -ENOMEM;
+			goto heap_failure;
+		}
 		for (i = 0; i < q->flows_cnt; i++) {
 			struct fq_codel_flow *flow = q->flows + i;
 
 			INIT_LIST_HEAD(&flow->flowchain);
 			codel_vars_init(&flow->cvars);
+			q->heap[i] = i;
+			q->heap_pos[i] = i;
 		}
 	}
 	if (sch->limit >= 1)
@@ -511,6 +586,13 @@ static int fq_codel_init(struct Qdisc *sch, struct nlattr *opt,
 		sch->flags &= ~TCQ_F_CAN_BYPASS;
 	return 0;
 
+heap_failure:
+	kvfree(q->heap_pos);
+	q->heap_pos = NULL;
+	kvfree(q->heap);
+	q->heap = NULL;
+	kvfree(q->backlogs);
+	q->backlogs = NULL;
 alloc_failure:
 	kvfree(q->flows);
 	q->flows = NULL;
@@ -543,7 +625,9 @@ static int fq_codel_dump(struct Qdisc *sch, struct sk_buff *skb)
 	    nla_put_u32(skb, TCA_FQ_CODEL_MEMORY_LIMIT,
 			q->memory_limit) ||
 	    nla_put_u32(skb, TCA_FQ_CODEL_FLOWS,
-			q->flows_cnt))
+			q->flows_cnt) ||
+	    nla_put_u32(skb, TCA_FQ_CODEL_FLOW_QUOTA,
+			q->flow_quota))
 		goto nla_put_failure;
 
 	if (q->cparams.ce_threshold != CODEL_DISABLED_THRESHOLD) {
@@ -577,6 +661,7 @@ static int fq_codel_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 	st.qdisc_stats.ce_mark = q->cstats.ce_mark;
 	st.qdisc_stats.memory_usage  = q->memory_usage;
 	st.qdisc_stats.drop_overmemory = q->drop_overmemory;
+	st.qdisc_stats.drop_flow_quota = q->drop_flow_quota;
 
 	sch_tree_lock(sch);
 	list_for_each(pos, &q->new_flows)
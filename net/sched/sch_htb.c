@@ -66,6 +66,10 @@ static int htb_rate_est = 0; /* htb classes have a default rate estimator */
 module_param(htb_rate_est, int, 0640);
 MODULE_PARM_DESC(htb_rate_est, "setup a default rate estimator (4sec 16sec) for htb classes");
 
+static unsigned int htb_charge_batch __read_mostly; /* bytes, 0 = off */
+module_param(htb_charge_batch, uint, 0640);
+MODULE_PARM_DESC(htb_charge_batch, "bytes a leaf sends on its own rate before its ancestors are charged, less CPU load, less accurate");
+
 /* used internaly to keep status of single class */
 enum htb_cmode {
 	HTB_CANT_SEND,		/* class can't send and can't borrow */
@@ -126,6 +130,8 @@ struct htb_class {
 			int		deficit[TC_HTB_MAXDEPTH];
 			struct Qdisc	*q;
 			struct netdev_queue *offload_queue;
+			u32		batch_bytes;	/* not yet charged */
+			u32		batch_pkts;	/* to the ancestors */
 		} leaf;
 		struct htb_class_inner {
 			struct htb_prio clprio[TC_HTB_NUMPRIO];
@@ -692,40 +698,70 @@ static inline void htb_accnt_ctokens(struct htb_class *cl, int bytes, s64 diff)
  * CAN_SEND) because we can use more precise clock that event queue here.
  * In such case we remove class from event queue first.
  */
-static void htb_charge_class(struct htb_sched *q, struct htb_class *cl,
-			     int level, struct sk_buff *skb)
+static void htb_charge_one(struct htb_sched *q, struct htb_class *cl,
+			   int level, int bytes, u32 packets)
 {
-	int bytes = qdisc_pkt_len(skb);
 	enum htb_cmode old_mode;
 	s64 diff;
 
-	while (cl) {
-		diff = min_t(s64, q->now - cl->t_c, cl->mbuffer);
-		if (cl->level >= level) {
-			if (cl->level == level)
-				cl->xstats.lends++;
-			htb_accnt_tokens(cl, bytes, diff);
-		} else {
-			cl->xstats.borrows++;
-			cl->tokens += diff;	/* we moved t_c; update tokens */
-		}
-		htb_accnt_ctokens(cl, bytes, diff);
-		cl->t_c = q->now;
+	diff = min_t(s64, q->now - cl->t_c, cl->mbuffer);
+	if (cl->level >= level) {
+		if (cl->level == level)
+			cl->xstats.lends++;
+		htb_accnt_tokens(cl, bytes, diff);
+	} else {
+		cl->xstats.borrows++;
+		cl->tokens += diff;	/* we moved t_c; update tokens */
+	}
+	htb_accnt_ctokens(cl, bytes, diff);
+	cl->t_c = q->now;
+
+	old_mode = cl->cmode;
+	diff = 0;
+	htb_change_class_mode(q, cl, &diff);
+	if (old_mode != cl->cmode) {
+		if (old_mode != HTB_CAN_SEND)
+			htb_safe_rb_erase(&cl->pq_node, &q->hlevel[cl->level].wait_pq);
+		if (cl->cmode != HTB_CAN_SEND)
+			htb_add_to_wait_tree(q, cl, diff);
+	}
 
-		old_mode = cl->cmode;
-		diff = 0;
-		htb_change_class_mode(q, cl, &diff);
-		if (old_mode != cl->cmode) {
-			if (old_mode != HTB_CAN_SEND)
-				htb_safe_rb_erase(&cl->pq_node, &q->hlevel[cl->level].wait_pq);
-			if (cl->cmode != HTB_CAN_SEND)
-				htb_add_to_wait_tree(q, cl, diff);
-		}
+	/* update basic stats except for leaves which are already updated */
+	if (cl->level)
+		_bstats_update(&cl->bstats, bytes, packets);
+}
 
-		/* update basic stats except for leaves which are already updated */
-		if (cl->level)
-			bstats_update(&cl->bstats, skb);
+static void htb_charge_class(struct htb_sched *q, struct htb_class *cl,
+			     int level, struct sk_buff *skb)
+{
+	unsigned int batch = READ_ONCE(htb_charge_batch);
+	u32 packets = skb_is_gso(skb) ? skb_shinfo(skb)->gso_segs : 1;
+	int bytes = qdisc_pkt_len(skb);
+
+	/* A leaf that sent on its own rate is charged right away, so per
+	 * leaf limits stay exact. With htb_charge_batch set its ancestors
+	 * are charged for several packets at once, which takes the walk up
+	 * the tree and the wait queue updates off most dequeues, at the
+	 * cost of ancestors running up to one batch per leaf over their
+	 * limits. A leaf that borrowed charges the lender immediately.
+	 */
+	if (batch && level == 0 && cl->parent) {
+		htb_charge_one(q, cl, level, bytes, packets);
+
+		cl->leaf.batch_bytes += bytes;
+		cl->leaf.batch_pkts += packets;
+		if (cl->leaf.batch_bytes < batch)
+			return;
+
+		bytes = cl->leaf.batch_bytes;
+		packets = cl->leaf.batch_pkts;
+		cl->leaf.batch_bytes = 0;
+		cl->leaf.batch_pkts = 0;
+		cl = cl->parent;
+	}
 
+	while (cl) {
+		htb_charge_one(q, cl, level, bytes, packets);
 		cl = cl->parent;
 	}
 }
@@ -327,8 +327,10 @@ static void tls_sk_proto_close(struct sock *sk, long timeout)
 	long timeo = sock_sndtimeo(sk, 0);
 	bool free_ctx;
 
-	if (ctx->tx_conf == TLS_SW)
+	if (ctx->tx_conf == TLS_SW) {
+		tls_sw_tx_flush_deferred(sk);
 		tls_sw_cancel_work_tx(ctx);
+	}
 
 	lock_sock(sk);
 	free_ctx = ctx->tx_conf != TLS_HW && ctx->rx_conf != TLS_HW;
@@ -589,6 +591,29 @@ static int do_tls_getsockopt_tx_zc(struct sock *sk, char __user *optval,
 	return 0;
 }
 
+static int do_tls_getsockopt_tx_coalesce(struct sock *sk, char __user *optval,
+					  int __user *optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	unsigned int value;
+	int len;
+
+	if (ctx->tx_conf != TLS_SW)
+		return -EINVAL;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	if (len != sizeof(value))
+		return -EINVAL;
+
+	value = tls_sw_ctx_tx(ctx)->tx_coalesce_us;
+	if (copy_to_user(optval, &value, sizeof(value)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int do_tls_getsockopt_no_pad(struct sock *sk, char __user *optval,
 				    int __user *optlen)
 {
@@ -636,6 +661,9 @@ static int do_tls_getsockopt(struct sock *sk, int optname,
 	case TLS_RX_EXPECT_NO_PAD:
 		rc = do_tls_getsockopt_no_pad(sk, optval, optlen);
 		break;
+	case TLS_TX_COALESCE:
+		rc = do_tls_getsockopt_tx_coalesce(sk, optval, optlen);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
@@ -828,6 +856,30 @@ static int do_tls_setsockopt_tx_zc(struct sock *sk, sockptr_t optval,
 	return 0;
 }
 
+static int do_tls_setsockopt_tx_coalesce(struct sock *sk, sockptr_t optval,
+					  unsigned int optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	unsigned int value;
+
+	/* The device offload builds its records in tls_device.c */
+	if (ctx->tx_conf != TLS_SW)
+		return -EINVAL;
+
+	if (sockptr_is_null(optval) || optlen != sizeof(value))
+		return -EINVAL;
+
+	if (copy_from_sockptr(&value, optval, sizeof(value)))
+		return -EFAULT;
+
+	if (value > USEC_PER_SEC)
+		return -EINVAL;
+
+	tls_sw_ctx_tx(ctx)->tx_coalesce_us = value;
+
+	return 0;
+}
+
 static int do_tls_setsockopt_no_pad(struct sock *sk, sockptr_t optval,
 				    unsigned int optlen)
 {
@@ -881,6 +933,11 @@ static int do_tls_setsockopt(struct sock *sk, int optname, sockptr_t optval,
 	case TLS_RX_EXPECT_NO_PAD:
 		rc = do_tls_setsockopt_no_pad(sk, optval, optlen);
 		break;
+	case TLS_TX_COALESCE:
+		lock_sock(sk);
+		rc = do_tls_setsockopt_tx_coalesce(sk, optval, optlen);
+		release_sock(sk);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
@@ -892,10 +949,18 @@ static int tls_setsockopt(struct sock *sk, int level, int optname,
 			  sockptr_t optval, unsigned int optlen)
 {
 	struct tls_context *ctx = tls_get_ctx(sk);
+	int rc;
 
-	if (level != SOL_TLS)
-		return ctx->sk_proto->setsockopt(sk, level, optname, optval,
-						 optlen);
+	if (level != SOL_TLS) {
+		rc = ctx->sk_proto->setsockopt(sk, level, optname, optval,
+					       optlen);
+		/* Uncork closes a record held back while corked */
+		if (!rc && level == SOL_TCP && optname == TCP_CORK &&
+		    ctx->tx_conf == TLS_SW && sk->sk_socket &&
+		    !(tcp_sk(sk)->nonagle & TCP_NAGLE_CORK))
+			tls_sw_splice_eof(sk->sk_socket);
+		return rc;
+	}
 
 	return do_tls_setsockopt(sk, optname, optval, optlen);
 }
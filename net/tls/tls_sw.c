@@ -967,6 +967,61 @@ static int tls_sw_push_pending_record(struct sock *sk, int flags)
 				   &copied, flags);
 }
 
+/* Same ceiling TCP puts on data held back by TCP_CORK */
+#define TLS_TX_CORK_DELAY	(HZ / 5)
+
+/* A send that would end the record may instead leave it open when the
+ * socket asked for coalescing (TLS_TX_COALESCE) or the TCP socket is
+ * corked, so that back-to-back short writes share one record: one
+ * header, one tag and one AEAD call instead of one per write. The
+ * record still closes when it fills up, on a later send that is not
+ * deferred, on uncork, or from tx_work once tx_flush_at has passed.
+ */
+static bool tls_sw_tx_defer(struct sock *sk, struct tls_sw_context_tx *ctx)
+{
+	unsigned long delay;
+
+	if (ctx->tx_coalesce_us)
+		delay = usecs_to_jiffies(ctx->tx_coalesce_us);
+	else if (tcp_sk(sk)->nonagle & TCP_NAGLE_CORK)
+		delay = TLS_TX_CORK_DELAY;
+	else
+		goto no_defer;
+
+	if (!test_and_set_bit(BIT_TX_FLUSH, &ctx->tx_bitmask)) {
+		ctx->tx_flush_at = jiffies + delay;
+		return true;
+	}
+	/* Already held back for long enough, close it now */
+	if (time_before(jiffies, ctx->tx_flush_at))
+		return true;
+no_defer:
+	clear_bit(BIT_TX_FLUSH, &ctx->tx_bitmask);
+	return false;
+}
+
+/* Make sure tx_work is going to close a record held back by
+ * tls_sw_tx_defer(). Must be called with the socket locked.
+ */
+static void tls_sw_tx_arm_flush(struct tls_sw_context_tx *ctx)
+{
+	struct tls_rec *rec = ctx->open_rec;
+	unsigned long delay = 0;
+
+	if (!test_bit(BIT_TX_FLUSH, &ctx->tx_bitmask))
+		return;
+
+	if (!rec || !rec->msg_plaintext.sg.size) {
+		clear_bit(BIT_TX_FLUSH, &ctx->tx_bitmask);
+		return;
+	}
+
+	if (time_before(jiffies, ctx->tx_flush_at))
+		delay = ctx->tx_flush_at - jiffies;
+	if (!test_and_set_bit(BIT_TX_SCHEDULED, &ctx->tx_bitmask))
+		schedule_delayed_work(&ctx->tx_work.work, delay);
+}
+
 int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 {
 	long timeo = sock_sndtimeo(sk, msg->msg_flags & MSG_DONTWAIT);
@@ -1008,6 +1063,13 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 		}
 	}
 
+	/* Only data records may be left open: anything appended later
+	 * would go out under the record type of the first write.
+	 */
+	if (eor && record_type == TLS_RECORD_TYPE_DATA &&
+	    tls_sw_tx_defer(sk, ctx))
+		eor = false;
+
 	while (msg_data_left(msg)) {
 		if (sk->sk_err) {
 			ret = -sk->sk_err;
@@ -1173,6 +1235,7 @@ trim_sgl:
 	}
 
 send_end:
+	tls_sw_tx_arm_flush(ctx);
 	ret = sk_stream_error(sk, msg->msg_flags, ret);
 
 	release_sock(sk);
@@ -1259,6 +1322,8 @@ static int tls_sw_do_sendpage(struct sock *sk, struct page *page,
 	bool eor;
 
 	eor = !(flags & MSG_SENDPAGE_NOTLAST);
+	if (eor && tls_sw_tx_defer(sk, ctx))
+		eor = false;
 	sk_clear_bit(SOCKWQ_ASYNC_NOSPACE, sk);
 
 	/* Call the sk_stream functions to manage the sndbuf mem. */
@@ -1355,6 +1420,7 @@ wait_for_memory:
 		}
 	}
 sendpage_end:
+	tls_sw_tx_arm_flush(ctx);
 	ret = sk_stream_error(sk, flags, ret);
 	return copied > 0 ? copied : ret;
 }
@@ -1524,6 +1590,34 @@ tls_alloc_clrtxt_skb(struct sock *sk, struct sk_buff *skb,
 	return clr_skb;
 }
 
+/* Synchronous decrypts are done and the request memory released before
+ * the reader lock is dropped, so a single buffer per socket can back all
+ * of them instead of a kmalloc()/kfree() pair per record. Async requests
+ * are freed from tls_decrypt_done() and keep their own allocation.
+ */
+static void *tls_decrypt_mem_get(struct sock *sk, struct tls_sw_context_rx *ctx,
+				 const struct tls_decrypt_arg *darg,
+				 unsigned int size)
+{
+	void *mem;
+
+	if (darg->async)
+		return kmalloc(size, sk->sk_allocation);
+
+	if (likely(size <= ctx->dec_mem_size))
+		return ctx->dec_mem;
+
+	size = kmalloc_size_roundup(size);
+	mem = kmalloc(size, sk->sk_allocation);
+	if (!mem)
+		return NULL;
+
+	kfree(ctx->dec_mem);
+	ctx->dec_mem = mem;
+	ctx->dec_mem_size = size;
+	return mem;
+}
+
 /* Decrypt handlers
  *
  * tls_decrypt_sw() and tls_decrypt_device() are decrypt handlers.
@@ -1597,8 +1691,9 @@ static int tls_decrypt_sg(struct sock *sk, struct iov_iter *out_iov,
 	 */
 	aead_size = sizeof(*aead_req) + crypto_aead_reqsize(ctx->aead_recv);
 	aead_size = ALIGN(aead_size, __alignof__(*dctx));
-	mem = kmalloc(aead_size + struct_size(dctx, sg, size_add(n_sgin, n_sgout)),
-		      sk->sk_allocation);
+	mem = tls_decrypt_mem_get(sk, ctx, darg,
+				  aead_size + struct_size(dctx, sg,
+							  size_add(n_sgin, n_sgout)));
 	if (!mem) {
 		err = -ENOMEM;
 		goto exit_free_skb;
@@ -1710,7 +1805,8 @@ exit_free_pages:
 	for (; pages > 0; pages--)
 		put_page(sg_page(&sgout[pages]));
 exit_free:
-	kfree(mem);
+	if (mem != ctx->dec_mem)
+		kfree(mem);
 exit_free_skb:
 	consume_skb(clear_skb);
 	return err;
@@ -2431,6 +2527,21 @@ static void tls_data_ready(struct sock *sk)
 	}
 }
 
+/* Send a record still held back by tls_sw_tx_defer(), on close. Once
+ * tx_work is cancelled nothing else would push it out.
+ */
+void tls_sw_tx_flush_deferred(struct sock *sk)
+{
+	struct tls_context *tls_ctx = tls_get_ctx(sk);
+	struct tls_sw_context_tx *ctx = tls_sw_ctx_tx(tls_ctx);
+
+	if (!test_and_clear_bit(BIT_TX_FLUSH, &ctx->tx_bitmask))
+		return;
+
+	if (sk->sk_socket)
+		tls_sw_splice_eof(sk->sk_socket);
+}
+
 void tls_sw_cancel_work_tx(struct tls_context *tls_ctx)
 {
 	struct tls_sw_context_tx *ctx = tls_sw_ctx_tx(tls_ctx);
@@ -2492,6 +2603,9 @@ void tls_sw_release_resources_rx(struct sock *sk)
 	if (ctx->aead_recv) {
 		__skb_queue_purge(&ctx->rx_list);
 		crypto_free_aead(ctx->aead_recv);
+		kfree(ctx->dec_mem);
+		ctx->dec_mem = NULL;
+		ctx->dec_mem_size = 0;
 		tls_strp_stop(&ctx->strp);
 		/* If tls_sw_strparser_arm() was not called (cleanup paths)
 		 * we still want to tls_strp_stop(), but sk->sk_data_ready was
@@ -2549,7 +2663,13 @@ static void tx_work_handler(struct work_struct *work)
 
 	if (mutex_trylock(&tls_ctx->tx_lock)) {
 		lock_sock(sk);
+		if (test_bit(BIT_TX_FLUSH, &ctx->tx_bitmask) &&
+		    !time_before(jiffies, ctx->tx_flush_at)) {
+			clear_bit(BIT_TX_FLUSH, &ctx->tx_bitmask);
+			tls_sw_push_pending_record(sk, MSG_DONTWAIT);
+		}
 		tls_tx_records(sk, -1);
+		tls_sw_tx_arm_flush(ctx);
 		release_sock(sk);
 		mutex_unlock(&tls_ctx->tx_lock);
 	} else if (!test_and_set_bit(BIT_TX_SCHEDULED, &ctx->tx_bitmask)) {
@@ -5,6 +5,7 @@
  * Copyright (c) 2002 James Morris <jmorris@intercode.com.au>
  */
 
+#include <crypto/aead.h>
 #include <crypto/hash.h>
 #include <crypto/skcipher.h>
 #include <linux/module.h>
@@ -791,6 +792,31 @@ struct xfrm_algo_desc *xfrm_aead_get_byname(const char *name, int icv_len, int p
 }
 EXPORT_SYMBOL_GPL(xfrm_aead_get_byname);
 
+/*
+ * Allocate the AEAD transform of an SA.  With XFRM_SA_XFLAG_PCRYPT the
+ * transform is wrapped in pcrypt, so that the packets of this one SA are
+ * processed on all CPUs of pcrypt's parallel cpumask and completed in
+ * order.  Falls back to the plain transform if pcrypt is unavailable.
+ */
+struct crypto_aead *xfrm_alloc_aead(const struct xfrm_state *x,
+				    const char *name)
+{
+	char pname[CRYPTO_MAX_ALG_NAME];
+	struct crypto_aead *aead;
+
+	if (!(x->props.extra_flags & XFRM_SA_XFLAG_PCRYPT) ||
+	    snprintf(pname, sizeof(pname), "pcrypt(%s)", name) >=
+	    sizeof(pname))
+		return crypto_alloc_aead(name, 0, 0);
+
+	aead = crypto_alloc_aead(pname, 0, 0);
+	if (IS_ERR(aead))
+		aead = crypto_alloc_aead(name, 0, 0);
+
+	return aead;
+}
+EXPORT_SYMBOL_GPL(xfrm_alloc_aead);
+
 struct xfrm_algo_desc *xfrm_aalg_get_byidx(unsigned int idx)
 {
 	if (idx >= aalg_entries())
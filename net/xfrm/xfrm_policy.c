@@ -2141,9 +2141,9 @@ fail:
 	return ret;
 }
 
-static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
-					      const struct flowi *fl,
-					      u16 family, u8 dir, u32 if_id)
+static struct xfrm_policy *__xfrm_policy_lookup(struct net *net,
+						const struct flowi *fl,
+						u16 family, u8 dir, u32 if_id)
 {
 #ifdef CONFIG_XFRM_SUB_POLICY
 	struct xfrm_policy *pol;
@@ -2157,6 +2157,146 @@ static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
 					 dir, if_id);
 }
 
+/*
+ * Per-cpu cache of policy lookup results, keyed on every flow field
+ * xfrm_policy_match() looks at. Entries carry the value of
+ * xfrm_pol_cache_genid at lookup time, which is bumped whenever a
+ * policy is linked or unlinked in any netns, and when the LSM policy
+ * that decides on labeled policies changes, so a hit always returns
+ * what a fresh lookup would. Negative results are cached too: with
+ * a few dozen policies most forwarded flows match none of them.
+ */
+#define XFRM_POL_CACHE_SIZE	64
+
+struct xfrm_pol_cache_key {
+	const struct net	*net;
+	xfrm_address_t		daddr;
+	xfrm_address_t		saddr;
+	u32			if_id;
+	u32			mark;
+	u32			secid;
+	int			oif;
+	__be16			dport;
+	__be16			sport;
+	u16			family;
+	u8			proto;
+	u8			dir;
+};
+
+struct xfrm_pol_cache_entry {
+	struct xfrm_pol_cache_key	key;
+	unsigned int			genid;
+	struct xfrm_policy		*pol;
+};
+
+static DEFINE_PER_CPU(struct xfrm_pol_cache_entry [XFRM_POL_CACHE_SIZE],
+		      xfrm_pol_cache);
+static atomic_t xfrm_pol_cache_genid;
+
+static bool xfrm_policy_cache __read_mostly = true;
+module_param_named(policy_cache, xfrm_policy_cache, bool, 0644);
+MODULE_PARM_DESC(policy_cache, "Cache policy lookups per flow and cpu");
+
+static void xfrm_pol_cache_invalidate(void)
+{
+	/* Fully ordered, the policy lists are updated before the bump */
+	atomic_inc_return(&xfrm_pol_cache_genid);
+}
+
+/* security_xfrm_policy_lookup() answers may change with the LSM policy */
+static int xfrm_pol_cache_lsm_notify(struct notifier_block *nb,
+				     unsigned long event, void *data)
+{
+	if (event == LSM_POLICY_CHANGE)
+		xfrm_pol_cache_invalidate();
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block xfrm_pol_cache_lsm_nb = {
+	.notifier_call = xfrm_pol_cache_lsm_notify,
+};
+
+static bool xfrm_pol_cache_key(struct xfrm_pol_cache_key *key,
+			       const struct net *net, const struct flowi *fl,
+			       u16 family, u8 dir, u32 if_id)
+{
+	const union flowi_uli *uli;
+
+	memset(key, 0, sizeof(*key));
+
+	switch (family) {
+	case AF_INET:
+		key->daddr.a4 = fl->u.ip4.daddr;
+		key->saddr.a4 = fl->u.ip4.saddr;
+		uli = &fl->u.ip4.uli;
+		break;
+	case AF_INET6:
+		key->daddr.in6 = fl->u.ip6.daddr;
+		key->saddr.in6 = fl->u.ip6.saddr;
+		uli = &fl->u.ip6.uli;
+		break;
+	default:
+		return false;
+	}
+
+	key->net = net;
+	key->if_id = if_id;
+	key->mark = fl->flowi_mark;
+	key->secid = fl->flowi_secid;
+	key->oif = fl->flowi_oif;
+	key->dport = xfrm_flowi_dport(fl, uli);
+	key->sport = xfrm_flowi_sport(fl, uli);
+	key->family = family;
+	key->proto = fl->flowi_proto;
+	key->dir = dir;
+
+	return true;
+}
+
+static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
+					      const struct flowi *fl,
+					      u16 family, u8 dir, u32 if_id)
+{
+	struct xfrm_pol_cache_entry *e;
+	struct xfrm_pol_cache_key key;
+	struct xfrm_policy *pol;
+	unsigned int genid;
+
+	if (!READ_ONCE(xfrm_policy_cache) ||
+	    !xfrm_pol_cache_key(&key, net, fl, family, dir, if_id))
+		return __xfrm_policy_lookup(net, fl, family, dir, if_id);
+
+	/* Keeps a cached policy from being freed once we saw genid match */
+	rcu_read_lock();
+	local_bh_disable();
+
+	genid = atomic_read_acquire(&xfrm_pol_cache_genid);
+	e = this_cpu_ptr(&xfrm_pol_cache[jhash(&key, sizeof(key), 0) %
+					 XFRM_POL_CACHE_SIZE]);
+
+	if (e->genid == genid && !memcmp(&e->key, &key, sizeof(key))) {
+		pol = e->pol;
+		if (!pol || xfrm_pol_hold_rcu(pol)) {
+			XFRM_INC_STATS(net, LINUX_MIB_XFRMPOLCACHEHIT);
+			goto out;
+		}
+	}
+
+	XFRM_INC_STATS(net, LINUX_MIB_XFRMPOLCACHEMISS);
+	pol = __xfrm_policy_lookup(net, fl, family, dir, if_id);
+	if (!IS_ERR(pol)) {
+		e->key = key;
+		e->genid = genid;
+		e->pol = pol;
+	}
+out:
+	local_bh_enable();
+	rcu_read_unlock();
+
+	return pol;
+}
+
 static struct xfrm_policy *xfrm_sk_policy_lookup(const struct sock *sk, int dir,
 						 const struct flowi *fl,
 						 u16 family, u32 if_id)
@@ -2207,6 +2347,7 @@ static void __xfrm_policy_link(struct xfrm_policy *pol, int dir)
 	list_add(&pol->walk.all, &net->xfrm.policy_all);
 	net->xfrm.policy_count[dir]++;
 	xfrm_pol_hold(pol);
+	xfrm_pol_cache_invalidate();
 }
 
 static struct xfrm_policy *__xfrm_policy_unlink(struct xfrm_policy *pol,
@@ -2226,6 +2367,7 @@ static struct xfrm_policy *__xfrm_policy_unlink(struct xfrm_policy *pol,
 
 	list_del_init(&pol->walk.all);
 	net->xfrm.policy_count[dir]--;
+	xfrm_pol_cache_invalidate();
 
 	return pol;
 }
@@ -4185,6 +4327,10 @@ void __init xfrm_init(void)
 	xfrm_dev_init();
 	xfrm_input_init();
 
+	/* Without LSM notifications cached verdicts could go stale */
+	if (register_blocking_lsm_notifier(&xfrm_pol_cache_lsm_nb))
+		xfrm_policy_cache = false;
+
 #ifdef CONFIG_XFRM_ESPINTCP
 	espintcp_init();
 #endif
@@ -41,6 +41,8 @@ static const struct snmp_mib xfrm_mib_list[] = {
 	SNMP_MIB_ITEM("XfrmFwdHdrError", LINUX_MIB_XFRMFWDHDRERROR),
 	SNMP_MIB_ITEM("XfrmOutStateInvalid", LINUX_MIB_XFRMOUTSTATEINVALID),
 	SNMP_MIB_ITEM("XfrmAcquireError", LINUX_MIB_XFRMACQUIREERROR),
+	SNMP_MIB_ITEM("XfrmPolCacheHit", LINUX_MIB_XFRMPOLCACHEHIT),
+	SNMP_MIB_ITEM("XfrmPolCacheMiss", LINUX_MIB_XFRMPOLCACHEMISS),
 	SNMP_MIB_SENTINEL
 };
 
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LPM trie with BPF_F_LPM_STRIDE: lookups through the 16-bit stride table
+ * must give the same answers as the plain trie walk, in particular for
+ * /16 nodes with children of their own and for prefixes shorter than 16
+ * bits that cover many table entries. Also checks BPF_F_REPLACE_ALL
+ * batch updates, including that a failing batch commits nothing.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+
+#include <bpf/bpf.h>
+
+#include "bpf_util.h"
+
+#ifndef BPF_F_LPM_STRIDE
+#define BPF_F_LPM_STRIDE	(1U << 14)
+#endif
+#ifndef BPF_F_REPLACE_ALL
+#define BPF_F_REPLACE_ALL	8
+#endif
+
+/* The stride table is rebuilt HZ / 10 after the last update */
+#define STRIDE_SETTLE_US	300000
+
+struct lpm_key4 {
+	__u32 prefixlen;
+	__u8 data[4];
+};
+
+struct route {
+	const char *addr;
+	__u32 prefixlen;
+	__u32 value;
+};
+
+struct probe {
+	const char *addr;
+	__u32 value;		/* 0: no match */
+};
+
+static struct lpm_key4 make_key(const char *addr, __u32 prefixlen)
+{
+	struct lpm_key4 key = { .prefixlen = prefixlen };
+
+	assert(inet_pton(AF_INET, addr, key.data) == 1);
+	return key;
+}
+
+static void check_probes(int fd, const struct probe *p, int n, const char *when)
+{
+	struct lpm_key4 key;
+	__u32 value;
+	int i, err;
+
+	for (i = 0; i < n; i++) {
+		key = make_key(p[i].addr, 32);
+		err = bpf_map_lookup_elem(fd, &key, &value);
+		if (!p[i].value) {
+			if (!err || errno != ENOENT) {
+				printf("%s: %s matched %u, expected no match\n",
+				       when, p[i].addr, value);
+				exit(1);
+			}
+			continue;
+		}
+		if (err || value != p[i].value) {
+			printf("%s: %s gave %u (err %d), expected %u\n",
+			       when, p[i].addr, err ? 0 : value, err,
+			       p[i].value);
+			exit(1);
+		}
+	}
+}
+
+static void test_lpm_stride_lookup(int fd)
+{
+	static const struct route routes[] = {
+		{ "10.0.0.0",    8,  1 },
+		{ "10.1.0.0",    16, 2 },	/* /16 with two children */
+		{ "10.1.0.0",    24, 5 },
+		{ "10.1.200.0",  24, 6 },
+		{ "10.2.0.0",    15, 4 },	/* covers 10.2 and 10.3 */
+		{ "10.3.7.0",    24, 7 },
+		{ "172.16.0.0",  12, 8 },	/* 16 table entries */
+		{ "0.0.0.0",     1,  9 },
+	};
+	static const struct probe probes[] = {
+		{ "10.1.0.7",     5 },
+		{ "10.1.200.9",   6 },
+		{ "10.1.100.1",   2 },
+		{ "10.1.255.255", 2 },
+		{ "10.2.1.1",     4 },
+		{ "10.3.1.1",     4 },
+		{ "10.3.7.1",     7 },
+		{ "10.9.9.9",     1 },
+		{ "172.31.0.1",   8 },
+		{ "172.32.0.1",   0 },
+		{ "1.2.3.4",      9 },
+		{ "200.1.1.1",    0 },
+	};
+	struct lpm_key4 key;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		key = make_key(routes[i].addr, routes[i].prefixlen);
+		assert(!bpf_map_update_elem(fd, &key, &routes[i].value, 0));
+	}
+
+	check_probes(fd, probes, ARRAY_SIZE(probes), "trie walk");
+	usleep(STRIDE_SETTLE_US);
+	check_probes(fd, probes, ARRAY_SIZE(probes), "stride table");
+
+	/* Deleting the /16 has to drop the table entry pointing at it */
+	key = make_key("10.1.0.0", 16);
+	assert(!bpf_map_delete_elem(fd, &key));
+	usleep(STRIDE_SETTLE_US);
+	{
+		static const struct probe after[] = {
+			{ "10.1.0.7",   5 },
+			{ "10.1.200.9", 6 },
+			{ "10.1.100.1", 1 },
+		};
+
+		check_probes(fd, after, ARRAY_SIZE(after), "after delete");
+	}
+}
+
+static void test_lpm_replace_all(int fd)
+{
+	static const struct probe probes[] = {
+		{ "192.168.1.5",  8 },
+		{ "192.168.2.5",  7 },
+		{ "10.1.0.7",     0 },
+		{ "10.9.9.9",     0 },
+	};
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts,
+		.elem_flags = BPF_F_REPLACE_ALL,
+	);
+	struct lpm_key4 keys[3];
+	__u32 values[3] = { 7, 8, 9 };
+	__u32 count;
+	int err;
+
+	keys[0] = make_key("192.168.0.0", 16);
+	keys[1] = make_key("192.168.1.0", 24);
+
+	count = 2;
+	err = bpf_map_update_batch(fd, keys, values, &count, &opts);
+	assert(!err && count == 2);
+
+	check_probes(fd, probes, ARRAY_SIZE(probes), "replace");
+	usleep(STRIDE_SETTLE_US);
+	check_probes(fd, probes, ARRAY_SIZE(probes), "replace, stride table");
+
+	/* A bad element fails the batch and leaves the map alone */
+	keys[2] = make_key("10.0.0.0", 8);
+	keys[2].prefixlen = 33;
+	count = 3;
+	err = bpf_map_update_batch(fd, keys, values, &count, &opts);
+	assert(err && count == 0);
+
+	check_probes(fd, probes, ARRAY_SIZE(probes), "failed replace");
+}
+
+int main(void)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_NO_PREALLOC | BPF_F_LPM_STRIDE,
+	);
+	int fd;
+
+	fd = bpf_map_create(BPF_MAP_TYPE_LPM_TRIE, NULL,
+			    sizeof(struct lpm_key4), sizeof(__u32), 1024,
+			    &opts);
+	if (fd < 0 && errno == EINVAL) {
+		printf("test_lpm_stride: SKIP (no BPF_F_LPM_STRIDE)\n");
+		return 4;
+	}
+	assert(fd >= 0);
+
+	test_lpm_stride_lookup(fd);
+	test_lpm_replace_all(fd);
+
+	close(fd);
+	printf("test_lpm_stride: OK\n");
+	return 0;
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Eviction order of an LRU hash map with BPF_F_LRU_CLOCK: once the map is
+ * full, the clock hand has to skip elements that were looked up since it
+ * last passed them and evict the ones that were not.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <linux/bpf.h>
+
+#include <bpf/bpf.h>
+
+#include "bpf_util.h"
+#include "../../../include/linux/filter.h"
+
+#ifndef BPF_F_LRU_CLOCK
+#define BPF_F_LRU_CLOCK		(1U << 13)
+#endif
+
+#define MAP_SIZE	128
+
+/* Lookups from the syscall do not set the ref bit, a program does */
+static int lookup_with_ref_bit(int fd, unsigned long long key, void *value)
+{
+	struct bpf_insn insns[] = {
+		BPF_LD_MAP_VALUE(BPF_REG_9, 0, 0),
+		BPF_LD_MAP_FD(BPF_REG_1, fd),
+		BPF_LD_IMM64(BPF_REG_3, key),
+		BPF_MOV64_REG(BPF_REG_2, BPF_REG_10),
+		BPF_ALU64_IMM(BPF_ADD, BPF_REG_2, -8),
+		BPF_STX_MEM(BPF_DW, BPF_REG_2, BPF_REG_3, 0),
+		BPF_EMIT_CALL(BPF_FUNC_map_lookup_elem),
+		BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 4),
+		BPF_LDX_MEM(BPF_DW, BPF_REG_1, BPF_REG_0, 0),
+		BPF_STX_MEM(BPF_DW, BPF_REG_9, BPF_REG_1, 0),
+		BPF_MOV64_IMM(BPF_REG_0, 42),
+		BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+		BPF_MOV64_IMM(BPF_REG_0, 1),
+		BPF_EXIT_INSN(),
+	};
+	__u8 data[64] = {};
+	LIBBPF_OPTS(bpf_test_run_opts, topts,
+		.data_in = data,
+		.data_size_in = sizeof(data),
+		.repeat = 1,
+	);
+	int mfd, pfd, ret, zero = 0;
+
+	mfd = bpf_map_create(BPF_MAP_TYPE_ARRAY, NULL, sizeof(int),
+			     sizeof(__u64), 1, NULL);
+	assert(mfd >= 0);
+	insns[0].imm = mfd;
+
+	pfd = bpf_prog_load(BPF_PROG_TYPE_SCHED_CLS, NULL, "GPL", insns,
+			    ARRAY_SIZE(insns), NULL);
+	assert(pfd >= 0);
+
+	ret = bpf_prog_test_run_opts(pfd, &topts);
+	if (ret < 0 || topts.retval != 42) {
+		ret = -1;
+	} else {
+		assert(!bpf_map_lookup_elem(mfd, &zero, value));
+		ret = 0;
+	}
+
+	close(pfd);
+	close(mfd);
+	return ret;
+}
+
+static void check_keys(int fd, unsigned long long first,
+		       unsigned long long last, int present)
+{
+	unsigned long long key, value;
+	int err;
+
+	for (key = first; key <= last; key++) {
+		err = bpf_map_lookup_elem(fd, &key, &value);
+		if (present && (err || value != key)) {
+			printf("key %llu missing\n", key);
+			exit(1);
+		}
+		if (!present && (!err || errno != ENOENT)) {
+			printf("key %llu should have been evicted\n", key);
+			exit(1);
+		}
+	}
+}
+
+/* Fill the map, reference its first half, then insert half a map worth of
+ * new keys. Within the first lap of the hand exactly the unreferenced half
+ * is evicted, the new keys land behind the hand.
+ */
+static void test_lru_clock_order(int map_type)
+{
+	LIBBPF_OPTS(bpf_map_create_opts, opts,
+		.map_flags = BPF_F_LRU_CLOCK,
+	);
+	unsigned long long key, value;
+	int fd;
+
+	fd = bpf_map_create(map_type, NULL, sizeof(key), sizeof(value),
+			    MAP_SIZE, &opts);
+	if (fd < 0 && errno == EINVAL) {
+		printf("test_lru_clock: SKIP (no BPF_F_LRU_CLOCK)\n");
+		exit(4);
+	}
+	assert(fd >= 0);
+
+	for (key = 0; key < MAP_SIZE; key++) {
+		value = key;
+		assert(!bpf_map_update_elem(fd, &key, &value, BPF_NOEXIST));
+	}
+
+	for (key = 0; key < MAP_SIZE / 2; key++) {
+		assert(!lookup_with_ref_bit(fd, key, &value));
+		assert(value == key);
+	}
+
+	for (key = MAP_SIZE; key < MAP_SIZE + MAP_SIZE / 2; key++) {
+		value = key;
+		assert(!bpf_map_update_elem(fd, &key, &value, BPF_NOEXIST));
+	}
+
+	check_keys(fd, 0, MAP_SIZE / 2 - 1, 1);
+	check_keys(fd, MAP_SIZE / 2, MAP_SIZE - 1, 0);
+	check_keys(fd, MAP_SIZE, MAP_SIZE + MAP_SIZE / 2 - 1, 1);
+
+	close(fd);
+}
+
+int main(void)
+{
+	test_lru_clock_order(BPF_MAP_TYPE_LRU_HASH);
+
+	printf("test_lru_clock: OK\n");
+	return 0;
+}
@@ -0,0 +1,112 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Check that the XDP forwarder and tc classifier used on the gateway are
+# fully JITed, i.e. that none of them (or their subprograms) silently fell
+# back to the interpreter because the JIT lacks support for an instruction,
+# a bpf-to-bpf call or a kfunc call.
+#
+# Both programs are attached to one end of a veth pair in a private
+# network namespace, so the test does not touch real links.
+#
+# Environment:
+#   XDP_OBJ, XDP_SEC	XDP program object and section [-, xdp]
+#   TC_OBJ, TC_SEC	tc (cls_bpf, direct-action) object and section [-, tc]
+#
+# Example:
+#   XDP_OBJ=xdp_fwd.o TC_OBJ=tc_cls.o ./bpf_jit_check.sh
+
+: "${XDP_SEC:=xdp}" "${TC_SEC:=tc}"
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+NS=bpfjit_$$
+ret=0
+
+log()
+{
+	echo "bpf_jit_check: $*"
+}
+
+cleanup()
+{
+	ip netns del "$NS" 2>/dev/null
+}
+
+# prog_jited <id> <what>
+prog_jited()
+{
+	local id=$1 what=$2
+	local info
+
+	if [ -z "$id" ]; then
+		log "FAIL: $what: no program attached"
+		ret=1
+		return
+	fi
+
+	info=$(bpftool prog show id "$id")
+	if echo "$info" | grep -q "not jited"; then
+		log "FAIL: $what (id $id) runs in the interpreter"
+		echo "$info"
+		ret=1
+	else
+		log "PASS: $what (id $id) is JITed"
+	fi
+}
+
+if [ "$(id -u)" -ne 0 ]; then
+	log "need root privileges"
+	exit $ksft_skip
+fi
+
+if [ -z "$XDP_OBJ" ] && [ -z "$TC_OBJ" ]; then
+	log "set XDP_OBJ and/or TC_OBJ"
+	exit $ksft_skip
+fi
+
+for tool in ip tc bpftool; do
+	if ! command -v $tool >/dev/null; then
+		log "$tool not found"
+		exit $ksft_skip
+	fi
+done
+
+if [ "$(sysctl -n net.core.bpf_jit_enable 2>/dev/null)" != 1 ]; then
+	log "BPF JIT not enabled (net.core.bpf_jit_enable != 1)"
+	exit $ksft_skip
+fi
+
+trap cleanup EXIT
+
+ip netns add "$NS" || exit 1
+ip -n "$NS" link add veth0 type veth peer name veth1 || exit 1
+ip -n "$NS" link set veth0 up
+ip -n "$NS" link set veth1 up
+
+if [ -n "$XDP_OBJ" ]; then
+	if ! ip -n "$NS" link set veth0 xdp obj "$XDP_OBJ" sec "$XDP_SEC"; then
+		log "FAIL: cannot attach $XDP_OBJ:$XDP_SEC"
+		ret=1
+	else
+		id=$(ip -n "$NS" -d link show veth0 |
+		     sed -n 's/.*prog\/xdp id \([0-9]*\).*/\1/p')
+		prog_jited "$id" "XDP $XDP_OBJ:$XDP_SEC"
+	fi
+fi
+
+if [ -n "$TC_OBJ" ]; then
+	tc -n "$NS" qdisc add dev veth0 clsact
+	if ! tc -n "$NS" filter add dev veth0 ingress \
+		bpf da obj "$TC_OBJ" sec "$TC_SEC"; then
+		log "FAIL: cannot attach $TC_OBJ:$TC_SEC"
+		ret=1
+	else
+		id=$(tc -n "$NS" filter show dev veth0 ingress |
+		     sed -n 's/.* id \([0-9]*\).*/\1/p' | head -n 1)
+		prog_jited "$id" "tc $TC_OBJ:$TC_SEC"
+	fi
+fi
+
+exit $ret
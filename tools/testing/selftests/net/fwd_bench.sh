@@ -0,0 +1,346 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# RFC2544-style forwarding benchmark for a two port router/bridge.
+#
+# Runs on the device under test (DUT).  A generator host, reachable
+# over ssh on a separate management link, is cabled to both DUT ports:
+#
+#   peer $GEN_TX ---> $DUT_IN  [DUT]  $DUT_OUT ---> peer $GEN_RX
+#
+# $GEN_RX is moved into a network namespace on the peer, so that the
+# latency probes really cross the DUT.  For every combination of
+# forwarding mode, conntrack, egress qdisc, frame size and flow count
+# the highest pktgen rate with a loss ratio within $LOSS is searched
+# for, then the round trip latency through the DUT is sampled at that
+# rate.  Each result is printed as one JSON object per line on stdout,
+# progress goes to stderr.
+#
+# Environment, defaults in brackets:
+#   PEER		ssh destination of the generator host (required)
+#   GEN_TX, GEN_RX	peer ports facing $DUT_IN / $DUT_OUT [eth0, eth1]
+#   DUT_IN, DUT_OUT	DUT ports [eth0, eth1]
+#   MODES		any of: bridge route flowtable xdp [bridge route flowtable]
+#   CONNTRACK		[off on]	(flowtable always runs with conntrack)
+#   QDISCS		egress qdisc on $DUT_OUT [pfifo_fast fq_codel]
+#   SIZES		Ethernet frame sizes incl. FCS [64 128 256 512 1024 1280 1518]
+#   FLOWS		number of UDP flows [1 16 256 4096]
+#   DURATION		seconds per trial [10]
+#   LOSS		accepted loss, per mille [1]
+#   STEPS		binary search iterations [8]
+#   LINK_MBPS		link speed used for the search ceiling [from $DUT_IN]
+#   XDP_OBJ, XDP_SEC	XDP program forwarding $DUT_IN to $DUT_OUT, for mode xdp
+#
+# Example:
+#   PEER=root@10.0.0.2 SIZES="64 1518" FLOWS="1 256" ./fwd_bench.sh > out.json
+
+: "${GEN_TX:=eth0}" "${GEN_RX:=eth1}"
+: "${DUT_IN:=eth0}" "${DUT_OUT:=eth1}"
+: "${MODES:=bridge route flowtable}"
+: "${CONNTRACK:=off on}"
+: "${QDISCS:=pfifo_fast fq_codel}"
+: "${SIZES:=64 128 256 512 1024 1280 1518}"
+: "${FLOWS:=1 16 256 4096}"
+: "${DURATION:=10}" "${LOSS:=1}" "${STEPS:=8}"
+: "${XDP_SEC:=xdp}"
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+NS=fwdbench_rx
+DUT_IN_IP=192.0.2.1
+GEN_TX_IP=192.0.2.2
+DUT_OUT_IP=198.51.100.1
+GEN_RX_IP=198.51.100.2
+BR_RX_IP=192.0.2.3
+
+log()
+{
+	echo "fwd_bench: $*" >&2
+}
+
+peer()
+{
+	ssh -o BatchMode=yes "$PEER" "$@"
+}
+
+peer_rx()
+{
+	peer ip netns exec "$NS" "$@"
+}
+
+# ---- generator host -------------------------------------------------
+
+peer_setup()
+{
+	peer "modprobe pktgen &&
+	      ip netns add $NS &&
+	      ip link set $GEN_TX up &&
+	      ip link set $GEN_RX netns $NS &&
+	      ip -n $NS link set $GEN_RX up &&
+	      ip -n $NS link set lo up"
+}
+
+peer_cleanup()
+{
+	peer "echo reset > /proc/net/pktgen/pgctrl;
+	      ip netns del $NS;
+	      ip addr flush dev $GEN_TX;
+	      ip route flush 198.51.100.0/24" 2>/dev/null
+}
+
+# Address the peer ends for the current mode.  In bridge mode both peer
+# ports share the DUT_IN subnet, otherwise the DUT routes between them.
+peer_addr()
+{
+	local mode=$1
+
+	peer "ip addr flush dev $GEN_TX; ip route flush 198.51.100.0/24"
+	peer_rx ip addr flush dev "$GEN_RX"
+	peer ip addr add "$GEN_TX_IP/24" dev "$GEN_TX"
+	if [ "$mode" = bridge ]; then
+		peer_rx ip addr add "$BR_RX_IP/24" dev "$GEN_RX"
+		RX_IP=$BR_RX_IP
+	else
+		peer_rx ip addr add "$GEN_RX_IP/24" dev "$GEN_RX"
+		peer_rx ip route add default via "$DUT_OUT_IP"
+		peer ip route add 198.51.100.0/24 via "$DUT_IN_IP"
+		RX_IP=$GEN_RX_IP
+	fi
+}
+
+peer_rx_packets()
+{
+	peer_rx cat "/sys/class/net/$GEN_RX/statistics/rx_packets"
+}
+
+# pktgen_run <dst mac> <frame size> <flows> <pps>
+# Sends $DURATION seconds worth of frames and prints the number sent.
+pktgen_run()
+{
+	local dmac=$1 size=$2 flows=$3 pps=$4
+	local count=$((pps * DURATION))
+	local pg=/proc/net/pktgen
+
+	peer "set -e
+	      echo rem_device_all > $pg/kpktgend_0
+	      echo add_device $GEN_TX > $pg/kpktgend_0
+	      pgset() { echo \"\$1\" > $pg/$GEN_TX; }
+	      pgset 'clone_skb 0'
+	      pgset 'pkt_size $((size - 4))'
+	      pgset 'count $count'
+	      pgset 'ratep $pps'
+	      pgset 'delay 0'
+	      pgset 'dst $RX_IP'
+	      pgset 'dst_mac $dmac'
+	      pgset 'udp_dst_min 9'
+	      pgset 'udp_dst_max 9'
+	      pgset 'udp_src_min 1024'
+	      pgset 'udp_src_max $((1024 + flows - 1))'
+	      pgset 'flag UDPSRC_RND'
+	      echo start > $pg/pgctrl
+	      sed -n 's/.*pkts-sofar: \([0-9]*\).*/\1/p' $pg/$GEN_TX"
+}
+
+# ---- device under test ----------------------------------------------
+
+dut_reset()
+{
+	ip link set "$DUT_IN" xdp off 2>/dev/null
+	ip link del fwdbench_br 2>/dev/null
+	nft delete table inet fwdbench 2>/dev/null
+	nft delete table bridge fwdbench 2>/dev/null
+	ip addr flush dev "$DUT_IN"
+	ip addr flush dev "$DUT_OUT"
+	ip neigh flush dev "$DUT_OUT"
+	tc qdisc del dev "$DUT_OUT" root 2>/dev/null
+	sysctl -qw net.ipv4.ip_forward=0
+}
+
+dut_setup()
+{
+	local mode=$1 ct=$2 qdisc=$3
+	local rx_mac
+
+	rx_mac=$(peer_rx cat "/sys/class/net/$GEN_RX/address")
+	dut_reset
+	ip link set "$DUT_IN" up
+	ip link set "$DUT_OUT" up
+
+	case $mode in
+	bridge)
+		ip link add fwdbench_br type bridge
+		ip link set "$DUT_IN" master fwdbench_br
+		ip link set "$DUT_OUT" master fwdbench_br
+		ip link set fwdbench_br up
+		bridge fdb replace "$rx_mac" dev "$DUT_OUT" master static
+		DST_MAC=$rx_mac
+		;;
+	route|flowtable|xdp)
+		ip addr add "$DUT_IN_IP/24" dev "$DUT_IN"
+		ip addr add "$DUT_OUT_IP/24" dev "$DUT_OUT"
+		ip neigh replace "$GEN_RX_IP" lladdr "$rx_mac" \
+			nud permanent dev "$DUT_OUT"
+		sysctl -qw net.ipv4.ip_forward=1
+		DST_MAC=$(cat "/sys/class/net/$DUT_IN/address")
+		;;
+	esac
+
+	if [ "$mode" = flowtable ]; then
+		nft -f - <<-EOF || return 1
+		table inet fwdbench {
+			flowtable ft {
+				hook ingress priority 0
+				devices = { $DUT_IN, $DUT_OUT }
+			}
+			chain forward {
+				type filter hook forward priority 0
+				meta l4proto udp flow add @ft
+				ct state new,established accept
+			}
+		}
+		EOF
+	elif [ "$ct" = on ]; then
+		local family=inet
+
+		[ "$mode" = bridge ] && family=bridge
+		nft -f - <<-EOF || return 1
+		table $family fwdbench {
+			chain forward {
+				type filter hook forward priority 0
+				ct state new,established accept
+			}
+		}
+		EOF
+	fi
+
+	if [ "$mode" = xdp ]; then
+		ip link set "$DUT_IN" xdpdrv obj "$XDP_OBJ" sec "$XDP_SEC" ||
+			return 1
+	fi
+
+	tc qdisc replace dev "$DUT_OUT" root "$qdisc"
+}
+
+# ---- measurement ----------------------------------------------------
+
+# trial <size> <flows> <pps>: prints "<sent> <received>"
+trial()
+{
+	local before after sent
+
+	before=$(peer_rx_packets)
+	sent=$(pktgen_run "$DST_MAC" "$1" "$2" "$3")
+	sleep 1
+	after=$(peer_rx_packets)
+	echo "${sent:-0} $((after - before))"
+}
+
+# Round trip latency in microseconds ("avg max") while offering <pps>.
+latency()
+{
+	local size=$1 flows=$2 pps=$3
+	local rtt
+
+	# a pktgen count of 0 would mean "forever"
+	if [ "$pps" -gt 0 ]; then
+		pktgen_run "$DST_MAC" "$size" "$flows" "$pps" >/dev/null &
+		sleep 1
+	fi
+	rtt=$(peer ping -q -c $((DURATION * 50)) -i 0.02 -s $((size - 46 > 16 ? size - 46 : 16)) \
+		"$RX_IP" | sed -n 's|.* = [0-9.]*/\([0-9.]*\)/\([0-9.]*\)/.*|\1 \2|p')
+	wait
+	set -- $rtt
+	awk -v a="${1:-0}" -v m="${2:-0}" 'BEGIN { printf "%d %d\n", a * 1000, m * 1000 }'
+}
+
+bench_one()
+{
+	local mode=$1 ct=$2 qdisc=$3 size=$4 flows=$5
+	local lo=0 hi sent rcvd loss i mid best_loss=0
+	local avg max
+
+	hi=$((LINK_MBPS * 1000000 / ((size + 20) * 8)))
+	for ((i = 0; i < STEPS; i++)); do
+		mid=$(((lo + hi + 1) / 2))
+		set -- $(trial "$size" "$flows" "$mid")
+		sent=$1 rcvd=$2
+		[ "$sent" -gt 0 ] || break
+		loss=$(((sent - rcvd) * 1000 / sent))
+		log "$mode ct=$ct $qdisc ${size}B ${flows}f: $mid pps, loss ${loss}/1000"
+		if [ "$loss" -le "$LOSS" ]; then
+			lo=$mid
+			best_loss=$loss
+		else
+			hi=$mid
+		fi
+	done
+
+	set -- $(latency "$size" "$flows" "$lo")
+	avg=$1 max=$2
+
+	printf '{"kernel":"%s","mode":"%s","conntrack":"%s","qdisc":"%s",' \
+		"$(uname -r)" "$mode" "$ct" "$qdisc"
+	printf '"frame_size":%d,"flows":%d,"pps":%d,"mbps":%d,' \
+		"$size" "$flows" "$lo" $((lo * size * 8 / 1000000))
+	printf '"loss_permille":%d,"rtt_avg_us":%d,"rtt_max_us":%d}\n' \
+		"$best_loss" "$avg" "$max"
+}
+
+cleanup()
+{
+	dut_reset
+	peer_cleanup
+}
+
+if [ "$(id -u)" -ne 0 ]; then
+	log "need root"
+	exit $ksft_skip
+fi
+if [ -z "$PEER" ]; then
+	log "PEER is not set, nothing to drive pktgen on"
+	exit $ksft_skip
+fi
+for tool in nft tc bridge ssh; do
+	if ! command -v $tool >/dev/null; then
+		log "$tool not found"
+		exit $ksft_skip
+	fi
+done
+: "${LINK_MBPS:=$(cat "/sys/class/net/$DUT_IN/speed" 2>/dev/null)}"
+if [ -z "$LINK_MBPS" ] || [ "$LINK_MBPS" -le 0 ]; then
+	LINK_MBPS=1000
+fi
+
+trap cleanup EXIT
+peer_setup || exit 1
+
+for mode in $MODES; do
+	if [ "$mode" = xdp ] && [ -z "$XDP_OBJ" ]; then
+		log "mode xdp needs XDP_OBJ, skipped"
+		continue
+	fi
+	peer_addr "$mode"
+
+	for ct in $CONNTRACK; do
+		# flowtable implies conntrack, XDP bypasses both it and qdiscs
+		[ "$mode" = flowtable ] && [ "$ct" = off ] && continue
+		[ "$mode" = xdp ] && [ "$ct" = on ] && continue
+
+		for qdisc in $QDISCS; do
+			if ! dut_setup "$mode" "$ct" "$qdisc"; then
+				log "$mode ct=$ct $qdisc: setup failed, skipped"
+				continue
+			fi
+			for size in $SIZES; do
+				for flows in $FLOWS; do
+					bench_one "$mode" "$ct" "$qdisc" \
+						  "$size" "$flows"
+				done
+			done
+			[ "$mode" = xdp ] && break
+		done
+	done
+done
+
+exit 0
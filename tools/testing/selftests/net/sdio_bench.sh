@@ -0,0 +1,107 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Host side SDIO benchmark for the xradio, rtl8189fs and rtl8189es
+# Wi-Fi drivers, without a radio link.
+#
+# Every driver found exposes an sdio_bench file that times raw reads
+# from the chip: debugfs ieee80211/<phy>/sdio_bench for xradio,
+# /proc/net/<driver>/<ifname>/sdio_bench for the Realtek drivers.
+# Writing "<size> <count>" runs <count> reads of <size> bytes, the
+# last line of the file then holds throughput and per-transfer
+# latency.  The reads run in the writing process, so its user and
+# system time, taken from rusage when it exits, is the CPU cost of the
+# run; it is reported as a percentage of wall time.  For every block size one JSON object per
+# line is printed on stdout, including the running kernel release, so
+# results can be diffed across kernel updates; progress goes to stderr.
+#
+# The interface should be up; reads fail while the chip is powered
+# down.  Nothing is written to the chip.
+#
+# Environment, defaults in brackets:
+#   SIZES	block sizes in bytes, multiples of 4 [4 64 256 512 1024 2048 4096 8188]
+#   COUNT	transfers per block size [1000]
+#
+# Example:
+#   SIZES="512 2048" COUNT=5000 ./sdio_bench.sh > out.json
+
+: "${SIZES:=4 64 256 512 1024 2048 4096 8188}"
+: "${COUNT:=1000}"
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+DEBUGFS=/sys/kernel/debug
+ret=0
+
+log()
+{
+	echo "sdio_bench: $*" >&2
+}
+
+# bench <driver> <file>
+bench()
+{
+	local drv=$1 file=$2
+	local size line times cpu_pct
+	local TIMEFORMAT="%3R %3U %3S"
+
+	for size in $SIZES; do
+		log "$drv: $size bytes x $COUNT"
+		# real user sys of the subshell doing the write
+		if ! times=$( { time (echo "$size $COUNT" > "$file") ; } 2>&1 ); then
+			log "FAIL: $drv: benchmark of $size bytes failed"
+			ret=1
+			continue
+		fi
+		cpu_pct=$(echo "$times" | tail -n 1 |
+			  awk '{ printf "%d", ($1 > 0) ? ($2 + $3) * 100 / $1 : 0 }')
+
+		# size count errors total_us kB/s lat_min_us lat_avg_us lat_max_us
+		line=$(tail -n 1 "$file")
+		set -- $line
+		if [ "$3" != 0 ]; then
+			log "FAIL: $drv: $3 of $2 transfers of $size bytes failed"
+			ret=1
+		fi
+
+		printf '{"kernel":"%s","driver":"%s","file":"%s",' \
+			"$(uname -r)" "$drv" "$file"
+		printf '"size":%s,"count":%s,"errors":%s,"total_us":%s,' \
+			"$1" "$2" "$3" "$4"
+		printf '"kBps":%s,"lat_min_us":%s,"lat_avg_us":%s,' \
+			"$5" "$6" "$7"
+		printf '"lat_max_us":%s,"cpu_pct":%s}\n' "$8" "$cpu_pct"
+	done
+}
+
+if [ "$(id -u)" -ne 0 ]; then
+	log "need root privileges"
+	exit $ksft_skip
+fi
+
+if ! mountpoint -q "$DEBUGFS"; then
+	mount -t debugfs none "$DEBUGFS" 2>/dev/null
+fi
+
+found=0
+for file in "$DEBUGFS"/ieee80211/phy*/sdio_bench \
+	    /proc/net/rtl8189fs/*/sdio_bench \
+	    /proc/net/rtl8189es/*/sdio_bench; do
+	[ -e "$file" ] || continue
+	found=1
+
+	case "$file" in
+	*/ieee80211/*)	drv=xradio ;;
+	*/rtl8189fs/*)	drv=rtl8189fs ;;
+	*)		drv=rtl8189es ;;
+	esac
+	bench "$drv" "$file"
+done
+
+if [ $found -eq 0 ]; then
+	log "no SDIO Wi-Fi driver with sdio_bench found"
+	exit $ksft_skip
+fi
+
+exit $ret
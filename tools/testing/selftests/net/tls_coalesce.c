@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * A record held back by TCP_CORK or TLS_TX_COALESCE must still reach the
+ * peer when the sender closes the socket before it would be flushed, and
+ * a control record (TLS_SET_RECORD_TYPE) must never be held back and
+ * then closed as data.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "../kselftest_harness.h"
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TLS_TX_COALESCE
+#define TLS_TX_COALESCE 5
+#endif
+
+/* Alert record type, see RFC 5246 section 6.2.1 */
+#define TLS_RECORD_TYPE_ALERT	21
+#define TLS_RECORD_TYPE_DATA	23
+
+static int tls_setup_pair(struct __test_metadata *_metadata, int *fd, int *cfd)
+{
+	struct tls12_crypto_info_aes_gcm_128 tls12;
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	struct timeval tv = { .tv_sec = 5 };
+	socklen_t len = sizeof(addr);
+	int sfd;
+
+	memset(&tls12, 0, sizeof(tls12));
+	tls12.info.version = TLS_1_2_VERSION;
+	tls12.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+
+	sfd = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(sfd, 0);
+	ASSERT_EQ(bind(sfd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	ASSERT_EQ(listen(sfd, 1), 0);
+	ASSERT_EQ(getsockname(sfd, (struct sockaddr *)&addr, &len), 0);
+
+	*fd = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(*fd, 0);
+	ASSERT_EQ(connect(*fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	*cfd = accept(sfd, (struct sockaddr *)&addr, &len);
+	ASSERT_GE(*cfd, 0);
+	close(sfd);
+
+	if (setsockopt(*fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) &&
+	    errno == ENOENT)
+		return -1;
+
+	ASSERT_EQ(setsockopt(*fd, SOL_TLS, TLS_TX, &tls12, sizeof(tls12)), 0);
+	ASSERT_EQ(setsockopt(*cfd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")), 0);
+	ASSERT_EQ(setsockopt(*cfd, SOL_TLS, TLS_RX, &tls12, sizeof(tls12)), 0);
+	ASSERT_EQ(setsockopt(*cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)), 0);
+
+	return 0;
+}
+
+static void tls_close_then_recv(struct __test_metadata *_metadata,
+				int fd, int cfd)
+{
+	const char *msgs[] = { "first ", "second ", "third" };
+	char expect[64] = "", buf[64];
+	size_t total = 0;
+	ssize_t n;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		ASSERT_EQ(send(fd, msgs[i], strlen(msgs[i]), 0),
+			  (ssize_t)strlen(msgs[i]));
+		strcat(expect, msgs[i]);
+	}
+	close(fd);
+
+	while (total < strlen(expect)) {
+		n = recv(cfd, buf + total, sizeof(buf) - total, 0);
+		ASSERT_GT(n, 0);
+		total += n;
+	}
+	EXPECT_EQ(total, strlen(expect));
+	EXPECT_EQ(memcmp(buf, expect, total), 0);
+	close(cfd);
+}
+
+TEST(cork_close)
+{
+	int fd, cfd, one = 1;
+
+	if (tls_setup_pair(_metadata, &fd, &cfd))
+		SKIP(return, "no TLS ULP");
+
+	ASSERT_EQ(setsockopt(fd, IPPROTO_TCP, TCP_CORK, &one, sizeof(one)), 0);
+	tls_close_then_recv(_metadata, fd, cfd);
+}
+
+TEST(coalesce_close)
+{
+	unsigned int usecs = 500000;
+	int fd, cfd;
+
+	if (tls_setup_pair(_metadata, &fd, &cfd))
+		SKIP(return, "no TLS ULP");
+
+	ASSERT_EQ(setsockopt(fd, SOL_TLS, TLS_TX_COALESCE, &usecs,
+			     sizeof(usecs)), 0);
+	tls_close_then_recv(_metadata, fd, cfd);
+}
+
+static void tls_send_ctrl(struct __test_metadata *_metadata, int fd,
+			  unsigned char type, const void *data, size_t len)
+{
+	char cbuf[CMSG_SPACE(sizeof(type))];
+	struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr *cmsg;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_TLS;
+	cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(type));
+	*CMSG_DATA(cmsg) = type;
+
+	ASSERT_EQ(sendmsg(fd, &msg, 0), (ssize_t)len);
+}
+
+/* Receive one record, returning its type */
+static unsigned char tls_recv_record(struct __test_metadata *_metadata,
+				     int cfd, void *buf, size_t len,
+				     ssize_t *n)
+{
+	char cbuf[CMSG_SPACE(sizeof(unsigned char))];
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr *cmsg;
+
+	*n = recvmsg(cfd, &msg, 0);
+	if (*n <= 0)
+		return 0;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_TLS &&
+	    cmsg->cmsg_type == TLS_GET_RECORD_TYPE)
+		return *CMSG_DATA(cmsg);
+	return TLS_RECORD_TYPE_DATA;
+}
+
+TEST(coalesce_control_record)
+{
+	const char alert[2] = { 1, 0 };	/* warning, close_notify */
+	unsigned int usecs = 500000;
+	unsigned char type;
+	char buf[64];
+	int fd, cfd;
+	ssize_t n;
+
+	if (tls_setup_pair(_metadata, &fd, &cfd))
+		SKIP(return, "no TLS ULP");
+
+	ASSERT_EQ(setsockopt(fd, SOL_TLS, TLS_TX_COALESCE, &usecs,
+			     sizeof(usecs)), 0);
+
+	/* held back, then closed by the alert in front of it */
+	ASSERT_EQ(send(fd, "before", 6, 0), 6);
+	tls_send_ctrl(_metadata, fd, TLS_RECORD_TYPE_ALERT,
+		      alert, sizeof(alert));
+	/* must go into a record of its own, not onto the alert */
+	ASSERT_EQ(send(fd, "after", 5, 0), 5);
+	close(fd);
+
+	type = tls_recv_record(_metadata, cfd, buf, sizeof(buf), &n);
+	ASSERT_EQ(type, TLS_RECORD_TYPE_DATA);
+	ASSERT_EQ(n, 6);
+	EXPECT_EQ(memcmp(buf, "before", 6), 0);
+
+	type = tls_recv_record(_metadata, cfd, buf, sizeof(buf), &n);
+	ASSERT_EQ(type, TLS_RECORD_TYPE_ALERT);
+	ASSERT_EQ(n, (ssize_t)sizeof(alert));
+	EXPECT_EQ(memcmp(buf, alert, sizeof(alert)), 0);
+
+	type = tls_recv_record(_metadata, cfd, buf, sizeof(buf), &n);
+	ASSERT_EQ(type, TLS_RECORD_TYPE_DATA);
+	ASSERT_EQ(n, 5);
+	EXPECT_EQ(memcmp(buf, "after", 5), 0);
+
+	close(cfd);
+}
+
+TEST_HARNESS_MAIN
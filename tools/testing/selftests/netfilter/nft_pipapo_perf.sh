@@ -0,0 +1,99 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Cost of a pipapo (concatenated ranges) set lookup in the output path.
+#
+# Locally generated UDP packets are sent from a task to a static neighbour
+# on a dummy device, so the lookup runs in process context, the only
+# context in which the NEON lookup is used on 32-bit ARM. The same number
+# of packets is sent without and with a rule that looks up the set, and
+# the difference is reported per packet. Run it on kernels with and
+# without CONFIG_KERNEL_MODE_NEON (or on x86 with and without AVX2) to
+# compare the lookup implementations.
+#
+# Usage: nft_pipapo_perf.sh [elements] [packets]
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+elements=${1:-4096}
+packets=${2:-200000}
+
+sfx=$(mktemp -u "XXXXXXXX")
+ns="ns-pipapo-$sfx"
+
+cleanup() {
+	ip netns del "$ns" 2>/dev/null
+}
+
+for tool in nft ip dd; do
+	if ! command -v $tool >/dev/null 2>&1; then
+		echo "SKIP: $tool not found"
+		exit $ksft_skip
+	fi
+done
+
+if ! ip netns add "$ns" 2>/dev/null; then
+	echo "SKIP: cannot create netns"
+	exit $ksft_skip
+fi
+trap cleanup EXIT
+
+ip -net "$ns" link add dummy0 type dummy || exit $ksft_skip
+ip -net "$ns" link set dummy0 up
+ip -net "$ns" addr add 10.0.0.1/24 dev dummy0
+ip -net "$ns" neigh add 10.0.0.2 lladdr 02:00:00:00:00:02 dev dummy0
+
+# Elements never match the traffic, so every packet walks all fields.
+setup_set() {
+	local i
+
+	{
+		echo "table inet pipapo {"
+		echo "  set s {"
+		echo "    type ipv4_addr . inet_service . ipv4_addr"
+		echo "    flags interval"
+		echo "  }"
+		echo "  chain output {"
+		echo "    type filter hook output priority 0"
+		echo "  }"
+		echo "}"
+		for ((i = 0; i < elements; i++)); do
+			echo "add element inet pipapo s {" \
+			     "10.$((i >> 8 & 255)).$((i & 255)).0-10.$((i >> 8 & 255)).$((i & 255)).127 . " \
+			     "$((1024 + i % 60000))-$((1100 + i % 60000)) . " \
+			     "192.168.$((i & 255)).0/24 }"
+		done
+	} | ip netns exec "$ns" nft -f -
+}
+
+# Nanoseconds taken to send $packets datagrams from one task
+send_time() {
+	local start end
+
+	start=$(date +%s%N)
+	ip netns exec "$ns" bash -c \
+		"dd if=/dev/zero bs=32 count=$packets 2>/dev/null > /dev/udp/10.0.0.2/9"
+	end=$(date +%s%N)
+
+	echo $((end - start))
+}
+
+if ! setup_set; then
+	echo "SKIP: could not create a concatenated range set"
+	exit $ksft_skip
+fi
+
+send_time >/dev/null	# warm up
+
+base=$(send_time)
+ip netns exec "$ns" nft add rule inet pipapo output \
+	ip daddr . udp dport . ip saddr @s counter
+with=$(send_time)
+
+echo "elements $elements, packets $packets"
+echo "  without lookup: $((base / packets)) ns/pkt"
+echo "  with lookup:    $((with / packets)) ns/pkt"
+echo "  lookup cost:    $(((with - base) / packets)) ns/pkt"
+
+exit 0